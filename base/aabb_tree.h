@@ -0,0 +1,676 @@
+// Copyright (C) 2020-2024 Sami Väisänen
+// Copyright (C) 2020-2024 Ensisoft http://www.ensisoft.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "config.h"
+
+#include <vector>
+#include <set>
+#include <unordered_set>
+#include <optional>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#include "base/assert.h"
+#include "base/types.h"
+
+namespace base
+{
+    // Dynamic bounding volume hierarchy (AABB tree) for 2D objects.
+    // Unlike the QuadTree and the DenseSpatialGrid the tree doesn't
+    // cover any fixed area but adapts to the objects as they're
+    // inserted, so there's no need to re-shape it when objects
+    // move around.
+    // Each object is stored in a leaf node with a "fat" rect that
+    // is somewhat larger than the object's actual rect. As long as
+    // the object keeps moving within its fat rect the tree doesn't
+    // need to change at all. When the object leaves the fat rect
+    // the leaf is removed and re-inserted. The insertion uses a
+    // surface area (perimeter in 2D) heuristic to choose the best
+    // sibling for the new leaf and the tree is kept balanced with
+    // AVL style rotations while refitting the ancestors.
+    template<typename Object>
+    class AABBTree
+    {
+    public:
+        using ProxyId = int;
+        static constexpr ProxyId NullProxy = -1;
+
+        // Relative amount by which the leaf rects are grown.
+        static constexpr auto DefaultMarginFactor = 0.25f;
+        // Absolute (minimum) amount by which the leaf rects are grown.
+        static constexpr auto DefaultMargin = 1.0f;
+
+        explicit AABBTree(float margin_factor = DefaultMarginFactor, float margin = DefaultMargin) noexcept
+          : mMarginFactor(margin_factor)
+          , mMargin(margin)
+        {}
+
+        // Insert a new object with the given rect in the tree.
+        // Returns a proxy id that identifies the object in the tree.
+        ProxyId Insert(const FRect& rect, Object object)
+        {
+            const auto proxy = AllocateNode();
+            auto& node  = mNodes[proxy];
+            node.rect   = rect;
+            node.fat    = Fatten(rect);
+            node.object = std::move(object);
+            node.height = 0;
+            InsertLeaf(proxy);
+            ++mNumItems;
+            return proxy;
+        }
+        // Erase the object identified by the proxy id from the tree.
+        // The proxy id is no longer valid after this.
+        void Erase(ProxyId proxy)
+        {
+            ASSERT(IsLeaf(proxy));
+            RemoveLeaf(proxy);
+            FreeNode(proxy);
+            --mNumItems;
+        }
+        // Move the object identified by the proxy to a new rect.
+        // If the new rect is still within the object's fat rect
+        // only the object's rect is updated. Otherwise, the object
+        // is re-inserted in the tree. Returns true if the tree
+        // structure was changed.
+        bool Move(ProxyId proxy, const FRect& rect)
+        {
+            ASSERT(IsLeaf(proxy));
+            auto& node = mNodes[proxy];
+            const auto old_rect = node.rect;
+            node.rect = rect;
+            if (Contains(node.fat, rect))
+                return false;
+
+            RemoveLeaf(proxy);
+
+            // predict the movement by extending the fat rect
+            // in the direction of the displacement.
+            auto fat = Fatten(rect);
+            const auto displacement = rect.GetCenter() - old_rect.GetCenter();
+            const auto dx = displacement.GetX() * 2.0f;
+            const auto dy = displacement.GetY() * 2.0f;
+            auto min_x = fat.GetMinX();
+            auto min_y = fat.GetMinY();
+            auto max_x = fat.GetMaxX();
+            auto max_y = fat.GetMaxY();
+            if (dx < 0.0f)
+                min_x += dx;
+            else max_x += dx;
+            if (dy < 0.0f)
+                min_y += dy;
+            else max_y += dy;
+            mNodes[proxy].fat = FRect(min_x, min_y, max_x - min_x, max_y - min_y);
+
+            InsertLeaf(proxy);
+            return true;
+        }
+        void Clear() noexcept
+        {
+            mNodes.clear();
+            mRoot = NullProxy;
+            mFreeList = NullProxy;
+            mNumItems = 0;
+        }
+
+        Object& GetObject(ProxyId proxy) noexcept
+        {
+            ASSERT(IsLeaf(proxy));
+            return mNodes[proxy].object;
+        }
+        const Object& GetObject(ProxyId proxy) const noexcept
+        {
+            ASSERT(IsLeaf(proxy));
+            return mNodes[proxy].object;
+        }
+        // Get the actual rect of the object.
+        FRect GetRect(ProxyId proxy) const noexcept
+        {
+            ASSERT(IsLeaf(proxy));
+            return mNodes[proxy].rect;
+        }
+        // Get the fat rect of the object stored in the tree.
+        FRect GetFatRect(ProxyId proxy) const noexcept
+        {
+            ASSERT(IsLeaf(proxy));
+            return mNodes[proxy].fat;
+        }
+        // Get the rect that covers all the objects in the tree.
+        FRect GetRect() const noexcept
+        {
+            if (mRoot == NullProxy)
+                return FRect();
+            return mNodes[mRoot].fat;
+        }
+        unsigned GetNumItems() const noexcept
+        { return mNumItems; }
+        // Get the height of the tree. An empty tree has height 0
+        // and a tree with a single leaf has height 1.
+        unsigned GetHeight() const noexcept
+        {
+            if (mRoot == NullProxy)
+                return 0;
+            return mNodes[mRoot].height + 1;
+        }
+        // Check the structure of the tree for consistency. Returns
+        // false if any parent/child link, height or rect is incorrect.
+        bool Validate() const noexcept
+        {
+            if (mRoot == NullProxy)
+                return mNumItems == 0;
+            if (mNodes[mRoot].parent != NullProxy)
+                return false;
+            unsigned leaves = 0;
+            return ValidateNode(mRoot, &leaves) && leaves == mNumItems;
+        }
+
+        template<typename RetObject>
+        inline void Find(const FRect& rect, std::vector<RetObject>* result) const
+        { find_objects_by_rect(rect, result); }
+        template<typename RetObject>
+        inline void Find(const FRect& rect, std::set<RetObject>* result) const
+        { find_objects_by_rect(rect, result); }
+        template<typename RetObject>
+        inline void Find(const FRect& rect, std::unordered_set<RetObject>* result) const
+        { find_objects_by_rect(rect, result); }
+
+        enum class FindMode {
+            Closest, All, First
+        };
+
+        template<typename RetObject>
+        inline void Find(const FPoint& point, std::vector<RetObject>* result, FindMode mode = FindMode::All) const
+        { find_objects_by_point(point, result, mode); }
+        template<typename RetObject>
+        inline void Find(const FPoint& point, std::set<RetObject>* result, FindMode mode = FindMode::All) const
+        { find_objects_by_point(point, result, mode); }
+        template<typename RetObject>
+        inline void Find(const FPoint& point, std::unordered_set<RetObject>* result, FindMode mode = FindMode::All) const
+        { find_objects_by_point(point, result, mode); }
+
+        template<typename RetObject>
+        inline void Find(const FPoint& point, float radius, std::vector<RetObject>* result, FindMode mode = FindMode::All) const
+        { find_objects_by_point_radius(point, radius, result, mode); }
+        template<typename RetObject>
+        inline void Find(const FPoint& point, float radius, std::set<RetObject>* result, FindMode mode = FindMode::All) const
+        { find_objects_by_point_radius(point, radius, result, mode); }
+        template<typename RetObject>
+        inline void Find(const FPoint& point, float radius, std::unordered_set<RetObject>* result, FindMode mode = FindMode::All) const
+        { find_objects_by_point_radius(point, radius, result, mode); }
+
+        template<typename RetObject>
+        inline void Find(const FPoint& a, const FPoint& b, std::vector<RetObject>* result, FindMode mode = FindMode::All) const
+        { find_objects_by_line(a, b, result, mode); }
+        template<typename RetObject>
+        inline void Find(const FPoint& a, const FPoint& b, std::set<RetObject>* result, FindMode mode = FindMode::All) const
+        { find_objects_by_line(a, b, result, mode); }
+        template<typename RetObject>
+        inline void Find(const FPoint& a, const FPoint& b, std::unordered_set<RetObject>* result, FindMode mode = FindMode::All) const
+        { find_objects_by_line(a, b, result, mode); }
+
+    private:
+        struct Node {
+            // the actual rect of the object (leaf nodes only)
+            FRect rect;
+            // the fat rect of the object (leaf nodes) or the
+            // union of the children's fat rects (inner nodes)
+            FRect fat;
+            Object object = {};
+            // parent node or the next free node when the node
+            // is in the free list.
+            ProxyId parent = NullProxy;
+            ProxyId left   = NullProxy;
+            ProxyId right  = NullProxy;
+            // leaf = 0, free = -1
+            int height = -1;
+        };
+
+        bool IsLeaf(ProxyId proxy) const noexcept
+        {
+            ASSERT(proxy >= 0 && proxy < static_cast<ProxyId>(mNodes.size()));
+            return mNodes[proxy].height == 0;
+        }
+
+        FRect Fatten(const FRect& rect) const noexcept
+        {
+            const auto width  = rect.GetWidth();
+            const auto height = rect.GetHeight();
+            const auto margin = std::max(width, height) * mMarginFactor + mMargin;
+            return FRect(rect.GetX() - margin, rect.GetY() - margin,
+                         width + 2.0f * margin, height + 2.0f * margin);
+        }
+        // Combine two rects. Unlike base::Union this doesn't ignore
+        // rects with zero width or height (points and lines) which
+        // are perfectly valid objects in the tree.
+        static FRect Combine(const FRect& lhs, const FRect& rhs) noexcept
+        {
+            const auto min_x = std::min(lhs.GetMinX(), rhs.GetMinX());
+            const auto min_y = std::min(lhs.GetMinY(), rhs.GetMinY());
+            const auto max_x = std::max(lhs.GetMaxX(), rhs.GetMaxX());
+            const auto max_y = std::max(lhs.GetMaxY(), rhs.GetMaxY());
+            return FRect(min_x, min_y, max_x - min_x, max_y - min_y);
+        }
+        static bool Overlaps(const FRect& lhs, const FRect& rhs) noexcept
+        {
+            return !(lhs.GetMaxX() < rhs.GetMinX() || lhs.GetMinX() > rhs.GetMaxX() ||
+                     lhs.GetMaxY() < rhs.GetMinY() || lhs.GetMinY() > rhs.GetMaxY());
+        }
+        // Check whether the outer rect encloses the inner rect allowing
+        // for some floating point error in the x + width computations.
+        static bool Encloses(const FRect& outer, const FRect& inner) noexcept
+        {
+            constexpr auto epsilon = 0.001f;
+            return inner.GetMinX() >= outer.GetMinX() - epsilon &&
+                   inner.GetMinY() >= outer.GetMinY() - epsilon &&
+                   inner.GetMaxX() <= outer.GetMaxX() + epsilon &&
+                   inner.GetMaxY() <= outer.GetMaxY() + epsilon;
+        }
+        static float Perimeter(const FRect& rect) noexcept
+        { return 2.0f * (rect.GetWidth() + rect.GetHeight()); }
+
+        ProxyId AllocateNode()
+        {
+            if (mFreeList == NullProxy)
+            {
+                mNodes.emplace_back();
+                return static_cast<ProxyId>(mNodes.size() - 1);
+            }
+            const auto proxy = mFreeList;
+            mFreeList = mNodes[proxy].parent;
+            mNodes[proxy] = Node {};
+            return proxy;
+        }
+        void FreeNode(ProxyId proxy) noexcept
+        {
+            auto& node = mNodes[proxy];
+            node.object = Object {};
+            node.parent = mFreeList;
+            node.left   = NullProxy;
+            node.right  = NullProxy;
+            node.height = -1;
+            mFreeList = proxy;
+        }
+
+        void InsertLeaf(ProxyId leaf)
+        {
+            if (mRoot == NullProxy)
+            {
+                mRoot = leaf;
+                mNodes[leaf].parent = NullProxy;
+                return;
+            }
+
+            // find the best sibling for the new leaf by descending
+            // down the tree and comparing the cost of creating a new
+            // parent at the current node against the cost of pushing
+            // the leaf further down into either child. The cost is
+            // the perimeter of the new/enlarged rects.
+            const auto leaf_rect = mNodes[leaf].fat;
+            auto index = mRoot;
+            while (mNodes[index].height > 0)
+            {
+                const auto& node = mNodes[index];
+                const auto perimeter = Perimeter(node.fat);
+                const auto combined  = Perimeter(Combine(node.fat, leaf_rect));
+                // cost of creating a new parent for this node and the new leaf
+                const auto cost = 2.0f * combined;
+                // minimum cost of pushing the leaf further down the tree
+                const auto inheritance = 2.0f * (combined - perimeter);
+                const auto left_cost  = ComputeDescendCost(node.left,  leaf_rect) + inheritance;
+                const auto right_cost = ComputeDescendCost(node.right, leaf_rect) + inheritance;
+                if (cost < left_cost && cost < right_cost)
+                    break;
+
+                index = left_cost < right_cost ? node.left : node.right;
+            }
+            const auto sibling = index;
+
+            // create a new parent for the sibling and the leaf.
+            const auto old_parent = mNodes[sibling].parent;
+            const auto new_parent = AllocateNode();
+            {
+                auto& node  = mNodes[new_parent];
+                node.parent = old_parent;
+                node.fat    = Combine(leaf_rect, mNodes[sibling].fat);
+                node.height = mNodes[sibling].height + 1;
+                node.left   = sibling;
+                node.right  = leaf;
+            }
+            mNodes[sibling].parent = new_parent;
+            mNodes[leaf].parent    = new_parent;
+
+            if (old_parent == NullProxy)
+                mRoot = new_parent;
+            else if (mNodes[old_parent].left == sibling)
+                mNodes[old_parent].left = new_parent;
+            else mNodes[old_parent].right = new_parent;
+
+            Refit(mNodes[leaf].parent);
+        }
+        void RemoveLeaf(ProxyId leaf)
+        {
+            if (leaf == mRoot)
+            {
+                mRoot = NullProxy;
+                return;
+            }
+            const auto parent = mNodes[leaf].parent;
+            const auto grand_parent = mNodes[parent].parent;
+            const auto sibling = mNodes[parent].left == leaf
+                ? mNodes[parent].right
+                : mNodes[parent].left;
+
+            // replace the parent with the sibling.
+            if (grand_parent == NullProxy)
+            {
+                mRoot = sibling;
+                mNodes[sibling].parent = NullProxy;
+                FreeNode(parent);
+                return;
+            }
+            if (mNodes[grand_parent].left == parent)
+                mNodes[grand_parent].left = sibling;
+            else mNodes[grand_parent].right = sibling;
+            mNodes[sibling].parent = grand_parent;
+            FreeNode(parent);
+
+            Refit(grand_parent);
+        }
+        float ComputeDescendCost(ProxyId child, const FRect& leaf_rect) const noexcept
+        {
+            const auto& node = mNodes[child];
+            const auto combined = Perimeter(Combine(node.fat, leaf_rect));
+            if (node.height == 0)
+                return combined;
+            return combined - Perimeter(node.fat);
+        }
+        // Walk up the tree from the given node, re-balancing and
+        // re-computing the rects and heights of the ancestors.
+        void Refit(ProxyId index)
+        {
+            while (index != NullProxy)
+            {
+                index = Balance(index);
+
+                auto& node = mNodes[index];
+                const auto& left  = mNodes[node.left];
+                const auto& right = mNodes[node.right];
+                node.height = 1 + std::max(left.height, right.height);
+                node.fat    = Combine(left.fat, right.fat);
+                index = node.parent;
+            }
+        }
+        // Perform a left or right rotation if the node A is imbalanced.
+        // Returns the new root of the sub-tree.
+        ProxyId Balance(ProxyId iA)
+        {
+            auto& A = mNodes[iA];
+            if (A.height < 2)
+                return iA;
+
+            const auto iB = A.left;
+            const auto iC = A.right;
+            auto& B = mNodes[iB];
+            auto& C = mNodes[iC];
+            const auto balance = C.height - B.height;
+
+            // rotate C up
+            if (balance > 1)
+            {
+                const auto iF = C.left;
+                const auto iG = C.right;
+                auto& F = mNodes[iF];
+                auto& G = mNodes[iG];
+
+                C.left   = iA;
+                C.parent = A.parent;
+                A.parent = iC;
+                ReplaceChild(C.parent, iA, iC);
+
+                if (F.height > G.height)
+                {
+                    C.right  = iF;
+                    A.right  = iG;
+                    G.parent = iA;
+                    A.fat    = Combine(B.fat, G.fat);
+                    C.fat    = Combine(A.fat, F.fat);
+                    A.height = 1 + std::max(B.height, G.height);
+                    C.height = 1 + std::max(A.height, F.height);
+                }
+                else
+                {
+                    C.right  = iG;
+                    A.right  = iF;
+                    F.parent = iA;
+                    A.fat    = Combine(B.fat, F.fat);
+                    C.fat    = Combine(A.fat, G.fat);
+                    A.height = 1 + std::max(B.height, F.height);
+                    C.height = 1 + std::max(A.height, G.height);
+                }
+                return iC;
+            }
+
+            // rotate B up
+            if (balance < -1)
+            {
+                const auto iD = B.left;
+                const auto iE = B.right;
+                auto& D = mNodes[iD];
+                auto& E = mNodes[iE];
+
+                B.left   = iA;
+                B.parent = A.parent;
+                A.parent = iB;
+                ReplaceChild(B.parent, iA, iB);
+
+                if (D.height > E.height)
+                {
+                    B.right  = iD;
+                    A.left   = iE;
+                    E.parent = iA;
+                    A.fat    = Combine(C.fat, E.fat);
+                    B.fat    = Combine(A.fat, D.fat);
+                    A.height = 1 + std::max(C.height, E.height);
+                    B.height = 1 + std::max(A.height, D.height);
+                }
+                else
+                {
+                    B.right  = iE;
+                    A.left   = iD;
+                    D.parent = iA;
+                    A.fat    = Combine(C.fat, D.fat);
+                    B.fat    = Combine(A.fat, E.fat);
+                    A.height = 1 + std::max(C.height, D.height);
+                    B.height = 1 + std::max(A.height, E.height);
+                }
+                return iB;
+            }
+            return iA;
+        }
+        void ReplaceChild(ProxyId parent, ProxyId old_child, ProxyId new_child) noexcept
+        {
+            if (parent == NullProxy)
+            {
+                mRoot = new_child;
+                return;
+            }
+            auto& node = mNodes[parent];
+            if (node.left == old_child)
+                node.left = new_child;
+            else node.right = new_child;
+        }
+        bool ValidateNode(ProxyId index, unsigned* leaves) const noexcept
+        {
+            const auto& node = mNodes[index];
+            if (node.height == 0)
+            {
+                ++(*leaves);
+                return Encloses(node.fat, node.rect);
+            }
+            if (node.left == NullProxy || node.right == NullProxy)
+                return false;
+            const auto& left  = mNodes[node.left];
+            const auto& right = mNodes[node.right];
+            if (left.parent != index || right.parent != index)
+                return false;
+            if (node.height != 1 + std::max(left.height, right.height))
+                return false;
+            if (!Encloses(node.fat, left.fat) || !Encloses(node.fat, right.fat))
+                return false;
+            return ValidateNode(node.left, leaves) && ValidateNode(node.right, leaves);
+        }
+
+        // Visit the leaves whose fat rect passes the node test. The callback
+        // is called for each leaf and returns false to stop the traversal.
+        template<typename NodeTest, typename Callback>
+        void for_each_leaf(NodeTest test, Callback callback) const
+        {
+            if (mRoot == NullProxy)
+                return;
+
+            // the tree is balanced so this should be plenty
+            // for any realistic number of objects but the stack
+            // will grow when needed.
+            ProxyId static_stack[64];
+            std::vector<ProxyId> dynamic_stack;
+            ProxyId* stack = static_stack;
+            std::size_t capacity = 64;
+            std::size_t size = 0;
+            stack[size++] = mRoot;
+
+            while (size)
+            {
+                const auto& node = mNodes[stack[--size]];
+                if (!test(node.fat))
+                    continue;
+
+                if (node.height == 0)
+                {
+                    if (!callback(node))
+                        return;
+                    continue;
+                }
+                if (size + 2 > capacity)
+                {
+                    dynamic_stack.resize(capacity * 2);
+                    std::copy(stack, stack + size, dynamic_stack.begin());
+                    stack = dynamic_stack.data();
+                    capacity = dynamic_stack.size();
+                }
+                stack[size++] = node.right;
+                stack[size++] = node.left;
+            }
+        }
+
+        template<typename ItemTest, typename NodeTest, typename Container>
+        void find_objects(NodeTest node_test, ItemTest item_test, const FPoint& origin, Container* result, FindMode mode) const
+        {
+            if (mode == FindMode::All)
+            {
+                for_each_leaf(node_test, [&item_test, result](const Node& node) {
+                    if (item_test(node.rect))
+                        store_result(node.object, result);
+                    return true;
+                });
+            }
+            else if (mode == FindMode::First)
+            {
+                for_each_leaf(node_test, [&item_test, result](const Node& node) {
+                    if (!item_test(node.rect))
+                        return true;
+                    store_result(node.object, result);
+                    return false;
+                });
+            }
+            else if (mode == FindMode::Closest)
+            {
+                float best_dist = std::numeric_limits<float>::max();
+                std::optional<Object> best_found;
+                for_each_leaf(node_test, [&item_test, &origin, &best_found, &best_dist](const Node& node) {
+                    if (!item_test(node.rect))
+                        return true;
+                    const float dist = SquareDistance(origin, node.rect.GetCenter());
+                    if (dist < best_dist)
+                    {
+                        best_found = node.object;
+                        best_dist  = dist;
+                    }
+                    return true;
+                });
+                if (best_found)
+                    store_result(best_found.value(), result);
+            } else BUG("Missing FindMode implementation.");
+        }
+
+        template<typename Container>
+        void find_objects_by_rect(const FRect& rect, Container* result) const
+        {
+            for_each_leaf([&rect](const FRect& fat) {
+                return Overlaps(fat, rect);
+            }, [&rect, result](const Node& node) {
+                if (DoesIntersect(node.rect, rect))
+                    store_result(node.object, result);
+                return true;
+            });
+        }
+        template<typename Container>
+        void find_objects_by_point(const FPoint& point, Container* result, FindMode mode) const
+        {
+            const auto test = [&point](const FRect& rect) {
+                return rect.TestPoint(point);
+            };
+            find_objects(test, test, point, result, mode);
+        }
+        template<typename Container>
+        void find_objects_by_point_radius(const FPoint& point, float radius, Container* result, FindMode mode) const
+        {
+            const FCircle circle(point, radius);
+            const auto test = [&circle](const FRect& rect) {
+                return DoesIntersect(rect, circle);
+            };
+            find_objects(test, test, point, result, mode);
+        }
+        template<typename Container>
+        void find_objects_by_line(const FPoint& a, const FPoint& b, Container* result, FindMode mode) const
+        {
+            const FLine line(a, b);
+            const auto test = [&line](const FRect& rect) {
+                return DoesIntersect(rect, line);
+            };
+            find_objects(test, test, a, result, mode);
+        }
+
+        template<typename SrcObject, typename RetObject> inline
+        static void store_result(SrcObject object, std::vector<RetObject>* vector)
+        { vector->push_back(std::move(object)); }
+        template<typename SrcObject, typename RetObject> inline
+        static void store_result(SrcObject object, std::set<RetObject>* set)
+        { set->insert(std::move(object)); }
+        template<typename SrcObject, typename RetObject> inline
+        static void store_result(SrcObject object, std::unordered_set<RetObject>* set)
+        { set->insert(std::move(object)); }
+    private:
+        const float mMarginFactor = DefaultMarginFactor;
+        const float mMargin = DefaultMargin;
+        std::vector<Node> mNodes;
+        ProxyId mRoot = NullProxy;
+        ProxyId mFreeList = NullProxy;
+        unsigned mNumItems = 0;
+    };
+} // namespace
@@ -127,6 +127,25 @@ namespace base
                 }
             }
         }
+        // Erase the given object that was inserted with the given rect.
+        // Only the cells that intersect with the rect are visited.
+        void Erase(const base::FRect& rect, const Object& object) noexcept
+        {
+            const auto sub_rect = Intersect(mRect, rect);
+            if (sub_rect.IsEmpty())
+                return;
+
+            for_each_cell(sub_rect, [&object](const auto& c_items) {
+                auto& items = const_cast<ItemList&>(c_items);
+                for (auto it = items.begin(); it != items.end();)
+                {
+                    if (it->object == object)
+                        it = items.erase(it);
+                    else ++it;
+                }
+                return true;
+            });
+        }
         // Erase objects whose rects intersect with the given rectangle.
         void Erase(const base::FRect& rect) noexcept
         {
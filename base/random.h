@@ -19,6 +19,7 @@
 #include "config.h"
 
 #include <ctime>
+#include <cstdint>
 #include <type_traits>
 
 #include "warnpush.h"
@@ -122,4 +123,49 @@ namespace base
         mutable boost::mt19937 mersenne_twister_;
     };
 
+    // Small and fast pseudo random number generator for hot loops such
+    // as particle initialization where the cost of the boost generators
+    // and distributions (and calling them through std::function) adds up.
+    // Implements the PCG32 (XSH RR) generator. The generator is a plain
+    // value type, so each user (or thread) should have its own instance.
+    class FastRandom
+    {
+    public:
+        explicit FastRandom(std::uint64_t seed = 0x853c49e6748fea9bull) noexcept
+        { Seed(seed); }
+
+        inline void Seed(std::uint64_t seed) noexcept
+        {
+            mState = 0u;
+            NextUint();
+            mState += seed;
+            NextUint();
+        }
+        // Generate a random 32bit unsigned integer.
+        inline std::uint32_t NextUint() noexcept
+        {
+            const std::uint64_t old = mState;
+            mState = old * 6364136223846793005ull + 1442695040888963407ull;
+            const auto xorshifted = static_cast<std::uint32_t>(((old >> 18u) ^ old) >> 27u);
+            const auto rotation = static_cast<std::uint32_t>(old >> 59u);
+            return (xorshifted >> rotation) | (xorshifted << ((32u - rotation) & 31u));
+        }
+        // Generate a random float in the [0.0f, 1.0f) range.
+        inline float NextFloat() noexcept
+        {
+            // use the top 24 bits which is the float mantissa precision.
+            return static_cast<float>(NextUint() >> 8u) * (1.0f / 16777216.0f);
+        }
+        // Generate a random float in the range of min max. Like with
+        // base::rand if min >= max then min is returned.
+        inline float operator()(float min, float max) noexcept
+        {
+            if (min >= max)
+                return min;
+            return min + (max - min) * NextFloat();
+        }
+    private:
+        std::uint64_t mState = 0;
+    };
+
 } // namespace
\ No newline at end of file
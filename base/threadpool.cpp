@@ -18,6 +18,7 @@
 #include "config.h"
 
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <mutex>
 #include <queue>
@@ -47,6 +48,8 @@ void ThreadTask::Execute()
         mException = std::current_exception();
     }
     mDone.store(true, std::memory_order_release);
+
+    ThreadPool::SubmitContinuations(this);
 }
 
 void ThreadTask::RethrowException() const
@@ -56,6 +59,16 @@ void ThreadTask::RethrowException() const
 
 struct ThreadPool::State {
     std::atomic<size_t> num_tasks = 0;
+    // the number of tasks currently sitting in the worker queues
+    // that are available for any worker thread to steal.
+    std::atomic<size_t> num_stealable_tasks = 0;
+    std::atomic<size_t> round_robin = 0;
+    // the worker threads wait on this condition for new work
+    // to become available either in their own queue or in the
+    // queue of some other worker.
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<RealThread*> workers;
 };
 
 class ThreadPool::Thread
@@ -72,27 +85,75 @@ public:
     explicit RealThread(std::shared_ptr<State> state, std::size_t id) noexcept
        : mState(std::move(state))
        , mThreadId(id)
+       , mIsWorker(id & 0xff00)
     {}
 
+    // Submit a task that must be executed by this thread.
     void Submit(std::shared_ptr<ThreadTask> task) override
     {
-        std::lock_guard<std::mutex> lock(mMutex);
-        mTaskQueue.push(std::move(task));
-        mCondition.notify_one();
+        if (mIsWorker)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mTaskQueue.push_back(std::move(task));
+            }
+            // must wake up all the workers since we can't know which
+            // thread the condition would wake up.
+            std::lock_guard<std::mutex> lock(mState->mutex);
+            mState->condition.notify_all();
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTaskQueue.push_back(std::move(task));
+            mCondition.notify_one();
+        }
+    }
+
+    // Push a task onto this worker thread's work queue from where
+    // any other worker thread can also steal it.
+    void Push(std::shared_ptr<ThreadTask> task)
+    {
+        ASSERT(mIsWorker);
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mWorkQueue.push_back(std::move(task));
+        }
+        mState->num_stealable_tasks++;
+
+        std::lock_guard<std::mutex> lock(mState->mutex);
+        mState->condition.notify_one();
     }
 
     size_t GetThreadId() const override
     {
         return mThreadId;
     }
+    bool IsWorker() const
+    {
+        return mIsWorker;
+    }
 
-    void Shutdown()
+    void Stop()
     {
+        mRunThread.store(false);
+
+        if (mIsWorker)
+        {
+            std::lock_guard<std::mutex> lock(mState->mutex);
+            mState->condition.notify_all();
+        }
+        else
         {
             std::lock_guard<std::mutex> lock(mMutex);
-            mRunThread = false;
             mCondition.notify_one();
         }
+    }
+
+    void Shutdown()
+    {
+        Stop();
+
         mThread->join();
 
         ASSERT(mTaskQueue.empty());
@@ -118,12 +179,132 @@ public:
         mCondition.notify_one();
     }
 
+    // Try to steal a task from the front of this worker's work queue.
+    // The owner thread takes tasks from the back.
+    std::shared_ptr<ThreadTask> Steal()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mWorkQueue.empty())
+            return nullptr;
+
+        auto task = std::move(mWorkQueue.front());
+        mWorkQueue.pop_front();
+        mState->num_stealable_tasks--;
+        return task;
+    }
+
+    static RealThread* GetCurrentWorker(const State* state) noexcept
+    {
+        if (current_worker && current_worker->mState.get() == state)
+            return current_worker;
+        return nullptr;
+    }
+
 private:
+    bool HasLocalWork()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return !mTaskQueue.empty() || !mWorkQueue.empty();
+    }
+
+    std::shared_ptr<ThreadTask> PopLocal()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mTaskQueue.empty())
+        {
+            auto task = std::move(mTaskQueue.front());
+            mTaskQueue.pop_front();
+            return task;
+        }
+        if (!mWorkQueue.empty())
+        {
+            // LIFO on the owner's side since the most recently
+            // pushed task is the most likely to have its data
+            // still in the cache.
+            auto task = std::move(mWorkQueue.back());
+            mWorkQueue.pop_back();
+            mState->num_stealable_tasks--;
+            return task;
+        }
+        return nullptr;
+    }
+
+    std::shared_ptr<ThreadTask> StealRemote()
+    {
+        std::lock_guard<std::mutex> lock(mState->mutex);
+        const auto& workers = mState->workers;
+        const auto num_workers = workers.size();
+        if (num_workers <= 1)
+            return nullptr;
+
+        // start looking from the next worker over so that the
+        // workers don't all start hammering the same victim.
+        size_t self = 0;
+        for (; self<num_workers; ++self)
+        {
+            if (workers[self] == this)
+                break;
+        }
+
+        for (size_t i=1; i<num_workers; ++i)
+        {
+            auto* victim = workers[(self + i) % num_workers];
+            if (auto task = victim->Steal())
+                return task;
+        }
+        return nullptr;
+    }
+
+    // Get the next task for a non-worker thread. Returns false if the
+    // thread should exit.
+    bool WaitNamedTask(std::shared_ptr<ThreadTask>* task)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        // use a loop in order to protect against spurious
+        // signals on the condition
+        while (mRunThread && mTaskQueue.empty())
+        {
+            mCondition.wait(lock);
+        }
+
+        if (!mTaskQueue.empty())
+        {
+            *task = std::move(mTaskQueue.front());
+            mTaskQueue.pop_front();
+        }
+        return mRunThread;
+    }
+
+    // Get the next task for a worker thread. First look in our own
+    // queues and if there's nothing there then try to steal work from
+    // the other workers. Returns false if the thread should exit.
+    bool WaitWorkerTask(std::shared_ptr<ThreadTask>* task)
+    {
+        while (mRunThread)
+        {
+            if ((*task = PopLocal()))
+                return true;
+            if ((*task = StealRemote()))
+                return true;
+
+            std::unique_lock<std::mutex> lock(mState->mutex);
+            while (mRunThread && !HasLocalWork() && mState->num_stealable_tasks == 0)
+            {
+                mState->condition.wait(lock);
+            }
+        }
+        return false;
+    }
+
     void ThreadMain()
     {
         DEBUG("Hello from thread pool thread. [id=%1]", mThreadId);
         std::unique_ptr<base::TraceLog> trace;
 
+        if (mIsWorker)
+            current_worker = this;
+
         while (true)
         {
             // enable disable tracing on this thread
@@ -143,7 +324,6 @@ private:
             }
 
             std::shared_ptr<ThreadTask> task;
-            bool running = true;
 
             // most of the trace calls are commented out because of the large
             // volume of data that is generated. Only have kept the task tracing
@@ -151,27 +331,8 @@ private:
             TRACE_START();
             ///TRACE_ENTER(MainLoop);
 
-            // use an explicit scope here to make sure the lock is
-            // released as soon as we have something
-            {
-                ///TRACE_SCOPE("WaitTask");
-                std::unique_lock<std::mutex> lock(mMutex);
-
-                // use a loop in order to protect against spurious
-                // signals on the condition
-                while (mRunThread && mTaskQueue.empty())
-                {
-                    mCondition.wait(lock);
-                }
-
-                if (!mTaskQueue.empty())
-                {
-                    task = std::move(mTaskQueue.front());
-                    mTaskQueue.pop();
-                }
-                running = mRunThread;
-            }
-
+            const bool running = mIsWorker ? WaitWorkerTask(&task)
+                                           : WaitNamedTask(&task);
             if (!running)
             {
                 ///TRACE_LEAVE(MainLoop);
@@ -208,22 +369,31 @@ private:
             }
 
         }
+        current_worker = nullptr;
         DEBUG("Thread pool thread exiting... [id=%1]", mThreadId);
     }
 
 private:
+    static thread_local RealThread* current_worker;
+
     std::shared_ptr<State> mState;
     std::mutex mMutex;
     std::condition_variable mCondition;
     std::unique_ptr<std::thread> mThread;
-    std::queue<std::shared_ptr<ThreadTask>> mTaskQueue;
+    // tasks that have been submitted to this thread specifically.
+    std::deque<std::shared_ptr<ThreadTask>> mTaskQueue;
+    // tasks that can be executed by any worker thread.
+    std::deque<std::shared_ptr<ThreadTask>> mWorkQueue;
 
     base::TraceWriter* mTraceWriter = nullptr;
     bool mEnableTrace = false;
-    bool mRunThread = true;
+    std::atomic<bool> mRunThread = {true};
     std::size_t mThreadId = 0;
+    bool mIsWorker = false;
 };
 
+thread_local ThreadPool::RealThread* ThreadPool::RealThread::current_worker = nullptr;
+
 class ThreadPool::MainThread : public ThreadPool::Thread
 {
 public:
@@ -233,6 +403,7 @@ public:
 
     void Submit(std::shared_ptr<ThreadTask> task) override
     {
+        std::lock_guard<std::mutex> lock(mutex_);
         queue_.push(std::move(task));
     }
     size_t GetThreadId() const override
@@ -244,11 +415,19 @@ public:
     {
         ///TRACE_SCOPE("ExecuteMainThread");
 
-        while (!queue_.empty())
+        while (true)
         {
-            auto task = queue_.front();
-
-            queue_.pop();
+            std::shared_ptr<ThreadTask> task;
+            {
+                // continuations can be submitted to the main
+                // thread from any of the other threads.
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (queue_.empty())
+                    break;
+
+                task = std::move(queue_.front());
+                queue_.pop();
+            }
 
             if (!task->IsComplete())
             {
@@ -269,6 +448,7 @@ public:
     }
 private:
     std::shared_ptr<State> state_;
+    std::mutex mutex_;
     std::queue<std::shared_ptr<ThreadTask>> queue_;
 
 };
@@ -276,6 +456,9 @@ private:
 
 void TaskHandle::Wait(WaitStrategy strategy) noexcept
 {
+    base::ElapsedTimer t;
+    t.Start();
+
     // assuming our current thread is the "main" thread
     // if we call here to wait for completion we'll spin
     // indefinitely since the current thread would then
@@ -283,15 +466,28 @@ void TaskHandle::Wait(WaitStrategy strategy) noexcept
 
     if (mThreadId == ThreadPool::MainThreadID)
     {
+        // a continuation can't be executed before its
+        // parent task has completed. the parent might be
+        // a main thread task too (or depend on one) so the
+        // pending main thread tasks must be run here or the
+        // continuation would never be released.
+        while (mTask->IsDeferred())
+        {
+            if (mPool)
+                mPool->ExecuteMainThread();
+
+            if (strategy == WaitStrategy::Sleep)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(1));
+            }
+        }
+
         if (!IsComplete())
         {
             mTask->Execute();
         }
     }
 
-    base::ElapsedTimer t;
-    t.Start();
-
     while (!IsComplete())
     {
         // holy hell batman, let's not cause a stall here by blocking the
@@ -324,6 +520,11 @@ ThreadPool::~ThreadPool()
 void ThreadPool::AddRealThread(size_t threadId)
 {
     auto thread = std::make_unique<RealThread>(mState, threadId);
+    if (thread->IsWorker())
+    {
+        std::lock_guard<std::mutex> lock(mState->mutex);
+        mState->workers.push_back(thread.get());
+    }
     thread->Start();
     mRealThreads.push_back(std::move(thread));
     DEBUG("Added real thread pool thread.");
@@ -338,30 +539,78 @@ void ThreadPool::AddMainThread()
 
 TaskHandle ThreadPool::SubmitTask(std::unique_ptr<ThreadTask> task, size_t threadId)
 {
-    Thread* thread = nullptr;
+    std::shared_ptr<ThreadTask> shared(std::move(task));
+
+    TaskHandle handle(shared, threadId, this);
+
+    SubmitShared(std::move(shared), threadId);
+
+    return handle;
+}
+
+TaskHandle ThreadPool::SubmitContinuation(const TaskHandle& parent, std::unique_ptr<ThreadTask> task, size_t threadId)
+{
+    ASSERT(parent.IsValid());
+
+    std::shared_ptr<ThreadTask> shared(std::move(task));
+
+    TaskHandle handle(shared, threadId, this);
+
+    // the parent task is not available through the handle's public
+    // API until it's complete, so dig it out here.
+    auto* parent_task = parent.mTask.get();
+    {
+        std::lock_guard<std::mutex> lock(parent_task->mContinuationLock);
+        if (!parent_task->IsComplete())
+        {
+            shared->mDeferred.store(true, std::memory_order_release);
+
+            ThreadTask::Continuation continuation;
+            continuation.task     = std::move(shared);
+            continuation.threadId = threadId;
+            continuation.pool     = this;
+            parent_task->mContinuations.push_back(std::move(continuation));
+            return handle;
+        }
+    }
+    SubmitShared(std::move(shared), threadId);
+    return handle;
+}
+
+void ThreadPool::SubmitShared(std::shared_ptr<ThreadTask> task, size_t threadId)
+{
+    // increment the counter before the task becomes visible to any
+    // thread so that it can't be decremented before it's incremented.
+    mState->num_tasks++;
 
     if (threadId == ThreadPool::MainThreadID)
     {
         ASSERT(mMainThread && "Main thread has not been added to the thread pool");
-        thread = mMainThread.get();
+        mMainThread->Submit(std::move(task));
     }
     else if (threadId == ThreadPool::AnyWorkerThreadID)
     {
-        std::vector<RealThread*> workers;
-        for (auto& t : mRealThreads)
+        // if we're submitting from a worker thread then push the task
+        // onto that worker's own queue. Idle workers will steal it if
+        // the current worker doesn't get to it first.
+        if (auto* worker = RealThread::GetCurrentWorker(mState.get()))
         {
-            if (t->GetThreadId() & 0xff00)
-                workers.push_back(t.get());
-
+            worker->Push(std::move(task));
+            return;
         }
 
-        ASSERT(!workers.empty() && "The thread pool has no worker threads.");
-        thread = workers[mRoundRobin % workers.size()];
-        mRoundRobin++;
-
+        RealThread* worker = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mState->mutex);
+            const auto& workers = mState->workers;
+            ASSERT(!workers.empty() && "The thread pool has no worker threads.");
+            worker = workers[mState->round_robin++ % workers.size()];
+        }
+        worker->Push(std::move(task));
     }
     else
     {
+        Thread* thread = nullptr;
         for (auto& t : mRealThreads)
         {
             if (t->GetThreadId() == threadId)
@@ -371,27 +620,131 @@ TaskHandle ThreadPool::SubmitTask(std::unique_ptr<ThreadTask> task, size_t threa
             }
         }
         ASSERT(thread && "No such named thread has been added to the thread pool.");
+        thread->Submit(std::move(task));
     }
+}
 
-    std::shared_ptr<ThreadTask> shared(std::move(task));
+void ThreadPool::SubmitContinuations(ThreadTask* task)
+{
+    std::vector<ThreadTask::Continuation> continuations;
+    {
+        std::lock_guard<std::mutex> lock(task->mContinuationLock);
+        std::swap(continuations, task->mContinuations);
+    }
+    for (auto& continuation : continuations)
+    {
+        continuation.task->mDeferred.store(false, std::memory_order_release);
+        continuation.pool->SubmitShared(std::move(continuation.task), continuation.threadId);
+    }
+}
 
-    TaskHandle handle(shared, threadId);
+void ThreadPool::ExecuteChunks(std::size_t num_chunks, const ChunkFunction& function)
+{
+    const auto num_workers = GetWorkerCount();
+    if (num_chunks <= 1 || num_workers == 0)
+    {
+        for (size_t chunk=0; chunk<num_chunks; ++chunk)
+            function(chunk);
+        return;
+    }
 
-    thread->Submit(std::move(shared));
+    // The chunks are handed out through an atomic counter so any thread
+    // that participates simply keeps grabbing the next chunk until they
+    // have all been handed out. The batch state is shared with the helper
+    // tasks since a helper task might only start running after the batch
+    // has already been completed and this function has returned. In that
+    // case it won't find any chunks and won't touch the chunk function.
+    struct Batch {
+        std::atomic<size_t> next_chunk = 0;
+        std::atomic<size_t> done_chunks = 0;
+        std::size_t num_chunks = 0;
+        const ChunkFunction* function = nullptr;
+        std::mutex mutex;
+        std::exception_ptr exception;
+
+        void Run()
+        {
+            while (true)
+            {
+                const auto chunk = next_chunk++;
+                if (chunk >= num_chunks)
+                    break;
 
-    mState->num_tasks++;
+                try
+                {
+                    (*function)(chunk);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!exception)
+                        exception = std::current_exception();
+                }
+                done_chunks.fetch_add(1, std::memory_order_release);
+            }
+        }
+    };
+
+    class ChunkTask : public ThreadTask {
+    public:
+        explicit ChunkTask(std::shared_ptr<Batch> batch) noexcept
+          : mBatch(std::move(batch))
+        {}
+    protected:
+        void DoTask() override
+        {
+            mBatch->Run();
+        }
+    private:
+        const std::shared_ptr<Batch> mBatch;
+    };
+
+    auto batch = std::make_shared<Batch>();
+    batch->num_chunks = num_chunks;
+    batch->function   = &function;
+
+    // the calling thread takes part in the work so the number
+    // of helpers can be one less than the number of chunks.
+    const auto num_helpers = std::min(num_workers, num_chunks - 1);
+    for (size_t i=0; i<num_helpers; ++i)
+    {
+        auto task = std::make_unique<ChunkTask>(batch);
+        task->SetTaskName("ChunkTask");
+        SubmitTask(std::move(task), AnyWorkerThreadID);
+    }
 
-    return handle;
+    batch->Run();
+
+    // wait for the chunks that are still being processed
+    // by other threads to complete.
+    while (batch->done_chunks.load(std::memory_order_acquire) != num_chunks)
+    {
+        std::this_thread::yield();
+    }
+
+    if (batch->exception)
+        std::rethrow_exception(batch->exception);
 }
 
 void ThreadPool::Shutdown()
 {
     DEBUG("Thread pool shutdown.");
 
+    // stop all threads first so that none of the workers
+    // will go and steal work from the threads that are
+    // shutting down.
+    for (auto& thread : mRealThreads)
+    {
+        thread->Stop();
+    }
     for (auto& thread : mRealThreads)
     {
         thread->Shutdown();
     }
+    {
+        std::lock_guard<std::mutex> lock(mState->mutex);
+        mState->workers.clear();
+    }
     mRealThreads.clear();
 
     mMainThread.reset();
@@ -422,6 +775,12 @@ bool ThreadPool::HasThread(std::size_t threadId) const
     return false;
 }
 
+std::size_t ThreadPool::GetWorkerCount() const
+{
+    std::lock_guard<std::mutex> lock(mState->mutex);
+    return mState->workers.size();
+}
+
 void ThreadPool::ExecuteMainThread()
 {
     if (mMainThread)
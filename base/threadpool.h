@@ -18,13 +18,17 @@
 
 #include "config.h"
 
+#include <algorithm>
 #include <thread>
 #include <atomic>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <chrono>
 #include <optional>
 #include <typeinfo>
+#include <vector>
+#include <functional>
 
 #include "base/platform.h"
 #include "base/logging.h"
@@ -33,6 +37,7 @@
 namespace base
 {
     class TraceWriter;
+    class ThreadPool;
 
     class ThreadTask
     {
@@ -60,6 +65,11 @@ namespace base
         inline bool IsComplete() const noexcept
         { return mDone.load(std::memory_order_acquire); }
 
+        // Check whether the task is a continuation that is still waiting
+        // for its parent task to complete before it can be executed.
+        inline bool IsDeferred() const noexcept
+        { return mDeferred.load(std::memory_order_acquire); }
+
         inline bool TestFlag(Flags flag) const noexcept
         { return mFlags.test(flag); }
 
@@ -133,11 +143,21 @@ namespace base
             static std::atomic<size_t> id(1);
             return id++;
         }
+        friend class ThreadPool;
+
+        struct Continuation {
+            std::shared_ptr<ThreadTask> task;
+            std::size_t threadId = 0;
+            ThreadPool* pool = nullptr;
+        };
 
     private:
         std::size_t mTaskId = 0;
         std::exception_ptr mException;
         std::atomic<bool> mDone = {false};
+        std::atomic<bool> mDeferred = {false};
+        std::mutex mContinuationLock;
+        std::vector<Continuation> mContinuations;
         std::optional<Description> mDescription;
         std::string mErrorString;
     };
@@ -148,9 +168,10 @@ namespace base
     public:
         TaskHandle() = default;
 
-        explicit TaskHandle(std::shared_ptr<ThreadTask> task, size_t threadId)
+        explicit TaskHandle(std::shared_ptr<ThreadTask> task, size_t threadId, ThreadPool* pool = nullptr)
           : mTask(std::move(task))
           , mThreadId(threadId)
+          , mPool(pool)
         {}
 
         inline bool IsComplete() const noexcept
@@ -210,8 +231,12 @@ namespace base
         }
 
     private:
+        friend class ThreadPool;
         std::shared_ptr<ThreadTask> mTask;
         std::size_t mThreadId = 0;
+        // the pool that the task was submitted to. used for running
+        // the main thread tasks while waiting on a main thread task.
+        ThreadPool* mPool = nullptr;
     };
 
     class ThreadPool
@@ -237,9 +262,31 @@ namespace base
         void AddRealThread(size_t threadId);
         void AddMainThread();
 
+        // Submit a new task for execution on the given thread. When the
+        // thread is AnyWorkerThreadID the task is placed on the queue of
+        // one of the worker threads from where it can be stolen by any
+        // other idle worker thread. Tasks submitted to a specific thread
+        // are only ever executed by that thread in FIFO order.
         TaskHandle SubmitTask(std::unique_ptr<ThreadTask> task,
                               std::size_t threadID = AnyWorkerThreadID);
 
+        // Submit a continuation task that will be submitted for execution
+        // on the given thread only after the parent task has completed.
+        // The continuation is executed regardless of whether the parent
+        // task failed or not.
+        TaskHandle SubmitContinuation(const TaskHandle& parent,
+                                      std::unique_ptr<ThreadTask> task,
+                                      std::size_t threadID = AnyWorkerThreadID);
+
+        // Run the chunk function for every chunk index in [0, num_chunks)
+        // using the worker threads. The calling thread participates in the
+        // execution and the call returns only once every chunk has been
+        // processed. Any exception thrown by the chunk function is re-thrown
+        // on the calling thread. If there are no worker threads the chunks
+        // are executed serially on the calling thread.
+        using ChunkFunction = std::function<void (std::size_t chunk)>;
+        void ExecuteChunks(std::size_t num_chunks, const ChunkFunction& function);
+
         void Shutdown();
 
         void WaitAll();
@@ -248,6 +295,10 @@ namespace base
 
         bool HasThread(std::size_t threadId) const;
 
+        // Get the number of worker threads, i.e. the threads that can
+        // execute tasks submitted with AnyWorkerThreadID.
+        std::size_t GetWorkerCount() const;
+
         void ExecuteMainThread();
 
         void SetThreadTraceWriter(base::TraceWriter* writer);
@@ -257,11 +308,13 @@ namespace base
         struct State;
         class RealThread;
         class MainThread;
+        friend class ThreadTask;
+        void SubmitShared(std::shared_ptr<ThreadTask> task, std::size_t threadId);
+        static void SubmitContinuations(ThreadTask* task);
     private:
         std::shared_ptr<State> mState;
         std::vector<std::unique_ptr<RealThread>> mRealThreads;
         std::unique_ptr<MainThread> mMainThread;
-        std::size_t mRoundRobin = 0;
     };
 
     ThreadPool* GetGlobalThreadPool();
@@ -273,4 +326,79 @@ namespace base
         return GetGlobalThreadPool() != nullptr;
     }
 
+    // Call the function for every index in the range [begin, end). The range
+    // is split into chunks of at most 'grain' indices which are then executed
+    // in parallel on the thread pool worker threads. If the thread pool is
+    // null the whole range is processed serially on the calling thread.
+    template<typename Function>
+    void ParallelFor(ThreadPool* pool, std::size_t begin, std::size_t end, std::size_t grain, Function function)
+    {
+        if (end <= begin)
+            return;
+
+        grain = grain ? grain : 1;
+        const auto count = end - begin;
+        const auto num_chunks = (count + grain - 1) / grain;
+        if (pool == nullptr || num_chunks == 1)
+        {
+            for (std::size_t i=begin; i<end; ++i)
+                function(i);
+            return;
+        }
+        pool->ExecuteChunks(num_chunks, [begin, end, grain, &function](std::size_t chunk) {
+            const auto chunk_begin = begin + chunk * grain;
+            const auto chunk_end   = std::min(chunk_begin + grain, end);
+            for (std::size_t i=chunk_begin; i<chunk_end; ++i)
+                function(i);
+        });
+    }
+
+    // Map every index in the range [begin, end) to a value and combine the
+    // values into a single result. Each chunk of at most 'grain' indices is
+    // reduced in parallel starting from the identity value and the partial
+    // results are then combined in chunk order on the calling thread. This
+    // means the result is deterministic as long as the combine function is
+    // associative, regardless of how the chunks were scheduled.
+    template<typename T, typename Map, typename Combine>
+    T ParallelReduce(ThreadPool* pool, std::size_t begin, std::size_t end, std::size_t grain,
+                     T identity, Map map, Combine combine)
+    {
+        if (end <= begin)
+            return identity;
+
+        grain = grain ? grain : 1;
+        const auto count = end - begin;
+        const auto num_chunks = (count + grain - 1) / grain;
+
+        // wrap the value so that we never end up with std::vector<bool>
+        // which cannot be written to concurrently.
+        struct Partial {
+            T value;
+        };
+        std::vector<Partial> partials(num_chunks, Partial{identity});
+        auto reduce_chunk = [begin, end, grain, &partials, &map, &combine](std::size_t chunk) {
+            const auto chunk_begin = begin + chunk * grain;
+            const auto chunk_end   = std::min(chunk_begin + grain, end);
+            T value = std::move(partials[chunk].value);
+            for (std::size_t i=chunk_begin; i<chunk_end; ++i)
+                value = combine(std::move(value), map(i));
+            partials[chunk].value = std::move(value);
+        };
+
+        if (pool == nullptr || num_chunks == 1)
+        {
+            for (std::size_t chunk=0; chunk<num_chunks; ++chunk)
+                reduce_chunk(chunk);
+        }
+        else
+        {
+            pool->ExecuteChunks(num_chunks, reduce_chunk);
+        }
+
+        T result = std::move(identity);
+        for (auto& partial : partials)
+            result = combine(std::move(result), std::move(partial.value));
+        return result;
+    }
+
 } // namespace
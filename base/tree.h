@@ -481,6 +481,47 @@ namespace base
                 }
             }
 
+            // Same as above except that only the nodes whose rect intersects
+            // with the given rect are visited. The rect must be the same rect
+            // that was used to insert the object(s) that are to be erased.
+            template<typename Predicate>
+            void Erase(const base::FRect& rect, Predicate predicate, mem::Allocator& alloc, unsigned max_items) noexcept
+            {
+                for (auto it = mItems.begin(); it != mItems.end();)
+                {
+                    auto& item = *it;
+                    if (predicate(item.object, GetItemRect(item)))
+                        it = mItems.erase(it);
+                    else ++it;
+                }
+                if (!HasChildren())
+                    return;
+
+                size_t items = 0;
+                for (int i=0; i<4; ++i)
+                {
+                    // use the same test as Insert to find the quadrants
+                    // that the object was inserted in.
+                    const auto& intersection = base::Intersect(mQuadrants[i]->GetRect(), rect);
+                    if (!intersection.IsEmpty())
+                        mQuadrants[i]->Erase(intersection, predicate, alloc, max_items);
+                    items += mQuadrants[i]->GetNumItems();
+                    if (mQuadrants[i]->HasChildren())
+                        items += max_items + 1;
+                }
+                if (items > max_items)
+                    return;
+
+                for (int i=0; i<4; ++i)
+                {
+                    mQuadrants[i]->MoveItems(mItems);
+                    mQuadrants[i]->Clear(alloc);
+                    mQuadrants[i]->~QuadTreeNode();
+                    alloc.Free((void*)mQuadrants[i]);
+                    mQuadrants[i] = nullptr;
+                }
+            }
+
             inline bool HasChildren() const noexcept
             { return !!mQuadrants[0]; }
             inline bool HasItems() const noexcept
@@ -586,6 +627,16 @@ namespace base
         template<typename Predicate>
         void Erase(Predicate predicate) noexcept
         { mRoot.Erase(std::move(predicate), mPool, mMaxItems); }
+        // Erase the given object that was inserted with the given rect.
+        // Only the part of the tree that intersects with the rect is visited.
+        void Erase(const base::FRect& rect, Object object) noexcept
+        {
+            mRoot.Erase(rect, [&object](const Object& item, const base::FRect&) {
+                return item == object;
+            }, mPool, mMaxItems);
+        }
+        const base::FRect& GetRect() const noexcept
+        { return mRoot.GetRect(); }
 
         const TreeNode& GetRoot() const noexcept
         { return mRoot; }
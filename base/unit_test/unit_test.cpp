@@ -693,6 +693,51 @@ void unit_test_color()
     }
 }
 
+void unit_test_fast_random()
+{
+    TEST_CASE(test::Type::Feature)
+
+    // same seed gives the same sequence, different seed a different sequence.
+    {
+        base::FastRandom a(123);
+        base::FastRandom b(123);
+        base::FastRandom c(124);
+        unsigned same = 0;
+        for (unsigned i=0; i<100; ++i)
+        {
+            const auto val = a.NextUint();
+            TEST_REQUIRE(val == b.NextUint());
+            same += val == c.NextUint();
+        }
+        TEST_REQUIRE(same < 5);
+    }
+
+    // range and distribution
+    {
+        base::FastRandom random(0xdeadbeef);
+        float sum = 0.0f;
+        unsigned buckets[10] = {};
+        for (unsigned i=0; i<100000; ++i)
+        {
+            const auto val = random.NextFloat();
+            TEST_REQUIRE(val >= 0.0f && val < 1.0f);
+            buckets[unsigned(val * 10.0f)]++;
+            sum += val;
+        }
+        TEST_REQUIRE(sum / 100000.0f > 0.49f && sum / 100000.0f < 0.51f);
+        for (unsigned count : buckets)
+            TEST_REQUIRE(count > 9500 && count < 10500);
+
+        for (unsigned i=0; i<1000; ++i)
+        {
+            const auto val = random(-5.0f, 5.0f);
+            TEST_REQUIRE(val >= -5.0f && val <= 5.0f);
+        }
+        TEST_REQUIRE(random(1.0f, 1.0f) == 1.0f);
+        TEST_REQUIRE(random(2.0f, 1.0f) == 2.0f);
+    }
+}
+
 EXPORT_TEST_MAIN(
 int test_main(int argc, char* argv[])
 {
@@ -707,6 +752,7 @@ int test_main(int argc, char* argv[])
     unit_test_rect_mapping();
     unit_test_string();
     unit_test_color();
+    unit_test_fast_random();
 
     unit_test_shmem();
     unit_test_trace();
@@ -0,0 +1,281 @@
+// Copyright (C) 2020-2024 Sami Väisänen
+// Copyright (C) 2020-2024 Ensisoft http://www.ensisoft.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "config.h"
+
+#include <string>
+#include <vector>
+#include <set>
+#include <cstddef>
+
+#include "base/test_minimal.h"
+#include "base/test_help.h"
+#include "base/aabb_tree.h"
+#include "base/random.h"
+
+#if !defined(UNIT_TEST_BUNDLE)
+#  include "base/assert.cpp"
+#  include "base/utility.cpp"
+#endif
+
+namespace {
+struct Entity {
+    std::string name;
+    base::FRect rect;
+};
+} // namespace
+
+void unit_test_aabb_tree_insert_query()
+{
+    TEST_CASE(test::Type::Feature)
+
+    using Tree = base::AABBTree<Entity*>;
+
+    Tree tree;
+    TEST_REQUIRE(tree.GetNumItems() == 0);
+    TEST_REQUIRE(tree.GetHeight() == 0);
+    TEST_REQUIRE(tree.Validate());
+
+    std::vector<Entity> entities;
+    entities.resize(3);
+    entities[0].name = "0";
+    entities[0].rect = base::FRect(0.0f, 0.0f, 10.0f, 10.0f);
+    entities[1].name = "1";
+    entities[1].rect = base::FRect(20.0f, 0.0f, 10.0f, 10.0f);
+    entities[2].name = "2";
+    entities[2].rect = base::FRect(5.0f, 5.0f, 10.0f, 10.0f);
+
+    std::vector<Tree::ProxyId> proxies;
+    for (auto& e : entities)
+        proxies.push_back(tree.Insert(e.rect, &e));
+
+    TEST_REQUIRE(tree.GetNumItems() == 3);
+    TEST_REQUIRE(tree.Validate());
+    TEST_REQUIRE(tree.GetObject(proxies[1]) == &entities[1]);
+    TEST_REQUIRE(base::Contains(tree.GetFatRect(proxies[1]), entities[1].rect));
+
+    // rect query
+    {
+        std::set<Entity*> ret;
+        tree.Find(base::FRect(0.0f, 0.0f, 100.0f, 100.0f), &ret);
+        TEST_REQUIRE(ret.size() == 3);
+
+        ret.clear();
+        tree.Find(base::FRect(1.0f, 1.0f, 2.0f, 2.0f), &ret);
+        TEST_REQUIRE(ret.size() == 1);
+        TEST_REQUIRE(*ret.begin() == &entities[0]);
+
+        // inside the fat rect but outside the object's actual rect
+        ret.clear();
+        tree.Find(base::FRect(31.0f, 0.0f, 1.0f, 1.0f), &ret);
+        TEST_REQUIRE(ret.empty());
+    }
+
+    // point query
+    {
+        std::set<Entity*> ret;
+        tree.Find(base::FPoint(7.0f, 7.0f), &ret, Tree::FindMode::All);
+        TEST_REQUIRE(ret.size() == 2);
+
+        ret.clear();
+        tree.Find(base::FPoint(7.0f, 7.0f), &ret, Tree::FindMode::First);
+        TEST_REQUIRE(ret.size() == 1);
+
+        ret.clear();
+        tree.Find(base::FPoint(4.0f, 4.0f), &ret, Tree::FindMode::Closest);
+        TEST_REQUIRE(ret.size() == 1);
+        TEST_REQUIRE(*ret.begin() == &entities[0]);
+
+        ret.clear();
+        tree.Find(base::FPoint(17.0f, 17.0f), &ret, Tree::FindMode::All);
+        TEST_REQUIRE(ret.empty());
+    }
+
+    // point radius query
+    {
+        std::set<Entity*> ret;
+        tree.Find(base::FPoint(35.0f, 5.0f), 6.0f, &ret, Tree::FindMode::All);
+        TEST_REQUIRE(ret.size() == 1);
+        TEST_REQUIRE(*ret.begin() == &entities[1]);
+    }
+
+    // line query
+    {
+        std::set<Entity*> ret;
+        tree.Find(base::FPoint(-5.0f, 2.0f), base::FPoint(50.0f, 2.0f), &ret, Tree::FindMode::All);
+        TEST_REQUIRE(ret.size() == 2);
+
+        ret.clear();
+        tree.Find(base::FPoint(-5.0f, 2.0f), base::FPoint(50.0f, 2.0f), &ret, Tree::FindMode::Closest);
+        TEST_REQUIRE(ret.size() == 1);
+        TEST_REQUIRE(*ret.begin() == &entities[0]);
+    }
+
+    // erase
+    {
+        tree.Erase(proxies[0]);
+        TEST_REQUIRE(tree.GetNumItems() == 2);
+        TEST_REQUIRE(tree.Validate());
+
+        std::set<Entity*> ret;
+        tree.Find(base::FRect(0.0f, 0.0f, 100.0f, 100.0f), &ret);
+        TEST_REQUIRE(ret.size() == 2);
+        TEST_REQUIRE(ret.count(&entities[0]) == 0);
+
+        // proxies are recycled
+        proxies[0] = tree.Insert(entities[0].rect, &entities[0]);
+        TEST_REQUIRE(tree.GetNumItems() == 3);
+        TEST_REQUIRE(tree.Validate());
+
+        for (auto proxy : proxies)
+            tree.Erase(proxy);
+        TEST_REQUIRE(tree.GetNumItems() == 0);
+        TEST_REQUIRE(tree.GetHeight() == 0);
+        TEST_REQUIRE(tree.Validate());
+    }
+
+    // zero size objects (points)
+    {
+        Entity point;
+        point.rect = base::FRect(50.0f, 50.0f, 0.0f, 0.0f);
+        const auto proxy = tree.Insert(point.rect, &point);
+
+        std::vector<Entity*> ret;
+        tree.Find(base::FPoint(50.0f, 50.0f), &ret, Tree::FindMode::All);
+        TEST_REQUIRE(ret.size() == 1);
+        tree.Erase(proxy);
+    }
+}
+
+void unit_test_aabb_tree_move()
+{
+    TEST_CASE(test::Type::Feature)
+
+    using Tree = base::AABBTree<Entity*>;
+
+    Tree tree;
+    Entity entity;
+    entity.rect = base::FRect(0.0f, 0.0f, 10.0f, 10.0f);
+    const auto proxy = tree.Insert(entity.rect, &entity);
+
+    Entity other;
+    other.rect = base::FRect(100.0f, 100.0f, 10.0f, 10.0f);
+    tree.Insert(other.rect, &other);
+
+    // small movement within the fat rect doesn't change the tree.
+    TEST_REQUIRE(tree.Move(proxy, base::FRect(1.0f, 1.0f, 10.0f, 10.0f)) == false);
+    TEST_REQUIRE(tree.Validate());
+    TEST_REQUIRE(tree.GetRect(proxy) == base::FRect(1.0f, 1.0f, 10.0f, 10.0f));
+
+    // queries use the actual rect.
+    std::set<Entity*> ret;
+    tree.Find(base::FPoint(0.5f, 0.5f), &ret, Tree::FindMode::All);
+    TEST_REQUIRE(ret.empty());
+    tree.Find(base::FPoint(10.5f, 10.5f), &ret, Tree::FindMode::All);
+    TEST_REQUIRE(ret.size() == 1);
+
+    // moving outside the fat rect re-inserts.
+    TEST_REQUIRE(tree.Move(proxy, base::FRect(200.0f, 0.0f, 10.0f, 10.0f)) == true);
+    TEST_REQUIRE(tree.Validate());
+    TEST_REQUIRE(base::Contains(tree.GetFatRect(proxy), base::FRect(200.0f, 0.0f, 10.0f, 10.0f)));
+
+    ret.clear();
+    tree.Find(base::FPoint(205.0f, 5.0f), &ret, Tree::FindMode::All);
+    TEST_REQUIRE(ret.size() == 1);
+    TEST_REQUIRE(*ret.begin() == &entity);
+
+    // the fat rect is extended in the direction of the movement.
+    const auto& fat = tree.GetFatRect(proxy);
+    const auto left_margin  = 200.0f - fat.GetMinX();
+    const auto right_margin = fat.GetMaxX() - 210.0f;
+    TEST_REQUIRE(right_margin > left_margin);
+}
+
+void unit_test_aabb_tree_random()
+{
+    TEST_CASE(test::Type::Feature)
+
+    using Tree = base::AABBTree<Entity*>;
+
+    // random inserts, moves and erases and compare the query
+    // results against brute force search.
+    std::vector<Entity> entities;
+    entities.resize(500);
+
+    Tree tree;
+    std::vector<Tree::ProxyId> proxies;
+    for (auto& e : entities)
+    {
+        const auto x = base::rand<0x123, float>(-1000.0f, 1000.0f);
+        const auto y = base::rand<0x123, float>(-1000.0f, 1000.0f);
+        const auto w = base::rand<0x123, float>(1.0f, 50.0f);
+        const auto h = base::rand<0x123, float>(1.0f, 50.0f);
+        e.rect = base::FRect(x, y, w, h);
+        proxies.push_back(tree.Insert(e.rect, &e));
+    }
+    TEST_REQUIRE(tree.Validate());
+    // a balanced tree with 500 leaves should be nowhere near this.
+    TEST_REQUIRE(tree.GetHeight() < 20);
+
+    const auto check_queries = [&]() {
+        for (unsigned i=0; i<50; ++i)
+        {
+            const auto x = base::rand<0x123, float>(-1000.0f, 1000.0f);
+            const auto y = base::rand<0x123, float>(-1000.0f, 1000.0f);
+            const base::FRect query(x, y, 200.0f, 200.0f);
+
+            std::set<Entity*> expected;
+            for (auto& e : entities)
+            {
+                if (base::DoesIntersect(e.rect, query))
+                    expected.insert(&e);
+            }
+            std::set<Entity*> ret;
+            tree.Find(query, &ret);
+            TEST_REQUIRE(ret == expected);
+        }
+    };
+    check_queries();
+
+    for (unsigned round=0; round<10; ++round)
+    {
+        for (size_t i=0; i<entities.size(); ++i)
+        {
+            auto& e = entities[i];
+            const auto dx = base::rand<0x123, float>(-20.0f, 20.0f);
+            const auto dy = base::rand<0x123, float>(-20.0f, 20.0f);
+            e.rect.Translate(dx, dy);
+            tree.Move(proxies[i], e.rect);
+        }
+        TEST_REQUIRE(tree.Validate());
+        check_queries();
+    }
+
+    for (size_t i=0; i<entities.size(); i+=2)
+        tree.Erase(proxies[i]);
+    TEST_REQUIRE(tree.GetNumItems() == 250);
+    TEST_REQUIRE(tree.Validate());
+}
+
+EXPORT_TEST_MAIN(
+int test_main(int argc, char* argv[])
+{
+    unit_test_aabb_tree_insert_query();
+    unit_test_aabb_tree_move();
+    unit_test_aabb_tree_random();
+    return 0;
+}
+) // TEST_MAIN
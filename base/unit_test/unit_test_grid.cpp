@@ -418,6 +418,29 @@ void unit_test_insert_query()
         TEST_REQUIRE(grid.GetObject(0, 0, 0) == &e2);
     }
 
+    // erase a specific object by its insertion rect.
+    {
+        base::DenseSpatialGrid<Entity*> grid(100.0f, 100.0f, 2, 2);
+
+        Entity e1;
+        e1.rect = base::FRect(10.0f, 10.0f, 55.0f, 20.0f);
+        grid.Insert(e1.rect, &e1);
+        Entity e2;
+        e2.rect = base::FRect(15.0f, 15.0f, 20.0f, 20.0f);
+        grid.Insert(e2.rect, &e2);
+        TEST_REQUIRE(grid.GetNumItems() == 3);
+
+        grid.Erase(base::FRect(150.0f, 150.0f, 10.0f, 10.0f), &e1);
+        TEST_REQUIRE(grid.GetNumItems() == 3);
+
+        grid.Erase(e1.rect, &e1);
+        TEST_REQUIRE(grid.GetNumItems() == 1);
+        TEST_REQUIRE(grid.GetObject(0, 0, 0) == &e2);
+
+        grid.Erase(e2.rect, &e2);
+        TEST_REQUIRE(grid.GetNumItems() == 0);
+    }
+
     {
         base::DenseSpatialGrid<Entity*> grid(100.0f, 100.0f, 10, 10);
 
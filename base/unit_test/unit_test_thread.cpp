@@ -102,6 +102,288 @@ void unit_test_pool()
     TEST_REQUIRE(counter == 1000);
 }
 
+void unit_test_work_stealing()
+{
+    TEST_CASE(test::Type::Feature)
+
+    // a long running task must not hold up the tasks that were
+    // queued on the same worker behind it since the other workers
+    // will steal them.
+    class SleepTask : public base::ThreadTask
+    {
+    public:
+        SleepTask(std::atomic_bool& release) noexcept
+          : mRelease(release)
+        {}
+    protected:
+        void DoTask() override
+        {
+            while (!mRelease)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    private:
+        std::atomic_bool& mRelease;
+    };
+    class CountTask : public base::ThreadTask
+    {
+    public:
+        CountTask(std::atomic_int& counter) noexcept
+          : mCounter(counter)
+        {}
+    protected:
+        void DoTask() override
+        { mCounter++; }
+    private:
+        std::atomic_int& mCounter;
+    };
+
+    base::ThreadPool threads;
+    threads.AddRealThread(base::ThreadPool::Worker0ThreadID);
+    threads.AddRealThread(base::ThreadPool::Worker1ThreadID);
+    TEST_REQUIRE(threads.GetWorkerCount() == 2);
+
+    std::atomic_bool release = false;
+    std::atomic_int counter = 0;
+
+    auto sleeper = threads.SubmitTask(std::make_unique<SleepTask>(release));
+
+    std::vector<base::TaskHandle> handles;
+    for (int i=0; i<100; ++i)
+    {
+        handles.push_back(threads.SubmitTask(std::make_unique<CountTask>(counter)));
+    }
+    for (auto& handle : handles)
+    {
+        handle.Wait(base::TaskHandle::WaitStrategy::Sleep);
+    }
+    TEST_REQUIRE(counter == 100);
+    TEST_REQUIRE(!sleeper.IsComplete());
+
+    release = true;
+    threads.WaitAll();
+    TEST_REQUIRE(sleeper.IsComplete());
+    threads.Shutdown();
+}
+
+void unit_test_continuation()
+{
+    TEST_CASE(test::Type::Feature)
+
+    class AppendTask : public base::ThreadTask
+    {
+    public:
+        AppendTask(std::mutex& mutex, std::vector<int>& values, int value, unsigned wait) noexcept
+          : mMutex(mutex)
+          , mValues(values)
+          , mValue(value)
+          , mWait(wait)
+        {}
+    protected:
+        void DoTask() override
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(mWait));
+            std::lock_guard<std::mutex> lock(mMutex);
+            mValues.push_back(mValue);
+        }
+    private:
+        std::mutex& mMutex;
+        std::vector<int>& mValues;
+        const int mValue = 0;
+        const unsigned mWait = 0;
+    };
+
+    base::ThreadPool threads;
+    threads.AddRealThread(base::ThreadPool::Worker0ThreadID);
+    threads.AddRealThread(base::ThreadPool::Worker1ThreadID);
+    threads.AddRealThread(base::ThreadPool::Worker2ThreadID);
+    threads.AddMainThread();
+
+    // continuation chain over worker threads
+    {
+        std::mutex mutex;
+        std::vector<int> values;
+
+        auto first  = threads.SubmitTask(std::make_unique<AppendTask>(mutex, values, 1, 20));
+        auto second = threads.SubmitContinuation(first, std::make_unique<AppendTask>(mutex, values, 2, 10));
+        auto third  = threads.SubmitContinuation(second, std::make_unique<AppendTask>(mutex, values, 3, 0));
+        TEST_REQUIRE(third.GetTask() == nullptr);
+
+        third.Wait(base::TaskHandle::WaitStrategy::Sleep);
+        TEST_REQUIRE(second.IsComplete());
+        TEST_REQUIRE(first.IsComplete());
+        TEST_REQUIRE(values.size() == 3);
+        TEST_REQUIRE(values[0] == 1);
+        TEST_REQUIRE(values[1] == 2);
+        TEST_REQUIRE(values[2] == 3);
+    }
+
+    // continuation of a task that has already completed
+    {
+        std::mutex mutex;
+        std::vector<int> values;
+
+        auto first = threads.SubmitTask(std::make_unique<AppendTask>(mutex, values, 1, 0));
+        first.Wait(base::TaskHandle::WaitStrategy::Sleep);
+
+        auto second = threads.SubmitContinuation(first, std::make_unique<AppendTask>(mutex, values, 2, 0));
+        second.Wait(base::TaskHandle::WaitStrategy::Sleep);
+        TEST_REQUIRE(values.size() == 2);
+        TEST_REQUIRE(values[1] == 2);
+    }
+
+    // continuation on the main thread
+    {
+        std::mutex mutex;
+        std::vector<int> values;
+
+        auto first  = threads.SubmitTask(std::make_unique<AppendTask>(mutex, values, 1, 10));
+        auto second = threads.SubmitContinuation(first, std::make_unique<AppendTask>(mutex, values, 2, 0),
+                                                 base::ThreadPool::MainThreadID);
+        second.Wait(base::TaskHandle::WaitStrategy::Sleep);
+        TEST_REQUIRE(values.size() == 2);
+        TEST_REQUIRE(values[0] == 1);
+        TEST_REQUIRE(values[1] == 2);
+        threads.ExecuteMainThread();
+    }
+
+    // continuation of a main thread task on the main thread. waiting
+    // on the continuation must run the parent task on the main thread.
+    {
+        std::mutex mutex;
+        std::vector<int> values;
+
+        auto first  = threads.SubmitTask(std::make_unique<AppendTask>(mutex, values, 1, 0),
+                                         base::ThreadPool::MainThreadID);
+        auto second = threads.SubmitContinuation(first, std::make_unique<AppendTask>(mutex, values, 2, 0),
+                                                 base::ThreadPool::MainThreadID);
+        auto third  = threads.SubmitContinuation(second, std::make_unique<AppendTask>(mutex, values, 3, 0),
+                                                 base::ThreadPool::MainThreadID);
+        third.Wait(base::TaskHandle::WaitStrategy::BusyLoop);
+        TEST_REQUIRE(first.IsComplete());
+        TEST_REQUIRE(second.IsComplete());
+        TEST_REQUIRE(values.size() == 3);
+        TEST_REQUIRE(values[0] == 1);
+        TEST_REQUIRE(values[1] == 2);
+        TEST_REQUIRE(values[2] == 3);
+        threads.ExecuteMainThread();
+    }
+
+    threads.WaitAll();
+    threads.Shutdown();
+}
+
+void unit_test_parallel_for()
+{
+    TEST_CASE(test::Type::Feature)
+
+    base::ThreadPool threads;
+    threads.AddRealThread(base::ThreadPool::Worker0ThreadID);
+    threads.AddRealThread(base::ThreadPool::Worker1ThreadID);
+    threads.AddRealThread(base::ThreadPool::Worker2ThreadID);
+    threads.AddRealThread(base::ThreadPool::Worker3ThreadID);
+
+    for (auto* pool : {(base::ThreadPool*)nullptr, &threads})
+    {
+        // empty range
+        {
+            int calls = 0;
+            base::ParallelFor(pool, 10, 10, 4, [&calls](size_t) { ++calls; });
+            TEST_REQUIRE(calls == 0);
+        }
+
+        // every index is visited exactly once with various grain sizes.
+        for (size_t grain : {0u, 1u, 7u, 64u, 1000u, 5000u})
+        {
+            std::vector<std::atomic_int> visits(1000);
+            base::ParallelFor(pool, 0, visits.size(), grain, [&visits](size_t index) {
+                visits[index]++;
+            });
+            for (const auto& v : visits)
+                TEST_REQUIRE(v == 1);
+        }
+
+        // sub range
+        {
+            std::vector<int> values(100, 0);
+            base::ParallelFor(pool, 10, 20, 3, [&values](size_t index) {
+                values[index] = 1;
+            });
+            for (size_t i=0; i<values.size(); ++i)
+                TEST_REQUIRE(values[i] == (i >= 10 && i < 20 ? 1 : 0));
+        }
+
+        // reduce
+        {
+            const auto sum = base::ParallelReduce(pool, 1, 10001, 100, (uint64_t)0,
+                [](size_t index) { return (uint64_t)index; },
+                [](uint64_t a, uint64_t b) { return a + b; });
+            TEST_REQUIRE(sum == 50005000u);
+        }
+
+        // reduce with a non-commutative combine still gives the same
+        // result as the serial order.
+        {
+            const auto str = base::ParallelReduce(pool, 0, 26, 4, std::string(),
+                [](size_t index) { return std::string(1, char('a' + index)); },
+                [](std::string a, std::string b) { return a + b; });
+            TEST_REQUIRE(str == "abcdefghijklmnopqrstuvwxyz");
+        }
+
+        // exceptions are propagated to the caller.
+        {
+            bool caught = false;
+            try
+            {
+                base::ParallelFor(pool, 0, 100, 10, [](size_t index) {
+                    if (index == 55)
+                        throw std::runtime_error("boom");
+                });
+            }
+            catch (const std::runtime_error& e)
+            {
+                caught = true;
+            }
+            TEST_REQUIRE(caught);
+        }
+    }
+
+    // nested parallel for from inside a worker thread.
+    {
+        class NestedTask : public base::ThreadTask
+        {
+        public:
+            NestedTask(base::ThreadPool& pool, std::atomic_int& counter) noexcept
+              : mPool(pool)
+              , mCounter(counter)
+            {}
+        protected:
+            void DoTask() override
+            {
+                base::ParallelFor(&mPool, 0, 100, 10, [this](size_t) {
+                    mCounter++;
+                });
+            }
+        private:
+            base::ThreadPool& mPool;
+            std::atomic_int& mCounter;
+        };
+
+        std::atomic_int counter = 0;
+        std::vector<base::TaskHandle> handles;
+        for (int i=0; i<8; ++i)
+        {
+            handles.push_back(threads.SubmitTask(std::make_unique<NestedTask>(threads, counter)));
+        }
+        for (auto& handle : handles)
+        {
+            handle.Wait(base::TaskHandle::WaitStrategy::Sleep);
+        }
+        TEST_REQUIRE(counter == 800);
+    }
+
+    threads.WaitAll();
+    threads.Shutdown();
+}
 
 EXPORT_TEST_MAIN(
 int test_main(int argc, char* argv[])
@@ -109,6 +391,9 @@ int test_main(int argc, char* argv[])
     test::TestLogger logger("unit_test_thread_pool.log");
 
     unit_test_pool();
+    unit_test_work_stealing();
+    unit_test_continuation();
+    unit_test_parallel_for();
     return 0;
 }
 ) // TEST_MAIN
@@ -0,0 +1,418 @@
+// Copyright (C) 2020-2025 Sami Väisänen
+// Copyright (C) 2020-2025 Ensisoft http://www.ensisoft.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "config.h"
+
+#include <cstring>
+
+#include "base/assert.h"
+#include "device/command_buffer.h"
+
+namespace dev
+{
+
+class CommandBuffer::Executor
+{
+public:
+    Executor(const CommandBuffer& buffer, GraphicsDevice* device) noexcept
+      : mBuffer(buffer)
+      , mDevice(device)
+    {}
+
+    void operator()(const AllocateMSAAColorRenderTargetCmd& cmd) const
+    {
+        mDevice->AllocateMSAAColorRenderTarget(cmd.framebuffer, cmd.color_attachment_index, cmd.width, cmd.height);
+    }
+    void operator()(const BindColorRenderTargetCmd& cmd) const
+    {
+        mDevice->BindColorRenderTargetTexture2D(cmd.framebuffer, cmd.texture, cmd.color_attachment_index);
+    }
+    void operator()(const BindDepthRenderTargetCmd& cmd) const
+    {
+        mDevice->BindDepthRenderTargetTexture2D(cmd.framebuffer, cmd.texture, cmd.texture_array_index);
+    }
+    void operator()(const ResolveFramebufferCmd& cmd) const
+    {
+        mDevice->ResolveFramebuffer(cmd.framebuffer, cmd.resolve_target, cmd.color_attachment);
+    }
+    void operator()(const BindFramebufferCmd& cmd) const
+    {
+        mDevice->BindFramebuffer(cmd.framebuffer);
+    }
+    void operator()(const DeleteFramebufferCmd& cmd) const
+    {
+        mDevice->DeleteFramebuffer(cmd.framebuffer);
+    }
+    void operator()(const BindTextureCmd& cmd) const
+    {
+        GraphicsDevice::BindWarnings warnings;
+        mDevice->BindTexture2D(cmd.texture, cmd.program, cmd.sampler_name, cmd.texture_unit,
+                               cmd.texture_x_wrap, cmd.texture_y_wrap,
+                               cmd.texture_min_filter, cmd.texture_mag_filter, &warnings);
+    }
+    void operator()(const DeleteTextureCmd& cmd) const
+    {
+        mDevice->DeleteTexture(cmd.texture);
+    }
+    void operator()(const FreeBufferCmd& cmd) const
+    {
+        mDevice->FreeBuffer(cmd.buffer);
+    }
+    void operator()(const UploadBufferCmd& cmd) const
+    {
+        const auto* data = mBuffer.mBufferData.data() + cmd.data.offset;
+        mDevice->UploadBuffer(cmd.buffer, data, cmd.data.count);
+    }
+    void operator()(const BindVertexBufferCmd& cmd) const
+    {
+        mDevice->BindVertexBuffer(cmd.buffer, cmd.program, cmd.layout);
+    }
+    void operator()(const BindIndexBufferCmd& cmd) const
+    {
+        mDevice->BindIndexBuffer(cmd.buffer);
+    }
+    void operator()(const ViewportState& state) const
+    {
+        mDevice->SetViewportState(state);
+    }
+    void operator()(const ColorDepthStencilState& state) const
+    {
+        mDevice->SetColorDepthStencilState(state);
+    }
+    void operator()(const RasterState& state) const
+    {
+        mDevice->SetRasterState(state);
+    }
+    void operator()(const SetProgramStateCmd& cmd) const
+    {
+        mProgramState.uniforms.clear();
+        for (size_t i=0; i<cmd.uniforms.count; ++i)
+        {
+            mProgramState.uniforms.push_back(&mBuffer.mUniforms[cmd.uniforms.offset + i]);
+        }
+        mDevice->SetProgramState(cmd.program, mProgramState);
+    }
+    void operator()(const ModifyStateCmd& cmd) const
+    {
+        mDevice->ModifyState(cmd.value, cmd.name);
+    }
+    void operator()(const BindProgramBufferCmd& cmd) const
+    {
+        mDevice->BindProgramBuffer(cmd.program, cmd.buffer, cmd.interface_block_name, cmd.binding_index);
+    }
+    void operator()(const DeleteShaderCmd& cmd) const
+    {
+        mDevice->DeleteShader(cmd.shader);
+    }
+    void operator()(const DeleteProgramCmd& cmd) const
+    {
+        mDevice->DeleteProgram(cmd.program);
+    }
+    void operator()(const DrawElementsCmd& cmd) const
+    {
+        if (cmd.instanced)
+            mDevice->DrawElementsInstanced(cmd.draw_primitive, cmd.index_type, cmd.primitive_count,
+                                           cmd.index_buffer_byte_offset, cmd.instance_count);
+        else mDevice->DrawElements(cmd.draw_primitive, cmd.index_type, cmd.primitive_count,
+                                   cmd.index_buffer_byte_offset);
+    }
+    void operator()(const DrawArraysCmd& cmd) const
+    {
+        if (cmd.instanced)
+            mDevice->DrawArraysInstanced(cmd.draw_primitive, cmd.vertex_start_index,
+                                         cmd.vertex_draw_count, cmd.instance_count);
+        else mDevice->DrawArrays(cmd.draw_primitive, cmd.vertex_start_index, cmd.vertex_draw_count);
+    }
+    void operator()(const ClearCmd& cmd) const
+    {
+        if (cmd.flags == (ClearCmd::Color | ClearCmd::Depth | ClearCmd::Stencil))
+            mDevice->ClearColorDepthStencil(cmd.color, cmd.depth, cmd.stencil, cmd.framebuffer, cmd.attachment);
+        else if (cmd.flags == (ClearCmd::Color | ClearCmd::Depth))
+            mDevice->ClearColorDepth(cmd.color, cmd.depth, cmd.framebuffer, cmd.attachment);
+        else if (cmd.flags == ClearCmd::Color)
+            mDevice->ClearColor(cmd.color, cmd.framebuffer, cmd.attachment);
+        else if (cmd.flags == ClearCmd::Depth)
+            mDevice->ClearDepth(cmd.depth, cmd.framebuffer);
+        else if (cmd.flags == ClearCmd::Stencil)
+            mDevice->ClearStencil(cmd.stencil, cmd.framebuffer);
+        else BUG("Bug on clear command flags.");
+    }
+    void operator()(const BeginFrameCmd&) const
+    {
+        mDevice->BeginFrame();
+    }
+    void operator()(const EndFrameCmd& cmd) const
+    {
+        mDevice->EndFrame(cmd.display);
+    }
+private:
+    const CommandBuffer& mBuffer;
+    GraphicsDevice* mDevice = nullptr;
+    mutable ProgramState mProgramState;
+};
+
+void CommandBuffer::Execute() const
+{
+    Executor executor(*this, mDevice);
+    for (const auto& cmd : mCommands)
+    {
+        std::visit(executor, cmd);
+    }
+}
+
+void CommandBuffer::Clear() noexcept
+{
+    mCommands.clear();
+    mBufferData.clear();
+    mUniforms.clear();
+}
+
+Framebuffer CommandBuffer::GetDefaultFramebuffer() const
+{
+    return mDevice->GetDefaultFramebuffer();
+}
+Framebuffer CommandBuffer::CreateFramebuffer(const FramebufferConfig& config)
+{
+    return mDevice->CreateFramebuffer(config);
+}
+bool CommandBuffer::CompleteFramebuffer(const Framebuffer& framebuffer, const std::vector<unsigned>& color_attachments)
+{
+    return mDevice->CompleteFramebuffer(framebuffer, color_attachments);
+}
+GraphicsShader CommandBuffer::CompileShader(const std::string& source, ShaderType type, std::string* compile_info)
+{
+    return mDevice->CompileShader(source, type, compile_info);
+}
+GraphicsProgram CommandBuffer::BuildProgram(const std::vector<GraphicsShader>& shaders, std::string* build_info)
+{
+    return mDevice->BuildProgram(shaders, build_info);
+}
+TextureObject CommandBuffer::AllocateTexture2D(unsigned texture_width, unsigned texture_height, TextureFormat format)
+{
+    return mDevice->AllocateTexture2D(texture_width, texture_height, format);
+}
+TextureObject CommandBuffer::AllocateTexture2DArray(unsigned texture_width, unsigned texture_height,
+                                                    unsigned texture_array_size, TextureFormat format)
+{
+    return mDevice->AllocateTexture2DArray(texture_width, texture_height, texture_array_size, format);
+}
+TextureObject CommandBuffer::UploadTexture2D(const void* bytes, unsigned texture_width, unsigned texture_height, TextureFormat format)
+{
+    return mDevice->UploadTexture2D(bytes, texture_width, texture_height, format);
+}
+GraphicsDevice::MipStatus CommandBuffer::GenerateMipmaps(const TextureObject& texture)
+{
+    return mDevice->GenerateMipmaps(texture);
+}
+void CommandBuffer::UploadTexture2DMip(const TextureObject& texture, unsigned mip_level, const void* bytes,
+                                       size_t byte_count, unsigned mip_width, unsigned mip_height)
+{
+    mDevice->UploadTexture2DMip(texture, mip_level, bytes, byte_count, mip_width, mip_height);
+}
+GraphicsBuffer CommandBuffer::AllocateBuffer(size_t bytes, BufferUsage usage, BufferType type)
+{
+    return mDevice->AllocateBuffer(bytes, usage, type);
+}
+bool CommandBuffer::RelocateBuffer(const GraphicsBuffer& buffer, GraphicsBuffer* relocated)
+{
+    return mDevice->RelocateBuffer(buffer, relocated);
+}
+void CommandBuffer::ReadColor(unsigned width, unsigned height, const Framebuffer& fbo, void* color_data) const
+{
+    mDevice->ReadColor(width, height, fbo, color_data);
+}
+void CommandBuffer::ReadColor(unsigned x, unsigned y, unsigned width, unsigned  height,
+                              const Framebuffer& fbo, void* color_data) const
+{
+    mDevice->ReadColor(x, y, width, height, fbo, color_data);
+}
+void CommandBuffer::GetResourceStats(GraphicsDeviceResourceStats* stats) const
+{
+    mDevice->GetResourceStats(stats);
+}
+void CommandBuffer::GetStateStats(GraphicsDeviceStateStats* stats) const
+{
+    mDevice->GetStateStats(stats);
+}
+void CommandBuffer::GetDeviceCaps(GraphicsDeviceCaps* caps) const
+{
+    mDevice->GetDeviceCaps(caps);
+}
+
+void CommandBuffer::AllocateMSAAColorRenderTarget(const Framebuffer& framebuffer, unsigned color_attachment_index,
+                                                  unsigned width, unsigned height)
+{
+    mCommands.push_back(AllocateMSAAColorRenderTargetCmd { framebuffer, color_attachment_index, width, height });
+}
+void CommandBuffer::BindColorRenderTargetTexture2D(const Framebuffer& framebuffer, const TextureObject& texture,
+                                                   unsigned color_attachment_index)
+{
+    mCommands.push_back(BindColorRenderTargetCmd { framebuffer, texture, color_attachment_index });
+}
+void CommandBuffer::BindDepthRenderTargetTexture2D(const Framebuffer& framebuffer, const TextureObject& texture,
+                                                   unsigned texture_array_index)
+{
+    mCommands.push_back(BindDepthRenderTargetCmd { framebuffer, texture, texture_array_index });
+}
+void CommandBuffer::ResolveFramebuffer(const Framebuffer& multisampled_framebuffer, const TextureObject& resolve_target,
+                                       unsigned color_attachment)
+{
+    mCommands.push_back(ResolveFramebufferCmd { multisampled_framebuffer, resolve_target, color_attachment });
+}
+void CommandBuffer::BindFramebuffer(const Framebuffer& framebuffer) const
+{
+    mCommands.push_back(BindFramebufferCmd { framebuffer });
+}
+void CommandBuffer::DeleteFramebuffer(const Framebuffer& fbo)
+{
+    mCommands.push_back(DeleteFramebufferCmd { fbo });
+}
+bool CommandBuffer::BindTexture2D(const TextureObject& texture, const GraphicsProgram& program, const std::string& sampler_name,
+                                  unsigned texture_unit, TextureWrapping texture_x_wrap, TextureWrapping texture_y_wrap,
+                                  TextureMinFilter texture_min_filter, TextureMagFilter texture_mag_filter, BindWarnings* warnings) const
+{
+    BindTextureCmd cmd;
+    cmd.texture = texture;
+    cmd.program = program;
+    cmd.sampler_name = sampler_name;
+    cmd.texture_unit = texture_unit;
+    cmd.texture_x_wrap = texture_x_wrap;
+    cmd.texture_y_wrap = texture_y_wrap;
+    cmd.texture_min_filter = texture_min_filter;
+    cmd.texture_mag_filter = texture_mag_filter;
+    mCommands.push_back(std::move(cmd));
+
+    // the warnings are only known when the command is replayed.
+    if (warnings)
+        *warnings = BindWarnings {};
+    return true;
+}
+void CommandBuffer::DeleteTexture(const TextureObject& texture)
+{
+    mCommands.push_back(DeleteTextureCmd { texture });
+}
+void CommandBuffer::FreeBuffer(const GraphicsBuffer& buffer)
+{
+    mCommands.push_back(FreeBufferCmd { buffer });
+}
+void CommandBuffer::UploadBuffer(const GraphicsBuffer& buffer, const void* data, size_t bytes)
+{
+    DataRange range;
+    range.offset = mBufferData.size();
+    range.count  = bytes;
+    mBufferData.resize(mBufferData.size() + bytes);
+    if (bytes)
+        std::memcpy(&mBufferData[range.offset], data, bytes);
+
+    mCommands.push_back(UploadBufferCmd { buffer, range });
+}
+void CommandBuffer::BindVertexBuffer(const GraphicsBuffer& buffer, const GraphicsProgram& program, const VertexLayout& layout) const
+{
+    mCommands.push_back(BindVertexBufferCmd { buffer, program, layout });
+}
+void CommandBuffer::BindIndexBuffer(const GraphicsBuffer& buffer) const
+{
+    mCommands.push_back(BindIndexBufferCmd { buffer });
+}
+void CommandBuffer::SetViewportState(const ViewportState& state) const
+{
+    mCommands.push_back(state);
+}
+void CommandBuffer::SetColorDepthStencilState(const ColorDepthStencilState& state) const
+{
+    mCommands.push_back(state);
+}
+void CommandBuffer::SetRasterState(const RasterState& state) const
+{
+    mCommands.push_back(state);
+}
+void CommandBuffer::SetProgramState(const GraphicsProgram& program, const ProgramState& state) const
+{
+    DataRange range;
+    range.offset = mUniforms.size();
+    range.count  = state.uniforms.size();
+    for (const auto* uniform : state.uniforms)
+    {
+        mUniforms.push_back(*uniform);
+    }
+    mCommands.push_back(SetProgramStateCmd { program, range });
+}
+void CommandBuffer::ModifyState(const StateValue& value, StateName state) const
+{
+    mCommands.push_back(ModifyStateCmd { value, state });
+}
+void CommandBuffer::BindProgramBuffer(const GraphicsProgram& program, const GraphicsBuffer& buffer,
+                                      const std::string& interface_block_name, unsigned binding_index)
+{
+    mCommands.push_back(BindProgramBufferCmd { program, buffer, interface_block_name, binding_index });
+}
+void CommandBuffer::DeleteShader(const GraphicsShader& shader)
+{
+    mCommands.push_back(DeleteShaderCmd { shader });
+}
+void CommandBuffer::DeleteProgram(const GraphicsProgram& program)
+{
+    mCommands.push_back(DeleteProgramCmd { program });
+}
+void CommandBuffer::DrawElementsInstanced(DrawType draw_primitive, IndexType index_type,
+                                          unsigned primitive_count, unsigned index_buffer_byte_offset, unsigned instance_count) const
+{
+    mCommands.push_back(DrawElementsCmd { draw_primitive, index_type, primitive_count, index_buffer_byte_offset, instance_count, true });
+}
+void CommandBuffer::DrawElements(DrawType draw_primitive, IndexType index_type,
+                                 unsigned primitive_count, unsigned index_buffer_byte_offset) const
+{
+    mCommands.push_back(DrawElementsCmd { draw_primitive, index_type, primitive_count, index_buffer_byte_offset, 0, false });
+}
+void CommandBuffer::DrawArraysInstanced(DrawType draw_primitive, unsigned vertex_start_index,
+                                        unsigned vertex_draw_count, unsigned instance_count) const
+{
+    mCommands.push_back(DrawArraysCmd { draw_primitive, vertex_start_index, vertex_draw_count, instance_count, true });
+}
+void CommandBuffer::DrawArrays(DrawType draw_primitive, unsigned vertex_start_index, unsigned vertex_draw_count) const
+{
+    mCommands.push_back(DrawArraysCmd { draw_primitive, vertex_start_index, vertex_draw_count, 0, false });
+}
+void CommandBuffer::ClearColor(const base::Color4f& color, const Framebuffer& fbo, ColorAttachment attachment) const
+{
+    mCommands.push_back(ClearCmd { ClearCmd::Color, color, 0.0f, 0, fbo, attachment });
+}
+void CommandBuffer::ClearStencil(int value, const Framebuffer& fbo) const
+{
+    mCommands.push_back(ClearCmd { ClearCmd::Stencil, base::Color4f(), 0.0f, value, fbo, ColorAttachment::Attachment0 });
+}
+void CommandBuffer::ClearDepth(float value, const Framebuffer& fbo) const
+{
+    mCommands.push_back(ClearCmd { ClearCmd::Depth, base::Color4f(), value, 0, fbo, ColorAttachment::Attachment0 });
+}
+void CommandBuffer::ClearColorDepth(const base::Color4f& color, float depth, const Framebuffer& fbo, ColorAttachment attachment) const
+{
+    mCommands.push_back(ClearCmd { ClearCmd::Color | ClearCmd::Depth, color, depth, 0, fbo, attachment });
+}
+void CommandBuffer::ClearColorDepthStencil(const base::Color4f& color, float depth, int stencil, const Framebuffer& fbo, ColorAttachment attachment) const
+{
+    mCommands.push_back(ClearCmd { ClearCmd::Color | ClearCmd::Depth | ClearCmd::Stencil, color, depth, stencil, fbo, attachment });
+}
+void CommandBuffer::BeginFrame()
+{
+    mCommands.push_back(BeginFrameCmd {});
+}
+void CommandBuffer::EndFrame(bool display)
+{
+    mCommands.push_back(EndFrameCmd { display });
+}
+
+} // namespace
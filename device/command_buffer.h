@@ -0,0 +1,299 @@
+// Copyright (C) 2020-2025 Sami Väisänen
+// Copyright (C) 2020-2025 Ensisoft http://www.ensisoft.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "config.h"
+
+#include <string>
+#include <vector>
+#include <variant>
+#include <cstddef>
+#include <cstdint>
+
+#include "device/graphics.h"
+#include "device/uniform.h"
+#include "device/vertex.h"
+
+namespace dev
+{
+    // CommandBuffer records the rendering commands issued through the
+    // GraphicsDevice interface so that they can be replayed later on
+    // the actual device. This allows draw lists to be built on worker
+    // threads (each thread using its own command buffer) and then
+    // submitted on the thread that owns the device context.
+    //
+    // All the functions that only change state, draw or release objects
+    // (i.e. return nothing) are recorded. Any data that is referenced by
+    // these calls (buffer data, uniform values, vertex layouts) is copied
+    // into the command buffer.
+    //
+    // Functions that return a result such as creating resources, reading
+    // pixels or querying stats cannot be deferred and are forwarded to the
+    // device immediately. These must only be called on the device thread.
+    //
+    // Texture binding warnings depend on the texture object state on the
+    // device and can't be resolved when recording. See BindTexture2D.
+    class CommandBuffer final : public GraphicsDevice
+    {
+    public:
+        explicit CommandBuffer(GraphicsDevice* device) noexcept
+          : mDevice(device)
+        {}
+       ~CommandBuffer() override = default;
+        CommandBuffer(const CommandBuffer&) = delete;
+
+        // Replay all the recorded commands on the device in the order
+        // they were recorded. The command buffer is not cleared and
+        // can be executed again.
+        void Execute() const;
+        // Clear all the recorded commands. The memory is retained
+        // for recording the next set of commands.
+        void Clear() noexcept;
+
+        inline std::size_t GetCommandCount() const noexcept
+        { return mCommands.size(); }
+        inline bool IsEmpty() const noexcept
+        { return mCommands.empty(); }
+
+        // immediate, forwarded to the device.
+        Framebuffer GetDefaultFramebuffer() const override;
+        Framebuffer CreateFramebuffer(const FramebufferConfig& config) override;
+        bool CompleteFramebuffer(const Framebuffer& framebuffer, const std::vector<unsigned>& color_attachments) override;
+        GraphicsShader CompileShader(const std::string& source, ShaderType type, std::string* compile_info) override;
+        GraphicsProgram BuildProgram(const std::vector<GraphicsShader>& shaders, std::string* build_info) override;
+        TextureObject AllocateTexture2D(unsigned texture_width, unsigned texture_height, TextureFormat format) override;
+        TextureObject AllocateTexture2DArray(unsigned texture_width, unsigned texture_height,
+                                             unsigned texture_array_size, TextureFormat format) override;
+        TextureObject UploadTexture2D(const void* bytes, unsigned texture_width, unsigned texture_height, TextureFormat format) override;
+        MipStatus GenerateMipmaps(const TextureObject& texture) override;
+        void UploadTexture2DMip(const TextureObject& texture, unsigned mip_level, const void* bytes,
+                                size_t byte_count, unsigned mip_width, unsigned mip_height) override;
+        GraphicsBuffer AllocateBuffer(size_t bytes, BufferUsage usage, BufferType type) override;
+        bool RelocateBuffer(const GraphicsBuffer& buffer, GraphicsBuffer* relocated) override;
+        void ReadColor(unsigned width, unsigned height, const Framebuffer& fbo, void* color_data) const override;
+        void ReadColor(unsigned x, unsigned y, unsigned width, unsigned  height,
+                       const Framebuffer& fbo, void* color_data) const override;
+        void GetResourceStats(GraphicsDeviceResourceStats* stats) const override;
+        void GetStateStats(GraphicsDeviceStateStats* stats) const override;
+        void GetDeviceCaps(GraphicsDeviceCaps* caps) const override;
+
+        // recorded
+        void AllocateMSAAColorRenderTarget(const Framebuffer& framebuffer, unsigned color_attachment_index,
+                                           unsigned width, unsigned height) override;
+        void BindColorRenderTargetTexture2D(const Framebuffer& framebuffer, const TextureObject& texture,
+                                            unsigned color_attachment_index) override;
+        void BindDepthRenderTargetTexture2D(const Framebuffer& framebuffer, const TextureObject& texture,
+                                            unsigned texture_array_index) override;
+        void ResolveFramebuffer(const Framebuffer& multisampled_framebuffer, const TextureObject& resolve_target,
+                                unsigned color_attachment) override;
+        void BindFramebuffer(const Framebuffer& framebuffer) const override;
+        void DeleteFramebuffer(const Framebuffer& fbo) override;
+        // Record the texture binding. The texture binding warnings can't be
+        // known until the command is replayed on the device, at which point
+        // the caller's warnings object is long gone. So the warnings (if any)
+        // are always reported as none and the binding is always reported
+        // as successful. Any binding failure is reported by the device when
+        // the command buffer is executed.
+        bool BindTexture2D(const TextureObject& texture, const GraphicsProgram& program, const std::string& sampler_name,
+                           unsigned texture_unit, TextureWrapping texture_x_wrap, TextureWrapping texture_y_wrap,
+                           TextureMinFilter texture_min_filter, TextureMagFilter texture_mag_filter, BindWarnings* warnings) const override;
+        void DeleteTexture(const TextureObject& texture) override;
+        void FreeBuffer(const GraphicsBuffer& buffer) override;
+        void UploadBuffer(const GraphicsBuffer& buffer, const void* data, size_t bytes) override;
+        void BindVertexBuffer(const GraphicsBuffer& buffer, const GraphicsProgram& program, const VertexLayout& layout) const override;
+        void BindIndexBuffer(const GraphicsBuffer& buffer) const override;
+        void SetViewportState(const ViewportState& state) const override;
+        void SetColorDepthStencilState(const ColorDepthStencilState& state) const override;
+        void SetRasterState(const RasterState& state) const override;
+        void SetProgramState(const GraphicsProgram& program, const ProgramState& state) const override;
+        void ModifyState(const StateValue& value, StateName state) const override;
+        void BindProgramBuffer(const GraphicsProgram& program, const GraphicsBuffer& buffer,
+                               const std::string& interface_block_name, unsigned binding_index) override;
+        void DeleteShader(const GraphicsShader& shader) override;
+        void DeleteProgram(const GraphicsProgram& program) override;
+        void DrawElementsInstanced(DrawType draw_primitive, IndexType index_type,
+                                   unsigned primitive_count, unsigned index_buffer_byte_offset, unsigned instance_count) const override;
+        void DrawElements(DrawType draw_primitive, IndexType index_type,
+                          unsigned primitive_count, unsigned index_buffer_byte_offset) const override;
+        void DrawArraysInstanced(DrawType draw_primitive, unsigned vertex_start_index,
+                                 unsigned vertex_draw_count, unsigned instance_count) const override;
+        void DrawArrays(DrawType draw_primitive, unsigned vertex_start_index, unsigned vertex_draw_count) const override;
+        void ClearColor(const base::Color4f& color, const Framebuffer& fbo, ColorAttachment attachment) const override;
+        void ClearStencil(int value, const Framebuffer& fbo) const override;
+        void ClearDepth(float value, const Framebuffer& fbo) const override;
+        void ClearColorDepth(const base::Color4f& color, float depth, const Framebuffer& fbo, ColorAttachment attachment) const override;
+        void ClearColorDepthStencil(const base::Color4f& color, float depth, int stencil, const Framebuffer& fbo, ColorAttachment attachment) const override;
+        void BeginFrame() override;
+        void EndFrame(bool display) override;
+
+        CommandBuffer& operator=(const CommandBuffer&) = delete;
+    private:
+        // data that is referenced by a command is stored in the
+        // command buffer's arrays and the command only refers to
+        // a range in the array. this avoids a memory allocation
+        // per recorded command.
+        struct DataRange {
+            std::size_t offset = 0;
+            std::size_t count  = 0;
+        };
+
+        struct AllocateMSAAColorRenderTargetCmd {
+            Framebuffer framebuffer;
+            unsigned color_attachment_index = 0;
+            unsigned width  = 0;
+            unsigned height = 0;
+        };
+        struct BindColorRenderTargetCmd {
+            Framebuffer framebuffer;
+            TextureObject texture;
+            unsigned color_attachment_index = 0;
+        };
+        struct BindDepthRenderTargetCmd {
+            Framebuffer framebuffer;
+            TextureObject texture;
+            unsigned texture_array_index = 0;
+        };
+        struct ResolveFramebufferCmd {
+            Framebuffer framebuffer;
+            TextureObject resolve_target;
+            unsigned color_attachment = 0;
+        };
+        struct BindFramebufferCmd {
+            Framebuffer framebuffer;
+        };
+        struct DeleteFramebufferCmd {
+            Framebuffer framebuffer;
+        };
+        struct BindTextureCmd {
+            TextureObject texture;
+            GraphicsProgram program;
+            std::string sampler_name;
+            unsigned texture_unit = 0;
+            TextureWrapping texture_x_wrap;
+            TextureWrapping texture_y_wrap;
+            TextureMinFilter texture_min_filter;
+            TextureMagFilter texture_mag_filter;
+        };
+        struct DeleteTextureCmd {
+            TextureObject texture;
+        };
+        struct FreeBufferCmd {
+            GraphicsBuffer buffer;
+        };
+        struct UploadBufferCmd {
+            GraphicsBuffer buffer;
+            DataRange data;
+        };
+        struct BindVertexBufferCmd {
+            GraphicsBuffer buffer;
+            GraphicsProgram program;
+            VertexLayout layout;
+        };
+        struct BindIndexBufferCmd {
+            GraphicsBuffer buffer;
+        };
+        struct SetProgramStateCmd {
+            GraphicsProgram program;
+            DataRange uniforms;
+        };
+        struct ModifyStateCmd {
+            StateValue value;
+            StateName name;
+        };
+        struct BindProgramBufferCmd {
+            GraphicsProgram program;
+            GraphicsBuffer buffer;
+            std::string interface_block_name;
+            unsigned binding_index = 0;
+        };
+        struct DeleteShaderCmd {
+            GraphicsShader shader;
+        };
+        struct DeleteProgramCmd {
+            GraphicsProgram program;
+        };
+        struct DrawElementsCmd {
+            DrawType draw_primitive;
+            IndexType index_type;
+            unsigned primitive_count = 0;
+            unsigned index_buffer_byte_offset = 0;
+            unsigned instance_count = 0;
+            // instanced draw with instance_count instances. note that an
+            // instanced draw with 0 instances is legal and draws nothing.
+            bool instanced = false;
+        };
+        struct DrawArraysCmd {
+            DrawType draw_primitive;
+            unsigned vertex_start_index = 0;
+            unsigned vertex_draw_count  = 0;
+            unsigned instance_count = 0;
+            // instanced draw with instance_count instances. note that an
+            // instanced draw with 0 instances is legal and draws nothing.
+            bool instanced = false;
+        };
+        struct ClearCmd {
+            enum Flags {
+                Color = 0x1, Depth = 0x2, Stencil = 0x4
+            };
+            unsigned flags = 0;
+            base::Color4f color;
+            float depth = 0.0f;
+            int stencil = 0;
+            Framebuffer framebuffer;
+            ColorAttachment attachment;
+        };
+        struct BeginFrameCmd {};
+        struct EndFrameCmd {
+            bool display = false;
+        };
+
+        using Command = std::variant<
+            AllocateMSAAColorRenderTargetCmd,
+            BindColorRenderTargetCmd,
+            BindDepthRenderTargetCmd,
+            ResolveFramebufferCmd,
+            BindFramebufferCmd,
+            DeleteFramebufferCmd,
+            BindTextureCmd,
+            DeleteTextureCmd,
+            FreeBufferCmd,
+            UploadBufferCmd,
+            BindVertexBufferCmd,
+            BindIndexBufferCmd,
+            ViewportState,
+            ColorDepthStencilState,
+            RasterState,
+            SetProgramStateCmd,
+            ModifyStateCmd,
+            BindProgramBufferCmd,
+            DeleteShaderCmd,
+            DeleteProgramCmd,
+            DrawElementsCmd,
+            DrawArraysCmd,
+            ClearCmd,
+            BeginFrameCmd,
+            EndFrameCmd>;
+
+        class Executor;
+
+        GraphicsDevice* mDevice = nullptr;
+        mutable std::vector<Command> mCommands;
+        mutable std::vector<std::uint8_t> mBufferData;
+        mutable std::vector<Uniform> mUniforms;
+    };
+
+} // namespace
@@ -110,9 +110,42 @@ namespace dev
         // 8bit linear alpha mask
         AlphaMask,
         // 32bit floating point depth texture.
-        DepthComponent32f
+        DepthComponent32f,
+        // Block compressed formats. Each block encodes 4x4 pixels.
+        // BC1 (DXT1) RGB, 8 bytes per block.
+        BC1_RGB, BC1_sRGB,
+        // BC3 (DXT5) RGBA, 16 bytes per block.
+        BC3_RGBA, BC3_sRGBA,
+        // ETC2 RGB, 8 bytes per block.
+        ETC2_RGB, ETC2_sRGB,
+        // ETC2 RGB + EAC alpha, 16 bytes per block.
+        ETC2_RGBA, ETC2_sRGBA
     };
 
+    // Check whether the texture format is a block compressed format.
+    inline bool IsCompressedFormat(TextureFormat format) noexcept
+    {
+        return format == TextureFormat::BC1_RGB  || format == TextureFormat::BC1_sRGB  ||
+               format == TextureFormat::BC3_RGBA || format == TextureFormat::BC3_sRGBA ||
+               format == TextureFormat::ETC2_RGB || format == TextureFormat::ETC2_sRGB ||
+               format == TextureFormat::ETC2_RGBA || format == TextureFormat::ETC2_sRGBA;
+    }
+
+    // Map the block compressed texture format and texture dimensions
+    // to the size of the compressed texture data in bytes.
+    inline size_t GetCompressedTextureByteSize(TextureFormat format, unsigned width, unsigned height)
+    {
+        const size_t blocks = size_t((width + 3) / 4) * size_t((height + 3) / 4);
+        if (format == TextureFormat::BC1_RGB || format == TextureFormat::BC1_sRGB ||
+            format == TextureFormat::ETC2_RGB || format == TextureFormat::ETC2_sRGB)
+            return blocks * 8;
+        else if (format == TextureFormat::BC3_RGBA || format == TextureFormat::BC3_sRGBA ||
+                 format == TextureFormat::ETC2_RGBA || format == TextureFormat::ETC2_sRGBA)
+            return blocks * 16;
+        else BUG("Not a compressed texture format.");
+        return 0;
+    }
+
     // Texture minifying filter is used whenever the
     // pixel being textured maps to an area greater than
     // one texture element.
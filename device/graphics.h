@@ -93,6 +93,12 @@ namespace dev
                                               unsigned texture_width,
                                               unsigned texture_height, TextureFormat format) = 0;
         virtual MipStatus GenerateMipmaps(const TextureObject& texture) = 0;
+        // Upload the texture data for a single mip level of a texture that
+        // was previously created with UploadTexture2D. The data must be in
+        // the texture's format and the caller is responsible for uploading
+        // a complete mip chain down to 1x1 before using mipmap filtering.
+        virtual void UploadTexture2DMip(const TextureObject& texture, unsigned mip_level, const void* bytes,
+                                        size_t byte_count, unsigned mip_width, unsigned mip_height) = 0;
 
         virtual bool BindTexture2D(const TextureObject& texture, const GraphicsProgram& program, const std::string& sampler_name,
                                    unsigned texture_unit, TextureWrapping texture_x_wrap, TextureWrapping texture_y_wrap,
@@ -103,6 +109,11 @@ namespace dev
         virtual GraphicsBuffer AllocateBuffer(size_t bytes, BufferUsage usage, BufferType type) = 0;
         virtual void FreeBuffer(const GraphicsBuffer& buffer) = 0;
         virtual void UploadBuffer(const GraphicsBuffer& buffer, const void* data, size_t bytes) = 0;
+        // Try to move the buffer data to a free range closer to the start of the
+        // buffer pool in order to reduce fragmentation. On success the old buffer
+        // is freed, the new buffer is returned in relocated and true is returned.
+        // The relocated buffer can alias the original buffer.
+        virtual bool RelocateBuffer(const GraphicsBuffer& buffer, GraphicsBuffer* relocated) = 0;
 
         virtual void BindVertexBuffer(const GraphicsBuffer& buffer, const GraphicsProgram& program, const VertexLayout& layout) const = 0;
         virtual void BindIndexBuffer(const GraphicsBuffer& buffer) const = 0;
@@ -140,6 +151,7 @@ namespace dev
                                const Framebuffer& fbo, void* color_data) const = 0;
 
         virtual void GetResourceStats(GraphicsDeviceResourceStats* stats) const = 0;
+        virtual void GetStateStats(GraphicsDeviceStateStats* stats) const = 0;
         virtual void GetDeviceCaps(GraphicsDeviceCaps* caps) const = 0;
 
         virtual void BeginFrame()  = 0;
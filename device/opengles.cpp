@@ -24,6 +24,7 @@
 
 #include <GLES3/gl3.h>
 
+#include <algorithm>
 #include <cstdio>
 #include <cassert>
 #include <cstring> // for memcpy
@@ -75,6 +76,18 @@
 // <pname> is RENDERBUFFER_INTERNAL_FORMAT:
 #define GL_DEPTH24_STENCIL8_OES                           0x88F0
 
+// EXT_texture_compression_s3tc
+// https://registry.khronos.org/OpenGL/extensions/EXT/EXT_texture_compression_s3tc.txt
+// Accepted by the <internalformat> parameter of CompressedTexImage2D:
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT                   0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT                  0x83F3
+
+// EXT_texture_compression_s3tc_srgb
+// https://registry.khronos.org/OpenGL/extensions/EXT/EXT_texture_compression_s3tc_srgb.txt
+// Accepted by the <internalformat> parameter of CompressedTexImage2D:
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT                  0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT            0x8C4F
+
 // https://registry.khronos.org/OpenGL/extensions/KHR/KHR_debug.txt
 // Tokens accepted by the <target> parameters of Enable, Disable, and IsEnabled:
 #define GL_DEBUG_OUTPUT_KHR                                     0x92E0
@@ -297,6 +310,7 @@ struct OpenGLFunctions
     PFNGLVERTEXATTRIBDIVISORPROC     glVertexAttribDivisor;
     PFNGLGETSTRINGPROC               glGetString;
     PFNGLGETUNIFORMLOCATIONPROC      glGetUniformLocation;
+    PFNGLGETACTIVEUNIFORMPROC        glGetActiveUniform;
     PFNGLGETUNIFORMBLOCKINDEXPROC    glGetUniformBlockIndex;
     PFNGLUNIFORMBLOCKBINDINGPROC     glUniformBlockBinding;
     PFNGLUNIFORM1UIPROC              glUniform1ui;
@@ -327,6 +341,7 @@ struct OpenGLFunctions
     PFNGLACTIVETEXTUREPROC           glActiveTexture;
     PFNGLGENERATEMIPMAPPROC          glGenerateMipmap;
     PFNGLTEXIMAGE2DPROC              glTexImage2D;
+    PFNGLCOMPRESSEDTEXIMAGE2DPROC    glCompressedTexImage2D;
     PFNGLTEXIMAGE3DPROC              glTexImage3D;
     PFNGLTEXPARAMETERIPROC           glTexParameteri;
     PFNGLPIXELSTOREIPROC             glPixelStorei;
@@ -344,6 +359,7 @@ struct OpenGLFunctions
     PFNGLBINDBUFFERRANGEPROC         glBindBufferRange;
     PFNGLBUFFERDATAPROC              glBufferData;
     PFNGLBUFFERSUBDATAPROC           glBufferSubData;
+    PFNGLCOPYBUFFERSUBDATAPROC       glCopyBufferSubData;
     PFNGLFRAMEBUFFERRENDERBUFFERPROC glFramebufferRenderbuffer;
     PFNGLGENFRAMEBUFFERSPROC         glGenFramebuffers;
     PFNGLDELETEFRAMEBUFFERSPROC      glDeleteFramebuffers;
@@ -379,14 +395,32 @@ class OpenGLES2GraphicsDevice : public std::enable_shared_from_this<OpenGLES2Gra
 private:
     struct CachedUniform {
         GLuint location = 0;
-        uint32_t hash = 0;
+        // the last value set to the uniform in the program object.
+        // uniform values are part of the program object state so
+        // this remains valid until the program is deleted.
+        dev::UniformValType value;
+        bool has_value = false;
+        // when non-null this uniform is just another name for the
+        // aliased uniform (i.e. an array name that refers to the first
+        // element) and all the state lives in the aliased uniform.
+        CachedUniform* alias = nullptr;
+    };
+    struct BufferRange {
+        size_t offset = 0;
+        size_t bytes  = 0;
     };
     struct BufferObject {
         dev::BufferUsage usage = dev::BufferUsage::Static;
         GLuint name = 0;
         size_t capacity = 0;
+        // bump allocation offset. only used with streaming buffers.
         size_t offset = 0;
+        // number of bytes in live allocations.
+        size_t used = 0;
         size_t refcount = 0;
+        // the free ranges of a static or dynamic buffer sorted by offset.
+        // adjacent free ranges are always merged together.
+        std::vector<BufferRange> free_list;
     };
     struct TextureState {
         GLenum wrap_x = GL_NONE;
@@ -408,13 +442,17 @@ private:
         };
         std::vector<MSAARenderBuffer> multisample_color_buffers;
     };
-    using UniformCache = std::unordered_map<std::string, CachedUniform>;
+    // uniforms by uniform name hash. built when the program is linked.
+    using UniformCache = std::unordered_map<std::uint32_t, CachedUniform>;
+    using UniformBlockCache = std::unordered_map<std::string, CachedUniform>;
+
+    static constexpr GLuint InvalidBinding = 0xffffffff;
 
     std::shared_ptr<dev::Context> mContextImpl;
     dev::Context* mContext = nullptr;
 
     mutable std::unordered_map<unsigned, UniformCache> mUniformCache;
-    mutable std::unordered_map<unsigned, UniformCache> mUniformBlockCache;
+    mutable std::unordered_map<unsigned, UniformBlockCache> mUniformBlockCache;
     mutable std::unordered_map<unsigned, TextureState> mTextureState;
     mutable std::unordered_map<unsigned, FramebufferState> mFramebufferState;
 
@@ -423,8 +461,25 @@ private:
     mutable dev::ColorDepthStencilState mColorDepthStencilState;
     mutable dev::ViewportState mViewportState;
 
+    // shadow copy of the current object bindings in the context.
+    // used to cull superfluous binding calls.
+    struct BindingState {
+        GLuint program = 0;
+        GLuint array_buffer = 0;
+        GLuint element_array_buffer = 0;
+        GLuint uniform_buffer = 0;
+        unsigned active_texture_unit = 0;
+        // currently bound texture object per texture unit.
+        std::vector<GLuint> texture_2d;
+        std::vector<GLuint> texture_2d_array;
+    };
+    mutable BindingState mBindingState;
+    mutable dev::GraphicsDeviceStateStats mStateStats;
+
     // vertex buffers at index 0 and index buffers at index 1, uniform buffers at index 2
     std::vector<BufferObject> mBuffers[3];
+    std::size_t mBufferRelocations = 0;
+    std::size_t mBufferRelocatedBytes = 0;
 
     unsigned mTempResolveFbo = 0;
     unsigned mTempTextureUnitIndex = 0;
@@ -439,24 +494,85 @@ private:
         bool OES_texture_float = false;
         // support multiple color attachments in GL ES2.
         bool GL_EXT_draw_buffers = false;
+        // block compressed texture formats.
+        bool EXT_texture_compression_s3tc = false;
+        bool EXT_texture_compression_s3tc_srgb = false;
+        bool OES_compressed_ETC2 = false;
     } mExtensions;
 private:
 
-    CachedUniform& GetUniformFromCache(const dev::GraphicsProgram& program, const std::string& name) const
+    // Find an active uniform in the program's uniform cache.
+    // Returns nullptr if the program has no such (active) uniform.
+    static CachedUniform* FindUniform(UniformCache& cache, dev::UniformName name) noexcept
     {
-        // todo: replace with a better faster key
-        auto& cache = mUniformCache[program.handle];
+        auto it = cache.find(name.GetHash());
+        if (it == std::end(cache))
+            return nullptr;
+        if (it->second.alias)
+            return it->second.alias;
+        return &it->second;
+    }
 
-        auto it = cache.find(name);
-        if (it != std::end(cache))
-            return it->second;
+    void BuildUniformCache(GLuint program) const
+    {
+        GLint num_uniforms = 0;
+        GLint max_name_length = 0;
+        GL_CALL(glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &num_uniforms));
+        GL_CALL(glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length));
 
-        auto ret = mGL.glGetUniformLocation(program.handle, name.c_str());
-        CachedUniform uniform;
-        uniform.location = ret;
-        uniform.hash = 0;
-        cache[name] = uniform;
-        return cache[name];
+        auto& cache = mUniformCache[program];
+        cache.clear();
+
+        std::string name;
+        name.resize(max_name_length + 1);
+
+        // returns the new cache entry or nullptr if the uniform was not added.
+        // the entries are stable since the unordered_map never moves its elements.
+        const auto AddUniform = [&cache, program, this](const std::string& name) -> CachedUniform* {
+            const GLint location = mGL.glGetUniformLocation(program, name.c_str());
+            // uniforms in uniform blocks don't have a location.
+            if (location == -1)
+                return nullptr;
+            const auto key = dev::UniformName(name).GetHash();
+            if (base::Contains(cache, key))
+            {
+                ERROR("Uniform name hash collision. [program=%1, uniform='%2']", program, name);
+                return nullptr;
+            }
+            CachedUniform uniform;
+            uniform.location = location;
+            cache[key] = uniform;
+            return &cache[key];
+        };
+
+        for (GLint i=0; i<num_uniforms; ++i)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = GL_NONE;
+            GL_CALL(glGetActiveUniform(program, i, (GLsizei)name.size(), &length, &size, &type, &name[0]));
+
+            const std::string uniform_name(name.c_str(), length);
+
+            // arrays are reported with the name of the first element, i.e. foo[0].
+            // resolve the array elements individually. the array name itself
+            // refers to the first element so it's an alias of the first element
+            // and shares the cached value with it.
+            if (base::EndsWith(uniform_name, "[0]"))
+            {
+                const auto& array_name = uniform_name.substr(0, uniform_name.size() - 3);
+                CachedUniform* first = nullptr;
+                for (GLint j=0; j<size; ++j)
+                {
+                    auto* element = AddUniform(array_name + "[" + std::to_string(j) + "]");
+                    if (j == 0)
+                        first = element;
+                }
+                if (auto* alias = AddUniform(array_name))
+                    alias->alias = first;
+            }
+            else AddUniform(uniform_name);
+        }
     }
 
     CachedUniform& GetUniformBlockFromCache(const dev::GraphicsProgram& program, const std::string& name) const
@@ -470,11 +586,127 @@ private:
         auto ret = mGL.glGetUniformBlockIndex(program.handle, name.c_str());
         CachedUniform block;
         block.location = ret;
-        block.hash = 0;
         cache[name] = block;
         return cache[name];
     }
 
+    static bool IsSameUniformValue(const dev::UniformValType& lhs, const dev::UniformValType& rhs) noexcept
+    {
+        if (lhs.index() != rhs.index())
+            return false;
+
+        // all the uniform value types are plain floats and ints
+        // without any padding so a bitwise compare will do.
+        return std::visit([&rhs](const auto& value) {
+            using Type = std::decay_t<decltype(value)>;
+            return std::memcmp(&value, &std::get<Type>(rhs), sizeof(Type)) == 0;
+        }, lhs);
+    }
+
+    bool TestUniformValue(CachedUniform& uniform, const dev::UniformValType& value) const noexcept
+    {
+        if (uniform.has_value && IsSameUniformValue(uniform.value, value))
+        {
+            mStateStats.uniform_sets_skipped++;
+            return false;
+        }
+        uniform.value = value;
+        uniform.has_value = true;
+        mStateStats.uniform_sets_issued++;
+        return true;
+    }
+
+    void UseProgram(GLuint program) const noexcept
+    {
+        if (mBindingState.program == program)
+        {
+            mStateStats.program_binds_skipped++;
+            return;
+        }
+        GL_CALL(glUseProgram(program));
+        mBindingState.program = program;
+        mStateStats.program_binds_issued++;
+    }
+
+    void BindBuffer(GLenum target, GLuint buffer) const noexcept
+    {
+        GLuint* binding = nullptr;
+        if (target == GL_ARRAY_BUFFER)
+            binding = &mBindingState.array_buffer;
+        else if (target == GL_ELEMENT_ARRAY_BUFFER)
+            binding = &mBindingState.element_array_buffer;
+        else if (target == GL_UNIFORM_BUFFER)
+            binding = &mBindingState.uniform_buffer;
+        else BUG("Bug on buffer binding target.");
+
+        if (*binding == buffer)
+        {
+            mStateStats.buffer_binds_skipped++;
+            return;
+        }
+        GL_CALL(glBindBuffer(target, buffer));
+        *binding = buffer;
+        mStateStats.buffer_binds_issued++;
+    }
+
+    // Deleting a buffer object that is bound reverts the binding to zero.
+    void InvalidateBufferBinding(GLuint buffer) const noexcept
+    {
+        if (mBindingState.array_buffer == buffer)
+            mBindingState.array_buffer = 0;
+        if (mBindingState.element_array_buffer == buffer)
+            mBindingState.element_array_buffer = 0;
+        if (mBindingState.uniform_buffer == buffer)
+            mBindingState.uniform_buffer = 0;
+    }
+
+    void ActiveTextureUnit(unsigned texture_unit) const noexcept
+    {
+        if (mBindingState.active_texture_unit == texture_unit)
+            return;
+        GL_CALL(glActiveTexture(GL_TEXTURE0 + texture_unit));
+        mBindingState.active_texture_unit = texture_unit;
+    }
+
+    // Bind the texture to the given texture unit. If the texture is
+    // already bound to the texture unit nothing is done and the active
+    // texture unit is not changed either. If the caller needs to modify
+    // the texture object through the texture unit the texture unit must
+    // be activated separately.
+    void BindTexture(GLenum target, unsigned texture_unit, GLuint texture) const noexcept
+    {
+        auto& bindings = target == GL_TEXTURE_2D_ARRAY ? mBindingState.texture_2d_array
+                                                       : mBindingState.texture_2d;
+        ASSERT(texture_unit < bindings.size());
+        if (bindings[texture_unit] == texture)
+        {
+            mStateStats.texture_binds_skipped++;
+            return;
+        }
+        ActiveTextureUnit(texture_unit);
+        GL_CALL(glBindTexture(target, texture));
+        bindings[texture_unit] = texture;
+        mStateStats.texture_binds_issued++;
+    }
+
+    void ResetBindingState() const noexcept
+    {
+        // forget what is bound so that the next bind call on each
+        // binding point is always issued. used when we can't know what
+        // is actually bound in the context, for example something outside
+        // this device might have changed the bindings in between frames.
+        const auto texture_units = mBindingState.texture_2d.size();
+
+        mBindingState = BindingState {};
+        mBindingState.program = InvalidBinding;
+        mBindingState.array_buffer = InvalidBinding;
+        mBindingState.element_array_buffer = InvalidBinding;
+        mBindingState.uniform_buffer = InvalidBinding;
+        mBindingState.active_texture_unit = InvalidBinding;
+        mBindingState.texture_2d.resize(texture_units, InvalidBinding);
+        mBindingState.texture_2d_array.resize(texture_units, InvalidBinding);
+    }
+
     void SetState(dev::BlendOp blending, bool premulalpha) const noexcept
     {
         // blending
@@ -504,12 +736,17 @@ private:
 
             mRasterState.blending = blending;
             mRasterState.premulalpha = premulalpha;
+            mStateStats.render_state_issued++;
         }
+        else mStateStats.render_state_skipped++;
     }
     void SetState(dev::PolygonWindingOrder winding_order) const noexcept
     {
         if (mRasterState.winding_order == winding_order)
+        {
+            mStateStats.render_state_skipped++;
             return;
+        }
 
         if (winding_order == dev::PolygonWindingOrder::CounterClockWise)
         {
@@ -522,11 +759,15 @@ private:
         else BUG("Bug on polygon winding order.");
 
         mRasterState.winding_order = winding_order;
+        mStateStats.render_state_issued++;
     }
     void SetState(dev::Culling culling) const noexcept
     {
         if (mRasterState.culling == culling)
+        {
+            mStateStats.render_state_skipped++;
             return;
+        }
 
         if (culling == dev::Culling::None)
         {
@@ -550,12 +791,15 @@ private:
         else BUG("Bug on cull face state.");
 
         mRasterState.culling = culling;
-
+        mStateStats.render_state_issued++;
     }
     void SetState(dev::DepthTest depth_test) const noexcept
     {
         if (mColorDepthStencilState.depth_test == depth_test)
+        {
+            mStateStats.render_state_skipped++;
             return;
+        }
 
         if (depth_test == dev::DepthTest::Disabled)
         {
@@ -574,6 +818,7 @@ private:
         else BUG("Bug on depth test state.");
 
         mColorDepthStencilState.depth_test = depth_test;
+        mStateStats.render_state_issued++;
     }
 
 public:
@@ -615,6 +860,7 @@ public:
         RESOLVE(glVertexAttribDivisor);
         RESOLVE(glGetString);
         RESOLVE(glGetUniformLocation);
+        RESOLVE(glGetActiveUniform);
         RESOLVE(glGetUniformBlockIndex);
         RESOLVE(glUniformBlockBinding);
         RESOLVE(glUniform1ui);
@@ -645,6 +891,7 @@ public:
         RESOLVE(glActiveTexture);
         RESOLVE(glGenerateMipmap);
         RESOLVE(glTexImage2D);
+        RESOLVE(glCompressedTexImage2D);
         RESOLVE(glTexImage3D);
         RESOLVE(glTexParameteri);
         RESOLVE(glPixelStorei);
@@ -662,6 +909,7 @@ public:
         RESOLVE(glBindBufferRange);
         RESOLVE(glBufferData);
         RESOLVE(glBufferSubData);
+        RESOLVE(glCopyBufferSubData);
         RESOLVE(glFramebufferRenderbuffer);
         RESOLVE(glGenFramebuffers);
         RESOLVE(glDeleteFramebuffers);
@@ -752,6 +1000,18 @@ public:
                 mExtensions.GL_EXT_draw_buffers = true;
             else if (extension == "GL_OES_texture_float")
                 mExtensions.OES_texture_float = true;
+            else if (extension == "GL_EXT_texture_compression_s3tc" ||
+                     extension == "GL_WEBGL_compressed_texture_s3tc" ||
+                     extension == "WEBGL_compressed_texture_s3tc")
+                mExtensions.EXT_texture_compression_s3tc = true;
+            else if (extension == "GL_EXT_texture_compression_s3tc_srgb" ||
+                     extension == "GL_WEBGL_compressed_texture_s3tc_srgb" ||
+                     extension == "WEBGL_compressed_texture_s3tc_srgb")
+                mExtensions.EXT_texture_compression_s3tc_srgb = true;
+            else if (extension == "GL_OES_compressed_ETC2_RGBA8_texture" ||
+                     extension == "GL_WEBGL_compressed_texture_etc" ||
+                     extension == "WEBGL_compressed_texture_etc")
+                mExtensions.OES_compressed_ETC2 = true;
 
             VERBOSE("Found extension '%1'", extension);
         }
@@ -759,6 +1019,7 @@ public:
         INFO("FBO packed depth+stencil: %1", mExtensions.OES_packed_depth_stencil ? "YES" : "NO");
         INFO("EXT draw buffers: %1", mExtensions.GL_EXT_draw_buffers ? "YES" : "NO");
         INFO("Texture float32: %1", mExtensions.OES_texture_float ? "YES" : "NO");
+        INFO("Texture compression S3TC: %1", mExtensions.EXT_texture_compression_s3tc ? "YES" : "NO");
 
         if (context->IsDebug() && mGL.glDebugMessageCallback)
         {
@@ -823,6 +1084,10 @@ public:
         mColorDepthStencilState.stencil_func = dev::StencilFunc::Disabled;
         mColorDepthStencilState.bWriteColor = true;
 
+        mBindingState.texture_2d.resize(max_texture_units);
+        mBindingState.texture_2d_array.resize(max_texture_units);
+        ResetBindingState();
+
         have_printed_info = true;
 
     }
@@ -843,15 +1108,18 @@ public:
         }
         for (auto& buffer: mBuffers[0])
         {
-            GL_CALL(glDeleteBuffers(1, &buffer.name));
+            if (buffer.name)
+                GL_CALL(glDeleteBuffers(1, &buffer.name));
         }
         for (auto& buffer: mBuffers[1])
         {
-            GL_CALL(glDeleteBuffers(1, &buffer.name));
+            if (buffer.name)
+                GL_CALL(glDeleteBuffers(1, &buffer.name));
         }
         for (auto& buffer: mBuffers[2])
         {
-            GL_CALL(glDeleteBuffers(1, &buffer.name));
+            if (buffer.name)
+                GL_CALL(glDeleteBuffers(1, &buffer.name));
         }
     }
 
@@ -868,6 +1136,88 @@ public:
         return 0;
     }
 
+    // Get the number of bytes actually taken by a static or dynamic
+    // buffer allocation. The allocations are padded so that every
+    // range in the free list keeps a properly aligned offset.
+    size_t GetAllocationSize(size_t bytes, dev::BufferType type) const
+    {
+        size_t alignment = 16;
+        if (type == dev::BufferType::UniformBuffer)
+            alignment = std::max(alignment, (size_t)mUniformBufferOffsetAlignment);
+        return (bytes + alignment - 1) / alignment * alignment;
+    }
+
+    // Find the smallest free range that can hold the given number of bytes.
+    // Returns the index of the range or the size of the free list if no
+    // such range exists.
+    static size_t FindBestFit(const BufferObject& buffer, size_t bytes) noexcept
+    {
+        size_t best_index = buffer.free_list.size();
+        for (size_t i=0; i<buffer.free_list.size(); ++i)
+        {
+            const auto& range = buffer.free_list[i];
+            if (range.bytes < bytes)
+                continue;
+            if (best_index == buffer.free_list.size() || range.bytes < buffer.free_list[best_index].bytes)
+                best_index = i;
+            if (range.bytes == bytes)
+                break;
+        }
+        return best_index;
+    }
+
+    // Take the given number of bytes from the start of the free range
+    // and return the offset of the allocation.
+    static size_t AllocateRange(BufferObject& buffer, size_t range_index, size_t bytes) noexcept
+    {
+        ASSERT(range_index < buffer.free_list.size());
+        auto& range = buffer.free_list[range_index];
+        ASSERT(range.bytes >= bytes);
+
+        const auto offset = range.offset;
+        range.offset += bytes;
+        range.bytes  -= bytes;
+        if (range.bytes == 0)
+            buffer.free_list.erase(buffer.free_list.begin() + range_index);
+
+        buffer.used += bytes;
+        buffer.refcount++;
+        return offset;
+    }
+
+    // Return the range back to the free list and merge it with
+    // any adjacent free ranges.
+    static void FreeRange(BufferObject& buffer, size_t offset, size_t bytes) noexcept
+    {
+        ASSERT(buffer.used >= bytes);
+        buffer.used -= bytes;
+
+        auto& list = buffer.free_list;
+        auto it = std::lower_bound(list.begin(), list.end(), offset,
+            [](const BufferRange& range, size_t offset) {
+                return range.offset < offset;
+            });
+        ASSERT(it == list.end() || offset + bytes <= it->offset);
+
+        it = list.insert(it, BufferRange{offset, bytes});
+        auto next = it + 1;
+        if (next != list.end() && it->offset + it->bytes == next->offset)
+        {
+            it->bytes += next->bytes;
+            list.erase(next);
+        }
+        if (it != list.begin())
+        {
+            auto prev = it - 1;
+            ASSERT(prev->offset + prev->bytes <= it->offset);
+            if (prev->offset + prev->bytes == it->offset)
+            {
+                prev->bytes += it->bytes;
+                list.erase(it);
+            }
+        }
+    }
+
     static GLenum GetEnum(dev::BufferType type)
     {
         if (type == dev::BufferType::VertexBuffer)
@@ -1084,6 +1434,31 @@ public:
                 baseFormat = GL_RGBA;
                 type = GL_FLOAT;
                 break;
+            // compressed formats only have the internal format.
+            case dev::TextureFormat::BC1_RGB:
+                sizeFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+                break;
+            case dev::TextureFormat::BC1_sRGB:
+                sizeFormat = GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+                break;
+            case dev::TextureFormat::BC3_RGBA:
+                sizeFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+                break;
+            case dev::TextureFormat::BC3_sRGBA:
+                sizeFormat = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+                break;
+            case dev::TextureFormat::ETC2_RGB:
+                sizeFormat = GL_COMPRESSED_RGB8_ETC2;
+                break;
+            case dev::TextureFormat::ETC2_sRGB:
+                sizeFormat = GL_COMPRESSED_SRGB8_ETC2;
+                break;
+            case dev::TextureFormat::ETC2_RGBA:
+                sizeFormat = GL_COMPRESSED_RGBA8_ETC2_EAC;
+                break;
+            case dev::TextureFormat::ETC2_sRGBA:
+                sizeFormat = GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC;
+                break;
             default:
                 BUG("Unknown texture format.");
                 break;
@@ -1133,6 +1508,11 @@ public:
     {
         GL_CALL(glDeleteProgram(program.handle));
 
+        // the program remains in use until another program is made
+        // current but the name could be recycled so force a re-bind.
+        if (mBindingState.program == program.handle)
+            mBindingState.program = InvalidBinding;
+
         mUniformCache.erase(program.handle);
         mUniformBlockCache.erase(program.handle);
     }
@@ -1557,20 +1937,23 @@ public:
             GL_CALL(glDeleteProgram(program));
             return {0};
         }
+        BuildUniformCache(program);
         return {program};
     }
 
     dev::TextureObject AllocateTexture2D(unsigned texture_width,
                                          unsigned texture_height, dev::TextureFormat format) override
     {
+        ASSERT(!dev::IsCompressedFormat(format) && "Compressed textures must be uploaded with data.");
+
         const auto& internal_format = GetTextureFormat(format);
         constexpr auto texture_border = 0;
         constexpr auto texture_level = 0; // mip level
 
         GLuint handle = 0;
         GL_CALL(glGenTextures(1, &handle));
-        GL_CALL(glActiveTexture(GL_TEXTURE0 + mTempTextureUnitIndex));
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, handle));
+        ActiveTextureUnit(mTempTextureUnitIndex);
+        BindTexture(GL_TEXTURE_2D, mTempTextureUnitIndex, handle);
         GL_CALL(glTexImage2D(GL_TEXTURE_2D, texture_level, internal_format.sizeFormat,
                              texture_width, texture_height, texture_border,
                              internal_format.baseFormat, internal_format.type, nullptr));
@@ -1600,8 +1983,8 @@ public:
 
         GLuint handle = 0;
         GL_CALL(glGenTextures(1, &handle));
-        GL_CALL(glActiveTexture(GL_TEXTURE0 + mTempTextureUnitIndex));
-        GL_CALL(glBindTexture(GL_TEXTURE_2D_ARRAY, handle));
+        ActiveTextureUnit(mTempTextureUnitIndex);
+        BindTexture(GL_TEXTURE_2D_ARRAY, mTempTextureUnitIndex, handle);
         GL_CALL(glTexImage3D(GL_TEXTURE_2D_ARRAY, texture_level, internal_format.sizeFormat,
                              texture_width, texture_height, texture_array_size, texture_border,
                              internal_format.baseFormat, internal_format.type, nullptr));
@@ -1633,11 +2016,21 @@ public:
 
         GLuint handle = 0;
         GL_CALL(glGenTextures(1, &handle));
-        GL_CALL(glActiveTexture(GL_TEXTURE0 + mTempTextureUnitIndex));
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, handle));
-        GL_CALL(glTexImage2D(GL_TEXTURE_2D, texture_level, internal_format.sizeFormat,
-                             texture_width, texture_height, texture_border,
-                             internal_format.baseFormat, internal_format.type, bytes));
+        ActiveTextureUnit(mTempTextureUnitIndex);
+        BindTexture(GL_TEXTURE_2D, mTempTextureUnitIndex, handle);
+        if (dev::IsCompressedFormat(format))
+        {
+            const auto bytes_size = dev::GetCompressedTextureByteSize(format, texture_width, texture_height);
+            GL_CALL(glCompressedTexImage2D(GL_TEXTURE_2D, texture_level, internal_format.sizeFormat,
+                                           texture_width, texture_height, texture_border,
+                                           (GLsizei)bytes_size, bytes));
+        }
+        else
+        {
+            GL_CALL(glTexImage2D(GL_TEXTURE_2D, texture_level, internal_format.sizeFormat,
+                                 texture_width, texture_height, texture_border,
+                                 internal_format.baseFormat, internal_format.type, bytes));
+        }
 
         auto& texture_state = mTextureState[handle];
         texture_state.min_filter = GL_NONE;
@@ -1661,6 +2054,10 @@ public:
         ASSERT(texture.texture_width);
         ASSERT(texture.texture_height);
 
+        // compressed texture mips cannot be generated by the GL.
+        if (dev::IsCompressedFormat(texture.format))
+            return GraphicsDevice::MipStatus::UnsupportedFormat;
+
         if (mContext->GetVersion() == dev::Context::Version::WebGL_1)
         {
             if (!base::IsPowerOfTwo(texture.texture_width) || !base::IsPowerOfTwo(texture.texture_height))
@@ -1682,8 +2079,8 @@ public:
                 texture.format == dev::TextureFormat::sRGBA)
                 return GraphicsDevice::MipStatus::UnsupportedFormat;
         }
-        GL_CALL(glActiveTexture(GL_TEXTURE0 + mTempTextureUnitIndex));
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, texture.handle));
+        ActiveTextureUnit(mTempTextureUnitIndex);
+        BindTexture(GL_TEXTURE_2D, mTempTextureUnitIndex, texture.handle);
         // seems that driver bugs are common regarding sRGB mipmap generation
         // so we're going to unwrap this GL call and assume any error
         // is an error about failing to generate mips because of driver bugs
@@ -1698,6 +2095,39 @@ public:
         return GraphicsDevice::MipStatus::Success;
     }
 
+    void UploadTexture2DMip(const dev::TextureObject& texture, unsigned mip_level, const void* bytes,
+                            size_t byte_count, unsigned mip_width, unsigned mip_height) override
+    {
+        ASSERT(texture.IsValid());
+        ASSERT(texture.texture_array_size == 0);
+        ASSERT(bytes && byte_count);
+
+        const auto& internal_format = GetTextureFormat(texture.format);
+        const auto texture_border = 0;
+
+        ActiveTextureUnit(mTempTextureUnitIndex);
+        BindTexture(GL_TEXTURE_2D, mTempTextureUnitIndex, texture.handle);
+        if (dev::IsCompressedFormat(texture.format))
+        {
+            ASSERT(byte_count == dev::GetCompressedTextureByteSize(texture.format, mip_width, mip_height));
+            GL_CALL(glCompressedTexImage2D(GL_TEXTURE_2D, mip_level, internal_format.sizeFormat,
+                                           mip_width, mip_height, texture_border,
+                                           (GLsizei)byte_count, bytes));
+        }
+        else
+        {
+            GL_CALL(glTexImage2D(GL_TEXTURE_2D, mip_level, internal_format.sizeFormat,
+                                 mip_width, mip_height, texture_border,
+                                 internal_format.baseFormat, internal_format.type, bytes));
+        }
+
+        if (mip_level > 0)
+        {
+            auto& texture_state = mTextureState[texture.handle];
+            texture_state.has_mips = true;
+        }
+    }
+
     bool BindTexture2D(const dev::TextureObject& texture, const dev::GraphicsProgram& program, const std::string& sampler_name, unsigned texture_unit,
                        dev::TextureWrapping texture_x_wrap, dev::TextureWrapping texture_y_wrap,
                        dev::TextureMinFilter texture_min_filter, dev::TextureMagFilter texture_mag_filter,
@@ -1716,8 +2146,8 @@ public:
             return false;
         }
 
-        const auto& sampler = GetUniformFromCache(program, sampler_name);
-        if (sampler.location == -1)
+        auto* sampler = FindUniform(mUniformCache[program.handle], sampler_name);
+        if (sampler == nullptr)
             return true;
 
         bool force_clamp_x = false;
@@ -1778,13 +2208,12 @@ public:
             texture_state.wrap_x != internal_texture_x_wrap ||
             texture_state.wrap_y != internal_texture_y_wrap)
         {
-            GL_CALL(glActiveTexture(GL_TEXTURE0 + texture_unit));
-            GL_CALL(glBindTexture(texture_target, texture.handle));
+            ActiveTextureUnit(texture_unit);
+            BindTexture(texture_target, texture_unit, texture.handle);
             GL_CALL(glTexParameteri(texture_target, GL_TEXTURE_WRAP_S, internal_texture_x_wrap));
             GL_CALL(glTexParameteri(texture_target, GL_TEXTURE_WRAP_T, internal_texture_y_wrap));
             GL_CALL(glTexParameteri(texture_target, GL_TEXTURE_MAG_FILTER, internal_texture_mag_filter));
             GL_CALL(glTexParameteri(texture_target, GL_TEXTURE_MIN_FILTER, internal_texture_min_filter));
-            GL_CALL(glUniform1i(sampler.location, texture_unit));
             texture_state.mag_filter = internal_texture_mag_filter;
             texture_state.min_filter = internal_texture_min_filter;
             texture_state.wrap_x = internal_texture_x_wrap;
@@ -1792,10 +2221,13 @@ public:
         }
         else
         {
-            // set the texture unit to the sampler
-            GL_CALL(glActiveTexture(GL_TEXTURE0 + texture_unit));
-            GL_CALL(glBindTexture(texture_target, texture.handle));
-            GL_CALL(glUniform1i(sampler.location, texture_unit));
+            BindTexture(texture_target, texture_unit, texture.handle);
+        }
+
+        // set the texture unit to the sampler
+        if (TestUniformValue(*sampler, static_cast<int>(texture_unit)))
+        {
+            GL_CALL(glUniform1i(sampler->location, texture_unit));
         }
         return true;
     }
@@ -1804,6 +2236,17 @@ public:
     {
         GL_CALL(glDeleteTextures(1, &texture.handle));
 
+        // deleting a bound texture reverts the binding to the default texture.
+        for (auto& binding : mBindingState.texture_2d)
+        {
+            if (binding == texture.handle)
+                binding = 0;
+        }
+        for (auto& binding : mBindingState.texture_2d_array)
+        {
+            if (binding == texture.handle)
+                binding = 0;
+        }
         mTextureState.erase(texture.handle);
     }
 
@@ -1815,23 +2258,18 @@ public:
         // 1. Static buffers
         // Static buffers are allocated by static geometry objects
         // that are typically created once and never updated.
-        // For static buffers we're using so called bump allocation.
-        // That means that for each geometry allocation we take the
-        // first chunk that can be found and has enough space. These
-        // individual chunks can then never be "freed" but only when
-        // the whole VBO is no longer referred to can the data be re-used.
-        // This should be the optimal allocation strategy for static
-        // game data that is created when the application begins
-        // running and then never gets modified.
-        //
         // 2. Dynamic buffers
         // Dynamic buffers can be allocated and used by geometry objects
         // that have had their geometry data updated. The usage can thus
-        // grow or shrink during application run. This type of buffering
-        // needs an allocation strategy that can handle fragmentation.
-        // Since that doesn't currently exist (but is a TODO) we're just
-        // going to use a VBO *per* geometry and let the driver handle
-        // the fragmentation.
+        // grow or shrink during application run.
+        //
+        // Both static and dynamic buffers are sub-allocated from large
+        // buffer objects. Each buffer object keeps a free list of the
+        // ranges that are not in use and allocation takes the smallest
+        // free range that has enough space (best fit). When a range is
+        // freed it's merged back with its neighbours in the free list.
+        // Levels that are streamed in and out can still fragment the
+        // buffers over time, see RelocateBuffer for compaction.
         //
         // 3. Streaming buffers.
         // Streaming buffers are used for streaming geometry that gets
@@ -1844,53 +2282,94 @@ public:
         if (type == dev::BufferType::UniformBuffer)
         {
             const auto reminder = bytes % mUniformBufferOffsetAlignment;
-            const auto padding = mUniformBufferOffsetAlignment - reminder;
-            VERBOSE("Grow uniform buffer size from %1 to %2 bytes for offset alignment to %3.",
-                    bytes, bytes + padding, mUniformBufferOffsetAlignment);
-            bytes += padding;
+            if (reminder)
+            {
+                const auto padding = mUniformBufferOffsetAlignment - reminder;
+                VERBOSE("Grow uniform buffer size from %1 to %2 bytes for offset alignment to %3.",
+                        bytes, bytes + padding, mUniformBufferOffsetAlignment);
+                bytes += padding;
+            }
         }
 
-        size_t capacity = 0;
-        if (usage == dev::BufferUsage::Static)
-            capacity = std::max(size_t(1024 * 1024), bytes);
-        else if (usage == dev::BufferUsage::Stream)
-            capacity = std::max(size_t(1024 * 1024), bytes);
-        else if (usage == dev::BufferUsage::Dynamic)
-            capacity = bytes;
-        else BUG("Unsupported vertex buffer type.");
-
         auto& buffers = mBuffers[BufferIndex(type)];
-        for (size_t buffer_index = 0; buffer_index < buffers.size(); ++buffer_index)
+
+        if (usage == dev::BufferUsage::Stream)
+        {
+            for (size_t buffer_index = 0; buffer_index < buffers.size(); ++buffer_index)
+            {
+                auto& buffer = buffers[buffer_index];
+                const auto available = buffer.capacity - buffer.offset;
+                if ((available >= bytes) && (buffer.usage == usage))
+                {
+                    const auto offset = buffer.offset;
+                    buffer.offset += bytes;
+                    buffer.used   += bytes;
+                    buffer.refcount++;
+                    return dev::GraphicsBuffer{buffer.name, type, buffer_index, offset, bytes};
+                }
+            }
+        }
+        else if (usage == dev::BufferUsage::Static || usage == dev::BufferUsage::Dynamic)
         {
-            auto& buffer = buffers[buffer_index];
-            const auto available = buffer.capacity - buffer.offset;
-            if ((available >= bytes) && (buffer.usage == usage))
+            const auto allocation_bytes = GetAllocationSize(bytes, type);
+
+            for (size_t buffer_index = 0; buffer_index < buffers.size(); ++buffer_index)
             {
-                const auto offset = buffer.offset;
-                buffer.offset += bytes;
-                buffer.refcount++;
+                auto& buffer = buffers[buffer_index];
+                if (buffer.usage != usage || buffer.name == 0)
+                    continue;
+                if (buffer.capacity - buffer.used < allocation_bytes)
+                    continue;
+
+                const auto range_index = FindBestFit(buffer, allocation_bytes);
+                if (range_index == buffer.free_list.size())
+                    continue;
+
+                const auto offset = AllocateRange(buffer, range_index, allocation_bytes);
                 return dev::GraphicsBuffer{buffer.name, type, buffer_index, offset, bytes};
             }
         }
+        else BUG("Unsupported vertex buffer type.");
+
+        const auto capacity = std::max(size_t(1024 * 1024), bytes);
 
         BufferObject buffer;
         buffer.usage = usage;
-        buffer.offset = bytes;
         buffer.capacity = capacity;
-        buffer.refcount = 1;
 
         GL_CALL(glGenBuffers(1, &buffer.name));
-        GL_CALL(glBindBuffer(GetEnum(type), buffer.name));
+        BindBuffer(GetEnum(type), buffer.name);
         GL_CALL(glBufferData(GetEnum(type), buffer.capacity, nullptr, GetEnum(usage)));
 
-        buffers.push_back(buffer);
-
         DEBUG("Allocated new buffer object. [bo=%1, size=%2, type=%3, type=%4]",
               buffer.name, buffer.capacity, usage, type);
 
-        const auto buffer_index = buffers.size() - 1;
-        const auto buffer_offset = 0;
-        return dev::GraphicsBuffer{buffer.name, type, buffer_index, buffer_offset, bytes};
+        // re-use the slot of a buffer object that was released
+        // when compacting the buffers. the buffer indices of the
+        // live buffers must not change.
+        size_t buffer_index = 0;
+        for (buffer_index=0; buffer_index<buffers.size(); ++buffer_index)
+        {
+            if (buffers[buffer_index].name == 0)
+                break;
+        }
+        if (buffer_index == buffers.size())
+            buffers.push_back(BufferObject {});
+
+        buffers[buffer_index] = std::move(buffer);
+
+        auto& buffer_object = buffers[buffer_index];
+        if (usage == dev::BufferUsage::Stream)
+        {
+            buffer_object.offset = bytes;
+            buffer_object.used = bytes;
+            buffer_object.refcount = 1;
+            return dev::GraphicsBuffer{buffer_object.name, type, buffer_index, 0, bytes};
+        }
+
+        buffer_object.free_list.push_back({0, capacity});
+        const auto offset = AllocateRange(buffer_object, 0, GetAllocationSize(bytes, type));
+        return dev::GraphicsBuffer{buffer_object.name, type, buffer_index, offset, bytes};
     }
 
     void FreeBuffer(const dev::GraphicsBuffer& buffer) override
@@ -1899,13 +2378,13 @@ public:
 
         ASSERT(buffer.buffer_index < buffers.size());
         auto& buffer_object = buffers[buffer.buffer_index];
+        ASSERT(buffer_object.name == buffer.handle);
         ASSERT(buffer_object.refcount > 0);
         buffer_object.refcount--;
 
         if (buffer_object.usage == dev::BufferUsage::Static || buffer_object.usage == dev::BufferUsage::Dynamic)
         {
-            if (buffer_object.refcount == 0)
-                buffer_object.offset = 0;
+            FreeRange(buffer_object, buffer.buffer_offset, GetAllocationSize(buffer.buffer_bytes, buffer.type));
         }
         if (buffer_object.usage == dev::BufferUsage::Static)
         {
@@ -1915,6 +2394,74 @@ public:
         }
     }
 
+    bool RelocateBuffer(const dev::GraphicsBuffer& buffer, dev::GraphicsBuffer* relocated) override
+    {
+        // copying the data from one buffer to another on the GPU
+        // requires glCopyBufferSubData which is ES3 / WebGL2 only.
+        const auto version = mContext->GetVersion();
+        if (version != dev::Context::Version::OpenGL_ES3 &&
+            version != dev::Context::Version::WebGL_2)
+            return false;
+
+        auto& buffers = mBuffers[BufferIndex(buffer.type)];
+
+        ASSERT(buffer.buffer_index < buffers.size());
+        auto& src = buffers[buffer.buffer_index];
+        ASSERT(src.name == buffer.handle);
+        if (src.usage == dev::BufferUsage::Stream)
+            return false;
+
+        // find the first free range with enough space that is located
+        // before the current allocation in the buffer order. Moving the
+        // live data towards the start of the buffers consolidates the
+        // free space at the end and eventually releases buffer objects
+        // that no longer contain any live data.
+        const auto allocation_bytes = GetAllocationSize(buffer.buffer_bytes, buffer.type);
+        for (size_t buffer_index = 0; buffer_index <= buffer.buffer_index; ++buffer_index)
+        {
+            auto& dst = buffers[buffer_index];
+            if (dst.usage != src.usage || dst.name == 0)
+                continue;
+
+            for (size_t range_index=0; range_index<dst.free_list.size(); ++range_index)
+            {
+                const auto& range = dst.free_list[range_index];
+                if (buffer_index == buffer.buffer_index && range.offset >= buffer.buffer_offset)
+                    break;
+                if (range.bytes < allocation_bytes)
+                    continue;
+
+                const auto offset = AllocateRange(dst, range_index, allocation_bytes);
+
+                GL_CALL(glBindBuffer(GL_COPY_READ_BUFFER, src.name));
+                GL_CALL(glBindBuffer(GL_COPY_WRITE_BUFFER, dst.name));
+                GL_CALL(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                            buffer.buffer_offset, offset, buffer.buffer_bytes));
+                mStateStats.buffer_binds_issued += 2;
+
+                // careful, the relocated buffer could alias the old buffer.
+                const dev::GraphicsBuffer old = buffer;
+                const dev::GraphicsBuffer ret {dst.name, old.type, buffer_index, offset, old.buffer_bytes};
+
+                FreeBuffer(old);
+                mBufferRelocations++;
+                mBufferRelocatedBytes += old.buffer_bytes;
+                *relocated = ret;
+
+                if (src.refcount == 0)
+                {
+                    DEBUG("Released empty buffer object. [bo=%1, size=%2, usage=%3, type=%4]",
+                          src.name, src.capacity, src.usage, old.type);
+                    InvalidateBufferBinding(src.name);
+                    GL_CALL(glDeleteBuffers(1, &src.name));
+                    src = BufferObject {};
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
     void UploadBuffer(const dev::GraphicsBuffer& buffer, const void* data, size_t bytes) override
     {
         auto& buffers = mBuffers[BufferIndex(buffer.type)];
@@ -1924,12 +2471,12 @@ public:
         ASSERT(bytes <= buffer.buffer_bytes);
         ASSERT(buffer.buffer_offset + bytes <= buffer_object.capacity);
 
-        GL_CALL(glBindBuffer(GetEnum(buffer.type), buffer_object.name));
+        BindBuffer(GetEnum(buffer.type), buffer_object.name);
         GL_CALL(glBufferSubData(GetEnum(buffer.type), buffer.buffer_offset, bytes, data));
 
         if (buffer_object.usage == dev::BufferUsage::Static)
         {
-            const int percent_full = 100 * (double) buffer_object.offset / (double) buffer_object.capacity;
+            const int percent_full = 100 * (double) buffer_object.used / (double) buffer_object.capacity;
             DEBUG("Uploaded buffer data. [bo=%1, bytes=%2, offset=%3, full=%4%, usage=%5, type=%6]",
                   buffer_object.name, bytes, buffer.buffer_offset, percent_full, buffer_object.usage, buffer.type);
         }
@@ -1949,7 +2496,7 @@ public:
         // into the contents of the VBO.
         const auto* base_ptr = reinterpret_cast<const uint8_t*>(buffer.buffer_offset);
 
-        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, buffer.handle));
+        BindBuffer(GL_ARRAY_BUFFER, buffer.handle);
         for (const auto& attr: vertex_layout.attributes)
         {
             const GLint location = mGL.glGetAttribLocation(program.handle, attr.name.c_str());
@@ -1975,22 +2522,29 @@ public:
     {
         ASSERT(buffer.IsValid());
         ASSERT(buffer.type == dev::BufferType::IndexBuffer);
-        GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer.handle));
+        BindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer.handle);
     }
 
     void SetProgramState(const dev::GraphicsProgram& program, const dev::ProgramState& state) const override
     {
-        GL_CALL(glUseProgram(program.handle));
+        UseProgram(program.handle);
+
+        auto& cache = mUniformCache[program.handle];
         // flush pending uniforms onto the GPU program object
         for (size_t i = 0; i < state.uniforms.size(); ++i)
         {
             const auto* uniform_setting = state.uniforms[i];
-            const auto& uniform_binding = GetUniformFromCache(program, uniform_setting->name);
-            if (uniform_binding.location == -1)
+            auto* uniform_binding = FindUniform(cache, uniform_setting->name);
+            if (uniform_binding == nullptr)
                 continue;
 
             const auto& value = uniform_setting->value;
-            const auto location = uniform_binding.location;
+            const auto location = uniform_binding->location;
+
+            // the program object retains the uniform values so if the
+            // value is the same as the last value set there's nothing to do.
+            if (!TestUniformValue(*uniform_binding, value))
+                continue;
 
             // if the glUnifromXYZ gives GL_INVALID_OPERATION a possible
             // cause is using wrong API for the uniform. for example
@@ -2026,7 +2580,7 @@ public:
                 // place to convert to linear and will catch all uses without
                 // breaking the higher level APIs
                 // the cost of the sRGB conversion should be mitigated due to
-                // the hash check to compare to the previous value.
+                // the check to compare to the previous value.
                 const auto& linear = sRGB_Decode(*ptr);
                 GL_CALL(glUniform4f(location, linear.Red(), linear.Green(), linear.Blue(), linear.Alpha()));
             } else if (const auto* ptr = std::get_if<glm::mat2>(&value))
@@ -2047,7 +2601,9 @@ public:
             GL_CALL(glLineWidth(state.line_width));
 
             mRasterState.line_width = state.line_width;
+            mStateStats.render_state_issued++;
         }
+        else mStateStats.render_state_skipped++;
 
         SetState(state.winding_order);
         SetState(state.blending, state.premulalpha);
@@ -2065,8 +2621,8 @@ public:
         if (uniform_block.location == -1)
             return;
 
-        GL_CALL(glUseProgram(program.handle));
-        GL_CALL(glBindBuffer(GL_UNIFORM_BUFFER, buffer.handle));
+        UseProgram(program.handle);
+        BindBuffer(GL_UNIFORM_BUFFER, buffer.handle);
         GL_CALL(glUniformBlockBinding(program.handle, uniform_block.location, binding_index));
         GL_CALL(glBindBufferRange(GL_UNIFORM_BUFFER, binding_index, buffer.handle, buffer.buffer_offset,
                                   buffer.buffer_bytes));
@@ -2108,7 +2664,9 @@ public:
                                state.viewport.GetWidth(), state.viewport.GetHeight()));
 
             mViewportState.viewport = state.viewport;
+            mStateStats.render_state_issued++;
         }
+        else mStateStats.render_state_skipped++;
 
         if (mViewportState.scissor != state.scissor)
         {
@@ -2124,7 +2682,9 @@ public:
             }
 
             mViewportState.scissor = state.scissor;
+            mStateStats.render_state_issued++;
         }
+        else mStateStats.render_state_skipped++;
     }
 
     void SetColorDepthStencilState(const dev::ColorDepthStencilState& state) const override
@@ -2148,7 +2708,9 @@ public:
             }
 
             mColorDepthStencilState.stencil_func = state.stencil_func;
+            mStateStats.render_state_issued++;
         }
+        else mStateStats.render_state_skipped++;
 
         if (mColorDepthStencilState.stencil_func != dev::StencilFunc::Disabled)
         {
@@ -2163,7 +2725,9 @@ public:
                 mColorDepthStencilState.stencil_func = state.stencil_func;
                 mColorDepthStencilState.stencil_ref = state.stencil_ref;
                 mColorDepthStencilState.stencil_mask = state.stencil_mask;
+                mStateStats.render_state_issued++;
             }
+            else mStateStats.render_state_skipped++;
 
             if (mColorDepthStencilState.stencil_fail != state.stencil_fail ||
                 mColorDepthStencilState.stencil_dfail != state.stencil_dfail ||
@@ -2178,7 +2742,9 @@ public:
                 mColorDepthStencilState.stencil_fail = state.stencil_fail;
                 mColorDepthStencilState.stencil_dfail = state.stencil_dfail;
                 mColorDepthStencilState.stencil_dpass = state.stencil_dpass;
+                mStateStats.render_state_issued++;
             }
+            else mStateStats.render_state_skipped++;
         }
 
         if (mColorDepthStencilState.bWriteColor != state.bWriteColor)
@@ -2194,7 +2760,9 @@ public:
             }
 
             mColorDepthStencilState.bWriteColor = state.bWriteColor;
+            mStateStats.render_state_issued++;
         }
+        else mStateStats.render_state_skipped++;
     }
 
     void DrawElementsInstanced(dev::DrawType draw_primitive, dev::IndexType index_type,
@@ -2354,17 +2922,17 @@ public:
             if (buffer.usage == dev::BufferUsage::Static)
             {
                 stats->static_vbo_mem_alloc += buffer.capacity;
-                stats->static_vbo_mem_use += buffer.offset;
+                stats->static_vbo_mem_use += buffer.used;
             }
             else if (buffer.usage == dev::BufferUsage::Dynamic)
             {
                 stats->dynamic_vbo_mem_alloc += buffer.capacity;
-                stats->dynamic_vbo_mem_use += buffer.offset;
+                stats->dynamic_vbo_mem_use += buffer.used;
             }
             else if (buffer.usage == dev::BufferUsage::Stream)
             {
                 stats->streaming_vbo_mem_alloc += buffer.capacity;
-                stats->streaming_vbo_mem_use += buffer.offset;
+                stats->streaming_vbo_mem_use += buffer.used;
             }
         }
         for (const auto& buffer: mBuffers[1])
@@ -2372,17 +2940,17 @@ public:
             if (buffer.usage == dev::BufferUsage::Static)
             {
                 stats->static_ibo_mem_alloc += buffer.capacity;
-                stats->static_ibo_mem_use += buffer.offset;
+                stats->static_ibo_mem_use += buffer.used;
             }
             else if (buffer.usage == dev::BufferUsage::Dynamic)
             {
                 stats->dynamic_ibo_mem_alloc += buffer.capacity;
-                stats->dynamic_ibo_mem_use += buffer.offset;
+                stats->dynamic_ibo_mem_use += buffer.used;
             }
             else if (buffer.usage == dev::BufferUsage::Stream)
             {
                 stats->streaming_ibo_mem_alloc += buffer.capacity;
-                stats->streaming_ibo_mem_use += buffer.offset;
+                stats->streaming_ibo_mem_use += buffer.used;
             }
         }
         for (const auto& buffer: mBuffers[2])
@@ -2390,19 +2958,42 @@ public:
             if (buffer.usage == dev::BufferUsage::Static)
             {
                 stats->static_ubo_mem_alloc += buffer.capacity;
-                stats->static_ubo_mem_use += buffer.offset;
+                stats->static_ubo_mem_use += buffer.used;
             }
             else if (buffer.usage == dev::BufferUsage::Dynamic)
             {
                 stats->dynamic_ubo_mem_alloc += buffer.capacity;
-                stats->dynamic_ubo_mem_use += buffer.offset;
+                stats->dynamic_ubo_mem_use += buffer.used;
             }
             else if (buffer.usage == dev::BufferUsage::Stream)
             {
                 stats->streaming_ubo_mem_alloc += buffer.capacity;
-                stats->streaming_ubo_mem_use += buffer.offset;
+                stats->streaming_ubo_mem_use += buffer.used;
             }
         }
+        for (const auto& buffers : mBuffers)
+        {
+            for (const auto& buffer : buffers)
+            {
+                if (buffer.usage == dev::BufferUsage::Stream || buffer.name == 0)
+                    continue;
+
+                stats->buffer_objects++;
+                for (const auto& range : buffer.free_list)
+                {
+                    stats->buffer_free_mem += range.bytes;
+                    stats->buffer_free_ranges++;
+                    stats->buffer_largest_free_range = std::max(stats->buffer_largest_free_range, (std::uint32_t)range.bytes);
+                }
+            }
+        }
+        stats->buffer_relocations = mBufferRelocations;
+        stats->buffer_relocated_bytes = mBufferRelocatedBytes;
+    }
+
+    void GetStateStats(dev::GraphicsDeviceStateStats* stats) const override
+    {
+        *stats = mStateStats;
     }
 
     void GetDeviceCaps(dev::GraphicsDeviceCaps* caps) const override
@@ -2416,6 +3007,7 @@ public:
         caps->num_texture_units = num_texture_units;
         caps->max_fbo_height = max_fbo_size;
         caps->max_fbo_width = max_fbo_size;
+        caps->uniform_buffer_offset_alignment = mUniformBufferOffsetAlignment;
 
         const auto version = mContext->GetVersion();
         if (version == dev::Context::Version::WebGL_2 ||
@@ -2430,10 +3022,18 @@ public:
             caps->instanced_rendering = false;
             caps->multiple_color_attachments = false;
         }
+        // ETC2 is a core feature in GL ES3 but WebGL2 requires the extension.
+        caps->texture_compression_bc      = mExtensions.EXT_texture_compression_s3tc;
+        caps->texture_compression_bc_srgb = mExtensions.EXT_texture_compression_s3tc_srgb;
+        caps->texture_compression_etc2    = mExtensions.OES_compressed_ETC2 ||
+                                            version == dev::Context::Version::OpenGL_ES3;
     }
 
     void BeginFrame() override
     {
+        ResetBindingState();
+        mStateStats = dev::GraphicsDeviceStateStats {};
+
         // trying to do so-called "buffer streaming" by "orphaning" the streaming
         // vertex buffers. this is achieved by re-specifying the contents of the
         // buffer by using nullptr data upload.
@@ -2444,9 +3044,10 @@ public:
         {
             if (buff.usage == dev::BufferUsage::Stream)
             {
-                GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, buff.name));
+                BindBuffer(GL_ARRAY_BUFFER, buff.name);
                 GL_CALL(glBufferData(GL_ARRAY_BUFFER, buff.capacity, nullptr, GL_STREAM_DRAW));
                 buff.offset = 0;
+                buff.used = 0;
             }
         }
         // index buffers
@@ -2454,9 +3055,10 @@ public:
         {
             if (buff.usage == dev::BufferUsage::Stream)
             {
-                GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buff.name));
+                BindBuffer(GL_ELEMENT_ARRAY_BUFFER, buff.name);
                 GL_CALL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, buff.capacity, nullptr, GL_STREAM_DRAW));
                 buff.offset = 0;
+                buff.used = 0;
             }
         }
         // uniform buffers
@@ -2464,9 +3066,10 @@ public:
         {
             if (buff.usage == dev::BufferUsage::Stream)
             {
-                GL_CALL(glBindBuffer(GL_UNIFORM_BUFFER, buff.name));
+                BindBuffer(GL_UNIFORM_BUFFER, buff.name);
                 GL_CALL(glBufferData(GL_UNIFORM_BUFFER, buff.capacity, nullptr, GL_STREAM_DRAW));
                 buff.offset = 0;
+                buff.used = 0;
             }
         }
     }
@@ -118,14 +118,52 @@ namespace dev
         std::uint32_t static_ubo_mem_alloc    = 0;
         std::uint32_t streaming_ubo_mem_use   = 0;
         std::uint32_t streaming_ubo_mem_alloc = 0;
+        // sub-allocation of the static and dynamic buffer objects.
+        // the fragmentation of the free memory can be estimated with
+        // 1.0 - largest_free_range / free_mem
+        std::uint32_t buffer_objects            = 0;
+        std::uint32_t buffer_free_mem           = 0;
+        std::uint32_t buffer_free_ranges        = 0;
+        std::uint32_t buffer_largest_free_range = 0;
+        // total number of buffer ranges (and their bytes) that have
+        // been moved in order to compact the buffers.
+        std::uint32_t buffer_relocations        = 0;
+        std::uint32_t buffer_relocated_bytes    = 0;
+    };
+
+    // Counters for the GL state setting calls that the device has
+    // either issued or skipped because the shadow copy of the state
+    // indicated that the call would not have changed anything.
+    // The counters are reset on every BeginFrame.
+    struct GraphicsDeviceStateStats {
+        // glUseProgram
+        std::uint32_t program_binds_issued   = 0;
+        std::uint32_t program_binds_skipped  = 0;
+        // glBindBuffer
+        std::uint32_t buffer_binds_issued    = 0;
+        std::uint32_t buffer_binds_skipped   = 0;
+        // glActiveTexture + glBindTexture
+        std::uint32_t texture_binds_issued   = 0;
+        std::uint32_t texture_binds_skipped  = 0;
+        // glUniformXYZ
+        std::uint32_t uniform_sets_issued    = 0;
+        std::uint32_t uniform_sets_skipped   = 0;
+        // blend, depth, stencil, culling, viewport etc. state
+        std::uint32_t render_state_issued    = 0;
+        std::uint32_t render_state_skipped   = 0;
     };
 
     struct GraphicsDeviceCaps {
         unsigned num_texture_units = 0;
         unsigned max_fbo_width = 0;
         unsigned max_fbo_height = 0;
+        unsigned uniform_buffer_offset_alignment = 0;
         bool instanced_rendering = false;
         bool multiple_color_attachments = false;
+        // block compressed texture format support.
+        bool texture_compression_bc = false;
+        bool texture_compression_bc_srgb = false;
+        bool texture_compression_etc2 = false;
     };
 
 } // dev
@@ -27,6 +27,7 @@
 
 #include <string>
 #include <variant>
+#include <cstdint>
 
 #include "base/color4f.h"
 
@@ -46,7 +47,46 @@ namespace dev
             glm::mat2,
             glm::mat3,
             glm::mat4>;
-    using UniformKeyType = std::string;
+
+    // Identify uniforms by the hash of the uniform name instead of
+    // the name string so that setting and applying uniform values
+    // never needs to deal with strings. The hashing is constexpr
+    // so that string literal uniform names can be hashed at compile
+    // time, for example  constexpr UniformName kFoo("kFoo");
+    class UniformName
+    {
+    public:
+        constexpr UniformName() noexcept = default;
+        constexpr UniformName(const char* name) noexcept
+          : mHash(Hash(name))
+        {}
+        UniformName(const std::string& name) noexcept
+          : mHash(Hash(name.c_str()))
+        {}
+        constexpr std::uint32_t GetHash() const noexcept
+        { return mHash; }
+
+        constexpr bool operator==(const UniformName& other) const noexcept
+        { return mHash == other.mHash; }
+        constexpr bool operator!=(const UniformName& other) const noexcept
+        { return mHash != other.mHash; }
+
+        // 32bit FNV-1a
+        static constexpr std::uint32_t Hash(const char* str) noexcept
+        {
+            std::uint32_t hash = 2166136261u;
+            for (; *str; ++str)
+            {
+                hash ^= static_cast<unsigned char>(*str);
+                hash *= 16777619u;
+            }
+            return hash;
+        }
+    private:
+        std::uint32_t mHash = 0;
+    };
+
+    using UniformKeyType = UniformName;
 
     struct Uniform {
         UniformKeyType name;
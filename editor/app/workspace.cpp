@@ -44,6 +44,7 @@
 #include <algorithm>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include <set>
 #include <map>
 #include <stack>
@@ -57,6 +58,7 @@
 #include "graphics/color4f.h"
 #include "graphics/simple_shape.h"
 #include "graphics/texture_file_source.h"
+#include "graphics/texture_container.h"
 #include "graphics/image.h"
 #include "graphics/packer.h"
 #include "graphics/material_instance.h"
@@ -99,7 +101,7 @@ public:
     GfxTexturePacker(const QString& outdir,
                      unsigned max_width, unsigned max_height,
                      unsigned pack_width, unsigned pack_height, unsigned padding,
-                     bool resize_large, bool pack_small)
+                     bool resize_large, bool pack_small, bool bake)
         : kOutDir(outdir)
         , kMaxTextureWidth(max_width)
         , kMaxTextureHeight(max_height)
@@ -108,6 +110,7 @@ public:
         , kTexturePadding(padding)
         , kResizeLargeTextures(resize_large)
         , kPackSmallTextures(pack_small)
+        , kBakeTextures(bake)
     {}
    virtual ~GfxTexturePacker()
     {
@@ -132,6 +135,14 @@ public:
             mTextureMap[instance].allowed_to_combine = on_off;
         else if (flags == gfx::TexturePacker::TextureFlags::AllowedToResize)
             mTextureMap[instance].allowed_to_resize = on_off;
+        else if (flags == gfx::TexturePacker::TextureFlags::sRGB)
+            mTextureMap[instance].srgb = on_off;
+        else if (flags == gfx::TexturePacker::TextureFlags::PremulAlpha)
+            mTextureMap[instance].premul_alpha = on_off;
+        else if (flags == gfx::TexturePacker::TextureFlags::EdgeEffect)
+            mTextureMap[instance].edge_effect = on_off;
+        else if (flags == gfx::TexturePacker::TextureFlags::BlurEffect)
+            mTextureMap[instance].blur_effect = on_off;
         else BUG("Unhandled texture packing flag.");
     }
     std::string GetPackedTextureId(ObjectHandle instance) const override
@@ -528,9 +539,120 @@ public:
                                   relocation.width * original_rect_width,
                                   relocation.height * original_rect_height);
         }
+
+        if (kBakeTextures)
+            BakeTextures(progress);
     }
     unsigned GetNumErrors() const
     { return mNumErrors; }
+private:
+    // Bake the packed texture files into texture containers. The runtime
+    // work (alpha pre-multiplication, texture effects and mipmap generation)
+    // is done here instead and the result is written into a container file.
+    // Every unique combination of file and processing flags gets its own
+    // container since the same file can be used by several texture sources.
+    // Note that when textures have been combined into an atlas the effects
+    // are applied on the whole atlas which is the same as what would happen
+    // at runtime.
+    void BakeTextures(const TexturePackingProgressCallback& progress)
+    {
+        std::unordered_map<std::string, std::string> baked_files;
+        std::unordered_set<QString> source_files;
+
+        int cur_step = 0;
+        int max_step = static_cast<int>(mTextureMap.size());
+        for (auto& pair : mTextureMap)
+        {
+            progress("Baking textures...", cur_step++, max_step);
+
+            TextureSource& tex = pair.second;
+            if (tex.file.empty())
+                continue;
+
+            // only files in the package can be baked.
+            if (!base::StartsWith(tex.file, "pck://"))
+                continue;
+
+            base::bitflag<gfx::TextureFileSource::Effect> effects;
+            effects.set(gfx::TextureFileSource::Effect::Edges, tex.edge_effect);
+            effects.set(gfx::TextureFileSource::Effect::Blur, tex.blur_effect);
+
+            const auto& key = base::FormatString("%1/%2/%3/%4", tex.file, tex.srgb, tex.premul_alpha, effects.value());
+            if (const auto* baked = base::SafeFind(baked_files, key))
+            {
+                tex.file = *baked;
+                continue;
+            }
+
+            const QString& src_file = app::JoinPath(kOutDir, app::FromUtf8(tex.file.substr(6)));
+            std::vector<char> img_data;
+            gfx::Image img;
+            if (!app::ReadBinaryFile(src_file, img_data) || !img.Load(&img_data[0], img_data.size()))
+            {
+                ERROR("Failed to load texture file for baking. [file='%1']", src_file);
+                mNumErrors++;
+                continue;
+            }
+
+            std::unique_ptr<gfx::IBitmap> bitmap;
+            if (img.GetDepthBits() == 8)
+                bitmap = std::make_unique<gfx::AlphaMask>(img.AsBitmap<gfx::Pixel_A>());
+            else if (img.GetDepthBits() == 24)
+                bitmap = std::make_unique<gfx::RgbBitmap>(img.AsBitmap<gfx::Pixel_RGB>());
+            else if (img.GetDepthBits() == 32)
+                bitmap = std::make_unique<gfx::RgbaBitmap>(img.AsBitmap<gfx::Pixel_RGBA>());
+            else
+            {
+                ERROR("Unsupported texture bit depth for baking. [file='%1', depth=%2]", src_file, img.GetDepthBits());
+                mNumErrors++;
+                continue;
+            }
+
+            const auto colorspace = tex.srgb ? gfx::TextureFileSource::ColorSpace::sRGB
+                                             : gfx::TextureFileSource::ColorSpace::Linear;
+            gfx::TextureContainer container;
+            if (!gfx::TextureFileSource::BakeData(*bitmap, colorspace, tex.premul_alpha, effects, &container))
+            {
+                ERROR("Failed to bake texture. [file='%1']", src_file);
+                mNumErrors++;
+                continue;
+            }
+
+            const QFileInfo info(src_file);
+            const QString& name = QString("%1_%2%3").arg(info.completeBaseName())
+                                                    .arg(baked_files.size())
+                                                    .arg(gfx::TextureContainer::FileExtension);
+            const QString& dst_file = app::JoinPath(app::JoinPath(kOutDir, "textures"), name);
+            const auto& data = container.ToMemory();
+            QFile file(dst_file);
+            if (!file.open(QIODevice::WriteOnly) ||
+                file.write((const char*)data.data(), data.size()) != (qint64)data.size())
+            {
+                ERROR("Failed to write baked texture file. [file='%1', error='%2']", dst_file, file.errorString());
+                mNumErrors++;
+                continue;
+            }
+            DEBUG("Baked texture file. [src='%1', dst='%2', levels=%3]", src_file, dst_file, container.GetLevelCount());
+
+            const auto& uri = app::toString("pck://textures/%1", name);
+            baked_files[key] = uri;
+            source_files.insert(src_file);
+            tex.file = uri;
+        }
+
+        // the original files are no longer referenced if every texture
+        // using them has been baked.
+        for (const auto& pair : mTextureMap)
+        {
+            const auto& file = pair.second.file;
+            if (base::StartsWith(file, "pck://") && !base::EndsWith(file, gfx::TextureContainer::FileExtension))
+                source_files.erase(app::JoinPath(kOutDir, app::FromUtf8(file.substr(6))));
+        }
+        for (const auto& file : source_files)
+        {
+            QFile::remove(file);
+        }
+    }
 private:
     const QString kOutDir;
     const unsigned kMaxTextureHeight = 0;
@@ -540,6 +662,7 @@ private:
     const unsigned kTexturePadding = 0;
     const bool kResizeLargeTextures = true;
     const bool kPackSmallTextures = true;
+    const bool kBakeTextures = false;
     unsigned mNumErrors = 0;
 
     struct TextureSource {
@@ -548,6 +671,10 @@ private:
         bool can_be_combined = true;
         bool allowed_to_resize = true;
         bool allowed_to_combine = true;
+        bool srgb = true;
+        bool premul_alpha = false;
+        bool edge_effect = false;
+        bool blur_effect = false;
     };
     std::unordered_map<ObjectHandle, TextureSource> mTextureMap;
     std::vector<QString> mTempFiles;
@@ -2524,7 +2651,7 @@ bool Workspace::BuildReleasePackage(const std::vector<const Resource*>& resource
 
     DEBUG("Max texture size. [width=%1, height=%2]", options.max_texture_width, options.max_texture_height);
     DEBUG("Pack size. [width=%1, height=%2]", options.texture_pack_width, options.texture_pack_height);
-    DEBUG("Pack flags. [resize=%1, combine=%2]", options.resize_textures, options.combine_textures);
+    DEBUG("Pack flags. [resize=%1, combine=%2, bake=%3]", options.resize_textures, options.combine_textures, options.bake_textures);
 
     GfxTexturePacker texture_packer(outdir,
         options.max_texture_width,
@@ -2533,7 +2660,8 @@ bool Workspace::BuildReleasePackage(const std::vector<const Resource*>& resource
         options.texture_pack_height,
         options.texture_padding,
         options.resize_textures,
-        options.combine_textures);
+        options.combine_textures,
+        options.bake_textures);
 
     // collect the resources in the packer.
     for (int i=0; i<mutable_copies.size(); ++i)
@@ -469,6 +469,11 @@ namespace app
             // on the filtering setting on the sampler. the padding pixels
             // are filtered from the source texture.
             unsigned texture_padding = 0;
+            // Bake the texture data offline into texture containers with
+            // the alpha pre-multiplication and the texture effects applied
+            // and with complete mip chains. This removes the work from the
+            // runtime texture loading.
+            bool bake_textures = false;
             // Copy/deploy the native game engine files (executables and libraries)
             bool copy_native_files = false;
             // Copy/deploy the html5/wasm game engine files (wasm and js)
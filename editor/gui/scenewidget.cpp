@@ -2574,7 +2574,8 @@ void SceneWidget::DisplaySceneProperties()
     mUI.spinBottomBoundary->ClearValue();
 
     const auto index = mState.scene->GetDynamicSpatialIndex();
-    if (index == game::SceneClass::SpatialIndex::Disabled)
+    if (index == game::SceneClass::SpatialIndex::Disabled ||
+        index == game::SceneClass::SpatialIndex::AABBTree)
     {
         SetEnabled(mUI.spQuadMaxItems,  false);
         SetEnabled(mUI.spQuadMaxLevels, false);
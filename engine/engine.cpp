@@ -49,6 +49,7 @@
 #include "graphics/resource.h"
 #include "graphics/material.h"
 #include "graphics/material_instance.h"
+#include "graphics/text_buffer.h"
 #include "graphics/utility.h"
 #include "graphics/simple_shape.h"
 #include "graphics/texture_bitmap_buffer_source.h"
@@ -96,6 +97,8 @@ struct RenderState {
     engine::GameRuntime::Camera camera;
     base::Color4f clear_color;
     bool enable_bloom = false;
+    bool sort_packets = false;
+    bool batch_sprites = false;
     std::optional<engine::Engine::RendererConfig> render_config;
 };
 
@@ -155,6 +158,8 @@ public:
         mDevice = gfx::CreateDevice(device->GetSharedGraphicsDevice());
         mDevice->SetDefaultTextureFilter(conf.default_min_filter);
         mDevice->SetDefaultTextureFilter(conf.default_mag_filter);
+        mDevice->EnableTextureStreaming(conf.enable_texture_streaming);
+        mDevice->SetTextureBudget(std::size_t(conf.texture_memory_budget) * 1024 * 1024);
 
 #if defined(ENGINE_ENABLE_LUA_SCRIPTING)
         mLuaRuntime = std::make_unique<engine::LuaRuntime>("lua", init.game_script, mGameHome, init.application_name);
@@ -186,9 +191,14 @@ public:
         mUIEngine.SetLoader(mEngineDataLoader);
         mUIEngine.SetSurfaceSize(float(init.surface_width), float(init.surface_height));
         mUIEngine.SetEditingMode(init.editing_mode);
+        mUIEngine.SetGlyphAtlasText(conf.enable_glyph_atlas_text || conf.enable_distance_field_text);
+        mUIEngine.SetDistanceFieldText(conf.enable_distance_field_text);
 
         mRenderer.SetClassLibrary(mClasslib);
         mRenderer.SetEditingMode(init.editing_mode);
+        mRenderer.SetGlyphAtlasText(conf.enable_glyph_atlas_text || conf.enable_distance_field_text);
+        mRenderer.SetDistanceFieldText(conf.enable_distance_field_text);
+        mRenderer.SetParallelParticleUpdates(conf.enable_parallel_particle_updates);
         mRenderer.SetName("Engine");
 
         mPhysics.SetClassLibrary(mClasslib);
@@ -207,6 +217,8 @@ public:
         mFlags.set(Flags::ShowDebugs,      true);
         mFlags.set(Flags::EnableBloom,     true);
         mFlags.set(Flags::EnablePhysics,   true);
+        mFlags.set(Flags::SortDrawPackets, conf.sort_draw_packets);
+        mFlags.set(Flags::BatchSprites,    conf.enable_sprite_batching);
         mFlags.set(Flags::ShowMouseCursor, conf.mouse_cursor.show);
         mFlags.set(Flags::EnablePhysics, conf.physics.enabled);
 
@@ -603,6 +615,8 @@ public:
         gfx::SetResourceLoader(env.graphics_loader);
         DEBUG("Game install directory: '%1'.", env.directory);
         DEBUG("Game home: '%1'.", env.game_home);
+        if (!env.game_home.empty())
+            gfx::TextBuffer::SetDistanceFieldCacheDirectory(env.game_home);
         DEBUG("User home: '%1'.", env.user_home);
     }
 
@@ -653,6 +667,8 @@ public:
             state.surface_height    = mSurfaceHeight;
             state.clear_color       = mClearColor;
             state.enable_bloom      = mFlags.test(DetonatorEngine::Flags::EnableBloom);
+            state.sort_packets      = mFlags.test(DetonatorEngine::Flags::SortDrawPackets);
+            state.batch_sprites     = mFlags.test(DetonatorEngine::Flags::BatchSprites);
             state.render_config     = mRendererConfig;
 
             EngineRuntime runtime;
@@ -1060,6 +1076,23 @@ public:
         stats->dynamic_vbo_mem_use     = rs.dynamic_vbo_mem_use;
         stats->streaming_vbo_mem_alloc = rs.streaming_vbo_mem_alloc;
         stats->streaming_vbo_mem_use   = rs.streaming_vbo_mem_use;
+        stats->buffer_free_mem         = rs.buffer_free_mem;
+        if (rs.buffer_free_mem)
+            stats->buffer_fragmentation = 1.0f - (float)rs.buffer_largest_free_range / (float)rs.buffer_free_mem;
+
+        const auto& frame = mRenderer.GetFrameStats();
+        stats->num_culled_paint_nodes    = frame.num_culled_paint_nodes;
+        stats->num_submitted_paint_nodes = frame.num_submitted_paint_nodes;
+        stats->num_draw_calls            = frame.num_draw_calls;
+        stats->num_program_switches      = frame.num_program_switches;
+        stats->num_texture_switches      = frame.num_texture_switches;
+        stats->num_buffer_switches       = frame.num_buffer_switches;
+
+        gfx::Device::TextureStats ts;
+        mDevice->GetTextureStats(&ts);
+        stats->texture_mem_use       = ts.resident_bytes;
+        stats->texture_mem_budget    = ts.budget;
+        stats->num_texture_evictions = ts.evicted_textures;
         return true;
     }
     void TakeScreenshot(const std::string& filename) const override
@@ -1781,6 +1814,9 @@ private:
         settings.camera.position    = game_camera.position;
         settings.camera.rotation    = 0.0f;
         settings.camera.ppa         = engine::ComputePerspectiveProjection(game_view);
+        settings.sort_mode          = state.sort_packets ? engine::Renderer::PacketSortMode::SortKey
+                                                         : engine::Renderer::PacketSortMode::Submission;
+        settings.enable_sprite_batching = state.batch_sprites;
 
         if (auto* bloom = runtime.scene->GetBloom(); bloom && state.enable_bloom)
         {
@@ -2100,7 +2136,11 @@ private:
         // flag to control physics world creation.
         EnablePhysics,
         // master flag to control bloom PP in the renderer, controlled by the game.
-        EnableBloom
+        EnableBloom,
+        // flag to control sorting the draw packets for minimal GPU state changes.
+        SortDrawPackets,
+        // flag to control combining compatible sprite draws into batches.
+        BatchSprites
     };
     // list of current debug print messages that
     // get printed to the display.
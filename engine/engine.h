@@ -286,6 +286,34 @@ namespace engine
             } audio;
             // the default clear color.
             Color4f clear_color = {0.2f, 0.3f, 0.4f, 1.0f};
+            // Sort the draw packets inside each render layer in order to
+            // minimize the GPU program and texture changes. The order of
+            // opaque draws within the same render layer will change.
+            bool sort_draw_packets = false;
+            // Combine consecutive sprite draws (solid rectangles) that share
+            // the same material state into a single draw. Works best when
+            // combined with sort_draw_packets.
+            bool enable_sprite_batching = false;
+            // Load texture files asynchronously on the thread pool and
+            // upload them within a per frame budget. Placeholder textures
+            // are used until the textures are ready.
+            bool enable_texture_streaming = false;
+            // The texture memory budget in megabytes. When the textures
+            // exceed the budget the least recently used textures are evicted
+            // and re-loaded when needed again. 0 for no budget.
+            unsigned texture_memory_budget = 0;
+            // Draw the TrueType/OpenType font texts as glyph quads sampling
+            // a shared glyph atlas instead of rasterizing every text into
+            // its own texture whenever the text changes.
+            bool enable_glyph_atlas_text = false;
+            // Use signed distance field glyphs for the glyph atlas text.
+            // The text then stays sharp when scaled (for example when the
+            // camera zooms) without re-rasterizing it. Implies the glyph
+            // atlas text.
+            bool enable_distance_field_text = false;
+            // Update the particle engines in parallel on the thread pool
+            // instead of serially on a single background worker thread.
+            bool enable_parallel_particle_updates = true;
         };
 
         // Called once on application startup. The arguments
@@ -421,6 +449,23 @@ namespace engine
             std::size_t static_vbo_mem_alloc  = 0;
             std::size_t streaming_vbo_mem_use = 0;
             std::size_t streaming_vbo_mem_alloc = 0;
+            // free memory inside the static and dynamic buffer objects
+            // and the fragmentation of that memory [0.0, 1.0].
+            std::size_t buffer_free_mem = 0;
+            float buffer_fragmentation  = 0.0f;
+            // paint nodes culled/submitted for rendering in the last frame.
+            std::size_t num_culled_paint_nodes    = 0;
+            std::size_t num_submitted_paint_nodes = 0;
+            // draw calls and GPU state switches in the last drawn frame.
+            std::size_t num_draw_calls       = 0;
+            std::size_t num_program_switches = 0;
+            std::size_t num_texture_switches = 0;
+            std::size_t num_buffer_switches  = 0;
+            // texture memory use, budget and the number of textures
+            // evicted so far in order to stay within the budget.
+            std::size_t texture_mem_use    = 0;
+            std::size_t texture_mem_budget = 0;
+            std::size_t num_texture_evictions = 0;
         };
         // Get the current statistics collected by the app implementation.
         // Returns false if not available.
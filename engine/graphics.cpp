@@ -16,15 +16,21 @@
 
 #include "config.h"
 
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
 #include "base/assert.h"
 #include "base/logging.h"
 #include "base/trace.h"
+#include "base/hash.h"
 #include "game/enum.h"
 #include "engine/graphics.h"
 #include "graphics/framebuffer.h"
 #include "graphics/device.h"
 #include "graphics/device_algo.h"
 #include "graphics/texture.h"
+#include "graphics/material_class.h"
 #include "graphics/program.h"
 #include "graphics/renderpass.h"
 #include "graphics/shader_program.h"
@@ -34,6 +40,7 @@
 #include "graphics/drawcmd.h"
 #include "graphics/generic_shader_program.h"
 #include "graphics/particle_engine.h"
+#include "graphics/spritebatch.h"
 
 namespace engine
 {
@@ -45,6 +52,8 @@ LowLevelRenderer::LowLevelRenderer(const std::string* name, gfx::Device& device)
 
 void LowLevelRenderer::DrawPackets(DrawPacketList& packets, LightList& lights) const
 {
+    mDrawStats = DrawStats {};
+
     if (mSettings.enable_bloom)
     {
         DrawFramebuffer(packets, lights);
@@ -320,6 +329,21 @@ void LowLevelRenderer::Draw(DrawPacketList& packets, LightList& lights,
     }
     TRACE_LEAVE(CreateDrawCmd);
 
+    if (mSettings.sort_mode == PacketSortMode::SortKey)
+    {
+        TRACE_ENTER(SortDrawCmd);
+        for (auto& scene_layer : layers)
+        {
+            for (auto& entity_layer : scene_layer)
+            {
+                SortDrawCommands(entity_layer.draw_color_list);
+                SortDrawCommands(entity_layer.mask_cover_list);
+                SortDrawCommands(entity_layer.mask_expose_list);
+            }
+        }
+        TRACE_LEAVE(SortDrawCmd);
+    }
+
     gfx::Painter::RenderPassState mask_cover_state;
     mask_cover_state.render_pass = gfx::RenderPass::StencilPass;
     mask_cover_state.cds.bWriteColor   = false;
@@ -353,6 +377,12 @@ void LowLevelRenderer::Draw(DrawPacketList& packets, LightList& lights,
     draw_color_state.cds.stencil_ref = 0;
     draw_color_state.cds.stencil_func = gfx::Painter::StencilFunc::Disabled;
 
+    // the sprite batches transform the vertices to the world space
+    // which changes the tangent space basis vectors computed in the vertex
+    // shader. so no batching when the lights are on.
+    const bool batch_sprites = mSettings.enable_sprite_batching && !mSettings.enable_lights;
+    std::vector<std::unique_ptr<gfx::SpriteBatch>> sprite_batches;
+
     TRACE_ENTER(DrawLayers);
     for (const auto& scene_layer : layers)
     {
@@ -362,6 +392,14 @@ void LowLevelRenderer::Draw(DrawPacketList& packets, LightList& lights,
             for (auto* light : entity_layer.layer_lights)
                 program.AddLight(light->light);
 
+            const auto* draw_color_list = &entity_layer.draw_color_list;
+            std::vector<gfx::Painter::DrawCommand> batched_draw_color_list;
+            if (batch_sprites)
+            {
+                TRACE_CALL("BatchDrawCmd", BatchDrawCommands(entity_layer.draw_color_list, batched_draw_color_list, sprite_batches));
+                draw_color_list = &batched_draw_color_list;
+            }
+
             if (!entity_layer.mask_cover_list.empty() && !entity_layer.mask_expose_list.empty())
             {
                 gfx::StencilShaderProgram stencil_program;
@@ -369,7 +407,7 @@ void LowLevelRenderer::Draw(DrawPacketList& packets, LightList& lights,
                 scene_painter.ClearStencil(gfx::StencilClearValue(1));
                 scene_painter.Draw(entity_layer.mask_cover_list,  stencil_program, mask_cover_state);
                 scene_painter.Draw(entity_layer.mask_expose_list, stencil_program, mask_expose_state);
-                scene_painter.Draw(entity_layer.draw_color_list,  program, mask_draw_color_state);
+                scene_painter.Draw(*draw_color_list, program, mask_draw_color_state);
             }
             else if (!entity_layer.mask_cover_list.empty())
             {
@@ -377,7 +415,7 @@ void LowLevelRenderer::Draw(DrawPacketList& packets, LightList& lights,
 
                 scene_painter.ClearStencil(gfx::StencilClearValue(1));
                 scene_painter.Draw(entity_layer.mask_cover_list, stencil_program, mask_cover_state);
-                scene_painter.Draw(entity_layer.draw_color_list, program, mask_draw_color_state);
+                scene_painter.Draw(*draw_color_list, program, mask_draw_color_state);
             }
             else if (!entity_layer.mask_expose_list.empty())
             {
@@ -385,11 +423,11 @@ void LowLevelRenderer::Draw(DrawPacketList& packets, LightList& lights,
 
                 scene_painter.ClearStencil(gfx::StencilClearValue(0));
                 scene_painter.Draw(entity_layer.mask_expose_list, stencil_program, mask_expose_state);
-                scene_painter.Draw(entity_layer.draw_color_list, program, mask_draw_color_state);
+                scene_painter.Draw(*draw_color_list, program, mask_draw_color_state);
             }
-            else if (!entity_layer.draw_color_list.empty())
+            else if (!draw_color_list->empty())
             {
-                scene_painter.Draw(entity_layer.draw_color_list, program, draw_color_state);
+                scene_painter.Draw(*draw_color_list, program, draw_color_state);
             }
 
             if (mRenderHook)
@@ -408,6 +446,12 @@ void LowLevelRenderer::Draw(DrawPacketList& packets, LightList& lights,
     }
     TRACE_LEAVE(DrawLayers);
 
+    const auto& stats = scene_painter.GetStats();
+    mDrawStats.draw_calls       += stats.draw_calls;
+    mDrawStats.program_switches += stats.program_switches;
+    mDrawStats.texture_switches += stats.texture_switches;
+    mDrawStats.buffer_switches  += stats.buffer_switches;
+
     // draw editor packets
     if (mSettings.editing_mode)
     {
@@ -606,6 +650,172 @@ gfx::Framebuffer* LowLevelRenderer::CreateFrameBuffer(const std::string& name) c
     return fbo;
 }
 
+void LowLevelRenderer::SortDrawCommands(std::vector<gfx::Painter::DrawCommand>& list) const
+{
+    if (list.size() < 2)
+        return;
+
+    // the tilemap packets have already been sorted for occlusion
+    // and any reordering would break that.
+    for (const auto& draw : list)
+    {
+        const auto* packet = static_cast<const DrawPacket*>(draw.user);
+        if (packet->flags.test(DrawPacket::Flags::KeepOrder))
+            return;
+    }
+
+    // sort the keys together with the original index so that any
+    // draws with equal keys keep their relative order.
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> keys;
+    keys.reserve(list.size());
+    for (std::uint32_t i=0; i<list.size(); ++i)
+    {
+        const auto& draw = list[i];
+        const auto* packet = static_cast<const DrawPacket*>(draw.user);
+        keys.emplace_back(MakeSortKey(*packet, *draw.view, i), i);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<gfx::Painter::DrawCommand> sorted;
+    sorted.reserve(list.size());
+    for (const auto& key : keys)
+        sorted.push_back(std::move(list[key.second]));
+
+    list = std::move(sorted);
+}
+
+// static
+std::uint64_t LowLevelRenderer::MakeSortKey(const DrawPacket& packet, const glm::mat4& view, std::uint32_t sequence) noexcept
+{
+    using SurfaceType = gfx::MaterialClass::SurfaceType;
+
+    const auto* klass = packet.material->GetClass();
+
+    // materials without a class could be doing anything, treat them
+    // as transparent which means they're not going to be reordered.
+    const auto surface = klass ? klass->GetSurfaceType() : SurfaceType::Transparent;
+
+    const auto layer = static_cast<std::uint64_t>(std::min(packet.render_layer, 0xfff));
+    const auto index = static_cast<std::uint64_t>(std::min(packet.packet_index, 0xfff));
+    const auto pass  = static_cast<std::uint64_t>(packet.pass) & 0x3;
+
+    std::uint64_t key = 0;
+    key |= layer << 52;
+    key |= index << 40;
+    key |= pass  << 38;
+
+    // without depth testing the draw order is the only thing that
+    // resolves the visibility, so every draw must keep its submission
+    // order (painter's order) regardless of the surface type.
+    if (packet.depth_test == DrawPacket::DepthTest::Disabled)
+        return key | (static_cast<std::uint64_t>(sequence) & 0xfffffffff);
+
+    const auto blend = static_cast<std::uint64_t>(surface) & 0x3;
+    key |= blend << 36;
+
+    // transparent draws blend with what has been drawn before them,
+    // so their relative order must be kept. opaque draws overwrite the
+    // destination and emissive draws blend additively so those can be
+    // drawn in any order.
+    if (surface == SurfaceType::Transparent)
+        return key | (static_cast<std::uint64_t>(sequence) & 0xfffffffff);
+
+    // the GPU program is the combination of the material shader and
+    // the drawable shader. Material classes of the same type share
+    // the built-in shader unless they're using a custom shader.
+    std::size_t program_hash = 0;
+    program_hash = base::hash_combine(program_hash, klass->GetType());
+    if (klass->GetType() == gfx::MaterialClass::Type::Custom)
+        program_hash = base::hash_combine(program_hash, klass->GetShaderUri());
+    program_hash = base::hash_combine(program_hash, packet.drawable->GetType());
+
+    // the material class is what determines the textures and the
+    // material uniforms.
+    const auto material_hash = std::hash<const void*>()(klass);
+
+    // draw front to back in order to have the occluded fragments
+    // rejected early. the exponent bits of a positive float increase
+    // monotonically and give a logarithmic depth bucket.
+    const auto& view_pos = view * packet.transform * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    const float distance = std::max(-view_pos.z, 0.0f);
+    std::uint32_t bits = 0;
+    std::memcpy(&bits, &distance, sizeof(bits));
+    const std::uint64_t depth = (bits >> 23) & 0xff;
+    key |= (static_cast<std::uint64_t>(program_hash) & 0xfff) << 24;
+    key |= (static_cast<std::uint64_t>(material_hash) & 0xffff) << 8;
+    key |= depth;
+    return key;
+}
+
+void LowLevelRenderer::BatchDrawCommands(const std::vector<gfx::Painter::DrawCommand>& list,
+                                         std::vector<gfx::Painter::DrawCommand>& batched,
+                                         std::vector<std::unique_ptr<gfx::SpriteBatch>>& batches) const
+{
+    static const glm::mat4 Identity(1.0f);
+    // keep the streamed vertex buffers at a reasonable size.
+    constexpr std::size_t MaxBatchSize = 2048;
+
+    const auto can_batch = [](const gfx::Painter::DrawCommand& draw) {
+        const auto* packet = static_cast<const DrawPacket*>(draw.user);
+        // the batched vertices are 2D only, the Z is lost.
+        if (packet->projection != DrawPacket::Projection::Orthographic)
+            return false;
+        if (draw.state.depth_test != DrawPacket::DepthTest::Disabled)
+            return false;
+        if (draw.instanced_draw.has_value())
+            return false;
+        return gfx::SpriteBatch::CanBatch(*draw.drawable);
+    };
+    const auto is_compatible = [](const gfx::Painter::DrawCommand& lhs, const gfx::Painter::DrawCommand& rhs) {
+        if (lhs.view != rhs.view || lhs.projection != rhs.projection)
+            return false;
+        if (lhs.state.culling != rhs.state.culling ||
+            lhs.state.winding != rhs.state.winding ||
+            lhs.state.blending != rhs.state.blending ||
+            lhs.state.premulalpha != rhs.state.premulalpha ||
+            lhs.state.flip_uv_horizontally != rhs.state.flip_uv_horizontally ||
+            lhs.state.flip_uv_vertically != rhs.state.flip_uv_vertically)
+            return false;
+        return lhs.material->HasSameState(*rhs.material);
+    };
+
+    batched.reserve(list.size());
+
+    for (size_t i=0; i<list.size();)
+    {
+        const auto& first = list[i];
+        size_t end = i + 1;
+        if (can_batch(first))
+        {
+            while (end < list.size() && end - i < MaxBatchSize &&
+                   can_batch(list[end]) && is_compatible(first, list[end]))
+                ++end;
+        }
+
+        // nothing to combine.
+        if (end - i == 1)
+        {
+            batched.push_back(first);
+            ++i;
+            continue;
+        }
+
+        auto batch = std::make_unique<gfx::SpriteBatch>();
+        for (size_t j=i; j<end; ++j)
+            batch->AddSprite(*list[j].model);
+
+        // the first draw in the batch represents the whole batch,
+        // the material state is the same for all of them.
+        gfx::Painter::DrawCommand draw = first;
+        draw.drawable = batch.get();
+        draw.model    = &Identity;
+        draw.geometry_gpu_ptr.reset();
+        batched.push_back(std::move(draw));
+        batches.push_back(std::move(batch));
+        i = end;
+    }
+}
+
 bool LowLevelRenderer::CullDrawPacket(const DrawPacket& packet, const glm::mat4& projection, const glm::mat4& modelview) const
 {
     // the draw packets for the map are only generated for the visible part
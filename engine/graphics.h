@@ -25,6 +25,7 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <cstdint>
 
 #include "base/bitflag.h"
 #include "graphics/types.h"
@@ -49,7 +50,12 @@ namespace engine
             PP_Bloom,
             CullPacket,
             Flip_UV_Vertically,
-            Flip_UV_Horizontally
+            Flip_UV_Horizontally,
+            // the packet's position relative to the other packets in the
+            // same render layer is significant (for example tilemap tiles
+            // that have been sorted for occlusion) and the packet must not
+            // be reordered when sorting the packets for state changes.
+            KeepOrder
         };
         enum class Domain {
             Scene, Editor
@@ -160,6 +166,19 @@ namespace engine
         using BasicFogMode   = game::BasicFogMode;
         using BasicFogParams = game::BasicFogParameters;
 
+        // Control how the draw packets are ordered inside each
+        // render layer (render_layer and packet_index).
+        enum class PacketSortMode {
+            // Draw the packets in the order they were submitted.
+            Submission,
+            // Sort the packets by a 64bit sort key in order to minimize
+            // the GPU program, material (texture) and blending state
+            // changes. Only packets with depth testing are reordered,
+            // transparent packets keep their relative submission order
+            // and layers with KeepOrder packets are not sorted at all.
+            SortKey
+        };
+
         struct Camera {
             Color4f clear_color;
             glm::vec2 position = {0.0f, 0.0f};
@@ -187,6 +206,8 @@ namespace engine
             bool enable_bloom = false;
             bool enable_lights = false;
             bool enable_fog    = false;
+            PacketSortMode sort_mode = PacketSortMode::Submission;
+            bool enable_sprite_batching = false;
             glm::vec2 pixel_ratio = {1.0f, 1.0f};
             BloomParams bloom;
             BasicFogParams fog;
@@ -212,6 +233,8 @@ namespace engine
         using Surface = LowLevelRendererHook::Surface;
         using RenderSettings = LowLevelRendererHook::RenderSettings;
         using BasicFogParams = LowLevelRendererHook::BasicFogParams;
+        using PacketSortMode = LowLevelRendererHook::PacketSortMode;
+        using DrawStats = gfx::Painter::DrawStats;
 
         LowLevelRenderer(const std::string* name, gfx::Device& device);
 
@@ -254,6 +277,17 @@ namespace engine
         {
             mSettings.enable_bloom = on_off;
         }
+        void SetPacketSortMode(PacketSortMode mode) noexcept
+        {
+            mSettings.sort_mode = mode;
+        }
+        // Enable combining consecutive compatible sprite draws (solid
+        // rectangles with the same material and draw state) into a single
+        // draw with the vertices transformed on the CPU.
+        void EnableSpriteBatching(bool on_off) noexcept
+        {
+            mSettings.enable_sprite_batching = on_off;
+        }
         void SetRenderHook(LowLevelRendererHook* hook) noexcept
         {
             mRenderHook = hook;
@@ -266,6 +300,31 @@ namespace engine
         void DrawPackets(DrawPacketList& packets, LightList& lights) const;
         void BlitImage() const;
 
+        // Get the draw statistics (draw calls, state switches) of the
+        // scene packets drawn by the last call to DrawPackets.
+        const DrawStats& GetDrawStats() const noexcept
+        {
+            return mDrawStats;
+        }
+
+        // Compute the 64bit sort key for ordering the draw packets when the
+        // packet sort mode is SortKey. From the most significant bits to
+        // the least significant bits the key is composed of
+        // - render layer (12 bits)
+        // - packet index (12 bits)
+        // - render pass (2 bits)
+        // and then for packets without depth testing
+        // - submission sequence number (36 bits)
+        // and for packets with depth testing
+        // - blending / surface type (2 bits)
+        // and then for opaque packets
+        // - program hash (12 bits)
+        // - material hash (16 bits)
+        // - depth (8 bits)
+        // and for transparent packets
+        // - submission sequence number (36 bits)
+        static std::uint64_t MakeSortKey(const DrawPacket& packet, const glm::mat4& view, std::uint32_t sequence) noexcept;
+
     private:
         unsigned GetSurfaceWidth() const noexcept
         {
@@ -280,6 +339,10 @@ namespace engine
         void DrawDefault(DrawPacketList& packets, LightList& lights) const;
         void DrawFramebuffer(DrawPacketList& packets, LightList& lights) const;
         void Draw(DrawPacketList& packets, LightList& lights, gfx::Framebuffer* fbo, gfx::GenericShaderProgram& program) const;
+        void SortDrawCommands(std::vector<gfx::Painter::DrawCommand>& list) const;
+        void BatchDrawCommands(const std::vector<gfx::Painter::DrawCommand>& list,
+                               std::vector<gfx::Painter::DrawCommand>& batched,
+                               std::vector<std::unique_ptr<gfx::SpriteBatch>>& batches) const;
         bool CullDrawPacket(const DrawPacket& packet, const glm::mat4& projection, const glm::mat4& modelview) const;
 
     private:
@@ -294,6 +357,7 @@ namespace engine
         mutable gfx::Texture* mMainImage = nullptr;
         mutable gfx::Texture* mBloomImage = nullptr;
         mutable gfx::Framebuffer* mMainFBO = nullptr;
+        mutable DrawStats mDrawStats;
         gfx::Device& mDevice;
     };
 
@@ -55,6 +55,7 @@
 #include "graphics/simple_shape.h"
 #include "graphics/polygon_mesh.h"
 #include "graphics/particle_engine.h"
+#include "graphics/fluid_simulation.h"
 #include "graphics/material_class.h"
 #include "game/entity.h"
 #include "game/scene_class.h"
@@ -1005,6 +1006,8 @@ bool ContentLoaderImpl::LoadClasses(const data::Reader& data)
         return false;
    if (!LoadContent<gfx::DrawableClass, gfx::PolygonMeshClass>(data, "shapes", mDrawables, nullptr))
        return false;
+   if (!LoadContent<gfx::DrawableClass, gfx::FluidSimulationClass>(data, "fluids", mDrawables, nullptr))
+       return false;
    if (!LoadContent<game::EntityClass>(data, "entities", mEntities, &mEntityNameTable))
        return false;
    if (!LoadContent<game::SceneClass>(data, "scenes", mScenes, &mSceneNameTable))
@@ -1982,10 +1982,15 @@ void BindGameLib(sol::state& L)
     game_event["message"] = &GameEvent::message;
 
     auto transform = table.new_usertype<game::EntityNodeTransform>("EntityNodeTransform");
-    transform["translation"] = &EntityNodeTransform::translation;
-    transform["scale"]       = &EntityNodeTransform::scale;
-    transform["size"]        = &EntityNodeTransform::size;
-    transform["rotation"]    = &EntityNodeTransform::rotation;
+    // go through the setters so that the cached node transforms get invalidated.
+    transform["translation"] = sol::property(&EntityNodeTransform::GetTranslation,
+        [](EntityNodeTransform& transform, const glm::vec2& value) { transform.SetTranslation(value); });
+    transform["scale"]       = sol::property(&EntityNodeTransform::GetScale,
+        [](EntityNodeTransform& transform, const glm::vec2& value) { transform.SetScale(value); });
+    transform["size"]        = sol::property(&EntityNodeTransform::GetSize,
+        [](EntityNodeTransform& transform, const glm::vec2& value) { transform.SetSize(value); });
+    transform["rotation"]    = sol::property(&EntityNodeTransform::GetRotation,
+        [](EntityNodeTransform& transform, float value) { transform.SetRotation(value); });
     transform["SetRotation"] = &EntityNodeTransform::SetRotation;
     transform["SetScale"]    = sol::overload(
         [](EntityNodeTransform& transform, float x, float y) {
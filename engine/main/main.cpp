@@ -827,6 +827,13 @@ int main(int argc, char* argv[])
             base::JsonReadSafe(engine_settings, "default_mag_filter", &config.default_mag_filter);
             base::JsonReadSafe(engine_settings, "updates_per_second", &config.updates_per_second);
             base::JsonReadSafe(engine_settings, "ticks_per_second", &config.ticks_per_second);
+            base::JsonReadSafe(engine_settings, "sort_draw_packets", &config.sort_draw_packets);
+            base::JsonReadSafe(engine_settings, "enable_sprite_batching", &config.enable_sprite_batching);
+            base::JsonReadSafe(engine_settings, "enable_texture_streaming", &config.enable_texture_streaming);
+            base::JsonReadSafe(engine_settings, "texture_memory_budget", &config.texture_memory_budget);
+            base::JsonReadSafe(engine_settings, "enable_glyph_atlas_text", &config.enable_glyph_atlas_text);
+            base::JsonReadSafe(engine_settings, "enable_distance_field_text", &config.enable_distance_field_text);
+            base::JsonReadSafe(engine_settings, "enable_parallel_particle_updates", &config.enable_parallel_particle_updates);
             DEBUG("time_step = 1.0/%1, tick_step = 1.0/%2", config.updates_per_second, config.ticks_per_second);
         }
         if (json.contains("mouse_cursor"))
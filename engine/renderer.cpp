@@ -27,6 +27,7 @@
 #include "base/logging.h"
 #include "base/utility.h"
 #include "base/trace.h"
+#include "base/threadpool.h"
 #include "graphics/drawable.h"
 #include "graphics/material.h"
 #include "graphics/painter.h"
@@ -40,6 +41,7 @@
 #include "graphics/debug_drawable.h"
 #include "graphics/effect_drawable.h"
 #include "graphics/text_material.h"
+#include "graphics/text_drawable.h"
 #include "graphics/material_class.h"
 #include "graphics/material_instance.h"
 #include "engine/classlib.h"
@@ -64,6 +66,39 @@ using namespace game;
 namespace engine
 {
 
+namespace {
+template<typename NodeState>
+void ClearVisited(NodeState& state)
+{
+    if (state.drawable)
+        state.drawable->visited = false;
+    if (state.text_item)
+        state.text_item->visited = false;
+    if (state.light)
+        state.light->visited = false;
+}
+
+// Erase the parts of the node state that were not visited.
+// Returns true if the node state is now completely empty.
+template<typename NodeState>
+bool EraseUnvisited(NodeState& state)
+{
+    if (state.drawable && !state.drawable->visited)
+        state.drawable.reset();
+    if (state.text_item && !state.text_item->visited)
+        state.text_item.reset();
+    if (state.light && !state.light->visited)
+        state.light.reset();
+    return !state.drawable && !state.text_item && !state.light;
+}
+
+template<typename NodeState>
+size_t CountPaintNodes(const NodeState& state)
+{
+    return (state.drawable ? 1 : 0) + (state.text_item ? 1 : 0);
+}
+} // namespace
+
 Renderer::Renderer(const ClassLibrary* classlib)
   : mClassLib(classlib)
 {
@@ -73,7 +108,7 @@ void Renderer::CreateRendererState(const game::Scene& scene, const game::Tilemap
 {
     std::lock_guard<std::mutex> lock(mRendererLock);
 
-    mPaintNodes.clear();
+    mNodeStates.clear();
 
     const auto& nodes = scene.CollectNodes();
 
@@ -104,10 +139,7 @@ void Renderer::UpdateRendererState(const game::Scene& scene, const game::Tilemap
         {
             for (size_t i=0; i<entity->GetNumNodes(); ++i)
             {
-                const auto& node = entity->GetNode(i);
-                mPaintNodes.erase("drawable/" + node.GetId());
-                mPaintNodes.erase("text-item/" + node.GetId());
-                mLightNodes.erase("basic/" + node.GetId());
+                EraseNodeState(entity->GetNode(i));
             }
         }
         else
@@ -130,6 +162,15 @@ void Renderer::Update(const Scene& scene, const game::Tilemap* map, double time,
 
     const auto& projection = scene->GetProjection();
 
+    // collect the particle engine updates for updating them in parallel
+    // once all the entities have been visited.
+    ParticleUpdateList* particle_updates = nullptr;
+    if (mParallelParticleUpdates)
+    {
+        mParticleUpdates.clear();
+        particle_updates = &mParticleUpdates;
+    }
+
     for (size_t i=0; i<scene.GetNumEntities(); ++i)
     {
         const auto& entity = scene.GetEntity(i);
@@ -138,19 +179,23 @@ void Renderer::Update(const Scene& scene, const game::Tilemap* map, double time,
         {
             const auto& node = entity.GetNode(i);
 
-            if (auto* paint = base::SafeFind(mPaintNodes, "drawable/" + node.GetId()))
+            auto* state = FindNodeState(node);
+            if (!state)
+                continue;
+
+            if (auto& paint = state->drawable)
             {
-                UpdateDrawableResources<Entity, EntityNode>(entity, node, *paint, projection, time, dt);
+                UpdateDrawableResources<Entity, EntityNode>(entity, node, *paint, projection, time, dt, particle_updates);
                 paint->visited = true;
             }
 
-            if (auto* paint = base::SafeFind(mPaintNodes, "text-item/" + node.GetId()))
+            if (auto& paint = state->text_item)
             {
                 UpdateTextResources<Entity, EntityNode>(entity, node, *paint, projection, time, dt);
                 paint->visited = true;
             }
 
-            if (auto* light = base::SafeFind(mLightNodes, "basic/" + node.GetId()))
+            if (auto& light = state->light)
             {
                 UpdateLightResources<Entity, EntityNode>(entity, node, *light, projection, time, dt);
                 light->visited = true;
@@ -158,6 +203,34 @@ void Renderer::Update(const Scene& scene, const game::Tilemap* map, double time,
         }
 
     }
+
+    if (particle_updates)
+        UpdateParticleEngines(*particle_updates);
+}
+
+void Renderer::UpdateParticleEngines(ParticleUpdateList& updates) const
+{
+    TRACE_SCOPE("UpdateParticleEngines");
+
+    // every particle engine is independent and uses its own random
+    // number generator so the results don't depend on the order in
+    // which the engines are updated.
+    base::ParallelFor(base::GetGlobalThreadPool(), 0, updates.size(), 1, [&updates](size_t index) {
+        auto& update = updates[index];
+        auto* drawable = update.drawable;
+
+        gfx::Drawable::Environment env;
+        env.model_matrix = &update.model_matrix;
+        env.world_matrix = &update.world_matrix;
+        if (update.update)
+            drawable->Update(env, update.dt);
+        if (update.restart && !drawable->IsAlive())
+            drawable->Restart(env);
+
+        for (const auto& cmd : update.commands)
+            drawable->Execute(env, cmd);
+    });
+    updates.clear();
 }
 
 void Renderer::CreateFrame(const game::Scene& scene, const game::Tilemap* map, const FrameSettings& settings)
@@ -184,6 +257,44 @@ void Renderer::CreateFrame(const game::Scene& scene, const game::Tilemap* map, c
 
     const auto map_packet_count = map_draw_packets.size();
 
+    // Compute the part of the scene that is visible through the camera
+    // in order to cull paint nodes before creating any draw packets for
+    // them. This is only done with the axis aligned orthographic projection
+    // for now since the other projections would need the scene plane to
+    // be mapped through the projection specific model transformation.
+    // The low level renderer still does the per packet culling later on.
+    base::FRect visible_rect;
+    bool cull_paint_nodes = false;
+    if (projection == SceneProjection::AxisAlignedOrthographic)
+    {
+        const auto& camera  = settings.camera;
+        const auto& surface = settings.surface;
+        const auto window_size = glm::vec2{surface.viewport.GetWidth(), surface.viewport.GetHeight()};
+        if (!camera.viewport.IsEmpty() && window_size.x > 0.0f && window_size.y > 0.0f)
+        {
+            const auto& view_to_clip  = CreateProjectionMatrix(Projection::Orthographic, camera.viewport);
+            const auto& world_to_view = CreateModelViewMatrix(GameView::AxisAligned, camera.position, camera.scale, camera.rotation);
+            // map all the 4 corners since the camera can be rotated.
+            const auto corners = MapFromWindowToWorldPlane(view_to_clip, world_to_view, window_size,
+                                                           {window_size * glm::vec2{0.0f, 0.0f},
+                                                            window_size * glm::vec2{1.0f, 0.0f},
+                                                            window_size * glm::vec2{0.0f, 1.0f},
+                                                            window_size * glm::vec2{1.0f, 1.0f}
+                                                           });
+            auto min = glm::vec2{corners[0].x, corners[0].y};
+            auto max = min;
+            for (const auto& corner : corners)
+            {
+                min = glm::min(min, glm::vec2{corner.x, corner.y});
+                max = glm::max(max, glm::vec2{corner.x, corner.y});
+            }
+            visible_rect = base::FRect(min.x, min.y, max.x - min.x, max.y - min.y);
+            cull_paint_nodes = true;
+        }
+    }
+
+    FrameStats stats;
+
     {
         TRACE_SCOPE("CreateScenePackets");
 
@@ -199,19 +310,41 @@ void Renderer::CreateFrame(const game::Scene& scene, const game::Tilemap* map, c
             {
                 const auto& node = entity.GetNode(j);
 
-                if (auto* paint = base::SafeFind(mPaintNodes, "drawable/" + node.GetId()))
+                auto* state = FindNodeState(node);
+                if (!state)
+                    continue;
+
+                if (auto& paint = state->drawable)
                 {
-                    CreateDrawableDrawPackets<Entity, EntityNode>(entity, node, *paint, settings, projection, *packet_list, nullptr);
+                    if (cull_paint_nodes && CullDrawablePaintNode(node, *paint, visible_rect))
+                    {
+                        ++stats.num_culled_paint_nodes;
+                    }
+                    else
+                    {
+                        CreateDrawableDrawPackets<Entity, EntityNode>(entity, node, *paint, settings, projection, *packet_list, nullptr);
+                        ++stats.num_submitted_paint_nodes;
+                    }
                     paint->visited = true;
                 }
 
-                if (auto* paint = base::SafeFind(mPaintNodes, "text-item/" + node.GetId()))
+                if (auto& paint = state->text_item)
                 {
-                    CreateTextDrawPackets<Entity, EntityNode>(entity, node, *paint, settings, projection, *packet_list, nullptr);
+                    if (cull_paint_nodes && CullTextPaintNode(node, *paint, visible_rect))
+                    {
+                        ++stats.num_culled_paint_nodes;
+                    }
+                    else
+                    {
+                        CreateTextDrawPackets<Entity, EntityNode>(entity, node, *paint, settings, projection, *packet_list, nullptr);
+                        ++stats.num_submitted_paint_nodes;
+                    }
                     paint->visited = true;
                 }
 
-                if (auto* light = base::SafeFind(mLightNodes, "basic/" + node.GetId()))
+                // lights affect the lighting of the visible objects even when
+                // the light itself is outside the visible area.
+                if (auto& light = state->light)
                 {
                     CreateLights<Entity, EntityNode>(entity, node, *light, settings, projection, lights);
                     light->visited = true;
@@ -244,6 +377,14 @@ void Renderer::CreateFrame(const game::Scene& scene, const game::Tilemap* map, c
     std::swap(mRenderBuffer, packets);
     std::swap(mLightBuffer, lights);
     mFrameSettings = settings;
+    mFrameStats.num_culled_paint_nodes    = stats.num_culled_paint_nodes;
+    mFrameStats.num_submitted_paint_nodes = stats.num_submitted_paint_nodes;
+}
+
+Renderer::FrameStats Renderer::GetFrameStats() const
+{
+    std::lock_guard<std::mutex> lock(mFrameLock);
+    return mFrameStats;
 }
 
 void Renderer::DrawFrame(gfx::Device& device) const
@@ -282,6 +423,8 @@ void Renderer::DrawFrame(gfx::Device& device) const
     low_level_renderer.EnableBloom(enable_bloom);
     low_level_renderer.EnableLights(enable_lights);
     low_level_renderer.EnableFog(mFrameSettings.enable_fog);
+    low_level_renderer.SetPacketSortMode(mFrameSettings.sort_mode);
+    low_level_renderer.EnableSpriteBatching(mFrameSettings.enable_sprite_batching);
 #if !defined(DETONATOR_ENGINE_BUILD)
     low_level_renderer.SetRenderHook(mLowLevelRendererHook);
     low_level_renderer.SetPacketFilter(mPacketFilter);
@@ -289,6 +432,12 @@ void Renderer::DrawFrame(gfx::Device& device) const
 
     TRACE_CALL("DrawPackets", low_level_renderer.DrawPackets(mRenderBuffer, mLightBuffer));
     TRACE_CALL("BlitImage", low_level_renderer.BlitImage());
+
+    const auto& stats = low_level_renderer.GetDrawStats();
+    mFrameStats.num_draw_calls       = stats.draw_calls;
+    mFrameStats.num_program_switches = stats.program_switches;
+    mFrameStats.num_texture_switches = stats.texture_switches;
+    mFrameStats.num_buffer_switches  = stats.buffer_switches;
 }
 
 
@@ -335,19 +484,23 @@ void Renderer::Update(const EntityClass& entity, double time, float dt)
     {
         const auto& node = entity.GetNode(i);
 
-        if (auto* paint = base::SafeFind(mPaintNodes, "drawable/" + node.GetId()))
+        auto* state = FindNodeState(node, "");
+        if (!state)
+            continue;
+
+        if (auto& paint = state->drawable)
         {
             UpdateDrawableResources<EntityClass, EntityNodeClass>(entity, node, *paint, mProjection, time, dt);
             paint->visited = true;
         }
 
-        if (auto* paint = base::SafeFind(mPaintNodes, "text-item/" + node.GetId()))
+        if (auto& paint = state->text_item)
         {
             UpdateTextResources<EntityClass, EntityNodeClass>(entity, node, *paint, mProjection, time, dt);
             paint->visited = true;
         }
 
-        if (auto* light = base::SafeFind(mLightNodes, "basic/" + node.GetId()))
+        if (auto& light = state->light)
         {
             UpdateLightResources<EntityClass, EntityNodeClass>(entity, node, *light, mProjection, time, dt);
             light->visited = true;
@@ -369,17 +522,21 @@ void Renderer::Update(const SceneClass& scene, const game::Tilemap* map, double
         for (size_t j=0; j<entity->GetNumNodes(); ++j)
         {
             const auto& node = entity->GetNode(j);
-            if (auto* paint = base::SafeFind(mPaintNodes, "drawable/" + placement.GetId() + "/" + node.GetId()))
+            auto* state = FindNodeState(node, placement.GetId() + "/");
+            if (!state)
+                continue;
+
+            if (auto& paint = state->drawable)
             {
                 UpdateDrawableResources<EntityClass, EntityNodeClass>(*entity, node, *paint, projection, time, dt);
                 paint->visited = true;
             }
-            if (auto* paint = base::SafeFind(mPaintNodes, "text-item/" + placement.GetId() + "/" + node.GetId()))
+            if (auto& paint = state->text_item)
             {
                 UpdateTextResources<EntityClass, EntityNodeClass>(*entity, node, *paint, projection, time, dt);
                 paint->visited = true;
             }
-            if (auto* light = base::SafeFind(mLightNodes, "basic/" + placement.GetId() + "/" + node.GetId()))
+            if (auto& light = state->light)
             {
                 UpdateLightResources<EntityClass, EntityNodeClass>(*entity, node, *light, projection, time, dt);
                 light->visited = true;
@@ -400,19 +557,23 @@ void Renderer::Update(const Entity& entity, double time, float dt)
     {
         const auto& node = entity.GetNode(i);
 
-        if (auto* paint = base::SafeFind(mPaintNodes, "drawable/" + node.GetId()))
+        auto* state = FindNodeState(node);
+        if (!state)
+            continue;
+
+        if (auto& paint = state->drawable)
         {
             UpdateDrawableResources<Entity, EntityNode>(entity, node, *paint, mProjection, time, dt);
             paint->visited = true;
         }
 
-        if (auto* paint = base::SafeFind(mPaintNodes, "text-item/" + node.GetId()))
+        if (auto& paint = state->text_item)
         {
             UpdateTextResources<Entity, EntityNode>(entity, node, *paint, mProjection, time, dt);
             paint->visited = true;
         }
 
-        if (auto* light = base::SafeFind(mLightNodes, "basic/" + node.GetId()))
+        if (auto& light = state->light)
         {
             UpdateLightResources<Entity, EntityNode>(entity, node, *light, mProjection, time, dt);
             light->visited = true;
@@ -479,18 +640,22 @@ void Renderer::CreateFrame(const game::SceneClass& scene, const game::Tilemap* m
             {
                 const auto& node = entity->GetNode(i);
 
-                if (auto* paint = base::SafeFind(mPaintNodes, "drawable/" + placement->GetId() + "/" + node.GetId()))
+                auto* state = FindNodeState(node, placement->GetId() + "/");
+                if (!state)
+                    continue;
+
+                if (auto& paint = state->drawable)
                 {
                     CreateDrawableDrawPackets<game::EntityClass, game::EntityNodeClass>(*entity, node, *paint, mFrameSettings, projection, entity_packets, nullptr);
                     paint->visited = true;
                 }
 
-                if (auto* paint = base::SafeFind(mPaintNodes, "text-item/" + placement->GetId() + "/" + node.GetId()))
+                if (auto& paint = state->text_item)
                 {
                     CreateTextDrawPackets<game::EntityClass, game::EntityNodeClass>(*entity, node, *paint, mFrameSettings, projection, entity_packets, nullptr);
                     paint->visited = true;
                 }
-                if (auto* light = base::SafeFind(mLightNodes, "basic/" + placement->GetId() + "/" + node.GetId()))
+                if (auto& light = state->light)
                 {
                     CreateLights<game::EntityClass, game::EntityNodeClass>(*entity, node, *light, mFrameSettings, projection, entity_lights);
                     light->visited = true;
@@ -581,32 +746,35 @@ void Renderer::CreateFrame(const game::EntityClass& entity, EntityClassDrawHook*
         const auto& node = entity.GetNode(i);
 
         bool did_paint = false;
-        if (node.HasDrawable())
+        if (auto* state = FindNodeState(node, ""))
         {
-            if (auto* paint = base::SafeFind(mPaintNodes, "drawable/" + node.GetId()))
+            if (node.HasDrawable())
             {
-                CreateDrawableDrawPackets<game::EntityClass, game::EntityNodeClass>(entity, node, *paint, mFrameSettings, mProjection, packets, hook);
-                paint->visited = true;
-                did_paint = true;
+                if (auto& paint = state->drawable)
+                {
+                    CreateDrawableDrawPackets<game::EntityClass, game::EntityNodeClass>(entity, node, *paint, mFrameSettings, mProjection, packets, hook);
+                    paint->visited = true;
+                    did_paint = true;
+                }
             }
-        }
 
-        if (node.HasTextItem())
-        {
-            if (auto* paint = base::SafeFind(mPaintNodes, "text-item/" + node.GetId()))
+            if (node.HasTextItem())
             {
-                CreateTextDrawPackets<game::EntityClass, game::EntityNodeClass>(entity, node, *paint, mFrameSettings, mProjection, packets, hook);
-                paint->visited = true;
-                did_paint = true;
+                if (auto& paint = state->text_item)
+                {
+                    CreateTextDrawPackets<game::EntityClass, game::EntityNodeClass>(entity, node, *paint, mFrameSettings, mProjection, packets, hook);
+                    paint->visited = true;
+                    did_paint = true;
+                }
             }
-        }
 
-        if (node.HasBasicLight())
-        {
-            if (auto* light = base::SafeFind(mLightNodes, "basic/" + node.GetId()))
+            if (node.HasBasicLight())
             {
-                CreateLights<game::EntityClass, game::EntityNodeClass>(entity, node, *light, mFrameSettings, mProjection, lights);
-                light->visited = true;
+                if (auto& light = state->light)
+                {
+                    CreateLights<game::EntityClass, game::EntityNodeClass>(entity, node, *light, mFrameSettings, mProjection, lights);
+                    light->visited = true;
+                }
             }
         }
 
@@ -639,23 +807,26 @@ void Renderer::CreateFrame(const game::Entity& entity, EntityInstanceDrawHook* h
         const auto& node = entity.GetNode(i);
 
         bool did_paint = false;
-        if (auto* paint = base::SafeFind(mPaintNodes, "drawable/" + node.GetId()))
+        if (auto* state = FindNodeState(node))
         {
-            CreateDrawableDrawPackets<game::Entity, game::EntityNode>(entity, node, *paint, mFrameSettings, mProjection, packets, hook);
-            paint->visited = true;
-            did_paint = true;
-        }
+            if (auto& paint = state->drawable)
+            {
+                CreateDrawableDrawPackets<game::Entity, game::EntityNode>(entity, node, *paint, mFrameSettings, mProjection, packets, hook);
+                paint->visited = true;
+                did_paint = true;
+            }
 
-        if (auto* paint = base::SafeFind(mPaintNodes, "text-item/" + node.GetId()))
-        {
-            CreateTextDrawPackets<game::Entity, game::EntityNode>(entity, node, *paint, mFrameSettings, mProjection, packets, hook);
-            paint->visited = true;
-            did_paint = true;
-        }
-        if (auto* light = base::SafeFind(mLightNodes, "basic/" + node.GetId()))
-        {
-            CreateLights<game::Entity, game::EntityNode>(entity, node, *light, mFrameSettings, mProjection, lights);
-            light->visited = true;
+            if (auto& paint = state->text_item)
+            {
+                CreateTextDrawPackets<game::Entity, game::EntityNode>(entity, node, *paint, mFrameSettings, mProjection, packets, hook);
+                paint->visited = true;
+                did_paint = true;
+            }
+            if (auto& light = state->light)
+            {
+                CreateLights<game::Entity, game::EntityNode>(entity, node, *light, mFrameSettings, mProjection, lights);
+                light->visited = true;
+            }
         }
 
         if (hook && !did_paint)
@@ -735,11 +906,11 @@ void Renderer::BeginFrame()
 {
     if (mEditingMode)
     {
-        for (auto& node: mPaintNodes)
-            node.second.visited = false;
+        for (auto& state : mNodeStates)
+            ClearVisited(state);
 
-        for (auto& light : mLightNodes)
-            light.second.visited = false;
+        for (auto& pair : mClassNodeStates)
+            ClearVisited(pair.second);
     }
 }
 
@@ -747,31 +918,35 @@ void Renderer::EndFrame()
 {
     if (mEditingMode)
     {
-        for (auto it = mPaintNodes.begin(); it != mPaintNodes.end();)
-        {
-            const auto& paint_node = it->second;
-            if (paint_node.visited)
-                ++it;
-            else it = mPaintNodes.erase(it);
-        }
+        for (auto& state : mNodeStates)
+            EraseUnvisited(state);
 
-        for (auto it = mLightNodes.begin(); it != mLightNodes.end(); )
+        for (auto it = mClassNodeStates.begin(); it != mClassNodeStates.end();)
         {
-            const auto& light_node = it->second;
-            if (light_node.visited)
-                ++it;
-            else it = mLightNodes.erase(it);
+            if (EraseUnvisited(it->second))
+                it = mClassNodeStates.erase(it);
+            else ++it;
         }
     }
 }
 
 void Renderer::ClearPaintState()
 {
-    mPaintNodes.clear();
-    mLightNodes.clear();
+    mNodeStates.clear();
+    mClassNodeStates.clear();
     mTilemapPalette.clear();
 }
 
+size_t Renderer::GetNumPaintNodes() const noexcept
+{
+    size_t count = 0;
+    for (const auto& state : mNodeStates)
+        count += CountPaintNodes(state);
+    for (const auto& pair : mClassNodeStates)
+        count += CountPaintNodes(pair.second);
+    return count;
+}
+
 #endif // DETONATOR_ENGINE_BUILD
 
 
@@ -1000,7 +1175,8 @@ void Renderer::PrepareMapTileBatches(const game::Tilemap& map,
 
 template<typename EntityType, typename EntityNodeType>
 void Renderer::UpdateDrawableResources(const EntityType& entity, const EntityNodeType& entity_node, PaintNode& paint_node,
-                                       SceneProjection projection, double time, float dt) const
+                                       SceneProjection projection, double time, float dt,
+                                       ParticleUpdateList* particle_updates) const
 {
     using DrawableItemType = typename EntityNodeType::DrawableItemType;
     const auto* item = entity_node.GetDrawable();
@@ -1132,6 +1308,34 @@ void Renderer::UpdateDrawableResources(const EntityType& entity, const EntityNod
         // todo: other env matrices?
 
         const auto time_scale = item->GetTimeScale();
+
+        if (particle_updates && paint_node.drawable->GetType() == gfx::Drawable::Type::ParticleEngine)
+        {
+            // defer the particle engine update and do it later in parallel
+            // with the other particle engines.
+            ParticleUpdate update;
+            update.drawable     = paint_node.drawable.get();
+            update.model_matrix = model_transform_matrix;
+            update.world_matrix = world_transform_matrix;
+            update.dt      = dt * time_scale;
+            update.update  = item->TestFlag(DrawableItemType::Flags::UpdateDrawable);
+            update.restart = item->TestFlag(DrawableItemType::Flags::RestartDrawable);
+            if constexpr (std::is_same_v<EntityNodeType, game::EntityNode>)
+            {
+                for (size_t i=0; i<item->GetNumCommands(); ++i)
+                {
+                    const auto& src_cmd = item->GetCommand(i);
+                    gfx::Drawable::Command gfx_cmd;
+                    gfx_cmd.name = src_cmd.name;
+                    gfx_cmd.args = src_cmd.args;
+                    update.commands.push_back(std::move(gfx_cmd));
+                }
+                item->ClearCommands();
+            }
+            particle_updates->push_back(std::move(update));
+            return;
+        }
+
         if (item->TestFlag(DrawableItemType::Flags::UpdateDrawable))
             paint_node.drawable->Update(env, dt * time_scale);
         if (item->TestFlag(DrawableItemType::Flags::RestartDrawable) && !paint_node.drawable->IsAlive())
@@ -1234,6 +1438,53 @@ void Renderer::UpdateLightResources(const EntityType& entity, const EntityNodeTy
     }
 }
 
+Renderer::NodeState* Renderer::FindNodeState(const game::EntityNode& node) noexcept
+{
+    const auto handle = node.GetHandle();
+    if (handle.index >= mNodeStates.size())
+        return nullptr;
+
+    auto& state = mNodeStates[handle.index];
+    if (state.generation != handle.generation)
+        return nullptr;
+    return &state;
+}
+
+Renderer::NodeState& Renderer::GetNodeState(const game::EntityNode& node, const std::string&)
+{
+    const auto handle = node.GetHandle();
+    ASSERT(handle.IsValid());
+
+    if (handle.index >= mNodeStates.size())
+        mNodeStates.resize(handle.index + 1);
+
+    // if the generation doesn't match the slot has state left
+    // over from some node that no longer exists.
+    auto& state = mNodeStates[handle.index];
+    if (state.generation != handle.generation)
+    {
+        state = NodeState();
+        state.generation = handle.generation;
+    }
+    return state;
+}
+
+void Renderer::EraseNodeState(const game::EntityNode& node)
+{
+    if (auto* state = FindNodeState(node))
+        *state = NodeState();
+}
+
+Renderer::NodeState* Renderer::FindNodeState(const game::EntityNodeClass& node, const std::string& prefix)
+{
+    return base::SafeFind(mClassNodeStates, prefix + node.GetId());
+}
+
+Renderer::NodeState& Renderer::GetNodeState(const game::EntityNodeClass& node, const std::string& prefix)
+{
+    return mClassNodeStates[prefix + node.GetId()];
+}
+
 template<typename EntityType, typename EntityNodeType>
 void Renderer::CreatePaintNodes(const EntityType& entity, gfx::Transform& transform, std::string prefix)
 {
@@ -1256,13 +1507,17 @@ void Renderer::CreatePaintNodes(const EntityType& entity, gfx::Transform& transf
             // do render even if this node itself doesn't
             mTransform.Push(node->GetNodeTransform());
 
+            if (!node->HasDrawable() && !node->HasTextItem() && !node->HasBasicLight())
+                return;
+
             game::FBox box;
-            if  (node->HasDrawable() || node->HasTextItem() || node->HasBasicLight())
-                box.Transform(mTransform.GetAsMatrix());
+            box.Transform(mTransform.GetAsMatrix());
+
+            auto& state = mRenderer.GetNodeState(*node, mPrefix);
 
             if (const auto* item = node->GetDrawable())
             {
-                auto& paint_node = mRenderer.mPaintNodes["drawable/" + mPrefix + node->GetId()];
+                auto& paint_node = state.drawable ? *state.drawable : state.drawable.emplace();
                 paint_node.visited        = true;
                 paint_node.world_pos      = box.GetTopLeft();
                 paint_node.world_scale    = box.GetSize();
@@ -1272,7 +1527,7 @@ void Renderer::CreatePaintNodes(const EntityType& entity, gfx::Transform& transf
 
             if (const auto* text = node->GetTextItem())
             {
-                auto& paint_node = mRenderer.mPaintNodes["text-item/" + mPrefix + node->GetId()];
+                auto& paint_node = state.text_item ? *state.text_item : state.text_item.emplace();
                 paint_node.visited        = true;
                 paint_node.world_pos      = box.GetTopLeft();
                 paint_node.world_scale    = box.GetSize();
@@ -1282,7 +1537,7 @@ void Renderer::CreatePaintNodes(const EntityType& entity, gfx::Transform& transf
 
             if (const auto* light = node->GetBasicLight())
             {
-                auto& light_node = mRenderer.mLightNodes["basic/" + mPrefix + node->GetId()];
+                auto& light_node = state.light ? *state.light : state.light.emplace();
                 light_node.visited        = true;
                 light_node.world_pos      = box.GetTopLeft();
                 light_node.world_scale    = box.GetSize();
@@ -1390,6 +1645,14 @@ void Renderer::CreateDrawableResources(const EntityType& entity, const EntityNod
             if (!paint_node.drawable)
                 WARN("No such drawable class found. [drawable='%1', entity='%2', node='%3']", item->GetMaterialId(),
                      entity.GetName(), entity_node.GetName());
+            if (paint_node.drawable && mParallelParticleUpdates &&
+                paint_node.drawable->GetType() == gfx::Drawable::Type::ParticleEngine)
+            {
+                // the particle engines are updated in parallel by the renderer
+                // so the engine itself must not use its own background tasks.
+                auto particles = std::static_pointer_cast<gfx::ParticleEngineInstance>(paint_node.drawable);
+                particles->SetExecutionMode(gfx::ParticleEngineClass::ExecutionMode::Immediate);
+            }
             if (paint_node.drawable)
             {
                 gfx::Transform transform;
@@ -1482,9 +1745,32 @@ void Renderer::CreateTextResources(const EntityType& entity, const EntityNodeTyp
                 buffer.SetAlignment(gfx::TextBuffer::HorizontalAlignment::AlignRight);
             buffer.SetText(std::move(text_and_style));
 
+            // with the glyph atlas the text is drawn as a batch of glyph quads
+            // so the drawable must be replaced whenever the text changes. create
+            // a new drawable instead of changing the current one since it might
+            // be used to draw the current frame.
+            const auto glyph_atlas = mGlyphAtlasText &&
+                    buffer.GetRasterFormat() == gfx::TextBuffer::RasterFormat::Bitmap;
+            const auto glyph_mode = mDistanceFieldText
+                    ? gfx::TextBuffer::GlyphMode::DistanceField
+                    : gfx::TextBuffer::GlyphMode::Bitmap;
+            if (glyph_atlas)
+            {
+                auto text_drawable = std::make_shared<gfx::TextDrawable>(buffer, entity_node.GetId());
+                text_drawable->SetGlyphMode(glyph_mode);
+                paint_node.drawable = std::move(text_drawable);
+                paint_node.drawableId = "_glyph_text";
+            }
+            else if (paint_node.drawableId != drawable)
+            {
+                paint_node.drawable.reset();
+            }
+
             // setup material to shade text.
             auto mat = gfx::CreateMaterialInstance(std::move(buffer));
             mat->SetColor(text->GetTextColor());
+            mat->SetGlyphAtlas(glyph_atlas);
+            mat->SetGlyphMode(glyph_mode);
             paint_node.material = std::move(mat);
             paint_node.materialId = material;
             paint_node.material->SetFlag(gfx::MaterialInstance::Flags::EnableBloom, text->TestFlag(TextItemType::Flags::PP_EnableBloom));
@@ -1495,6 +1781,7 @@ void Renderer::CreateTextResources(const EntityType& entity, const EntityNodeTyp
         {
             auto klass = mClassLib->FindDrawableClassById(drawable);
             paint_node.drawable = gfx::CreateDrawableInstance(klass);
+            paint_node.drawableId = drawable;
         }
     }
 }
@@ -1539,6 +1826,68 @@ void Renderer::CreateLightResources(const EntityType& entity, const EntityNodeTy
    }
 }
 
+namespace {
+// Test whether a paint node is completely outside the visible scene rect.
+// The paint node's world transformation is scale, rotate and translate
+// and the node's model transformation centers the shape around the node
+// origin. This means that a circle around the node's world position with
+// the radius of the node's bounding sphere (scaled by the maximum world
+// scale) will always enclose the shape regardless of any rotations.
+bool IsOutsideRect(const glm::vec2& world_pos, const glm::vec2& world_scale, float local_radius,
+                   const base::FRect& visible_rect)
+{
+    const auto scale  = std::max(std::abs(world_scale.x), std::abs(world_scale.y));
+    const auto radius = local_radius * scale;
+    const auto min = world_pos - glm::vec2{radius, radius};
+    const auto max = world_pos + glm::vec2{radius, radius};
+    return max.x < visible_rect.GetX() || min.x > visible_rect.GetX() + visible_rect.GetWidth() ||
+           max.y < visible_rect.GetY() || min.y > visible_rect.GetY() + visible_rect.GetHeight();
+}
+} // namespace
+
+template<typename EntityNodeType>
+bool Renderer::CullDrawablePaintNode(const EntityNodeType& entity_node, const PaintNode& paint_node,
+                                     const base::FRect& visible_rect) const
+{
+    using DrawableItemType = typename EntityNodeType::DrawableItemType;
+
+    const auto* item = entity_node.GetDrawable();
+    if (!item || !paint_node.drawable)
+        return false;
+
+    // anything rendered relative to the camera is always visible.
+    if (item->GetCoordinateSpace() != DrawableItemType::CoordinateSpace::Scene)
+        return false;
+
+    // particles and mesh effect shards can move outside the node's
+    // bounds, so we can't know where they are without asking the drawable.
+    const auto type = paint_node.drawable->GetType();
+    if (type == gfx::Drawable::Type::ParticleEngine ||
+        type == gfx::Drawable::Type::EffectsDrawable)
+        return false;
+
+    const auto& size = entity_node.GetSize();
+    const auto radius = glm::length(glm::vec3{size.x, size.y, item->GetDepth()}) * 0.5f +
+                        glm::length(item->GetRenderTranslation());
+    return IsOutsideRect(paint_node.world_pos, paint_node.world_scale, radius, visible_rect);
+}
+
+template<typename EntityNodeType>
+bool Renderer::CullTextPaintNode(const EntityNodeType& entity_node, const PaintNode& paint_node,
+                                 const base::FRect& visible_rect) const
+{
+    const auto* text = entity_node.GetTextItem();
+    if (!text)
+        return false;
+
+    if (text->GetCoordinateSpace() != TextItemClass::CoordinateSpace::Scene)
+        return false;
+
+    const auto& size = entity_node.GetSize();
+    const auto radius = glm::length(size) * 0.5f + glm::length(text->GetRenderTranslation());
+    return IsOutsideRect(paint_node.world_pos, paint_node.world_scale, radius, visible_rect);
+}
+
 template<typename EntityType, typename EntityNodeType>
 void Renderer::CreateDrawableDrawPackets(const EntityType& entity,
                                          const EntityNodeType& entity_node,
@@ -2104,6 +2453,13 @@ void Renderer::SortTilePackets(std::vector<DrawPacket>& packets) const
         }
         return false;
     });
+
+    // the order is now significant and the low level renderer
+    // must not reorder these packets for state sorting.
+    for (auto& packet : packets)
+    {
+        packet.flags.set(DrawPacket::Flags::KeepOrder, true);
+    }
 }
 
 void Renderer::ComputeTileCoordinates(const game::Tilemap& map,
@@ -23,11 +23,13 @@
 #include "warnpop.h"
 
 #include <memory>
+#include <optional>
 #include <string>
 #include <variant>
 #include <vector>
 #include <unordered_map>
 #include <mutex>
+#include <cstdint>
 
 #include "base/bitflag.h"
 #include "graphics/fwd.h"
@@ -121,6 +123,7 @@ namespace engine
         using BloomParams = LowLevelRenderer::BloomParams;
         using Camera = LowLevelRenderer::Camera;
         using Surface = LowLevelRenderer::Surface;
+        using PacketSortMode = LowLevelRenderer::PacketSortMode;
 
         struct FrameSettings {
             base::bitflag<Effects> effects;
@@ -129,7 +132,9 @@ namespace engine
             Camera camera;
             Surface surface;
             RenderingStyle style = RenderingStyle::FlatColor;
+            PacketSortMode sort_mode = PacketSortMode::Submission;
             bool enable_fog = false;
+            bool enable_sprite_batching = false;
             // render units (= scene units?)
             // add a little fudge to the renderable tile size in order to try to
             // close any possible gap between the tiles. if the tiles are exactly
@@ -138,12 +143,43 @@ namespace engine
             float tile_size_fudge = 0.5f;
         };
 
+        // Statistics about the most recently created frame.
+        struct FrameStats {
+            // The number of paint nodes (drawables and text items) that
+            // were culled as not visible before creating draw packets.
+            std::size_t num_culled_paint_nodes = 0;
+            // The number of paint nodes that were submitted for draw
+            // packet creation.
+            std::size_t num_submitted_paint_nodes = 0;
+            // The draw calls and the GPU state switches done when
+            // drawing the scene packets of the most recently drawn frame.
+            std::size_t num_draw_calls       = 0;
+            std::size_t num_program_switches = 0;
+            std::size_t num_texture_switches = 0;
+            std::size_t num_buffer_switches  = 0;
+        };
+
         explicit Renderer(const ClassLibrary* classlib = nullptr);
 
         void SetClassLibrary(const ClassLibrary* classlib) noexcept
         { mClassLib = classlib; }
         void SetEditingMode(bool on_off) noexcept
         { mEditingMode = on_off; }
+        // Draw the text items using glyph quads that sample the shared
+        // glyph atlas instead of rasterizing every text into a texture.
+        // Only applies to texts using a TrueType/OpenType font.
+        void SetGlyphAtlasText(bool on_off) noexcept
+        { mGlyphAtlasText = on_off; }
+        // Use distance field glyphs with the glyph atlas text so that the
+        // text stays sharp when scaled without having to re-rasterize it.
+        void SetDistanceFieldText(bool on_off) noexcept
+        { mDistanceFieldText = on_off; }
+        // Update the particle engines of the scene in parallel on the global
+        // thread pool. The scene update gathers all the particle engines that
+        // need updating and then updates them as parallel jobs and waits for
+        // them to complete. Set this before creating the renderer state.
+        void SetParallelParticleUpdates(bool on_off) noexcept
+        { mParallelParticleUpdates = on_off; }
         void SetName(std::string name) noexcept
         { mRendererName = std::move(name); }
 
@@ -175,8 +211,7 @@ namespace engine
         { mPacketFilter = filter; }
         void SetLowLevelRendererHook(LowLevelRendererHook* hook) noexcept
         { mLowLevelRendererHook = hook; }
-        auto GetNumPaintNodes() const noexcept
-        { return mPaintNodes.size(); }
+        size_t GetNumPaintNodes() const noexcept;
 #endif
         // This the current *real* rendering API used by the engine.
 
@@ -202,6 +237,10 @@ namespace engine
         // enqueued and created draw commands.
         void DrawFrame(gfx::Device& painter) const;
 
+        // Get the statistics of the frame last created by CreateFrame
+        // and drawn by DrawFrame.
+        FrameStats GetFrameStats() const;
+
 #if !defined(DETONATOR_ENGINE_BUILD)
         void UpdateRendererState(const game::SceneClass& scene, const game::Tilemap* map);
         void UpdateRendererState(const game::EntityClass& entity);
@@ -263,9 +302,23 @@ namespace engine
         struct PaintNode;
         struct LightNode;
 
+        // A deferred particle engine drawable update.
+        struct ParticleUpdate {
+            gfx::Drawable* drawable = nullptr;
+            glm::mat4 model_matrix;
+            glm::mat4 world_matrix;
+            float dt = 0.0f;
+            bool update  = false;
+            bool restart = false;
+            std::vector<gfx::Drawable::Command> commands;
+        };
+        using ParticleUpdateList = std::vector<ParticleUpdate>;
+        void UpdateParticleEngines(ParticleUpdateList& updates) const;
+
         template<typename EntityType, typename EntityNodeType>
         void UpdateDrawableResources(const EntityType& entity, const EntityNodeType& entity_node, PaintNode& paint_node,
-                                     SceneProjection mode, double time, float dt) const;
+                                     SceneProjection mode, double time, float dt,
+                                     ParticleUpdateList* particle_updates = nullptr) const;
         template<typename EntityType, typename EntityNodeType>
         void UpdateTextResources(const EntityType& entity, const EntityNodeType& entity_node, PaintNode& paint_node,
                                  SceneProjection mode, double time, float dt) const;
@@ -280,6 +333,13 @@ namespace engine
         template<typename EntityType, typename EntityNodeType>
         void CreateLightResources(const EntityType& entity, const EntityNodeType& entity_node, LightNode& light_node) const;
 
+        template<typename EntityNodeType>
+        bool CullDrawablePaintNode(const EntityNodeType& entity_node, const PaintNode& paint_node,
+                                   const base::FRect& visible_rect) const;
+        template<typename EntityNodeType>
+        bool CullTextPaintNode(const EntityNodeType& entity_node, const PaintNode& paint_node,
+                               const base::FRect& visible_rect) const;
+
         template<typename EntityType, typename EntityNodeType>
         void CreateDrawableDrawPackets(const EntityType& entity,
                                        const EntityNodeType& entity_node,
@@ -347,6 +407,9 @@ namespace engine
         const ClassLibrary* mClassLib = nullptr;
         std::string mRendererName;
         bool mEditingMode = false;
+        bool mGlyphAtlasText = false;
+        bool mDistanceFieldText = false;
+        bool mParallelParticleUpdates = false;
 
         struct PaintNode {
             bool visited = false;
@@ -367,6 +430,28 @@ namespace engine
             float world_rotation = 0.0f;
         };
 
+        // All the renderer state of a single entity node. The
+        // node can have a drawable, a text item and a light.
+        struct NodeState {
+            // the generation of the entity node handle that owns this
+            // state. only used with entity node instances.
+            std::uint32_t generation = 0;
+            std::optional<PaintNode> drawable;
+            std::optional<PaintNode> text_item;
+            std::optional<LightNode> light;
+        };
+
+        // Find the renderer state of an entity node instance. This is just an
+        // array lookup using the node's handle.
+        NodeState* FindNodeState(const game::EntityNode& node) noexcept;
+        NodeState& GetNodeState(const game::EntityNode& node, const std::string& prefix);
+        void EraseNodeState(const game::EntityNode& node);
+        // Find the renderer state of an entity node class. These are keyed by the
+        // node id combined with the prefix which is used to tell apart the node
+        // classes in different scene placements.
+        NodeState* FindNodeState(const game::EntityNodeClass& node, const std::string& prefix);
+        NodeState& GetNodeState(const game::EntityNodeClass& node, const std::string& prefix);
+
         struct TilemapLayerPaletteEntry {
             std::string material_id;
             std::shared_ptr<gfx::Material> material;
@@ -374,9 +459,13 @@ namespace engine
         using TilemapLayerPalette = std::vector<TilemapLayerPaletteEntry>;
 
         std::mutex mRendererLock;
-        std::unordered_map<std::string, PaintNode> mPaintNodes;
-        std::unordered_map<std::string, LightNode> mLightNodes;
+        // entity node instance states indexed by the node handle index.
+        std::vector<NodeState> mNodeStates;
+        // entity node class states (editor) keyed by prefix + node id.
+        std::unordered_map<std::string, NodeState> mClassNodeStates;
         std::vector<TilemapLayerPalette> mTilemapPalette;
+        // the particle engine updates collected during the scene update.
+        ParticleUpdateList mParticleUpdates;
 
 #if !defined(DETONATOR_ENGINE_BUILD)
         SceneProjection mProjection = SceneProjection::AxisAlignedOrthographic;
@@ -387,6 +476,7 @@ namespace engine
         mutable std::vector<DrawPacket> mRenderBuffer;
         mutable std::vector<Light> mLightBuffer;
         mutable FrameSettings mFrameSettings;
+        mutable FrameStats mFrameStats;
     };
 
 } // namespace
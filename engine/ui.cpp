@@ -42,6 +42,7 @@
 #include "graphics/simple_shape.h"
 #include "graphics/texture_file_source.h"
 #include "graphics/text_material.h"
+#include "graphics/text_drawable.h"
 #include "graphics/material_instance.h"
 #include "engine/ui.h"
 #include "engine/classlib.h"
@@ -856,7 +857,7 @@ void UIPainter::DrawStaticText(const WidgetId& id, const PaintStruct& ps, const
         alignment |= gfx::TextAlign::AlignBottom;
     else BUG("Unknown vertical text alignment.");
 
-    DrawText(text, font_name, font_size, ps.rect, text_color, alignment, properties, line_height);
+    DrawText(id, text, font_name, font_size, ps.rect, text_color, alignment, properties, line_height);
 }
 
 void UIPainter::DrawEditableText(const WidgetId& id, const PaintStruct& ps, const EditableText& text) const
@@ -869,7 +870,7 @@ void UIPainter::DrawEditableText(const WidgetId& id, const PaintStruct& ps, cons
     const auto  font_size  = GetWidgetProperty(id, ps, "edit-text-size",16);
     const unsigned alignment  = gfx::TextAlign::AlignVCenter | gfx::TextAlign::AlignLeft;
     const unsigned properties = 0;
-    DrawText(text.text, font_name, font_size, ps.rect, text_color, alignment, properties, 1.0f);
+    DrawText(id, text.text, font_name, font_size, ps.rect, text_color, alignment, properties, 1.0f);
 }
 
 void UIPainter::DrawTextEditBox(const WidgetId& id, const PaintStruct& ps) const
@@ -1565,7 +1566,7 @@ uint8_t UIPainter::StencilPass() const
     return stencil_val;
 }
 
-void UIPainter::DrawText(const std::string& text, const std::string& font_name, int font_size,
+void UIPainter::DrawText(const WidgetId& id, const std::string& text, const std::string& font_name, int font_size,
                          const gfx::FRect& rect, const gfx::Color4f & color, unsigned alignment, unsigned properties,
                          float line_height) const
 {
@@ -1591,6 +1592,36 @@ void UIPainter::DrawText(const std::string& text, const std::string& font_name,
                                                 raster_width, raster_height,
                                                 alignment, properties, line_height);
 
+    if (mFlags.test(Flags::GlyphAtlasText) &&
+        material.GetText().GetRasterFormat() == gfx::TextBuffer::RasterFormat::Bitmap)
+    {
+        // draw the text as glyph quads using the widget ID for the
+        // geometry so that the geometry only changes when the text changes.
+        const auto glyph_mode = mFlags.test(Flags::DistanceFieldText)
+                ? gfx::TextBuffer::GlyphMode::DistanceField
+                : gfx::TextBuffer::GlyphMode::Bitmap;
+        material.SetGlyphAtlas(true);
+        material.SetGlyphMode(glyph_mode);
+        gfx::TextDrawable drawable(material.GetText(), "ui/" + id);
+        drawable.SetGlyphMode(glyph_mode);
+
+        gfx::Transform transform;
+        transform.Resize(rect);
+        transform.Translate(rect);
+
+        if (const auto value = StencilPass())
+        {
+            gfx::StencilTestColorWritePass pass(gfx::StencilPassValue(value), *mPainter);
+            pass.Draw(drawable, transform, material);
+        }
+        else
+        {
+            gfx::GenericRenderPass pass(*mPainter);
+            pass.Draw(drawable, transform, material);
+        }
+        return;
+    }
+
     if (const auto value = StencilPass())
     {
         gfx::StencilTestColorWritePass pass(gfx::StencilPassValue(value), *mPainter);
@@ -2557,6 +2588,8 @@ void UIEngine::OpenWindowStackState(std::shared_ptr<uik::Window> window)
     state.style->SetDataLoader(mLoader);
     state.keymap = mKeyMaps[window->GetKeyMapFile()];
     state.painter.SetFlag(UIPainter::Flags::ClipWidgets, true);
+    state.painter.SetFlag(UIPainter::Flags::GlyphAtlasText, mGlyphAtlasText);
+    state.painter.SetFlag(UIPainter::Flags::DistanceFieldText, mDistanceFieldText);
     state.painter.SetStyle(state.style.get());
     state.painter.SetClassLib(mClassLib);
 
@@ -588,7 +588,12 @@ namespace engine
         {}
         enum class Flags {
             ClipWidgets,
-            DesignMode
+            DesignMode,
+            // Draw the widget texts as glyph quads sampling the
+            // shared glyph atlas instead of rasterizing the texts.
+            GlyphAtlasText,
+            // Use distance field glyphs with the glyph atlas text.
+            DistanceFieldText
         };
 
         // uik::Painter implementation.
@@ -656,7 +661,7 @@ namespace engine
         { mFlags.set(flag, on_off); }
     private:
         uint8_t StencilPass() const;
-        void DrawText(const std::string& text, const std::string& font_name, int font_size,
+        void DrawText(const WidgetId& id, const std::string& text, const std::string& font_name, int font_size,
                       const gfx::FRect& rect, const gfx::Color4f & color, unsigned alignment, unsigned properties,
                       float line_height) const;
         enum class ShapeDirection {
@@ -773,6 +778,10 @@ namespace engine
 
         inline void SetEditingMode(bool on_off) noexcept
         { mEditingMode = on_off; }
+        inline void SetGlyphAtlasText(bool on_off) noexcept
+        { mGlyphAtlasText = on_off; }
+        inline void SetDistanceFieldText(bool on_off) noexcept
+        { mDistanceFieldText = on_off; }
         inline void SetClassLibrary(const ClassLibrary* classlib) noexcept
         { mClassLib = classlib; }
         inline void SetLoader(const Loader* loader) noexcept
@@ -885,6 +894,8 @@ namespace engine
         using UIActionQueue = std::queue<UIAction>;
 
         bool mEditingMode = false;
+        bool mGlyphAtlasText = false;
+        bool mDistanceFieldText = false;
         float mSurfaceWidth  = 0.0f;
         float mSurfaceHeight = 0.0f;
 
@@ -18,6 +18,7 @@
 
 #include <vector>
 #include <fstream>
+#include <algorithm>
 
 #include "base/test_minimal.h"
 #include "base/test_float.h"
@@ -26,6 +27,7 @@
 #include "graphics/drawable.h"
 #include "graphics/material.h"
 #include "graphics/material_class.h"
+#include "graphics/material_instance.h"
 #include "graphics/painter.h"
 #include "graphics/transform.h"
 #include "graphics/utility.h"
@@ -1276,6 +1278,197 @@ void unit_test_scene_culling()
 }
 
 
+void unit_test_scene_paint_node_culling()
+{
+    TEST_CASE(test::Type::Feature)
+
+    auto entity_klass = std::make_shared<game::EntityClass>();
+    {
+        game::DrawableItemClass red;
+        red.SetDrawableId("rect");
+        red.SetMaterialId("red");
+        red.SetLayer(0);
+
+        game::EntityNodeClass red_node;
+        red_node.SetName("red");
+        red_node.SetSize(glm::vec2(100.0f, 100.0f));
+        red_node.SetDrawable(red);
+
+        entity_klass->LinkChild(nullptr, entity_klass->AddNode(red_node));
+        entity_klass->SetName("entity");
+    }
+
+    auto scene_class = std::make_shared<game::SceneClass>();
+    {
+        game::EntityPlacement node;
+        node.SetEntity(entity_klass);
+        node.SetName("visible");
+        node.SetTranslation(glm::vec2(0.0f, 0.0f));
+        scene_class->LinkChild(nullptr, scene_class->PlaceEntity(node));
+    }
+    {
+        game::EntityPlacement node;
+        node.SetEntity(entity_klass);
+        node.SetName("far-away");
+        node.SetTranslation(glm::vec2(1000.0f, 0.0f));
+        scene_class->LinkChild(nullptr, scene_class->PlaceEntity(node));
+    }
+    {
+        // partially visible, the node's bounds overlap the viewport edge
+        game::EntityPlacement node;
+        node.SetEntity(entity_klass);
+        node.SetName("edge");
+        node.SetTranslation(glm::vec2(-340.0f, 0.0f));
+        node.SetRotation(math::Pi * 0.25f);
+        scene_class->LinkChild(nullptr, scene_class->PlaceEntity(node));
+    }
+    auto scene = game::CreateSceneInstance(scene_class);
+
+    DummyClassLib classlib;
+    engine::Renderer renderer(&classlib);
+    renderer.SetEditingMode(false);
+    renderer.CreateRendererState(*scene, nullptr);
+    TEST_REQUIRE(renderer.GetNumPaintNodes() == 3);
+
+    engine::Renderer::Surface surface;
+    surface.size     = gfx::USize(600, 600);
+    surface.viewport = gfx::IRect(0, 0, 600, 600);
+    renderer.SetSurface(surface);
+
+    engine::Renderer::Camera camera;
+    camera.viewport = gfx::FRect(-300.0f, -300.0f, 600.0f, 600.0f);
+    camera.position = glm::vec2{0.0f, 0.0f};
+    renderer.SetCamera(camera);
+
+    renderer.CreateFrame(*scene, nullptr);
+    {
+        const auto& stats = renderer.GetFrameStats();
+        TEST_REQUIRE(stats.num_culled_paint_nodes == 1);
+        TEST_REQUIRE(stats.num_submitted_paint_nodes == 2);
+    }
+
+    // move the camera over to the far away entity.
+    camera.position = glm::vec2{1000.0f, 0.0f};
+    renderer.SetCamera(camera);
+    renderer.CreateFrame(*scene, nullptr);
+    {
+        const auto& stats = renderer.GetFrameStats();
+        TEST_REQUIRE(stats.num_culled_paint_nodes == 2);
+        TEST_REQUIRE(stats.num_submitted_paint_nodes == 1);
+    }
+
+    // zoom out so that everything is visible.
+    camera.position = glm::vec2{0.0f, 0.0f};
+    camera.scale    = glm::vec2{0.25f, 0.25f};
+    renderer.SetCamera(camera);
+    renderer.CreateFrame(*scene, nullptr);
+    {
+        const auto& stats = renderer.GetFrameStats();
+        TEST_REQUIRE(stats.num_culled_paint_nodes == 0);
+        TEST_REQUIRE(stats.num_submitted_paint_nodes == 3);
+    }
+}
+
+void unit_test_packet_sort_key()
+{
+    TEST_CASE(test::Type::Feature)
+
+    auto red_class = std::make_shared<gfx::ColorClass>(gfx::CreateMaterialClassFromColor(gfx::Color::Red));
+    auto green_class = std::make_shared<gfx::ColorClass>(gfx::CreateMaterialClassFromColor(gfx::Color::Green));
+    auto blend_class = std::make_shared<gfx::ColorClass>(gfx::CreateMaterialClassFromColor(gfx::Color::Blue));
+    blend_class->SetSurfaceType(gfx::MaterialClass::SurfaceType::Transparent);
+    red_class->SetSurfaceType(gfx::MaterialClass::SurfaceType::Opaque);
+    green_class->SetSurfaceType(gfx::MaterialClass::SurfaceType::Opaque);
+
+    std::shared_ptr<const gfx::Material> red   = gfx::CreateMaterialInstance(red_class);
+    std::shared_ptr<const gfx::Material> green = gfx::CreateMaterialInstance(green_class);
+    std::shared_ptr<const gfx::Material> blend = gfx::CreateMaterialInstance(blend_class);
+    std::shared_ptr<const gfx::Drawable> rect  = gfx::CreateDrawableInstance(std::make_shared<gfx::RectangleClass>());
+
+    const glm::mat4 view(1.0f);
+
+    const auto make_packet = [&](std::shared_ptr<const gfx::Material> material, int layer, int index,
+                                 engine::DrawPacket::DepthTest depth_test = engine::DrawPacket::DepthTest::LessOrEQual) {
+        engine::DrawPacket packet;
+        packet.material     = material;
+        packet.drawable     = rect;
+        packet.transform    = glm::mat4(1.0f);
+        packet.render_layer = layer;
+        packet.packet_index = index;
+        packet.depth_test   = depth_test;
+        return packet;
+    };
+    using Renderer = engine::LowLevelRenderer;
+
+    // render layer and packet index come first.
+    TEST_REQUIRE(Renderer::MakeSortKey(make_packet(red, 0, 0), view, 10) <
+                 Renderer::MakeSortKey(make_packet(red, 0, 1), view, 0));
+    TEST_REQUIRE(Renderer::MakeSortKey(make_packet(red, 0, 1), view, 10) <
+                 Renderer::MakeSortKey(make_packet(red, 1, 0), view, 0));
+
+    // opaque draws with the same material have the same key regardless
+    // of the submission order so they're grouped together.
+    TEST_REQUIRE(Renderer::MakeSortKey(make_packet(red, 0, 0), view, 0) ==
+                 Renderer::MakeSortKey(make_packet(red, 0, 0), view, 5));
+    TEST_REQUIRE(Renderer::MakeSortKey(make_packet(red, 0, 0), view, 0) !=
+                 Renderer::MakeSortKey(make_packet(green, 0, 0), view, 0));
+
+    // opaque draws are before the transparent draws and the transparent
+    // draws keep their submission order.
+    TEST_REQUIRE(Renderer::MakeSortKey(make_packet(red, 0, 0), view, 5) <
+                 Renderer::MakeSortKey(make_packet(blend, 0, 0), view, 0));
+    TEST_REQUIRE(Renderer::MakeSortKey(make_packet(blend, 0, 0), view, 0) <
+                 Renderer::MakeSortKey(make_packet(blend, 0, 0), view, 1));
+
+    // interleaved opaque materials are grouped by material and
+    // otherwise keep their submission order.
+    {
+        std::vector<std::shared_ptr<const gfx::Material>> materials = {
+            red, green, blend, red, green, blend
+        };
+        std::vector<std::pair<std::uint64_t, std::uint32_t>> keys;
+        for (std::uint32_t i=0; i<materials.size(); ++i)
+            keys.emplace_back(Renderer::MakeSortKey(make_packet(materials[i], 0, 0), view, i), i);
+        std::sort(keys.begin(), keys.end());
+
+        TEST_REQUIRE(materials[keys[0].second] == materials[keys[1].second]);
+        TEST_REQUIRE(materials[keys[2].second] == materials[keys[3].second]);
+        TEST_REQUIRE(keys[0].second < keys[1].second);
+        TEST_REQUIRE(keys[2].second < keys[3].second);
+        TEST_REQUIRE(keys[4].second == 2);
+        TEST_REQUIRE(keys[5].second == 5);
+    }
+
+    // without depth testing overlapping opaque draws must keep their
+    // submission order since nothing else resolves the visibility.
+    {
+        constexpr auto NoDepth = engine::DrawPacket::DepthTest::Disabled;
+        TEST_REQUIRE(Renderer::MakeSortKey(make_packet(red, 0, 0, NoDepth), view, 0) <
+                     Renderer::MakeSortKey(make_packet(green, 0, 0, NoDepth), view, 1));
+        TEST_REQUIRE(Renderer::MakeSortKey(make_packet(green, 0, 0, NoDepth), view, 0) <
+                     Renderer::MakeSortKey(make_packet(red, 0, 0, NoDepth), view, 1));
+        TEST_REQUIRE(Renderer::MakeSortKey(make_packet(red, 0, 0, NoDepth), view, 0) <
+                     Renderer::MakeSortKey(make_packet(red, 0, 0, NoDepth), view, 1));
+        // transparent draws blend over the opaque draws submitted before them.
+        TEST_REQUIRE(Renderer::MakeSortKey(make_packet(blend, 0, 0, NoDepth), view, 0) <
+                     Renderer::MakeSortKey(make_packet(red, 0, 0, NoDepth), view, 1));
+
+        std::vector<std::shared_ptr<const gfx::Material>> materials = {
+            green, red, blend, red, green
+        };
+        std::vector<std::pair<std::uint64_t, std::uint32_t>> keys;
+        for (std::uint32_t i=0; i<materials.size(); ++i)
+            keys.emplace_back(Renderer::MakeSortKey(make_packet(materials[i], 0, 0, NoDepth), view, i), i);
+        std::sort(keys.begin(), keys.end());
+        for (std::uint32_t i=0; i<keys.size(); ++i)
+            TEST_REQUIRE(keys[i].second == i);
+
+        // the layer and the packet index still come first.
+        TEST_REQUIRE(Renderer::MakeSortKey(make_packet(red, 0, 1, NoDepth), view, 0) >
+                     Renderer::MakeSortKey(make_packet(green, 0, 0, NoDepth), view, 1));
+    }
+}
+
 EXPORT_TEST_MAIN(
 int test_main(int argc, char* argv[])
 {
@@ -1289,6 +1482,8 @@ int test_main(int argc, char* argv[])
     unit_test_axis_aligned_map();
 
     unit_test_scene_culling();
+    unit_test_scene_paint_node_culling();
+    unit_test_packet_sort_key();
 
     return 0;
 }
@@ -24,6 +24,8 @@
 #include <algorithm>
 #include <set>
 #include <unordered_map>
+#include <mutex>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/assert.h"
@@ -48,6 +50,52 @@
 #include "game/entity_node_fixture.h"
 #include "game/entity_node_tilemap_node.h"
 
+namespace {
+// Issue the entity node handles. Entities can be created and destroyed
+// from different threads (for example the editor and the engine
+// loader) so this needs to be thread safe.
+class EntityNodeHandleAllocator
+{
+public:
+    game::EntityNodeHandle Allocate()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        game::EntityNodeHandle handle;
+        if (mFreeList.empty())
+        {
+            handle.index = static_cast<std::uint32_t>(mGenerations.size());
+            handle.generation = 1;
+            mGenerations.push_back(handle.generation);
+            return handle;
+        }
+        handle.index = mFreeList.back();
+        handle.generation = mGenerations[handle.index];
+        mFreeList.pop_back();
+        return handle;
+    }
+    void Release(game::EntityNodeHandle handle)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        ASSERT(handle.index < mGenerations.size());
+        ASSERT(mGenerations[handle.index] == handle.generation);
+        // generation 0 is reserved for the invalid handle.
+        auto& generation = mGenerations[handle.index];
+        if (++generation == 0)
+            generation = 1;
+        mFreeList.push_back(handle.index);
+    }
+    static EntityNodeHandleAllocator& Get()
+    {
+        static EntityNodeHandleAllocator allocator;
+        return allocator;
+    }
+private:
+    std::mutex mMutex;
+    std::vector<std::uint32_t> mGenerations;
+    std::vector<std::uint32_t> mFreeList;
+};
+} // namespace
+
 namespace game
 {
 
@@ -76,6 +124,8 @@ Entity::Entity(std::shared_ptr<const EntityClass> klass)
             auto node_klass = mClass->GetSharedEntityNodeClass(i);
             EntityNode node(node_klass, allocator);
             node.SetEntity(this);
+            node.SetHandle(EntityNodeHandleAllocator::Get().Allocate());
+            node.GetTransform()->entity_dirty = &mNodeTransformsDirty;
             mNodes.push_back(std::move(node));
             map[node_klass.get()] = &mNodes.back();
         }
@@ -209,6 +259,11 @@ Entity::Entity(const EntityClass& klass)
 
 Entity::~Entity()
 {
+    for (auto& node : mNodes)
+    {
+        EntityNodeHandleAllocator::Get().Release(node.GetHandle());
+    }
+
     if (auto* allocator = mClass->GetAllocator())
     {
         for (auto& node: mNodes)
@@ -342,34 +397,77 @@ Float2 Entity::MapCoordsToNodeBox(const Float2& pos, const EntityNode* node) con
 
 glm::mat4 Entity::FindNodeTransform(const EntityNode* node) const
 {
-    return game::FindNodeTransform(mRenderTree, node);
+    if (node == nullptr || node->GetEntity() != this)
+        return game::FindNodeTransform(mRenderTree, node);
+
+    UpdateNodeTransforms();
+    return node->GetTransform()->node_to_entity;
 }
 glm::mat4 Entity::FindNodeModelTransform(const EntityNode* node) const
 {
-    return game::FindNodeModelTransform(mRenderTree, node);
+    return FindNodeTransform(node) * node->GetModelTransform();
 }
 
 glm::mat4 Entity::FindRelativeTransform(const EntityNode* parent, const EntityNode* child) const
 {
-    const auto& parent_to_world = game::FindNodeTransform(mRenderTree, parent);
-    const auto& child_to_world  = game::FindNodeTransform(mRenderTree, child);
+    const auto& parent_to_world = FindNodeTransform(parent);
+    const auto& child_to_world  = FindNodeTransform(child);
     const auto& world_to_parent = glm::inverse(parent_to_world);
     return world_to_parent * child_to_world;
 }
 
 FRect Entity::FindNodeBoundingRect(const EntityNode* node) const
 {
-    return game::FindBoundingRect(mRenderTree, node);
+    return game::ComputeBoundingRect(FindNodeModelTransform(node));
 }
 
 FRect Entity::GetBoundingRect() const
 {
-    return game::FindBoundingRect(mRenderTree);
+    UpdateNodeTransforms();
+
+    FRect ret;
+    for (const auto& node : mNodes)
+    {
+        const auto& mat = node.GetTransform()->node_to_entity * node.GetModelTransform();
+        ret = Union(ret, game::ComputeBoundingRect(mat));
+    }
+    return ret;
 }
 
 FBox Entity::FindNodeBoundingBox(const EntityNode* node) const
 {
-    return game::FindBoundingBox(mRenderTree, node);
+    return FBox(FindNodeModelTransform(node));
+}
+
+void Entity::UpdateNodeTransforms() const
+{
+    if (!mNodeTransformsDirty)
+        return;
+
+    // the root node is null, start from there and walk the whole
+    // hierarchy but only recompute the sub-trees that have changed.
+    const glm::mat4 identity(1.0f);
+    mRenderTree.ForEachChild([this, &identity](const EntityNode* child) {
+        UpdateNodeTransforms(child, identity, false);
+    }, nullptr);
+
+    mNodeTransformsDirty = false;
+}
+
+void Entity::UpdateNodeTransforms(const EntityNode* node, const glm::mat4& parent_to_entity, bool parent_changed) const
+{
+    const auto* transform = node->GetTransform();
+    const bool changed = parent_changed || transform->dirty;
+    if (changed)
+    {
+        transform->node_to_entity = parent_to_entity * node->GetNodeTransform();
+        transform->dirty = false;
+    }
+    const auto& node_to_entity = transform->node_to_entity;
+
+    mRenderTree.ForEachChild([this, &node_to_entity, changed](const EntityNode* child) {
+        UpdateNodeTransforms(child, node_to_entity, changed);
+    }, node);
 }
 
 void Entity::Die()
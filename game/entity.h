@@ -202,7 +202,11 @@ namespace game
         // Compute the oriented bounding box (OOB) for the given entity node.
         FBox FindNodeBoundingBox(const EntityNode* node) const;
 
-        // todo:
+        // Find the node to entity transform for the given node. The
+        // result is served from a per node cache that is recomputed
+        // lazily only for the nodes whose transform (or some parent's
+        // transform) has changed since the last query.
+        // Note that the cache is not thread safe.
         glm::mat4 FindNodeTransform(const EntityNode* node) const;
         glm::mat4 FindNodeModelTransform(const EntityNode* node) const;
         glm::mat4 FindRelativeTransform(const EntityNode* parent, const EntityNode* child) const;
@@ -424,6 +428,8 @@ namespace game
 
         Entity& operator=(const Entity&) = delete;
     private:
+        void UpdateNodeTransforms() const;
+        void UpdateNodeTransforms(const EntityNode* node, const glm::mat4& parent_to_entity, bool parent_changed) const;
         // the class object.
         std::shared_ptr<const EntityClass> mClass;
         // The entity instance id.
@@ -450,6 +456,9 @@ namespace game
         // the render tree for hierarchical traversal and transformation
         // of the entity and its nodes.
         RenderTree mRenderTree;
+        // flag to indicate that some node's cached node to entity
+        // transform is stale. set by the nodes' transform objects.
+        mutable bool mNodeTransformsDirty = true;
         // the current scene.
         Scene* mScene = nullptr;
         // remaining time for the until scheduled death takes place
@@ -454,6 +454,7 @@ EntityNode::EntityNode(EntityNode&& other) noexcept
    , mAllocatorIndex(other.mAllocatorIndex)
    , mTransform     (other.mTransform)
    , mNodeData      (other.mNodeData)
+   , mHandle        (other.mHandle)
    , mRigidBody     (std::move(other.mRigidBody))
    , mDrawable      (std::move(other.mDrawable))
    , mTextItem      (std::move(other.mTextItem))
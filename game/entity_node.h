@@ -26,6 +26,7 @@
 
 #include <string>
 #include <memory>
+#include <cstdint>
 
 #include "base/allocator.h"
 #include "base/bitflag.h"
@@ -364,6 +365,18 @@ namespace game
         // Rotation around z axis in radians relative to parent.
         float rotation = 0.0f;
 
+        // Cached node to entity transform, i.e. the product of all
+        // the node transforms from the top level node down to this
+        // node. Maintained by Entity::UpdateNodeTransforms. The size
+        // is not part of this transform so changing it doesn't
+        // invalidate the cache.
+        mutable glm::mat4 node_to_entity = glm::mat4(1.0f);
+        // When true the cached node_to_entity is stale.
+        mutable bool dirty = true;
+        // Points to the owning entity's flag that indicates that
+        // some node's cached transform needs to be recomputed.
+        bool* entity_dirty = nullptr;
+
         EntityNodeTransform() = default;
         explicit EntityNodeTransform(const EntityNodeClass& klass)
           : translation(klass.GetTranslation())
@@ -373,30 +386,50 @@ namespace game
         {}
 
         void SetScale(glm::vec2 scale) noexcept
-        { this->scale = scale; }
+        {
+            this->scale = scale;
+            MarkDirty();
+        }
         void SetScale(float sx, float sy) noexcept
-        { this->scale = glm::vec2(sx, sy); }
+        { SetScale(glm::vec2(sx, sy)); }
         void SetSize(glm::vec2 size) noexcept
         { this->size = size; }
         void SetSize(float width, float height) noexcept
         { this->size = glm::vec2(width, height); }
         void SetTranslation(glm::vec2 pos) noexcept
-        { this->translation = pos; }
+        {
+            this->translation = pos;
+            MarkDirty();
+        }
         void SetTranslation(float x, float y) noexcept
-        { this->translation = glm::vec2(x, y); }
+        { SetTranslation(glm::vec2(x, y)); }
         void SetRotation(float rotation) noexcept
-        { this->rotation = rotation; }
+        {
+            this->rotation = rotation;
+            MarkDirty();
+        }
         void Translate(glm::vec2 vec) noexcept
-        { this->translation += vec; }
+        { SetTranslation(this->translation + vec); }
         void Translate(float dx, float dy) noexcept
-        { this->translation += glm::vec2(dx, dy); }
+        { SetTranslation(this->translation + glm::vec2(dx, dy)); }
         void Rotate(float dr) noexcept
-        { this->rotation += dr; }
+        { SetRotation(this->rotation + dr); }
         void Grow(glm::vec2 vec) noexcept
         { this->size += vec; }
         void Grow(float dx, float dy) noexcept
         { this->size += glm::vec2(dx, dy); }
 
+        // Flag the cached node to entity transform as stale. This
+        // must be called whenever translation, scale or rotation
+        // changes. Writing to the public members directly bypasses
+        // the cache invalidation so use the setters instead.
+        void MarkDirty() noexcept
+        {
+            this->dirty = true;
+            if (this->entity_dirty)
+                *this->entity_dirty = true;
+        }
+
         glm::vec2 GetXVector() const noexcept
         { return math::RotateVectorAroundZ(glm::vec2{1.0f, 0.0f}, this->rotation); }
         glm::vec2 GetYVector() const noexcept
@@ -428,6 +461,25 @@ namespace game
 
     class EntityNode;
 
+    // A compact handle for identifying an entity node instance. The handles
+    // are issued by the entity when it's created and released when the entity
+    // is destroyed. The index part can be used to index into some array of
+    // per node data and the generation tells whether the data at that index
+    // still belongs to the same node. Each time an index is recycled its
+    // generation is bumped so any stale handle will no longer compare equal.
+    struct EntityNodeHandle {
+        std::uint32_t index = 0;
+        std::uint32_t generation = 0;
+
+        bool IsValid() const noexcept
+        { return generation != 0; }
+    };
+
+    inline bool operator==(const EntityNodeHandle& lhs, const EntityNodeHandle& rhs) noexcept
+    { return lhs.index == rhs.index && lhs.generation == rhs.generation; }
+    inline bool operator!=(const EntityNodeHandle& lhs, const EntityNodeHandle& rhs) noexcept
+    { return !(lhs == rhs); }
+
     class EntityNodeData {
     public:
         EntityNodeData(std::string id, std::string name) noexcept
@@ -480,29 +532,29 @@ namespace game
 
         // transformation
         void SetScale(glm::vec2 scale) noexcept
-        { mTransform->scale = scale; }
+        { mTransform->SetScale(scale); }
         void SetScale(float sx, float sy) noexcept
-        { mTransform->scale = glm::vec2(sx, sy); }
+        { mTransform->SetScale(sx, sy); }
         void SetSize(const glm::vec2& size) noexcept
-        { mTransform->size = size; }
+        { mTransform->SetSize(size); }
         void SetSize(float width, float height) noexcept
-        { mTransform->size = glm::vec2(width, height); }
+        { mTransform->SetSize(width, height); }
         void SetTranslation(glm::vec2 pos) noexcept
-        { mTransform->translation = pos; }
+        { mTransform->SetTranslation(pos); }
         void SetTranslation(float x, float y) noexcept
-        { mTransform->translation = glm::vec2(x, y); }
+        { mTransform->SetTranslation(x, y); }
         void SetRotation(float rotation) noexcept
-        { mTransform->rotation = rotation; }
+        { mTransform->SetRotation(rotation); }
         void Translate(const glm::vec2& vec) noexcept
-        { mTransform->translation += vec; }
+        { mTransform->Translate(vec); }
         void Translate(float dx, float dy) noexcept
-        { mTransform->translation += glm::vec2(dx, dy); }
+        { mTransform->Translate(dx, dy); }
         void Rotate(float dr) noexcept
-        { mTransform->rotation += dr; }
+        { mTransform->Rotate(dr); }
         void Grow(glm::vec2 vec) noexcept
-        { mTransform->size += vec; }
+        { mTransform->Grow(vec); }
         void Grow(float dx, float dy) noexcept
-        { mTransform->size += glm::vec2(dx, dy); }
+        { mTransform->Grow(dx, dy); }
         glm::vec2 GetTranslation() const noexcept
         { return mTransform->translation; }
         glm::vec2 GetScale() const noexcept
@@ -541,6 +593,12 @@ namespace game
 
         void SetEntity(Entity* entity) noexcept
         { mNodeData->mEntity = entity; }
+        void SetHandle(EntityNodeHandle handle) noexcept
+        { mHandle = handle; }
+        // Get the node's handle. The handle is only valid when
+        // the node is owned by an entity.
+        EntityNodeHandle GetHandle() const noexcept
+        { return mHandle; }
 
         EntityNodeTransform* GetTransform() noexcept;
         EntityNodeData* GetData() noexcept;
@@ -624,6 +682,8 @@ namespace game
         EntityNodeTransform* mTransform = nullptr;
         // data object
         EntityNodeData* mNodeData = nullptr;
+        // the handle issued by the owning entity.
+        EntityNodeHandle mHandle;
         // rigid body if any.
         std::unique_ptr<RigidBody> mRigidBody;
         // drawable if any.
@@ -19,6 +19,7 @@
 #include "config.h"
 
 #include <memory>
+#include <cstddef>
 
 #include "base/bitflag.h"
 #include "data/fwd.h"
@@ -75,6 +76,12 @@ namespace game
         { mFlags.set(Flags::Enabled, value); }
         inline void SetFlag(Flags flag, bool on_off) noexcept
         { mFlags.set(flag, on_off); }
+        // Handle to the item in the scene's spatial index (if any)
+        // 0 means the node is currently not in the index.
+        inline std::size_t GetIndexHandle() const noexcept
+        { return mIndexHandle; }
+        inline void SetIndexHandle(std::size_t handle) noexcept
+        { mIndexHandle = handle; }
 
         // class access
         const SpatialNodeClass& GetClass() const noexcept
@@ -84,6 +91,7 @@ namespace game
     private:
         std::shared_ptr<const SpatialNodeClass> mClass;
         base::bitflag<Flags> mFlags;
+        std::size_t mIndexHandle = 0;
     };
 
 } // namespace
\ No newline at end of file
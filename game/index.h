@@ -26,7 +26,9 @@
 #include <vector>
 #include <cstddef>
 
+#include "base/assert.h"
 #include "base/grid.h"
+#include "base/aabb_tree.h"
 #include "game/tree.h"
 #include "game/treeop.h"
 #include "game/types.h"
@@ -38,14 +40,123 @@ namespace game
     class SpatialIndex
     {
     public:
-        struct Item {
-            T* object;
-            FRect rect;
-        };
+        // Handle to an item in the index. The handle remains valid until
+        // the item is removed from the index. 0 is never a valid handle.
+        using ItemHandle = std::size_t;
+        static constexpr ItemHandle InvalidHandle = 0;
 
         virtual ~SpatialIndex() = default;
-        virtual void Insert(const FRect& rect, const std::vector<Item>& items) = 0;
-        virtual void Erase(const std::set<T*>& killset) = 0;
+
+        // Insert a new object with the given bounding rect into the index.
+        // Returns a handle that can later be used to move or remove the item.
+        ItemHandle Insert(T* object, const FRect& rect)
+        {
+            ItemHandle handle = InvalidHandle;
+            if (mFreeList.empty())
+            {
+                mItems.emplace_back();
+                handle = mItems.size();
+            }
+            else
+            {
+                handle = mFreeList.back();
+                mFreeList.pop_back();
+            }
+            auto& item = mItems[handle-1];
+            item.object  = object;
+            item.rect    = rect;
+            item.alive   = true;
+            item.indexed = TryInsert(handle, object, rect);
+            ++mNumItems;
+            return handle;
+        }
+        // Move an existing item to a new bounding rect. If the rect hasn't
+        // changed this is a no-op. Otherwise, the item is moved from its
+        // current location to the new location.
+        void Move(ItemHandle handle, const FRect& rect)
+        {
+            auto& item = GetItem(handle);
+            if (IsSameRect(item.rect, rect))
+                return;
+            if (item.indexed && CanInsert(rect))
+            {
+                item.indexed = DoMove(handle, item.object, item.rect, rect);
+                if (!item.indexed)
+                    mNeedsReshape = true;
+            }
+            else
+            {
+                if (item.indexed)
+                    DoErase(handle, item.object, item.rect);
+                item.indexed = TryInsert(handle, item.object, rect);
+            }
+            item.rect = rect;
+        }
+        // Remove an item from the index. The handle is no longer valid after this.
+        void Remove(ItemHandle handle)
+        {
+            auto& item = GetItem(handle);
+            if (item.indexed)
+                DoErase(handle, item.object, item.rect);
+            item = Item {};
+            mFreeList.push_back(handle);
+            --mNumItems;
+        }
+        // Commit the pending changes. If any item has been placed outside the
+        // current bounds of the index the index is re-shaped to cover all the
+        // items with some extra space to spare and all the items are re-inserted.
+        // Otherwise, nothing is done. Indices without fixed bounds never need
+        // to be re-shaped. Items that are pending re-shape can't be
+        // found by queries before the changes are committed.
+        void Commit()
+        {
+            if (!mNeedsReshape)
+                return;
+
+            FRect bounds;
+            for (const auto& item : mItems)
+            {
+                if (item.alive)
+                    bounds = base::Union(bounds, item.rect);
+            }
+            // grow the bounds in order to avoid re-shaping again
+            // immediately when the items keep moving outwards.
+            // the extra unit is there to mitigate floating point
+            // precision issues at the edges of the bounds.
+            const auto extra_width  = bounds.GetWidth() * (GrowthFactor - 1.0f) * 0.5f + 1.0f;
+            const auto extra_height = bounds.GetHeight() * (GrowthFactor - 1.0f) * 0.5f + 1.0f;
+            bounds = FRect(bounds.GetX() - extra_width, bounds.GetY() - extra_height,
+                           bounds.GetWidth() + 2.0f * extra_width,
+                           bounds.GetHeight() + 2.0f * extra_height);
+            DoReshape(bounds);
+            mBounds = bounds;
+            mNeedsReshape = false;
+
+            for (std::size_t i=0; i<mItems.size(); ++i)
+            {
+                auto& item = mItems[i];
+                if (!item.alive)
+                    continue;
+                item.indexed = DoInsert(i+1, item.object, item.rect);
+            }
+            ++mNumReshapes;
+        }
+
+        // Get the number of items currently in the index.
+        std::size_t GetNumItems() const noexcept
+        { return mNumItems; }
+        // Get the number of times the index has been re-shaped.
+        std::size_t GetNumReshapes() const noexcept
+        { return mNumReshapes; }
+        // Get the current bounds covered by the index. Only meaningful
+        // for indices with fixed bounds.
+        FRect GetBounds() const noexcept
+        { return mBounds; }
+        // Get the object/rect of the item identified by the handle.
+        T* GetObject(ItemHandle handle) const noexcept
+        { return GetItem(handle).object; }
+        FRect GetRect(ItemHandle handle) const noexcept
+        { return GetItem(handle).rect; }
 
         // Query interface functions for specific query parameters
         // and result container types.
@@ -100,6 +211,7 @@ namespace game
             virtual ~SpatialQuery() = default;
             virtual void Execute(const base::QuadTree<T*>& tree) const = 0;
             virtual void Execute(const base::DenseSpatialGrid<T*>& grid) const = 0;
+            virtual void Execute(const base::AABBTree<T*>& tree) const = 0;
         private:
         };
         template<typename ResultContainer>
@@ -113,6 +225,8 @@ namespace game
             { QueryQuadTree(mRect, tree, mResult); }
             virtual void Execute(const base::DenseSpatialGrid<T*>& grid) const override
             { grid.Find(mRect, mResult); }
+            virtual void Execute(const base::AABBTree<T*>& tree) const override
+            { tree.Find(mRect, mResult); }
         private:
             const FRect mRect;
             ResultContainer* mResult;
@@ -144,6 +258,15 @@ namespace game
                 else if (mMode == QueryMode::First)
                     grid.Find(mPointA, mPointB, mResult, base::DenseSpatialGrid<T*>::FindMode::First);
             }
+            virtual void Execute(const base::AABBTree<T*>& tree) const override
+            {
+                if (mMode == QueryMode::Closest)
+                    tree.Find(mPointA, mPointB, mResult, base::AABBTree<T*>::FindMode::Closest);
+                else if (mMode == QueryMode::All)
+                    tree.Find(mPointA, mPointB, mResult, base::AABBTree<T*>::FindMode::All);
+                else if (mMode == QueryMode::First)
+                    tree.Find(mPointA, mPointB, mResult, base::AABBTree<T*>::FindMode::First);
+            }
         private:
             const FPoint mPointA;
             const FPoint mPointB;
@@ -178,6 +301,15 @@ namespace game
                 else if (mMode == QueryMode::First)
                     grid.Find(mPoint, mResult, base::DenseSpatialGrid<T*>::FindMode::First);
             }
+            virtual void Execute(const base::AABBTree<T*>& tree) const override
+            {
+                if (mMode == QueryMode::Closest)
+                    tree.Find(mPoint, mResult, base::AABBTree<T*>::FindMode::Closest);
+                else if (mMode == QueryMode::All)
+                    tree.Find(mPoint, mResult, base::AABBTree<T*>::FindMode::All);
+                else if (mMode == QueryMode::First)
+                    tree.Find(mPoint, mResult, base::AABBTree<T*>::FindMode::First);
+            }
         private:
             const FPoint mPoint;
             const QueryMode mMode;
@@ -211,6 +343,15 @@ namespace game
                 else if (mMode == QueryMode::First)
                     grid.Find(mPoint, mResult, base::DenseSpatialGrid<T*>::FindMode::First);
             }
+            virtual void Execute(const base::AABBTree<T*>& tree) const override
+            {
+                if (mMode == QueryMode::Closest)
+                    tree.Find(mPoint, mRadius, mResult, base::AABBTree<T*>::FindMode::Closest);
+                else if (mMode == QueryMode::All)
+                    tree.Find(mPoint, mRadius, mResult, base::AABBTree<T*>::FindMode::All);
+                else if (mMode == QueryMode::First)
+                    tree.Find(mPoint, mRadius, mResult, base::AABBTree<T*>::FindMode::First);
+            }
         private:
             const FPoint mPoint;
             const float mRadius;
@@ -219,38 +360,103 @@ namespace game
         };
     protected:
         virtual void ExecuteQuery(const SpatialQuery& query) const = 0;
+        // Returns true if the index data structure covers some fixed
+        // area and needs to be re-shaped when items move outside of it.
+        virtual bool HasFixedBounds() const
+        { return true; }
+        // Clear the index data structure and change its shape
+        // to cover the given rectangle.
+        virtual void DoReshape(const FRect& rect) = 0;
+        // Insert the object with the given rect into the index data
+        // structure. For indices with fixed bounds the rect is always
+        // within the current bounds.
+        virtual bool DoInsert(ItemHandle handle, T* object, const FRect& rect) = 0;
+        // Erase an object previously inserted with the given rect.
+        virtual void DoErase(ItemHandle handle, T* object, const FRect& rect) = 0;
+        // Move an object previously inserted with the old rect to the
+        // new rect. The default implementation erases and re-inserts.
+        virtual bool DoMove(ItemHandle handle, T* object, const FRect& old_rect, const FRect& new_rect)
+        {
+            DoErase(handle, object, old_rect);
+            return DoInsert(handle, object, new_rect);
+        }
+    private:
+        struct Item {
+            T* object = nullptr;
+            FRect rect;
+            // true when the item slot is in use.
+            bool alive = false;
+            // true when the item is currently in the index data structure.
+            bool indexed = false;
+        };
+        // how much to grow the bounds (relative to the current
+        // bounds of all items) when re-shaping the index.
+        static constexpr float GrowthFactor = 1.5f;
+
+        bool CanInsert(const FRect& rect) const
+        {
+            // once some item falls outside the bounds a re-shape is
+            // needed anyway so don't bother inserting any more items.
+            if (mNeedsReshape)
+                return false;
+            return !HasFixedBounds() || base::Contains(mBounds, rect);
+        }
+        bool TryInsert(ItemHandle handle, T* object, const FRect& rect)
+        {
+            if (CanInsert(rect) && DoInsert(handle, object, rect))
+                return true;
+            mNeedsReshape = true;
+            return false;
+        }
+        Item& GetItem(ItemHandle handle) noexcept
+        {
+            ASSERT(handle != InvalidHandle && handle <= mItems.size());
+            auto& item = mItems[handle-1];
+            ASSERT(item.alive);
+            return item;
+        }
+        const Item& GetItem(ItemHandle handle) const noexcept
+        {
+            ASSERT(handle != InvalidHandle && handle <= mItems.size());
+            const auto& item = mItems[handle-1];
+            ASSERT(item.alive);
+            return item;
+        }
+        static bool IsSameRect(const FRect& lhs, const FRect& rhs) noexcept
+        {
+            return lhs.GetX() == rhs.GetX() &&
+                   lhs.GetY() == rhs.GetY() &&
+                   lhs.GetWidth() == rhs.GetWidth() &&
+                   lhs.GetHeight() == rhs.GetHeight();
+        }
+    private:
+        std::vector<Item> mItems;
+        std::vector<ItemHandle> mFreeList;
+        std::size_t mNumItems = 0;
+        std::size_t mNumReshapes = 0;
+        FRect mBounds;
+        bool mNeedsReshape = false;
     };
 
     template<typename T>
     class QuadTreeIndex final : public SpatialIndex<T>
     {
     public:
-        using Item = typename SpatialIndex<T>::Item;
-
         QuadTreeIndex(unsigned max_items, unsigned max_levels)
           : mMaxItems(max_items)
           , mMaxLevels(max_levels)
         {}
-        virtual void Insert(const FRect& rect, const std::vector<Item>& items) override
-        {
-            // todo: re-compute the tree parameters ?
-            // todo: find some way to balance the tree ?
-            mTree.Clear();
-            mTree.Reshape(rect, mMaxItems, mMaxLevels);
-            for (const auto& item : items)
-                mTree.Insert(item.rect, item.object);
-        }
-
-        virtual void Erase(const std::set<T*>& killset) override
-        {
-            mTree.Erase([&killset](T* object, const base::FRect&) {
-                return base::Contains(killset, object);
-            });
-        }
     protected:
         using SpatialQuery = typename SpatialIndex<T>::SpatialQuery;
+        using ItemHandle   = typename SpatialIndex<T>::ItemHandle;
         virtual void ExecuteQuery(const SpatialQuery& query) const override
         { query.Execute(mTree); }
+        virtual void DoReshape(const FRect& rect) override
+        { mTree.Reshape(rect, mMaxItems, mMaxLevels); }
+        virtual bool DoInsert(ItemHandle, T* object, const FRect& rect) override
+        { return mTree.Insert(rect, object); }
+        virtual void DoErase(ItemHandle, T* object, const FRect& rect) override
+        { mTree.Erase(rect, object); }
     private:
         const unsigned mMaxItems = 0;
         const unsigned mMaxLevels = 0;
@@ -261,36 +467,74 @@ namespace game
     class DenseGridIndex final : public SpatialIndex<T>
     {
     public:
-        using Item = typename SpatialIndex<T>::Item;
-
         DenseGridIndex(unsigned rows, unsigned cols)
           : mNumRows(rows)
           , mNumCols(cols)
         {}
-        virtual void Insert(const FRect& rect, const std::vector<Item>& items) override
-        {
-            // todo: re-compute the grid parameters ?
-            // todo: find some way to balance the grid ?
-            mGrid.Clear();
-            mGrid.Reshape(rect, mNumRows, mNumCols);
-            for (const auto& item : items)
-                mGrid.Insert(item.rect, item.object);
-        }
-
-        virtual void Erase(const std::set<T*>& killset) override
-        {
-            mGrid.Erase([&killset](T* object, const base::FRect& rect) {
-                return base::Contains(killset, object);
-            });
-        }
     protected:
         using SpatialQuery = typename SpatialIndex<T>::SpatialQuery;
+        using ItemHandle   = typename SpatialIndex<T>::ItemHandle;
         virtual void ExecuteQuery(const SpatialQuery& query) const override
         { query.Execute(mGrid); }
+        virtual void DoReshape(const FRect& rect) override
+        { mGrid.Reshape(rect, mNumRows, mNumCols); }
+        virtual bool DoInsert(ItemHandle, T* object, const FRect& rect) override
+        { return mGrid.Insert(rect, object); }
+        virtual void DoErase(ItemHandle, T* object, const FRect& rect) override
+        { mGrid.Erase(rect, object); }
     private:
         const unsigned mNumRows = 0;
         const unsigned mNumCols = 0;
         base::DenseSpatialGrid<T*> mGrid;
     };
 
+    template<typename T>
+    class AABBTreeIndex final : public SpatialIndex<T>
+    {
+    public:
+        AABBTreeIndex() = default;
+        AABBTreeIndex(float margin_factor, float margin)
+          : mTree(margin_factor, margin)
+        {}
+        // Get the current height of the tree for diagnostics.
+        unsigned GetHeight() const noexcept
+        { return mTree.GetHeight(); }
+    protected:
+        using SpatialQuery = typename SpatialIndex<T>::SpatialQuery;
+        using ItemHandle   = typename SpatialIndex<T>::ItemHandle;
+        using Tree         = base::AABBTree<T*>;
+        virtual void ExecuteQuery(const SpatialQuery& query) const override
+        { query.Execute(mTree); }
+        virtual bool HasFixedBounds() const override
+        { return false; }
+        virtual void DoReshape(const FRect& rect) override
+        {
+            mTree.Clear();
+            mProxies.clear();
+        }
+        virtual bool DoInsert(ItemHandle handle, T* object, const FRect& rect) override
+        {
+            if (handle > mProxies.size())
+                mProxies.resize(handle, Tree::NullProxy);
+            mProxies[handle-1] = mTree.Insert(rect, object);
+            return true;
+        }
+        virtual void DoErase(ItemHandle handle, T* object, const FRect& rect) override
+        {
+            auto& proxy = base::SafeIndex(mProxies, handle-1);
+            mTree.Erase(proxy);
+            proxy = Tree::NullProxy;
+        }
+        virtual bool DoMove(ItemHandle handle, T* object, const FRect& old_rect, const FRect& new_rect) override
+        {
+            // the tree only changes if the item moves outside its fat rect.
+            mTree.Move(base::SafeIndex(mProxies, handle-1), new_rect);
+            return true;
+        }
+    private:
+        Tree mTree;
+        // mapping from the index item handle (-1) to the tree proxy.
+        std::vector<typename Tree::ProxyId> mProxies;
+    };
+
 } // namespace
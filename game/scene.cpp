@@ -211,6 +211,11 @@ Scene::Scene(std::shared_ptr<const SceneClass> klass)
         DEBUG("Created scene spatial index. [type=%1, rows=%2, cols=%3]",
               index, args->num_rows, args->num_cols);
     }
+    else if (index == SceneClass::SpatialIndex::AABBTree)
+    {
+        mSpatialIndex.reset(new AABBTreeIndex<EntityNode>());
+        DEBUG("Created scene spatial index. [type=%1]", index);
+    }
     if (spatial_nodes && !mSpatialIndex)
     {
         WARN("Scene entities have spatial nodes but scene has no spatial index set.\n"
@@ -436,6 +441,7 @@ void Scene::BeginLoop()
         mNameMap[entity->GetName()] = entity.get();
         mRenderTree.LinkChild(nullptr, entity.get());
         mEntities.push_back(std::move(entity));
+        mNodesDirty = true;
     }
 
     base::EraseRemove(mSpawnList, [](auto& record) {
@@ -447,8 +453,6 @@ void Scene::BeginLoop()
 
 void Scene::EndLoop()
 {
-    std::set<EntityNode*> killed_spatial_nodes;
-
     for (auto& entity : mEntities)
     {
         // turn off spawn flags.
@@ -468,19 +472,21 @@ void Scene::EndLoop()
 
         mRenderTree.DeleteNode(entity.get());
         mNameMap.erase(entity->GetName());
+        mNodesDirty = true;
 
         if (mSpatialIndex)
         {
             for (size_t i = 0; i < entity->GetNumNodes(); ++i)
             {
-                auto& node = entity->GetNode(i);
-                if (node.HasSpatialNode())
-                    killed_spatial_nodes.insert(&node);
+                auto* spatial = entity->GetNode(i).GetSpatialNode();
+                if (spatial && spatial->GetIndexHandle())
+                {
+                    mSpatialIndex->Remove(spatial->GetIndexHandle());
+                    spatial->SetIndexHandle(SpatialIndex::InvalidHandle);
+                }
             }
         }
     }
-    if (mSpatialIndex)
-        mSpatialIndex->Erase(killed_spatial_nodes);
 
     if (auto* task_pool = base::GetGlobalThreadPool())
     {
@@ -522,30 +528,51 @@ void Scene::EndLoop()
     }
 }
 
-std::vector<Scene::ConstSceneNode> Scene::CollectNodes() const
+const std::vector<Scene::ConstSceneNode>& Scene::CollectNodes() const
 {
-    std::vector<ConstSceneNode> ret;
-    for (auto& entity : mEntities)
-    {
-        ConstSceneNode node;
-        node.node_to_scene = FindEntityTransform(entity.get());
-        node.entity = entity.get();
-        ret.push_back(std::move(node));
-    }
-    return ret;
+    UpdateNodes();
+    return mConstNodes;
 }
 
-std::vector<Scene::SceneNode> Scene::CollectNodes()
+const std::vector<Scene::SceneNode>& Scene::CollectNodes()
 {
-    std::vector<SceneNode> ret;
-    for (auto& entity : mEntities)
+    UpdateNodes();
+    return mNodes;
+}
+
+void Scene::UpdateNodes() const
+{
+    if (mNodesDirty)
     {
-        SceneNode node;
-        node.node_to_scene = FindEntityTransform(entity.get());
-        node.entity = entity.get();
-        ret.push_back(std::move(node));
+        mNodes.resize(mEntities.size());
+        mConstNodes.resize(mEntities.size());
+        mLinkedNodes.clear();
+
+        for (size_t i=0; i<mEntities.size(); ++i)
+        {
+            auto* entity = mEntities[i].get();
+            mNodes[i].entity = entity;
+            mNodes[i].node_to_scene = glm::mat4(1.0f);
+            mConstNodes[i].entity = entity;
+            mConstNodes[i].node_to_scene = glm::mat4(1.0f);
+            // entities that are linked directly to the root have
+            // an identity transform that never changes.
+            if (mRenderTree.HasNode(entity) && mRenderTree.GetParent(entity))
+                mLinkedNodes.push_back(i);
+        }
+        mNodesDirty = false;
+    }
+
+    // the parent entities' node transforms might have changed
+    // since the last time. the parent entities keep their own
+    // node transforms cached so this is cheap when nothing has
+    // changed.
+    for (auto index : mLinkedNodes)
+    {
+        const auto& node_to_scene = FindEntityTransform(mNodes[index].entity);
+        mNodes[index].node_to_scene = node_to_scene;
+        mConstNodes[index].node_to_scene = node_to_scene;
     }
-    return ret;
 }
 
 glm::mat4 Scene::FindEntityTransform(const Entity* entity) const
@@ -555,58 +582,19 @@ glm::mat4 Scene::FindEntityTransform(const Entity* entity) const
     if (!mRenderTree.HasNode(entity) || !mRenderTree.GetParent(entity))
         return glm::mat4(1.0f);
 
-    // search the render tree until we find the entity.
-    class Visitor : public RenderTree::ConstVisitor {
-    public:
-        Visitor(const Entity* entity) : mEntity(entity), mMatrix(1.0f)
-        {}
-        virtual void EnterNode(const Entity* entity) override
-        {
-            if (!entity)
-                return;
-            glm::mat4 parent_node_transform(1.0f);
-            if (const auto* parent = GetParent())
-            {
-                const auto* parent_node = parent->FindNodeByClassId(entity->GetParentNodeClassId());
-                parent_node_transform   = parent->FindNodeTransform(parent_node);
-            }
-            mParents.push(entity);
-            mTransform.Push(parent_node_transform);
-            if (entity == mEntity)
-            {
-                mMatrix = mTransform.GetAsMatrix();
-                mDone = true;
-            }
-        }
-        virtual void LeaveNode(const Entity* entity) override
-        {
-            if (!entity)
-                return;
-            mTransform.Pop();
-            mParents.pop();
-        }
-        virtual bool IsDone() const override
-        { return mDone; }
-
-        glm::mat4 GetMatrix() const
-        { return mMatrix; }
-    private:
-        const Entity* GetParent() const
-        {
-            if (mParents.empty())
-                return nullptr;
-            return mParents.top();
-        }
-    private:
-        const Entity* mEntity = nullptr;
-        std::stack<const Entity*> mParents;
-        glm::mat4 mMatrix;
-        Transform mTransform;
-        bool mDone = false;
-    };
-    Visitor visitor(entity);
-    mRenderTree.PreOrderTraverse(visitor);
-    return visitor.GetMatrix();
+    // walk up the render tree towards the root and accumulate the
+    // parent node transforms. Each parent entity keeps its node
+    // transforms cached so this is proportional to the depth of the
+    // entity hierarchy instead of the number of entities in the scene.
+    glm::mat4 matrix(1.0f);
+    while (const auto* parent = mRenderTree.GetParent(entity))
+    {
+        const auto* parent_node = parent->FindNodeByClassId(entity->GetParentNodeClassId());
+        if (parent_node)
+            matrix = parent->FindNodeTransform(parent_node) * matrix;
+        entity = parent;
+    }
+    return matrix;
 }
 
 glm::mat4 Scene::FindEntityNodeTransform(const Entity* entity, const EntityNode* node) const
@@ -782,7 +770,9 @@ void Scene::Rebuild()
 
     // Iterate over the render tree and look for entity nodes that have
     // SpatialNode attachment. For the nodes with spatial node compute
-    // the node's AABB and place that node into the spatial index.
+    // the node's AABB and update the node's item in the spatial index.
+    // The index is updated incrementally, i.e. only the items that
+    // have actually moved are touched.
     class Visitor final : public RenderTree::Visitor {
     public:
         Visitor(SpatialIndex* index, Scene* scene, float left, float right, float top, float bottom)
@@ -790,10 +780,6 @@ void Scene::Rebuild()
             , mRightBound(right)
             , mTopBound(top)
             , mBottomBound(bottom)
-            , mLeft(std::numeric_limits<double>::max())
-            , mRight(std::numeric_limits<double>::lowest())
-            , mTop(std::numeric_limits<double>::max())
-            , mBottom(std::numeric_limits<double>::lowest())
             , mIndex(index)
             , mScene(scene)
         {}
@@ -821,23 +807,23 @@ void Scene::Rebuild()
             FRect rect;
             for (size_t i=0; i<entity->GetNumNodes(); ++i)
             {
-                const auto& node = entity->GetNode(i);
+                auto& node = entity->GetNode(i);
                 mTransform.Push(entity->FindNodeModelTransform(&node));
                 const auto& aabb = ComputeBoundingRect(mTransform.GetAsMatrix());
-                if (const auto* spatial = node.GetSpatialNode(); spatial && spatial->IsEnabled() && mIndex)
+                if (auto* spatial = node.GetSpatialNode(); spatial && mIndex)
                 {
-                    const auto left   = (double)aabb.GetX();
-                    const auto right  = (double)aabb.GetX() + aabb.GetWidth();
-                    const auto top    = (double)aabb.GetY();
-                    const auto bottom = (double)aabb.GetY() + aabb.GetHeight();
-                    mLeft   = std::min(mLeft, left);
-                    mRight  = std::max(mRight, right);
-                    mTop    = std::min(mTop, top);
-                    mBottom = std::max(mBottom, bottom);
-
-                    if (spatial->GetShape() == SpatialNode::Shape::AABB)
+                    const auto handle = spatial->GetIndexHandle();
+                    if (!spatial->IsEnabled())
+                    {
+                        if (handle)
+                            mIndex->Remove(handle);
+                        spatial->SetIndexHandle(SpatialIndex::InvalidHandle);
+                    }
+                    else if (spatial->GetShape() == SpatialNode::Shape::AABB)
                     {
-                        mItems.push_back({const_cast<EntityNode*>(&node), aabb});
+                        if (handle)
+                            mIndex->Move(handle, aabb);
+                        else spatial->SetIndexHandle(mIndex->Insert(&node, aabb));
                     } else BUG("Unimplemented spatial shape insertion.");
                 }
                 rect = base::Union(rect, aabb);
@@ -873,20 +859,10 @@ void Scene::Rebuild()
         }
         void Update() const
         {
+            // re-shapes the index only if some item has moved
+            // outside the current bounds of the index.
             if (mIndex)
-            {
-                // because of numerical stability with floats (precision loss)
-                // we're going to artificially enlarge the spatial rectangle little
-                // bit to make sure that all the spatial node rects will be enclosed
-                // inside the main rect.
-                // Todo: using a hard coded value here, the scale of the adjustment
-                // should depend on scale of the floats min/max themselves.
-                const auto xpos   = mLeft - 1.0;
-                const auto ypos   = mTop -1.0;
-                const auto width  = mRight - mLeft + 2.0f;
-                const auto height = mBottom - mTop + 2.0f;
-                mIndex->Insert(FRect(xpos, ypos, width, height), mItems);
-            }
+                mIndex->Commit();
         }
     private:
         Entity* GetParent() const noexcept
@@ -896,18 +872,11 @@ void Scene::Rebuild()
             return mParents.top();
         }
     private:
-        using SpatialIndexItem = game::SpatialIndex<EntityNode>::Item;
-
         const double mLeftBound;
         const double mRightBound;
         const double mTopBound;
         const double mBottomBound;
-        double mLeft;
-        double mRight;
-        double mTop;
-        double mBottom;
 
-        std::vector<SpatialIndexItem> mItems;
         std::stack<Entity*> mParents;
         Transform mTransform;
         SpatialIndex* mIndex = nullptr;
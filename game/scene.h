@@ -131,8 +131,14 @@ namespace game
                 const Entity* placement; // = nullptr;
             };
         };
-        // Collect the entities in the scene into a flat list.
-        std::vector<ConstSceneNode> CollectNodes() const;
+        // Collect the entities in the scene into a flat list. The list is
+        // owned by the scene and maintained incrementally, i.e. it's only
+        // rebuilt when entities are spawned or deleted at the loop boundaries
+        // (BeginLoop/EndLoop) and otherwise only the transforms of the entities
+        // that are linked to other entities are refreshed. This means the same
+        // list can be shared by all the subsystems within the same frame.
+        // The returned reference remains valid until the next call to CollectNodes.
+        const std::vector<ConstSceneNode>& CollectNodes() const;
 
         // Value aggregate for nodes (entities) in the scene.
         // Keep in mind that mutating any entity data can invalidate
@@ -150,7 +156,8 @@ namespace game
             };
         };
         // Collect the entities in the scene into a flat list.
-        std::vector<SceneNode> CollectNodes();
+        // See the const version for details.
+        const std::vector<SceneNode>& CollectNodes();
 
         // Find the transformation for transforming nodes
         // from this entity's space into scene's coordinate space.
@@ -266,8 +273,12 @@ namespace game
         // Get the scene's render tree (scene graph). The render tree defines
         // the relative transformations and the transformation hierarchy of the
         // scene class nodes in the scene.
+        // Mutating the render tree invalidates the collected scene nodes.
         RenderTree& GetRenderTree() noexcept
-        { return mRenderTree; }
+        {
+            mNodesDirty = true;
+            return mRenderTree;
+        }
         const RenderTree& GetRenderTree() const noexcept
         { return mRenderTree; }
         // Get current scene runtime in seconds since the scene was first created.
@@ -326,6 +337,8 @@ namespace game
                 mSpatialIndex->Query(a, b, result, mode);
         }
 
+    private:
+        void UpdateNodes() const;
     private:
         // the class object.
         std::shared_ptr<const SceneClass> mClass;
@@ -363,6 +376,16 @@ namespace game
             std::vector<SpawnRecord> spawn_list;
         };
         std::shared_ptr<AsyncSpawnState> mAsyncSpawnState;
+        // Persistent flat list of scene nodes in the same order
+        // as the entities in mEntities. See CollectNodes.
+        mutable std::vector<SceneNode> mNodes;
+        mutable std::vector<ConstSceneNode> mConstNodes;
+        // indices of the nodes whose entity is linked to some other
+        // entity and whose transform thus needs to be refreshed.
+        mutable std::vector<std::size_t> mLinkedNodes;
+        // flag to indicate that the scene graph has changed
+        // and the node list needs to be rebuilt.
+        mutable bool mNodesDirty = true;
     };
 
     std::unique_ptr<Scene> CreateSceneInstance(std::shared_ptr<const SceneClass> klass);
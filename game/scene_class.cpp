@@ -533,7 +533,8 @@ void SceneClass::SetDynamicSpatialIndex(SpatialIndex index)
     if (mDynamicSpatialIndex == index)
         return;
 
-    if (index == SpatialIndex::Disabled)
+    // the AABB tree adapts to the objects and needs no arguments.
+    if (index == SpatialIndex::Disabled || index == SpatialIndex::AABBTree)
     {
         mDynamicSpatialIndexArgs.reset();
         mDynamicSpatialIndex = index;
@@ -70,7 +70,8 @@ namespace game
         enum class SpatialIndex {
             Disabled,
             QuadTree,
-            DenseGrid
+            DenseGrid,
+            AABBTree
         };
         struct QuadTreeArgs {
             unsigned max_items = 4;
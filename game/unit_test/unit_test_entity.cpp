@@ -42,6 +42,7 @@
 #include "game/entity_node_tilemap_node.h"
 #include "game/entity_node_light.h"
 #include "game/entity_node_mesh_effect.h"
+#include "game/treeop.h"
 #include "game/timeline_transform_animator.h"
 #include "game/timeline_property_animator.h"
 
@@ -1018,6 +1019,135 @@ void unit_test_entity_instance()
     // todo: test more of the instance api
 }
 
+bool MatrixEquals(const glm::mat4& lhs, const glm::mat4& rhs)
+{
+    for (int i=0; i<4; ++i)
+    {
+        if (!math::equals(lhs[i], rhs[i]))
+            return false;
+    }
+    return true;
+}
+
+void unit_test_entity_transform_cache()
+{
+    TEST_CASE(test::Type::Feature)
+
+    game::EntityClass klass;
+    for (const char* name : {"root", "child_1", "child_2", "child_3"})
+    {
+        game::EntityNodeClass node;
+        node.SetName(name);
+        node.SetTranslation(glm::vec2(10.0f, 5.0f));
+        node.SetSize(glm::vec2(4.0f, 2.0f));
+        node.SetScale(glm::vec2(1.5f, 1.0f));
+        node.SetRotation(0.25f);
+        klass.AddNode(std::move(node));
+    }
+    klass.LinkChild(nullptr, klass.FindNodeByName("root"));
+    klass.LinkChild(klass.FindNodeByName("root"), klass.FindNodeByName("child_1"));
+    klass.LinkChild(klass.FindNodeByName("root"), klass.FindNodeByName("child_2"));
+    klass.LinkChild(klass.FindNodeByName("child_1"), klass.FindNodeByName("child_3"));
+
+    game::Entity instance(klass);
+    auto* root    = instance.FindNodeByClassName("root");
+    auto* child_1 = instance.FindNodeByClassName("child_1");
+    auto* child_2 = instance.FindNodeByClassName("child_2");
+    auto* child_3 = instance.FindNodeByClassName("child_3");
+
+    // compare the cached results against a full tree search.
+    const auto& tree = instance.GetRenderTree();
+    auto verify = [&]() {
+        for (const auto* node : {root, child_1, child_2, child_3})
+        {
+            TEST_REQUIRE(MatrixEquals(instance.FindNodeTransform(node),
+                                      game::FindNodeTransform(tree, node)));
+            TEST_REQUIRE(MatrixEquals(instance.FindNodeModelTransform(node),
+                                      game::FindNodeModelTransform(tree, node)));
+            TEST_REQUIRE(instance.FindNodeBoundingRect(node) == game::FindBoundingRect(tree, node));
+        }
+        TEST_REQUIRE(instance.GetBoundingRect() == game::FindBoundingRect(tree));
+    };
+    verify();
+
+    // changing a leaf only affects the leaf.
+    child_3->Translate(1.0f, -2.0f);
+    verify();
+
+    // changing a parent must propagate to the children.
+    root->SetRotation(1.0f);
+    root->SetScale(2.0f, 0.5f);
+    verify();
+
+    child_1->Rotate(-0.5f);
+    child_2->SetTranslation(-3.0f, 4.0f);
+    verify();
+
+    // changes through the transform object must invalidate the cache too.
+    child_1->GetTransform()->Translate(glm::vec2(5.0f, 5.0f));
+    verify();
+
+    // size is not part of the node transform but is part of the model transform.
+    child_3->SetSize(10.0f, 1.0f);
+    verify();
+}
+
+void unit_test_entity_node_handles()
+{
+    TEST_CASE(test::Type::Feature)
+
+    game::EntityClass klass;
+    for (const char* name : {"root", "child"})
+    {
+        game::EntityNodeClass node;
+        node.SetName(name);
+        klass.AddNode(std::move(node));
+    }
+    klass.LinkChild(nullptr, klass.FindNodeByName("root"));
+    klass.LinkChild(klass.FindNodeByName("root"), klass.FindNodeByName("child"));
+
+    // nodes not owned by any entity don't have a valid handle.
+    {
+        game::EntityNode node(*klass.FindNodeByName("root"));
+        TEST_REQUIRE(node.GetHandle().IsValid() == false);
+    }
+
+    game::EntityNodeHandle stale;
+    {
+        game::Entity one(klass);
+        game::Entity two(klass);
+        const auto a = one.GetNode(0).GetHandle();
+        const auto b = one.GetNode(1).GetHandle();
+        const auto c = two.GetNode(0).GetHandle();
+        const auto d = two.GetNode(1).GetHandle();
+        TEST_REQUIRE(a.IsValid() && b.IsValid() && c.IsValid() && d.IsValid());
+        // the handles are unique across all entities.
+        TEST_REQUIRE(a.index != b.index);
+        TEST_REQUIRE(a.index != c.index);
+        TEST_REQUIRE(a.index != d.index);
+        TEST_REQUIRE(b.index != c.index);
+        TEST_REQUIRE(b.index != d.index);
+        TEST_REQUIRE(c.index != d.index);
+        stale = a;
+    }
+
+    // the indices are recycled but with a new generation so that
+    // the old handle no longer matches.
+    game::Entity three(klass);
+    bool recycled = false;
+    for (size_t i=0; i<three.GetNumNodes(); ++i)
+    {
+        const auto handle = three.GetNode(i).GetHandle();
+        TEST_REQUIRE(handle != stale);
+        if (handle.index == stale.index)
+        {
+            TEST_REQUIRE(handle.generation != stale.generation);
+            recycled = true;
+        }
+    }
+    TEST_REQUIRE(recycled);
+}
+
 void unit_test_entity_clone_track_bug()
 {
     TEST_CASE(test::Type::Feature)
@@ -1557,6 +1687,8 @@ int test_main(int argc, char* argv[])
     unit_test_entity_node();
     unit_test_entity_class();
     unit_test_entity_instance();
+    unit_test_entity_transform_cache();
+    unit_test_entity_node_handles();
     unit_test_entity_clone_track_bug();
     unit_test_entity_class_coords();
     unit_test_entity_transformation_precision();
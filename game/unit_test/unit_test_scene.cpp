@@ -19,6 +19,7 @@
 #include <string>
 #include <cstddef>
 #include <iostream>
+#include <algorithm>
 
 #include "base/test_minimal.h"
 #include "base/test_float.h"
@@ -27,10 +28,13 @@
 #include "base/math.h"
 #include "base/threadpool.h"
 #include "base/random.h"
+#include "base/format.h"
 #include "data/json.h"
 #include "game/scene.h"
+#include "game/index.h"
 #include "game/entity.h"
 #include "game/entity_class.h"
+#include "game/entity_node_spatial_node.h"
 
 // build easily comparable representation of the render tree
 // by concatenating node names into a string in the order
@@ -918,6 +922,103 @@ void unit_test_scene_instance_transform()
 
 }
 
+void unit_test_scene_collect_nodes()
+{
+    TEST_CASE(test::Type::Feature)
+
+    auto entity0 = std::make_shared<game::EntityClass>();
+    {
+        game::EntityNodeClass parent;
+        parent.SetName("parent");
+        parent.SetSize(glm::vec2(10.0f, 10.0f));
+        entity0->LinkChild(nullptr, entity0->AddNode(parent));
+
+        game::EntityNodeClass child0;
+        child0.SetName("child0");
+        child0.SetSize(glm::vec2(16.0f, 6.0f));
+        child0.SetTranslation(glm::vec2(20.0f, 20.0f));
+        entity0->LinkChild(entity0->FindNodeByName("parent"), entity0->AddNode(child0));
+    }
+    auto entity1 = std::make_shared<game::EntityClass>();
+    {
+        game::EntityNodeClass node;
+        node.SetName("node");
+        node.SetSize(glm::vec2(5.0f, 5.0f));
+        entity1->LinkChild(nullptr, entity1->AddNode(node));
+    }
+
+    game::SceneClass klass;
+    {
+        game::EntityPlacement node;
+        node.SetName("entity0");
+        node.SetEntity(entity0);
+        klass.LinkChild(nullptr, klass.PlaceEntity(node));
+    }
+    {
+        game::EntityPlacement node;
+        node.SetName("entity1");
+        node.SetEntity(entity1);
+        node.SetParentRenderTreeNodeId(entity0->FindNodeByName("child0")->GetId());
+        klass.LinkChild(klass.FindPlacementByName("entity0"), klass.PlaceEntity(node));
+    }
+
+    auto scene = game::CreateSceneInstance(klass);
+    auto* parent = scene->FindEntityByInstanceName("entity0");
+    auto* child  = scene->FindEntityByInstanceName("entity1");
+
+    const auto& nodes = scene->CollectNodes();
+    TEST_REQUIRE(nodes.size() == 2);
+    TEST_REQUIRE(nodes[0].entity == parent);
+    TEST_REQUIRE(nodes[1].entity == child);
+    TEST_REQUIRE(game::FBox(nodes[1].node_to_scene).GetTopLeft() == glm::vec2(20.0f, 20.0f));
+
+    // the node list is persistent.
+    TEST_REQUIRE(&scene->CollectNodes() == &nodes);
+
+    // moving the link node in the parent entity must be
+    // reflected in the linked child entity's transform.
+    parent->FindNodeByInstanceName("child0")->Translate(5.0f, -5.0f);
+    TEST_REQUIRE(&scene->CollectNodes() == &nodes);
+    TEST_REQUIRE(game::FBox(nodes[1].node_to_scene).GetTopLeft() == glm::vec2(25.0f, 15.0f));
+    parent->FindNodeByInstanceName("parent")->Translate(-25.0f, -15.0f);
+    TEST_REQUIRE(game::FBox(scene->CollectNodes()[1].node_to_scene).GetTopLeft() == glm::vec2(0.0f, 0.0f));
+
+    // const access gives the same results.
+    {
+        const auto& const_scene = *scene;
+        const auto& const_nodes = const_scene.CollectNodes();
+        TEST_REQUIRE(const_nodes.size() == 2);
+        TEST_REQUIRE(const_nodes[0].entity == parent);
+        TEST_REQUIRE(const_nodes[1].entity == child);
+        TEST_REQUIRE(game::FBox(const_nodes[1].node_to_scene).GetTopLeft() == glm::vec2(0.0f, 0.0f));
+    }
+
+    // spawning adds new nodes at the loop boundary.
+    scene->BeginLoop();
+        game::EntityArgs args;
+        args.klass = entity1;
+        args.name  = "spawned";
+        scene->SpawnEntity(args);
+        TEST_REQUIRE(scene->CollectNodes().size() == 2);
+    scene->EndLoop();
+
+    scene->BeginLoop();
+        TEST_REQUIRE(scene->CollectNodes().size() == 3);
+        TEST_REQUIRE(scene->CollectNodes()[2].entity == scene->FindEntityByInstanceName("spawned"));
+        scene->KillEntity(parent);
+    scene->EndLoop();
+
+    // killing the parent kills the linked children as well.
+    scene->BeginLoop();
+        TEST_REQUIRE(scene->CollectNodes().size() == 3);
+    scene->EndLoop();
+
+    scene->BeginLoop();
+        TEST_REQUIRE(scene->CollectNodes().size() == 1);
+        TEST_REQUIRE(scene->CollectNodes()[0].entity == scene->FindEntityByInstanceName("spawned"));
+    scene->EndLoop();
+}
+
 void unit_test_scene_instance_kill_at_boundary()
 {
     TEST_CASE(test::Type::Feature)
@@ -1238,6 +1339,285 @@ void unit_test_scene_spatial_update(game::SceneClass::SpatialIndex index)
 
 }
 
+void unit_test_spatial_index_incremental(game::SceneClass::SpatialIndex type)
+{
+    TEST_CASE(test::Type::Feature)
+
+    struct Object {
+        int value = 0;
+    };
+    using Index = game::SpatialIndex<Object>;
+
+    std::unique_ptr<Index> index;
+    if (type == game::SceneClass::SpatialIndex::QuadTree)
+        index = std::make_unique<game::QuadTreeIndex<Object>>(4, 4);
+    else if (type == game::SceneClass::SpatialIndex::DenseGrid)
+        index = std::make_unique<game::DenseGridIndex<Object>>(10, 10);
+    else if (type == game::SceneClass::SpatialIndex::AABBTree)
+        index = std::make_unique<game::AABBTreeIndex<Object>>();
+
+    // the AABB tree has no fixed bounds and never needs to be re-shaped.
+    const auto bounded = type != game::SceneClass::SpatialIndex::AABBTree;
+    const auto reshapes = [bounded](std::size_t count) {
+        return bounded ? count : 0;
+    };
+
+    std::vector<Object> objects;
+    objects.resize(10);
+
+    std::vector<Index::ItemHandle> handles;
+    for (int i=0; i<10; ++i)
+    {
+        objects[i].value = i;
+        const auto handle = index->Insert(&objects[i], game::FRect(i * 10.0f, 0.0f, 5.0f, 5.0f));
+        TEST_REQUIRE(handle != Index::InvalidHandle);
+        handles.push_back(handle);
+    }
+    TEST_REQUIRE(index->GetNumItems() == 10);
+
+    // the first commit needs to shape the index to cover the items.
+    index->Commit();
+    TEST_REQUIRE(index->GetNumReshapes() == reshapes(1));
+    if (bounded)
+        TEST_REQUIRE(base::Contains(index->GetBounds(), game::FRect(0.0f, 0.0f, 95.0f, 5.0f)));
+
+    std::vector<Object*> result;
+    index->Query(game::FRect(0.0f, 0.0f, 100.0f, 100.0f), &result);
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    TEST_REQUIRE(result.size() == 10);
+
+    // moving items within the bounds doesn't re-shape.
+    index->Move(handles[0], game::FRect(50.0f, 2.0f, 1.0f, 1.0f));
+    index->Move(handles[1], game::FRect(10.0f, 0.0f, 5.0f, 5.0f));
+    index->Commit();
+    TEST_REQUIRE(index->GetNumReshapes() == reshapes(1));
+
+    std::set<Object*> hits;
+    index->Query(game::FPoint(2.0f, 2.0f), &hits, Index::QueryMode::All);
+    TEST_REQUIRE(hits.empty());
+    index->Query(game::FPoint(50.5f, 2.5f), &hits, Index::QueryMode::All);
+    TEST_REQUIRE(hits.size() == 2);
+
+    // removing an item.
+    index->Remove(handles[5]);
+    TEST_REQUIRE(index->GetNumItems() == 9);
+    hits.clear();
+    index->Query(game::FPoint(50.5f, 2.5f), &hits, Index::QueryMode::All);
+    TEST_REQUIRE(hits.size() == 1);
+    TEST_REQUIRE(*hits.begin() == &objects[0]);
+
+    // handles are recycled.
+    handles[5] = index->Insert(&objects[5], game::FRect(60.0f, 0.0f, 1.0f, 1.0f));
+    TEST_REQUIRE(index->GetObject(handles[5]) == &objects[5]);
+    TEST_REQUIRE(index->GetNumItems() == 10);
+    index->Commit();
+    TEST_REQUIRE(index->GetNumReshapes() == reshapes(1));
+
+    // moving an item outside the bounds causes a re-shape on commit.
+    index->Move(handles[9], game::FRect(500.0f, 500.0f, 5.0f, 5.0f));
+    index->Commit();
+    TEST_REQUIRE(index->GetNumReshapes() == reshapes(2));
+    if (bounded)
+        TEST_REQUIRE(base::Contains(index->GetBounds(), game::FRect(0.0f, 0.0f, 505.0f, 505.0f)));
+
+    result.clear();
+    index->Query(game::FRect(0.0f, 0.0f, 1000.0f, 1000.0f), &result);
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    TEST_REQUIRE(result.size() == 10);
+
+    hits.clear();
+    index->Query(game::FPoint(502.0f, 502.0f), &hits, Index::QueryMode::All);
+    TEST_REQUIRE(hits.size() == 1);
+    TEST_REQUIRE(*hits.begin() == &objects[9]);
+
+    for (auto handle : handles)
+        index->Remove(handle);
+    TEST_REQUIRE(index->GetNumItems() == 0);
+    result.clear();
+    index->Query(game::FRect(0.0f, 0.0f, 1000.0f, 1000.0f), &result);
+    TEST_REQUIRE(result.empty());
+}
+
+void unit_test_scene_spatial_static(game::SceneClass::SpatialIndex type)
+{
+    TEST_CASE(test::Type::Feature)
+
+    auto entity = std::make_shared<game::EntityClass>();
+    entity->SetName("entity");
+    {
+        game::EntityNodeClass node;
+        node.SetName("node");
+        node.SetSize(10.0f, 10.0f);
+        node.CreateSpatialNode();
+        entity->LinkChild(nullptr, entity->AddNode(node));
+    }
+
+    game::SceneClass klass;
+    klass.SetDynamicSpatialIndex(type);
+
+    auto scene = game::CreateSceneInstance(klass);
+
+    const auto bounded = type != game::SceneClass::SpatialIndex::AABBTree;
+    const auto reshapes = [bounded](std::size_t count) {
+        return bounded ? count : 0;
+    };
+
+    scene->BeginLoop();
+    for (unsigned i=0; i<100; ++i)
+    {
+        game::EntityArgs args;
+        args.position.x = (i % 10) * 20.0f;
+        args.position.y = (i / 10) * 20.0f;
+        args.name  = std::to_string(i);
+        args.klass = entity;
+        scene->SpawnEntity(args);
+    }
+    scene->EndLoop();
+
+    scene->BeginLoop();
+    scene->Rebuild();
+    scene->EndLoop();
+
+    const auto* index = scene->GetSpatialIndex();
+    TEST_REQUIRE(index->GetNumItems() == 100);
+    TEST_REQUIRE(index->GetNumReshapes() == reshapes(1));
+
+    // nothing moves, nothing needs to be done.
+    for (int i=0; i<10; ++i)
+    {
+        scene->BeginLoop();
+        scene->Rebuild();
+        scene->EndLoop();
+    }
+    TEST_REQUIRE(index->GetNumReshapes() == reshapes(1));
+
+    // move one entity within the current bounds.
+    auto* mover = scene->FindEntityByInstanceName("0");
+    mover->GetNode(0).SetTranslation(30.0f, 30.0f);
+    scene->BeginLoop();
+    scene->Rebuild();
+    scene->EndLoop();
+    TEST_REQUIRE(index->GetNumReshapes() == reshapes(1));
+
+    std::set<game::EntityNode*> result;
+    scene->QuerySpatialNodes(game::FPoint(30.0f, 30.0f), &result, game::Scene::SpatialQueryMode::All);
+    TEST_REQUIRE(result.size() == 1);
+    TEST_REQUIRE(*result.begin() == &mover->GetNode(0));
+
+    // move outside the bounds.
+    mover->GetNode(0).SetTranslation(1000.0f, 1000.0f);
+    scene->BeginLoop();
+    scene->Rebuild();
+    scene->EndLoop();
+    TEST_REQUIRE(index->GetNumReshapes() == reshapes(2));
+
+    result.clear();
+    scene->QuerySpatialNodes(game::FPoint(1000.0f, 1000.0f), &result, game::Scene::SpatialQueryMode::All);
+    TEST_REQUIRE(result.size() == 1);
+    TEST_REQUIRE(*result.begin() == &mover->GetNode(0));
+
+    // disabling the spatial node removes it from the index.
+    mover->GetNode(0).GetSpatialNode()->Enable(false);
+    scene->BeginLoop();
+    scene->Rebuild();
+    scene->EndLoop();
+    TEST_REQUIRE(index->GetNumItems() == 99);
+}
+
+// compare the spatial index implementations in a headless setting
+// where N objects move around every "frame" and then a number of
+// queries are performed.
+void measure_spatial_index_perf(game::SceneClass::SpatialIndex type, bool clustered)
+{
+    TEST_CASE(test::Type::Performance)
+
+    struct Object {
+        game::FRect rect;
+        game::SpatialIndex<Object>::ItemHandle handle = 0;
+    };
+    using Index = game::SpatialIndex<Object>;
+
+    std::unique_ptr<Index> index;
+    if (type == game::SceneClass::SpatialIndex::QuadTree)
+        index = std::make_unique<game::QuadTreeIndex<Object>>(4, 6);
+    else if (type == game::SceneClass::SpatialIndex::DenseGrid)
+        index = std::make_unique<game::DenseGridIndex<Object>>(20, 20);
+    else if (type == game::SceneClass::SpatialIndex::AABBTree)
+        index = std::make_unique<game::AABBTreeIndex<Object>>();
+
+    // 10k objects in a 2000x2000 space. In the clustered case the
+    // objects are packed in a handful of small clusters and the
+    // sizes vary wildly, i.e. there are some very large objects
+    // among the small ones.
+    std::vector<Object> objects;
+    objects.resize(10000);
+
+    std::vector<game::FPoint> clusters;
+    for (unsigned i=0; i<8; ++i)
+    {
+        const auto x = base::rand<0x5eed, float>(0.0f, 2000.0f);
+        const auto y = base::rand<0x5eed, float>(0.0f, 2000.0f);
+        clusters.emplace_back(x, y);
+    }
+
+    for (size_t i=0; i<objects.size(); ++i)
+    {
+        auto& object = objects[i];
+        if (clustered)
+        {
+            const auto& center = clusters[i % clusters.size()];
+            const auto x = center.GetX() + base::rand<0x5eed, float>(-50.0f, 50.0f);
+            const auto y = center.GetY() + base::rand<0x5eed, float>(-50.0f, 50.0f);
+            const auto size = (i % 100) == 0
+                ? base::rand<0x5eed, float>(100.0f, 400.0f)
+                : base::rand<0x5eed, float>(1.0f, 5.0f);
+            object.rect = game::FRect(x, y, size, size);
+        }
+        else
+        {
+            const auto x = base::rand<0x5eed, float>(0.0f, 2000.0f);
+            const auto y = base::rand<0x5eed, float>(0.0f, 2000.0f);
+            object.rect = game::FRect(x, y, 10.0f, 10.0f);
+        }
+        object.handle = index->Insert(&object, object.rect);
+    }
+    index->Commit();
+
+    std::vector<game::FRect> queries;
+    for (unsigned i=0; i<1000; ++i)
+    {
+        const auto& object = objects[i * 10];
+        queries.emplace_back(object.rect.GetX() - 20.0f, object.rect.GetY() - 20.0f, 50.0f, 50.0f);
+    }
+
+    const auto name = base::ToString(type) + (clustered ? " clustered " : " uniform ");
+
+    const auto update = test::TimedTest(100, [&objects, &index]() {
+        for (auto& object : objects)
+        {
+            const auto dx = base::rand<0x5eed, float>(-2.0f, 2.0f);
+            const auto dy = base::rand<0x5eed, float>(-2.0f, 2.0f);
+            object.rect.Translate(dx, dy);
+            index->Move(object.handle, object.rect);
+        }
+        index->Commit();
+    });
+    test::PrintTestTimes((name + "update 10k").c_str(), update);
+
+    std::vector<Object*> result;
+    result.reserve(objects.size());
+    const auto query = test::TimedTest(100, [&queries, &index, &result]() {
+        for (const auto& rect : queries)
+        {
+            result.clear();
+            index->Query(rect, &result);
+        }
+    });
+    test::PrintTestTimes((name + "query 1k").c_str(), query);
+}
+
 void unit_test_async_spawn()
 {
     TEST_CASE(test::Type::Feature)
@@ -1291,13 +1671,29 @@ int test_main(int argc, char* argv[])
     unit_test_scene_instance_spawn();
     unit_test_scene_instance_kill();
     unit_test_scene_instance_transform();
+    unit_test_scene_collect_nodes();
     unit_test_scene_instance_kill_at_boundary();
     unit_test_scene_spatial_query(game::SceneClass::SpatialIndex::QuadTree);
     unit_test_scene_spatial_update(game::SceneClass::SpatialIndex::QuadTree);
     unit_test_scene_spatial_query(game::SceneClass::SpatialIndex::DenseGrid);
     unit_test_scene_spatial_update(game::SceneClass::SpatialIndex::DenseGrid);
+    unit_test_spatial_index_incremental(game::SceneClass::SpatialIndex::QuadTree);
+    unit_test_spatial_index_incremental(game::SceneClass::SpatialIndex::DenseGrid);
+    unit_test_scene_spatial_static(game::SceneClass::SpatialIndex::QuadTree);
+    unit_test_scene_spatial_static(game::SceneClass::SpatialIndex::DenseGrid);
+    unit_test_scene_spatial_query(game::SceneClass::SpatialIndex::AABBTree);
+    unit_test_scene_spatial_update(game::SceneClass::SpatialIndex::AABBTree);
+    unit_test_spatial_index_incremental(game::SceneClass::SpatialIndex::AABBTree);
+    unit_test_scene_spatial_static(game::SceneClass::SpatialIndex::AABBTree);
 
     unit_test_async_spawn();
+
+    measure_spatial_index_perf(game::SceneClass::SpatialIndex::QuadTree,  false);
+    measure_spatial_index_perf(game::SceneClass::SpatialIndex::DenseGrid, false);
+    measure_spatial_index_perf(game::SceneClass::SpatialIndex::AABBTree,  false);
+    measure_spatial_index_perf(game::SceneClass::SpatialIndex::QuadTree,  true);
+    measure_spatial_index_perf(game::SceneClass::SpatialIndex::DenseGrid, true);
+    measure_spatial_index_perf(game::SceneClass::SpatialIndex::AABBTree,  true);
     return 0;
 }
 ) // TEST-MAIN
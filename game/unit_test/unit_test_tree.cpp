@@ -789,6 +789,48 @@ void unit_test_quadtree_erase()
         TEST_REQUIRE(tree->GetChildQuadrant(1)->GetItemObject(0)->name == "split");
         TEST_REQUIRE(tree->GetChildQuadrant(3)->GetItemObject(0)->name == "split");
     }
+
+    // erase a single object by its insertion rect. only the
+    // quadrants that intersect with the rect are visited.
+    {
+        game::QuadTree<Entity*> tree(-50.0f, -50.0f,100.0f, 100.0f, 1);
+
+        Entity first;
+        first.name = "first";
+        first.rect = base::FRect(-10.0f, -20.0f, 10.0f, 10.0f);
+        tree.Insert(first.rect, &first);
+
+        Entity split;
+        split.rect = base::FRect(-10.0f, 20.0f, 20.0f, 20.0f);
+        split.name = "split";
+        tree.Insert(split.rect, &split);
+
+        Entity other;
+        other.rect = base::FRect(20.0f, -20.0f, 10.0f, 10.0f);
+        other.name = "other";
+        tree.Insert(other.rect, &other);
+        TEST_REQUIRE(tree.GetNumItems() == 4);
+
+        // wrong rect, nothing is erased.
+        tree.Erase(first.rect, &split);
+        TEST_REQUIRE(tree.GetNumItems() == 4);
+
+        // the split object is removed from every quadrant.
+        tree.Erase(split.rect, &split);
+        TEST_REQUIRE(tree.GetNumItems() == 2);
+        TEST_REQUIRE(tree->HasChildren() == true);
+        TEST_REQUIRE(tree->GetChildQuadrant(0)->GetItemObject(0)->name == "first");
+        TEST_REQUIRE(tree->GetChildQuadrant(2)->GetItemObject(0)->name == "other");
+
+        // the quadrants are merged back once there's room in the parent.
+        tree.Erase(other.rect, &other);
+        TEST_REQUIRE(tree.GetNumItems() == 1);
+        TEST_REQUIRE(tree->HasChildren() == false);
+        TEST_REQUIRE(tree->GetItemObject(0)->name == "first");
+
+        tree.Erase(first.rect, &first);
+        TEST_REQUIRE(tree.GetNumItems() == 0);
+    }
 }
 
 void unit_test_quadtree_query()
@@ -32,24 +32,7 @@
 #include "graphics/bitmap.h"
 
 namespace {
-void PremultiplyPixel_lRGB(const gfx::Pixel_RGBA& src, gfx::Pixel_RGBA* dst)
-{
-    gfx::Pixel_RGBAf norm;
-    norm = gfx::Pixel_to_floats(src);
-    norm = gfx::RGBA_premul_alpha(norm);
-    *dst = gfx::Pixel_to_uints(norm);
-}
-void PremultiplyPixel_sRGB(const gfx::Pixel_RGBA& src, gfx::Pixel_RGBA* dst)
-{
-    gfx::Pixel_RGBAf norm;
-    norm = gfx::Pixel_to_floats(src);
-    norm = gfx::sRGB_decode(norm);
-    norm = gfx::RGBA_premul_alpha(norm);
-    norm = gfx::sRGB_encode(norm);
-    *dst = gfx::Pixel_to_uints(norm);
-}
-
-template<typename T_u8, typename T_float>
+template<typename T_u8>
 std::unique_ptr<gfx::Bitmap<T_u8>> ConvertToLinear(const gfx::IBitmapReadView& src)
 {
     ASSERT(src.IsValid());
@@ -60,21 +43,8 @@ std::unique_ptr<gfx::Bitmap<T_u8>> ConvertToLinear(const gfx::IBitmapReadView& s
     using Bitmap = gfx::Bitmap<T_u8>;
 
     auto ret = std::make_unique<Bitmap>(width, height);
-    auto dst = ret->GetWriteView();
-
-    for (unsigned row=0; row<height; ++row)
-    {
-        for (unsigned col=0; col<width; ++col)
-        {
-            T_u8 value;
-            T_float norm;
-            src.ReadPixel(row, col, &value);
-            norm  = gfx::Pixel_to_floats(value);
-            norm  = gfx::sRGB_decode(norm);
-            value = gfx::Pixel_to_uints(norm);
-            dst->WritePixel(row, col, value);
-        }
-    }
+    gfx::PixelSpan_sRGB_decode(static_cast<T_u8*>(ret->GetDataPtr()),
+                               static_cast<const T_u8*>(src.GetReadPtr()), width * height);
     return ret;
 }
 
@@ -91,17 +61,16 @@ std::unique_ptr<gfx::Bitmap<T_u8>> BoxFilter(const gfx::IBitmapReadView& src, bo
     const auto dst_width  = std::max(1u, src_width / 2);
     const auto dst_height = std::max(1u, src_height / 2);
 
-    const auto src_height_max = src_height & ~0x1;
-    const auto src_width_max  = src_width & ~0x1;
-
     using Bitmap = gfx::Bitmap<T_u8>;
 
     auto ret = std::make_unique<Bitmap>(dst_width, dst_height);
     auto dst = ret->GetWriteView();
 
-    for (unsigned dst_row=0, src_row=0; src_row<src_height_max; src_row+=2, dst_row++)
+    // iterate over the destination so that a source dimension of 1
+    // (for example a 2x1 mip) still gets filtered by clamping.
+    for (unsigned dst_row=0, src_row=0; dst_row<dst_height; src_row+=2, dst_row++)
     {
-        for (unsigned dst_col=0, src_col=0; src_col<src_width_max; src_col+=2, dst_col++)
+        for (unsigned dst_col=0, src_col=0; dst_col<dst_width; src_col+=2, dst_col++)
         {
             // read 2x2 pixels from the source image
             T_u8 values[4];
@@ -113,24 +82,21 @@ std::unique_ptr<gfx::Bitmap<T_u8>> BoxFilter(const gfx::IBitmapReadView& src, bo
             // normalize the values for better precision. alternative would
             // be to use bit shift (right shift by two) on the integer type
             // but that would lose some precision.
-            T_float values_norm[4];
-            values_norm[0] = gfx::Pixel_to_floats(values[0]);
-            values_norm[1] = gfx::Pixel_to_floats(values[1]);
-            values_norm[2] = gfx::Pixel_to_floats(values[2]);
-            values_norm[3] = gfx::Pixel_to_floats(values[3]);
-
             // if we're dealing with sRGB color space then the values need first
             // be converted into linear before averaging. this is only supported
             // for RGBA and RGB formats.
-            if constexpr (support_srgb)
+            T_float values_norm[4];
+            for (unsigned i=0; i<4; ++i)
             {
-                if (srgb)
+                if constexpr (support_srgb)
                 {
-                    values_norm[0] = gfx::sRGB_decode(values_norm[0]);
-                    values_norm[1] = gfx::sRGB_decode(values_norm[1]);
-                    values_norm[2] = gfx::sRGB_decode(values_norm[2]);
-                    values_norm[3] = gfx::sRGB_decode(values_norm[3]);
+                    if (srgb)
+                    {
+                        values_norm[i] = gfx::sRGB_decode_to_floats(values[i]);
+                        continue;
+                    }
                 }
+                values_norm[i] = gfx::Pixel_to_floats(values[i]);
             }
 
             // premultiply alpha into RGB
@@ -154,7 +120,10 @@ std::unique_ptr<gfx::Bitmap<T_u8>> BoxFilter(const gfx::IBitmapReadView& src, bo
             if constexpr (support_srgb)
             {
                 if (srgb)
-                    value = gfx::sRGB_encode(value);
+                {
+                    dst->WritePixel(dst_row, dst_col, gfx::sRGB_encode_to_uints(value));
+                    continue;
+                }
             }
 
             // write the new pixel value out.
@@ -237,9 +206,9 @@ std::unique_ptr<IBitmap> GenerateNextMipmap(const IBitmap& src, bool srgb)
 std::unique_ptr<IBitmap> ConvertToLinear(const IBitmapReadView& src)
 {
     if (src.GetDepthBits() == 32)
-        return ::ConvertToLinear < Pixel_RGBA, Pixel_RGBAf > (src);
+        return ::ConvertToLinear<Pixel_RGBA>(src);
     else if (src.GetDepthBits() == 24)
-        return ::ConvertToLinear < Pixel_RGB, Pixel_RGBf > (src);
+        return ::ConvertToLinear<Pixel_RGB>(src);
     return nullptr;
 }
 std::unique_ptr<IBitmap> ConvertToLinear(const IBitmap& src)
@@ -251,9 +220,11 @@ std::unique_ptr<IBitmap> ConvertToLinear(const IBitmap& src)
 void PremultiplyAlpha(const BitmapWriteView<Pixel_RGBA>& dst,
                       const BitmapReadView<Pixel_RGBA>& src, bool srgb)
 {
-    auto conversion  = srgb ? &PremultiplyPixel_sRGB
-                            : &PremultiplyPixel_lRGB;
-    ConvertBitmap(dst, src, conversion);
+    ASSERT(dst.GetWidth() == src.GetWidth());
+    ASSERT(dst.GetHeight() == src.GetHeight());
+    PixelSpan_PremulAlpha(static_cast<Pixel_RGBA*>(dst.GetWritePtr()),
+                          static_cast<const Pixel_RGBA*>(src.GetReadPtr()),
+                          src.GetWidth() * src.GetHeight(), srgb);
 }
 
 Bitmap<Pixel_RGBA> PremultiplyAlpha(const BitmapReadView<Pixel_RGBA>& src, bool srgb)
@@ -391,4 +362,114 @@ void SetAlphaToOne(RgbaBitmap& bitmap)
 
 }
 
+void BlurBitmap(RgbaBitmap& bitmap, unsigned iterations, bool srgb)
+{
+    const int width  = static_cast<int>(bitmap.GetWidth());
+    const int height = static_cast<int>(bitmap.GetHeight());
+    const auto count = bitmap.GetWidth() * bitmap.GetHeight();
+
+    // same weights as in the blur kernel shader.
+    constexpr float weights[5] = {
+        0.227027f, 0.1945946f, 0.1216216f, 0.054054f, 0.016216f
+    };
+    // the shader moves the sampling position in fixed normalized
+    // steps of 1/256 regardless of the texture size.
+    constexpr float step = 1.0f / 256.0f;
+
+    std::vector<Pixel_RGBAf> src(count);
+    std::vector<Pixel_RGBAf> dst(count);
+    for (unsigned i=0; i<count; ++i)
+    {
+        src[i] = srgb ? sRGB_decode_to_floats(bitmap.GetPixel(i))
+                      : Pixel_to_floats(bitmap.GetPixel(i));
+    }
+
+    // sample with linear filtering along a single axis with
+    // clamp to edge wrapping.
+    const auto sample = [&src, width, height](int row, int col, float texel, bool vertical) {
+        const auto size = vertical ? height : width;
+        const auto pos  = texel - 0.5f;
+        const auto i0   = static_cast<int>(std::floor(pos));
+        const auto f    = pos - static_cast<float>(i0);
+        const auto a    = math::clamp(0, size-1, i0);
+        const auto b    = math::clamp(0, size-1, i0+1);
+        const auto& p0  = vertical ? src[a * width + col] : src[row * width + a];
+        const auto& p1  = vertical ? src[b * width + col] : src[row * width + b];
+        return p0 * (1.0f - f) + p1 * f;
+    };
+
+    for (unsigned i=0; i<iterations; ++i)
+    {
+        const bool vertical = i & 1;
+        const auto size = static_cast<float>(vertical ? height : width);
+        for (int row=0; row<height; ++row)
+        {
+            for (int col=0; col<width; ++col)
+            {
+                const auto center = static_cast<float>(vertical ? row : col) + 0.5f;
+                Pixel_RGBAf color = src[row * width + col] * weights[0];
+                for (int j=1; j<5; ++j)
+                {
+                    const auto offset = static_cast<float>(j) * step * size;
+                    color = color + sample(row, col, center - offset, vertical) * weights[j];
+                    color = color + sample(row, col, center + offset, vertical) * weights[j];
+                }
+                dst[row * width + col] = color;
+            }
+        }
+        std::swap(src, dst);
+    }
+
+    for (unsigned i=0; i<count; ++i)
+    {
+        bitmap.SetPixel(i, srgb ? sRGB_encode_to_uints(src[i])
+                                : Pixel_to_uints(src[i]));
+    }
+}
+
+void DetectBitmapEdges(RgbaBitmap& bitmap, const Pixel_RGBA& edge_color)
+{
+    const int width  = static_cast<int>(bitmap.GetWidth());
+    const int height = static_cast<int>(bitmap.GetHeight());
+
+    std::vector<float> alpha(bitmap.GetWidth() * bitmap.GetHeight());
+    for (unsigned i=0; i<alpha.size(); ++i)
+        alpha[i] = bitmap.GetPixel(i).a / 255.0f;
+
+    // the edge kernel shader discards samples within 2 pixels
+    // from the texture borders.
+    const auto texel = [&alpha, width, height](int row, int col) {
+        if (col < 2 || col > width - 3)
+            return 0.0f;
+        if (row < 2 || row > height - 3)
+            return 0.0f;
+        return alpha[row * width + col];
+    };
+
+    for (int row=0; row<height; ++row)
+    {
+        for (int col=0; col<width; ++col)
+        {
+            float n[9];
+            n[0] = texel(row-1, col-1);
+            n[1] = texel(row-1, col+0);
+            n[2] = texel(row-1, col+1);
+            n[3] = texel(row+0, col-1);
+            n[4] = texel(row+0, col+0);
+            n[5] = texel(row+0, col+1);
+            n[6] = texel(row+1, col-1);
+            n[7] = texel(row+1, col+0);
+            n[8] = texel(row+1, col+1);
+            const auto sobel_h = n[2] + (2.0f*n[5]) + n[8] - (n[0] + (2.0f*n[3]) + n[6]);
+            const auto sobel_v = n[0] + (2.0f*n[1]) + n[2] - (n[6] + (2.0f*n[7]) + n[8]);
+            const auto sobel = std::sqrt(sobel_h*sobel_h + sobel_v*sobel_v);
+            const auto edge  = math::clamp(0.0f, 1.0f, sobel * edge_color.a / 255.0f);
+
+            Pixel_RGBA pixel = edge_color;
+            pixel.a = static_cast<std::uint8_t>(edge * 255.0f + 0.5f);
+            bitmap.SetPixel(row, col, pixel);
+        }
+    }
+}
+
 } // namespace
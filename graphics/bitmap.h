@@ -557,4 +557,14 @@ namespace gfx
 
     void SetAlphaToOne(RgbaBitmap& bitmap);
 
+    // CPU versions of the texture effects in device_algo.h. These are used
+    // to bake the effects into the texture data offline and they produce
+    // the same results as the GPU versions up to some rounding differences.
+    // Blur the bitmap with a separable gaussian kernel. Even iterations
+    // blur horizontally and odd iterations blur vertically.
+    void BlurBitmap(RgbaBitmap& bitmap, unsigned iterations, bool srgb);
+    // Detect the sprite edges using a sobel filter on the alpha channel.
+    // The result has the edge color with the edge strength as alpha.
+    void DetectBitmapEdges(RgbaBitmap& bitmap, const Pixel_RGBA& edge_color);
+
 } // namespace
@@ -19,13 +19,49 @@
 #include "config.h"
 
 #include <vector>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
 
 #include "base/assert.h"
 #include "graphics/bitmap_view.h"
+#include "graphics/pixel_kernels.h"
 #include "graphics/types.h"
 
 namespace gfx
 {
+    namespace detail {
+        // The bitmap views are contiguous row major arrays of pixels
+        // without any padding so the algorithms below process the
+        // bitmaps row by row with the pixel kernels where possible.
+        template<typename View>
+        inline auto GetViewRow(const View& view, int row, int col) noexcept
+        {
+            using Pixel = typename View::PixelType;
+            if constexpr (std::is_same_v<View, BitmapReadView<Pixel>>)
+                return static_cast<const Pixel*>(view.GetReadPtr()) + row * view.GetWidth() + col;
+            else return static_cast<Pixel*>(view.GetWritePtr()) + row * view.GetWidth() + col;
+        }
+
+        template<typename Pixel, typename CompareFunc>
+        inline bool CompareRow(const Pixel* lhs, const Pixel* rhs, unsigned count, const CompareFunc& comparer)
+        {
+            if constexpr (std::is_same_v<CompareFunc, PixelEquality::PixelPrecision>)
+                return std::memcmp(lhs, rhs, sizeof(Pixel) * count) == 0;
+            else if constexpr (std::is_same_v<CompareFunc, PixelEquality::ThresholdPrecision>)
+                return PixelSpan_Compare(lhs, rhs, count, comparer.max_mse);
+            else
+            {
+                for (unsigned i=0; i<count; ++i)
+                {
+                    if (!comparer(lhs[i], rhs[i]))
+                        return false;
+                }
+                return true;
+            }
+        }
+    } // detail
+
     template<typename Pixel>
     void ReadBitmapPixels(const BitmapReadView<Pixel>& src,
                           const URect& rect, std::vector<Pixel>* pixels)
@@ -35,14 +71,12 @@ namespace gfx
 
         ASSERT(Contains(URect(0, 0, bitmap_width, bitmap_height), rect));
 
+        pixels->reserve(pixels->size() + rect.GetWidth() * rect.GetHeight());
         for (unsigned y=0; y<rect.GetHeight(); ++y)
         {
-            for (unsigned x=0; x<rect.GetWidth(); ++x)
-            {
-                const auto src_point = rect.MapToGlobal(x, y);
-                const auto src_pixel = src.template ReadPixel<Pixel>(src_point);
-                pixels->push_back(src_pixel);
-            }
+            const auto src_point = rect.MapToGlobal(0, y);
+            const auto* src_row = detail::GetViewRow(src, src_point.GetY(), src_point.GetX());
+            pixels->insert(pixels->end(), src_row, src_row + rect.GetWidth());
         }
     }
 
@@ -56,11 +90,8 @@ namespace gfx
         const auto rect = Intersect(dst_rect_safe, dst_rect);
         for (unsigned y=0; y<rect.GetHeight(); ++y)
         {
-            for (unsigned x=0; x<rect.GetWidth(); ++x)
-            {
-                const auto point = rect.MapToGlobal(x, y);
-                dst.WritePixel(point, value);
-            }
+            const auto point = rect.MapToGlobal(0, y);
+            std::fill_n(detail::GetViewRow(dst, point.GetY(), point.GetX()), rect.GetWidth(), value);
         }
     }
 
@@ -77,8 +108,30 @@ namespace gfx
         const auto dst_rect = IRect(dst_pos, src_rect_safe.GetSize());
         const auto cpy_rect = Intersect(IRect(0, 0, dst_width, dst_height), dst_rect);
 
+        // the bitwise raster ops are the same for each byte
+        // regardless of the pixel format.
+        void (*span_op)(u8*, const u8*, std::size_t) noexcept = nullptr;
+        if constexpr (std::is_same_v<RasterOp, Pixel(*)(const Pixel&, const Pixel&)>)
+        {
+            if (raster_op == &RasterOp_BitwiseAnd<Pixel>)
+                span_op = &PixelSpan_BitwiseAnd;
+            else if (raster_op == &RasterOp_BitwiseOr<Pixel>)
+                span_op = &PixelSpan_BitwiseOr;
+        }
+
         for (unsigned y=0; y<cpy_rect.GetHeight(); ++y)
         {
+            if (span_op)
+            {
+                const auto& dst_point = cpy_rect.MapToGlobal(0, y);
+                const auto& src_point = src_rect_safe.MapToGlobal(dst_rect.MapToLocal(dst_point));
+                auto* dst_row = detail::GetViewRow(dst, dst_point.GetY(), dst_point.GetX());
+                const auto* src_row = detail::GetViewRow(src, src_point.GetY(), src_point.GetX());
+                span_op(reinterpret_cast<u8*>(dst_row),
+                        reinterpret_cast<const u8*>(src_row), sizeof(Pixel) * cpy_rect.GetWidth());
+                continue;
+            }
+
             for (unsigned x=0; x<cpy_rect.GetWidth(); ++x)
             {
                 const auto& dst_point = cpy_rect.MapToGlobal(x, y);
@@ -106,13 +159,11 @@ namespace gfx
 
         for (unsigned y=0; y<cpy_rect.GetHeight(); ++y)
         {
-            for (unsigned x=0; x<cpy_rect.GetWidth(); ++x)
-            {
-                const auto& dst_point = cpy_rect.MapToGlobal(x, y);
-                const auto& src_point = src_rect_safe.MapToGlobal(dst_rect.MapToLocal(dst_point));
-                const auto& src_pixel = src.template ReadPixel<Pixel>(src_point);
-                dst.WritePixel(dst_point, src_pixel);
-            }
+            const auto& dst_point = cpy_rect.MapToGlobal(0, y);
+            const auto& src_point = src_rect_safe.MapToGlobal(dst_rect.MapToLocal(dst_point));
+            auto* dst_row = detail::GetViewRow(dst, dst_point.GetY(), dst_point.GetX());
+            const auto* src_row = detail::GetViewRow(src, src_point.GetY(), src_point.GetX());
+            std::memmove(dst_row, src_row, sizeof(Pixel) * cpy_rect.GetWidth());
         }
     }
 
@@ -126,6 +177,21 @@ namespace gfx
         const auto dst_height = dst.GetHeight();
         ASSERT(src_width == dst_width);
         ASSERT(src_height == dst_height);
+
+        const auto count = src_width * src_height;
+        if constexpr (std::is_same_v<SrcPixel, DstPixel>)
+        {
+            std::memmove(dst.GetWritePtr(), src.GetReadPtr(), sizeof(SrcPixel) * count);
+            return;
+        }
+        else if constexpr ((std::is_same_v<SrcPixel, Pixel_RGB> && std::is_same_v<DstPixel, Pixel_RGBA>) ||
+                           (std::is_same_v<SrcPixel, Pixel_RGBA> && std::is_same_v<DstPixel, Pixel_RGB>))
+        {
+            PixelSpan_Convert(static_cast<DstPixel*>(dst.GetWritePtr()),
+                              static_cast<const SrcPixel*>(src.GetReadPtr()), count);
+            return;
+        }
+
         for (unsigned row=0; row<src_height; ++row)
         {
             for (unsigned col=0; col<src_width; ++col)
@@ -152,16 +218,14 @@ namespace gfx
         const auto dst_height = dst.GetHeight();
         ASSERT(src_width == dst_width);
         ASSERT(src_height == dst_height);
-        for (unsigned row=0; row<src_height; ++row)
+        const auto* src_pixels = static_cast<const SrcPixel*>(src.GetReadPtr());
+        auto* dst_pixels = static_cast<DstPixel*>(dst.GetWritePtr());
+        for (unsigned i=0; i<src_width*src_height; ++i)
         {
-            for (unsigned col=0; col<src_width; ++col)
-            {
-                SrcPixel src_pixel;
-                DstPixel dst_pixel;
-                src.ReadPixel(row, col, &src_pixel);
-                conversion_op(src_pixel, &dst_pixel);
-                dst.WritePixel(row, col, dst_pixel);
-            }
+            // convert through a temporary in case the conversion is in-place.
+            DstPixel dst_pixel;
+            conversion_op(src_pixels[i], &dst_pixel);
+            dst_pixels[i] = dst_pixel;
         }
     }
 
@@ -183,15 +247,12 @@ namespace gfx
         const auto height = std::min(dst_rect_safe.GetHeight(), dst_rect_safe.GetHeight());
         for (unsigned row=0; row<height; ++row)
         {
-            for (unsigned col=0; col<width; ++col)
-            {
-                const auto& dst_point = dst_rect_safe.MapToGlobal(col, row);
-                const auto& src_point = src_rect_safe.MapToGlobal(col, row);
-                const auto& dst_pixel = dst.template ReadPixel<Pixel>(dst_point);
-                const auto& src_pixel = src.template ReadPixel<Pixel>(src_point);
-                if (!comparer(dst_pixel, src_pixel))
-                    return false;
-            }
+            const auto& dst_point = dst_rect_safe.MapToGlobal(0, row);
+            const auto& src_point = src_rect_safe.MapToGlobal(0, row);
+            const auto* dst_row = detail::GetViewRow(dst, dst_point.GetY(), dst_point.GetX());
+            const auto* src_row = detail::GetViewRow(src, src_point.GetY(), src_point.GetX());
+            if (!detail::CompareRow(dst_row, src_row, width, comparer))
+                return false;
         }
         return true;
     }
@@ -206,15 +267,14 @@ namespace gfx
         const auto bmp_width  = bmp.GetWidth();
         const auto bmp_height = bmp.GetHeight();
         const auto safe_rect  = Intersect(URect(0, 0, bmp_width, bmp_height), area);
+        // compare the rows against a row of reference pixels.
+        const std::vector<Pixel> reference_row(safe_rect.GetWidth(), reference);
         for (unsigned row=0; row<safe_rect.GetHeight(); ++row)
         {
-            for (unsigned col=0; col<safe_rect.GetWidth(); ++col)
-            {
-                const auto& bmp_point = safe_rect.MapToGlobal(col, row);
-                const auto& bmp_pixel = bmp.template ReadPixel<Pixel>(bmp_point);
-                if (!comparer(bmp_pixel, reference))
-                    return false;
-            }
+            const auto& bmp_point = safe_rect.MapToGlobal(0, row);
+            const auto* bmp_row = detail::GetViewRow(bmp, bmp_point.GetY(), bmp_point.GetX());
+            if (!detail::CompareRow(bmp_row, reference_row.data(), safe_rect.GetWidth(), comparer))
+                return false;
         }
         return true;
     }
@@ -17,7 +17,11 @@
 #include "config.h"
 
 #include <unordered_map>
+#include <algorithm>
+#include <vector>
 #include <stack>
+#include <limits>
+#include <optional>
 
 #include "base/assert.h"
 #include "base/logging.h"
@@ -32,6 +36,8 @@
 #include "graphics/device_framebuffer.h"
 #include "graphics/device_program.h"
 #include "graphics/device_instance.h"
+#include "graphics/device_uniform_buffer.h"
+#include "graphics/texture_streamer.h"
 
 namespace {
 class GraphicsDevice final : public gfx::Device {
@@ -56,6 +62,23 @@ public:
         mDefaultMagTextureFilter = filter;
     }
 
+    void EnableTextureStreaming(bool on_off) override
+    {
+        if (on_off && !mTextureStreamer)
+            mTextureStreamer = std::make_unique<gfx::TextureStreamer>();
+        else if (!on_off)
+            mTextureStreamer.reset();
+    }
+    gfx::TextureStreamer* GetTextureStreamer() override
+    {
+        return mTextureStreamer.get();
+    }
+    void SetTextureBudget(std::size_t bytes) override
+    {
+        mTextureBudget = bytes;
+    }
+    void GetTextureStats(TextureStats* stats) const override;
+
     gfx::ShaderPtr FindShader(const std::string& id) override;
     gfx::ShaderPtr CreateShader(const std::string& id, const gfx::Shader::CreateArgs& args) override;
     gfx::ProgramPtr FindProgram(const std::string& id) override;
@@ -92,6 +115,7 @@ public:
     void BeginFrame() override;
     void EndFrame(bool display = true) override;
     void GetResourceStats(ResourceStats* stats) const override;
+    void GetStateStats(StateStats* stats) const override;
     void GetDeviceCaps(DeviceCaps* caps) const override;
     gfx::Bitmap<gfx::Pixel_RGBA> ReadColorBuffer(unsigned width, unsigned height,
                                                  gfx::Framebuffer* fbo) const override;
@@ -101,6 +125,9 @@ public:
 private:
     dev::Framebuffer SetupFBO(gfx::Framebuffer* fbo) const;
     bool IsTextureFBOTarget(const gfx::Texture* texture) const;
+    bool IsTexturePinned(const gfx::DeviceTexture* texture) const;
+    void CompactBuffers(size_t max_bytes);
+    void EvictTextures();
 
 private:
     std::shared_ptr<dev::GraphicsDevice> mDeviceImpl;
@@ -114,7 +141,16 @@ private:
     std::unordered_map<std::string, std::shared_ptr<gfx::Program>> mPrograms;
     std::unordered_map<std::string, std::unique_ptr<gfx::Texture>> mTextures;
     std::unordered_map<std::string, std::unique_ptr<gfx::Framebuffer>> mFBOs;
+    std::unique_ptr<gfx::DeviceUniformBuffer> mUniformBuffer;
+    std::unique_ptr<gfx::TextureStreamer> mTextureStreamer;
     std::size_t mFrameNumber = 0;
+    // the device caps don't change so query them only once.
+    mutable std::optional<DeviceCaps> mDeviceCaps;
+    // texture memory budget in bytes and the eviction counters.
+    std::size_t mTextureBudget = 0;
+    std::size_t mTextureEvictedBytes = 0;
+    unsigned mTextureEvictions = 0;
+    bool mTextureBudgetWarning = true;
 
     struct State {
         ViewportState vs;
@@ -130,17 +166,20 @@ GraphicsDevice::GraphicsDevice(std::shared_ptr<dev::GraphicsDevice> device) noex
 {
     DEBUG("Create gfx::Device");
     mStateStack.push({});
+    mUniformBuffer = std::make_unique<gfx::DeviceUniformBuffer>(mDevice);
 }
 GraphicsDevice::GraphicsDevice(dev::GraphicsDevice* device) noexcept
   : mDevice(device)
 {
     DEBUG("Create gfx::Device");
     mStateStack.push({});
+    mUniformBuffer = std::make_unique<gfx::DeviceUniformBuffer>(mDevice);
 }
 
 GraphicsDevice::~GraphicsDevice()
 {
     DEBUG("Destroy gfx::Device");
+    mTextureStreamer.reset();
     // make sure our cleanup order is specific so that the
     // resources are deleted before the context is deleted.
     mFBOs.clear();
@@ -149,6 +188,7 @@ GraphicsDevice::~GraphicsDevice()
     mPrograms.clear();
     mGeoms.clear();
     mInstances.clear();
+    mUniformBuffer.reset();
 }
 
 void GraphicsDevice::ClearColor(const gfx::Color4f& color, gfx::Framebuffer* fbo, ColorAttachment attachment) const
@@ -234,7 +274,7 @@ gfx::ProgramPtr GraphicsDevice::CreateProgram(const std::string& id, const gfx::
 
     if (program->IsValid()) {
         // set the initial uniform state
-        program->ApplyUniformState(args.state);
+        program->ApplyUniformState(args.state, mUniformBuffer.get());
     }
 
     mPrograms[id] = program;
@@ -353,6 +393,8 @@ void GraphicsDevice::DeleteGeometries()
 void GraphicsDevice::DeleteTextures()
 {
     mTextures.clear();
+    if (mTextureStreamer)
+        mTextureStreamer->Clear();
 }
 
 void GraphicsDevice::DeleteFramebuffers()
@@ -452,7 +494,7 @@ void GraphicsDevice::Draw(const gfx::Program& program,
         return;
 
     TRACE_BLOCK("SetUniforms",
-        myprog->ApplyUniformState(program_state);
+        myprog->ApplyUniformState(program_state, mUniformBuffer.get());
         myprog->ApplyTextureState(program_state, mDefaultMinTextureFilter, mDefaultMagTextureFilter);
     );
 
@@ -672,11 +714,21 @@ void GraphicsDevice::CleanGarbage(size_t max_num_idle_frames, unsigned flags)
         if (did_have_instances && mInstances.empty())
             INFO("All GPU geometry instances were deleted.");
     }
+
+    if (flags & GCFlags::Buffers)
+    {
+        CompactBuffers(std::numeric_limits<size_t>::max());
+    }
 }
 
 void GraphicsDevice::BeginFrame()
 {
     mDevice->BeginFrame();
+    mUniformBuffer->BeginFrame();
+    if (mTextureBudget)
+        EvictTextures();
+    if (mTextureStreamer)
+        mTextureStreamer->BeginFrame();
 }
 
 void GraphicsDevice::EndFrame(bool display)
@@ -685,6 +737,13 @@ void GraphicsDevice::EndFrame(bool display)
 
     mFrameNumber++;
 
+    // incrementally compact the geometry buffers in the background
+    // with a limited number of bytes moved per frame.
+    if ((mFrameNumber % 60) == 0)
+    {
+        CompactBuffers(1024 * 1024);
+    }
+
     const auto max_num_idle_frames = 120;
 
     // clean up expired transient textures.
@@ -738,9 +797,38 @@ void GraphicsDevice::GetResourceStats(ResourceStats* stats) const
 {
     mDevice->GetResourceStats(stats);
 }
+void GraphicsDevice::GetTextureStats(TextureStats* stats) const
+{
+    *stats = TextureStats {};
+    stats->budget = mTextureBudget;
+    stats->evicted_bytes = mTextureEvictedBytes;
+    stats->evicted_textures = mTextureEvictions;
+    for (const auto& pair : mTextures)
+    {
+        const auto* impl = static_cast<const gfx::DeviceTexture*>(pair.second.get());
+        const auto bytes = impl->GetByteSize();
+        stats->resident_bytes += bytes;
+        stats->resident_textures++;
+        if (IsTexturePinned(impl))
+        {
+            stats->pinned_bytes += bytes;
+            stats->pinned_textures++;
+        }
+    }
+}
+void GraphicsDevice::GetStateStats(StateStats* stats) const
+{
+    mDevice->GetStateStats(stats);
+}
 void GraphicsDevice::GetDeviceCaps(DeviceCaps* caps) const
 {
-    mDevice->GetDeviceCaps(caps);
+    if (!mDeviceCaps.has_value())
+    {
+        DeviceCaps device_caps;
+        mDevice->GetDeviceCaps(&device_caps);
+        mDeviceCaps = device_caps;
+    }
+    *caps = mDeviceCaps.value();
 }
 
 dev::Framebuffer GraphicsDevice::SetupFBO(gfx::Framebuffer* framebuffer) const
@@ -767,6 +855,37 @@ dev::Framebuffer GraphicsDevice::SetupFBO(gfx::Framebuffer* framebuffer) const
     return mDevice->GetDefaultFramebuffer();
 }
 
+void GraphicsDevice::CompactBuffers(size_t max_bytes)
+{
+    ResourceStats stats;
+    mDevice->GetResourceStats(&stats);
+    // when all the free space is in a single range there's
+    // nothing to compact. moving the data would only move the
+    // free space around.
+    if (stats.buffer_free_ranges <= 1)
+        return;
+
+    size_t bytes = 0;
+    for (auto& pair : mGeoms)
+    {
+        const auto* impl = static_cast<const gfx::DeviceGeometry*>(pair.second.get());
+        bytes += impl->Compact();
+        if (bytes >= max_bytes)
+            return;
+    }
+    for (auto& pair : mInstances)
+    {
+        const auto* impl = static_cast<const gfx::DeviceDrawInstanceBuffer*>(pair.second.get());
+        bytes += impl->Compact();
+        if (bytes >= max_bytes)
+            return;
+    }
+    if (bytes)
+    {
+        DEBUG("Compacted geometry buffers. [bytes=%1]", bytes);
+    }
+}
+
 bool GraphicsDevice::IsTextureFBOTarget(const gfx::Texture* texture) const
 {
     for (const auto& pair: mFBOs)
@@ -786,6 +905,106 @@ bool GraphicsDevice::IsTextureFBOTarget(const gfx::Texture* texture) const
     return false;
 }
 
+bool GraphicsDevice::IsTexturePinned(const gfx::DeviceTexture* texture) const
+{
+    return !texture->GarbageCollect() || IsTextureFBOTarget(texture);
+}
+
+void GraphicsDevice::EvictTextures()
+{
+    std::size_t resident_bytes = 0;
+    for (const auto& pair : mTextures)
+    {
+        const auto* impl = static_cast<const gfx::DeviceTexture*>(pair.second.get());
+        // a texture whose contents were uploaded after the previous eviction
+        // counts as used now even if it hasn't been bound yet. otherwise an
+        // old texture that was just updated could be evicted immediately.
+        if (impl->TakeUploadFlag())
+            impl->SetFrameStamp(mFrameNumber);
+        resident_bytes += impl->GetByteSize();
+    }
+    if (resident_bytes <= mTextureBudget)
+    {
+        mTextureBudgetWarning = true;
+        return;
+    }
+
+    // textures in the same group are considered to be used together
+    // just like when collecting garbage.
+    std::unordered_map<std::string, std::size_t> group_last_use;
+    for (const auto& pair : mTextures)
+    {
+        const auto* impl = static_cast<const gfx::DeviceTexture*>(pair.second.get());
+        const auto& group = impl->GetGroup();
+        if (group.empty())
+            continue;
+        group_last_use[group] = std::max(group_last_use[group], impl->GetFrameStamp());
+    }
+
+    struct Candidate {
+        decltype(mTextures)::iterator it;
+        std::size_t last_used = 0;
+        std::size_t bytes = 0;
+    };
+    std::vector<Candidate> candidates;
+
+    for (auto it = mTextures.begin(); it != mTextures.end(); ++it)
+    {
+        const auto* impl = static_cast<const gfx::DeviceTexture*>(it->second.get());
+        const auto& group = impl->GetGroup();
+        const auto last_used = group.empty() ? impl->GetFrameStamp()
+                                             : std::max(impl->GetFrameStamp(), group_last_use[group]);
+        // never evict anything that was used to render the previous
+        // frame since it's likely going to be needed again right away.
+        if (last_used + 1 >= mFrameNumber)
+            continue;
+        if (IsTexturePinned(impl))
+            continue;
+        candidates.push_back({it, last_used, impl->GetByteSize()});
+    }
+
+    // evict the least recently used textures first and prefer
+    // the bigger textures in order to evict as few as possible.
+    std::sort(candidates.begin(), candidates.end(), [](const auto& lhs, const auto& rhs) {
+        if (lhs.last_used < rhs.last_used)
+            return true;
+        else if (lhs.last_used == rhs.last_used)
+            return lhs.bytes > rhs.bytes;
+        return false;
+    });
+
+    std::size_t evicted_bytes = 0;
+    unsigned evicted_textures = 0;
+    for (const auto& candidate : candidates)
+    {
+        if (resident_bytes <= mTextureBudget)
+            break;
+        resident_bytes -= candidate.bytes;
+        evicted_bytes += candidate.bytes;
+        evicted_textures++;
+        mTextures.erase(candidate.it);
+    }
+    mTextureEvictedBytes += evicted_bytes;
+    mTextureEvictions += evicted_textures;
+
+    if (evicted_textures)
+    {
+        DEBUG("Evicted textures to meet the texture budget. [count=%1, bytes=%2, budget=%3]",
+              evicted_textures, evicted_bytes, mTextureBudget);
+    }
+
+    if (resident_bytes > mTextureBudget && mTextureBudgetWarning)
+    {
+        WARN("Texture budget exceeded by pinned or recently used textures. [resident=%1, budget=%2]",
+             resident_bytes, mTextureBudget);
+        mTextureBudgetWarning = false;
+    }
+    else if (resident_bytes <= mTextureBudget)
+    {
+        mTextureBudgetWarning = true;
+    }
+}
+
 } // namespace
 
 namespace gfx {
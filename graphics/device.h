@@ -41,6 +41,7 @@ namespace gfx
     class GeometryDrawCommand;
     class Texture;
     class Framebuffer;
+    class TextureStreamer;
 
     class Device
     {
@@ -49,6 +50,7 @@ namespace gfx
         using ViewportState = dev::ViewportState;
         using ColorDepthStencilState = dev::ColorDepthStencilState;
         using ResourceStats = dev::GraphicsDeviceResourceStats;
+        using StateStats = dev::GraphicsDeviceStateStats;
         using DeviceCaps = dev::GraphicsDeviceCaps;
         using StateName  = dev::StateName;
         using StateValue = dev::StateValue;
@@ -94,6 +96,44 @@ namespace gfx
         virtual void SetDefaultTextureFilter(MinFilter filter) = 0;
         virtual void SetDefaultTextureFilter(MagFilter filter) = 0;
 
+        // Enable asynchronous texture streaming. When enabled texture
+        // sources that support streaming decode their data on the thread
+        // pool and upload it within a per frame budget. Until then a
+        // placeholder texture is used.
+        virtual void EnableTextureStreaming(bool on_off) = 0;
+        // Get the texture streamer or nullptr if streaming is not enabled.
+        virtual TextureStreamer* GetTextureStreamer() = 0;
+
+        // Texture memory residency statistics. The byte sizes are estimates
+        // computed from the texture dimensions and formats since the actual
+        // memory layout is up to the driver.
+        struct TextureStats {
+            // the current texture memory budget in bytes. 0 when not set.
+            std::size_t budget = 0;
+            // the memory used by all the currently resident textures.
+            std::size_t resident_bytes = 0;
+            unsigned resident_textures = 0;
+            // the memory used by the pinned textures that can't be evicted.
+            std::size_t pinned_bytes = 0;
+            unsigned pinned_textures = 0;
+            // the total number of textures (and their bytes) that have been
+            // evicted in order to stay within the budget.
+            std::size_t evicted_bytes = 0;
+            unsigned evicted_textures = 0;
+        };
+
+        // Set the texture memory budget in bytes. When the resident textures
+        // exceed the budget the least recently used textures are evicted on
+        // BeginFrame until the texture memory use is within the budget again.
+        // Textures used in the previous frame and pinned textures, i.e. textures
+        // that aren't eligible for garbage collection and textures used as frame
+        // buffer render targets, are never evicted. This means that the budget
+        // can temporarily be exceeded. Evicted textures are re-created by their
+        // texture sources (and streamed when streaming is enabled) when they're
+        // needed again. A budget of 0 disables the eviction.
+        virtual void SetTextureBudget(std::size_t bytes) = 0;
+        virtual void GetTextureStats(TextureStats* stats) const = 0;
+
         // resource creation APIs
         virtual ShaderPtr FindShader(const std::string& id) = 0;
         virtual ShaderPtr CreateShader(const std::string& id, const Shader::CreateArgs& args) = 0;
@@ -134,6 +174,9 @@ namespace gfx
             Programs   = 0x2,
             Geometries = 0x4,
             FBOs       = 0x8,
+            // compact the geometry buffers by moving the geometry
+            // data in order to reduce the buffer fragmentation.
+            Buffers    = 0x10,
         };
 
         // Delete GPU resources that are no longer being used and that are
@@ -160,6 +203,7 @@ namespace gfx
         virtual Bitmap<Pixel_RGBA> ReadColorBuffer(unsigned x, unsigned y, unsigned width, unsigned height, Framebuffer* fbo = nullptr) const = 0;
 
         virtual void GetResourceStats(ResourceStats* stats) const = 0;
+        virtual void GetStateStats(StateStats* stats) const = 0;
         virtual void GetDeviceCaps(DeviceCaps* caps) const = 0;
     private:
     };
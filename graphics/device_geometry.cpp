@@ -55,6 +55,9 @@ void DeviceGeometry::Upload() const
 
     if (mVertexBuffer.buffer_bytes != vertex_bytes)
     {
+        if (mVertexBuffer.IsValid())
+            mDevice->FreeBuffer(mVertexBuffer);
+
         mVertexBuffer = mDevice->AllocateBuffer(vertex_bytes, mUsage, dev::BufferType::VertexBuffer);
         if (mUsage == gfx::BufferUsage::Static)
         {
@@ -71,6 +74,9 @@ void DeviceGeometry::Upload() const
 
     if (mIndexBuffer.buffer_bytes != index_bytes)
     {
+        if (mIndexBuffer.IsValid())
+            mDevice->FreeBuffer(mIndexBuffer);
+
         mIndexBuffer = mDevice->AllocateBuffer(index_bytes, mUsage, dev::BufferType::IndexBuffer);
         if (mUsage == gfx::BufferUsage::Static)
         {
@@ -82,4 +88,14 @@ void DeviceGeometry::Upload() const
     mIndexBufferType = upload->GetIndexType();
 }
 
+size_t DeviceGeometry::Compact() const
+{
+    size_t bytes = 0;
+    if (mVertexBuffer.IsValid() && mDevice->RelocateBuffer(mVertexBuffer, &mVertexBuffer))
+        bytes += mVertexBuffer.buffer_bytes;
+    if (mIndexBuffer.IsValid() && mDevice->RelocateBuffer(mIndexBuffer, &mIndexBuffer))
+        bytes += mIndexBuffer.buffer_bytes;
+    return bytes;
+}
+
 } // namespace
\ No newline at end of file
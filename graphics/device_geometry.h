@@ -108,6 +108,10 @@ namespace gfx
         { return dev::GetIndexByteSize(mIndexBufferType); }
 
         void Upload() const;
+
+        // Try to move the geometry buffers to reduce the buffer
+        // fragmentation. Returns the number of bytes moved.
+        size_t Compact() const;
     private:
         dev::GraphicsDevice* mDevice = nullptr;
         dev::BufferUsage mUsage = BufferUsage::Static;
@@ -45,6 +45,9 @@ void DeviceDrawInstanceBuffer::Upload() const
     if (vertex_bytes == 0)
         return;
 
+    if (mBuffer.IsValid())
+        mDevice->FreeBuffer(mBuffer);
+
     mBuffer = mDevice->AllocateBuffer(vertex_bytes, mUsage, dev::BufferType::VertexBuffer);
     mDevice->UploadBuffer(mBuffer, vertex_ptr, vertex_bytes);
 
@@ -55,4 +58,11 @@ void DeviceDrawInstanceBuffer::Upload() const
     }
 }
 
+size_t DeviceDrawInstanceBuffer::Compact() const
+{
+    if (mBuffer.IsValid() && mDevice->RelocateBuffer(mBuffer, &mBuffer))
+        return mBuffer.buffer_bytes;
+    return 0;
+}
+
 } // namespace
\ No newline at end of file
@@ -66,6 +66,10 @@ namespace gfx
 
         void Upload() const;
 
+        // Try to move the instance buffer to reduce the buffer
+        // fragmentation. Returns the number of bytes moved.
+        size_t Compact() const;
+
     private:
         dev::GraphicsDevice* mDevice = nullptr;
         std::size_t mContentHash = 0;
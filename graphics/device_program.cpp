@@ -26,6 +26,7 @@
 #include "graphics/device_program.h"
 #include "graphics/device_shader.h"
 #include "graphics/device_texture.h"
+#include "graphics/device_uniform_buffer.h"
 
 namespace gfx
 {
@@ -37,15 +38,6 @@ DeviceProgram::~DeviceProgram()
         mDevice->DeleteProgram(mProgram);
         DEBUG("Deleted program object. [name='%1']", mName);
     }
-
-    for (auto pair : mUniformBlockBuffers)
-    {
-        const auto& buffer = pair.second;
-        if (buffer.IsValid())
-        {
-            mDevice->FreeBuffer(buffer);
-        }
-    }
 }
 
 bool DeviceProgram::Build(const std::vector<ShaderPtr>& shaders)
@@ -164,7 +156,7 @@ void DeviceProgram::ApplyTextureState(const ProgramState &state,
     }
 }
 
-void DeviceProgram::ApplyUniformState(const ProgramState& state) const
+void DeviceProgram::ApplyUniformState(const ProgramState& state, DeviceUniformBuffer* uniform_buffer) const
 {
     dev::ProgramState ps;
     for (size_t i=0; i<state.GetUniformCount(); ++i)
@@ -179,18 +171,13 @@ void DeviceProgram::ApplyUniformState(const ProgramState& state) const
     {
         const auto& block = state.GetUniformBlock(i);
 
-        auto gpu_buffer = mUniformBlockBuffers[block.GetName()];
-
         const auto& cpu_block_buffer = block.GetBuffer();
         const auto block_buffer_size = cpu_block_buffer.size();
+        if (block_buffer_size == 0)
+            continue;
 
-        if (gpu_buffer.buffer_bytes < block_buffer_size)
-        {
-            gpu_buffer = mDevice->AllocateBuffer(block_buffer_size, dev::BufferUsage::Stream, dev::BufferType::UniformBuffer);
-        }
-        mDevice->UploadBuffer(gpu_buffer, cpu_block_buffer.data(), block_buffer_size);
+        const auto& gpu_buffer = uniform_buffer->Upload(cpu_block_buffer.data(), block_buffer_size);
         mDevice->BindProgramBuffer(mProgram, gpu_buffer, block.GetName(), i); // todo: binding index ??
-        mUniformBlockBuffers[block.GetName()] = gpu_buffer;
 
         for (auto& info : mUniformInfo)
         {
@@ -30,6 +30,7 @@
 namespace gfx
 {
     class DeviceShader;
+    class DeviceUniformBuffer;
 
     class DeviceProgram : public Program
     {
@@ -62,7 +63,7 @@ namespace gfx
 
         void ApplyTextureState(const ProgramState& state,
             TextureMinFilter device_default_min_filter, TextureMagFilter device_default_mag_filter) const;
-        void ApplyUniformState(const ProgramState& state) const;
+        void ApplyUniformState(const ProgramState& state, DeviceUniformBuffer* uniform_buffer) const;
         void ValidateProgramState(const ProgramState& state) const;
 
     private:
@@ -80,7 +81,6 @@ namespace gfx
         // lest there be GL_INVALID_OPERATION from the draw call...
         mutable std::vector<UniformInfo> mUniformInfo;
 
-        mutable std::unordered_map<std::string, dev::GraphicsBuffer> mUniformBlockBuffers;
         mutable std::size_t mFrameNumber = 0;
     };
 
@@ -60,6 +60,19 @@ void DeviceTexture::Upload(const void* bytes, unsigned width, unsigned height, F
     mFormat = format;
     mArraySize = 0;
     mHasMips = false;
+    mUploaded = true;
+}
+
+void DeviceTexture::UploadMip(unsigned mip_level, const void* bytes, size_t byte_count,
+                              unsigned mip_width, unsigned mip_height)
+{
+    ASSERT(mTexture.IsValid());
+    ASSERT(mip_level > 0);
+
+    mDevice->UploadTexture2DMip(mTexture, mip_level, bytes, byte_count, mip_width, mip_height);
+    if (mip_width == 1 && mip_height == 1)
+        mHasMips = true;
+    mUploaded = true;
 }
 
 void DeviceTexture::Allocate(unsigned width, unsigned height, Format format)
@@ -78,6 +91,7 @@ void DeviceTexture::Allocate(unsigned width, unsigned height, Format format)
     mFormat = format;
     mArraySize = 0;
     mHasMips = false;
+    mUploaded = true;
 }
 
 void DeviceTexture::AllocateArray(unsigned width, unsigned height, unsigned array_size, Format format)
@@ -97,6 +111,7 @@ void DeviceTexture::AllocateArray(unsigned width, unsigned height, unsigned arra
     mFormat = format;
     mArraySize = array_size;
     mHasMips = false;
+    mUploaded = true;
 }
 
 bool DeviceTexture::GenerateMips()
@@ -125,5 +140,31 @@ bool DeviceTexture::GenerateMips()
     return mHasMips;
 }
 
+std::size_t DeviceTexture::GetByteSize() const noexcept
+{
+    if (!mTexture.IsValid())
+        return 0;
+
+    std::size_t bytes = 0;
+    if (dev::IsCompressedFormat(mFormat))
+        bytes = dev::GetCompressedTextureByteSize(mFormat, mWidth, mHeight);
+    else
+    {
+        // RGB textures are typically padded to 4 bytes per pixel
+        // by the driver so account for that.
+        std::size_t bytes_per_pixel = 4;
+        if (mFormat == Format::AlphaMask)
+            bytes_per_pixel = 1;
+        else if (mFormat == Format::RGBA32f)
+            bytes_per_pixel = 16;
+        bytes = std::size_t(mWidth) * std::size_t(mHeight) * bytes_per_pixel;
+    }
+    if (mArraySize)
+        bytes *= mArraySize;
+    // the complete mip chain adds roughly a third to the size.
+    if (mHasMips)
+        bytes += bytes / 3;
+    return bytes;
+}
 
 } // namespace
\ No newline at end of file
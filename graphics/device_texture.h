@@ -41,6 +41,8 @@ namespace gfx {
         ~DeviceTexture() override;
 
         void Upload(const void* bytes, unsigned width, unsigned height, Format format) override;
+        void UploadMip(unsigned mip_level, const void* bytes, size_t byte_count,
+                       unsigned mip_width, unsigned mip_height) override;
         void Allocate(unsigned width, unsigned height, Format format) override;
         void AllocateArray(unsigned width, unsigned height, unsigned array_size, Format format) override;
         bool GenerateMips() override;
@@ -117,6 +119,20 @@ namespace gfx {
             return mFrameNumber;
         }
 
+        // Check whether the texture has been uploaded (or allocated)
+        // since the last call. The texture itself doesn't know the
+        // device frame number so the device uses this to stamp the
+        // texture as used when its contents change.
+        inline bool TakeUploadFlag() const noexcept
+        {
+            auto ret = mUploaded;
+            mUploaded = false;
+            return ret;
+        }
+
+        // Get the estimated GPU memory use of the texture in bytes.
+        std::size_t GetByteSize() const noexcept;
+
     private:
         dev::GraphicsDevice* mDevice = nullptr;
         dev::TextureObject mTexture;
@@ -140,6 +156,7 @@ namespace gfx {
         bool mHasMips = false;
         mutable bool mWarnOnce = true;
         mutable std::size_t mFrameNumber = 0;
+        mutable bool mUploaded = false;
     };
 
 } // namespace
\ No newline at end of file
@@ -0,0 +1,133 @@
+// Copyright (C) 2020-2025 Sami Väisänen
+// Copyright (C) 2020-2025 Ensisoft http://www.ensisoft.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "config.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+#include "base/assert.h"
+#include "base/logging.h"
+#include "graphics/device_uniform_buffer.h"
+
+namespace gfx
+{
+
+DeviceUniformBuffer::~DeviceUniformBuffer()
+{
+    for (auto& frame : mFrames)
+    {
+        for (auto& buffer : frame.buffers)
+        {
+            mDevice->FreeBuffer(buffer.buffer);
+        }
+    }
+}
+
+dev::GraphicsBuffer DeviceUniformBuffer::Upload(const void* data, std::size_t bytes)
+{
+    ASSERT(bytes);
+
+    if (mAlignment == 0)
+    {
+        dev::GraphicsDeviceCaps caps;
+        mDevice->GetDeviceCaps(&caps);
+        mAlignment = std::max(caps.uniform_buffer_offset_alignment, 1u);
+    }
+
+    auto& frame = mFrames[mFrameIndex];
+
+    const auto hash = std::hash<std::string_view>()(std::string_view((const char*)data, bytes));
+    const auto [begin, end] = frame.ranges.equal_range(hash);
+    for (auto it = begin; it != end; ++it)
+    {
+        const auto& range = it->second;
+        const auto& buffer = frame.buffers[range.buffer_index];
+        if (range.bytes != bytes)
+            continue;
+        if (std::memcmp(&buffer.data[range.offset], data, bytes))
+            continue;
+
+        mStats.reuses++;
+        return MakeRange(buffer, range);
+    }
+
+    // find a buffer with enough space for the data at the next
+    // aligned offset. Typically, this is the last buffer but
+    // a block that didn't fit might leave space behind.
+    std::size_t buffer_index = 0;
+    std::size_t buffer_offset = 0;
+    for (buffer_index=0; buffer_index<frame.buffers.size(); ++buffer_index)
+    {
+        const auto& buffer = frame.buffers[buffer_index];
+        buffer_offset = (buffer.offset + mAlignment - 1) / mAlignment * mAlignment;
+        if (buffer_offset + bytes <= buffer.data.size())
+            break;
+    }
+    if (buffer_index == frame.buffers.size())
+    {
+        const auto buffer_size = std::max(BufferSize, bytes);
+
+        Buffer buffer;
+        buffer.buffer = mDevice->AllocateBuffer(buffer_size, dev::BufferUsage::Dynamic, dev::BufferType::UniformBuffer);
+        buffer.data.resize(buffer_size);
+        frame.buffers.push_back(std::move(buffer));
+        buffer_offset = 0;
+        DEBUG("Allocated new uniform ring buffer. [frame=%1, size=%2]", mFrameIndex, buffer_size);
+    }
+
+    auto& buffer = frame.buffers[buffer_index];
+    std::memcpy(&buffer.data[buffer_offset], data, bytes);
+    buffer.offset = buffer_offset + bytes;
+
+    Range range;
+    range.buffer_index = buffer_index;
+    range.offset = buffer_offset;
+    range.bytes  = bytes;
+    frame.ranges.insert({hash, range});
+
+    const auto& ret = MakeRange(buffer, range);
+    mDevice->UploadBuffer(ret, data, bytes);
+
+    mStats.uploads++;
+    mStats.bytes += bytes;
+    return ret;
+}
+
+void DeviceUniformBuffer::BeginFrame()
+{
+    mFrameIndex = (mFrameIndex + 1) % FrameCount;
+
+    auto& frame = mFrames[mFrameIndex];
+    for (auto& buffer : frame.buffers)
+    {
+        buffer.offset = 0;
+    }
+    frame.ranges.clear();
+    mStats = Stats {};
+}
+
+// static
+dev::GraphicsBuffer DeviceUniformBuffer::MakeRange(const Buffer& buffer, const Range& range) noexcept
+{
+    dev::GraphicsBuffer ret = buffer.buffer;
+    ret.buffer_offset = buffer.buffer.buffer_offset + range.offset;
+    ret.buffer_bytes  = range.bytes;
+    return ret;
+}
+
+} // namespace
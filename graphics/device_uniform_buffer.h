@@ -0,0 +1,99 @@
+// Copyright (C) 2020-2025 Sami Väisänen
+// Copyright (C) 2020-2025 Ensisoft http://www.ensisoft.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "config.h"
+
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+#include "device/graphics.h"
+
+namespace gfx
+{
+    // Per frame ring buffer for uniform block data. The uniform block
+    // data is sub-allocated from large uniform buffer objects and the
+    // resulting buffer ranges are then bound to the program with ranged
+    // binding. Every frame in the ring has its own set of buffers so that
+    // writing the data for the current frame doesn't overwrite data that
+    // might still be in use by the GPU for rendering the previous frame.
+    // Identical block data within a frame is only uploaded once.
+    class DeviceUniformBuffer
+    {
+    public:
+        struct Stats {
+            // number of block data uploads during the current frame.
+            unsigned uploads = 0;
+            // number of times previously uploaded data was re-used.
+            unsigned reuses = 0;
+            // number of bytes uploaded during the current frame.
+            std::size_t bytes = 0;
+        };
+        // The number of frames in the ring.
+        static constexpr unsigned FrameCount = 3;
+        // The default size of a single buffer object in bytes.
+        static constexpr std::size_t BufferSize = 64 * 1024;
+
+        explicit DeviceUniformBuffer(dev::GraphicsDevice* device) noexcept
+          : mDevice(device)
+        {}
+       ~DeviceUniformBuffer();
+        DeviceUniformBuffer(const DeviceUniformBuffer&) = delete;
+
+        // Upload the uniform block data and return the buffer range
+        // that contains the data. If the exact same data has already
+        // been uploaded during the current frame the previous range
+        // is returned and nothing is uploaded.
+        dev::GraphicsBuffer Upload(const void* data, std::size_t bytes);
+
+        // Begin a new frame and start re-using the buffers of the
+        // oldest frame in the ring.
+        void BeginFrame();
+
+        inline const Stats& GetStats() const noexcept
+        { return mStats; }
+
+        DeviceUniformBuffer& operator=(const DeviceUniformBuffer&) = delete;
+    private:
+        struct Buffer {
+            dev::GraphicsBuffer buffer;
+            std::size_t offset = 0;
+            // copy of the buffer contents for comparing the data
+            // when looking for a duplicate.
+            std::vector<std::uint8_t> data;
+        };
+        struct Range {
+            std::size_t buffer_index = 0;
+            std::size_t offset = 0;
+            std::size_t bytes  = 0;
+        };
+        struct Frame {
+            std::vector<Buffer> buffers;
+            std::unordered_multimap<std::size_t, Range> ranges;
+        };
+        static dev::GraphicsBuffer MakeRange(const Buffer& buffer, const Range& range) noexcept;
+
+        dev::GraphicsDevice* mDevice = nullptr;
+        std::size_t mAlignment = 0;
+        unsigned mFrameIndex = 0;
+        Frame mFrames[FrameCount];
+        Stats mStats;
+    };
+
+} // namespace
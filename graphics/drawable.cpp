@@ -25,6 +25,7 @@
 #include "graphics/simple_shape.h"
 #include "graphics/polygon_mesh.h"
 #include "graphics/particle_engine.h"
+#include "graphics/fluid_simulation.h"
 
 namespace gfx {
 
@@ -41,6 +42,8 @@ DrawCategory DrawableClass::MapDrawableCategory(Type type) noexcept
              type == Type::LineBatch3D ||
              type == Type::LineBatch2D ||
              type == Type::GuideGrid ||
+             type == Type::Text ||
+             type == Type::FluidSimulation ||
              type == Type::Other)
         return DrawCategory::Basic;
     BUG("Bug on draw category mapping based on drawable type.");
@@ -138,6 +141,8 @@ std::unique_ptr<Drawable> CreateDrawableInstance(const std::shared_ptr<const Dra
         return std::make_unique<ParticleEngineInstance>(std::static_pointer_cast<const ParticleEngineClass>(klass));
     else if (type == DrawableClass::Type::Polygon)
         return std::make_unique<PolygonMeshInstance>(std::static_pointer_cast<const PolygonMeshClass>(klass));
+    else if (type == DrawableClass::Type::FluidSimulation)
+        return std::make_unique<FluidSimulationInstance>(std::static_pointer_cast<const FluidSimulationClass>(klass));
     else BUG("Unhandled drawable class type");
     return nullptr;
 }
@@ -150,6 +150,22 @@ namespace gfx
         virtual std::string GetInstanceId(const Environment& env, const InstancedDraw& draw) const
         { return draw.gpu_id; }
 
+        // Drawable instancing support.
+        // Some drawables, such as particle engines, can draw their geometry once
+        // per instance with the per instance data generated by the drawable itself.
+        // This is separate from the client side instancing above and is only used
+        // when the client isn't doing an instanced draw.
+
+        // Returns true if the drawable draws its geometry as instances with
+        // the instance data from ConstructInstances.
+        virtual bool HasDrawableInstances(const Environment& env) const
+        { return false; }
+        // Construct the drawable's own instance buffer. The buffer is
+        // always considered to be streaming data.
+        // Returns true if successful or false if there's nothing to draw.
+        virtual bool ConstructInstances(const Environment& env, Device& device, gfx::InstancedDraw::CreateArgs& args) const
+        { return false; }
+
         // Execute drawable commands coming from the scripting environment.
         // The commands can be used to change the drawable, alter its parameters
         // or trigger its function such as particle emission.
@@ -70,6 +70,8 @@ namespace gfx
             GuideGrid,
             DebugDrawable,
             EffectsDrawable,
+            Text,
+            FluidSimulation,
             Other
         };
         enum class MeshType {
@@ -93,6 +95,10 @@ namespace gfx
             bool flip_uv_horizontally = false;
             // true to indicate that we're going to do instanced draw.
             bool use_instancing = false;
+            // true if the device supports instanced rendering. Drawables that
+            // generate their own per instance data must fall back to non-instanced
+            // geometry when this is false.
+            bool instancing_supported = false;
             // true if running in an "editor mode", which means that even
             // content marked static might have changed and should be checked
             // in case it has been modified and should be re-uploaded.
@@ -0,0 +1,677 @@
+// Copyright (C) 2020-2025 Sami Väisänen
+// Copyright (C) 2020-2025 Ensisoft http://www.ensisoft.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "config.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "base/assert.h"
+#include "base/hash.h"
+#include "base/logging.h"
+#include "base/threadpool.h"
+#include "base/utility.h"
+#include "data/writer.h"
+#include "data/reader.h"
+#include "graphics/device.h"
+#include "graphics/fluid_simulation.h"
+#include "graphics/program.h"
+#include "graphics/shader_source.h"
+#include "graphics/texture.h"
+#include "graphics/vertex.h"
+
+namespace {
+    using Grid = gfx::FluidSimulationClass::Grid;
+
+    // The boundary condition to apply on the field. The velocity
+    // component normal to the wall is mirrored so that nothing
+    // flows through the walls.
+    enum class Boundary {
+        Scalar, VelocityX, VelocityY
+    };
+
+    // The smallest grid that is solved in parallel. On smaller grids
+    // the cost of synchronizing the worker threads after every solver
+    // iteration is higher than the cost of solving the grid.
+    constexpr unsigned MinParallelCells = 128 * 128;
+
+    // The maximum number of simulation steps per update. If the update
+    // falls behind (for example after a long frame) the simulation is
+    // slowed down instead of trying to catch up with ever more steps.
+    constexpr unsigned MaxStepsPerUpdate = 4;
+
+    // Get the number of grid rows per parallel task.
+    std::size_t GetRowGrain(const Grid& grid) noexcept
+    {
+        return std::max<std::size_t>(1, 4096 / grid.GetStride());
+    }
+
+    template<typename Function>
+    void ForEachRow(base::ThreadPool* pool, const Grid& grid, Function function)
+    {
+        base::ParallelFor(pool, 1, grid.height + 1, GetRowGrain(grid), function);
+    }
+
+    void SetBoundary(Boundary boundary, float* x, unsigned width, unsigned height) noexcept
+    {
+        const std::size_t stride = width + 2;
+        const float sx = boundary == Boundary::VelocityX ? -1.0f : 1.0f;
+        const float sy = boundary == Boundary::VelocityY ? -1.0f : 1.0f;
+        for (unsigned i=1; i<=width; ++i)
+        {
+            x[i] = sy * x[stride + i];
+            x[(height+1) * stride + i] = sy * x[height * stride + i];
+        }
+        for (unsigned j=1; j<=height; ++j)
+        {
+            x[j * stride] = sx * x[j * stride + 1];
+            x[j * stride + width + 1] = sx * x[j * stride + width];
+        }
+        const auto bottom = (height + 1) * stride;
+        x[0]                  = 0.5f * (x[1] + x[stride]);
+        x[width + 1]          = 0.5f * (x[width] + x[stride + width + 1]);
+        x[bottom]             = 0.5f * (x[bottom + 1] + x[height * stride]);
+        x[bottom + width + 1] = 0.5f * (x[bottom + width] + x[height * stride + width + 1]);
+    }
+
+    // Compute one Jacobi iteration on one grid row. All the pointers
+    // point to the start of the row.
+    void JacobiRow(float* __restrict out, const float* __restrict in, const float* __restrict rhs,
+                   float a, float inv_c, std::size_t stride, unsigned width) noexcept
+    {
+        for (unsigned i=1; i<=width; ++i)
+            out[i] = (rhs[i] + a * (in[i-1] + in[i+1] + in[i-stride] + in[i+stride])) * inv_c;
+    }
+
+    // Solve the linear system x = (x0 + a * sum of x neighbours) / c
+    // with Jacobi iterations. The current x is used as the initial guess.
+    void LinearSolve(Boundary boundary, std::vector<float>& x, const std::vector<float>& x0,
+                     float a, float c, unsigned iterations, Grid& grid, base::ThreadPool* pool)
+    {
+        const auto stride = grid.GetStride();
+        const auto width  = grid.width;
+        const auto inv_c  = 1.0f / c;
+        for (unsigned iter=0; iter<iterations; ++iter)
+        {
+            const float* in  = x.data();
+            const float* rhs = x0.data();
+            float* out = grid.jacobi.data();
+            ForEachRow(pool, grid, [=](std::size_t row) {
+                const auto offset = row * stride;
+                JacobiRow(out + offset, in + offset, rhs + offset, a, inv_c, stride, width);
+            });
+            SetBoundary(boundary, out, grid.width, grid.height);
+            std::swap(x, grid.jacobi);
+        }
+    }
+
+    // Move the field d0 along the velocity field by tracing the cell
+    // centers back in time and interpolating the field d0 at the traced
+    // position.
+    void AdvectRow(float* __restrict d, const float* __restrict d0,
+                   const float* __restrict u, const float* __restrict v,
+                   float dt0, unsigned width, unsigned height, std::size_t row) noexcept
+    {
+        const std::size_t stride = width + 2;
+        const float max_x = float(width) + 0.5f;
+        const float max_y = float(height) + 0.5f;
+        for (unsigned i=1; i<=width; ++i)
+        {
+            const auto index = row * stride + i;
+            const float x = std::clamp(float(i) - dt0 * u[index], 0.5f, max_x);
+            const float y = std::clamp(float(row) - dt0 * v[index], 0.5f, max_y);
+            const auto i0 = static_cast<std::size_t>(x);
+            const auto j0 = static_cast<std::size_t>(y);
+            const float s1 = x - float(i0);
+            const float s0 = 1.0f - s1;
+            const float t1 = y - float(j0);
+            const float t0 = 1.0f - t1;
+            const auto top    = j0 * stride + i0;
+            const auto bottom = top + stride;
+            d[index] = s0 * (t0 * d0[top]     + t1 * d0[bottom]) +
+                       s1 * (t0 * d0[top + 1] + t1 * d0[bottom + 1]);
+        }
+    }
+
+    void DivergenceRow(float* __restrict div, const float* __restrict u, const float* __restrict v,
+                       float h, std::size_t stride, unsigned width) noexcept
+    {
+        for (unsigned i=1; i<=width; ++i)
+            div[i] = -0.5f * h * (u[i+1] - u[i-1] + v[i+stride] - v[i-stride]);
+    }
+
+    void SubtractGradientRow(float* __restrict u, float* __restrict v, const float* __restrict p,
+                             float inv_h, std::size_t stride, unsigned width) noexcept
+    {
+        for (unsigned i=1; i<=width; ++i)
+        {
+            u[i] -= 0.5f * inv_h * (p[i+1] - p[i-1]);
+            v[i] -= 0.5f * inv_h * (p[i+stride] - p[i-stride]);
+        }
+    }
+
+    void ScaleField(float* __restrict x, float scale, std::size_t count) noexcept
+    {
+        for (std::size_t i=0; i<count; ++i)
+            x[i] *= scale;
+    }
+
+    // Make the velocity field mass conserving (divergence free) by
+    // solving for the pressure and subtracting the pressure gradient.
+    // The previous pressure is used as the initial guess since the
+    // pressure changes little from one step to the next.
+    void Project(Grid& grid, unsigned iterations, float h, base::ThreadPool* pool)
+    {
+        const auto stride = grid.GetStride();
+        const auto width  = grid.width;
+        {
+            float* div = grid.divergence.data();
+            const float* u = grid.velocity_x.data();
+            const float* v = grid.velocity_y.data();
+            ForEachRow(pool, grid, [=](std::size_t row) {
+                const auto offset = row * stride;
+                DivergenceRow(div + offset, u + offset, v + offset, h, stride, width);
+            });
+            SetBoundary(Boundary::Scalar, div, grid.width, grid.height);
+        }
+
+        LinearSolve(Boundary::Scalar, grid.pressure, grid.divergence, 1.0f, 4.0f, iterations, grid, pool);
+
+        {
+            float* u = grid.velocity_x.data();
+            float* v = grid.velocity_y.data();
+            const float* p = grid.pressure.data();
+            const float inv_h = 1.0f / h;
+            ForEachRow(pool, grid, [=](std::size_t row) {
+                const auto offset = row * stride;
+                SubtractGradientRow(u + offset, v + offset, p + offset, inv_h, stride, width);
+            });
+            SetBoundary(Boundary::VelocityX, u, grid.width, grid.height);
+            SetBoundary(Boundary::VelocityY, v, grid.width, grid.height);
+        }
+    }
+
+    // Add the value to the field around the given grid position with
+    // a gaussian falloff. The position and radius are in grid cells.
+    void Splat(const Grid& grid, std::vector<float>& field, float cx, float cy, float radius, float value)
+    {
+        const float r = std::max(radius, 0.5f);
+        const float inv_r2 = 1.0f / (r * r);
+        // beyond 3 radii the weights are negligible.
+        const int x0 = std::max(1, int(std::floor(cx - 3.0f * r)));
+        const int y0 = std::max(1, int(std::floor(cy - 3.0f * r)));
+        const int x1 = std::min(int(grid.width),  int(std::ceil(cx + 3.0f * r)));
+        const int y1 = std::min(int(grid.height), int(std::ceil(cy + 3.0f * r)));
+        for (int y=y0; y<=y1; ++y)
+        {
+            for (int x=x0; x<=x1; ++x)
+            {
+                // the cell center is at half a cell from the cell edge
+                const float dx = float(x) - 0.5f - cx;
+                const float dy = float(y) - 0.5f - cy;
+                field[grid.GetIndex(x, y)] += value * std::exp(-(dx*dx + dy*dy) * inv_r2);
+            }
+        }
+    }
+
+    // Get the grid cell size in simulation units. The longer side of the
+    // simulation is 1.0 units long and the cells are square.
+    float GetCellSize(const Grid& grid) noexcept
+    {
+        return 1.0f / float(std::max(grid.width, grid.height));
+    }
+
+    bool ReadFloatArg(const gfx::Drawable::Command& cmd, const char* name, float* value)
+    {
+        const auto* arg = base::SafeFind(cmd.args, std::string(name));
+        if (arg == nullptr)
+            return false;
+        if (const auto* val = std::get_if<float>(arg))
+            *value = *val;
+        else if (const auto* val = std::get_if<int>(arg))
+            *value = static_cast<float>(*val);
+        else
+        {
+            WARN("Fluid simulation command argument has wrong type. Expected 'float'. [cmd='%1', arg='%2']", cmd.name, name);
+            return false;
+        }
+        return true;
+    }
+
+} // namespace
+
+namespace gfx
+{
+
+bool FluidSimulationClass::ApplyDynamicState(const Environment& env, Device& device, const InstanceState& state,
+                                             const std::string& instance_id, ProgramState& program) const
+{
+    unsigned flags = 0;
+    if (env.flip_uv_horizontally)
+        flags |= static_cast<unsigned>(DrawableFlags::Flip_UV_Horizontally);
+    if (env.flip_uv_vertically)
+        flags |= static_cast<unsigned>(DrawableFlags::Flip_UV_Vertically);
+
+    program.SetUniform("kProjectionMatrix", *env.proj_matrix);
+    program.SetUniform("kModelViewMatrix", *env.view_matrix * *env.model_matrix);
+    program.SetUniform("kDrawableFlags", flags);
+
+    const auto* texture = UploadDensity(device, state, instance_id);
+    if (!texture)
+        return false;
+
+    // bind the density texture after the material textures.
+    const auto texture_count = program.GetSamplerCount();
+    program.SetTexture("kFluidDensityMap", texture_count, *texture);
+    program.SetTextureCount(texture_count + 1);
+    return true;
+}
+
+bool FluidSimulationClass::Construct(const Environment& env, Geometry::CreateArgs& create) const
+{
+    // same layout as the rectangle shape.
+    const Vertex2D vertices[6] = {
+        { {0.0f,  0.0f}, {0.0f, 0.0f} },
+        { {0.0f, -1.0f}, {0.0f, 1.0f} },
+        { {1.0f, -1.0f}, {1.0f, 1.0f} },
+        { {0.0f,  0.0f}, {0.0f, 0.0f} },
+        { {1.0f, -1.0f}, {1.0f, 1.0f} },
+        { {1.0f,  0.0f}, {1.0f, 0.0f} }
+    };
+    create.content_name = "FluidSimulation/" + mName;
+    create.usage = Geometry::Usage::Static;
+    auto& geometry = create.buffer;
+    geometry.SetVertexBuffer(vertices, 6);
+    geometry.SetVertexLayout(GetVertexLayout<Vertex2D>());
+    geometry.AddDrawCmd(Geometry::DrawType::Triangles);
+    return true;
+}
+
+void FluidSimulationClass::Update(const Environment& env, InstanceState& state, float dt) const
+{
+    auto& grid = state.grid;
+    if (grid.width != std::max(mParams.grid_width, 1u) || grid.height != std::max(mParams.grid_height, 1u))
+        Restart(state);
+
+    const auto time_step = mParams.time_step > 0.0f ? mParams.time_step : 1.0f / 60.0f;
+    auto* pool = GetSolverThreadPool(grid);
+
+    state.time_accum += dt;
+
+    unsigned steps = 0;
+    while (state.time_accum >= time_step && steps < MaxStepsPerUpdate)
+    {
+        StepSimulation(mParams, grid, time_step, pool);
+        state.time_accum -= time_step;
+        ++steps;
+    }
+    if (steps == MaxStepsPerUpdate)
+        state.time_accum = std::min(state.time_accum, time_step);
+    if (steps)
+        ++state.version;
+}
+
+void FluidSimulationClass::Restart(InstanceState& state) const
+{
+    InitGrid(mParams, state.grid);
+    state.time_accum = 0.0f;
+    ++state.version;
+}
+
+Texture* FluidSimulationClass::UploadDensity(Device& device, const InstanceState& state, const std::string& instance_id) const
+{
+    const auto& gpu_id = GetDensityTextureId(instance_id);
+    auto* texture = device.FindTexture(gpu_id);
+    if (!texture)
+    {
+        texture = device.MakeTexture(gpu_id);
+        texture->SetName("FluidSimulationDensity/" + mName + "/" + instance_id);
+        texture->SetFilter(Texture::MinFilter::Linear);
+        texture->SetFilter(Texture::MagFilter::Linear);
+        texture->SetWrapX(Texture::Wrapping::Clamp);
+        texture->SetWrapY(Texture::Wrapping::Clamp);
+        texture->SetGarbageCollection(true);
+    }
+
+    std::size_t hash = 0;
+    hash = base::hash_combine(hash, state.version);
+    if (texture->GetContentHash() == hash)
+        return texture;
+
+    static thread_local std::vector<std::uint8_t> texels;
+    ConvertDensity(state.grid, texels);
+    texture->Upload(texels.data(), state.grid.width, state.grid.height, Texture::Format::AlphaMask);
+    texture->SetContentHash(hash);
+    return texture;
+}
+
+void FluidSimulationClass::AddDensity(InstanceState& state, const glm::vec2& position, float amount, float radius) const
+{
+    auto& grid = state.grid;
+    const auto cx = position.x * float(grid.width);
+    const auto cy = position.y * float(grid.height);
+    Splat(grid, grid.density, cx, cy, radius * float(grid.width), amount);
+    ++state.version;
+}
+
+void FluidSimulationClass::AddVelocity(InstanceState& state, const glm::vec2& position, const glm::vec2& velocity, float radius) const
+{
+    auto& grid = state.grid;
+    const auto cx = position.x * float(grid.width);
+    const auto cy = position.y * float(grid.height);
+    // convert from simulation widths to simulation units.
+    const auto scale = float(grid.width) * GetCellSize(grid);
+    Splat(grid, grid.velocity_x, cx, cy, radius * float(grid.width), velocity.x * scale);
+    Splat(grid, grid.velocity_y, cx, cy, radius * float(grid.width), velocity.y * scale);
+}
+
+std::string FluidSimulationClass::GetDensityTextureId(const std::string& instance_id) const
+{
+    return "FluidSimulation/" + mId + "/" + instance_id + "/Density";
+}
+
+void FluidSimulationClass::SetName(const std::string& name)
+{
+    mName = name;
+}
+
+Drawable::Type FluidSimulationClass::GetType() const
+{
+    return Type::FluidSimulation;
+}
+
+SpatialMode FluidSimulationClass::GetSpatialMode() const
+{
+    return SpatialMode::Flat2D;
+}
+
+std::string FluidSimulationClass::GetId() const
+{
+    return mId;
+}
+
+std::string FluidSimulationClass::GetName() const
+{
+    return mName;
+}
+
+std::size_t FluidSimulationClass::GetHash() const
+{
+    size_t hash = 0;
+    hash = base::hash_combine(hash, mId);
+    hash = base::hash_combine(hash, mName);
+    hash = base::hash_combine(hash, mParams);
+    return hash;
+}
+
+void FluidSimulationClass::IntoJson(data::Writer& data) const
+{
+    data.Write("id",                   mId);
+    data.Write("name",                 mName);
+    data.Write("grid_width",           mParams.grid_width);
+    data.Write("grid_height",          mParams.grid_height);
+    data.Write("solver_iterations",    mParams.solver_iterations);
+    data.Write("time_step",            mParams.time_step);
+    data.Write("viscosity",            mParams.viscosity);
+    data.Write("diffusion",            mParams.diffusion);
+    data.Write("density_dissipation",  mParams.density_dissipation);
+    data.Write("velocity_dissipation", mParams.velocity_dissipation);
+    data.Write("buoyancy",             mParams.buoyancy);
+}
+
+bool FluidSimulationClass::FromJson(const data::Reader& data)
+{
+    Params params;
+
+    bool ok = true;
+    ok &= data.Read("id",                   &mId);
+    ok &= data.Read("name",                 &mName);
+    ok &= data.Read("grid_width",           &params.grid_width);
+    ok &= data.Read("grid_height",          &params.grid_height);
+    ok &= data.Read("solver_iterations",    &params.solver_iterations);
+    ok &= data.Read("time_step",            &params.time_step);
+    ok &= data.Read("viscosity",            &params.viscosity);
+    ok &= data.Read("diffusion",            &params.diffusion);
+    ok &= data.Read("density_dissipation",  &params.density_dissipation);
+    ok &= data.Read("velocity_dissipation", &params.velocity_dissipation);
+    ok &= data.Read("buoyancy",             &params.buoyancy);
+
+    SetParams(params);
+    return ok;
+}
+
+std::unique_ptr<DrawableClass> FluidSimulationClass::Clone() const
+{
+    auto ret = std::make_unique<FluidSimulationClass>(*this);
+    ret->mId = base::RandomString(10);
+    return ret;
+}
+std::unique_ptr<DrawableClass> FluidSimulationClass::Copy() const
+{
+    return std::make_unique<FluidSimulationClass>(*this);
+}
+
+// static
+void FluidSimulationClass::InitGrid(const Params& params, Grid& grid)
+{
+    grid.width  = std::max(params.grid_width, 1u);
+    grid.height = std::max(params.grid_height, 1u);
+
+    const auto size = grid.GetSize();
+    for (auto* field : { &grid.density, &grid.velocity_x, &grid.velocity_y,
+                         &grid.prev_density, &grid.prev_velocity_x, &grid.prev_velocity_y,
+                         &grid.pressure, &grid.divergence, &grid.jacobi })
+    {
+        field->assign(size, 0.0f);
+    }
+}
+
+// static
+void FluidSimulationClass::StepSimulation(const Params& params, Grid& grid, float dt, base::ThreadPool* pool)
+{
+    ASSERT(grid.density.size() == grid.GetSize());
+
+    const auto stride = grid.GetStride();
+    const auto width  = grid.width;
+    const auto height = grid.height;
+    const auto size   = grid.GetSize();
+    const auto iterations = params.solver_iterations;
+    const auto h   = GetCellSize(grid);
+    const auto dt0 = dt / h;
+
+    // external forces. the dense areas rise, i.e. towards the top
+    // of the simulation which is the first row of the grid.
+    if (params.buoyancy != 0.0f)
+    {
+        const auto force = -dt * params.buoyancy;
+        float* v = grid.velocity_y.data();
+        const float* d = grid.density.data();
+        ForEachRow(pool, grid, [=](std::size_t row) {
+            const auto offset = row * stride;
+            for (unsigned i=1; i<=width; ++i)
+                v[offset + i] += force * d[offset + i];
+        });
+    }
+
+    // velocity step
+    if (params.viscosity > 0.0f)
+    {
+        const auto a = dt * params.viscosity / (h * h);
+        std::swap(grid.velocity_x, grid.prev_velocity_x);
+        std::swap(grid.velocity_y, grid.prev_velocity_y);
+        LinearSolve(Boundary::VelocityX, grid.velocity_x, grid.prev_velocity_x, a, 1.0f + 4.0f * a, iterations, grid, pool);
+        LinearSolve(Boundary::VelocityY, grid.velocity_y, grid.prev_velocity_y, a, 1.0f + 4.0f * a, iterations, grid, pool);
+    }
+    Project(grid, iterations, h, pool);
+
+    std::swap(grid.velocity_x, grid.prev_velocity_x);
+    std::swap(grid.velocity_y, grid.prev_velocity_y);
+    {
+        float* u = grid.velocity_x.data();
+        float* v = grid.velocity_y.data();
+        const float* u0 = grid.prev_velocity_x.data();
+        const float* v0 = grid.prev_velocity_y.data();
+        ForEachRow(pool, grid, [=](std::size_t row) {
+            AdvectRow(u, u0, u0, v0, dt0, width, height, row);
+            AdvectRow(v, v0, u0, v0, dt0, width, height, row);
+        });
+        SetBoundary(Boundary::VelocityX, u, width, height);
+        SetBoundary(Boundary::VelocityY, v, width, height);
+    }
+    Project(grid, iterations, h, pool);
+
+    if (params.velocity_dissipation > 0.0f)
+    {
+        const auto scale = 1.0f / (1.0f + dt * params.velocity_dissipation);
+        ScaleField(grid.velocity_x.data(), scale, size);
+        ScaleField(grid.velocity_y.data(), scale, size);
+    }
+
+    // density step
+    if (params.diffusion > 0.0f)
+    {
+        const auto a = dt * params.diffusion / (h * h);
+        std::swap(grid.density, grid.prev_density);
+        LinearSolve(Boundary::Scalar, grid.density, grid.prev_density, a, 1.0f + 4.0f * a, iterations, grid, pool);
+    }
+
+    std::swap(grid.density, grid.prev_density);
+    {
+        float* d = grid.density.data();
+        const float* d0 = grid.prev_density.data();
+        const float* u  = grid.velocity_x.data();
+        const float* v  = grid.velocity_y.data();
+        ForEachRow(pool, grid, [=](std::size_t row) {
+            AdvectRow(d, d0, u, v, dt0, width, height, row);
+        });
+        SetBoundary(Boundary::Scalar, d, width, height);
+    }
+
+    if (params.density_dissipation > 0.0f)
+    {
+        const auto scale = 1.0f / (1.0f + dt * params.density_dissipation);
+        ScaleField(grid.density.data(), scale, size);
+    }
+}
+
+// static
+base::ThreadPool* FluidSimulationClass::GetSolverThreadPool(const Grid& grid) noexcept
+{
+    if (grid.width * grid.height < MinParallelCells)
+        return nullptr;
+    return base::GetGlobalThreadPool();
+}
+
+// static
+void FluidSimulationClass::ConvertDensity(const Grid& grid, std::vector<std::uint8_t>& texels)
+{
+    texels.resize(std::size_t(grid.width) * std::size_t(grid.height));
+
+    for (unsigned row=0; row<grid.height; ++row)
+    {
+        const float* __restrict src = grid.density.data() + grid.GetIndex(1, row + 1);
+        std::uint8_t* __restrict dst = texels.data() + std::size_t(row) * grid.width;
+        for (unsigned i=0; i<grid.width; ++i)
+        {
+            const float value = std::clamp(src[i], 0.0f, 1.0f);
+            dst[i] = static_cast<std::uint8_t>(value * 255.0f + 0.5f);
+        }
+    }
+}
+
+bool FluidSimulationInstance::ApplyDynamicState(const Environment& env, Device& device, ProgramState& program, RasterState& state) const
+{
+    return mClass->ApplyDynamicState(env, device, mState, mId, program);
+}
+
+ShaderSource FluidSimulationInstance::GetShader(const Environment& env, const Device& device) const
+{
+    ASSERT(env.mesh_type == MeshType::NormalRenderMesh);
+    ASSERT(env.use_instancing == false);
+
+    return Drawable::CreateShader(env, device, Shader::Simple2D);
+}
+
+std::string FluidSimulationInstance::GetShaderId(const Environment& env) const
+{
+    return Drawable::GetShaderId(env, Shader::Simple2D);
+}
+
+std::string FluidSimulationInstance::GetShaderName(const Environment& env) const
+{
+    return Drawable::GetShaderName(env, Shader::Simple2D);
+}
+
+std::string FluidSimulationInstance::GetGeometryId(const Environment& env) const
+{
+    return "FluidSimulation/" + mClass->GetId();
+}
+
+bool FluidSimulationInstance::Construct(const Environment& env, Device& device, Geometry::CreateArgs& create) const
+{
+    return mClass->Construct(env, create);
+}
+
+void FluidSimulationInstance::Update(const Environment& env, float dt)
+{
+    mClass->Update(env, mState, dt);
+}
+
+void FluidSimulationInstance::Restart(const Environment& env)
+{
+    mClass->Restart(mState);
+}
+
+void FluidSimulationInstance::Execute(const Environment& env, const Command& cmd)
+{
+    glm::vec2 position = {0.5f, 0.5f};
+    float radius = 0.05f;
+    ReadFloatArg(cmd, "x", &position.x);
+    ReadFloatArg(cmd, "y", &position.y);
+    ReadFloatArg(cmd, "radius", &radius);
+
+    if (cmd.name == "AddDensity")
+    {
+        float amount = 1.0f;
+        ReadFloatArg(cmd, "amount", &amount);
+        mClass->AddDensity(mState, position, amount, radius);
+    }
+    else if (cmd.name == "AddVelocity")
+    {
+        glm::vec2 velocity = {0.0f, 0.0f};
+        ReadFloatArg(cmd, "vx", &velocity.x);
+        ReadFloatArg(cmd, "vy", &velocity.y);
+        mClass->AddVelocity(mState, position, velocity, radius);
+    }
+    else WARN("No such fluid simulation command. [cmd='%1']", cmd.name);
+}
+
+Drawable::DrawPrimitive FluidSimulationInstance::GetDrawPrimitive() const
+{
+    return DrawPrimitive::Triangles;
+}
+
+SpatialMode FluidSimulationInstance::GetSpatialMode() const
+{
+    return SpatialMode::Flat2D;
+}
+
+Drawable::Type FluidSimulationInstance::GetType() const
+{
+    return Type::FluidSimulation;
+}
+
+} // namespace
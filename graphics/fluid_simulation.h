@@ -0,0 +1,245 @@
+// Copyright (C) 2020-2025 Sami Väisänen
+// Copyright (C) 2020-2025 Ensisoft http://www.ensisoft.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "config.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+#include "base/utility.h"
+#include "graphics/drawable.h"
+
+namespace base {
+    class ThreadPool;
+} // namespace
+
+namespace gfx
+{
+    class Texture;
+
+    // FluidSimulationClass defines a type of 2D fluid (smoke) simulation
+    // that runs on a regular grid on the CPU. The solver is the "stable
+    // fluids" solver, i.e. the velocity and density fields are moved with
+    // semi-Lagrangian advection and the velocity field is kept mass
+    // conserving with a pressure projection step. The linear systems are
+    // solved with Jacobi iterations so that every grid row can be solved
+    // independently of the others which makes the solver easy to run in
+    // parallel and lets the compiler vectorize the row loops.
+    //
+    // The simulation is drawn as a quad in the unit square (0,0) - (1,-1)
+    // just like the rectangle shape. The density field of every instance
+    // is uploaded into an alpha mask texture of its own and the drawable
+    // binds the texture to the "kFluidDensityMap" sampler. Use a custom
+    // material whose shader samples the density from the alpha channel
+    // of kFluidDensityMap.
+    class FluidSimulationClass : public DrawableClass
+    {
+    public:
+        struct Params {
+            // The number of simulation grid cells horizontally.
+            unsigned grid_width  = 64;
+            // The number of simulation grid cells vertically.
+            unsigned grid_height = 64;
+            // The number of Jacobi iterations for solving the diffusion
+            // and pressure. More iterations give a more accurate result
+            // but cost linearly more.
+            unsigned solver_iterations = 20;
+            // The fixed simulation time step in seconds. The simulation
+            // is advanced in steps of this size.
+            float time_step = 1.0f / 60.0f;
+            // The rate at which the velocity diffuses, i.e. the kinematic
+            // viscosity of the fluid. 0.0 to disable.
+            float viscosity = 0.0f;
+            // The rate at which the density diffuses. 0.0 to disable.
+            float diffusion = 0.0f;
+            // The fraction of the density that fades away per second.
+            float density_dissipation = 0.0f;
+            // The fraction of the velocity that fades away per second.
+            float velocity_dissipation = 0.0f;
+            // The upwards force per unit of density. Makes the dense
+            // regions rise like hot smoke does.
+            float buoyancy = 0.0f;
+        };
+
+        // The simulation grid state. Every field is stored in a separate
+        // row major array of (width + 2) * (height + 2) floats, i.e. the
+        // simulation cells are surrounded by a single cell boundary.
+        // Rows go from the top of the simulation to the bottom.
+        struct Grid {
+            unsigned width  = 0;
+            unsigned height = 0;
+            std::vector<float> density;
+            std::vector<float> velocity_x;
+            std::vector<float> velocity_y;
+            // the solver scratch fields.
+            std::vector<float> prev_density;
+            std::vector<float> prev_velocity_x;
+            std::vector<float> prev_velocity_y;
+            std::vector<float> pressure;
+            std::vector<float> divergence;
+            std::vector<float> jacobi;
+
+            inline std::size_t GetStride() const noexcept
+            { return width + 2; }
+            inline std::size_t GetIndex(unsigned x, unsigned y) const noexcept
+            { return y * GetStride() + x; }
+            inline std::size_t GetSize() const noexcept
+            { return GetStride() * (height + 2); }
+        };
+
+        struct InstanceState {
+            Grid grid;
+            // The simulation time that has not yet been stepped.
+            float time_accum = 0.0f;
+            // The running version of the grid content. Changes every
+            // time the simulation state changes.
+            std::size_t version = 0;
+        };
+
+        explicit FluidSimulationClass(const Params& init, std::string id = base::RandomString(10), std::string name = "") noexcept
+          : mId(std::move(id))
+          , mName(std::move(name))
+          , mParams(init)
+        {}
+        explicit FluidSimulationClass(std::string id = base::RandomString(10), std::string name = "") noexcept
+          : mId(std::move(id))
+          , mName(std::move(name))
+        {}
+
+        bool ApplyDynamicState(const Environment& env, Device& device, const InstanceState& state,
+                               const std::string& instance_id, ProgramState& program) const;
+        bool Construct(const Environment& env, Geometry::CreateArgs& create) const;
+        void Update(const Environment& env, InstanceState& state, float dt) const;
+        void Restart(InstanceState& state) const;
+        // Upload the instance density field into the instance's density
+        // texture unless the texture already has the current content.
+        // The texture is created if it doesn't exist yet (or has been
+        // garbage collected).
+        Texture* UploadDensity(Device& device, const InstanceState& state, const std::string& instance_id) const;
+
+        // Splat density into the simulation around the given normalized
+        // simulation position. The radius is relative to the simulation width.
+        void AddDensity(InstanceState& state, const glm::vec2& position, float amount, float radius) const;
+        // Splat velocity into the simulation around the given normalized
+        // simulation position. The velocity is in simulation widths per second.
+        void AddVelocity(InstanceState& state, const glm::vec2& position, const glm::vec2& velocity, float radius) const;
+
+        // Get the ID of the GPU texture that contains the simulation
+        // density of the simulation instance identified by instance_id.
+        std::string GetDensityTextureId(const std::string& instance_id) const;
+
+        // Get the params.
+        inline const Params& GetParams() const noexcept
+        { return mParams; }
+        inline Params& GetParams() noexcept
+        { return mParams; }
+        // Set the params.
+        inline void SetParams(const Params& params) noexcept
+        { mParams = params; }
+
+        void SetName(const std::string& name) override;
+
+        Type GetType() const override;
+        SpatialMode GetSpatialMode() const override;
+
+        std::string GetId() const override;
+        std::string GetName() const override;
+        std::size_t GetHash() const override;
+        void IntoJson(data::Writer& data) const override;
+        bool FromJson(const data::Reader& data) override;
+        std::unique_ptr<DrawableClass> Clone() const override;
+        std::unique_ptr<DrawableClass> Copy() const override;
+
+        // Resize the grid according to the params and clear all the fields.
+        static void InitGrid(const Params& params, Grid& grid);
+        // Advance the simulation by dt seconds in a single step. If the
+        // thread pool is not null the grid rows are solved in parallel.
+        static void StepSimulation(const Params& params, Grid& grid, float dt, base::ThreadPool* pool);
+        // Get the thread pool to use for stepping the given grid or nullptr
+        // if the grid is so small that solving it on a single thread is faster.
+        static base::ThreadPool* GetSolverThreadPool(const Grid& grid) noexcept;
+        // Convert the density field into 8bit texels clamped to [0, 1] range.
+        static void ConvertDensity(const Grid& grid, std::vector<std::uint8_t>& texels);
+    private:
+        std::string mId;
+        std::string mName;
+        Params mParams;
+    };
+
+    // FluidSimulationInstance is an instance of some fluid simulation
+    // type and holds the simulation state.
+    // The simulation can be driven with drawable commands:
+    //  "AddDensity"  with args x, y, amount and radius.
+    //  "AddVelocity" with args x, y, vx, vy and radius.
+    // The x and y are normalized simulation coordinates with 0,0 being
+    // the top left corner of the simulation and 1,1 the bottom right.
+    class FluidSimulationInstance : public Drawable
+    {
+    public:
+        using Params = FluidSimulationClass::Params;
+
+        explicit FluidSimulationInstance(std::shared_ptr<const FluidSimulationClass> klass, std::string id = base::RandomString(10))
+          : mClass(std::move(klass))
+          , mId(std::move(id))
+        { mClass->Restart(mState); }
+        explicit FluidSimulationInstance(const FluidSimulationClass& klass, std::string id = base::RandomString(10))
+          : mClass(std::make_shared<FluidSimulationClass>(klass))
+          , mId(std::move(id))
+        { mClass->Restart(mState); }
+        explicit FluidSimulationInstance(const Params& params, std::string id = base::RandomString(10))
+          : mClass(std::make_shared<FluidSimulationClass>(params))
+          , mId(std::move(id))
+        { mClass->Restart(mState); }
+        bool ApplyDynamicState(const Environment& env, Device& device, ProgramState& program, RasterState& state) const override;
+        ShaderSource GetShader(const Environment& env, const Device& device) const override;
+        std::string GetShaderId(const Environment& env) const override;
+        std::string GetShaderName(const Environment& env) const override;
+        std::string GetGeometryId(const Environment& env) const override;
+        bool Construct(const Environment& env, Device& device, Geometry::CreateArgs& create) const override;
+        void Update(const Environment& env, float dt) override;
+        void Restart(const Environment& env) override;
+        void Execute(const Environment& env, const Command& cmd) override;
+
+        DrawPrimitive GetDrawPrimitive() const override;
+        SpatialMode GetSpatialMode() const override;
+        Type GetType() const override;
+
+        const DrawableClass* GetClass() const override
+        { return mClass.get(); }
+
+        inline void AddDensity(const glm::vec2& position, float amount, float radius)
+        { mClass->AddDensity(mState, position, amount, radius); }
+        inline void AddVelocity(const glm::vec2& position, const glm::vec2& velocity, float radius)
+        { mClass->AddVelocity(mState, position, velocity, radius); }
+
+        inline const FluidSimulationClass::Grid& GetGrid() const noexcept
+        { return mState.grid; }
+        inline const Params& GetParams() const noexcept
+        { return mClass->GetParams(); }
+        inline std::string GetDensityTextureId() const
+        { return mClass->GetDensityTextureId(mId); }
+    private:
+        std::shared_ptr<const FluidSimulationClass> mClass;
+        std::string mId;
+        FluidSimulationClass::InstanceState mState;
+    };
+
+} // namespace
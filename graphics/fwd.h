@@ -47,6 +47,7 @@ namespace gfx
     class Texture;
     class Geometry;
     class GenericShaderProgram;
+    class SpriteBatch;
 
 } // namespace
 
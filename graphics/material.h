@@ -55,6 +55,9 @@ namespace gfx
             DrawPrimitive draw_primitive = DrawPrimitive::Triangles;
             DrawCategory draw_category = DrawCategory::Basic;
             RenderPass render_pass = RenderPass::ColorPass;
+            // The approximate on-screen area of the draw in pixels.
+            // Used to prioritize texture streaming.
+            float texture_priority = 0.0f;
         };
         struct RasterState {
             using Blending = Device::RasterState::BlendOp;
@@ -114,6 +117,10 @@ namespace gfx
         virtual bool Execute(const Environment& env, const Command& command) { return true; }
 
         virtual bool GetValue(const std::string& key, RuntimeValue* value) const { return false; }
+        // Check whether this material applies exactly the same dynamic state
+        // as the other material so that draws using either material can be
+        // combined into a single draw. The default is to say no.
+        virtual bool HasSameState(const Material& other) const { return false; }
         // Get the material class instance if any. Warning, this may be null for
         // material objects that aren't based on any material clas!
         virtual const MaterialClass* GetClass() const  { return nullptr; }
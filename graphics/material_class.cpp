@@ -1331,10 +1331,11 @@ bool MaterialClass::ApplySpriteDynamicState(const State& state, Device& device,
     }
 
     TextureMap::BindingState ts;
-    ts.dynamic_content = state.editing_mode || !IsStatic();
-    ts.current_time    = state.material_time;
-    ts.group_tag       = mClassId;
-    ts.blend_frames    = BlendFrames();
+    ts.dynamic_content  = state.editing_mode || !IsStatic();
+    ts.texture_priority = state.texture_priority;
+    ts.current_time     = state.material_time;
+    ts.group_tag        = mClassId;
+    ts.blend_frames     = BlendFrames();
 
     TextureMap::BoundState binds;
     if (!map->BindTextures(ts, device,  binds))
@@ -1421,9 +1422,10 @@ bool MaterialClass::ApplyTextureDynamicState(const State& state, Device& device,
     }
 
     TextureMap::BindingState ts;
-    ts.dynamic_content = state.editing_mode || !IsStatic();
-    ts.current_time    = 0.0;
-    ts.blend_frames    = BlendFrames();
+    ts.dynamic_content  = state.editing_mode || !IsStatic();
+    ts.texture_priority = state.texture_priority;
+    ts.current_time     = 0.0;
+    ts.blend_frames     = BlendFrames();
 
     TextureMap::BoundState binds;
     if (!map->BindTextures(ts, device, binds))
@@ -1497,9 +1499,10 @@ bool MaterialClass::ApplyTilemapDynamicState(const State& state, Device& device,
     }
 
     TextureMap::BindingState ts;
-    ts.dynamic_content = state.editing_mode || !IsStatic();
-    ts.current_time    = 0.0;
-    ts.blend_frames    = BlendFrames();
+    ts.dynamic_content  = state.editing_mode || !IsStatic();
+    ts.texture_priority = state.texture_priority;
+    ts.current_time     = 0.0;
+    ts.blend_frames     = BlendFrames();
 
     TextureMap::BoundState binds;
     if (!map->BindTextures(ts, device, binds))
@@ -1552,9 +1555,10 @@ bool MaterialClass::ApplyParticleDynamicState(const State& state, Device& device
     }
 
     TextureMap::BindingState ts;
-    ts.dynamic_content = state.editing_mode || !IsStatic();
-    ts.current_time    = 0.0;
-    ts.blend_frames    = BlendFrames();
+    ts.dynamic_content  = state.editing_mode || !IsStatic();
+    ts.texture_priority = state.texture_priority;
+    ts.current_time     = 0.0;
+    ts.blend_frames     = BlendFrames();
 
     TextureMap::BoundState binds;
     if (!texture_map->BindTextures(ts, device, binds))
@@ -1640,9 +1644,10 @@ bool MaterialClass::ApplyBasicLightDynamicState(const State& state, Device& devi
         map_flags |= static_cast<unsigned>(maps[i].type);
 
         TextureMap::BindingState ts;
-        ts.dynamic_content = state.editing_mode || !IsStatic();
-        ts.current_time    = state.material_time;
-        ts.blend_frames    = BlendFrames();
+        ts.dynamic_content  = state.editing_mode || !IsStatic();
+        ts.texture_priority = state.texture_priority;
+        ts.current_time     = state.material_time;
+        ts.blend_frames     = BlendFrames();
 
         TextureMap::BoundState binds;
         if (!texture_map->BindTextures(ts, device, binds))
@@ -1698,10 +1703,11 @@ bool MaterialClass::ApplyCustomDynamicState(const State& state, Device& device,
     for (const auto& map : mTextureMaps)
     {
         TextureMap::BindingState ts;
-        ts.dynamic_content = true; // todo: need static flag. for now use dynamic (which is slower) but always correct
-        ts.current_time    = state.material_time;
-        ts.group_tag       = mClassId;
-        ts.blend_frames    = BlendFrames();
+        ts.dynamic_content  = true; // todo: need static flag. for now use dynamic (which is slower) but always correct
+        ts.current_time     = state.material_time;
+        ts.texture_priority = state.texture_priority;
+        ts.group_tag        = mClassId;
+        ts.blend_frames     = BlendFrames();
 
         TextureMap::BoundState binds;
         if (!map->BindTextures(ts, device, binds))
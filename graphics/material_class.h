@@ -170,6 +170,9 @@ namespace gfx
             DrawCategory draw_category = DrawCategory::Basic;
             // The current material instance time.
             double material_time = 0.0f;
+            // The priority of the material's textures when streaming
+            // texture content. Typically, the on-screen size in pixels.
+            float texture_priority = 0.0f;
             // The uniform parameters set on the material instance (if any).
             // The instance uniforms will take precedence over the uniforms
             // set in the class whenever they're set.
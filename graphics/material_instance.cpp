@@ -16,6 +16,9 @@
 
 #include "config.h"
 
+#include <type_traits>
+#include <variant>
+
 #include "base/logging.h"
 #include "graphics/paint_log.h"
 #include "graphics/material_class.h"
@@ -23,6 +26,37 @@
 #include "graphics/texture_bitmap_buffer_source.h"
 #include "graphics/texture_texture_source.h"
 
+namespace {
+bool IsSameUniformValue(const gfx::Uniform& lhs, const gfx::Uniform& rhs)
+{
+    if (lhs.index() != rhs.index())
+        return false;
+
+    return std::visit([&rhs](const auto& value) {
+        using Type = std::decay_t<decltype(value)>;
+        const auto& other = std::get<Type>(rhs);
+        if constexpr (std::is_same_v<Type, gfx::Color4f>)
+            return value.Red()   == other.Red()   &&
+                   value.Green() == other.Green() &&
+                   value.Blue()  == other.Blue()  &&
+                   value.Alpha() == other.Alpha();
+        else return value == other;
+    }, lhs);
+}
+bool IsSameUniformMap(const gfx::UniformMap& lhs, const gfx::UniformMap& rhs)
+{
+    if (lhs.size() != rhs.size())
+        return false;
+    for (const auto& [name, value] : lhs)
+    {
+        const auto it = rhs.find(name);
+        if (it == rhs.end() || !IsSameUniformValue(value, it->second))
+            return false;
+    }
+    return true;
+}
+} // namespace
+
 namespace gfx
 {
 
@@ -54,6 +88,7 @@ bool MaterialInstance::ApplyDynamicState(const Environment& env, Device& device,
     state.draw_category  = env.draw_category;
     state.render_pass    = env.render_pass;
     state.material_time  = mRuntime;
+    state.texture_priority = env.texture_priority;
     state.uniforms       = &mUniforms;
     state.flags          = mFlags;;
 
@@ -248,6 +283,33 @@ bool MaterialInstance::GetValue(const std::string& key, RuntimeValue* value) con
     return false;
 }
 
+bool MaterialInstance::HasSameState(const Material& other) const
+{
+    if (&other == this)
+        return true;
+
+    const auto* instance = dynamic_cast<const MaterialInstance*>(&other);
+    if (instance == nullptr)
+        return false;
+
+    if (mClass != instance->mClass || mFlags != instance->mFlags)
+        return false;
+    if (mSpriteCycle.has_value() || instance->mSpriteCycle.has_value())
+        return false;
+    if (!IsSameUniformMap(mUniforms, instance->mUniforms))
+        return false;
+
+    // the runtime only matters when the material output changes
+    // over time, i.e. sprite animation or texture velocity.
+    const auto type = mClass->GetType();
+    if (type == MaterialClass::Type::Color || type == MaterialClass::Type::Gradient)
+        return true;
+    if (type == MaterialClass::Type::Texture && mClass->GetTextureVelocity() == glm::vec3(0.0f))
+        return true;
+
+    return mRuntime == instance->mRuntime;
+}
+
 ShaderSource MaterialInstance::GetShader(const Environment& env, const Device& device) const
 {
     MaterialClass::State state;
@@ -58,6 +58,7 @@ namespace gfx
         void Update(float dt) override;
         void SetRuntime(double runtime) override;
         bool GetValue(const std::string& key, RuntimeValue* value) const override;
+        bool HasSameState(const Material& other) const override;
 
         void SetUniform(const std::string& name, Uniform value) override
         { mUniforms[name] = std::move(value); }
@@ -58,7 +58,15 @@ namespace gfx
             // Texture flags allow resizing.
             AllowedToResize,
             // Texture flags allow packing/combining.
-            AllowedToPack
+            AllowedToPack,
+            // The texture data is sRGB encoded.
+            sRGB,
+            // The texture data should be pre-multiplied with alpha.
+            PremulAlpha,
+            // The texture should have the sprite edge detection effect applied.
+            EdgeEffect,
+            // The texture should have the blur effect applied.
+            BlurEffect
         };
         // Set the texture flags that impact how the texture can be packed
         virtual void SetTextureFlag(ObjectHandle instance, TextureFlags flag, bool on_off) = 0;
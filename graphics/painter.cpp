@@ -65,12 +65,15 @@ void Painter::Prime(DrawCommand& draw) const
     drawable_env.editing_mode   = mEditingMode;
     drawable_env.pixel_ratio    = mPixelRatio;
     drawable_env.use_instancing = draw.instanced_draw.has_value();
+    drawable_env.instancing_supported = IsInstancingSupported();
     drawable_env.view_matrix    = draw.view       ? draw.view       : &mViewMatrix;
     drawable_env.proj_matrix    = draw.projection ? draw.projection : &mProjMatrix;
     drawable_env.model_matrix   = draw.model      ? draw.model      : &Identity;
     draw.geometry_gpu_ptr = GetGpuGeometry(*draw.drawable, drawable_env);
     if (draw.instanced_draw.has_value())
         draw.instance_draw_ptr = GetGpuInstancedDraw(draw.instanced_draw.value(), *draw.drawable, drawable_env);
+    else if (draw.drawable->HasDrawableInstances(drawable_env))
+        draw.instance_draw_ptr = GetGpuDrawableInstances(*draw.drawable, drawable_env);
 }
 
 bool Painter::Draw(const DrawCommandList& list, const ShaderProgram& program, const RenderPassState& render_pass_state) const
@@ -90,6 +93,8 @@ bool Painter::Draw(const DrawCommandList& list, const ShaderProgram& program, co
 
     std::unordered_set<std::string> used_programs;
 
+    const auto instancing_supported = IsInstancingSupported();
+
     bool success = false;
 
     for (const auto& draw : list)
@@ -103,6 +108,7 @@ bool Painter::Draw(const DrawCommandList& list, const ShaderProgram& program, co
         drawable_env.pixel_ratio    = mPixelRatio;
         drawable_env.render_pass    = render_pass_state.render_pass;
         drawable_env.use_instancing = draw.instanced_draw.has_value();
+        drawable_env.instancing_supported = instancing_supported;
         drawable_env.view_matrix    = draw.view       ? draw.view       : &mViewMatrix;
         drawable_env.proj_matrix    = draw.projection ? draw.projection : &mProjMatrix;
         drawable_env.model_matrix   = draw.model      ? draw.model      : &Identity;
@@ -123,12 +129,28 @@ bool Painter::Draw(const DrawCommandList& list, const ShaderProgram& program, co
             if (instanced_draw == nullptr)
                 instanced_draw = GetGpuInstancedDraw(draw.instanced_draw.value(), *draw.drawable, drawable_env);
         }
+        else if (draw.drawable->HasDrawableInstances(drawable_env))
+        {
+            instanced_draw = draw.instance_draw_ptr;
+            if (instanced_draw == nullptr)
+                TRACE_CALL("GetGpuInstances", instanced_draw = GetGpuDrawableInstances(*draw.drawable, drawable_env));
+
+            // no instances, nothing to draw.
+            if (!instanced_draw)
+                continue;
+        }
 
         Material::Environment material_env;
         material_env.editing_mode   = mEditingMode;
         material_env.draw_primitive = draw.drawable->GetDrawPrimitive();
         material_env.draw_category  = draw.drawable->GetDrawCategory();
         material_env.render_pass    = render_pass_state.render_pass;
+        if (mDevice->GetTextureStreamer())
+        {
+            material_env.texture_priority = GetScreenArea(*drawable_env.proj_matrix,
+                                                          *drawable_env.view_matrix,
+                                                          *drawable_env.model_matrix);
+        }
         ProgramPtr gpu_program;
 
         TRACE_CALL("GetGpuProgram", gpu_program = GetProgram(program, *draw.drawable, *draw.material, drawable_env, material_env));
@@ -179,6 +201,8 @@ bool Painter::Draw(const DrawCommandList& list, const ShaderProgram& program, co
         // modify the depth testing state since this is per draw right now.
         mDevice->ModifyState(draw.state.depth_test, Device::StateName::DepthTest);
 
+        UpdateStats(*gpu_program, *geometry, gpu_program_state);
+
         TRACE_CALL("DeviceDraw", mDevice->Draw(*gpu_program,
                       gpu_program_state,
                       GeometryDrawCommand(*geometry,
@@ -667,6 +691,54 @@ InstancedDrawPtr Painter::GetGpuInstancedDraw(const InstancedDraw& draw, const g
     return nullptr;
 }
 
+InstancedDrawPtr Painter::GetGpuDrawableInstances(const gfx::Drawable& drawable, const Drawable::Environment& env) const
+{
+    // The drawable instance data is like STREAM geometry, generated
+    // on the CPU on the fly by computation (see particles) and
+    // re-uploaded on every draw.
+    gfx::InstancedDraw::CreateArgs args;
+    if (!drawable.ConstructInstances(env, *mDevice, args))
+        return nullptr;
+
+    args.usage = BufferUsage::Stream;
+    return mDevice->CreateInstancedDraw(drawable.GetGeometryId(env) + "-instances", std::move(args));
+}
+
+bool Painter::IsInstancingSupported() const
+{
+    Device::DeviceCaps caps;
+    mDevice->GetDeviceCaps(&caps);
+    return caps.instanced_rendering;
+}
+
+void Painter::UpdateStats(const Program& program, const Geometry& geometry, const ProgramState& state) const
+{
+    ++mStats.draw_calls;
+
+    if (mLastProgram != &program)
+        ++mStats.program_switches;
+    if (mLastGeometry != &geometry)
+        ++mStats.buffer_switches;
+
+    // the texture bindings are per texture unit, so count each unit
+    // that needs a texture different from what the previous draw had.
+    for (size_t i=0; i<state.GetSamplerCount(); ++i)
+    {
+        const auto& sampler = state.GetSamplerSetting(i);
+        if (sampler.texture == nullptr)
+            continue;
+        if (sampler.unit >= mLastTextures.size())
+            mLastTextures.resize(sampler.unit + 1, nullptr);
+        if (mLastTextures[sampler.unit] == sampler.texture)
+            continue;
+
+        mLastTextures[sampler.unit] = sampler.texture;
+        ++mStats.texture_switches;
+    }
+    mLastProgram  = &program;
+    mLastGeometry = &geometry;
+}
+
 IRect Painter::MapToDevice(const IRect& rect) const noexcept
 {
     if (rect.IsEmpty())
@@ -681,4 +753,23 @@ IRect Painter::MapToDevice(const IRect& rect) const noexcept
     return IRect(x, y, rect.GetWidth(), rect.GetHeight());
 }
 
+float Painter::GetScreenArea(const glm::mat4& proj, const glm::mat4& view, const glm::mat4& model) const
+{
+    // approximate the on-screen area of the draw by projecting the
+    // model's unit axes onto the viewport. The perspective divide
+    // takes care of making distant objects smaller.
+    const auto& mvp = proj * view * model;
+    const auto& origin = mvp * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    const auto& x_axis = mvp * glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+    const auto& y_axis = mvp * glm::vec4(0.0f, 1.0f, 0.0f, 1.0f);
+    if (origin.w <= 0.0f || x_axis.w <= 0.0f || y_axis.w <= 0.0f)
+        return 0.0f;
+
+    const glm::vec2 half_viewport = glm::vec2(mViewport.GetWidth(), mViewport.GetHeight()) * 0.5f;
+    const auto& o = glm::vec2(origin) / origin.w * half_viewport;
+    const auto& x = glm::vec2(x_axis) / x_axis.w * half_viewport;
+    const auto& y = glm::vec2(y_axis) / y_axis.w * half_viewport;
+    return glm::length(x - o) * glm::length(y - o);
+}
+
 } // namespace
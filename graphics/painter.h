@@ -145,6 +145,10 @@ namespace gfx
 
         auto HasScissor() const noexcept
         { return !mScissor.IsEmpty(); }
+        const auto& GetStats() const noexcept
+        { return mStats; }
+        void ResetStats() noexcept
+        { mStats = DrawStats {}; }
 
         // Clear the current render target color buffer with the given clear color.
         void ClearColor(const Color4f& color) const;
@@ -196,6 +200,17 @@ namespace gfx
 
         using InstancedDraw = Drawable::InstancedDraw;
 
+        // Statistics about the draws done through the painter. The switch
+        // counts are the number of times a draw needed a different GPU program,
+        // texture or geometry buffer than the previous draw. The counts are
+        // accumulated until ResetStats is called.
+        struct DrawStats {
+            unsigned draw_calls       = 0;
+            unsigned program_switches = 0;
+            unsigned texture_switches = 0;
+            unsigned buffer_switches  = 0;
+        };
+
         // State aggregate for the device state for depth testing
         // stencil testing etc.
         struct DrawCommandState {
@@ -332,6 +347,10 @@ namespace gfx
         GeometryPtr GetGpuGeometry(const Drawable& drawable, const Drawable::Environment& env) const;
         InstancedDrawPtr GetGpuInstancedDraw(const InstancedDraw& inst,
                 const Drawable& drawable, const Drawable::Environment& env) const;
+        InstancedDrawPtr GetGpuDrawableInstances(const Drawable& drawable, const Drawable::Environment& env) const;
+        bool IsInstancingSupported() const;
+        void UpdateStats(const Program& program, const Geometry& geometry, const ProgramState& state) const;
+        float GetScreenArea(const glm::mat4& proj, const glm::mat4& view, const glm::mat4& model) const;
 
     private:
         std::shared_ptr<Device> mDeviceInst;
@@ -347,6 +366,12 @@ namespace gfx
     private:
         bool mEditingMode = false;
         bool mDebugMode= false;
+    private:
+        // the previous draw's GPU objects for computing the stats.
+        mutable const Program* mLastProgram = nullptr;
+        mutable const Geometry* mLastGeometry = nullptr;
+        mutable std::vector<const Texture*> mLastTextures;
+        mutable DrawStats mStats;
     };
 
 } // namespace
@@ -20,10 +20,13 @@
 #  include <glm/glm.hpp>
 #include "warnpop.h"
 
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+
 #include "base/assert.h"
 #include "base/math.h"
 #include "base/hash.h"
-#include "base/random.h"
 #include "base/threadpool.h"
 #include "data/writer.h"
 #include "data/reader.h"
@@ -73,12 +76,181 @@ namespace  {
         std::optional<glm::mat4> world_matrix;
     };
 
-    std::function<float (float min, float max)> random_function;
-    auto GetRandomGenerator()
+#if defined(MATH_FORCE_DETERMINISTIC_RANDOM)
+    std::uint64_t random_seed = 0xdeadbeef;
+#else
+    std::uint64_t random_seed = std::time(nullptr);
+#endif
+    std::atomic<std::uint64_t> random_sequence = 0;
+
+    // The particle update kernels. These are written as simple loops
+    // over the particle attribute arrays without any branching on the
+    // per particle data so that the compiler can vectorize them.
+    // Instead of removing particles while updating the kernels only
+    // flag particles to be killed and the dead particles are then
+    // removed in a separate pass.
+
+    void AgeParticles(float* __restrict time, const float* __restrict time_scale,
+                      std::uint8_t* __restrict kill, float max_lifetime, float dt, size_t count) noexcept
+    {
+        for (size_t i=0; i<count; ++i)
+        {
+            time[i] += dt;
+            kill[i] |= time[i] > time_scale[i] * max_lifetime;
+        }
+    }
+    void AgeParticles(float* __restrict time, float dt, size_t count) noexcept
+    {
+        for (size_t i=0; i<count; ++i)
+            time[i] += dt;
+    }
+
+    struct IntegrateArgs {
+        float* __restrict position_x;
+        float* __restrict position_y;
+        float* __restrict direction_x;
+        float* __restrict direction_y;
+        float* __restrict pointsize;
+        float* __restrict alpha;
+        float* __restrict distance;
+        const float* __restrict time_scale;
+        std::uint8_t* __restrict kill;
+        // the gravity is zero for linear motion.
+        glm::vec2 gravity;
+        float size_wrt_time;
+        float size_wrt_dist;
+        float alpha_wrt_time;
+        float alpha_wrt_dist;
+        float dt;
+        size_t count;
+    };
+
+    // Integrate the particle position, the change in velocity due to gravity
+    // and the change in particle size and alpha wrt time and travelled distance.
+    void IntegrateParticles(const IntegrateArgs& args) noexcept
+    {
+        float* __restrict position_x  = args.position_x;
+        float* __restrict position_y  = args.position_y;
+        float* __restrict direction_x = args.direction_x;
+        float* __restrict direction_y = args.direction_y;
+        float* __restrict pointsize   = args.pointsize;
+        float* __restrict alpha       = args.alpha;
+        float* __restrict distance    = args.distance;
+        const float* __restrict time_scale = args.time_scale;
+        std::uint8_t* __restrict kill = args.kill;
+
+        const float dt = args.dt;
+        const float gx = args.gravity.x * dt;
+        const float gy = args.gravity.y * dt;
+        const float size_dt  = args.size_wrt_time * dt;
+        const float size_dd  = args.size_wrt_dist;
+        const float alpha_dt = args.alpha_wrt_time * dt;
+        const float alpha_dd = args.alpha_wrt_dist * dt;
+
+        for (size_t i=0; i<args.count; ++i)
+        {
+            const float dx = direction_x[i] * dt;
+            const float dy = direction_y[i] * dt;
+            const float dd = std::sqrt(dx*dx + dy*dy);
+            position_x[i] += dx;
+            position_y[i] += dy;
+            direction_x[i] += gx;
+            direction_y[i] += gy;
+
+            pointsize[i] += size_dt * time_scale[i];
+            pointsize[i] += dd * size_dd;
+
+            alpha[i] += alpha_dt * time_scale[i];
+            alpha[i] += alpha_dd;
+
+            kill[i] |= (pointsize[i] <= 0.0f) | (alpha[i] <= 0.0f);
+
+            alpha[i] = std::min(std::max(alpha[i], 0.0f), 1.0f);
+            distance[i] += dd;
+        }
+    }
+
+    void WrapParticles(float* __restrict position, float max, size_t count) noexcept
     {
-        if (!random_function)
-            random_function = base::rand<float>;
-        return random_function;
+        for (size_t i=0; i<count; ++i)
+        {
+            const float p = position[i];
+            position[i] = p > max ? 0.0f : (p < 0.0f ? max : p);
+        }
+    }
+    void ClampParticles(float* __restrict position, float max, size_t count) noexcept
+    {
+        for (size_t i=0; i<count; ++i)
+            position[i] = std::min(std::max(position[i], 0.0f), max);
+    }
+    void KillParticlesOutside(const float* __restrict position, std::uint8_t* __restrict kill, float max, size_t count) noexcept
+    {
+        for (size_t i=0; i<count; ++i)
+            kill[i] |= (position[i] < 0.0f) | (position[i] > max);
+    }
+
+    // Reflect the particles at the boundary. Only the particles at the
+    // boundary need any work so this is not worth vectorizing.
+    void ReflectParticles(gfx::ParticleEngineClass::ParticleBuffer& particles, float max_x, float max_y) noexcept
+    {
+        for (size_t i=0; i<particles.GetCount(); ++i)
+        {
+            auto& x = particles.position_x[i];
+            auto& y = particles.position_y[i];
+            glm::vec2 n;
+            if (x <= 0.0f)
+                n = glm::vec2(1.0f, 0.0f);
+            else if (x >= max_x)
+                n = glm::vec2(-1.0f, 0.0f);
+            else if (y <= 0.0f)
+                n = glm::vec2(0, 1.0f);
+            else if (y >= max_y)
+                n = glm::vec2(0, -1.0f);
+            else continue;
+            // compute new direction vector given the normal vector of the boundary
+            // and then bake the velocity in the new direction
+            const glm::vec2 direction(particles.direction_x[i], particles.direction_y[i]);
+            const auto& d = glm::normalize(direction);
+            const float v = glm::length(direction);
+            const auto& r = (d - 2 * glm::dot(d, n) * n) * v;
+            particles.direction_x[i] = r.x;
+            particles.direction_y[i] = r.y;
+
+            // clamp the position in order to eliminate the situation
+            // where the object has moved beyond the boundaries of the simulation
+            // and is stuck there alternating it's direction vector
+            x = math::clamp(0.0f, max_x, x);
+            y = math::clamp(0.0f, max_y, y);
+        }
+    }
+
+    // Remove the killed particles. The order of the surviving particles
+    // is the same as when killing the particles one by one by moving the
+    // last particle in place of the dead one.
+    void RemoveDeadParticles(gfx::ParticleEngineClass::ParticleBuffer& particles, std::vector<std::uint8_t>& kill) noexcept
+    {
+        size_t count = particles.GetCount();
+        for (size_t i=0; i<count;)
+        {
+            if (!kill[i])
+            {
+                ++i;
+                continue;
+            }
+            const auto last = count - 1;
+            kill[i] = kill[last];
+            particles.KillParticle(i);
+            --count;
+        }
+    }
+
+    // Get the thread pool for running the particle engine tasks on
+    // or nullptr if the tasks should be executed immediately.
+    base::ThreadPool* GetTaskThreadPool(const gfx::ParticleEngineClass::InstanceState& state) noexcept
+    {
+        if (state.execution_mode == gfx::ParticleEngineClass::ExecutionMode::Immediate)
+            return nullptr;
+        return base::GetGlobalThreadPool();
     }
 
 } // namespace
@@ -86,11 +258,202 @@ namespace  {
 namespace gfx
 {
 
+namespace {
+#pragma pack(push, 1)
+// Per particle vertex data. This is the vertex data when drawing
+// points and lines and the per instance data when drawing instanced quads.
+struct ParticleVertex {
+    Vec2 aPosition;
+    Vec2 aDirection;
+    Vec4 aData;
+};
+// Quad corner vertex for expanding the particle instances into quads.
+struct ParticleCornerVertex {
+    Vec2 aCorner;
+};
+// Quad vertex for drawing quads without instancing. The particle
+// data is repeated for every vertex of the quad.
+struct ParticleQuadVertex {
+    Vec2 aCorner;
+    Vec2 aPosition;
+    Vec2 aDirection;
+    Vec4 aData;
+};
+#pragma pack(pop)
+
+using DataType = VertexLayout::Attribute::DataType;
+
+const VertexLayout& GetParticleVertexLayout()
+{
+    static const VertexLayout layout(sizeof(ParticleVertex), {
+        {"aPosition",  0, 2, 0, offsetof(ParticleVertex, aPosition),  DataType::Float},
+        {"aDirection", 0, 2, 0, offsetof(ParticleVertex, aDirection), DataType::Float},
+        {"aData",      0, 4, 0, offsetof(ParticleVertex, aData),      DataType::Float}
+    });
+    return layout;
+}
+const InstanceDataLayout& GetParticleInstanceLayout()
+{
+    static const InstanceDataLayout layout(sizeof(ParticleVertex), {
+        {"aPosition",  0, 2, 1, offsetof(ParticleVertex, aPosition),  DataType::Float},
+        {"aDirection", 0, 2, 1, offsetof(ParticleVertex, aDirection), DataType::Float},
+        {"aData",      0, 4, 1, offsetof(ParticleVertex, aData),      DataType::Float}
+    });
+    return layout;
+}
+const VertexLayout& GetParticleCornerLayout()
+{
+    static const VertexLayout layout(sizeof(ParticleCornerVertex), {
+        {"aCorner", 0, 2, 0, offsetof(ParticleCornerVertex, aCorner), DataType::Float}
+    });
+    return layout;
+}
+const VertexLayout& GetParticleQuadLayout()
+{
+    static const VertexLayout layout(sizeof(ParticleQuadVertex), {
+        {"aCorner",    0, 2, 0, offsetof(ParticleQuadVertex, aCorner),    DataType::Float},
+        {"aPosition",  0, 2, 0, offsetof(ParticleQuadVertex, aPosition),  DataType::Float},
+        {"aDirection", 0, 2, 0, offsetof(ParticleQuadVertex, aDirection), DataType::Float},
+        {"aData",      0, 4, 0, offsetof(ParticleQuadVertex, aData),      DataType::Float}
+    });
+    return layout;
+}
+
+static_assert(std::is_trivially_copyable<ParticleVertex>::value &&
+              std::is_trivially_copy_assignable<ParticleVertex>::value &&
+              std::is_standard_layout<ParticleVertex>::value, "Particle vertex is not supported.");
+static_assert(sizeof(ParticleVertex) == 32);
+
+// The quad corners for two triangles. The corners map to the
+// texture coordinates the same way as gl_PointCoord maps to
+// the rasterized point.
+constexpr ParticleCornerVertex QuadCorners[6] = {
+    {{-0.5f, -0.5f}}, {{-0.5f,  0.5f}}, {{ 0.5f,  0.5f}},
+    {{-0.5f, -0.5f}}, {{ 0.5f,  0.5f}}, {{ 0.5f, -0.5f}}
+};
+
+// Map the particle in the particle buffer to the particle vertex.
+// The size scaler maps the particle size to the size used in the
+// shader, i.e. pixels for points and world units for quads.
+struct ParticleVertexArgs {
+    float inv_max_xpos = 1.0f;
+    float inv_max_ypos = 1.0f;
+    float inv_max_lifetime = 1.0f;
+    float size_scaler = 1.0f;
+};
+
+inline ParticleVertex MakeParticleVertex(const ParticleEngineClass::ParticleBuffer& particles,
+                                         size_t i, const ParticleVertexArgs& args) noexcept
+{
+    ParticleVertex vertex;
+    // When using local coordinate space the max x/y should
+    // be the extents of the simulation in which case the
+    // particle x,y become normalized on the [0.0f, 1.0f] range.
+    // when using global coordinate space max x/y should be 1.0f
+    // and particle coordinates are left in the global space
+    vertex.aPosition.x = particles.position_x[i] * args.inv_max_xpos;
+    vertex.aPosition.y = particles.position_y[i] * args.inv_max_ypos;
+    vertex.aDirection.x = particles.direction_x[i];
+    vertex.aDirection.y = particles.direction_y[i];
+    // copy the per particle data into the data vector for the fragment shader.
+    vertex.aData.x = std::max(particles.pointsize[i], 0.0f) * args.size_scaler;
+    // abusing texcoord here to provide per particle random value.
+    // we can use this to simulate particle rotation for example
+    // (if the material supports it)
+    vertex.aData.y = particles.randomizer[i];
+    // Use the particle data to pass the per particle alpha.
+    vertex.aData.z = particles.alpha[i];
+    // use the particle data to pass the per particle time.
+    vertex.aData.w = particles.time[i] / particles.time_scale[i] * args.inv_max_lifetime;
+    return vertex;
+}
+
+} // namespace
+
+void ParticleEngineClass::ParticleBuffer::Resize(size_t count)
+{
+    position_x.resize(count);
+    position_y.resize(count);
+    direction_x.resize(count);
+    direction_y.resize(count);
+    pointsize.resize(count);
+    time.resize(count);
+    time_scale.resize(count);
+    distance.resize(count);
+    randomizer.resize(count);
+    alpha.resize(count);
+}
+
+void ParticleEngineClass::ParticleBuffer::Clear() noexcept
+{
+    position_x.clear();
+    position_y.clear();
+    direction_x.clear();
+    direction_y.clear();
+    pointsize.clear();
+    time.clear();
+    time_scale.clear();
+    distance.clear();
+    randomizer.clear();
+    alpha.clear();
+}
+
+void ParticleEngineClass::ParticleBuffer::KillParticle(size_t index) noexcept
+{
+    auto Kill = [index](std::vector<float>& values) {
+        values[index] = values.back();
+        values.pop_back();
+    };
+    Kill(position_x);
+    Kill(position_y);
+    Kill(direction_x);
+    Kill(direction_y);
+    Kill(pointsize);
+    Kill(time);
+    Kill(time_scale);
+    Kill(distance);
+    Kill(randomizer);
+    Kill(alpha);
+}
+
+ParticleEngineClass::Particle ParticleEngineClass::ParticleBuffer::GetParticle(size_t index) const noexcept
+{
+    Particle p;
+    p.position   = glm::vec2(position_x[index], position_y[index]);
+    p.direction  = glm::vec2(direction_x[index], direction_y[index]);
+    p.pointsize  = pointsize[index];
+    p.time       = time[index];
+    p.time_scale = time_scale[index];
+    p.distance   = distance[index];
+    p.randomizer = randomizer[index];
+    p.alpha      = alpha[index];
+    return p;
+}
+
+void ParticleEngineClass::ParticleBuffer::SetParticle(size_t index, const Particle& particle) noexcept
+{
+    position_x[index]  = particle.position.x;
+    position_y[index]  = particle.position.y;
+    direction_x[index] = particle.direction.x;
+    direction_y[index] = particle.direction.y;
+    pointsize[index]   = particle.pointsize;
+    time[index]        = particle.time;
+    time_scale[index]  = particle.time_scale;
+    distance[index]    = particle.distance;
+    randomizer[index]  = particle.randomizer;
+    alpha[index]       = particle.alpha;
+}
+
+ParticleEngineClass::InstanceState::InstanceState() noexcept
+  : random(base::hash_combine(random_seed, random_sequence++))
+{}
+
 std::string ParticleEngineClass::GetShaderId(const Environment& env) const
 {
     std::size_t hash = 0;
     hash = base::hash_combine(hash, "particle-shader");
     hash = base::hash_combine(hash, env.use_instancing);
+    hash = base::hash_combine(hash, mParams->primitive == DrawPrimitive::Quad);
     return std::to_string(hash);
 }
 
@@ -109,11 +472,16 @@ ShaderSource ParticleEngineClass::GetShader(const Environment& env, const Device
     {
         source.AddPreprocessorDefinition("INSTANCED_DRAW");
     }
+    if (mParams->primitive == DrawPrimitive::Quad)
+    {
+        source.AddPreprocessorDefinition("PARTICLE_QUADS");
+    }
     source.LoadRawSource(glsl::vertex_base);
     source.LoadRawSource(glsl::vertex_2d_particle);
     source.AddShaderSourceUri("shaders/vertex_shader_base.glsl");
     source.AddShaderSourceUri("shaders/vertex_2d_particle_shader.glsl");
     source.AddDebugInfo("Instanced", env.use_instancing ? "YES" : "NO");
+    source.AddDebugInfo("Quads", mParams->primitive == DrawPrimitive::Quad ? "YES" : "NO");
     return source;
 }
 
@@ -135,62 +503,79 @@ bool ParticleEngineClass::Construct(const Drawable::Environment& env,  const Ins
     // based sizes
     const auto pixel_scaler = std::min(env.pixel_ratio.x, env.pixel_ratio.y);
 
-#pragma pack(push, 1)
-    struct ParticleVertex {
-        Vec2 aPosition;
-        Vec2 aDirection;
-        Vec4 aData;
-    };
-#pragma pack(pop)
-    using DataType = VertexLayout::Attribute::DataType;
-    static const VertexLayout layout(sizeof(ParticleVertex), {
-        {"aPosition",  0, 2, 0, offsetof(ParticleVertex, aPosition),  DataType::Float},
-        {"aDirection", 0, 2, 0, offsetof(ParticleVertex, aDirection), DataType::Float},
-        {"aData",      0, 4, 0, offsetof(ParticleVertex, aData),      DataType::Float}
-    });
-    static_assert(std::is_trivially_copyable<ParticleVertex>::value &&
-                  std::is_trivially_copy_assignable<ParticleVertex>::value &&
-                  std::is_standard_layout<ParticleVertex>::value, "Particle vertex is not supported.");
-
     auto& geometry = create.buffer;
     ASSERT(geometry.GetNumDrawCmds() == 0);
     create.usage = Geometry::Usage::Stream;
     create.content_name = mName;
 
+    ParticleVertexArgs args;
+    args.inv_max_xpos = 1.0f / mParams->max_xpos;
+    args.inv_max_ypos = 1.0f / mParams->max_ypos;
+    args.inv_max_lifetime = 1.0f / mParams->max_lifetime;
+    args.size_scaler = pixel_scaler;
+
     if (mParams->primitive == DrawPrimitive::Point)
     {
+        const auto& particles = state.particles;
+        const auto particle_count = particles.GetCount();
+
         TypedVertexBuffer<ParticleVertex> vertex_buffer;
-        vertex_buffer.SetVertexLayout(layout);
-        vertex_buffer.Resize(state.particles.size());
+        vertex_buffer.SetVertexLayout(GetParticleVertexLayout());
+        vertex_buffer.Resize(particle_count);
 
-        for (size_t i=0; i<state.particles.size(); ++i)
+        for (size_t i=0; i<particle_count; ++i)
         {
-            const auto& particle = state.particles[i];
-            // When using local coordinate space the max x/y should
-            // be the extents of the simulation in which case the
-            // particle x,y become normalized on the [0.0f, 1.0f] range.
-            // when using global coordinate space max x/y should be 1.0f
-            // and particle coordinates are left in the global space
-            auto& vertex = vertex_buffer[i];
-            vertex.aPosition.x = particle.position.x / mParams->max_xpos;
-            vertex.aPosition.y = particle.position.y / mParams->max_ypos;
-            vertex.aDirection = ToVec(particle.direction);
-            // copy the per particle data into the data vector for the fragment shader.
-            vertex.aData.x = particle.pointsize >= 0.0f ? particle.pointsize * pixel_scaler : 0.0f;
-            // abusing texcoord here to provide per particle random value.
-            // we can use this to simulate particle rotation for example
-            // (if the material supports it)
-            vertex.aData.y = particle.randomizer;
-            // Use the particle data to pass the per particle alpha.
-            vertex.aData.z = particle.alpha;
-            // use the particle data to pass the per particle time.
-            vertex.aData.w = particle.time / (particle.time_scale * mParams->max_lifetime);
+            vertex_buffer[i] = MakeParticleVertex(particles, i, args);
         }
 
-        geometry.SetVertexLayout(layout);
+        geometry.SetVertexLayout(GetParticleVertexLayout());
         geometry.SetVertexBuffer(std::move(vertex_buffer));
         geometry.AddDrawCmd(Geometry::DrawType::Points);
     }
+    else if (mParams->primitive == DrawPrimitive::Quad && HasParticleInstances(env))
+    {
+        // the particles are instances of this quad and the per particle
+        // data comes from the instance buffer. See ConstructInstances.
+        TypedVertexBuffer<ParticleCornerVertex> vertex_buffer;
+        vertex_buffer.SetVertexLayout(GetParticleCornerLayout());
+        vertex_buffer.Resize(6);
+        for (size_t i=0; i<6; ++i)
+            vertex_buffer[i] = QuadCorners[i];
+
+        geometry.SetVertexLayout(GetParticleCornerLayout());
+        geometry.SetVertexBuffer(std::move(vertex_buffer));
+        geometry.AddDrawCmd(Geometry::DrawType::Triangles);
+    }
+    else if (mParams->primitive == DrawPrimitive::Quad)
+    {
+        // no instancing available (GL ES2) or the client is doing its own
+        // instancing. Expand the quads on the CPU. The quad size is in the
+        // world units and the expansion is done in the vertex shader.
+        args.size_scaler = 1.0f;
+
+        const auto& particles = state.particles;
+        const auto particle_count = particles.GetCount();
+
+        TypedVertexBuffer<ParticleQuadVertex> vertex_buffer;
+        vertex_buffer.SetVertexLayout(GetParticleQuadLayout());
+        vertex_buffer.Resize(particle_count * 6);
+
+        for (size_t i=0; i<particle_count; ++i)
+        {
+            const auto& particle = MakeParticleVertex(particles, i, args);
+            for (size_t j=0; j<6; ++j)
+            {
+                auto& vertex = vertex_buffer[i * 6 + j];
+                vertex.aCorner    = QuadCorners[j].aCorner;
+                vertex.aPosition  = particle.aPosition;
+                vertex.aDirection = particle.aDirection;
+                vertex.aData      = particle.aData;
+            }
+        }
+        geometry.SetVertexLayout(GetParticleQuadLayout());
+        geometry.SetVertexBuffer(std::move(vertex_buffer));
+        geometry.AddDrawCmd(Geometry::DrawType::Triangles);
+    }
     else if (mParams->primitive == DrawPrimitive::FullLine ||
              mParams->primitive == DrawPrimitive::PartialLineBackward ||
              mParams->primitive == DrawPrimitive::PartialLineForward)
@@ -227,15 +612,15 @@ bool ParticleEngineClass::Construct(const Drawable::Environment& env,  const Ins
                                      ? glm::inverse(model_to_world) : glm::mat4(1.0f);
 
         const auto primitive = mParams->primitive;
-        const auto particle_count = state.particles.size();
+        const auto particle_count = state.particles.GetCount();
 
         TypedVertexBuffer<ParticleVertex> vertex_buffer;
-        vertex_buffer.SetVertexLayout(layout);
+        vertex_buffer.SetVertexLayout(GetParticleVertexLayout());
         vertex_buffer.Resize(particle_count * 2); // for the 2 line end points.
 
-        for (size_t i=0; i<state.particles.size(); ++i)
+        for (size_t i=0; i<particle_count; ++i)
         {
-            const auto& particle = state.particles[i];
+            const auto& particle = state.particles.GetParticle(i);
             const auto line_length = mParams->coordinate_space == CoordinateSpace::Local
                                      ? glm::length(world_to_model * glm::vec4(particle.pointsize, 0.0f, 0.0f, 0.0f)) : particle.pointsize;
 
@@ -284,7 +669,7 @@ bool ParticleEngineClass::Construct(const Drawable::Environment& env,  const Ins
             vertex_buffer[vertex_index+1] = vertex;
         }
         geometry.SetVertexBuffer(std::move(vertex_buffer));
-        geometry.SetVertexLayout(layout);
+        geometry.SetVertexLayout(GetParticleVertexLayout());
         geometry.AddDrawCmd(Geometry::DrawType::Lines);
     }
     return true;
@@ -316,8 +701,58 @@ bool ParticleEngineClass::Construct(const Environment& env, const InstanceState&
     return true;
 }
 
+bool ParticleEngineClass::ConstructInstances(const Environment& env, const InstanceState& state,
+                                             gfx::InstancedDraw::CreateArgs& args) const
+{
+    // take a lock on the mutex to make sure that we don't have
+    // a race condition with the background tasks.
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    const auto& particles = state.particles;
+    const auto particle_count = particles.GetCount();
+    if (particle_count == 0)
+        return false;
+
+    // the quad size is in world units, the quads are
+    // expanded in the vertex shader.
+    ParticleVertexArgs vertex_args;
+    vertex_args.inv_max_xpos = 1.0f / mParams->max_xpos;
+    vertex_args.inv_max_ypos = 1.0f / mParams->max_ypos;
+    vertex_args.inv_max_lifetime = 1.0f / mParams->max_lifetime;
+
+    InstancedDrawBuffer buffer;
+    buffer.SetInstanceDataLayout(GetParticleInstanceLayout());
+    buffer.Resize(particle_count);
+
+    for (size_t i=0; i<particle_count; ++i)
+    {
+        buffer.SetInstanceData(MakeParticleVertex(particles, i, vertex_args), i);
+    }
+
+    args.usage = BufferUsage::Stream;
+    args.content_name = mName;
+    args.buffer = std::move(buffer);
+    return true;
+}
+
+bool ParticleEngineClass::HasParticleInstances(const Environment& env) const
+{
+    // the client side instancing (drawing the same particle engine
+    // multiple times) uses the instance buffer for the instance
+    // transforms so then the quads are expanded on the CPU.
+    return mParams->primitive == DrawPrimitive::Quad &&
+           env.instancing_supported && !env.use_instancing;
+}
+
 bool ParticleEngineClass::ApplyDynamicState(const Environment& env, ProgramState& program) const
 {
+    if (mParams->primitive == DrawPrimitive::Quad)
+    {
+        // the quads are expanded around the particle position in the view
+        // space. map the quad corner from world units to view units.
+        program.SetUniform("kParticleQuadMatrix", glm::mat2(*env.view_matrix));
+    }
+
     if (mParams->coordinate_space == CoordinateSpace::Global)
     {
         // when the coordinate space is global the particles are spawn directly
@@ -349,7 +784,8 @@ void ParticleEngineClass::Update(const Environment& env, InstanceStatePtr ptr, f
     //   animation (for example space ship) using its own particle engine
     //   instance each kind of ship could share one particle engine.
     // - Parallelize the particle updates, i.e. try to throw more CPU cores
-    //   at the issue.
+    //   at the issue. With the immediate execution mode the caller can update
+    //   several particle engines in parallel (see the renderer)
     // - Use the GPU instead of the CPU. On GL ES 2 there are no transform
     //   feedback buffers. But for any simple particle animation such as this
     //   that doesn't use any second degree derivatives it should be possible
@@ -370,7 +806,7 @@ void ParticleEngineClass::Update(const Environment& env, InstanceStatePtr ptr, f
     // check if we've exceeded maximum lifetime.
     if (has_max_time && state.time >= mParams->max_time)
     {
-        state.particles.clear();
+        state.particles.Clear();
         state.time += dt;
         return;
     }
@@ -413,7 +849,7 @@ void ParticleEngineClass::Update(const Environment& env, InstanceStatePtr ptr, f
 
                 std::lock_guard<std::mutex> buffer_mutex(mInstanceState->buffer_mutex);
 
-                const auto num_particles_now = mInstanceState->task_buffer[0].size();
+                const auto num_particles_now = mInstanceState->task_buffer[0].GetCount();
                 if (num_particles_now < num_particles_always)
                 {
                     const auto num_particles_needed = num_particles_always - num_particles_now;
@@ -421,6 +857,7 @@ void ParticleEngineClass::Update(const Environment& env, InstanceStatePtr ptr, f
                     ParticleEngineClass::InitParticles(mEnvironment.ToEnv(),
                                                        *mEngineParams,
                                                        mInstanceState->task_buffer[0],
+                                                       mInstanceState->random,
                                                        num_particles_needed);
 
                     // copy the updated contents over to the dst buffer.
@@ -443,7 +880,7 @@ void ParticleEngineClass::Update(const Environment& env, InstanceStatePtr ptr, f
             const EngineParamsPtr  mEngineParams;
         };
 
-        if (auto* pool = base::GetGlobalThreadPool())
+        if (auto* pool = GetTaskThreadPool(*ptr))
         {
             ptr->task_count++;
 
@@ -455,14 +892,14 @@ void ParticleEngineClass::Update(const Environment& env, InstanceStatePtr ptr, f
         else
         {
             const auto num_particles_always = size_t(mParams->num_particles);
-            const auto num_particles_now = state.particles.size();
+            const auto num_particles_now = state.particles.GetCount();
             if (num_particles_now < num_particles_always)
             {
                 const auto num_particles_needed = num_particles_always - num_particles_now;
 
                 std::lock_guard<std::mutex> lock(state.mutex);
 
-                ParticleEngineClass::InitParticles(env, *mParams, ptr->particles, num_particles_needed);
+                ParticleEngineClass::InitParticles(env, *mParams, ptr->particles, ptr->random, num_particles_needed);
             }
         }
     }
@@ -637,7 +1074,7 @@ bool ParticleEngineClass::IsAlive(const InstanceStatePtr& ptr) const
     if (state.task_count)
         return true;
 
-    return !state.particles.empty();
+    return !state.particles.IsEmpty();
 }
 
 void ParticleEngineClass::Emit(const Environment& env, InstanceStatePtr ptr, int count) const
@@ -670,13 +1107,13 @@ void ParticleEngineClass::Restart(const Environment& env, InstanceStatePtr ptr)
         {
             {
                 std::lock_guard<std::mutex> lock(mInstanceState->buffer_mutex);
-                mInstanceState->task_buffer[0].clear();
-                mInstanceState->task_buffer[1].clear();
+                mInstanceState->task_buffer[0].Clear();
+                mInstanceState->task_buffer[1].Clear();
             }
 
             {
                 std::lock_guard<std::mutex> lock(mInstanceState->mutex);
-                mInstanceState->particles.clear();
+                mInstanceState->particles.Clear();
                 mInstanceState->task_count--;
             }
         }
@@ -684,7 +1121,7 @@ void ParticleEngineClass::Restart(const Environment& env, InstanceStatePtr ptr)
         const InstanceStatePtr mInstanceState;
     };
 
-    if (auto* pool = base::GetGlobalThreadPool())
+    if (auto* pool = GetTaskThreadPool(*ptr))
     {
         ptr->task_count++;
 
@@ -696,7 +1133,7 @@ void ParticleEngineClass::Restart(const Environment& env, InstanceStatePtr ptr)
     {
         std::lock_guard<std::mutex> lock(state.mutex);
 
-        state.particles.clear();
+        state.particles.Clear();
     }
 
     state.delay    = mParams->delay;
@@ -763,7 +1200,7 @@ void ParticleEngineClass::UpdateParticles(const Environment& env, InstanceStateP
         const float mTimeStep;
     };
 
-    if (auto* pool = base::GetGlobalThreadPool())
+    if (auto* pool = GetTaskThreadPool(*state))
     {
         state->task_count++;
 
@@ -782,7 +1219,7 @@ void ParticleEngineClass::UpdateParticles(const Environment& env, InstanceStateP
 // static
 void ParticleEngineClass::UpdateParticles(const Environment& env, const Params& params, ParticleBuffer& particles, float dt)
 {
-    ParticleWorld world;
+    std::optional<glm::vec2> world_gravity;
     // transform the gravity vector associated with the particle engine
     // to world space. For example when the rendering system uses dimetric
     // rendering for some shape (we're looking at it at on a xy plane at
@@ -792,27 +1229,76 @@ void ParticleEngineClass::UpdateParticles(const Environment& env, const Params&
     {
         const auto local_gravity_dir = glm::normalize(params.gravity);
         const auto world_gravity_dir = glm::normalize(*env.world_matrix * glm::vec4 { local_gravity_dir, 0.0f, 0.0f });
-        const auto world_gravity = glm::vec2 { world_gravity_dir.x * std::abs(params.gravity.x),
-                                               world_gravity_dir.y * std::abs(params.gravity.y) };
-        world.world_gravity = world_gravity;
+        world_gravity = glm::vec2 { world_gravity_dir.x * std::abs(params.gravity.x),
+                                    world_gravity_dir.y * std::abs(params.gravity.y) };
     }
 
-    // update each current particle
-    for (size_t i=0; i<particles.size();)
+    const auto count = particles.GetCount();
+
+    // the particles to kill at the end of the update. reusing the
+    // buffer per thread in order to avoid allocating on every update.
+    static thread_local std::vector<std::uint8_t> kill;
+    kill.clear();
+    kill.resize(count, 0);
+
+    if (params.flags.test(Flags::ParticlesCanExpire))
+        AgeParticles(particles.time.data(), particles.time_scale.data(), kill.data(), params.max_lifetime, dt, count);
+    else AgeParticles(particles.time.data(), dt, count);
+
+    IntegrateArgs args;
+    args.position_x  = particles.position_x.data();
+    args.position_y  = particles.position_y.data();
+    args.direction_x = particles.direction_x.data();
+    args.direction_y = particles.direction_y.data();
+    args.pointsize   = particles.pointsize.data();
+    args.alpha       = particles.alpha.data();
+    args.distance    = particles.distance.data();
+    args.time_scale  = particles.time_scale.data();
+    args.kill        = kill.data();
+    args.gravity     = glm::vec2(0.0f, 0.0f);
+    if (params.motion == Motion::Projectile)
+        args.gravity = world_gravity.value_or(params.gravity);
+    args.size_wrt_time  = params.rate_of_change_in_size_wrt_time;
+    args.size_wrt_dist  = params.rate_of_change_in_size_wrt_dist;
+    args.alpha_wrt_time = params.rate_of_change_in_alpha_wrt_time;
+    args.alpha_wrt_dist = params.rate_of_change_in_alpha_wrt_dist;
+    args.dt    = dt;
+    args.count = count;
+    IntegrateParticles(args);
+
+    // boundary conditions.
+    // todo: boundary conditions with global coordinate space.
+    if (params.coordinate_space == CoordinateSpace::Local)
     {
-        if (UpdateParticle(env, params, world, particles, i, dt))
+        if (params.boundary == BoundaryPolicy::Wrap)
+        {
+            WrapParticles(particles.position_x.data(), params.max_xpos, count);
+            WrapParticles(particles.position_y.data(), params.max_ypos, count);
+        }
+        else if (params.boundary == BoundaryPolicy::Clamp)
+        {
+            ClampParticles(particles.position_x.data(), params.max_xpos, count);
+            ClampParticles(particles.position_y.data(), params.max_ypos, count);
+        }
+        else if (params.boundary == BoundaryPolicy::Kill)
+        {
+            KillParticlesOutside(particles.position_x.data(), kill.data(), params.max_xpos, count);
+            KillParticlesOutside(particles.position_y.data(), kill.data(), params.max_ypos, count);
+        }
+        else if (params.boundary == BoundaryPolicy::Reflect)
         {
-            ++i;
-            continue;
+            ReflectParticles(particles, params.max_xpos, params.max_ypos);
         }
-        KillParticle(particles, i);
     }
+
+    RemoveDeadParticles(particles, kill);
 }
 
 // static
-void ParticleEngineClass::SetRandomGenerator(std::function<float(float min, float max)> rd)
+void ParticleEngineClass::SetRandomSeed(std::uint64_t seed)
 {
-    random_function = std::move(rd);
+    random_seed = seed;
+    random_sequence = 0;
 }
 
 // static
@@ -838,6 +1324,7 @@ void ParticleEngineClass::InitParticles(const Environment& env, InstanceStatePtr
                 ParticleEngineClass::InitParticles(mEnvironment.ToEnv(),
                                                    *mEngineParams,
                                                    mInstanceState->task_buffer[0],
+                                                   mInstanceState->random,
                                                    mInitCount);
 
                 // copy the updated contents over to the dst buffer.
@@ -861,7 +1348,7 @@ void ParticleEngineClass::InitParticles(const Environment& env, InstanceStatePtr
         const size_t mInitCount = 0;
     };
 
-    if (auto* pool = base::GetGlobalThreadPool())
+    if (auto* pool = GetTaskThreadPool(*state))
     {
         state->task_count++;
 
@@ -873,12 +1360,13 @@ void ParticleEngineClass::InitParticles(const Environment& env, InstanceStatePtr
     {
         std::lock_guard<std::mutex> lock(state->mutex);
 
-        ParticleEngineClass::InitParticles(env, *mParams, state->particles, num);
+        ParticleEngineClass::InitParticles(env, *mParams, state->particles, state->random, num);
     }
 }
 
 // static
-void ParticleEngineClass::InitParticles(const Environment& env, const Params& params, ParticleBuffer& particles, size_t num)
+void ParticleEngineClass::InitParticles(const Environment& env, const Params& params, ParticleBuffer& particles,
+                                        base::FastRandom& random, size_t num)
 {
     // basic sanity to avoid division by zero.
     if (params.max_lifetime <= 0.0f || params.max_lifetime < params.min_lifetime)
@@ -886,10 +1374,8 @@ void ParticleEngineClass::InitParticles(const Environment& env, const Params& pa
 
     const bool can_expire = params.flags.test(Flags::ParticlesCanExpire);
 
-    const auto count = particles.size();
-    particles.resize(count + num);
-
-    auto GenRandomNumber = GetRandomGenerator();
+    const auto count = particles.GetCount();
+    particles.Resize(count + num);
 
     if (params.coordinate_space == CoordinateSpace::Global)
     {
@@ -903,28 +1389,28 @@ void ParticleEngineClass::InitParticles(const Environment& env, const Params& pa
 
         for (size_t i=0; i<num; ++i)
         {
-            const auto velocity = GenRandomNumber(params.min_velocity, params.max_velocity);
+            const auto velocity = random(params.min_velocity, params.max_velocity);
 
             glm::vec2 position;
             glm::vec2 direction;
             if (params.shape == EmitterShape::Rectangle)
             {
                 if (params.placement == Placement::Inside)
-                    position = glm::vec2(GenRandomNumber(0.0f, 1.0f), GenRandomNumber(0.0f, 1.0f));
+                    position = glm::vec2(random(0.0f, 1.0f), random(0.0f, 1.0f));
                 else if (params.placement == Placement::Center)
                     position = glm::vec2(0.5f, 0.5f);
                 else if (params.placement == Placement::Edge)
                 {
-                    const auto value = static_cast<int>(GenRandomNumber(0.0f, 1.0f) * 100.0f);
+                    const auto value = static_cast<int>(random(0.0f, 1.0f) * 100.0f);
                     const auto edge = value % 4;
                     if (edge == 0 || edge == 1)
                     {
                         position.x = edge == 0 ? 0.0f : 1.0f;
-                        position.y = GenRandomNumber(0.0f, 1.0f);
+                        position.y = random(0.0f, 1.0f);
                     }
                     else
                     {
-                        position.x = GenRandomNumber(0.0f, 1.0f);
+                        position.x = random(0.0f, 1.0f);
                         position.y = edge == 2 ? 0.0f : 1.0f;
                     }
                 }
@@ -935,15 +1421,15 @@ void ParticleEngineClass::InitParticles(const Environment& env, const Params& pa
                     position = glm::vec2(0.5f, 0.5f);
                 else if (params.placement == Placement::Inside)
                 {
-                    const auto x = GenRandomNumber(-emitter_radius, emitter_radius);
-                    const auto y = GenRandomNumber(-emitter_radius, emitter_radius);
-                    const auto r = GenRandomNumber(0.0f, 1.0f);
+                    const auto x = random(-emitter_radius, emitter_radius);
+                    const auto y = random(-emitter_radius, emitter_radius);
+                    const auto r = random(0.0f, 1.0f);
                     position = glm::normalize(glm::vec2(x, y)) * emitter_radius * r + emitter_center;
                 }
                 else if (params.placement == Placement::Edge)
                 {
-                    const auto x = GenRandomNumber(-emitter_radius, emitter_radius);
-                    const auto y = GenRandomNumber(-emitter_radius, emitter_radius);
+                    const auto x = random(-emitter_radius, emitter_radius);
+                    const auto y = random(-emitter_radius, emitter_radius);
                     position = glm::normalize(glm::vec2(x, y)) * emitter_radius + emitter_center;
                 }
             }
@@ -951,7 +1437,7 @@ void ParticleEngineClass::InitParticles(const Environment& env, const Params& pa
             if (params.direction == Direction::Sector)
             {
                 const auto direction_angle = params.direction_sector_start_angle +
-                                                 GenRandomNumber(0.0f, params.direction_sector_size);
+                                                 random(0.0f, params.direction_sector_size);
 
                 const float model_to_world_rotation = math::GetRotationFromMatrix(*env.model_matrix);
                 const auto world_direction =  math::RotateVectorAroundZ(glm::vec2(1.0f, 0.0f), model_to_world_rotation + direction_angle);
@@ -959,8 +1445,8 @@ void ParticleEngineClass::InitParticles(const Environment& env, const Params& pa
             }
             else if (params.placement == Placement::Center)
             {
-                direction = glm::normalize(glm::vec2(GenRandomNumber(-1.0f, 1.0f),
-                                                     GenRandomNumber(-1.0f, 1.0f)));
+                direction = glm::normalize(glm::vec2(random(-1.0f, 1.0f),
+                                                     random(-1.0f, 1.0f)));
             }
             else if (params.direction == Direction::Inwards)
                 direction = glm::normalize(emitter_center - position);
@@ -970,14 +1456,15 @@ void ParticleEngineClass::InitParticles(const Environment& env, const Params& pa
             const auto world = particle_to_world * glm::vec4(position, 0.0f, 1.0f);
             // note that the velocity vector is baked into the
             // direction vector in order to save space.
-            auto& particle = particles[count+i];
+            Particle particle;
             particle.time       = 0.0f;
-            particle.time_scale = can_expire ? GenRandomNumber(params.min_lifetime, params.max_lifetime) / params.max_lifetime : 1.0f;
-            particle.pointsize  = GenRandomNumber(params.min_point_size, params.max_point_size);
-            particle.alpha      = GenRandomNumber(params.min_alpha, params.max_alpha);
+            particle.time_scale = can_expire ? random(params.min_lifetime, params.max_lifetime) / params.max_lifetime : 1.0f;
+            particle.pointsize  = random(params.min_point_size, params.max_point_size);
+            particle.alpha      = random(params.min_alpha, params.max_alpha);
             particle.position   = glm::vec2(world.x, world.y);
             particle.direction  = direction * velocity;
-            particle.randomizer = GenRandomNumber(0.0f, 1.0f);
+            particle.randomizer = random(0.0f, 1.0f);
+            particles.SetParticle(count+i, particle);
         }
     }
     else if (params.coordinate_space == CoordinateSpace::Local)
@@ -1001,35 +1488,35 @@ void ParticleEngineClass::InitParticles(const Environment& env, const Params& pa
 
         for (size_t i = 0; i < num; ++i)
         {
-            const auto velocity = GenRandomNumber(params.min_velocity, params.max_velocity);
+            const auto velocity = random(params.min_velocity, params.max_velocity);
             glm::vec2 position;
             glm::vec2 direction;
             if (params.shape == EmitterShape::Rectangle)
             {
                 if (params.placement == Placement::Inside)
-                    position = emitter_pos + glm::vec2(GenRandomNumber(0.0f, emitter_width),
-                                                       GenRandomNumber(0.0f, emitter_height));
+                    position = emitter_pos + glm::vec2(random(0.0f, emitter_width),
+                                                       random(0.0f, emitter_height));
                 else if (params.placement == Placement::Center)
                     position = emitter_center;
                 else if (params.placement == Placement::Edge)
                 {
-                    const auto value = static_cast<int>(GenRandomNumber(0.0f, 1.0f) * 100.0f);
+                    const auto value = static_cast<int>(random(0.0f, 1.0f) * 100.0f);
                     const auto edge = value % 4;
                     if (edge == 0 || edge == 1)
                     {
                         position.x = edge == 0 ? emitter_left : emitter_right;
-                        position.y = GenRandomNumber(emitter_top, emitter_bot);
+                        position.y = random(emitter_top, emitter_bot);
                     }
                     else
                     {
-                        position.x = GenRandomNumber(emitter_left, emitter_right);
+                        position.x = random(emitter_left, emitter_right);
                         position.y = edge == 2 ? emitter_top : emitter_bot;
                     }
                 }
                 else if (params.placement == Placement::Outside)
                 {
-                    position.x = GenRandomNumber(0.0f, sim_width);
-                    position.y = GenRandomNumber(0.0f, sim_height);
+                    position.x = random(0.0f, sim_width);
+                    position.y = random(0.0f, sim_height);
                     if (position.y >= emitter_top && position.y <= emitter_bot)
                     {
                         if (position.x < emitter_center.x)
@@ -1044,23 +1531,23 @@ void ParticleEngineClass::InitParticles(const Environment& env, const Params& pa
                     position  = emitter_center;
                 else if (params.placement == Placement::Inside)
                 {
-                    const auto x = GenRandomNumber(-1.0f, 1.0f);
-                    const auto y = GenRandomNumber(-1.0f, 1.0f);
-                    const auto r = GenRandomNumber(0.0f, 1.0f);
+                    const auto x = random(-1.0f, 1.0f);
+                    const auto y = random(-1.0f, 1.0f);
+                    const auto r = random(0.0f, 1.0f);
                     const auto p = glm::normalize(glm::vec2(x, y)) * emitter_radius * r;
                     position = p + emitter_pos + emitter_size * 0.5f;
                 }
                 else if (params.placement == Placement::Edge)
                 {
-                    const auto x = GenRandomNumber(-1.0f, 1.0f);
-                    const auto y = GenRandomNumber(-1.0f, 1.0f);
+                    const auto x = random(-1.0f, 1.0f);
+                    const auto y = random(-1.0f, 1.0f);
                     const auto p = glm::normalize(glm::vec2(x, y)) * emitter_radius;
                     position = p + emitter_pos + emitter_size * 0.5f;
                 }
                 else if (params.placement == Placement::Outside)
                 {
-                    auto p = glm::vec2(GenRandomNumber(0.0f, sim_width),
-                                       GenRandomNumber(0.0f, sim_height));
+                    auto p = glm::vec2(random(0.0f, sim_width),
+                                       random(0.0f, sim_height));
                     auto v = p - emitter_center;
                     if (glm::length(v) < emitter_radius)
                         p = glm::normalize(v) * emitter_radius + emitter_center;
@@ -1071,13 +1558,13 @@ void ParticleEngineClass::InitParticles(const Environment& env, const Params& pa
 
             if (params.direction == Direction::Sector)
             {
-                const auto angle = GenRandomNumber(0.0f, params.direction_sector_size) + params.direction_sector_start_angle;
+                const auto angle = random(0.0f, params.direction_sector_size) + params.direction_sector_start_angle;
                 direction = glm::vec2(std::cos(angle), std::sin(angle));
             }
             else if (params.placement == Placement::Center)
             {
-                direction = glm::normalize(glm::vec2(GenRandomNumber(-1.0f, 1.0f),
-                                                     GenRandomNumber(-1.0f, 1.0f)));
+                direction = glm::normalize(glm::vec2(random(-1.0f, 1.0f),
+                                                     random(-1.0f, 1.0f)));
             }
             else if (params.direction == Direction::Inwards)
                 direction = glm::normalize(emitter_center - position);
@@ -1086,125 +1573,19 @@ void ParticleEngineClass::InitParticles(const Environment& env, const Params& pa
 
             // note that the velocity vector is baked into the
             // direction vector in order to save space.
-            auto& particle      = particles[count+i];
+            Particle particle;
             particle.time       = 0.0f;
-            particle.time_scale = can_expire ? GenRandomNumber(params.min_lifetime, params.max_lifetime) / params.max_lifetime : 1.0f;
-            particle.pointsize  = GenRandomNumber(params.min_point_size, params.max_point_size);
-            particle.alpha      = GenRandomNumber(params.min_alpha, params.max_alpha);
+            particle.time_scale = can_expire ? random(params.min_lifetime, params.max_lifetime) / params.max_lifetime : 1.0f;
+            particle.pointsize  = random(params.min_point_size, params.max_point_size);
+            particle.alpha      = random(params.min_alpha, params.max_alpha);
             particle.position   = position;
             particle.direction  = direction *  velocity;
-            particle.randomizer = GenRandomNumber(0.0f, 1.0f);
+            particle.randomizer = random(0.0f, 1.0f);
+            particles.SetParticle(count+i, particle);
         }
     } else BUG("Unhandled particle system coordinate space.");
 }
 
-// static
-void ParticleEngineClass::KillParticle(ParticleBuffer& particles, size_t i)
-{
-    const auto last = particles.size() - 1;
-    std::swap(particles[i], particles[last]);
-    particles.pop_back();
-}
-
-
-// static
-bool ParticleEngineClass::UpdateParticle(const Environment& env, const Params& params, const ParticleWorld& world,
-                                         ParticleBuffer& particles, size_t i, float dt)
-{
-    auto& p = particles[i];
-
-    p.time += dt;
-
-    if (params.flags.test(Flags::ParticlesCanExpire))
-    {
-        if (p.time > p.time_scale * params.max_lifetime)
-            return false;
-    }
-
-    const auto p0 = p.position;
-
-    // update change in position
-    if (params.motion == Motion::Linear)
-        p.position += (p.direction * dt);
-    else if (params.motion == Motion::Projectile)
-    {
-        glm::vec2 gravity = params.gravity;
-        if (world.world_gravity.has_value())
-            gravity = world.world_gravity.value();
-
-        p.position += (p.direction * dt);
-        p.direction += (dt * gravity);
-    }
-
-    const auto& p1 = p.position;
-    const auto& dp = p1 - p0;
-    const auto  dd = glm::length(dp);
-
-    // Update particle size with respect to time and distance
-    p.pointsize += (dt * params.rate_of_change_in_size_wrt_time * p.time_scale);
-    p.pointsize += (dd * params.rate_of_change_in_size_wrt_dist);
-    if (p.pointsize <= 0.0f)
-        return false;
-
-    // update particle alpha value with respect to time and distance.
-    p.alpha += (dt * params.rate_of_change_in_alpha_wrt_time * p.time_scale);
-    p.alpha += (dt * params.rate_of_change_in_alpha_wrt_dist);
-    if (p.alpha <= 0.0f)
-        return false;
-    p.alpha = math::clamp(0.0f, 1.0f, p.alpha);
-
-    // accumulate distance approximation
-    p.distance += dd;
-
-    // todo:
-    if (params.coordinate_space == CoordinateSpace::Global)
-        return true;
-
-    // boundary conditions.
-    if (params.boundary == BoundaryPolicy::Wrap)
-    {
-        p.position.x = math::wrap(0.0f, params.max_xpos, p.position.x);
-        p.position.y = math::wrap(0.0f, params.max_ypos, p.position.y);
-    }
-    else if (params.boundary == BoundaryPolicy::Clamp)
-    {
-        p.position.x = math::clamp(0.0f, params.max_xpos, p.position.x);
-        p.position.y = math::clamp(0.0f, params.max_ypos, p.position.y);
-    }
-    else if (params.boundary == BoundaryPolicy::Kill)
-    {
-        if (p.position.x < 0.0f || p.position.x > params.max_xpos)
-            return false;
-        else if (p.position.y < 0.0f || p.position.y > params.max_ypos)
-            return false;
-    }
-    else if (params.boundary == BoundaryPolicy::Reflect)
-    {
-        glm::vec2 n;
-        if (p.position.x <= 0.0f)
-            n = glm::vec2(1.0f, 0.0f);
-        else if (p.position.x >= params.max_xpos)
-            n = glm::vec2(-1.0f, 0.0f);
-        else if (p.position.y <= 0.0f)
-            n = glm::vec2(0, 1.0f);
-        else if (p.position.y >= params.max_ypos)
-            n = glm::vec2(0, -1.0f);
-        else return true;
-        // compute new direction vector given the normal vector of the boundary
-        // and then bake the velocity in the new direction
-        const auto& d = glm::normalize(p.direction);
-        const float v = glm::length(p.direction);
-        p.direction = (d - 2 * glm::dot(d, n) * n) * v;
-
-        // clamp the position in order to eliminate the situation
-        // where the object has moved beyond the boundaries of the simulation
-        // and is stuck there alternating it's direction vector
-        p.position.x = math::clamp(0.0f, params.max_xpos, p.position.x);
-        p.position.y = math::clamp(0.0f, params.max_ypos, p.position.y);
-    }
-    return true;
-}
-
 bool ParticleEngineInstance::ApplyDynamicState(const Environment& env, Device&, ProgramState& program, RasterState& state) const
 {
     // state.line_width = 1.0; // don't change the line width
@@ -1239,6 +1620,16 @@ bool ParticleEngineInstance::Construct(const Environment& env, Device&, const In
     return mClass->Construct(env, *mState, draw, args);
 }
 
+bool ParticleEngineInstance::HasDrawableInstances(const Environment& env) const
+{
+    return mClass->HasParticleInstances(env);
+}
+
+bool ParticleEngineInstance::ConstructInstances(const Environment& env, Device&, gfx::InstancedDraw::CreateArgs& args) const
+{
+    return mClass->ConstructInstances(env, *mState, args);
+}
+
 void ParticleEngineInstance::Update(const Environment& env, float dt)
 {
     mClass->Update(env, mState, dt);
@@ -1302,6 +1693,8 @@ Drawable::DrawPrimitive ParticleEngineInstance::GetDrawPrimitive() const
     const auto p = mClass->GetParams().primitive;
     if (p == ParticleEngineClass::DrawPrimitive::Point)
         return DrawPrimitive::Points;
+    else if (p == ParticleEngineClass::DrawPrimitive::Quad)
+        return DrawPrimitive::Triangles;
     else if (p == ParticleEngineClass::DrawPrimitive::FullLine ||
              p == ParticleEngineClass::DrawPrimitive::PartialLineBackward ||
              p == ParticleEngineClass::DrawPrimitive::PartialLineForward)
@@ -27,10 +27,12 @@
 #include <optional>
 #include <memory>
 #include <mutex>
-#include <functional>
+#include <vector>
+#include <cstdint>
 
 #include "base/bitflag.h"
 #include "base/utility.h"
+#include "base/random.h"
 #include "graphics/drawable.h"
 
 namespace gfx
@@ -72,7 +74,37 @@ namespace gfx
             // 1.0f = particle is fully opaque.
             float alpha = 1.0f;
         };
-        using ParticleBuffer = std::vector<Particle>;
+
+        // The simulation particles stored in a structure of arrays layout.
+        // Each particle attribute is a contiguous array of floats so that
+        // the particle update kernels are simple loops over the arrays
+        // that the compiler can vectorize.
+        struct ParticleBuffer {
+            std::vector<float> position_x;
+            std::vector<float> position_y;
+            std::vector<float> direction_x;
+            std::vector<float> direction_y;
+            std::vector<float> pointsize;
+            std::vector<float> time;
+            std::vector<float> time_scale;
+            std::vector<float> distance;
+            std::vector<float> randomizer;
+            std::vector<float> alpha;
+
+            inline size_t GetCount() const noexcept
+            { return position_x.size(); }
+            inline bool IsEmpty() const noexcept
+            { return position_x.empty(); }
+
+            void Resize(size_t count);
+            void Clear() noexcept;
+            // Kill the particle at the given index by moving the last
+            // particle in its place.
+            void KillParticle(size_t index) noexcept;
+            // Get/set a single particle at the given index.
+            Particle GetParticle(size_t index) const noexcept;
+            void SetParticle(size_t index, const Particle& particle) noexcept;
+        };
 
         // Define the motion of the particle.
         enum class Motion {
@@ -164,7 +196,11 @@ namespace gfx
         };
 
         enum class DrawPrimitive {
-            Point, FullLine, PartialLineBackward, PartialLineForward
+            Point, FullLine, PartialLineBackward, PartialLineForward,
+            // Draw every particle as a quad. When the device supports
+            // instancing the quads are expanded on the GPU from compact
+            // per particle instance data, otherwise on the CPU.
+            Quad
         };
 
         enum class Flags {
@@ -175,7 +211,7 @@ namespace gfx
         struct Params {
             base::bitflag<Flags> flags = GetDefaultFlags();
 
-            DrawPrimitive primitive = DrawPrimitive::Point;
+            DrawPrimitive primitive = DrawPrimitive::Quad;
 
             Direction direction = Direction::Sector;
             // Placement of particles wrt. the emitter shape
@@ -254,8 +290,22 @@ namespace gfx
         };
         using EngineParamsPtr = std::shared_ptr<Params>;
 
+        // Control how the particle engine operations (restart, emit, update)
+        // are executed when there's a global thread pool.
+        enum class ExecutionMode {
+            // Run the operations as tasks on a background worker thread.
+            // The calling thread doesn't wait for the results which become
+            // available for rendering once the tasks have completed.
+            Background,
+            // Run the operations immediately on the calling thread. This
+            // lets the caller update several particle engines in parallel
+            // on the thread pool and then wait for all of them to complete.
+            Immediate
+        };
+
         // State of any instance of ParticleEngineInstance.
         struct InstanceState {
+            InstanceState() noexcept;
             // exclusion device on the particles buffer below.
             mutable std::mutex mutex;
             // the simulation particles.
@@ -273,6 +323,12 @@ namespace gfx
             mutable std::mutex buffer_mutex;
             ParticleBuffer task_buffer[2];
             std::atomic<size_t> task_count = 0;
+            // how to execute the particle engine operations.
+            ExecutionMode execution_mode = ExecutionMode::Background;
+            // the random number generator for initializing particles.
+            // used together with the particle buffer being initialized,
+            // i.e. with the task buffers under the buffer mutex.
+            base::FastRandom random;
         };
         using InstanceStatePtr = std::shared_ptr<InstanceState>;
 
@@ -290,6 +346,11 @@ namespace gfx
         bool Construct(const Environment& env, const InstanceState& state, Geometry::CreateArgs& create) const;
         bool Construct(const Environment& env, const InstanceState& state, const InstancedDraw& draw,
                        gfx::InstancedDraw::CreateArgs& args) const;
+        bool ConstructInstances(const Environment& env, const InstanceState& state,
+                                gfx::InstancedDraw::CreateArgs& args) const;
+        // Returns true if the particles are drawn as instanced quads with
+        // the per particle instance data from ConstructInstances.
+        bool HasParticleInstances(const Environment& env) const;
         ShaderSource GetShader(const Environment& env, const Device& device) const;
         std::string GetShaderId(const Environment& env) const;
         std::string GetShaderName(const Environment& env) const;
@@ -330,21 +391,17 @@ namespace gfx
         std::unique_ptr<DrawableClass> Clone() const override;
         std::unique_ptr<DrawableClass> Copy() const override;
 
-        static void SetRandomGenerator(std::function<float(float min, float max)> random_function);
+        // Set the seed for seeding the random number generators of the
+        // particle engine instances created after this call. Useful for
+        // getting a repeatable simulation for example when testing.
+        static void SetRandomSeed(std::uint64_t seed);
+
+        static void InitParticles(const Environment& env, const Params& params, ParticleBuffer& particles,
+                                  base::FastRandom& random, size_t num);
+        static void UpdateParticles(const Environment& env, const Params& params, ParticleBuffer& particles, float dt);
     private:
         void InitParticles(const Environment& env, InstanceStatePtr state, size_t num) const;
         void UpdateParticles(const Environment& env, InstanceStatePtr state, float dt) const;
-
-        static void InitParticles(const Environment& env, const Params& params, ParticleBuffer& particles, size_t num);
-        static void UpdateParticles(const Environment& env, const Params& params, ParticleBuffer& particles, float dt);
-        static void KillParticle(ParticleBuffer& particles, size_t i);
-
-        struct ParticleWorld {
-            std::optional<glm::vec2> world_gravity;
-        };
-
-        static bool UpdateParticle(const Environment& env, const Params& params, const ParticleWorld& world,
-                                   ParticleBuffer& particles, size_t i, float dt);
     private:
         std::string mId;
         std::string mName;
@@ -396,6 +453,8 @@ namespace gfx
         std::string GetGeometryId(const Environment& env) const override;
         bool Construct(const Environment& env, Device&, Geometry::CreateArgs& create) const override;
         bool Construct(const Environment& env, Device&, const InstancedDraw& draw, gfx::InstancedDraw::CreateArgs& args) const override;
+        bool HasDrawableInstances(const Environment& env) const override;
+        bool ConstructInstances(const Environment& env, Device&, gfx::InstancedDraw::CreateArgs& args) const override;
         void Update(const Environment& env, float dt) override;
         bool IsAlive() const override;
         void Restart(const Environment& env) override;
@@ -411,11 +470,18 @@ namespace gfx
 
         // Get the current number of alive particles.
         inline size_t GetNumParticlesAlive() const noexcept
-        { return mState->particles.size(); }
+        { return mState->particles.GetCount(); }
 
         inline const Params& GetParams() const noexcept
         { return mClass->GetParams(); }
 
+        // Set how the particle engine operations are executed. This should
+        // be set before the particle engine is restarted the first time.
+        inline void SetExecutionMode(ParticleEngineClass::ExecutionMode mode) noexcept
+        { mState->execution_mode = mode; }
+        inline ParticleEngineClass::ExecutionMode GetExecutionMode() const noexcept
+        { return mState->execution_mode; }
+
     private:
         // this is the "class" object for this particle engine type.
         std::shared_ptr<const ParticleEngineClass> mClass;
@@ -0,0 +1,914 @@
+// Copyright (C) 2020-2025 Sami Väisänen
+// Copyright (C) 2020-2025 Ensisoft http://www.ensisoft.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "config.h"
+
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#  define PIXEL_KERNELS_X86
+#  include <immintrin.h>
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#  endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define PIXEL_KERNELS_NEON
+#  include <arm_neon.h>
+#endif
+
+// with GCC and Clang the SIMD kernels are compiled for their instruction
+// set with a target attribute so that the rest of the code (and the
+// scalar fallback) doesn't require the instruction set. MSVC allows
+// using the intrinsics without any specific flags.
+#if defined(PIXEL_KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+#  define TARGET_SSE2 __attribute__((target("sse2")))
+#  define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#  define TARGET_SSE2
+#  define TARGET_AVX2
+#endif
+
+#include "graphics/pixel_kernels.h"
+
+namespace {
+using namespace gfx;
+
+// The tables for transforming between 8bit sRGB and linear values.
+struct sRGB_Tables {
+    // 8bit sRGB to normalized linear.
+    float decode[256];
+    // 8bit sRGB to 8bit linear.
+    u8 decode_u8[256];
+    // normalized linear to 8bit sRGB.
+    u8 encode_256[256];
+    u8 encode_4096[4096];
+
+    sRGB_Tables() noexcept
+    {
+        for (unsigned i=0; i<256; ++i)
+        {
+            decode[i] = sRGB_decode(i / 255.0f);
+            decode_u8[i] = static_cast<u8>(decode[i] * 255);
+        }
+        for (unsigned i=0; i<256; ++i)
+            encode_256[i] = EncodeExact(i / 255.0f);
+        for (unsigned i=0; i<4096; ++i)
+            encode_4096[i] = EncodeExact(i / 4095.0f);
+    }
+    static u8 EncodeExact(float value) noexcept
+    {
+        // match the float to 8bit conversion done by Pixel_to_uints.
+        return static_cast<u8>(sRGB_encode(value) * 255);
+    }
+    inline u8 Encode(float value, sRGB_Mode mode) const noexcept
+    {
+        value = std::min(1.0f, std::max(0.0f, value));
+        if (mode == sRGB_Mode::LUT4096)
+            return encode_4096[static_cast<unsigned>(value * 4095.0f + 0.5f)];
+        else if (mode == sRGB_Mode::LUT256)
+            return encode_256[static_cast<unsigned>(value * 255.0f + 0.5f)];
+        return EncodeExact(value);
+    }
+};
+
+const sRGB_Tables& Get_sRGB_Tables() noexcept
+{
+    static const sRGB_Tables tables;
+    return tables;
+}
+
+std::atomic<sRGB_Mode> Current_sRGB_Mode { sRGB_Mode::LUT4096 };
+
+// Find the largest per pixel sum of squared channel differences
+// that satisfies sum / channels <= max_mse exactly the same way
+// as Pixel_MSE and ThresholdPrecision do the comparison.
+// Returns -1 if no difference (not even 0) satisfies the threshold.
+int ComputeMaxPixelSSE(double max_mse, unsigned channels) noexcept
+{
+    if (!(max_mse >= 0.0))
+        return -1;
+    const int limit = 255 * 255 * static_cast<int>(channels);
+    if (max_mse * channels >= limit)
+        return limit;
+
+    int sse = static_cast<int>(max_mse * channels);
+    while (sse < limit && (sse + 1) / static_cast<double>(channels) <= max_mse)
+        ++sse;
+    while (sse >= 0 && sse / static_cast<double>(channels) > max_mse)
+        --sse;
+    return sse;
+}
+
+inline u8 MulDiv255(unsigned value, unsigned alpha) noexcept
+{
+    // round(value * alpha / 255)
+    return static_cast<u8>((value * alpha + 127) / 255);
+}
+
+inline int PixelSSE(const Pixel_A& lhs, const Pixel_A& rhs) noexcept
+{
+    const int r = static_cast<int>(lhs.r) - static_cast<int>(rhs.r);
+    return r*r;
+}
+inline int PixelSSE(const Pixel_RGB& lhs, const Pixel_RGB& rhs) noexcept
+{
+    const int r = static_cast<int>(lhs.r) - static_cast<int>(rhs.r);
+    const int g = static_cast<int>(lhs.g) - static_cast<int>(rhs.g);
+    const int b = static_cast<int>(lhs.b) - static_cast<int>(rhs.b);
+    return r*r + g*g + b*b;
+}
+inline int PixelSSE(const Pixel_RGBA& lhs, const Pixel_RGBA& rhs) noexcept
+{
+    const int r = static_cast<int>(lhs.r) - static_cast<int>(rhs.r);
+    const int g = static_cast<int>(lhs.g) - static_cast<int>(rhs.g);
+    const int b = static_cast<int>(lhs.b) - static_cast<int>(rhs.b);
+    const int a = static_cast<int>(lhs.a) - static_cast<int>(rhs.a);
+    return r*r + g*g + b*b + a*a;
+}
+
+// scalar kernels. these also take care of the tails of the
+// spans that the SIMD kernels don't process.
+
+void BitwiseAnd_Scalar(u8* dst, const u8* src, std::size_t bytes) noexcept
+{
+    for (std::size_t i=0; i<bytes; ++i)
+        dst[i] &= src[i];
+}
+void BitwiseOr_Scalar(u8* dst, const u8* src, std::size_t bytes) noexcept
+{
+    for (std::size_t i=0; i<bytes; ++i)
+        dst[i] |= src[i];
+}
+void RGB_to_RGBA_Scalar(Pixel_RGBA* dst, const Pixel_RGB* src, std::size_t count) noexcept
+{
+    for (std::size_t i=0; i<count; ++i)
+    {
+        dst[i].r = src[i].r;
+        dst[i].g = src[i].g;
+        dst[i].b = src[i].b;
+        dst[i].a = 0xff;
+    }
+}
+void RGBA_to_RGB_Scalar(Pixel_RGB* dst, const Pixel_RGBA* src, std::size_t count) noexcept
+{
+    for (std::size_t i=0; i<count; ++i)
+    {
+        dst[i].r = src[i].r;
+        dst[i].g = src[i].g;
+        dst[i].b = src[i].b;
+    }
+}
+void PremulAlpha_Scalar(Pixel_RGBA* dst, const Pixel_RGBA* src, std::size_t count) noexcept
+{
+    for (std::size_t i=0; i<count; ++i)
+    {
+        const auto pixel = src[i];
+        dst[i].r = MulDiv255(pixel.r, pixel.a);
+        dst[i].g = MulDiv255(pixel.g, pixel.a);
+        dst[i].b = MulDiv255(pixel.b, pixel.a);
+        dst[i].a = pixel.a;
+    }
+}
+template<typename Pixel>
+bool Compare_Scalar(const Pixel* lhs, const Pixel* rhs, std::size_t count, int max_sse) noexcept
+{
+    for (std::size_t i=0; i<count; ++i)
+    {
+        if (PixelSSE(lhs[i], rhs[i]) > max_sse)
+            return false;
+    }
+    return true;
+}
+bool Compare_A_Scalar(const Pixel_A* lhs, const Pixel_A* rhs, std::size_t count, int max_sse) noexcept
+{ return Compare_Scalar(lhs, rhs, count, max_sse); }
+bool Compare_RGBA_Scalar(const Pixel_RGBA* lhs, const Pixel_RGBA* rhs, std::size_t count, int max_sse) noexcept
+{ return Compare_Scalar(lhs, rhs, count, max_sse); }
+
+// the largest absolute single channel difference that is within the
+// given squared error.
+unsigned MaxAbsDiff(int max_sse) noexcept
+{
+    unsigned diff = 0;
+    while (diff < 255 && static_cast<int>((diff + 1) * (diff + 1)) <= max_sse)
+        ++diff;
+    return diff;
+}
+
+#if defined(PIXEL_KERNELS_X86)
+
+TARGET_SSE2 void BitwiseAnd_SSE2(u8* dst, const u8* src, std::size_t bytes) noexcept
+{
+    std::size_t i = 0;
+    for (; i + 16 <= bytes; i += 16)
+    {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_and_si128(a, b));
+    }
+    BitwiseAnd_Scalar(dst + i, src + i, bytes - i);
+}
+TARGET_SSE2 void BitwiseOr_SSE2(u8* dst, const u8* src, std::size_t bytes) noexcept
+{
+    std::size_t i = 0;
+    for (; i + 16 <= bytes; i += 16)
+    {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(a, b));
+    }
+    BitwiseOr_Scalar(dst + i, src + i, bytes - i);
+}
+
+// premultiply the 2 pixels in 16bit channels with the alpha.
+TARGET_SSE2 inline __m128i PremulAlpha2_SSE2(__m128i pixels) noexcept
+{
+    const __m128i bias  = _mm_set1_epi16(128);
+    const __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    // (t + (t >> 8)) >> 8 where t = value * alpha + 128 is the
+    // same as rounding value * alpha / 255
+    const __m128i t = _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), bias);
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+TARGET_SSE2 void PremulAlpha_SSE2(Pixel_RGBA* dst, const Pixel_RGBA* src, std::size_t count) noexcept
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha_mask = _mm_set1_epi32(static_cast<int>(0xff000000));
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i lo = PremulAlpha2_SSE2(_mm_unpacklo_epi8(pixels, zero));
+        const __m128i hi = PremulAlpha2_SSE2(_mm_unpackhi_epi8(pixels, zero));
+        const __m128i ret = _mm_packus_epi16(lo, hi);
+        // keep the original alpha.
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+            _mm_or_si128(_mm_andnot_si128(alpha_mask, ret), _mm_and_si128(alpha_mask, pixels)));
+    }
+    PremulAlpha_Scalar(dst + i, src + i, count - i);
+}
+
+TARGET_SSE2 inline __m128i AbsDiff_SSE2(__m128i a, __m128i b) noexcept
+{
+    return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+}
+
+TARGET_SSE2 bool Compare_A_SSE2(const Pixel_A* lhs, const Pixel_A* rhs, std::size_t count, int max_sse) noexcept
+{
+    const auto max_diff = MaxAbsDiff(max_sse);
+    if (max_diff == 255)
+        return true;
+
+    const auto* a = reinterpret_cast<const u8*>(lhs);
+    const auto* b = reinterpret_cast<const u8*>(rhs);
+    const __m128i limit = _mm_set1_epi8(static_cast<char>(max_diff + 1));
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        const __m128i diff = AbsDiff_SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        // diff >= limit
+        const __m128i over = _mm_cmpeq_epi8(_mm_max_epu8(diff, limit), diff);
+        if (_mm_movemask_epi8(over))
+            return false;
+    }
+    return Compare_Scalar(lhs + i, rhs + i, count - i, max_sse);
+}
+
+// compute the sum of squares of the 2 pixels in 16bit channels
+// and compare against the limit.
+TARGET_SSE2 inline int CompareSSE2_SSE2(__m128i diff, __m128i limit) noexcept
+{
+    const __m128i squares = _mm_madd_epi16(diff, diff);
+    const __m128i sums = _mm_add_epi32(squares, _mm_shuffle_epi32(squares, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_movemask_epi8(_mm_cmpgt_epi32(sums, limit));
+}
+
+TARGET_SSE2 bool Compare_RGBA_SSE2(const Pixel_RGBA* lhs, const Pixel_RGBA* rhs, std::size_t count, int max_sse) noexcept
+{
+    const __m128i zero  = _mm_setzero_si128();
+    const __m128i limit = _mm_set1_epi32(max_sse);
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i diff = AbsDiff_SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs + i)),
+                                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs + i)));
+        if (CompareSSE2_SSE2(_mm_unpacklo_epi8(diff, zero), limit) |
+            CompareSSE2_SSE2(_mm_unpackhi_epi8(diff, zero), limit))
+            return false;
+    }
+    return Compare_Scalar(lhs + i, rhs + i, count - i, max_sse);
+}
+
+TARGET_AVX2 void BitwiseAnd_AVX2(u8* dst, const u8* src, std::size_t bytes) noexcept
+{
+    std::size_t i = 0;
+    for (; i + 32 <= bytes; i += 32)
+    {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_and_si256(a, b));
+    }
+    BitwiseAnd_Scalar(dst + i, src + i, bytes - i);
+}
+TARGET_AVX2 void BitwiseOr_AVX2(u8* dst, const u8* src, std::size_t bytes) noexcept
+{
+    std::size_t i = 0;
+    for (; i + 32 <= bytes; i += 32)
+    {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_or_si256(a, b));
+    }
+    BitwiseOr_Scalar(dst + i, src + i, bytes - i);
+}
+
+TARGET_AVX2 void RGB_to_RGBA_AVX2(Pixel_RGBA* dst, const Pixel_RGB* src, std::size_t count) noexcept
+{
+    const auto* bytes = reinterpret_cast<const u8*>(src);
+    // spread 4 RGB pixels (12 bytes) in each 128bit lane into 4 RGBA pixels.
+    const __m256i shuffle = _mm256_setr_epi8(
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xff000000));
+    std::size_t i = 0;
+    // each 16 byte load reads 4 bytes past the 4 pixels. keep the
+    // loads within the span.
+    for (; i + 10 <= count; i += 8)
+    {
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i * 3));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i * 3 + 12));
+        const __m256i pixels = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        const __m256i ret = _mm256_or_si256(_mm256_shuffle_epi8(pixels, shuffle), alpha);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), ret);
+    }
+    RGB_to_RGBA_Scalar(dst + i, src + i, count - i);
+}
+
+TARGET_AVX2 void RGBA_to_RGB_AVX2(Pixel_RGB* dst, const Pixel_RGBA* src, std::size_t count) noexcept
+{
+    auto* bytes = reinterpret_cast<u8*>(dst);
+    // pack 4 RGBA pixels in each 128bit lane into 4 RGB pixels (12 bytes).
+    const __m256i shuffle = _mm256_setr_epi8(
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    std::size_t i = 0;
+    // each 16 byte store writes 4 bytes past the 4 pixels. the bytes
+    // are overwritten by the next store but keep the last store
+    // within the span.
+    for (; i + 10 <= count; i += 8)
+    {
+        const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        const __m256i ret = _mm256_shuffle_epi8(pixels, shuffle);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(bytes + i * 3), _mm256_castsi256_si128(ret));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(bytes + i * 3 + 12), _mm256_extracti128_si256(ret, 1));
+    }
+    RGBA_to_RGB_Scalar(dst + i, src + i, count - i);
+}
+
+TARGET_AVX2 inline __m256i PremulAlpha8_AVX2(__m256i pixels) noexcept
+{
+    const __m256i bias  = _mm256_set1_epi16(128);
+    const __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    const __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(pixels, alpha), bias);
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+TARGET_AVX2 void PremulAlpha_AVX2(Pixel_RGBA* dst, const Pixel_RGBA* src, std::size_t count) noexcept
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha_mask = _mm256_set1_epi32(static_cast<int>(0xff000000));
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        // the unpack and pack work within the 128bit lanes so
+        // the pixel order is preserved.
+        const __m256i lo = PremulAlpha8_AVX2(_mm256_unpacklo_epi8(pixels, zero));
+        const __m256i hi = PremulAlpha8_AVX2(_mm256_unpackhi_epi8(pixels, zero));
+        const __m256i ret = _mm256_packus_epi16(lo, hi);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+            _mm256_or_si256(_mm256_andnot_si256(alpha_mask, ret), _mm256_and_si256(alpha_mask, pixels)));
+    }
+    PremulAlpha_Scalar(dst + i, src + i, count - i);
+}
+
+TARGET_AVX2 inline __m256i AbsDiff_AVX2(__m256i a, __m256i b) noexcept
+{
+    return _mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a));
+}
+
+TARGET_AVX2 bool Compare_A_AVX2(const Pixel_A* lhs, const Pixel_A* rhs, std::size_t count, int max_sse) noexcept
+{
+    const auto max_diff = MaxAbsDiff(max_sse);
+    if (max_diff == 255)
+        return true;
+
+    const auto* a = reinterpret_cast<const u8*>(lhs);
+    const auto* b = reinterpret_cast<const u8*>(rhs);
+    const __m256i limit = _mm256_set1_epi8(static_cast<char>(max_diff + 1));
+    std::size_t i = 0;
+    for (; i + 32 <= count; i += 32)
+    {
+        const __m256i diff = AbsDiff_AVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        const __m256i over = _mm256_cmpeq_epi8(_mm256_max_epu8(diff, limit), diff);
+        if (_mm256_movemask_epi8(over))
+            return false;
+    }
+    return Compare_Scalar(lhs + i, rhs + i, count - i, max_sse);
+}
+
+TARGET_AVX2 inline int CompareSSE8_AVX2(__m256i diff, __m256i limit) noexcept
+{
+    const __m256i squares = _mm256_madd_epi16(diff, diff);
+    const __m256i sums = _mm256_add_epi32(squares, _mm256_shuffle_epi32(squares, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm256_movemask_epi8(_mm256_cmpgt_epi32(sums, limit));
+}
+
+TARGET_AVX2 bool Compare_RGBA_AVX2(const Pixel_RGBA* lhs, const Pixel_RGBA* rhs, std::size_t count, int max_sse) noexcept
+{
+    const __m256i zero  = _mm256_setzero_si256();
+    const __m256i limit = _mm256_set1_epi32(max_sse);
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256i diff = AbsDiff_AVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i)),
+                                          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i)));
+        if (CompareSSE8_AVX2(_mm256_unpacklo_epi8(diff, zero), limit) |
+            CompareSSE8_AVX2(_mm256_unpackhi_epi8(diff, zero), limit))
+            return false;
+    }
+    return Compare_Scalar(lhs + i, rhs + i, count - i, max_sse);
+}
+
+bool CpuHasSSE2() noexcept
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    return true;
+#elif defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    return false;
+#endif
+}
+
+bool CpuHasAVX2() noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    // check that the OS saves the AVX registers.
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx     = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
+#endif // PIXEL_KERNELS_X86
+
+#if defined(PIXEL_KERNELS_NEON)
+
+inline bool AnyNonZero_NEON(uint8x16_t value) noexcept
+{
+    const uint64x2_t bits = vreinterpretq_u64_u8(value);
+    return (vgetq_lane_u64(bits, 0) | vgetq_lane_u64(bits, 1)) != 0;
+}
+
+void BitwiseAnd_NEON(u8* dst, const u8* src, std::size_t bytes) noexcept
+{
+    std::size_t i = 0;
+    for (; i + 16 <= bytes; i += 16)
+        vst1q_u8(dst + i, vandq_u8(vld1q_u8(dst + i), vld1q_u8(src + i)));
+    BitwiseAnd_Scalar(dst + i, src + i, bytes - i);
+}
+void BitwiseOr_NEON(u8* dst, const u8* src, std::size_t bytes) noexcept
+{
+    std::size_t i = 0;
+    for (; i + 16 <= bytes; i += 16)
+        vst1q_u8(dst + i, vorrq_u8(vld1q_u8(dst + i), vld1q_u8(src + i)));
+    BitwiseOr_Scalar(dst + i, src + i, bytes - i);
+}
+
+void RGB_to_RGBA_NEON(Pixel_RGBA* dst, const Pixel_RGB* src, std::size_t count) noexcept
+{
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        const uint8x16x3_t rgb = vld3q_u8(reinterpret_cast<const u8*>(src + i));
+        uint8x16x4_t rgba;
+        rgba.val[0] = rgb.val[0];
+        rgba.val[1] = rgb.val[1];
+        rgba.val[2] = rgb.val[2];
+        rgba.val[3] = vdupq_n_u8(0xff);
+        vst4q_u8(reinterpret_cast<u8*>(dst + i), rgba);
+    }
+    RGB_to_RGBA_Scalar(dst + i, src + i, count - i);
+}
+
+void RGBA_to_RGB_NEON(Pixel_RGB* dst, const Pixel_RGBA* src, std::size_t count) noexcept
+{
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        const uint8x16x4_t rgba = vld4q_u8(reinterpret_cast<const u8*>(src + i));
+        uint8x16x3_t rgb;
+        rgb.val[0] = rgba.val[0];
+        rgb.val[1] = rgba.val[1];
+        rgb.val[2] = rgba.val[2];
+        vst3q_u8(reinterpret_cast<u8*>(dst + i), rgb);
+    }
+    RGBA_to_RGB_Scalar(dst + i, src + i, count - i);
+}
+
+inline uint8x8_t MulDiv255_NEON(uint8x8_t value, uint8x8_t alpha) noexcept
+{
+    // x = value * alpha, (x + ((x + 128) >> 8) + 128) >> 8
+    const uint16x8_t x = vmull_u8(value, alpha);
+    return vraddhn_u16(x, vrshrq_n_u16(x, 8));
+}
+inline uint8x16_t MulDiv255_NEON(uint8x16_t value, uint8x16_t alpha) noexcept
+{
+    return vcombine_u8(MulDiv255_NEON(vget_low_u8(value), vget_low_u8(alpha)),
+                       MulDiv255_NEON(vget_high_u8(value), vget_high_u8(alpha)));
+}
+
+void PremulAlpha_NEON(Pixel_RGBA* dst, const Pixel_RGBA* src, std::size_t count) noexcept
+{
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        uint8x16x4_t rgba = vld4q_u8(reinterpret_cast<const u8*>(src + i));
+        rgba.val[0] = MulDiv255_NEON(rgba.val[0], rgba.val[3]);
+        rgba.val[1] = MulDiv255_NEON(rgba.val[1], rgba.val[3]);
+        rgba.val[2] = MulDiv255_NEON(rgba.val[2], rgba.val[3]);
+        vst4q_u8(reinterpret_cast<u8*>(dst + i), rgba);
+    }
+    PremulAlpha_Scalar(dst + i, src + i, count - i);
+}
+
+bool Compare_A_NEON(const Pixel_A* lhs, const Pixel_A* rhs, std::size_t count, int max_sse) noexcept
+{
+    const auto max_diff = MaxAbsDiff(max_sse);
+    if (max_diff == 255)
+        return true;
+
+    const auto* a = reinterpret_cast<const u8*>(lhs);
+    const auto* b = reinterpret_cast<const u8*>(rhs);
+    const uint8x16_t limit = vdupq_n_u8(static_cast<u8>(max_diff));
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        const uint8x16_t diff = vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+        if (AnyNonZero_NEON(vcgtq_u8(diff, limit)))
+            return false;
+    }
+    return Compare_Scalar(lhs + i, rhs + i, count - i, max_sse);
+}
+
+inline uint32x4_t SumSquares_NEON(uint16x4_t r, uint16x4_t g, uint16x4_t b, uint16x4_t a) noexcept
+{
+    return vaddw_u16(vaddw_u16(vaddl_u16(r, g), b), a);
+}
+
+bool Compare_RGBA_NEON(const Pixel_RGBA* lhs, const Pixel_RGBA* rhs, std::size_t count, int max_sse) noexcept
+{
+    const uint32x4_t limit = vdupq_n_u32(static_cast<unsigned>(max_sse));
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        const uint8x16x4_t a = vld4q_u8(reinterpret_cast<const u8*>(lhs + i));
+        const uint8x16x4_t b = vld4q_u8(reinterpret_cast<const u8*>(rhs + i));
+        uint16x8_t lo[4];
+        uint16x8_t hi[4];
+        for (int c=0; c<4; ++c)
+        {
+            const uint8x16_t diff = vabdq_u8(a.val[c], b.val[c]);
+            lo[c] = vmull_u8(vget_low_u8(diff), vget_low_u8(diff));
+            hi[c] = vmull_u8(vget_high_u8(diff), vget_high_u8(diff));
+        }
+        const uint32x4_t s0 = SumSquares_NEON(vget_low_u16(lo[0]), vget_low_u16(lo[1]), vget_low_u16(lo[2]), vget_low_u16(lo[3]));
+        const uint32x4_t s1 = SumSquares_NEON(vget_high_u16(lo[0]), vget_high_u16(lo[1]), vget_high_u16(lo[2]), vget_high_u16(lo[3]));
+        const uint32x4_t s2 = SumSquares_NEON(vget_low_u16(hi[0]), vget_low_u16(hi[1]), vget_low_u16(hi[2]), vget_low_u16(hi[3]));
+        const uint32x4_t s3 = SumSquares_NEON(vget_high_u16(hi[0]), vget_high_u16(hi[1]), vget_high_u16(hi[2]), vget_high_u16(hi[3]));
+        const uint32x4_t over = vorrq_u32(vorrq_u32(vcgtq_u32(s0, limit), vcgtq_u32(s1, limit)),
+                                          vorrq_u32(vcgtq_u32(s2, limit), vcgtq_u32(s3, limit)));
+        if (AnyNonZero_NEON(vreinterpretq_u8_u32(over)))
+            return false;
+    }
+    return Compare_Scalar(lhs + i, rhs + i, count - i, max_sse);
+}
+#endif // PIXEL_KERNELS_NEON
+
+struct PixelKernels {
+    PixelKernelBackend backend;
+    void (*bitwise_and)(u8* dst, const u8* src, std::size_t bytes) noexcept;
+    void (*bitwise_or)(u8* dst, const u8* src, std::size_t bytes) noexcept;
+    void (*rgb_to_rgba)(Pixel_RGBA* dst, const Pixel_RGB* src, std::size_t count) noexcept;
+    void (*rgba_to_rgb)(Pixel_RGB* dst, const Pixel_RGBA* src, std::size_t count) noexcept;
+    void (*premul_alpha)(Pixel_RGBA* dst, const Pixel_RGBA* src, std::size_t count) noexcept;
+    bool (*compare_a)(const Pixel_A* lhs, const Pixel_A* rhs, std::size_t count, int max_sse) noexcept;
+    bool (*compare_rgba)(const Pixel_RGBA* lhs, const Pixel_RGBA* rhs, std::size_t count, int max_sse) noexcept;
+};
+
+constexpr PixelKernels ScalarKernels = {
+    PixelKernelBackend::Scalar,
+    &BitwiseAnd_Scalar,
+    &BitwiseOr_Scalar,
+    &RGB_to_RGBA_Scalar,
+    &RGBA_to_RGB_Scalar,
+    &PremulAlpha_Scalar,
+    &Compare_A_Scalar,
+    &Compare_RGBA_Scalar
+};
+#if defined(PIXEL_KERNELS_X86)
+// SSE2 doesn't have a byte shuffle so the RGB <-> RGBA
+// conversions use the scalar kernels.
+constexpr PixelKernels SSE2Kernels = {
+    PixelKernelBackend::SSE2,
+    &BitwiseAnd_SSE2,
+    &BitwiseOr_SSE2,
+    &RGB_to_RGBA_Scalar,
+    &RGBA_to_RGB_Scalar,
+    &PremulAlpha_SSE2,
+    &Compare_A_SSE2,
+    &Compare_RGBA_SSE2
+};
+constexpr PixelKernels AVX2Kernels = {
+    PixelKernelBackend::AVX2,
+    &BitwiseAnd_AVX2,
+    &BitwiseOr_AVX2,
+    &RGB_to_RGBA_AVX2,
+    &RGBA_to_RGB_AVX2,
+    &PremulAlpha_AVX2,
+    &Compare_A_AVX2,
+    &Compare_RGBA_AVX2
+};
+#endif
+#if defined(PIXEL_KERNELS_NEON)
+constexpr PixelKernels NEONKernels = {
+    PixelKernelBackend::NEON,
+    &BitwiseAnd_NEON,
+    &BitwiseOr_NEON,
+    &RGB_to_RGBA_NEON,
+    &RGBA_to_RGB_NEON,
+    &PremulAlpha_NEON,
+    &Compare_A_NEON,
+    &Compare_RGBA_NEON
+};
+#endif
+
+const PixelKernels* FindKernels(PixelKernelBackend backend) noexcept
+{
+    if (backend == PixelKernelBackend::Scalar)
+        return &ScalarKernels;
+#if defined(PIXEL_KERNELS_X86)
+    if (backend == PixelKernelBackend::SSE2 && CpuHasSSE2())
+        return &SSE2Kernels;
+    if (backend == PixelKernelBackend::AVX2 && CpuHasAVX2())
+        return &AVX2Kernels;
+#endif
+#if defined(PIXEL_KERNELS_NEON)
+    if (backend == PixelKernelBackend::NEON)
+        return &NEONKernels;
+#endif
+    return nullptr;
+}
+
+std::atomic<const PixelKernels*> CurrentKernels { nullptr };
+
+const PixelKernels& GetKernels() noexcept
+{
+    if (const auto* kernels = CurrentKernels.load(std::memory_order_acquire))
+        return *kernels;
+
+    const PixelKernels* kernels = nullptr;
+    for (auto backend : { PixelKernelBackend::AVX2,
+                          PixelKernelBackend::NEON,
+                          PixelKernelBackend::SSE2 })
+    {
+        if ((kernels = FindKernels(backend)))
+            break;
+    }
+    if (kernels == nullptr)
+        kernels = &ScalarKernels;
+
+    // racing threads all select the same kernels.
+    CurrentKernels.store(kernels, std::memory_order_release);
+    return *kernels;
+}
+
+} // namespace
+
+namespace gfx
+{
+
+PixelKernelBackend GetPixelKernelBackend() noexcept
+{
+    return GetKernels().backend;
+}
+
+bool IsPixelKernelBackendSupported(PixelKernelBackend backend) noexcept
+{
+    return FindKernels(backend) != nullptr;
+}
+
+bool SetPixelKernelBackend(PixelKernelBackend backend) noexcept
+{
+    const auto* kernels = FindKernels(backend);
+    if (kernels == nullptr)
+        return false;
+    CurrentKernels.store(kernels, std::memory_order_release);
+    return true;
+}
+
+sRGB_Mode Get_sRGB_Mode() noexcept
+{
+    return Current_sRGB_Mode.load(std::memory_order_relaxed);
+}
+
+void Set_sRGB_Mode(sRGB_Mode mode) noexcept
+{
+    Current_sRGB_Mode.store(mode, std::memory_order_relaxed);
+}
+
+float sRGB_decode_u8(u8 value) noexcept
+{
+    return Get_sRGB_Tables().decode[value];
+}
+
+u8 sRGB_encode_u8(float value) noexcept
+{
+    return Get_sRGB_Tables().Encode(value, Get_sRGB_Mode());
+}
+
+Pixel_RGBAf sRGB_decode_to_floats(const Pixel_RGBA& value) noexcept
+{
+    const auto& tables = Get_sRGB_Tables();
+    Pixel_RGBAf ret;
+    ret.r = tables.decode[value.r];
+    ret.g = tables.decode[value.g];
+    ret.b = tables.decode[value.b];
+    ret.a = value.a / 255.0f;
+    return ret;
+}
+
+Pixel_RGBf sRGB_decode_to_floats(const Pixel_RGB& value) noexcept
+{
+    const auto& tables = Get_sRGB_Tables();
+    Pixel_RGBf ret;
+    ret.r = tables.decode[value.r];
+    ret.g = tables.decode[value.g];
+    ret.b = tables.decode[value.b];
+    return ret;
+}
+
+Pixel_RGBA sRGB_encode_to_uints(const Pixel_RGBAf& value) noexcept
+{
+    const auto& tables = Get_sRGB_Tables();
+    const auto mode = Get_sRGB_Mode();
+    Pixel_RGBA ret;
+    ret.r = tables.Encode(value.r, mode);
+    ret.g = tables.Encode(value.g, mode);
+    ret.b = tables.Encode(value.b, mode);
+    ret.a = static_cast<u8>(value.a * 255);
+    return ret;
+}
+
+Pixel_RGB sRGB_encode_to_uints(const Pixel_RGBf& value) noexcept
+{
+    const auto& tables = Get_sRGB_Tables();
+    const auto mode = Get_sRGB_Mode();
+    Pixel_RGB ret;
+    ret.r = tables.Encode(value.r, mode);
+    ret.g = tables.Encode(value.g, mode);
+    ret.b = tables.Encode(value.b, mode);
+    return ret;
+}
+
+void PixelSpan_BitwiseAnd(u8* dst, const u8* src, std::size_t bytes) noexcept
+{
+    GetKernels().bitwise_and(dst, src, bytes);
+}
+
+void PixelSpan_BitwiseOr(u8* dst, const u8* src, std::size_t bytes) noexcept
+{
+    GetKernels().bitwise_or(dst, src, bytes);
+}
+
+void PixelSpan_Convert(Pixel_RGBA* dst, const Pixel_RGB* src, std::size_t count) noexcept
+{
+    GetKernels().rgb_to_rgba(dst, src, count);
+}
+
+void PixelSpan_Convert(Pixel_RGB* dst, const Pixel_RGBA* src, std::size_t count) noexcept
+{
+    GetKernels().rgba_to_rgb(dst, src, count);
+}
+
+void PixelSpan_PremulAlpha(Pixel_RGBA* dst, const Pixel_RGBA* src, std::size_t count, bool srgb) noexcept
+{
+    if (!srgb)
+    {
+        GetKernels().premul_alpha(dst, src, count);
+        return;
+    }
+
+    // the sRGB transforms are table lookups which don't vectorize
+    // without gathers so this is the same for every backend.
+    const auto& tables = Get_sRGB_Tables();
+    const auto mode = Get_sRGB_Mode();
+    for (std::size_t i=0; i<count; ++i)
+    {
+        const auto pixel = src[i];
+        const auto alpha = pixel.a / 255.0f;
+        dst[i].r = tables.Encode(tables.decode[pixel.r] * alpha, mode);
+        dst[i].g = tables.Encode(tables.decode[pixel.g] * alpha, mode);
+        dst[i].b = tables.Encode(tables.decode[pixel.b] * alpha, mode);
+        dst[i].a = pixel.a;
+    }
+}
+
+void PixelSpan_sRGB_decode(Pixel_RGBA* dst, const Pixel_RGBA* src, std::size_t count) noexcept
+{
+    const auto& tables = Get_sRGB_Tables();
+    for (std::size_t i=0; i<count; ++i)
+    {
+        const auto pixel = src[i];
+        dst[i].r = tables.decode_u8[pixel.r];
+        dst[i].g = tables.decode_u8[pixel.g];
+        dst[i].b = tables.decode_u8[pixel.b];
+        dst[i].a = pixel.a;
+    }
+}
+
+void PixelSpan_sRGB_decode(Pixel_RGB* dst, const Pixel_RGB* src, std::size_t count) noexcept
+{
+    const auto& tables = Get_sRGB_Tables();
+    for (std::size_t i=0; i<count; ++i)
+    {
+        const auto pixel = src[i];
+        dst[i].r = tables.decode_u8[pixel.r];
+        dst[i].g = tables.decode_u8[pixel.g];
+        dst[i].b = tables.decode_u8[pixel.b];
+    }
+}
+
+bool PixelSpan_Compare(const Pixel_A* lhs, const Pixel_A* rhs, std::size_t count, double max_mse) noexcept
+{
+    const auto max_sse = ComputeMaxPixelSSE(max_mse, 1);
+    if (max_sse < 0)
+        return count == 0;
+    return GetKernels().compare_a(lhs, rhs, count, max_sse);
+}
+
+bool PixelSpan_Compare(const Pixel_RGB* lhs, const Pixel_RGB* rhs, std::size_t count, double max_mse) noexcept
+{
+    // 3 byte pixels don't map nicely to the SIMD registers and
+    // comparing RGB bitmaps is rare enough to not matter.
+    const auto max_sse = ComputeMaxPixelSSE(max_mse, 3);
+    if (max_sse < 0)
+        return count == 0;
+    return Compare_Scalar(lhs, rhs, count, max_sse);
+}
+
+bool PixelSpan_Compare(const Pixel_RGBA* lhs, const Pixel_RGBA* rhs, std::size_t count, double max_mse) noexcept
+{
+    const auto max_sse = ComputeMaxPixelSSE(max_mse, 4);
+    if (max_sse < 0)
+        return count == 0;
+    return GetKernels().compare_rgba(lhs, rhs, count, max_sse);
+}
+
+} // namespace
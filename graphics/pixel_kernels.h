@@ -0,0 +1,113 @@
+// Copyright (C) 2020-2025 Sami Väisänen
+// Copyright (C) 2020-2025 Ensisoft http://www.ensisoft.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "config.h"
+
+#include <cstddef>
+
+#include "graphics/pixel.h"
+
+// Pixel kernels process spans of contiguous pixels at once. They're
+// the building blocks for the bitmap algorithms that work on entire
+// bitmap rows instead of single pixels. Every kernel has a scalar
+// implementation and the kernels that benefit from it have SIMD
+// implementations (SSE2, AVX2 and NEON) that are selected at runtime
+// based on the capabilities of the CPU. All the backends produce
+// bit exact same results.
+//
+// Unless otherwise noted the destination and source spans may be
+// the same span (in-place processing) but must not otherwise overlap.
+
+namespace gfx
+{
+    enum class PixelKernelBackend {
+        Scalar, SSE2, AVX2, NEON
+    };
+
+    // Get the backend that is currently used by the pixel kernels.
+    // By default, the best backend supported by the CPU is used.
+    PixelKernelBackend GetPixelKernelBackend() noexcept;
+    // Check whether the given backend is supported by the build
+    // target and the CPU.
+    bool IsPixelKernelBackendSupported(PixelKernelBackend backend) noexcept;
+    // Select the backend to use. This is mostly useful for testing
+    // and benchmarking. Returns false if the backend isn't supported.
+    bool SetPixelKernelBackend(PixelKernelBackend backend) noexcept;
+
+    // The sRGB mode controls how normalized linear values are encoded
+    // into 8bit sRGB values. Decoding 8bit sRGB values is always done
+    // with a 256 entry table since that gives the exact result.
+    enum class sRGB_Mode {
+        // Compute the encoding with the exact sRGB transfer function.
+        Exact,
+        // Use a 256 entry table indexed by the linear value. Fastest and
+        // smallest but loses precision in the dark values where the sRGB
+        // curve is steep, the error can be several 8bit steps.
+        LUT256,
+        // Use a 4096 entry table indexed by the linear value. The result
+        // is at most one 8bit step off from the exact encoding.
+        LUT4096
+    };
+    // Get the current sRGB mode. The default is LUT4096.
+    sRGB_Mode Get_sRGB_Mode() noexcept;
+    // Set the sRGB mode to use for all subsequent sRGB encoding.
+    void Set_sRGB_Mode(sRGB_Mode mode) noexcept;
+
+    // Decode an 8bit sRGB encoded value into a normalized linear value.
+    float sRGB_decode_u8(u8 value) noexcept;
+    // Encode a normalized linear value into an 8bit sRGB value according
+    // to the current sRGB mode. The value is clamped to [0.0f, 1.0f].
+    u8 sRGB_encode_u8(float value) noexcept;
+    // Decode the color channels of an 8bit sRGB pixel into normalized
+    // linear floats. Alpha is only normalized.
+    Pixel_RGBAf sRGB_decode_to_floats(const Pixel_RGBA& value) noexcept;
+    Pixel_RGBf sRGB_decode_to_floats(const Pixel_RGB& value) noexcept;
+    // Encode the color channels of a normalized linear pixel into 8bit
+    // sRGB values. Alpha is only converted to 8bits.
+    Pixel_RGBA sRGB_encode_to_uints(const Pixel_RGBAf& value) noexcept;
+    Pixel_RGB sRGB_encode_to_uints(const Pixel_RGBf& value) noexcept;
+
+    // dst = dst & src for each byte.
+    void PixelSpan_BitwiseAnd(u8* dst, const u8* src, std::size_t bytes) noexcept;
+    // dst = dst | src for each byte.
+    void PixelSpan_BitwiseOr(u8* dst, const u8* src, std::size_t bytes) noexcept;
+
+    // Convert between RGB and RGBA pixels. Converting to RGBA sets alpha
+    // to fully opaque and converting to RGB drops the alpha channel.
+    void PixelSpan_Convert(Pixel_RGBA* dst, const Pixel_RGB* src, std::size_t count) noexcept;
+    void PixelSpan_Convert(Pixel_RGB* dst, const Pixel_RGBA* src, std::size_t count) noexcept;
+
+    // Premultiply the color channels with the alpha channel. If the pixels
+    // are sRGB encoded the color channels are decoded into linear before the
+    // multiplication and encoded back into sRGB according to the sRGB mode.
+    // The linear multiplication is rounded to the nearest 8bit value.
+    void PixelSpan_PremulAlpha(Pixel_RGBA* dst, const Pixel_RGBA* src, std::size_t count, bool srgb) noexcept;
+
+    // Decode the color channels of 8bit sRGB pixels into 8bit linear values.
+    // Alpha is copied as-is.
+    void PixelSpan_sRGB_decode(Pixel_RGBA* dst, const Pixel_RGBA* src, std::size_t count) noexcept;
+    void PixelSpan_sRGB_decode(Pixel_RGB* dst, const Pixel_RGB* src, std::size_t count) noexcept;
+
+    // Compare the pixels pair wise and return true if the mean squared error
+    // of every pixel pair is within the given maximum. This gives the same
+    // result as comparing every pixel with PixelEquality::ThresholdPrecision.
+    bool PixelSpan_Compare(const Pixel_A* lhs, const Pixel_A* rhs, std::size_t count, double max_mse) noexcept;
+    bool PixelSpan_Compare(const Pixel_RGB* lhs, const Pixel_RGB* rhs, std::size_t count, double max_mse) noexcept;
+    bool PixelSpan_Compare(const Pixel_RGBA* lhs, const Pixel_RGBA* rhs, std::size_t count, double max_mse) noexcept;
+
+} // namespace
@@ -51,6 +51,7 @@ namespace gfx
             const Texture* texture = nullptr;
         };
         using Uniform = dev::Uniform;
+        using UniformName = dev::UniformName;
 
         template<typename T>
         inline void SetUniformBlock(std::string name, UniformBlockData<T>&& uniform_data)
@@ -74,79 +75,79 @@ namespace gfx
             mUniformBlocks.push_back(block);
         }
 
-        inline void SetUniform(const char* name, unsigned x)
+        inline void SetUniform(UniformName name, unsigned x)
         {
             mUniforms.push_back({ name, x, });
         }
-        inline void SetUniform(const char* name, unsigned x, unsigned y)
+        inline void SetUniform(UniformName name, unsigned x, unsigned y)
         {
             mUniforms.push_back({ name, glm::uvec2{ x, y} });
         }
-        inline void SetUniform(const char* name, unsigned x, unsigned y, unsigned z)
+        inline void SetUniform(UniformName name, unsigned x, unsigned y, unsigned z)
         {
             mUniforms.push_back({ name, glm::uvec3{ x, y, z} });
         }
-        inline void SetUniform(const char* name, unsigned x, unsigned y, unsigned z, unsigned w)
+        inline void SetUniform(UniformName name, unsigned x, unsigned y, unsigned z, unsigned w)
         {
             mUniforms.push_back({ name, glm::uvec4{ x, y, z, w} });
         }
 
         // Set scalar uniform.
 
-        inline void SetUniform(const char* name, int x)
+        inline void SetUniform(UniformName name, int x)
         {
             mUniforms.push_back({ name, x });
         }
-        inline void SetUniform(const char* name, int x, int y)
+        inline void SetUniform(UniformName name, int x, int y)
         {
             mUniforms.push_back({ name, glm::ivec2{x, y} });
         }
-        inline void SetUniform(const char* name, int x, int y, int z)
+        inline void SetUniform(UniformName name, int x, int y, int z)
         {
             mUniforms.push_back({ name, glm::ivec3{x, y, z} });
         }
-        inline void SetUniform(const char* name, int x, int y, int z, int w)
+        inline void SetUniform(UniformName name, int x, int y, int z, int w)
         {
             mUniforms.push_back({ name, glm::ivec4{x, y, z, w} });
         }
 
         // Set scalar uniform.
-        inline void SetUniform(const char* name, float x)
+        inline void SetUniform(UniformName name, float x)
         {
             mUniforms.push_back({ name, x });
         }
         // Set vec2 uniform.
-        inline void SetUniform(const char* name, float x, float y)
+        inline void SetUniform(UniformName name, float x, float y)
         {
             mUniforms.push_back({ name, glm::vec2{x, y} });
         }
         // Set vec3 uniform.
-        inline void SetUniform(const char* name, float x, float y, float z)
+        inline void SetUniform(UniformName name, float x, float y, float z)
         {
             mUniforms.push_back({ name, glm::vec3{x, y, z} });
         }
         // Set vec4 uniform.
-        inline void SetUniform(const char* name, float x, float y, float z, float w)
+        inline void SetUniform(UniformName name, float x, float y, float z, float w)
         {
             mUniforms.push_back({ name, glm::vec4{x, y, z, w} });
         }
         // set Color uniform
-        inline void SetUniform(const char* name, const Color4f& color)
+        inline void SetUniform(UniformName name, const Color4f& color)
         {
             mUniforms.push_back({name, color});
         }
 
-        inline void SetUniform(const char* name, const glm::vec2& vector)
+        inline void SetUniform(UniformName name, const glm::vec2& vector)
         {
             mUniforms.push_back({name, vector});
         }
 
-        inline void SetUniform(const char* name, const glm::vec3& vector)
+        inline void SetUniform(UniformName name, const glm::vec3& vector)
         {
             mUniforms.push_back({name, vector});
         }
 
-        inline void SetUniform(const char* name, const glm::vec4& vector)
+        inline void SetUniform(UniformName name, const glm::vec4& vector)
         {
             mUniforms.push_back({name, vector});
         }
@@ -160,17 +161,17 @@ namespace gfx
         // Y vector followed by the Z vector.
 
         // set 2x2 matrix uniform.
-        inline void SetUniform(const char* name, const glm::mat2& matrix)
+        inline void SetUniform(UniformName name, const glm::mat2& matrix)
         {
             mUniforms.push_back({name, matrix });
         }
         // Set 3x3 matrix uniform.
-        inline void SetUniform(const char* name, const glm::mat3& matrix)
+        inline void SetUniform(UniformName name, const glm::mat3& matrix)
         {
             mUniforms.push_back({name, matrix });
         }
         // Set 4x4 matrix uniform.
-        inline void SetUniform(const char* name, const glm::mat4& matrix)
+        inline void SetUniform(UniformName name, const glm::mat4& matrix)
         {
             mUniforms.push_back({name, matrix });
         }
@@ -266,7 +267,7 @@ namespace gfx
         }
 
         template<typename T>
-        bool GetUniform(const char* name, T* value) noexcept
+        bool GetUniform(UniformName name, T* value) noexcept
         {
             for (const auto& u : mUniforms)
             {
@@ -278,7 +279,7 @@ namespace gfx
             }
             return false;
         }
-        inline bool HasUniform(const char* name) noexcept
+        inline bool HasUniform(UniformName name) noexcept
         {
             for (const auto& u : mUniforms)
             {
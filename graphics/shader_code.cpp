@@ -112,6 +112,10 @@ namespace gfx::glsl {
 #include "shaders/fragment_text_texture_shader.glsl"
     };
 
+    const char* fragment_distance_field_text_shader = {
+#include "shaders/fragment_text_distance_field_shader.glsl"
+    };
+
     const char* fragment_texture_functions =  {
 #include "shaders/fragment_texture_functions.glsl"
     };
@@ -47,6 +47,7 @@ extern const char* fragment_particle_2d_shader;
 extern const char* fragment_basic_light_shader;
 extern const char* fragment_bitmap_text_shader;
 extern const char* fragment_texture_text_shader;
+extern const char* fragment_distance_field_text_shader;
 
 // fragment utility
 extern const char* fragment_texture_functions;
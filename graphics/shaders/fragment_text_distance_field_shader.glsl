@@ -0,0 +1,32 @@
+R"CPP_RAW_STRING(//"
+// Copyright (c) 2020-2025 Sami Väisänen
+// signed distance field text shader
+
+#version 300 es
+
+// @uniforms
+
+uniform uint kMaterialFlags;
+uniform vec4 kColor;
+uniform sampler2D kTexture;
+
+// @varyings
+in vec2 vTexCoord;
+
+// @code
+
+void FragmentShaderMain() {
+   // the glyph edge is at 0.5 and the distance increases towards
+   // the inside of the glyph. use the screen space rate of change
+   // of the distance to antialias the edge over roughly one pixel
+   // regardless of the scale of the text.
+   float distance = texture(kTexture, vTexCoord).a;
+   float width = max(fwidth(distance) * 0.7, 0.0001);
+   float alpha = smoothstep(0.5 - width, 0.5 + width, distance);
+   vec4 color = vec4(kColor.r, kColor.g, kColor.b, kColor.a * alpha);
+   fs_out.color = color;
+   fs_out.flags = kMaterialFlags;
+}
+
+
+)CPP_RAW_STRING"
\ No newline at end of file
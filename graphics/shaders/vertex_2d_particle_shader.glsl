@@ -12,6 +12,7 @@ R"CPP_RAW_STRING(//"
 in vec2 aPosition;
 // per particle data:
 // x = particle size to point rasterizer (gl_PointSize)
+//     or the particle quad size in world units
 // y = particle random value
 // z = particle alpha / transparency
 // w = particle lifetime as a fraction of maximum lifetime
@@ -20,6 +21,14 @@ in vec4 aData;
 // particle direction vector
 in vec2 aDirection;
 
+#ifdef PARTICLE_QUADS
+// quad corner relative to the particle position in particle
+// size units, i.e. [-0.5, 0.5]. With instanced drawing this is
+// the only per vertex attribute and the particle attributes
+// above are per instance.
+in vec2 aCorner;
+#endif
+
 // these should be in the base_vertex_shader.glsl but alas
 // it seems that if these are defined *before* the non-instanced
 // attributes we have some weird problems, the graphics_test app
@@ -39,15 +48,20 @@ in vec2 aDirection;
 uniform mat4 kProjectionMatrix;
 uniform mat4 kModelViewMatrix;
 
+#ifdef PARTICLE_QUADS
+// maps the quad corner from world units to view units.
+uniform mat2 kParticleQuadMatrix;
+#endif
+
 // @varyings
 out float vParticleRandomValue;
 out float vParticleAlpha;
 out float vParticleTime;
 out float vParticleAngle;
 
-// this is a dummy we don't currently support
-// vertex based texture coordinates for any
-// particle geometry (lines)
+// texture coordinates for particle quads. this is a
+// dummy for lines since we don't currently support
+// vertex based texture coordinates for lines.
 out vec2 vTexCoord;
 
 void VertexShaderMain() {
@@ -66,14 +80,25 @@ void VertexShaderMain() {
     vParticleAlpha       = aData.z;
     vParticleTime        = aData.w;
 
+#ifdef PARTICLE_QUADS
+    // same mapping as with gl_PointCoord when drawing points
+    vTexCoord = aCorner + vec2(0.5, 0.5);
+#else
     // dummy out
     vTexCoord = vec2(0.0, 0.0);
+#endif
 
     // base vertex shader
     mat4 model_inst_matrix = GetInstanceTransform();
     mat4 model_view_matrix = kModelViewMatrix * model_inst_matrix;
     vec4 view_position = model_view_matrix * vertex;
 
+#ifdef PARTICLE_QUADS
+    // expand the quad around the particle position.
+    // the particle size is in world units.
+    view_position.xy += kParticleQuadMatrix * (aCorner * aData.x);
+#endif
+
     vs_out.view_position = view_position;
     vs_out.clip_position = kProjectionMatrix * view_position;
     vs_out.point_size    = aData.x;
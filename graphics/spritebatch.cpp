@@ -0,0 +1,143 @@
+// Copyright (C) 2020-2024 Sami Väisänen
+// Copyright (C) 2020-2024 Ensisoft http://www.ensisoft.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "config.h"
+
+#include "warnpush.h"
+#  include <glm/vec4.hpp>
+#include "warnpop.h"
+
+#include <iterator>
+
+#include "base/assert.h"
+#include "graphics/spritebatch.h"
+#include "graphics/simple_shape.h"
+#include "graphics/shader_source.h"
+#include "graphics/program.h"
+#include "graphics/geometry.h"
+#include "graphics/enum.h"
+
+namespace gfx
+{
+
+void SpriteBatch::AddSprite(const glm::mat4& model)
+{
+    // the 2D shapes are laid out in the negative Y axis in the model
+    // space and the vertex shader flips the Y before transforming.
+    // So transform the flipped rectangle corners and then flip the
+    // result back in order to have the vertex shader produce the
+    // right world position with an identity model transform.
+    const auto& top_left  = model * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    const auto& bot_left  = model * glm::vec4(0.0f, 1.0f, 0.0f, 1.0f);
+    const auto& bot_right = model * glm::vec4(1.0f, 1.0f, 0.0f, 1.0f);
+    const auto& top_right = model * glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+
+    const Vertex2D verts[6] = {
+        { {top_left.x,  -top_left.y},  {0.0f, 0.0f} },
+        { {bot_left.x,  -bot_left.y},  {0.0f, 1.0f} },
+        { {bot_right.x, -bot_right.y}, {1.0f, 1.0f} },
+
+        { {top_left.x,  -top_left.y},  {0.0f, 0.0f} },
+        { {bot_right.x, -bot_right.y}, {1.0f, 1.0f} },
+        { {top_right.x, -top_right.y}, {1.0f, 0.0f} }
+    };
+    mVertices.insert(mVertices.end(), std::begin(verts), std::end(verts));
+}
+
+// static
+bool SpriteBatch::CanBatch(const Drawable& drawable) noexcept
+{
+    if (const auto* shape = dynamic_cast<const SimpleShapeInstance*>(&drawable))
+        return shape->GetShape() == SimpleShapeType::Rectangle &&
+               shape->GetStyle() == SimpleShapeStyle::Solid;
+    if (const auto* shape = dynamic_cast<const SimpleShape*>(&drawable))
+        return shape->GetShape() == SimpleShapeType::Rectangle &&
+               shape->GetStyle() == SimpleShapeStyle::Solid;
+    return false;
+}
+
+bool SpriteBatch::ApplyDynamicState(const Environment& env, Device&, ProgramState& program, RasterState& state) const
+{
+    unsigned flags = 0;
+    if (env.flip_uv_horizontally)
+        flags |= static_cast<unsigned>(DrawableFlags::Flip_UV_Horizontally);
+    if (env.flip_uv_vertically)
+        flags |= static_cast<unsigned>(DrawableFlags::Flip_UV_Vertically);
+
+    // the vertices are already in the world space so the model
+    // matrix should be identity.
+    program.SetUniform("kProjectionMatrix", *env.proj_matrix);
+    program.SetUniform("kModelViewMatrix", *env.view_matrix * *env.model_matrix);
+    program.SetUniform("kDrawableFlags", flags);
+    return true;
+}
+
+ShaderSource SpriteBatch::GetShader(const Environment& env, const Device& device) const
+{
+    ASSERT(env.mesh_type == MeshType::NormalRenderMesh);
+    ASSERT(env.use_instancing == false);
+
+    return Drawable::CreateShader(env, device, Shader::Simple2D);
+}
+
+std::string SpriteBatch::GetShaderId(const Environment& env) const
+{
+    return Drawable::GetShaderId(env, Shader::Simple2D);
+}
+
+std::string SpriteBatch::GetShaderName(const Environment& env) const
+{
+    return Drawable::GetShaderName(env, Shader::Simple2D);
+}
+
+std::string SpriteBatch::GetGeometryId(const Environment& env) const
+{
+    return "sprite-batch-2d";
+}
+
+bool SpriteBatch::Construct(const Environment& env, Device&, Geometry::CreateArgs& create) const
+{
+    create.content_name = "2D Sprite Batch";
+    create.usage = Geometry::Usage::Stream;
+    auto& geometry = create.buffer;
+
+    geometry.SetVertexBuffer(mVertices);
+    geometry.SetVertexLayout(GetVertexLayout<Vertex2D>());
+    geometry.AddDrawCmd(Geometry::DrawType::Triangles);
+    return true;
+}
+
+Drawable::DrawPrimitive SpriteBatch::GetDrawPrimitive() const
+{
+    return DrawPrimitive::Triangles;
+}
+
+SpatialMode SpriteBatch::GetSpatialMode() const
+{
+    return SpatialMode::Flat2D;
+}
+
+Drawable::Usage SpriteBatch::GetGeometryUsage() const
+{
+    return Usage::Stream;
+}
+
+Drawable::Type SpriteBatch::GetType() const
+{
+    return Type::Other;
+}
+
+} // namespace
@@ -0,0 +1,71 @@
+// Copyright (C) 2020-2024 Sami Väisänen
+// Copyright (C) 2020-2024 Ensisoft http://www.ensisoft.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "config.h"
+
+#include "warnpush.h"
+#  include <glm/mat4x4.hpp>
+#include "warnpop.h"
+
+#include <vector>
+
+#include "graphics/drawable.h"
+#include "graphics/vertex.h"
+
+namespace gfx
+{
+    // Batch of 2D rectangles (sprites) drawn with a single draw call.
+    // The sprite vertices are transformed on the CPU from the model
+    // space into the world space so the batch itself is drawn with
+    // an identity model transform. Only sprites that share the same
+    // material state and draw state can go into the same batch.
+    class SpriteBatch : public Drawable
+    {
+    public:
+        SpriteBatch() = default;
+
+        // Add a rectangle with the given model to world transform.
+        void AddSprite(const glm::mat4& model);
+
+        // Check whether the drawable can be drawn as a sprite in
+        // a sprite batch. I.e. it's a solid 2D rectangle.
+        static bool CanBatch(const Drawable& drawable) noexcept;
+
+        inline std::size_t GetNumSprites() const noexcept
+        { return mVertices.size() / 6; }
+        inline bool IsEmpty() const noexcept
+        { return mVertices.empty(); }
+        inline void Clear() noexcept
+        { mVertices.clear(); }
+
+        bool ApplyDynamicState(const Environment& environment, Device& device, ProgramState& program, RasterState& state) const override;
+        ShaderSource GetShader(const Environment& environment, const Device& device) const override;
+        std::string GetShaderId(const Environment& environment) const override;
+        std::string GetShaderName(const Environment& environment) const override;
+        std::string GetGeometryId(const Environment& environment) const override;
+        bool Construct(const Environment& environment, Device&, Geometry::CreateArgs& create) const override;
+
+        DrawPrimitive GetDrawPrimitive() const override;
+        SpatialMode GetSpatialMode() const override;
+        Usage GetGeometryUsage() const override;
+        Type GetType() const override;
+    private:
+        std::vector<Vertex2D> mVertices;
+    };
+
+} // namespace
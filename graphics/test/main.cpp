@@ -4528,9 +4528,7 @@ int main(int argc, char* argv[])
     gfx::EffectDrawable::SetRandomGenerator([&rg](float min, float max) {
         return rg(min, max);
     });
-    gfx::ParticleEngineClass::SetRandomGenerator([&rg](float min, float max) {
-        return rg(min, max);
-    });
+    gfx::ParticleEngineClass::SetRandomSeed(0xdeadbeef);
 
     std::size_t test_index = 0;
     std::vector<std::unique_ptr<GraphicsTest>> tests;
@@ -22,6 +22,7 @@
 #  include <ft2build.h>
 #  include FT_FREETYPE_H
 #  include FT_SIZES_H
+#  include FT_OUTLINE_H
 #  include <nlohmann/json.hpp>
 #  include <glm/glm.hpp>
 #  include <glm/mat4x4.hpp>
@@ -30,11 +31,16 @@
 
 #include <functional>
 #include <stdexcept>
-#include <map>
 #include <unordered_map>
+#include <fstream>
+#include <limits>
+#include <cmath>
+#include <cstring>
 #include <cwctype>
 
 #include "base/logging.h"
+#include "base/format.h"
+#include "base/math.h"
 #include "base/utility.h"
 #include "base/json.h"
 #include "data/reader.h"
@@ -140,6 +146,558 @@ const auto EFFIN_MAGIC_SCALE = 64;
 using gfx::Bitmap;
 using gfx::Pixel_A;
 
+struct Glyph {
+    // the font specific glyph index
+    unsigned index  = 0;
+    unsigned width  = 0;
+    unsigned height = 0;
+    // bearing X (left side bearing) is the horizontal distance from the current pen position
+    // to the glyph's left edge (the left edge of its bounding box)
+    int bearing_x = 0;
+    // bearing Y (top side bearing) is the vertical distance from the baseline to the top of glyph
+    // (to the top of its bounding box)
+    int bearing_y = 0;
+    gfx::AlphaMask bitmap;
+    // the position of the glyph in the glyph atlas. only valid when
+    // the atlas generation matches the current atlas generation.
+    unsigned atlas_x = 0;
+    unsigned atlas_y = 0;
+    std::size_t atlas_generation = 0;
+};
+
+// A font face with a particular pixel size. Creating the FreeType face
+// and the HarfBuzz font are expensive, so they're cached and re-used
+// together with the rasterized glyphs.
+struct FontFace {
+    std::shared_ptr<const gfx::Resource> data;
+    FT_Face face = nullptr;
+    hb_font_t* font = nullptr;
+    std::unordered_map<unsigned, Glyph> glyphs;
+
+    FontFace() = default;
+    FontFace(const FontFace&) = delete;
+   ~FontFace()
+    {
+        // destroy the hb font first since it refers to the face.
+        if (font)
+            hb_font_destroy(font);
+        if (face)
+            FT_Done_Face(face);
+    }
+    FontFace& operator=(const FontFace&) = delete;
+};
+
+// Find a cached font face or load a new one. Returns nullptr if the font
+// can't be loaded. Note that just like the rest of the text rasterization
+// this is not thread safe.
+FontFace* FindFontFace(const std::string& font, unsigned font_size)
+{
+    static FontLibrary freetype;
+    static std::unordered_map<std::string, std::unique_ptr<FontFace>> face_cache;
+    static std::unordered_map<std::string, std::shared_ptr<const gfx::Resource>> font_cache;
+
+    const auto& key = font + "@" + std::to_string(font_size);
+    auto it = face_cache.find(key);
+    if (it != face_cache.end())
+        return it->second.get();
+
+    // make sure to keep the font data buffer around while the face exists.
+    auto data = font_cache[font];
+    if (!data)
+    {
+        gfx::Loader::ResourceDesc desc;
+        desc.uri  = font;
+        desc.type = gfx::Loader::Type::Font;
+        data = gfx::LoadResource(desc);
+        if (!data)
+        {
+            font_cache.erase(font);
+            ERROR_RETURN(nullptr, "Failed to load font file. [font='%1]", font);
+        }
+        font_cache[font] = data;
+    }
+
+    auto face = std::make_unique<FontFace>();
+    face->data = data;
+    if (FT_New_Memory_Face(freetype.library, (const FT_Byte*)data->GetData(),
+                           data->GetByteSize(), 0, &face->face))
+        ERROR_RETURN(nullptr, "Failed to load font face. [font='%1']", font);
+
+    if (FT_Select_Charmap(face->face, FT_ENCODING_UNICODE))
+        ERROR_RETURN(nullptr, "Font doesn't support Unicode. [font='%1']", font);
+    if (FT_Set_Pixel_Sizes(face->face, 0, font_size))
+        ERROR_RETURN(nullptr, "Font doesn't support expected pixel size. [font='%1', size='%2']", font, font_size);
+
+    // simple example for harfbuzz is here
+    // https://github.com/harfbuzz/harfbuzz-tutorial/blob/master/hello-harfbuzz-freetype.c
+    face->font = hb_ft_font_create(face->face, nullptr);
+
+    DEBUG("Loaded new font face. [font='%1', size=%2]", font, font_size);
+    auto* ret = face.get();
+    face_cache[key] = std::move(face);
+    return ret;
+}
+
+Glyph& LoadGlyph(FontFace& face, unsigned codepoint)
+{
+    auto it = face.glyphs.find(codepoint);
+    if (it != face.glyphs.end())
+        return it->second;
+
+    // load/rasterize the glyph we don't already have
+    // https://www.freetype.org/freetype2/docs/glyphs/glyphs-3.html
+    FT_Load_Glyph(face.face, codepoint, FT_LOAD_DEFAULT);
+    FT_Render_Glyph(face.face->glyph, FT_RENDER_MODE_NORMAL);
+    FT_GlyphSlot slot = face.face->glyph;
+
+    Glyph glyph;
+    glyph.index     = codepoint;
+    glyph.width     = slot->bitmap.width;
+    glyph.height    = slot->bitmap.rows;
+    glyph.bearing_x = slot->bitmap_left;
+    glyph.bearing_y = slot->bitmap_top;
+    // copy into our buffer
+    glyph.bitmap = gfx::AlphaMask(reinterpret_cast<const Pixel_A*>(slot->bitmap.buffer),
+                                  slot->bitmap.width,
+                                  slot->bitmap.rows,
+                                  slot->bitmap.pitch);
+    return face.glyphs.insert(std::make_pair(codepoint, std::move(glyph))).first->second;
+}
+
+// Glyph atlas packs the rasterized glyphs of all fonts and sizes into
+// a single alpha mask texture using simple shelf packing. When the atlas
+// runs out of space the atlas is reset and a new generation is started.
+// All the glyph placements from a previous generation are then invalid.
+class GlyphAtlas
+{
+public:
+    static constexpr unsigned Size = 1024;
+    // empty space between glyphs to avoid sampling the neighbors.
+    static constexpr unsigned Padding = 1;
+    // solid block for drawing the underlines.
+    static constexpr unsigned SolidBlockSize = 4;
+
+    GlyphAtlas()
+      : mBitmap(Size, Size)
+    {
+        Reset();
+    }
+
+    void Reset()
+    {
+        mBitmap.Fill(Pixel_A(0));
+        mBitmap.Fill(gfx::URect(0, 0, SolidBlockSize, SolidBlockSize), Pixel_A(0xff));
+        mCursorX = SolidBlockSize + Padding;
+        mCursorY = 0;
+        mShelfHeight = SolidBlockSize;
+        mGeneration++;
+        mRevision++;
+    }
+
+    bool Insert(Glyph& glyph)
+    {
+        if (glyph.atlas_generation == mGeneration)
+            return true;
+
+        // nothing to pack with empty glyphs such as space.
+        if (glyph.width == 0 || glyph.height == 0)
+        {
+            glyph.atlas_generation = mGeneration;
+            return true;
+        }
+
+        if (mCursorX + glyph.width > Size)
+        {
+            mCursorX = 0;
+            mCursorY += mShelfHeight + Padding;
+            mShelfHeight = 0;
+        }
+        if (mCursorX + glyph.width > Size || mCursorY + glyph.height > Size)
+            return false;
+
+        mBitmap.Copy(mCursorX, mCursorY, glyph.bitmap);
+        glyph.atlas_x = mCursorX;
+        glyph.atlas_y = mCursorY;
+        glyph.atlas_generation = mGeneration;
+
+        mCursorX += glyph.width + Padding;
+        mShelfHeight = std::max(mShelfHeight, glyph.height);
+        mRevision++;
+        return true;
+    }
+
+    inline std::size_t GetGeneration() const noexcept
+    { return mGeneration; }
+    inline std::size_t GetRevision() const noexcept
+    { return mRevision; }
+    inline const gfx::AlphaMask& GetBitmap() const noexcept
+    { return mBitmap; }
+private:
+    gfx::AlphaMask mBitmap;
+    unsigned mCursorX = 0;
+    unsigned mCursorY = 0;
+    unsigned mShelfHeight = 0;
+    // generation changes every time the atlas is reset.
+    std::size_t mGeneration = 0;
+    // revision changes every time the atlas content changes.
+    std::size_t mRevision = 0;
+};
+
+GlyphAtlas& GetGlyphAtlas(gfx::TextBuffer::GlyphMode mode)
+{
+    static GlyphAtlas bitmap_atlas;
+    static GlyphAtlas distance_field_atlas;
+    if (mode == gfx::TextBuffer::GlyphMode::DistanceField)
+        return distance_field_atlas;
+    return bitmap_atlas;
+}
+
+// Distance field glyphs are generated once per font at a fixed pixel size
+// from the glyph outlines and then scaled to the requested font size when
+// the text is drawn. The glyph bitmaps include the distance field spread
+// and the glyph bearings refer to the top left corner of the bitmap.
+struct DistanceFieldFont {
+    std::unordered_map<unsigned, Glyph> glyphs;
+    std::string cache_file;
+};
+
+std::string gDistanceFieldCacheDir;
+
+const std::uint32_t DISTANCE_FIELD_CACHE_MAGIC   = 0x46445344; // 'DSDF'
+const std::uint32_t DISTANCE_FIELD_CACHE_VERSION = 1;
+
+struct DistanceFieldCacheHeader {
+    std::uint32_t magic   = DISTANCE_FIELD_CACHE_MAGIC;
+    std::uint32_t version = DISTANCE_FIELD_CACHE_VERSION;
+    std::uint32_t font_size = gfx::TextBuffer::DistanceFieldFontSize;
+    std::uint32_t spread    = gfx::TextBuffer::DistanceFieldSpread;
+    std::uint64_t font_hash = 0;
+};
+struct DistanceFieldCacheRecord {
+    std::uint32_t index  = 0;
+    std::uint32_t width  = 0;
+    std::uint32_t height = 0;
+    std::int32_t bearing_x = 0;
+    std::int32_t bearing_y = 0;
+};
+// The largest distance field glyph (width or height) that is stored in the
+// cache file. Anything larger in the cache file means the file is corrupt.
+const std::uint32_t DISTANCE_FIELD_CACHE_MAX_GLYPH_SIZE = gfx::TextBuffer::DistanceFieldFontSize +
+                                                          gfx::TextBuffer::DistanceFieldSpread * 2;
+
+std::uint64_t HashFontData(const gfx::Resource& data)
+{
+    // FNV-1a
+    std::uint64_t hash = 14695981039346656037ull;
+    const auto* bytes = static_cast<const std::uint8_t*>(data.GetData());
+    for (std::size_t i=0; i<data.GetByteSize(); ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Read the glyph records from the cache file. Returns false if any record
+// is bad (for example the file has been truncated) and the file can't be used.
+bool ReadDistanceFieldCacheRecords(std::ifstream& in, std::uint64_t bytes, DistanceFieldFont* font)
+{
+    while (bytes)
+    {
+        DistanceFieldCacheRecord record;
+        if (bytes < sizeof(record) || !in.read((char*)&record, sizeof(record)))
+            return false;
+        bytes -= sizeof(record);
+
+        // the record comes straight from the file, check the size before
+        // allocating anything.
+        if (record.width > DISTANCE_FIELD_CACHE_MAX_GLYPH_SIZE ||
+            record.height > DISTANCE_FIELD_CACHE_MAX_GLYPH_SIZE)
+            return false;
+        const std::uint64_t pixel_count = std::uint64_t(record.width) * std::uint64_t(record.height);
+        if (pixel_count > bytes)
+            return false;
+
+        std::vector<Pixel_A> pixels(pixel_count);
+        if (!in.read((char*)pixels.data(), pixels.size()))
+            return false;
+        bytes -= pixel_count;
+
+        Glyph glyph;
+        glyph.index     = record.index;
+        glyph.width     = record.width;
+        glyph.height    = record.height;
+        glyph.bearing_x = record.bearing_x;
+        glyph.bearing_y = record.bearing_y;
+        glyph.bitmap    = gfx::AlphaMask(pixels.data(), record.width, record.height);
+        font->glyphs[record.index] = std::move(glyph);
+    }
+    return true;
+}
+
+// Load the previously generated distance field glyphs from the cache file.
+// If the cache file doesn't exist, is stale or is corrupt a new cache file
+// is started.
+void LoadDistanceFieldCache(const std::string& file, std::uint64_t font_hash, DistanceFieldFont* font)
+{
+    DistanceFieldCacheHeader expected;
+    expected.font_hash = font_hash;
+
+    auto in = base::OpenBinaryInputStream(file);
+    if (in.is_open())
+    {
+        in.seekg(0, std::ios::end);
+        const auto end = in.tellg();
+        in.seekg(0, std::ios::beg);
+        const std::uint64_t bytes = end > 0 ? std::uint64_t(end) : 0;
+
+        DistanceFieldCacheHeader header;
+        in.read((char*)&header, sizeof(header));
+        if (in && std::memcmp(&header, &expected, sizeof(header)) == 0)
+        {
+            if (ReadDistanceFieldCacheRecords(in, bytes - sizeof(header), font))
+            {
+                font->cache_file = file;
+                DEBUG("Loaded distance field glyph cache. [file='%1', glyphs=%2]", file, font->glyphs.size());
+                return;
+            }
+            font->glyphs.clear();
+            WARN("Discarding corrupt distance field glyph cache. [file='%1']", file);
+        }
+        else WARN("Discarding stale distance field glyph cache. [file='%1']", file);
+    }
+    in.close();
+
+    auto out = base::OpenBinaryOutputStream(file);
+    if (!out.is_open())
+    {
+        WARN("Failed to create distance field glyph cache. [file='%1']", file);
+        return;
+    }
+    out.write((const char*)&expected, sizeof(expected));
+    font->cache_file = file;
+}
+
+void AppendDistanceFieldCache(const std::string& file, unsigned index, const Glyph& glyph)
+{
+    // glyphs larger than what the cache file accepts are simply
+    // generated again on every run.
+    if (glyph.width > DISTANCE_FIELD_CACHE_MAX_GLYPH_SIZE ||
+        glyph.height > DISTANCE_FIELD_CACHE_MAX_GLYPH_SIZE)
+        return;
+
+    std::ofstream out(file, std::ios::out | std::ios::app | std::ios::binary);
+    if (!out.is_open())
+        return;
+
+    DistanceFieldCacheRecord record;
+    record.index     = index;
+    record.width     = glyph.width;
+    record.height    = glyph.height;
+    record.bearing_x = glyph.bearing_x;
+    record.bearing_y = glyph.bearing_y;
+    out.write((const char*)&record, sizeof(record));
+    out.write((const char*)glyph.bitmap.GetDataPtr(), glyph.width * glyph.height);
+}
+
+DistanceFieldFont* FindDistanceFieldFont(const std::string& font)
+{
+    static std::unordered_map<std::string, std::unique_ptr<DistanceFieldFont>> font_cache;
+    auto it = font_cache.find(font);
+    if (it != font_cache.end())
+        return it->second.get();
+
+    auto* face = FindFontFace(font, gfx::TextBuffer::DistanceFieldFontSize);
+    if (!face)
+        return nullptr;
+
+    auto ret = std::make_unique<DistanceFieldFont>();
+    if (!gDistanceFieldCacheDir.empty())
+    {
+        const auto font_hash = HashFontData(*face->data);
+        const auto& file = base::JoinPath(gDistanceFieldCacheDir,
+            base::FormatString("sdf-%1.cache", std::hash<std::string>()(font)));
+        LoadDistanceFieldCache(file, font_hash, ret.get());
+    }
+    auto* ptr = ret.get();
+    font_cache[font] = std::move(ret);
+    return ptr;
+}
+
+// The glyph outline flattened into line segments.
+struct GlyphOutline {
+    struct Segment {
+        float x0, y0;
+        float x1, y1;
+    };
+    std::vector<Segment> segments;
+    float pen_x = 0.0f;
+    float pen_y = 0.0f;
+
+    void LineTo(float x, float y)
+    {
+        if (x != pen_x || y != pen_y)
+            segments.push_back({pen_x, pen_y, x, y});
+        pen_x = x;
+        pen_y = y;
+    }
+};
+
+// number of line segments used to approximate each bezier curve.
+const unsigned OUTLINE_CURVE_STEPS = 8;
+
+int OutlineMoveTo(const FT_Vector* to, void* user)
+{
+    auto* outline = static_cast<GlyphOutline*>(user);
+    outline->pen_x = to->x / float(EFFIN_MAGIC_SCALE);
+    outline->pen_y = to->y / float(EFFIN_MAGIC_SCALE);
+    return 0;
+}
+int OutlineLineTo(const FT_Vector* to, void* user)
+{
+    auto* outline = static_cast<GlyphOutline*>(user);
+    outline->LineTo(to->x / float(EFFIN_MAGIC_SCALE),
+                    to->y / float(EFFIN_MAGIC_SCALE));
+    return 0;
+}
+int OutlineConicTo(const FT_Vector* control, const FT_Vector* to, void* user)
+{
+    auto* outline = static_cast<GlyphOutline*>(user);
+    const float x0 = outline->pen_x;
+    const float y0 = outline->pen_y;
+    const float x1 = control->x / float(EFFIN_MAGIC_SCALE);
+    const float y1 = control->y / float(EFFIN_MAGIC_SCALE);
+    const float x2 = to->x / float(EFFIN_MAGIC_SCALE);
+    const float y2 = to->y / float(EFFIN_MAGIC_SCALE);
+    for (unsigned i=1; i<=OUTLINE_CURVE_STEPS; ++i)
+    {
+        const float t = i / float(OUTLINE_CURVE_STEPS);
+        const float a = (1.0f - t) * (1.0f - t);
+        const float b = 2.0f * (1.0f - t) * t;
+        const float c = t * t;
+        outline->LineTo(a*x0 + b*x1 + c*x2, a*y0 + b*y1 + c*y2);
+    }
+    return 0;
+}
+int OutlineCubicTo(const FT_Vector* control1, const FT_Vector* control2, const FT_Vector* to, void* user)
+{
+    auto* outline = static_cast<GlyphOutline*>(user);
+    const float x0 = outline->pen_x;
+    const float y0 = outline->pen_y;
+    const float x1 = control1->x / float(EFFIN_MAGIC_SCALE);
+    const float y1 = control1->y / float(EFFIN_MAGIC_SCALE);
+    const float x2 = control2->x / float(EFFIN_MAGIC_SCALE);
+    const float y2 = control2->y / float(EFFIN_MAGIC_SCALE);
+    const float x3 = to->x / float(EFFIN_MAGIC_SCALE);
+    const float y3 = to->y / float(EFFIN_MAGIC_SCALE);
+    for (unsigned i=1; i<=OUTLINE_CURVE_STEPS; ++i)
+    {
+        const float t = i / float(OUTLINE_CURVE_STEPS);
+        const float a = (1.0f - t) * (1.0f - t) * (1.0f - t);
+        const float b = 3.0f * (1.0f - t) * (1.0f - t) * t;
+        const float c = 3.0f * (1.0f - t) * t * t;
+        const float d = t * t * t;
+        outline->LineTo(a*x0 + b*x1 + c*x2 + d*x3, a*y0 + b*y1 + c*y2 + d*y3);
+    }
+    return 0;
+}
+
+// Generate a signed distance field for the glyph from the glyph outline.
+// The distance is mapped to 0-255 so that the glyph edge is at 128 and the
+// values increase towards the inside of the glyph. Distances beyond the
+// spread are clamped.
+Glyph GenerateDistanceFieldGlyph(FT_Face face, unsigned index)
+{
+    Glyph glyph;
+    if (FT_Load_Glyph(face, index, FT_LOAD_NO_BITMAP) ||
+        face->glyph->format != FT_GLYPH_FORMAT_OUTLINE)
+        return glyph;
+
+    FT_Outline* ft_outline = &face->glyph->outline;
+
+    GlyphOutline outline;
+    FT_Outline_Funcs funcs = {};
+    funcs.move_to  = OutlineMoveTo;
+    funcs.line_to  = OutlineLineTo;
+    funcs.conic_to = OutlineConicTo;
+    funcs.cubic_to = OutlineCubicTo;
+    if (FT_Outline_Decompose(ft_outline, &funcs, &outline) || outline.segments.empty())
+        return glyph;
+
+    FT_BBox box;
+    FT_Outline_Get_CBox(ft_outline, &box);
+    const int spread = gfx::TextBuffer::DistanceFieldSpread;
+    const int xmin = (int)std::floor(box.xMin / float(EFFIN_MAGIC_SCALE)) - spread;
+    const int xmax = (int)std::ceil(box.xMax / float(EFFIN_MAGIC_SCALE)) + spread;
+    const int ymin = (int)std::floor(box.yMin / float(EFFIN_MAGIC_SCALE)) - spread;
+    const int ymax = (int)std::ceil(box.yMax / float(EFFIN_MAGIC_SCALE)) + spread;
+
+    glyph.width     = xmax - xmin;
+    glyph.height    = ymax - ymin;
+    glyph.bearing_x = xmin;
+    glyph.bearing_y = ymax;
+    glyph.bitmap.Resize(glyph.width, glyph.height);
+
+    const bool even_odd = ft_outline->flags & FT_OUTLINE_EVEN_ODD_FILL;
+
+    for (unsigned row=0; row<glyph.height; ++row)
+    {
+        // sample at the pixel center. the outline has y growing up.
+        const float py = ymax - (row + 0.5f);
+        for (unsigned col=0; col<glyph.width; ++col)
+        {
+            const float px = xmin + (col + 0.5f);
+
+            float min_distance_sq = std::numeric_limits<float>::max();
+            int winding = 0;
+            for (const auto& seg : outline.segments)
+            {
+                // distance to the line segment
+                const float dx = seg.x1 - seg.x0;
+                const float dy = seg.y1 - seg.y0;
+                const float len_sq = dx*dx + dy*dy;
+                float t = len_sq > 0.0f ? ((px - seg.x0)*dx + (py - seg.y0)*dy) / len_sq : 0.0f;
+                t = math::clamp(0.0f, 1.0f, t);
+                const float cx = seg.x0 + t*dx - px;
+                const float cy = seg.y0 + t*dy - py;
+                min_distance_sq = std::min(min_distance_sq, cx*cx + cy*cy);
+
+                // winding number for the inside/outside test
+                const float side = dx * (py - seg.y0) - (px - seg.x0) * dy;
+                if (seg.y0 <= py)
+                {
+                    if (seg.y1 > py && side > 0.0f)
+                        ++winding;
+                }
+                else if (seg.y1 <= py && side < 0.0f)
+                    --winding;
+            }
+            const bool inside = even_odd ? (winding & 1) : (winding != 0);
+            const float distance = std::sqrt(min_distance_sq) * (inside ? 1.0f : -1.0f);
+            const float value = math::clamp(0.0f, 1.0f, 0.5f + distance / (2.0f * spread));
+            glyph.bitmap.SetPixel(row, col, Pixel_A(std::uint8_t(value * 255.0f + 0.5f)));
+        }
+    }
+    return glyph;
+}
+
+Glyph& LoadDistanceFieldGlyph(const std::string& font_name, DistanceFieldFont& font, unsigned index)
+{
+    auto it = font.glyphs.find(index);
+    if (it != font.glyphs.end())
+        return it->second;
+
+    // the face is cached and can't fail here since it was
+    // already used when the distance field font was created.
+    auto* face = FindFontFace(font_name, gfx::TextBuffer::DistanceFieldFontSize);
+    auto glyph = GenerateDistanceFieldGlyph(face->face, index);
+    glyph.index = index;
+    if (!font.cache_file.empty())
+        AppendDistanceFieldCache(font.cache_file, index, glyph);
+
+    return font.glyphs.insert(std::make_pair(index, std::move(glyph))).first->second;
+}
+
 template<size_t Pool>
 std::shared_ptr<gfx::AlphaMask> AllocateBitmap(unsigned width, unsigned height)
 {
@@ -206,7 +764,7 @@ int AlignLine(int line_width, int block_width, gfx::TextBuffer::HorizontalAlignm
 // fixed somehow so that if several text blocks with identical font settings are
 // being displayed the text is vertically aligned on the screen when the objects
 // displaying the text are vertically aligned.
-TextComposite CompositeTextBlock(const TextBlock& block, FT_Face face)
+TextComposite CompositeTextBlock(const TextBlock& block)
 {
     int block_width  = 0;
     for (const auto& line : block.lines)
@@ -257,18 +815,34 @@ TextComposite CompositeTextBlock(const TextBlock& block, FT_Face face)
     return ret;
 }
 
-// Rasterize and layout a row of glyphs on the a baseline in order to create a "line of text".
+struct GlyphPlacement {
+    Glyph* glyph = nullptr;
+    // the glyph top left corner in the line raster. y grows down.
+    int x = 0;
+    int y = 0;
+    // the glyph origin (pen position) in the line raster. y grows down.
+    int origin_x = 0;
+    int origin_y = 0;
+};
+
+struct ShapedLine {
+    std::vector<GlyphPlacement> glyphs;
+    unsigned width  = 0;
+    unsigned height = 0;
+    // the position of the baseline within the line raster
+    // measured from the top of the raster.
+    int baseline = 0;
+};
+
+// Shape and layout a row of glyphs on the a baseline in order to create a "line of text".
 // this will (or at least tries to) properly account for the vertical ascent or descent
-// (relative to the baseline) for each glyph. The returned value provides reference to the
-// grayscale bitmap and also the position of the baseline within the bitmap so that the
-// bitmap can be positioned correctly when composited. Keep in mind that using the size of the
-// bitmap is not correct way to composite multiple lines since the sizes of the bitmaps can
+// (relative to the baseline) for each glyph. The returned value provides the glyph positions
+// in the line raster and the position of the baseline within the raster so that the line
+// can be positioned correctly when composited. Keep in mind that using the size of the
+// raster is not correct way to composite multiple lines since the sizes of the rasters can
 // vary even when using same font settings.
-LineRaster RasterizeLine(const std::string& line, const gfx::TextBuffer::Text& text, FT_Face face)
+ShapedLine ShapeLine(const std::string& line, FontFace& face)
 {
-    // simple example for harfbuzz is here
-    // https://github.com/harfbuzz/harfbuzz-tutorial/blob/master/hello-harfbuzz-freetype.c
-    hb_font_t* hb_font = hb_ft_font_create(face, nullptr);
     hb_buffer_t* hb_buff = hb_buffer_create();
     hb_buffer_add_utf8(hb_buff, line.c_str(),
                        -1,  // NUL terminated string
@@ -278,20 +852,7 @@ LineRaster RasterizeLine(const std::string& line, const gfx::TextBuffer::Text& t
     hb_buffer_set_direction(hb_buff, HB_DIRECTION_LTR);
     hb_buffer_set_script(hb_buff, HB_SCRIPT_LATIN);
     hb_buffer_set_language(hb_buff, hb_language_from_string("en", -1));
-    hb_shape(hb_font, hb_buff, nullptr, 0);
-
-    struct GlyphRasterInfo {
-        unsigned width  = 0;
-        unsigned height = 0;
-        int bearing_x = 0;
-        int bearing_y = 0;
-        gfx::AlphaMask bitmap;
-    };
-
-    std::map<unsigned, GlyphRasterInfo> glyph_raster_info;
-
-    // rasterize the required glyphs
-    // https://www.freetype.org/freetype2/docs/glyphs/glyphs-3.html
+    hb_shape(face.font, hb_buff, nullptr, 0);
 
     // the distance from the baseline to the highest or upper grid coordinate
     // used to place an outline point. It's a positive value due to the grid's
@@ -306,47 +867,20 @@ LineRaster RasterizeLine(const std::string& line, const gfx::TextBuffer::Text& t
     int pen_x = 0;
     int pen_y = 0;
 
-    // the extents of the text block when rasterized
-    unsigned height = 0;
-    unsigned width  = 0;
+    ShapedLine ret;
 
     const auto glyph_count = hb_buffer_get_length(hb_buff);
     hb_glyph_info_t* glyph_info = hb_buffer_get_glyph_infos(hb_buff, nullptr);
     hb_glyph_position_t* glyph_pos = hb_buffer_get_glyph_positions(hb_buff, nullptr);
     for (unsigned i=0; i<glyph_count; ++i)
     {
-        const auto codepoint = glyph_info[i].codepoint;
-        auto it = glyph_raster_info.find(codepoint);
-        if (it == std::end(glyph_raster_info))
-        {
-            // load/rasterize the glyph we don't already have
-            FT_Load_Glyph(face, codepoint, FT_LOAD_DEFAULT);
-            FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL);
-            FT_GlyphSlot slot = face->glyph;
-
-            // copy into our buffer
-            gfx::AlphaMask bmp(reinterpret_cast<const Pixel_A*>(slot->bitmap.buffer),
-                                  slot->bitmap.width,
-                                  slot->bitmap.rows,
-                                  slot->bitmap.pitch);
-
-            GlyphRasterInfo info;
-            info.width  = slot->bitmap.width;
-            info.height = slot->bitmap.rows;
-            // bearing X (left side bearing) is the horizontal distance from the current pen position
-            // to the glyph's left edge (the left edge of its bounding box)
-            info.bearing_x = slot->bitmap_left;
-            // bearing Y (top side bearing) is the vertical distance from the baseline to the top of glyph
-            // (to the top of its bounding box)
-            info.bearing_y = slot->bitmap_top;
-            info.bitmap    = std::move(bmp);
-            it = glyph_raster_info.insert(std::make_pair(codepoint, std::move(info))).first;
-        }
-        const auto& info = it->second;
+        // the glyph references are stable since the glyph map is node based.
+        auto& glyph = LoadGlyph(face, glyph_info[i].codepoint);
 
         // compute the extents of the text i.e. the required height and width
         // of the bitmap into which to composite the glyphs
 
+        // advances tell us how much to move the pen in x/y direction for the next glyph
         const int xa = glyph_pos[i].x_advance / EFFIN_MAGIC_SCALE;
         const int ya = glyph_pos[i].y_advance / EFFIN_MAGIC_SCALE;
         // the x and y offsets from harfbuzz seem to be just for modifying
@@ -356,85 +890,113 @@ LineRaster RasterizeLine(const std::string& line, const gfx::TextBuffer::Text& t
 
         // this is the glyph top left corner relative to the imaginary baseline
         // where the baseline is at y=0 and y grows up
-        const int x = pen_x + info.bearing_x + xo;
-        const int y = pen_y + info.bearing_y + yo;
+        const int x = pen_x + glyph.bearing_x + xo;
+        const int y = pen_y + glyph.bearing_y + yo;
 
         const int glyph_top = y;
-        const int glyph_bot = y - info.height;
+        const int glyph_bot = y - glyph.height;
 
         ascent  = std::max(ascent, glyph_top);
         descent = std::min(descent, glyph_bot);
 
-        height = ascent - descent; // todo: + linegap (where to find linegap?)
-        width  = x + info.width;
+        ret.height = ascent - descent; // todo: + linegap (where to find linegap?)
+        ret.width  = x + glyph.width;
+
+        GlyphPlacement placement;
+        placement.glyph = &glyph;
+        placement.x = x;
+        placement.y = y;
+        placement.origin_x = pen_x + xo;
+        placement.origin_y = pen_y + yo;
+        ret.glyphs.push_back(placement);
 
         pen_x += xa;
         pen_y += ya;
     }
+    hb_buffer_destroy(hb_buff);
 
-    // offset to the baseline. if negative then it's below the baseline
-    // if positive it's above the baseline.
-    const auto underline_position  = face->underline_position / EFFIN_MAGIC_SCALE;
-    // vertical thickness of the underline.. units ??
-    const auto underline_thickness = 2; // face->underline_thickness ? face->underline_thickness : 1;
-    //const auto line_spacing = (face->size->metrics.height / EFFIN_MAGIC_SCALE) * text.lineheight;
-    //const auto margin = line_spacing > height ? line_spacing - height : 0;
-    //height += margin;
-
-    auto bmp = AllocateBitmap<1>(width, height);
-
-    // the bitmap has 0,0 at top left and y grows down.
+    // the raster has 0,0 at top left and y grows down.
     //
     // 0,0 ____________________
     //     |                  | ascent (above baseline)
     //     |  ---baseline---  |
     //     |__________________| descent (below baseline)
     //
-    const auto baseline = ascent;
-
-    // finally compose the glyphs into a text buffer starting at the current pen position
-    pen_x = 0;
-    pen_y = 0;
-
-    for (unsigned i=0; i<glyph_count; ++i)
+    ret.baseline = ascent;
+    for (auto& placement : ret.glyphs)
     {
-        const auto codepoint = glyph_info[i].codepoint;
-        const auto& info = glyph_raster_info[codepoint];
+        placement.y = ret.baseline - placement.y;
+        placement.origin_y = ret.baseline - placement.origin_y;
+    }
+    return ret;
+}
 
-        // advances tell us how much to move the pen in x/y direction for the next glyph
-        const int xa = glyph_pos[i].x_advance / EFFIN_MAGIC_SCALE;
-        const int ya = glyph_pos[i].y_advance / EFFIN_MAGIC_SCALE;
+// offset of the underline to the baseline. if negative then it's below
+// the baseline if positive it's above the baseline.
+int GetUnderlinePosition(const FontFace& face)
+{
+    return face.face->underline_position / EFFIN_MAGIC_SCALE;
+}
+// vertical thickness of the underline.. units ??
+const auto UNDERLINE_THICKNESS = 2; // face->underline_thickness ? face->underline_thickness : 1;
 
-        // offsets tell us how the glyph should be offset wrt the current pen position
-        const int xo = glyph_pos[i].x_offset / EFFIN_MAGIC_SCALE;
-        const int yo = glyph_pos[i].y_offset / EFFIN_MAGIC_SCALE;
+// Rasterize a line of text into a grayscale bitmap. The returned value provides
+// reference to the bitmap and also the position of the baseline within the bitmap.
+LineRaster RasterizeLine(const std::string& line, const gfx::TextBuffer::Text& text, FontFace& face)
+{
+    const auto& shaped = ShapeLine(line, face);
 
-        const int x = pen_x + info.bearing_x + xo;
-        const int y = pen_y + info.bearing_y + yo;
+    //const auto line_spacing = (face->size->metrics.height / EFFIN_MAGIC_SCALE) * text.lineheight;
+    //const auto margin = line_spacing > height ? line_spacing - height : 0;
+    //height += margin;
 
-        bmp->Blit(x, baseline - y, info.bitmap, gfx::RasterOp_BitwiseOr<Pixel_A>);
+    auto bmp = AllocateBitmap<1>(shaped.width, shaped.height);
 
-        pen_x += xa;
-        pen_y += ya;
+    // finally compose the glyphs into a text buffer
+    for (const auto& placement : shaped.glyphs)
+    {
+        bmp->Blit(placement.x, placement.y, placement.glyph->bitmap, gfx::RasterOp_BitwiseOr<Pixel_A>);
     }
 
     if (text.underline)
     {
         const auto width = bmp->GetWidth();
-        const gfx::URect underline(0, baseline + underline_position,
-                                   width, underline_thickness);
+        const gfx::IRect underline(0, shaped.baseline + GetUnderlinePosition(face),
+                                   width, UNDERLINE_THICKNESS);
         bmp->Fill(underline, gfx::Pixel_A(0xff));
     }
 
-    hb_font_destroy(hb_font);
-    hb_buffer_destroy(hb_buff);
-
     LineRaster ret;
-    ret.baseline  = baseline;
+    ret.baseline  = shaped.baseline;
     ret.bitmap    = bmp;
     return ret;
 }
 
+// Add the glyph quad to the list of quads while clipping it against
+// the clip rectangle. The texture rectangle is in normalized atlas
+// coordinates and is clipped proportionally to the glyph rectangle.
+void AddGlyphQuad(const gfx::FRect& rect, const gfx::FRect& clip, const gfx::FRect& texture_rect,
+                  std::vector<gfx::TextBuffer::GlyphQuad>* quads)
+{
+    const auto& visible = base::Intersect(rect, clip);
+    if (visible.IsEmpty())
+        return;
+
+    const auto sx = texture_rect.GetWidth() / rect.GetWidth();
+    const auto sy = texture_rect.GetHeight() / rect.GetHeight();
+
+    gfx::TextBuffer::GlyphQuad quad;
+    quad.x      = visible.GetX();
+    quad.y      = visible.GetY();
+    quad.width  = visible.GetWidth();
+    quad.height = visible.GetHeight();
+    quad.texture_x      = texture_rect.GetX() + (visible.GetX() - rect.GetX()) * sx;
+    quad.texture_y      = texture_rect.GetY() + (visible.GetY() - rect.GetY()) * sy;
+    quad.texture_width  = visible.GetWidth() * sx;
+    quad.texture_height = visible.GetHeight() * sy;
+    quads->push_back(quad);
+}
+
 } // namespace
 
 namespace gfx
@@ -461,12 +1023,6 @@ TextBuffer::RasterFormat TextBuffer::GetRasterFormat() const
 
 std::shared_ptr<AlphaMask> TextBuffer::RasterizeBitmap() const
 {
-    static FontLibrary freetype;
-
-    // make sure to destroy face first on stack unwind before
-    // font buff is released.
-    FT_Face face = nullptr;
-
     // rasterize the lines and accumulate the metrics for the
     // height of all the text blocks and the maximum line width.
 
@@ -475,28 +1031,12 @@ std::shared_ptr<AlphaMask> TextBuffer::RasterizeBitmap() const
     if (mText.font.empty())
         return nullptr;
 
-    gfx::Loader::ResourceDesc desc;
-    desc.uri  = mText.font;
-    desc.type = gfx::Loader::Type::Font;
-
-    // make sure to keep the font data buffer around while the face exists.
-    auto fontbuff = gfx::LoadResource(desc);
-    if (!fontbuff)
-        ERROR_RETURN(nullptr, "Failed to load font file. [font='%1]", mText.font);
-
-    if (FT_New_Memory_Face(freetype.library, (const FT_Byte*)fontbuff->GetData(),
-                           fontbuff->GetByteSize(), 0, &face))
-        ERROR_RETURN(nullptr, "Failed to load font face. [font='%1']", mText.font);
-
-    auto face_raii = base::MakeUniqueHandle(face, FT_Done_Face);
-
-    if (FT_Select_Charmap(face, FT_ENCODING_UNICODE))
-        ERROR_RETURN(nullptr, "Font doesn't support Unicode. [font='%1']", mText.font);
-    if (FT_Set_Pixel_Sizes(face, 0, mText.fontsize))
-        ERROR_RETURN(nullptr, "Font doesn't support expected pixel size. [font='%1', size='%2']", mText.font, mText.fontsize);
+    auto* face = FindFontFace(mText.font, mText.fontsize);
+    if (!face)
+        return nullptr;
 
     TextBlock block;
-    block.line_height = (face->size->metrics.height / EFFIN_MAGIC_SCALE) * mText.lineheight;
+    block.line_height = (face->face->size->metrics.height / EFFIN_MAGIC_SCALE) * mText.lineheight;
     block.halign = mHorizontalAlign;
     block.valign = mVerticalAlign;
 
@@ -507,10 +1047,10 @@ std::shared_ptr<AlphaMask> TextBuffer::RasterizeBitmap() const
     {
         LineRaster raster;
         if (!line.empty())
-            raster = RasterizeLine(line, mText, face);
+            raster = RasterizeLine(line, mText, *face);
         block.lines.push_back(std::move(raster));
     }
-    blocks.push_back(CompositeTextBlock(block, face));
+    blocks.push_back(CompositeTextBlock(block));
 
     // compute total combined size for text blocks to be laid out vertically.
     int text_width_px  = 0;
@@ -564,6 +1104,210 @@ std::shared_ptr<AlphaMask> TextBuffer::RasterizeBitmap() const
     return out;
 }
 
+bool TextBuffer::LayoutGlyphs(std::vector<GlyphQuad>* quads, unsigned* width, unsigned* height, GlyphMode mode) const
+{
+    if (mText.font.empty())
+        return false;
+
+    auto* face = FindFontFace(mText.font, mText.fontsize);
+    if (!face)
+        return false;
+
+    DistanceFieldFont* distance_field_font = nullptr;
+    if (mode == GlyphMode::DistanceField)
+    {
+        distance_field_font = FindDistanceFieldFont(mText.font);
+        if (!distance_field_font)
+            return false;
+    }
+
+    std::vector<ShapedLine> lines;
+    std::stringstream ss(mText.text);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        ShapedLine shaped;
+        if (!line.empty())
+            shaped = ShapeLine(line, *face);
+        lines.push_back(std::move(shaped));
+    }
+
+    // the glyphs to draw from the atlas. with distance field glyphs
+    // the glyph metrics and positions are still computed using the
+    // font face with the requested size.
+    auto GetAtlasGlyph = [&](const GlyphPlacement& placement) -> Glyph& {
+        if (distance_field_font)
+            return LoadDistanceFieldGlyph(mText.font, *distance_field_font, placement.glyph->index);
+        return *placement.glyph;
+    };
+
+    // make sure that all the glyphs we need are in the atlas. if the atlas
+    // is full start a new atlas generation and try once more.
+    auto& atlas = GetGlyphAtlas(mode);
+    for (unsigned attempt=0; attempt<2; ++attempt)
+    {
+        bool success = true;
+        for (auto& line : lines)
+        {
+            for (auto& placement : line.glyphs)
+            {
+                if (!atlas.Insert(GetAtlasGlyph(placement)))
+                {
+                    success = false;
+                    break;
+                }
+            }
+            if (!success)
+                break;
+        }
+        if (success)
+            break;
+        else if (attempt == 1)
+            ERROR_RETURN(false, "Text doesn't fit in the glyph atlas. [font='%1', size=%2]", mText.font, mText.fontsize);
+
+        DEBUG("Glyph atlas is full. Starting a new atlas generation.");
+        atlas.Reset();
+    }
+
+    // the layout below must produce exactly the same result as the
+    // composition done in RasterizeBitmap so that the both text
+    // rendering paths produce the same output.
+    const int line_height = (face->face->size->metrics.height / EFFIN_MAGIC_SCALE) * mText.lineheight;
+
+    int block_width = 0;
+    for (const auto& line : lines)
+        block_width = std::max(block_width, (int)line.width);
+    const int block_height = lines.size() * line_height;
+
+    const int image_width_px  = mBufferWidth  ? (int)mBufferWidth  : block_width;
+    const int image_height_px = mBufferHeight ? (int)mBufferHeight : block_height;
+
+    int block_xpos = 0;
+    if (mHorizontalAlign == HorizontalAlignment::AlignCenter)
+        block_xpos = (image_width_px - block_width) / 2;
+    else if (mHorizontalAlign == HorizontalAlignment::AlignRight)
+        block_xpos = image_width_px - block_width;
+
+    int block_ypos = 0;
+    if (mVerticalAlign == VerticalAlignment::AlignCenter)
+        block_ypos = (image_height_px - block_height) / 2;
+    else if (mVerticalAlign == VerticalAlignment::AlignBottom)
+        block_ypos = image_height_px - block_height;
+
+    const IRect image_rect(0, 0, image_width_px, image_height_px);
+    const IRect block_rect(block_xpos, block_ypos, block_width, block_height);
+    const auto& block_clip = base::Intersect(image_rect, block_rect);
+
+    const float atlas_size = GlyphAtlas::Size;
+    // the distance field glyphs are scaled from the distance field
+    // font size to the requested font size.
+    const float scale = float(mText.fontsize) / float(DistanceFieldFontSize);
+
+    // see CompositeTextBlock for the baseline rationale.
+    int baseline = line_height * 0.75;
+
+    for (const auto& line : lines)
+    {
+        const int line_xpos = block_xpos + AlignLine(line.width, block_width, mHorizontalAlign);
+        const int line_ypos = block_ypos + baseline - line.baseline;
+        const IRect line_rect(line_xpos, line_ypos, line.width, line.height);
+        const auto& clip = base::Intersect(line_rect, block_clip);
+
+        for (const auto& placement : line.glyphs)
+        {
+            const auto& glyph = GetAtlasGlyph(placement);
+            if (glyph.width == 0 || glyph.height == 0)
+                continue;
+
+            const FRect texture_rect(glyph.atlas_x / atlas_size,
+                                     glyph.atlas_y / atlas_size,
+                                     glyph.width / atlas_size,
+                                     glyph.height / atlas_size);
+            if (distance_field_font)
+            {
+                // the distance field glyph (including the spread) can extend
+                // beyond the line and the text block, so only clip against
+                // the buffer.
+                const FRect glyph_rect(line_xpos + placement.origin_x + glyph.bearing_x * scale,
+                                       line_ypos + placement.origin_y - glyph.bearing_y * scale,
+                                       glyph.width * scale, glyph.height * scale);
+                AddGlyphQuad(glyph_rect, FRect(image_rect), texture_rect, quads);
+            }
+            else
+            {
+                const FRect glyph_rect(line_xpos + placement.x,
+                                       line_ypos + placement.y,
+                                       glyph.width, glyph.height);
+                AddGlyphQuad(glyph_rect, FRect(clip), texture_rect, quads);
+            }
+        }
+
+        if (mText.underline && !line.glyphs.empty())
+        {
+            // sample the middle of the solid block in the atlas in order
+            // to avoid sampling the empty space around the block.
+            const FRect underline(line_xpos, line_ypos + line.baseline + GetUnderlinePosition(*face),
+                                  line.width, UNDERLINE_THICKNESS);
+            const FRect texture_rect(1.0f / atlas_size, 1.0f / atlas_size,
+                                     2.0f / atlas_size, 2.0f / atlas_size);
+            AddGlyphQuad(underline, FRect(clip), texture_rect, quads);
+        }
+        baseline += line_height;
+    }
+    *width  = image_width_px;
+    *height = image_height_px;
+    return true;
+}
+
+// static
+Texture* TextBuffer::UploadGlyphAtlas(Device& device, GlyphMode mode)
+{
+    const auto& atlas = GetGlyphAtlas(mode);
+    const auto* gpu_id = mode == GlyphMode::DistanceField
+                         ? "GlyphAtlasDistanceFieldTexture"
+                         : "GlyphAtlasTexture";
+
+    auto* texture = device.FindTexture(gpu_id);
+    if (!texture)
+    {
+        texture = device.MakeTexture(gpu_id);
+        texture->SetName(mode == GlyphMode::DistanceField ? "GlyphAtlasDistanceField" : "GlyphAtlas");
+        texture->SetFilter(Texture::MinFilter::Linear);
+        texture->SetFilter(Texture::MagFilter::Linear);
+        texture->SetWrapX(Texture::Wrapping::Clamp);
+        texture->SetWrapY(Texture::Wrapping::Clamp);
+        texture->SetGarbageCollection(false);
+    }
+    // the texture doesn't support sub-image uploads, so the whole atlas
+    // is uploaded whenever new glyphs have been added. this is expected
+    // to happen rarely once the commonly used glyphs have been cached.
+    if (texture->GetContentHash() != atlas.GetRevision())
+    {
+        const auto& bitmap = atlas.GetBitmap();
+        texture->Upload(bitmap.GetDataPtr(), bitmap.GetWidth(), bitmap.GetHeight(), Texture::Format::AlphaMask);
+        texture->SetContentHash(atlas.GetRevision());
+    }
+    return texture;
+}
+
+// static
+std::size_t TextBuffer::GetGlyphAtlasGeneration(GlyphMode mode)
+{
+    return GetGlyphAtlas(mode).GetGeneration();
+}
+
+// static
+const AlphaMask& TextBuffer::GetGlyphAtlasBitmap(GlyphMode mode)
+{
+    return GetGlyphAtlas(mode).GetBitmap();
+}
+
+// static
+void TextBuffer::SetDistanceFieldCacheDirectory(const std::string& directory)
+{
+    gDistanceFieldCacheDir = directory;
+}
+
 Texture* TextBuffer::RasterizeTexture(const std::string& gpu_id, const std::string& name, Device& device, bool transient) const
 {
     // load the bitmap font json descriptor
@@ -74,6 +74,59 @@ namespace gfx
 
         bool ComputeTextMetrics(unsigned* width, unsigned* height) const;
 
+        // A single glyph (or underline) quad in the text buffer.
+        // The position and size are in pixels relative to the top
+        // left corner of the buffer with y growing down. The texture
+        // coordinates are normalized coordinates in the glyph atlas.
+        struct GlyphQuad {
+            float x      = 0.0f;
+            float y      = 0.0f;
+            float width  = 0.0f;
+            float height = 0.0f;
+            float texture_x      = 0.0f;
+            float texture_y      = 0.0f;
+            float texture_width  = 0.0f;
+            float texture_height = 0.0f;
+        };
+
+        enum class GlyphMode {
+            // The glyphs are rasterized alpha masks at the font pixel size.
+            Bitmap,
+            // The glyphs are signed distance fields generated once at a
+            // fixed size and scaled to the font pixel size. Use with a
+            // distance field text shader for sharp text at any scale.
+            DistanceField
+        };
+        // The pixel size at which the distance field glyphs are generated.
+        static constexpr unsigned DistanceFieldFontSize = 48;
+        // The distance in pixels (at the distance field font size) that the
+        // distance field extends outside and inside the glyph outline.
+        static constexpr unsigned DistanceFieldSpread = 6;
+
+        // Shape and layout the text buffer contents into glyph quads that
+        // sample the shared glyph atlas. The layout matches the layout done
+        // by RasterizeBitmap but instead of rasterizing the text into a new
+        // bitmap only the glyphs missing from the atlas are rasterized.
+        // This only works with the Bitmap raster format. The width and height
+        // are the dimensions of the resulting text buffer in pixels.
+        // Returns false on error.
+        bool LayoutGlyphs(std::vector<GlyphQuad>* quads, unsigned* width, unsigned* height,
+                          GlyphMode mode = GlyphMode::Bitmap) const;
+
+        // Upload the current glyph atlas content to the device. The texture
+        // is only updated when the atlas content has changed.
+        static Texture* UploadGlyphAtlas(Device& device, GlyphMode mode = GlyphMode::Bitmap);
+        // Get the current glyph atlas generation. The generation changes
+        // whenever the atlas is reset and all previously computed glyph
+        // quads become invalid.
+        static std::size_t GetGlyphAtlasGeneration(GlyphMode mode = GlyphMode::Bitmap);
+        // Get the glyph atlas bitmap. Mostly for testing and debugging.
+        static const AlphaMask& GetGlyphAtlasBitmap(GlyphMode mode = GlyphMode::Bitmap);
+        // Set the directory for caching the generated distance field glyphs
+        // on disk. The glyphs are then only generated once per font instead
+        // of on every run. Empty string (the default) disables the caching.
+        static void SetDistanceFieldCacheDirectory(const std::string& directory);
+
         enum class HorizontalAlignment {
             AlignLeft,
             AlignCenter,
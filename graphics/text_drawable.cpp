@@ -0,0 +1,144 @@
+// Copyright (C) 2020-2025 Sami Väisänen
+// Copyright (C) 2020-2025 Ensisoft http://www.ensisoft.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "config.h"
+
+#include <vector>
+
+#include "base/assert.h"
+#include "base/hash.h"
+#include "graphics/text_drawable.h"
+#include "graphics/program.h"
+#include "graphics/shader_source.h"
+#include "graphics/vertex.h"
+
+namespace gfx
+{
+
+bool TextDrawable::ApplyDynamicState(const Environment& env, Device&, ProgramState& program, RasterState& state) const
+{
+    // the UV flips can't be supported since the texture coordinates
+    // refer to the glyphs in the glyph atlas.
+    program.SetUniform("kProjectionMatrix", *env.proj_matrix);
+    program.SetUniform("kModelViewMatrix", *env.view_matrix * *env.model_matrix);
+    program.SetUniform("kDrawableFlags", 0u);
+    return true;
+}
+
+ShaderSource TextDrawable::GetShader(const Environment& env, const Device& device) const
+{
+    ASSERT(env.mesh_type == MeshType::NormalRenderMesh);
+    ASSERT(env.use_instancing == false);
+
+    return Drawable::CreateShader(env, device, Shader::Simple2D);
+}
+
+std::string TextDrawable::GetShaderId(const Environment& env) const
+{
+    return Drawable::GetShaderId(env, Shader::Simple2D);
+}
+
+std::string TextDrawable::GetShaderName(const Environment& env) const
+{
+    return Drawable::GetShaderName(env, Shader::Simple2D);
+}
+
+std::string TextDrawable::GetGeometryId(const Environment& env) const
+{
+    return "glyph-text/" + mId;
+}
+
+bool TextDrawable::Construct(const Environment& env, Device&, Geometry::CreateArgs& create) const
+{
+    std::vector<TextBuffer::GlyphQuad> quads;
+    unsigned width  = 0;
+    unsigned height = 0;
+    if (!mText.LayoutGlyphs(&quads, &width, &height, mGlyphMode))
+        return false;
+
+    std::vector<Vertex2D> vertices;
+    vertices.reserve(quads.size() * 6);
+
+    // map the text buffer pixels to the unit square. the -y is
+    // because we're using the generic 2D vertex shader that the
+    // shapes with triangle rasterization also use.
+    const float w = width  ? (float)width  : 1.0f;
+    const float h = height ? (float)height : 1.0f;
+    for (const auto& quad : quads)
+    {
+        const float x0 = quad.x / w;
+        const float y0 = quad.y / h;
+        const float x1 = (quad.x + quad.width) / w;
+        const float y1 = (quad.y + quad.height) / h;
+        const float u0 = quad.texture_x;
+        const float v0 = quad.texture_y;
+        const float u1 = quad.texture_x + quad.texture_width;
+        const float v1 = quad.texture_y + quad.texture_height;
+
+        const Vertex2D top_left  = { {x0, -y0}, {u0, v0} };
+        const Vertex2D top_right = { {x1, -y0}, {u1, v0} };
+        const Vertex2D bot_left  = { {x0, -y1}, {u0, v1} };
+        const Vertex2D bot_right = { {x1, -y1}, {u1, v1} };
+        vertices.push_back(top_left);
+        vertices.push_back(bot_left);
+        vertices.push_back(bot_right);
+        vertices.push_back(top_left);
+        vertices.push_back(bot_right);
+        vertices.push_back(top_right);
+    }
+
+    create.content_name = "Glyph Text";
+    create.content_hash = GetGeometryHash();
+    create.usage = Geometry::Usage::Dynamic;
+    auto& geometry = create.buffer;
+    geometry.SetVertexBuffer(vertices);
+    geometry.SetVertexLayout(GetVertexLayout<Vertex2D>());
+    geometry.AddDrawCmd(Geometry::DrawType::Triangles);
+    return true;
+}
+
+Drawable::DrawPrimitive TextDrawable::GetDrawPrimitive() const
+{
+    return DrawPrimitive::Triangles;
+}
+
+SpatialMode TextDrawable::GetSpatialMode() const
+{
+    return SpatialMode::Flat2D;
+}
+
+Drawable::Usage TextDrawable::GetGeometryUsage() const
+{
+    return Usage::Dynamic;
+}
+
+size_t TextDrawable::GetGeometryHash() const
+{
+    // the geometry must be rebuilt when the atlas generation changes
+    // since the glyph texture coordinates are no longer valid.
+    size_t hash = 0;
+    hash = base::hash_combine(hash, mText.GetHash());
+    hash = base::hash_combine(hash, mGlyphMode);
+    hash = base::hash_combine(hash, TextBuffer::GetGlyphAtlasGeneration(mGlyphMode));
+    return hash;
+}
+
+Drawable::Type TextDrawable::GetType() const
+{
+    return Type::Text;
+}
+
+} // namespace
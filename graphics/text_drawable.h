@@ -0,0 +1,73 @@
+// Copyright (C) 2020-2025 Sami Väisänen
+// Copyright (C) 2020-2025 Ensisoft http://www.ensisoft.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "config.h"
+
+#include <string>
+
+#include "base/utility.h"
+#include "graphics/drawable.h"
+#include "graphics/text_buffer.h"
+
+namespace gfx
+{
+    // Draw the text buffer content as a batch of textured glyph quads
+    // that sample the shared glyph atlas. Compared to rasterizing the
+    // whole text buffer into a texture every time the text changes
+    // only the geometry needs to be updated and the glyphs are only
+    // rasterized once. Use with a text material in glyph atlas mode.
+    // The text quads are laid out in the unit square (0,0) - (1,-1)
+    // just like the rectangle shape so the drawable can be used as
+    // a drop-in replacement for a rectangle drawing text.
+    class TextDrawable : public Drawable
+    {
+    public:
+        explicit TextDrawable(const TextBuffer& text, std::string id = base::RandomString(10))
+          : mText(text)
+          , mId(std::move(id))
+        {}
+        inline void SetText(const TextBuffer& text)
+        { mText = text; }
+        // Set the glyph mode. The material used to draw the text must
+        // use the same glyph mode. The default is bitmap glyphs.
+        inline void SetGlyphMode(TextBuffer::GlyphMode mode) noexcept
+        { mGlyphMode = mode; }
+        inline TextBuffer::GlyphMode GetGlyphMode() const noexcept
+        { return mGlyphMode; }
+        inline const TextBuffer& GetText() const noexcept
+        { return mText; }
+
+        bool ApplyDynamicState(const Environment& env, Device& device, ProgramState& program, RasterState& state) const override;
+        ShaderSource GetShader(const Environment& env, const Device& device) const override;
+        std::string GetShaderId(const Environment& env) const override;
+        std::string GetShaderName(const Environment& env) const override;
+        std::string GetGeometryId(const Environment& env) const override;
+        bool Construct(const Environment& env, Device& device, Geometry::CreateArgs& create) const override;
+
+        DrawPrimitive GetDrawPrimitive() const override;
+        SpatialMode GetSpatialMode() const override;
+        Usage GetGeometryUsage() const override;
+        size_t GetGeometryHash() const override;
+        Type GetType() const override;
+    private:
+        TextBuffer mText;
+        std::string mId;
+        TextBuffer::GlyphMode mGlyphMode = TextBuffer::GlyphMode::Bitmap;
+    };
+
+} // namespace
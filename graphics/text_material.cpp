@@ -41,6 +41,15 @@ bool TextMaterial::ApplyDynamicState(const Environment& env, Device& device, Pro
 {
     raster.blending = RasterState::Blending::Transparent;
 
+    if (mGlyphAtlas && mText.GetRasterFormat() == TextBuffer::RasterFormat::Bitmap)
+    {
+        auto* texture = TextBuffer::UploadGlyphAtlas(device, mGlyphMode);
+        program.SetTexture("kTexture", 0, *texture);
+        program.SetUniform("kColor", mColor);
+        program.SetUniform("kMaterialFlags", static_cast<unsigned>(mFlags));
+        return true;
+    }
+
     const auto hash = mText.GetHash();
     const auto& gpu_id = std::to_string(hash);
     auto* texture = device.FindTexture(gpu_id);
@@ -132,7 +141,13 @@ ShaderSource TextMaterial::GetShader(const Environment& env, const Device& devic
     source.AddPreprocessorDefinition("MATERIAL_FLAGS_ENABLE_FOG",   static_cast<unsigned>(MaterialFlags::EnableFog));
 
     const auto format = mText.GetRasterFormat();
-    if (format == TextBuffer::RasterFormat::Bitmap)
+    if (IsDistanceFieldText())
+    {
+        source.LoadRawSource(glsl::fragment_distance_field_text_shader);
+        source.AddShaderSourceUri("shaders/fragment_text_distance_field_shader.glsl");
+        return source;
+    }
+    else if (format == TextBuffer::RasterFormat::Bitmap)
     {
         source.LoadRawSource(glsl::fragment_bitmap_text_shader);
         source.AddShaderSourceUri("shaders/fragment_text_bitmap_shader.glsl");
@@ -157,11 +172,15 @@ std::string TextMaterial::GetShaderId(const Environment& env) const
     size_t hash = 0;
     hash = base::hash_combine(hash, "text-shader");
     hash = base::hash_combine(hash, format);
+    if (IsDistanceFieldText())
+        hash = base::hash_combine(hash, mGlyphMode);
     return std::to_string(hash);
 }
 
 std::string TextMaterial::GetShaderName(const Environment&) const
 {
+    if (IsDistanceFieldText())
+        return "Distance Field Text Shader";
     const auto format = mText.GetRasterFormat();
     return base::FormatString("%1 Text Shader", format);
 }
@@ -176,6 +195,12 @@ void TextMaterial::InitDefaultFlags() noexcept
     TextMaterial::SetFlag(Flags::EnableLight, true);
 }
 
+bool TextMaterial::IsDistanceFieldText() const noexcept
+{
+    return mGlyphAtlas && mGlyphMode == TextBuffer::GlyphMode::DistanceField &&
+           mText.GetRasterFormat() == TextBuffer::RasterFormat::Bitmap;
+}
+
 TextMaterial CreateMaterialFromText(const std::string& text,
                                     const std::string& font,
                                     const gfx::Color4f& color,
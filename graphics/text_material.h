@@ -57,6 +57,8 @@ namespace gfx
 
         void SetColor(const Color4f& color) noexcept
         { mColor = color; }
+        const TextBuffer& GetText() const noexcept
+        { return mText; }
         // Set point sampling to true in order to use a fast filtering
         // when sampling from the texture. This should be for maximum perf
         // ideally when the geometry to be drawn matches closely with the
@@ -67,12 +69,28 @@ namespace gfx
         // The default is true.
         void SetPointSampling(bool on_off) noexcept
         { mPointSampling = on_off; }
+        // Set glyph atlas mode on in order to sample the text glyphs from
+        // the shared glyph atlas instead of a rasterized text texture.
+        // The material must then be used with a TextDrawable that provides
+        // the glyph quads. Only applies to the Bitmap raster format.
+        // The default is false.
+        void SetGlyphAtlas(bool on_off) noexcept
+        { mGlyphAtlas = on_off; }
+        // Set the type of glyphs sampled from the glyph atlas. With distance
+        // field glyphs a distance field shader is used to produce sharp text
+        // at any scale. Only applies in the glyph atlas mode.
+        // The default is bitmap glyphs.
+        void SetGlyphMode(TextBuffer::GlyphMode mode) noexcept
+        { mGlyphMode = mode; }
     private:
         void InitDefaultFlags() noexcept;
+        bool IsDistanceFieldText() const noexcept;
     private:
         TextBuffer mText;
         Color4f mColor = Color::White;
         bool mPointSampling = true;
+        bool mGlyphAtlas = false;
+        TextBuffer::GlyphMode mGlyphMode = TextBuffer::GlyphMode::Bitmap;
         std::int32_t mFlags = 0;
     };
 
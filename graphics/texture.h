@@ -88,6 +88,12 @@ namespace gfx
         // Upload the texture contents from the given CPU side buffer.
         // This will overwrite any previous contents and reshape the texture dimensions.
         virtual void Upload(const void* bytes, unsigned width, unsigned height, Format format) = 0;
+        // Upload the contents of a single mip level from the given CPU side buffer.
+        // The texture must have been uploaded first and the data must be in the
+        // texture's format. When the last (1x1) level has been uploaded the texture
+        // has a complete mip chain and doesn't need to generate mips.
+        virtual void UploadMip(unsigned mip_level, const void* bytes, size_t byte_count,
+                               unsigned mip_width, unsigned mip_height) = 0;
         // Allocate texture storage based on the texture format and dimensions.
         // The contents of the texture are unspecified and any previous contents
         // are no longer valid/available. The primary use case for this method is
@@ -0,0 +1,1118 @@
+// Copyright (C) 2020-2025 Sami Väisänen
+// Copyright (C) 2020-2025 Ensisoft http://www.ensisoft.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "config.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#include "base/assert.h"
+#include "base/logging.h"
+#include "graphics/texture_container.h"
+
+namespace {
+using Format = gfx::TextureContainer::Format;
+using u8  = std::uint8_t;
+using u16 = std::uint16_t;
+using u32 = std::uint32_t;
+using u64 = std::uint64_t;
+
+constexpr char Magic[4] = {'D', 'T', 'E', 'X'};
+constexpr u32 Version = 1;
+
+struct Header {
+    char magic[4];
+    u32 version;
+    u32 format;
+    u32 flags;
+    u32 level_count;
+    u32 reserved;
+};
+struct LevelHeader {
+    u32 width;
+    u32 height;
+    u64 offset;
+    u64 bytes;
+};
+static_assert(sizeof(Header) == 24);
+static_assert(sizeof(LevelHeader) == 24);
+
+// A block of 4x4 pixels in row major order.
+struct Block {
+    gfx::Pixel_RGBA pixels[16];
+};
+
+template<typename T>
+T Clamp(T min, T max, T value) noexcept
+{ return std::min(max, std::max(min, value)); }
+
+u8 ClampByte(int value) noexcept
+{ return static_cast<u8>(Clamp(0, 255, value)); }
+
+int ColorDistance(const gfx::Pixel_RGBA& lhs, int r, int g, int b) noexcept
+{
+    const auto dr = int(lhs.r) - r;
+    const auto dg = int(lhs.g) - g;
+    const auto db = int(lhs.b) - b;
+    return dr*dr + dg*dg + db*db;
+}
+
+Block ReadBlock(const gfx::BitmapReadView<gfx::Pixel_RGBA>& src, unsigned block_x, unsigned block_y) noexcept
+{
+    // blocks extending outside the image repeat the edge pixels.
+    const auto width  = src.GetWidth();
+    const auto height = src.GetHeight();
+    Block block;
+    for (unsigned y=0; y<4; ++y)
+    {
+        for (unsigned x=0; x<4; ++x)
+        {
+            const auto row = std::min(block_y * 4 + y, height - 1);
+            const auto col = std::min(block_x * 4 + x, width - 1);
+            src.ReadPixel(row, col, &block.pixels[y*4 + x]);
+        }
+    }
+    return block;
+}
+
+void WriteBlock(const Block& block, unsigned block_x, unsigned block_y, gfx::Bitmap<gfx::Pixel_RGBA>& dst) noexcept
+{
+    const auto width  = dst.GetWidth();
+    const auto height = dst.GetHeight();
+    for (unsigned y=0; y<4; ++y)
+    {
+        for (unsigned x=0; x<4; ++x)
+        {
+            const auto row = block_y * 4 + y;
+            const auto col = block_x * 4 + x;
+            if (row < height && col < width)
+                dst.SetPixel(row, col, block.pixels[y*4 + x]);
+        }
+    }
+}
+
+void WriteBE64(u64 value, u8* dst) noexcept
+{
+    for (int i=0; i<8; ++i)
+        dst[i] = static_cast<u8>(value >> (56 - i*8));
+}
+u64 ReadBE64(const u8* src) noexcept
+{
+    u64 value = 0;
+    for (int i=0; i<8; ++i)
+        value = (value << 8) | src[i];
+    return value;
+}
+void WriteLE16(u16 value, u8* dst) noexcept
+{
+    dst[0] = static_cast<u8>(value & 0xff);
+    dst[1] = static_cast<u8>(value >> 8);
+}
+u16 ReadLE16(const u8* src) noexcept
+{
+    return static_cast<u16>(src[0] | (src[1] << 8));
+}
+
+// ---------------------------------------------------------------------------
+// BC1 / BC3
+// ---------------------------------------------------------------------------
+
+u16 PackRGB565(int r, int g, int b) noexcept
+{
+    return static_cast<u16>(((r * 31 + 127) / 255) << 11 |
+                            ((g * 63 + 127) / 255) << 5 |
+                            ((b * 31 + 127) / 255));
+}
+void UnpackRGB565(u16 value, int* r, int* g, int* b) noexcept
+{
+    const int r5 = (value >> 11) & 0x1f;
+    const int g6 = (value >> 5) & 0x3f;
+    const int b5 = value & 0x1f;
+    *r = (r5 << 3) | (r5 >> 2);
+    *g = (g6 << 2) | (g6 >> 4);
+    *b = (b5 << 3) | (b5 >> 2);
+}
+
+void GetBC1Palette(u16 c0, u16 c1, bool four_color, gfx::Pixel_RGBA palette[4]) noexcept
+{
+    int r0, g0, b0, r1, g1, b1;
+    UnpackRGB565(c0, &r0, &g0, &b0);
+    UnpackRGB565(c1, &r1, &g1, &b1);
+    palette[0] = gfx::Pixel_RGBA(r0, g0, b0, 255);
+    palette[1] = gfx::Pixel_RGBA(r1, g1, b1, 255);
+    if (four_color)
+    {
+        palette[2] = gfx::Pixel_RGBA((2*r0 + r1) / 3, (2*g0 + g1) / 3, (2*b0 + b1) / 3, 255);
+        palette[3] = gfx::Pixel_RGBA((r0 + 2*r1) / 3, (g0 + 2*g1) / 3, (b0 + 2*b1) / 3, 255);
+    }
+    else
+    {
+        palette[2] = gfx::Pixel_RGBA((r0 + r1) / 2, (g0 + g1) / 2, (b0 + b1) / 2, 255);
+        palette[3] = gfx::Pixel_RGBA(0, 0, 0, 0);
+    }
+}
+
+// Encode the color part of a BC1/BC3 block. In BC3 the color block
+// is always decoded in the 4 color mode. In BC1 pixels with alpha
+// below 128 are encoded as transparent using the 3 color mode.
+void EncodeBC1Color(const Block& block, bool allow_alpha, u8* dst) noexcept
+{
+    bool has_alpha = false;
+    int min[3] = {255, 255, 255};
+    int max[3] = {0, 0, 0};
+    for (const auto& p : block.pixels)
+    {
+        if (allow_alpha && p.a < 128)
+        {
+            has_alpha = true;
+            continue;
+        }
+        min[0] = std::min(min[0], int(p.r));
+        min[1] = std::min(min[1], int(p.g));
+        min[2] = std::min(min[2], int(p.b));
+        max[0] = std::max(max[0], int(p.r));
+        max[1] = std::max(max[1], int(p.g));
+        max[2] = std::max(max[2], int(p.b));
+    }
+    if (min[0] > max[0])
+    {
+        // all pixels are transparent.
+        min[0] = min[1] = min[2] = 0;
+        max[0] = max[1] = max[2] = 0;
+    }
+
+    // inset the bounding box slightly to reduce the error
+    // caused by the end points being pulled by outliers.
+    for (int i=0; i<3; ++i)
+    {
+        const auto inset = (max[i] - min[i]) / 16;
+        min[i] += inset;
+        max[i] -= inset;
+    }
+
+    u16 c0 = PackRGB565(max[0], max[1], max[2]);
+    u16 c1 = PackRGB565(min[0], min[1], min[2]);
+    // 4 color mode requires c0 > c1, 3 color mode c0 <= c1.
+    if (has_alpha)
+    {
+        if (c0 > c1)
+            std::swap(c0, c1);
+    }
+    else
+    {
+        if (c0 < c1)
+            std::swap(c0, c1);
+    }
+
+    const bool four_color = c0 > c1 || !allow_alpha;
+    gfx::Pixel_RGBA palette[4];
+    GetBC1Palette(c0, c1, four_color, palette);
+
+    u32 indices = 0;
+    for (unsigned i=0; i<16; ++i)
+    {
+        const auto& p = block.pixels[i];
+        u32 best_index = 0;
+        if (has_alpha && p.a < 128)
+        {
+            best_index = 3;
+        }
+        else
+        {
+            const unsigned palette_size = (four_color || c0 == c1) ? 4 : 3;
+            int best_distance = std::numeric_limits<int>::max();
+            for (unsigned j=0; j<palette_size; ++j)
+            {
+                const auto distance = ColorDistance(p, palette[j].r, palette[j].g, palette[j].b);
+                if (distance < best_distance)
+                {
+                    best_distance = distance;
+                    best_index = j;
+                }
+            }
+            // in the 3 color mode index 3 is transparent black.
+            if (!four_color && best_index == 3)
+                best_index = 0;
+        }
+        indices |= best_index << (i * 2);
+    }
+    WriteLE16(c0, dst + 0);
+    WriteLE16(c1, dst + 2);
+    dst[4] = static_cast<u8>(indices >> 0);
+    dst[5] = static_cast<u8>(indices >> 8);
+    dst[6] = static_cast<u8>(indices >> 16);
+    dst[7] = static_cast<u8>(indices >> 24);
+}
+
+void DecodeBC1Color(const u8* src, bool allow_alpha, Block* block) noexcept
+{
+    const auto c0 = ReadLE16(src + 0);
+    const auto c1 = ReadLE16(src + 2);
+    const u32 indices = u32(src[4]) | u32(src[5]) << 8 | u32(src[6]) << 16 | u32(src[7]) << 24;
+
+    gfx::Pixel_RGBA palette[4];
+    GetBC1Palette(c0, c1, c0 > c1 || !allow_alpha, palette);
+    for (unsigned i=0; i<16; ++i)
+    {
+        block->pixels[i] = palette[(indices >> (i * 2)) & 0x3];
+    }
+}
+
+void GetBC3AlphaPalette(int a0, int a1, int palette[8]) noexcept
+{
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1)
+    {
+        for (int i=1; i<7; ++i)
+            palette[i+1] = ((7 - i) * a0 + i * a1) / 7;
+    }
+    else
+    {
+        for (int i=1; i<5; ++i)
+            palette[i+1] = ((5 - i) * a0 + i * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+void EncodeBC3Alpha(const Block& block, u8* dst) noexcept
+{
+    int min = 255;
+    int max = 0;
+    for (const auto& p : block.pixels)
+    {
+        min = std::min(min, int(p.a));
+        max = std::max(max, int(p.a));
+    }
+    // use the 8 alpha mode where a0 > a1
+    const int a0 = max;
+    const int a1 = min;
+    int palette[8];
+    GetBC3AlphaPalette(a0, a1, palette);
+
+    u64 indices = 0;
+    for (unsigned i=0; i<16; ++i)
+    {
+        const int alpha = block.pixels[i].a;
+        u64 best_index = 0;
+        int best_distance = std::numeric_limits<int>::max();
+        for (unsigned j=0; j<8; ++j)
+        {
+            const auto distance = std::abs(palette[j] - alpha);
+            if (distance < best_distance)
+            {
+                best_distance = distance;
+                best_index = j;
+            }
+        }
+        indices |= best_index << (i * 3);
+    }
+    dst[0] = static_cast<u8>(a0);
+    dst[1] = static_cast<u8>(a1);
+    for (int i=0; i<6; ++i)
+        dst[2 + i] = static_cast<u8>(indices >> (i * 8));
+}
+
+void DecodeBC3Alpha(const u8* src, Block* block) noexcept
+{
+    int palette[8];
+    GetBC3AlphaPalette(src[0], src[1], palette);
+
+    u64 indices = 0;
+    for (int i=0; i<6; ++i)
+        indices |= u64(src[2 + i]) << (i * 8);
+
+    for (unsigned i=0; i<16; ++i)
+    {
+        block->pixels[i].a = static_cast<u8>(palette[(indices >> (i * 3)) & 0x7]);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// ETC2 / EAC
+// ---------------------------------------------------------------------------
+
+constexpr int ETC1ModifierTable[8][2] = {
+    {2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}
+};
+constexpr int ETC2DistanceTable[8] = {
+    3, 6, 11, 16, 23, 32, 41, 64
+};
+constexpr int EACModifierTable[16][8] = {
+    {-3, -6,  -9, -15, 2, 5, 8, 14},
+    {-3, -7, -10, -13, 2, 6, 9, 12},
+    {-2, -5,  -8, -13, 1, 4, 7, 12},
+    {-2, -4,  -6, -13, 1, 3, 5, 12},
+    {-3, -6,  -8, -12, 2, 5, 7, 11},
+    {-3, -7,  -9, -11, 2, 6, 8, 10},
+    {-4, -7,  -8, -11, 3, 6, 7, 10},
+    {-3, -5,  -8, -11, 2, 4, 7, 10},
+    {-2, -6,  -8, -10, 1, 5, 7,  9},
+    {-2, -5,  -8, -10, 1, 4, 7,  9},
+    {-2, -4,  -8, -10, 1, 3, 7,  9},
+    {-2, -5,  -7, -10, 1, 4, 6,  9},
+    {-3, -4,  -7, -10, 2, 3, 6,  9},
+    {-1, -2,  -3, -10, 0, 1, 2,  9},
+    {-4, -6,  -8,  -9, 3, 5, 7,  8},
+    {-3, -5,  -7,  -9, 2, 4, 6,  8}
+};
+
+inline unsigned Bits(u64 value, unsigned high, unsigned low) noexcept
+{
+    return static_cast<unsigned>((value >> low) & ((u64(1) << (high - low + 1)) - 1));
+}
+inline int Extend4(unsigned value) noexcept
+{ return int((value << 4) | value); }
+inline int Extend5(unsigned value) noexcept
+{ return int((value << 3) | (value >> 2)); }
+inline int Extend6(unsigned value) noexcept
+{ return int((value << 2) | (value >> 4)); }
+inline int Extend7(unsigned value) noexcept
+{ return int((value << 1) | (value >> 6)); }
+
+// ETC pixels are indexed in column major order.
+inline unsigned GetETCPixelIndex(u64 block, unsigned x, unsigned y) noexcept
+{
+    const auto bit = x * 4 + y;
+    const auto msb = (block >> (16 + bit)) & 1;
+    const auto lsb = (block >> bit) & 1;
+    return static_cast<unsigned>((msb << 1) | lsb);
+}
+
+void DecodeETC2Color(const u8* src, Block* out) noexcept
+{
+    const auto block = ReadBE64(src);
+    const bool diff  = Bits(block, 33, 33);
+    const bool flip  = Bits(block, 32, 32);
+
+    int base[2][3];
+    if (diff)
+    {
+        const int r = int(Bits(block, 63, 59));
+        const int g = int(Bits(block, 55, 51));
+        const int b = int(Bits(block, 47, 43));
+        // 3 bit two's complement deltas
+        const int dr = int(Bits(block, 58, 56) ^ 4) - 4;
+        const int dg = int(Bits(block, 50, 48) ^ 4) - 4;
+        const int db = int(Bits(block, 42, 40) ^ 4) - 4;
+
+        if (r + dr < 0 || r + dr > 31)
+        {
+            // T mode
+            const unsigned r1 = Bits(block, 60, 59) << 2 | Bits(block, 57, 56);
+            const int c1[3] = { Extend4(r1), Extend4(Bits(block, 55, 52)), Extend4(Bits(block, 51, 48)) };
+            const int c2[3] = { Extend4(Bits(block, 47, 44)), Extend4(Bits(block, 43, 40)), Extend4(Bits(block, 39, 36)) };
+            const int d = ETC2DistanceTable[Bits(block, 35, 34) << 1 | Bits(block, 32, 32)];
+            gfx::Pixel_RGBA paint[4];
+            paint[0] = gfx::Pixel_RGBA(c1[0], c1[1], c1[2], 255);
+            paint[1] = gfx::Pixel_RGBA(ClampByte(c2[0] + d), ClampByte(c2[1] + d), ClampByte(c2[2] + d), 255);
+            paint[2] = gfx::Pixel_RGBA(c2[0], c2[1], c2[2], 255);
+            paint[3] = gfx::Pixel_RGBA(ClampByte(c2[0] - d), ClampByte(c2[1] - d), ClampByte(c2[2] - d), 255);
+            for (unsigned y=0; y<4; ++y)
+                for (unsigned x=0; x<4; ++x)
+                    out->pixels[y*4 + x] = paint[GetETCPixelIndex(block, x, y)];
+            return;
+        }
+        else if (g + dg < 0 || g + dg > 31)
+        {
+            // H mode
+            const unsigned r1 = Bits(block, 62, 59);
+            const unsigned g1 = Bits(block, 58, 56) << 1 | Bits(block, 52, 52);
+            const unsigned b1 = Bits(block, 51, 51) << 3 | Bits(block, 49, 47);
+            const unsigned r2 = Bits(block, 46, 43);
+            const unsigned g2 = Bits(block, 42, 39);
+            const unsigned b2 = Bits(block, 38, 35);
+            const unsigned v1 = r1 << 8 | g1 << 4 | b1;
+            const unsigned v2 = r2 << 8 | g2 << 4 | b2;
+            const int d = ETC2DistanceTable[Bits(block, 34, 34) << 2 | Bits(block, 32, 32) << 1 | (v1 >= v2 ? 1 : 0)];
+            const int c1[3] = { Extend4(r1), Extend4(g1), Extend4(b1) };
+            const int c2[3] = { Extend4(r2), Extend4(g2), Extend4(b2) };
+            gfx::Pixel_RGBA paint[4];
+            paint[0] = gfx::Pixel_RGBA(ClampByte(c1[0] + d), ClampByte(c1[1] + d), ClampByte(c1[2] + d), 255);
+            paint[1] = gfx::Pixel_RGBA(ClampByte(c1[0] - d), ClampByte(c1[1] - d), ClampByte(c1[2] - d), 255);
+            paint[2] = gfx::Pixel_RGBA(ClampByte(c2[0] + d), ClampByte(c2[1] + d), ClampByte(c2[2] + d), 255);
+            paint[3] = gfx::Pixel_RGBA(ClampByte(c2[0] - d), ClampByte(c2[1] - d), ClampByte(c2[2] - d), 255);
+            for (unsigned y=0; y<4; ++y)
+                for (unsigned x=0; x<4; ++x)
+                    out->pixels[y*4 + x] = paint[GetETCPixelIndex(block, x, y)];
+            return;
+        }
+        else if (b + db < 0 || b + db > 31)
+        {
+            // planar mode
+            const int ro = Extend6(Bits(block, 62, 57));
+            const int go = Extend7(Bits(block, 56, 56) << 6 | Bits(block, 54, 49));
+            const int bo = Extend6(Bits(block, 48, 48) << 5 | Bits(block, 44, 43) << 3 | Bits(block, 41, 39));
+            const int rh = Extend6(Bits(block, 38, 34) << 1 | Bits(block, 32, 32));
+            const int gh = Extend7(Bits(block, 31, 25));
+            const int bh = Extend6(Bits(block, 24, 19));
+            const int rv = Extend6(Bits(block, 18, 13));
+            const int gv = Extend7(Bits(block, 12, 6));
+            const int bv = Extend6(Bits(block, 5, 0));
+            for (int y=0; y<4; ++y)
+            {
+                for (int x=0; x<4; ++x)
+                {
+                    auto& p = out->pixels[y*4 + x];
+                    p.r = ClampByte((x * (rh - ro) + y * (rv - ro) + 4 * ro + 2) >> 2);
+                    p.g = ClampByte((x * (gh - go) + y * (gv - go) + 4 * go + 2) >> 2);
+                    p.b = ClampByte((x * (bh - bo) + y * (bv - bo) + 4 * bo + 2) >> 2);
+                    p.a = 255;
+                }
+            }
+            return;
+        }
+        base[0][0] = Extend5(r);
+        base[0][1] = Extend5(g);
+        base[0][2] = Extend5(b);
+        base[1][0] = Extend5(r + dr);
+        base[1][1] = Extend5(g + dg);
+        base[1][2] = Extend5(b + db);
+    }
+    else
+    {
+        base[0][0] = Extend4(Bits(block, 63, 60));
+        base[1][0] = Extend4(Bits(block, 59, 56));
+        base[0][1] = Extend4(Bits(block, 55, 52));
+        base[1][1] = Extend4(Bits(block, 51, 48));
+        base[0][2] = Extend4(Bits(block, 47, 44));
+        base[1][2] = Extend4(Bits(block, 43, 40));
+    }
+    const unsigned table[2] = { Bits(block, 39, 37), Bits(block, 36, 34) };
+
+    for (unsigned y=0; y<4; ++y)
+    {
+        for (unsigned x=0; x<4; ++x)
+        {
+            const auto sub = flip ? (y >= 2) : (x >= 2);
+            const auto index = GetETCPixelIndex(block, x, y);
+            const auto* modifiers = ETC1ModifierTable[table[sub]];
+            const auto modifier = (index & 1) ? modifiers[1] : modifiers[0];
+            const auto delta = (index & 2) ? -modifier : modifier;
+            auto& p = out->pixels[y*4 + x];
+            p.r = ClampByte(base[sub][0] + delta);
+            p.g = ClampByte(base[sub][1] + delta);
+            p.b = ClampByte(base[sub][2] + delta);
+            p.a = 255;
+        }
+    }
+}
+
+// Find the best modifier table and pixel modifiers for the given
+// sub-block pixels and base color. Returns the total error.
+int FitETC1SubBlock(const Block& block, bool flip, unsigned sub, const int base[3],
+                    unsigned* best_table, unsigned pixel_indices[16]) noexcept
+{
+    int best_error = std::numeric_limits<int>::max();
+    for (unsigned t=0; t<8; ++t)
+    {
+        int error = 0;
+        unsigned indices[16] = {0};
+        for (unsigned y=0; y<4; ++y)
+        {
+            for (unsigned x=0; x<4; ++x)
+            {
+                const auto pixel_sub = flip ? (y >= 2) : (x >= 2);
+                if (pixel_sub != sub)
+                    continue;
+                const auto& p = block.pixels[y*4 + x];
+                int best_pixel_error = std::numeric_limits<int>::max();
+                for (unsigned i=0; i<4; ++i)
+                {
+                    const auto modifier = (i & 1) ? ETC1ModifierTable[t][1] : ETC1ModifierTable[t][0];
+                    const auto delta = (i & 2) ? -modifier : modifier;
+                    const auto pixel_error = ColorDistance(p, ClampByte(base[0] + delta),
+                                                              ClampByte(base[1] + delta),
+                                                              ClampByte(base[2] + delta));
+                    if (pixel_error < best_pixel_error)
+                    {
+                        best_pixel_error = pixel_error;
+                        indices[y*4 + x] = i;
+                    }
+                }
+                error += best_pixel_error;
+            }
+        }
+        if (error < best_error)
+        {
+            best_error = error;
+            *best_table = t;
+            for (unsigned i=0; i<16; ++i)
+            {
+                const auto pixel_sub = flip ? (i / 4 >= 2) : (i % 4 >= 2);
+                if (pixel_sub == sub)
+                    pixel_indices[i] = indices[i];
+            }
+        }
+    }
+    return best_error;
+}
+
+// Encode using the ETC1 compatible individual and differential
+// modes which are a subset of ETC2.
+void EncodeETC2Color(const Block& block, u8* dst) noexcept
+{
+    u64 best_block = 0;
+    int best_error = std::numeric_limits<int>::max();
+
+    for (unsigned flip=0; flip<2; ++flip)
+    {
+        int average[2][3] = {};
+        for (unsigned y=0; y<4; ++y)
+        {
+            for (unsigned x=0; x<4; ++x)
+            {
+                const auto sub = flip ? (y >= 2) : (x >= 2);
+                const auto& p = block.pixels[y*4 + x];
+                average[sub][0] += p.r;
+                average[sub][1] += p.g;
+                average[sub][2] += p.b;
+            }
+        }
+        for (auto& sub : average)
+            for (auto& channel : sub)
+                channel = (channel + 4) / 8;
+
+        // try differential mode first since it has more color precision.
+        int q5[2][3];
+        bool differential = true;
+        for (unsigned c=0; c<3; ++c)
+        {
+            q5[0][c] = (average[0][c] * 31 + 127) / 255;
+            q5[1][c] = (average[1][c] * 31 + 127) / 255;
+            const auto delta = q5[1][c] - q5[0][c];
+            if (delta < -4 || delta > 3)
+                differential = false;
+        }
+
+        int base[2][3];
+        u64 bits = 0;
+        if (differential)
+        {
+            for (unsigned c=0; c<3; ++c)
+            {
+                base[0][c] = Extend5(q5[0][c]);
+                base[1][c] = Extend5(q5[1][c]);
+            }
+            const auto dr = u64((q5[1][0] - q5[0][0]) & 7);
+            const auto dg = u64((q5[1][1] - q5[0][1]) & 7);
+            const auto db = u64((q5[1][2] - q5[0][2]) & 7);
+            bits |= u64(q5[0][0]) << 59 | dr << 56;
+            bits |= u64(q5[0][1]) << 51 | dg << 48;
+            bits |= u64(q5[0][2]) << 43 | db << 40;
+            bits |= u64(1) << 33;
+        }
+        else
+        {
+            int q4[2][3];
+            for (unsigned c=0; c<3; ++c)
+            {
+                q4[0][c] = (average[0][c] * 15 + 127) / 255;
+                q4[1][c] = (average[1][c] * 15 + 127) / 255;
+                base[0][c] = Extend4(q4[0][c]);
+                base[1][c] = Extend4(q4[1][c]);
+            }
+            bits |= u64(q4[0][0]) << 60 | u64(q4[1][0]) << 56;
+            bits |= u64(q4[0][1]) << 52 | u64(q4[1][1]) << 48;
+            bits |= u64(q4[0][2]) << 44 | u64(q4[1][2]) << 40;
+        }
+
+        unsigned table[2] = {0, 0};
+        unsigned indices[16] = {0};
+        int error = 0;
+        error += FitETC1SubBlock(block, flip, 0, base[0], &table[0], indices);
+        error += FitETC1SubBlock(block, flip, 1, base[1], &table[1], indices);
+        if (error >= best_error)
+            continue;
+
+        bits |= u64(table[0]) << 37 | u64(table[1]) << 34;
+        bits |= u64(flip) << 32;
+        for (unsigned y=0; y<4; ++y)
+        {
+            for (unsigned x=0; x<4; ++x)
+            {
+                const auto index = indices[y*4 + x];
+                const auto bit = x * 4 + y;
+                bits |= u64(index >> 1) << (16 + bit);
+                bits |= u64(index & 1) << bit;
+            }
+        }
+        best_error = error;
+        best_block = bits;
+    }
+    WriteBE64(best_block, dst);
+}
+
+void EncodeEACAlpha(const Block& block, u8* dst) noexcept
+{
+    int min = 255;
+    int max = 0;
+    for (const auto& p : block.pixels)
+    {
+        min = std::min(min, int(p.a));
+        max = std::max(max, int(p.a));
+    }
+    const int base = (min + max + 1) / 2;
+
+    u64 best_block = 0;
+    int best_error = std::numeric_limits<int>::max();
+    for (unsigned table=0; table<16 && best_error; ++table)
+    {
+        for (unsigned multiplier=1; multiplier<16 && best_error; ++multiplier)
+        {
+            int error = 0;
+            u64 bits = u64(base) << 56 | u64(multiplier) << 52 | u64(table) << 48;
+            for (unsigned y=0; y<4; ++y)
+            {
+                for (unsigned x=0; x<4; ++x)
+                {
+                    const int alpha = block.pixels[y*4 + x].a;
+                    int best_pixel_error = std::numeric_limits<int>::max();
+                    unsigned best_index = 0;
+                    for (unsigned i=0; i<8; ++i)
+                    {
+                        const auto value = ClampByte(base + EACModifierTable[table][i] * int(multiplier));
+                        const auto pixel_error = std::abs(int(value) - alpha);
+                        if (pixel_error < best_pixel_error)
+                        {
+                            best_pixel_error = pixel_error;
+                            best_index = i;
+                        }
+                    }
+                    // column major, first pixel in the most significant bits.
+                    const auto pixel = x * 4 + y;
+                    bits |= u64(best_index) << (45 - pixel * 3);
+                    error += best_pixel_error * best_pixel_error;
+                }
+            }
+            if (error < best_error)
+            {
+                best_error = error;
+                best_block = bits;
+            }
+        }
+    }
+    WriteBE64(best_block, dst);
+}
+
+void DecodeEACAlpha(const u8* src, Block* out) noexcept
+{
+    const auto block = ReadBE64(src);
+    const int base = int(Bits(block, 63, 56));
+    const int multiplier = int(Bits(block, 55, 52));
+    const auto* modifiers = EACModifierTable[Bits(block, 51, 48)];
+    for (unsigned y=0; y<4; ++y)
+    {
+        for (unsigned x=0; x<4; ++x)
+        {
+            const auto pixel = x * 4 + y;
+            const auto index = Bits(block, 47 - pixel * 3, 45 - pixel * 3);
+            out->pixels[y*4 + x].a = ClampByte(base + modifiers[index] * multiplier);
+        }
+    }
+}
+
+std::size_t GetBlockByteSize(Format format) noexcept
+{
+    if (format == Format::BC1 || format == Format::ETC2_RGB)
+        return 8;
+    else if (format == Format::BC3 || format == Format::ETC2_RGBA)
+        return 16;
+    return 0;
+}
+
+unsigned GetPixelByteSize(Format format) noexcept
+{
+    if (format == Format::AlphaMask)
+        return 1;
+    else if (format == Format::RGB)
+        return 3;
+    else if (format == Format::RGBA)
+        return 4;
+    return 0;
+}
+
+dev::TextureFormat MapTextureFormat(Format format, bool srgb) noexcept
+{
+    if (format == Format::BC1)
+        return srgb ? dev::TextureFormat::BC1_sRGB : dev::TextureFormat::BC1_RGB;
+    else if (format == Format::BC3)
+        return srgb ? dev::TextureFormat::BC3_sRGBA : dev::TextureFormat::BC3_RGBA;
+    else if (format == Format::ETC2_RGB)
+        return srgb ? dev::TextureFormat::ETC2_sRGB : dev::TextureFormat::ETC2_RGB;
+    else if (format == Format::ETC2_RGBA)
+        return srgb ? dev::TextureFormat::ETC2_sRGBA : dev::TextureFormat::ETC2_RGBA;
+    else if (format == Format::RGB)
+        return srgb ? dev::TextureFormat::sRGB : dev::TextureFormat::RGB;
+    else if (format == Format::RGBA)
+        return srgb ? dev::TextureFormat::sRGBA : dev::TextureFormat::RGBA;
+    return dev::TextureFormat::AlphaMask;
+}
+
+} // namespace
+
+namespace gfx
+{
+
+bool TextureContainer::Encode(const IBitmap& bitmap, Format format, bool generate_mips)
+{
+    const auto depth = bitmap.GetDepthBits();
+    if (!bitmap.IsValid() || bitmap.GetWidth() == 0 || bitmap.GetHeight() == 0)
+        return false;
+
+    if (IsCompressed(format))
+    {
+        if (depth != 24 && depth != 32)
+        {
+            ERROR("Block compressed texture requires an RGB or RGBA bitmap. [depth=%1]", depth);
+            return false;
+        }
+    }
+    else if (depth != GetPixelByteSize(format) * 8)
+    {
+        ERROR("Texture container format doesn't match the bitmap depth. [format=%1, depth=%2]", format, depth);
+        return false;
+    }
+
+    const auto srgb = TestFlag(Flags::sRGB);
+
+    std::vector<Level> levels;
+    std::unique_ptr<IBitmap> mip;
+    const IBitmap* level_bitmap = &bitmap;
+    while (true)
+    {
+        Level level;
+        level.width  = level_bitmap->GetWidth();
+        level.height = level_bitmap->GetHeight();
+        if (IsCompressed(format))
+        {
+            Bitmap<Pixel_RGBA> rgba(level.width, level.height);
+            const auto view = level_bitmap->GetReadView();
+            for (unsigned row=0; row<level.height; ++row)
+            {
+                for (unsigned col=0; col<level.width; ++col)
+                {
+                    Pixel_RGBA pixel;
+                    view->ReadPixel(row, col, &pixel);
+                    rgba.SetPixel(row, col, pixel);
+                }
+            }
+            level.data = CompressTexture(rgba.GetPixelReadView(), format);
+        }
+        else
+        {
+            const auto* ptr = static_cast<const std::uint8_t*>(level_bitmap->GetDataPtr());
+            level.data.assign(ptr, ptr + GetLevelByteSize(format, level.width, level.height));
+        }
+        levels.push_back(std::move(level));
+
+        if (!generate_mips)
+            break;
+        if (level_bitmap->GetWidth() == 1 && level_bitmap->GetHeight() == 1)
+            break;
+
+        mip = GenerateNextMipmap(*level_bitmap, srgb);
+        if (!mip)
+        {
+            ERROR("Failed to generate texture container mip level. [level=%1]", levels.size());
+            return false;
+        }
+        level_bitmap = mip.get();
+    }
+    mFormat = format;
+    mLevels = std::move(levels);
+    return true;
+}
+
+std::unique_ptr<IBitmap> TextureContainer::Decode(unsigned level) const
+{
+    ASSERT(level < mLevels.size());
+    const auto& data = mLevels[level];
+
+    if (IsCompressed(mFormat))
+        return std::make_unique<RgbaBitmap>(DecompressTexture(data.data.data(), data.data.size(),
+                                                              data.width, data.height, mFormat));
+    else if (mFormat == Format::RGBA)
+        return std::make_unique<RgbaBitmap>((const Pixel_RGBA*)data.data.data(), data.width, data.height);
+    else if (mFormat == Format::RGB)
+        return std::make_unique<RgbBitmap>((const Pixel_RGB*)data.data.data(), data.width, data.height);
+    else if (mFormat == Format::AlphaMask)
+        return std::make_unique<AlphaMask>((const Pixel_A*)data.data.data(), data.width, data.height);
+
+    BUG("Unhandled texture container format.");
+    return nullptr;
+}
+
+bool TextureContainer::Upload(Texture* texture, const dev::GraphicsDeviceCaps& caps) const
+{
+    if (mLevels.empty())
+        return false;
+
+    const auto srgb = TestFlag(Flags::sRGB);
+
+    if (IsFormatSupported(mFormat, srgb, caps))
+    {
+        const auto texture_format = MapTextureFormat(mFormat, srgb);
+        const auto& base = mLevels[0];
+        texture->Upload(base.data.data(), base.width, base.height, texture_format);
+        for (unsigned i=1; i<mLevels.size(); ++i)
+        {
+            const auto& level = mLevels[i];
+            texture->UploadMip(i, level.data.data(), level.data.size(), level.width, level.height);
+        }
+        return true;
+    }
+
+    // transcode on the CPU. RGB is enough for the formats without alpha.
+    const auto has_alpha = mFormat == Format::BC3 || mFormat == Format::ETC2_RGBA || mFormat == Format::BC1;
+    const auto texture_format = srgb ? (has_alpha ? Texture::Format::sRGBA : Texture::Format::sRGB)
+                                     : (has_alpha ? Texture::Format::RGBA : Texture::Format::RGB);
+    DEBUG("Transcoding texture container data. [format=%1, size=%2x%3]", mFormat, GetWidth(), GetHeight());
+
+    for (unsigned i=0; i<mLevels.size(); ++i)
+    {
+        const auto& level = mLevels[i];
+        auto bitmap = DecompressTexture(level.data.data(), level.data.size(), level.width, level.height, mFormat);
+        if (has_alpha)
+        {
+            if (i == 0)
+                texture->Upload(bitmap.GetDataPtr(), level.width, level.height, texture_format);
+            else texture->UploadMip(i, bitmap.GetDataPtr(), level.width * level.height * 4, level.width, level.height);
+        }
+        else
+        {
+            Bitmap<Pixel_RGB> rgb(level.width, level.height);
+            ReinterpretBitmap(rgb.GetPixelWriteView(), bitmap.GetPixelReadView());
+            if (i == 0)
+                texture->Upload(rgb.GetDataPtr(), level.width, level.height, texture_format);
+            else texture->UploadMip(i, rgb.GetDataPtr(), level.width * level.height * 3, level.width, level.height);
+        }
+    }
+    return true;
+}
+
+bool TextureContainer::FromMemory(const void* data, std::size_t bytes)
+{
+    const auto* ptr = static_cast<const std::uint8_t*>(data);
+    if (bytes < sizeof(Header))
+        return false;
+
+    Header header;
+    std::memcpy(&header, ptr, sizeof(header));
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)))
+        return false;
+    if (header.version != Version)
+    {
+        ERROR("Unsupported texture container version. [version=%1]", header.version);
+        return false;
+    }
+    if (header.format > static_cast<u32>(Format::ETC2_RGBA))
+    {
+        ERROR("Unsupported texture container format. [format=%1]", header.format);
+        return false;
+    }
+    const auto format = static_cast<Format>(header.format);
+    if (header.level_count == 0 || header.level_count > (bytes - sizeof(Header)) / sizeof(LevelHeader))
+        return false;
+
+    std::vector<Level> levels;
+    for (unsigned i=0; i<header.level_count; ++i)
+    {
+        LevelHeader level_header;
+        std::memcpy(&level_header, ptr + sizeof(Header) + i * sizeof(LevelHeader), sizeof(LevelHeader));
+        // the offset and size come from the file, careful not to overflow.
+        if (level_header.offset > bytes || level_header.bytes > bytes - level_header.offset)
+            return false;
+        if (i == 0)
+        {
+            if (level_header.width == 0 || level_header.height == 0)
+                return false;
+        }
+        else
+        {
+            // every mip level is half the size of the previous level
+            // and the chain ends at 1x1.
+            const auto& prev = levels.back();
+            if (prev.width == 1 && prev.height == 1)
+                return false;
+            if (level_header.width != std::max(1u, levels[0].width >> i) ||
+                level_header.height != std::max(1u, levels[0].height >> i))
+                return false;
+        }
+        if (level_header.bytes != GetLevelByteSize(format, level_header.width, level_header.height))
+            return false;
+
+        Level level;
+        level.width  = level_header.width;
+        level.height = level_header.height;
+        level.data.assign(ptr + level_header.offset, ptr + level_header.offset + level_header.bytes);
+        levels.push_back(std::move(level));
+    }
+    mFormat = format;
+    mFlags.set_from_value(header.flags);
+    mLevels = std::move(levels);
+    return true;
+}
+
+std::vector<std::uint8_t> TextureContainer::ToMemory() const
+{
+    Header header;
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version     = Version;
+    header.format      = static_cast<u32>(mFormat);
+    header.flags       = static_cast<u32>(mFlags.value());
+    header.level_count = static_cast<u32>(mLevels.size());
+    header.reserved    = 0;
+
+    std::size_t offset = sizeof(Header) + mLevels.size() * sizeof(LevelHeader);
+    std::size_t size = offset;
+    for (const auto& level : mLevels)
+        size += level.data.size();
+
+    std::vector<std::uint8_t> ret;
+    ret.resize(size);
+    std::memcpy(&ret[0], &header, sizeof(header));
+    for (unsigned i=0; i<mLevels.size(); ++i)
+    {
+        const auto& level = mLevels[i];
+        LevelHeader level_header;
+        level_header.width  = level.width;
+        level_header.height = level.height;
+        level_header.offset = offset;
+        level_header.bytes  = level.data.size();
+        std::memcpy(&ret[sizeof(Header) + i * sizeof(LevelHeader)], &level_header, sizeof(level_header));
+        std::memcpy(&ret[offset], level.data.data(), level.data.size());
+        offset += level.data.size();
+    }
+    return ret;
+}
+
+// static
+bool TextureContainer::IsFormatSupported(Format format, bool srgb, const dev::GraphicsDeviceCaps& caps) noexcept
+{
+    if (format == Format::BC1 || format == Format::BC3)
+        return srgb ? caps.texture_compression_bc_srgb : caps.texture_compression_bc;
+    else if (format == Format::ETC2_RGB || format == Format::ETC2_RGBA)
+        return caps.texture_compression_etc2;
+    return true;
+}
+// static
+bool TextureContainer::IsCompressed(Format format) noexcept
+{
+    return GetBlockByteSize(format) != 0;
+}
+
+// static
+std::size_t TextureContainer::GetLevelByteSize(Format format, unsigned width, unsigned height) noexcept
+{
+    if (IsCompressed(format))
+    {
+        const auto blocks = ((std::size_t(width) + 3) / 4) * ((std::size_t(height) + 3) / 4);
+        return blocks * GetBlockByteSize(format);
+    }
+    return std::size_t(width) * height * GetPixelByteSize(format);
+}
+
+std::vector<std::uint8_t> CompressTexture(const BitmapReadView<Pixel_RGBA>& src, TextureContainer::Format format)
+{
+    ASSERT(TextureContainer::IsCompressed(format));
+
+    const auto width  = src.GetWidth();
+    const auto height = src.GetHeight();
+    const auto block_size = GetBlockByteSize(format);
+    const auto blocks_x = (width + 3) / 4;
+    const auto blocks_y = (height + 3) / 4;
+
+    std::vector<std::uint8_t> ret;
+    ret.resize(blocks_x * blocks_y * block_size);
+
+    auto* dst = ret.data();
+    for (unsigned by=0; by<blocks_y; ++by)
+    {
+        for (unsigned bx=0; bx<blocks_x; ++bx)
+        {
+            const auto& block = ReadBlock(src, bx, by);
+            if (format == Format::BC1)
+            {
+                EncodeBC1Color(block, true, dst);
+            }
+            else if (format == Format::BC3)
+            {
+                EncodeBC3Alpha(block, dst);
+                EncodeBC1Color(block, false, dst + 8);
+            }
+            else if (format == Format::ETC2_RGB)
+            {
+                EncodeETC2Color(block, dst);
+            }
+            else if (format == Format::ETC2_RGBA)
+            {
+                EncodeEACAlpha(block, dst);
+                EncodeETC2Color(block, dst + 8);
+            }
+            dst += block_size;
+        }
+    }
+    return ret;
+}
+
+Bitmap<Pixel_RGBA> DecompressTexture(const void* data, std::size_t bytes,
+                                     unsigned width, unsigned height, TextureContainer::Format format)
+{
+    ASSERT(TextureContainer::IsCompressed(format));
+    ASSERT(bytes == TextureContainer::GetLevelByteSize(format, width, height));
+
+    const auto block_size = GetBlockByteSize(format);
+    const auto blocks_x = (width + 3) / 4;
+    const auto blocks_y = (height + 3) / 4;
+
+    Bitmap<Pixel_RGBA> ret(width, height);
+
+    const auto* src = static_cast<const std::uint8_t*>(data);
+    for (unsigned by=0; by<blocks_y; ++by)
+    {
+        for (unsigned bx=0; bx<blocks_x; ++bx)
+        {
+            Block block;
+            if (format == Format::BC1)
+            {
+                DecodeBC1Color(src, true, &block);
+            }
+            else if (format == Format::BC3)
+            {
+                DecodeBC1Color(src + 8, false, &block);
+                DecodeBC3Alpha(src, &block);
+            }
+            else if (format == Format::ETC2_RGB)
+            {
+                DecodeETC2Color(src, &block);
+            }
+            else if (format == Format::ETC2_RGBA)
+            {
+                DecodeETC2Color(src + 8, &block);
+                DecodeEACAlpha(src, &block);
+            }
+            WriteBlock(block, bx, by, ret);
+            src += block_size;
+        }
+    }
+    return ret;
+}
+
+} // namespace
@@ -0,0 +1,150 @@
+// Copyright (C) 2020-2025 Sami Väisänen
+// Copyright (C) 2020-2025 Ensisoft http://www.ensisoft.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "config.h"
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+#include "base/bitflag.h"
+#include "device/types.h"
+#include "graphics/bitmap.h"
+#include "graphics/texture.h"
+
+namespace gfx
+{
+    // Packaged texture data container. The container stores the texture
+    // payload for every mip level of the texture either as uncompressed
+    // pixel data or as GPU block compressed data. This lets the texture
+    // be uploaded as-is without having to decode an image file format
+    // or to generate the mips at runtime.
+    //
+    // When the device doesn't support the block compressed format the
+    // payload is transcoded (decompressed) on the CPU and uploaded as
+    // an uncompressed texture instead.
+    //
+    // The binary layout is a simple header followed by a level index and
+    // then the level payloads. All values are little endian.
+    class TextureContainer
+    {
+    public:
+        // The file extension used for texture containers.
+        static constexpr const char* FileExtension = ".dtex";
+
+        // The payload format. These values are persisted, don't change them.
+        enum class Format : std::uint32_t {
+            // 8bit alpha only.
+            AlphaMask = 0,
+            // 8bit RGB
+            RGB = 1,
+            // 8bit RGBA
+            RGBA = 2,
+            // BC1 (DXT1) compressed RGB, 8 bytes per 4x4 block.
+            BC1 = 3,
+            // BC3 (DXT5) compressed RGBA, 16 bytes per 4x4 block.
+            BC3 = 4,
+            // ETC2 compressed RGB, 8 bytes per 4x4 block.
+            ETC2_RGB = 5,
+            // ETC2 + EAC compressed RGBA, 16 bytes per 4x4 block.
+            ETC2_RGBA = 6
+        };
+        // The flags are persisted, only add new flags at the end.
+        enum class Flags {
+            // The color data is sRGB encoded.
+            sRGB,
+            // The color data has been pre-multiplied with alpha.
+            PremulAlpha,
+            // The RGBA data was baked from an alpha mask and the
+            // texture should be treated as a (logical) alpha mask.
+            AlphaMask,
+            // The sprite edge detection effect has been baked in.
+            EdgeEffect,
+            // The blur effect has been baked in.
+            BlurEffect
+        };
+
+        struct Level {
+            unsigned width  = 0;
+            unsigned height = 0;
+            std::vector<std::uint8_t> data;
+        };
+
+        TextureContainer() = default;
+
+        // Create the container content from the given bitmap. If generate_mips
+        // is true a complete mip chain is generated. Block compressed formats
+        // require an RGB or RGBA bitmap and uncompressed formats require a bitmap
+        // with the matching depth. Set the flags before encoding.
+        bool Encode(const IBitmap& bitmap, Format format, bool generate_mips);
+
+        // Decode (transcode) the given level into an uncompressed bitmap.
+        // Block compressed payloads are decoded into RGBA bitmaps.
+        std::unique_ptr<IBitmap> Decode(unsigned level) const;
+
+        // Upload the container content to the texture. If the device supports
+        // the payload format the data is uploaded as-is. Otherwise, the data
+        // is transcoded to an uncompressed format first.
+        bool Upload(Texture* texture, const dev::GraphicsDeviceCaps& caps) const;
+
+        // Load the container from a memory buffer. Returns false if the
+        // data is not a valid texture container.
+        bool FromMemory(const void* data, std::size_t bytes);
+        // Serialize the container into a memory buffer.
+        std::vector<std::uint8_t> ToMemory() const;
+
+        // Check whether the device supports uploading the payload format
+        // without transcoding.
+        static bool IsFormatSupported(Format format, bool srgb, const dev::GraphicsDeviceCaps& caps) noexcept;
+        // Check whether the format is a block compressed format.
+        static bool IsCompressed(Format format) noexcept;
+        // Get the payload byte size for a level of the given dimensions.
+        static std::size_t GetLevelByteSize(Format format, unsigned width, unsigned height) noexcept;
+
+        inline Format GetFormat() const noexcept
+        { return mFormat; }
+        inline unsigned GetWidth() const noexcept
+        { return mLevels.empty() ? 0 : mLevels[0].width; }
+        inline unsigned GetHeight() const noexcept
+        { return mLevels.empty() ? 0 : mLevels[0].height; }
+        inline unsigned GetLevelCount() const noexcept
+        { return static_cast<unsigned>(mLevels.size()); }
+        inline const Level& GetLevel(unsigned index) const noexcept
+        { return mLevels[index]; }
+        inline bool TestFlag(Flags flag) const noexcept
+        { return mFlags.test(flag); }
+        inline void SetFlag(Flags flag, bool on_off) noexcept
+        { mFlags.set(flag, on_off); }
+        inline bool IsValid() const noexcept
+        { return !mLevels.empty(); }
+    private:
+        Format mFormat = Format::RGBA;
+        base::bitflag<Flags> mFlags;
+        std::vector<Level> mLevels;
+    };
+
+    // Block compression codecs for the block compressed container formats.
+    // The encoders favor simplicity and speed over quality and are meant
+    // to be used offline when packaging. The decoders are used to transcode
+    // the data when the device doesn't support the format.
+    std::vector<std::uint8_t> CompressTexture(const BitmapReadView<Pixel_RGBA>& src, TextureContainer::Format format);
+    Bitmap<Pixel_RGBA> DecompressTexture(const void* data, std::size_t bytes,
+                                         unsigned width, unsigned height, TextureContainer::Format format);
+
+} // namespace
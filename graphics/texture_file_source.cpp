@@ -15,6 +15,7 @@
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "base/logging.h"
+#include "base/utility.h"
 #include "data/writer.h"
 #include "data/reader.h"
 #include "graphics/device_algo.h"
@@ -22,8 +23,29 @@
 #include "graphics/texture.h"
 #include "graphics/image.h"
 #include "graphics/texture_file_source.h"
+#include "graphics/texture_streamer.h"
+#include "graphics/texture_container.h"
+#include "graphics/loader.h"
 #include "graphics/packer.h"
 
+namespace {
+bool IsTextureContainer(const std::string& file)
+{
+    return base::EndsWith(file, gfx::TextureContainer::FileExtension);
+}
+
+bool LoadTextureContainer(const std::string& file, gfx::TextureContainer* container)
+{
+    gfx::Loader::ResourceDesc desc;
+    desc.uri  = file;
+    desc.type = gfx::Loader::Type::Image;
+    const auto& buffer = gfx::LoadResource(desc);
+    if (!buffer)
+        return false;
+    return container->FromMemory(buffer->GetData(), buffer->GetByteSize());
+}
+} // namespace
+
 namespace gfx
 {
 
@@ -74,6 +96,29 @@ Texture* TextureFileSource::Upload(const Environment& env, Device& device) const
             return texture;
     }
 
+    // texture containers have the data ready for uploading in the
+    // right format and possibly with all the mips already so there's
+    // no decoding to be done and no reason to go through the streamer.
+    if (IsTextureContainer(mFile))
+        return UploadContainer(content_hash, texture, device);
+
+    // when streaming is enabled the initial texture load is done through
+    // the streamer which decodes the data in the background. Until the data
+    // is ready for uploading a placeholder texture is used instead.
+    std::shared_ptr<const IBitmap> bitmap;
+    bool streamed = false;
+    if (auto* streamer = device.GetTextureStreamer(); streamer && !texture)
+    {
+        const auto premul = TestFlag(Flags::PremulAlpha);
+        const auto status = streamer->Stream(gpu_id, env.priority, [file=mFile, premul]() {
+            return LoadData(file, premul);
+        }, &bitmap);
+        if (status == TextureStreamer::Status::Pending)
+            return streamer->GetPlaceholder(device);
+
+        streamed = true;
+    }
+
     if (!texture)
     {
         texture = device.MakeTexture(gpu_id);
@@ -93,7 +138,10 @@ Texture* TextureFileSource::Upload(const Environment& env, Device& device) const
         return nullptr;
     }
 
-    if (const auto& bitmap = GetData())
+    if (!streamed)
+        bitmap = GetData();
+
+    if (bitmap)
     {
         const auto sRGB = mColorSpace == ColorSpace::sRGB;
         texture->SetContentHash(content_hash);
@@ -127,36 +175,179 @@ Texture* TextureFileSource::Upload(const Environment& env, Device& device) const
     return nullptr;
 }
 
+Texture* TextureFileSource::UploadContainer(size_t content_hash, Texture* texture, Device& device) const
+{
+    if (texture && texture->GetContentHash() == 0)
+        return nullptr;
+
+    const auto& gpu_id = GetGpuId();
+    if (!texture)
+    {
+        texture = device.MakeTexture(gpu_id);
+        texture->SetName(mName.empty() ? mFile : mName);
+        texture->SetContentHash(0);
+    }
+
+    TextureContainer container;
+    if (!LoadTextureContainer(mFile, &container))
+    {
+        ERROR("Failed to load texture container file. [name='%1', file='%2']", mName, mFile);
+        return nullptr;
+    }
+    // the container data has been baked offline, the effects and the alpha
+    // pre-multiplication are never applied at runtime.
+    if (TestFlag(Flags::PremulAlpha) && !container.TestFlag(TextureContainer::Flags::PremulAlpha))
+        WARN("Texture container data is not alpha pre-multiplied. [name='%1', file='%2']", mName, mFile);
+    if (mEffects.test(Effect::Edges) && !container.TestFlag(TextureContainer::Flags::EdgeEffect))
+        WARN("Texture container data doesn't have edge effect baked in. [name='%1', file='%2']", mName, mFile);
+    if (mEffects.test(Effect::Blur) && !container.TestFlag(TextureContainer::Flags::BlurEffect))
+        WARN("Texture container data doesn't have blur effect baked in. [name='%1', file='%2']", mName, mFile);
+
+    Device::DeviceCaps caps;
+    device.GetDeviceCaps(&caps);
+    if (!container.Upload(texture, caps))
+    {
+        ERROR("Failed to upload texture container. [name='%1', file='%2']", mName, mFile);
+        return nullptr;
+    }
+    texture->SetContentHash(content_hash);
+    texture->SetFilter(Texture::MinFilter::Linear);
+    texture->SetFilter(Texture::MagFilter::Linear);
+    if (container.TestFlag(TextureContainer::Flags::AlphaMask))
+        texture->SetFlag(Texture::Flags::AlphaMask, true);
+
+    // compressed textures cannot have their mips generated on the GPU.
+    if (container.GetLevelCount() == 1 && !TextureContainer::IsCompressed(container.GetFormat()))
+        texture->GenerateMips();
+
+    DEBUG("Uploaded texture container. [name='%1', file='%2', format=%3, levels=%4]", mName, mFile,
+          container.GetFormat(), container.GetLevelCount());
+    return texture;
+}
+
 std::shared_ptr<const IBitmap> TextureFileSource::GetData() const
 {
-    DEBUG("Loading texture file. [file='%1']", mFile);
-    Image file(mFile);
-    if (!file.IsValid())
+    return LoadData(mFile, TestFlag(Flags::PremulAlpha));
+}
+
+// static
+std::shared_ptr<const IBitmap> TextureFileSource::LoadData(const std::string& file, bool premultiply_alpha)
+{
+    DEBUG("Loading texture file. [file='%1']", file);
+    if (IsTextureContainer(file))
+    {
+        TextureContainer container;
+        if (!LoadTextureContainer(file, &container))
+        {
+            ERROR("Failed to load texture container file. [file='%1']", file);
+            return nullptr;
+        }
+        std::shared_ptr<IBitmap> bitmap = container.Decode(0);
+        if (!bitmap)
+        {
+            ERROR("Failed to decode texture container file. [file='%1']", file);
+            return nullptr;
+        }
+        if (premultiply_alpha && bitmap->GetDepthBits() == 32 &&
+            !container.TestFlag(TextureContainer::Flags::PremulAlpha))
+        {
+            auto ret = std::make_shared<Bitmap<Pixel_RGBA>>();
+            ret->Resize(bitmap->GetWidth(), bitmap->GetHeight());
+            PremultiplyAlpha(ret->GetPixelWriteView(), static_cast<const RgbaBitmap*>(bitmap.get())->GetPixelReadView(), true /* srgb */);
+            return ret;
+        }
+        return bitmap;
+    }
+
+    Image image(file);
+    if (!image.IsValid())
     {
-        ERROR("Failed to load texture image file. [file='%1']", mFile);
+        ERROR("Failed to load texture image file. [file='%1']", file);
         return nullptr;
     }
 
-    if (file.GetDepthBits() == 8)
-        return std::make_shared<AlphaMask>(file.AsBitmap<Pixel_A>());
-    else if (file.GetDepthBits() == 24)
-        return std::make_shared<RgbBitmap>(file.AsBitmap<Pixel_RGB>());
-    else if (file.GetDepthBits() == 32)
+    if (image.GetDepthBits() == 8)
+        return std::make_shared<AlphaMask>(image.AsBitmap<Pixel_A>());
+    else if (image.GetDepthBits() == 24)
+        return std::make_shared<RgbBitmap>(image.AsBitmap<Pixel_RGB>());
+    else if (image.GetDepthBits() == 32)
     {
-        if (!TestFlag(Flags::PremulAlpha))
-            return std::make_shared<RgbaBitmap>(file.AsBitmap<Pixel_RGBA>());
+        if (!premultiply_alpha)
+            return std::make_shared<RgbaBitmap>(image.AsBitmap<Pixel_RGBA>());
 
-        auto view = file.GetPixelReadView<Pixel_RGBA>();
+        auto view = image.GetPixelReadView<Pixel_RGBA>();
         auto ret = std::make_shared<Bitmap<Pixel_RGBA>>();
         ret->Resize(view.GetWidth(), view.GetHeight());
-        DEBUG("Performing alpha pre-multiply on texture. [file='%1']", mFile);
+        DEBUG("Performing alpha pre-multiply on texture. [file='%1']", file);
         PremultiplyAlpha(ret->GetPixelWriteView(), view, true /* srgb */);
         return ret;
     }
-    else ERROR("Unexpected texture bit depth. [file='%1', depth=%2]", mFile, file.GetDepthBits());
+    else ERROR("Unexpected texture bit depth. [file='%1', depth=%2]", file, image.GetDepthBits());
 
     return nullptr;
 }
+// static
+bool TextureFileSource::BakeData(const IBitmap& bitmap, ColorSpace colorspace, bool premultiply_alpha,
+                                 base::bitflag<Effect> effects, TextureContainer* container)
+{
+    // this should produce the same results as loading the texture
+    // file and uploading it (see Upload) except that everything is
+    // done on the CPU.
+    auto srgb = colorspace == ColorSpace::sRGB;
+    const auto depth = bitmap.GetDepthBits();
+
+    std::unique_ptr<RgbaBitmap> rgba;
+    if (depth == 32)
+    {
+        rgba = std::make_unique<RgbaBitmap>(static_cast<const RgbaBitmap&>(bitmap));
+        if (premultiply_alpha)
+            PremultiplyAlpha(rgba->GetPixelWriteView(), rgba->GetPixelReadView(), true /* srgb */);
+    }
+    else if (depth == 8 && effects.any_bit())
+    {
+        // effects need RGBA data, the alpha mask is expanded into RGBA
+        // with RGB = 0 same as when sampling an alpha texture. The result
+        // is linear RGBA and logically still an alpha mask.
+        rgba = std::make_unique<RgbaBitmap>(bitmap.GetWidth(), bitmap.GetHeight());
+        const auto& mask = static_cast<const AlphaMask&>(bitmap);
+        for (unsigned row=0; row<bitmap.GetHeight(); ++row)
+        {
+            for (unsigned col=0; col<bitmap.GetWidth(); ++col)
+            {
+                rgba->SetPixel(row, col, Pixel_RGBA(0, 0, 0, mask.GetPixel(row, col).r));
+            }
+        }
+        container->SetFlag(TextureContainer::Flags::AlphaMask, true);
+        srgb = false;
+    }
+    else if (depth != 8 && depth != 24)
+    {
+        ERROR("Unexpected texture bit depth. [depth=%1]", depth);
+        return false;
+    }
+
+    if (rgba)
+    {
+        if (effects.test(Effect::Edges))
+            DetectBitmapEdges(*rgba, Pixel_RGBA(255, 255, 255, 255));
+        if (effects.test(Effect::Blur))
+            BlurBitmap(*rgba, 4, srgb);
+        container->SetFlag(TextureContainer::Flags::EdgeEffect, effects.test(Effect::Edges));
+        container->SetFlag(TextureContainer::Flags::BlurEffect, effects.test(Effect::Blur));
+    }
+    else if (effects.any_bit())
+        WARN("Texture effects not supported on texture format. [depth=%1, effects=%2]", depth, effects);
+
+    container->SetFlag(TextureContainer::Flags::sRGB, srgb && depth != 8);
+    container->SetFlag(TextureContainer::Flags::PremulAlpha, premultiply_alpha && rgba);
+
+    if (rgba)
+        return container->Encode(*rgba, TextureContainer::Format::RGBA, true);
+    else if (depth == 24)
+        return container->Encode(bitmap, TextureContainer::Format::RGB, true);
+    return container->Encode(bitmap, TextureContainer::Format::AlphaMask, true);
+}
+
 void TextureFileSource::IntoJson(data::Writer& data) const
 {
     data.Write("id",         mId);
@@ -186,6 +377,14 @@ void TextureFileSource::BeginPacking(TexturePacker* packer) const
                            TestFlag(Flags::AllowPacking));
     packer->SetTextureFlag(this, TexturePacker::TextureFlags::AllowedToResize,
                            TestFlag(Flags::AllowResizing));
+    packer->SetTextureFlag(this, TexturePacker::TextureFlags::sRGB,
+                           mColorSpace == ColorSpace::sRGB);
+    packer->SetTextureFlag(this, TexturePacker::TextureFlags::PremulAlpha,
+                           TestFlag(Flags::PremulAlpha));
+    packer->SetTextureFlag(this, TexturePacker::TextureFlags::EdgeEffect,
+                           mEffects.test(Effect::Edges));
+    packer->SetTextureFlag(this, TexturePacker::TextureFlags::BlurEffect,
+                           mEffects.test(Effect::Blur));
 }
 void TextureFileSource::FinishPacking(const TexturePacker* packer)
 {
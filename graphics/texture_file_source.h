@@ -23,6 +23,7 @@
 
 namespace gfx
 {
+    class TextureContainer;
 
     // Source texture data from an image file.
     class TextureFileSource : public TextureSource
@@ -81,6 +82,18 @@ namespace gfx
         { return mFlags.test(flag); }
         void SetFlag(Flags flag, bool on_off)
         { mFlags.set(flag, on_off); }
+
+        // Load and decode the texture data from the given image file.
+        // This does not touch any texture source state and can be
+        // called on any thread, for example when streaming textures.
+        static std::shared_ptr<const IBitmap> LoadData(const std::string& file, bool premultiply_alpha);
+
+        // Bake the texture data into a texture container offline. The alpha
+        // pre-multiplication and the texture effects are applied on the CPU
+        // and a complete mip chain is generated so that none of this work
+        // needs to be done when the texture is loaded at runtime.
+        static bool BakeData(const IBitmap& bitmap, ColorSpace colorspace, bool premultiply_alpha,
+                             base::bitflag<Effect> effects, TextureContainer* container);
     protected:
         std::unique_ptr<TextureSource> MakeCopy(std::string id) const override
         {
@@ -88,6 +101,8 @@ namespace gfx
             ret->mId = std::move(id);
             return ret;
         }
+    private:
+        Texture* UploadContainer(size_t content_hash, Texture* texture, Device& device) const;
     private:
         std::string mId;
         std::string mFile;
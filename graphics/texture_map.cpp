@@ -149,6 +149,7 @@ bool TextureMap::BindTextures(const BindingState& state, Device& device, BoundSt
 
         TextureSource::Environment texture_source_env;
         texture_source_env.dynamic_content = state.dynamic_content;
+        texture_source_env.priority = state.texture_priority;
 
         // if we're using a single sprite sheet then the sprite frames
         // are sub-rects inside the first texture rect.
@@ -202,6 +203,7 @@ bool TextureMap::BindTextures(const BindingState& state, Device& device, BoundSt
     {
         TextureSource::Environment texture_source_env;
         texture_source_env.dynamic_content = state.dynamic_content;
+        texture_source_env.priority = state.texture_priority;
 
         if (auto* texture = mTextures[0].source->Upload(texture_source_env, device))
         {
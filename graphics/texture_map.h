@@ -54,6 +54,8 @@ namespace gfx
             bool blend_frames = false;
             bool dynamic_content = false;
             double current_time  = 0.0f;
+            // texture streaming priority, see TextureSource::Environment
+            float texture_priority = 0.0f;
             std::string group_tag;
         };
         // The result of binding textures.
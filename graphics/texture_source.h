@@ -62,6 +62,9 @@ namespace gfx
         };
         struct Environment {
             bool dynamic_content = false;
+            // The priority of the texture when streaming texture content.
+            // Higher priority textures are loaded first.
+            float priority = 0.0f;
         };
 
         virtual ~TextureSource() = default;
@@ -0,0 +1,243 @@
+// Copyright (C) 2020-2025 Sami Väisänen
+// Copyright (C) 2020-2025 Ensisoft http://www.ensisoft.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "config.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "base/assert.h"
+#include "base/logging.h"
+#include "base/trace.h"
+#include "graphics/device.h"
+#include "graphics/texture.h"
+#include "graphics/texture_streamer.h"
+
+namespace gfx
+{
+
+class TextureStreamer::DecodeTask : public base::ThreadTask
+{
+public:
+    explicit DecodeTask(DecodeFunction decode) noexcept
+      : mDecode(std::move(decode))
+    {}
+    std::shared_ptr<const IBitmap> GetBitmap() const
+    { return mBitmap; }
+protected:
+    void DoTask() override
+    {
+        mBitmap = mDecode();
+        if (!mBitmap)
+            SetError("Failed to decode texture data.");
+    }
+private:
+    const DecodeFunction mDecode;
+    std::shared_ptr<const IBitmap> mBitmap;
+};
+
+TextureStreamer::~TextureStreamer()
+{
+    // the decode functions might depend on resources (such as the
+    // resource loader) that will go away soon after, so wait for
+    // the tasks to finish before returning.
+    Clear();
+}
+
+TextureStreamer::Status TextureStreamer::Stream(const std::string& gpu_id, float priority, const DecodeFunction& decode,
+                                                std::shared_ptr<const IBitmap>* bitmap)
+{
+    auto it = mRequests.find(gpu_id);
+    if (it == mRequests.end())
+    {
+        Request request;
+        request.decode      = decode;
+        request.priority    = priority;
+        request.frame_stamp = mFrameNumber;
+
+        // without a thread pool the decoding is done synchronously
+        // but the upload still goes through the upload budget.
+        if (base::GetGlobalThreadPool() == nullptr)
+        {
+            TRACE_SCOPE("TextureStreamer::Decode");
+            request.bitmap = decode();
+            request.state  = request.bitmap ? RequestState::Decoded : RequestState::Failed;
+            if (request.bitmap)
+            {
+                mStats.bytes_decoded += GetByteSize(*request.bitmap);
+                mStats.textures_decoded++;
+            }
+        }
+        it = mRequests.insert({gpu_id, std::move(request)}).first;
+    }
+
+    auto& request = it->second;
+    if (request.frame_stamp != mFrameNumber)
+        request.priority = priority;
+    else request.priority = std::max(request.priority, priority);
+    request.frame_stamp = mFrameNumber;
+
+    if (request.state == RequestState::Failed)
+    {
+        mRequests.erase(it);
+        return Status::Failed;
+    }
+
+    // allow a decoded texture to be uploaded outside the priority
+    // order in BeginFrame if there's still budget left this frame.
+    if (request.state == RequestState::Decoded)
+    {
+        const auto bytes = GetByteSize(*request.bitmap);
+        if (mGrantedBytes == 0 || mGrantedBytes + bytes <= mSettings.upload_budget)
+        {
+            request.state = RequestState::Granted;
+            mGrantedBytes += bytes;
+        }
+    }
+
+    if (request.state != RequestState::Granted)
+        return Status::Pending;
+
+    mStats.bytes_uploaded += GetByteSize(*request.bitmap);
+    mStats.textures_uploaded++;
+    *bitmap = std::move(request.bitmap);
+    mRequests.erase(it);
+    return Status::Ready;
+}
+
+Texture* TextureStreamer::GetPlaceholder(Device& device) const
+{
+    static const std::string gpu_id = "_texture_streamer_placeholder";
+
+    if (auto* texture = device.FindTexture(gpu_id))
+        return texture;
+
+    // a neutral 50% grey so that the placeholder doesn't stand out
+    // too much when the actual texture replaces it.
+    const Pixel_RGBA pixels[4] = {
+        Pixel_RGBA(127, 127, 127, 255), Pixel_RGBA(127, 127, 127, 255),
+        Pixel_RGBA(127, 127, 127, 255), Pixel_RGBA(127, 127, 127, 255)
+    };
+    auto* texture = device.MakeTexture(gpu_id);
+    texture->SetName("TextureStreamerPlaceholder");
+    texture->Upload(pixels, 2, 2, Texture::Format::RGBA);
+    texture->SetFilter(Texture::MinFilter::Linear);
+    texture->SetFilter(Texture::MagFilter::Linear);
+    return texture;
+}
+
+void TextureStreamer::BeginFrame()
+{
+    TRACE_SCOPE("TextureStreamer::BeginFrame", "decoded=%zu bytes, uploaded=%zu bytes, pending=%u",
+                mStats.bytes_decoded, mStats.bytes_uploaded, mStats.textures_pending);
+
+    mFrameNumber++;
+    mStats = Stats {};
+
+    unsigned num_decode_tasks = 0;
+
+    std::vector<std::pair<float, Request*>> queued;
+    std::vector<std::pair<float, Request*>> decoded;
+
+    for (auto it = mRequests.begin(); it != mRequests.end();)
+    {
+        auto& request = it->second;
+        if (request.state == RequestState::Decoding)
+        {
+            if (!request.task.IsComplete())
+            {
+                ++num_decode_tasks;
+                ++it;
+                continue;
+            }
+            const auto* task = static_cast<const DecodeTask*>(request.task.GetTask());
+            request.bitmap = task->GetBitmap();
+            request.state  = request.bitmap ? RequestState::Decoded : RequestState::Failed;
+            request.task.Clear();
+            if (request.bitmap)
+            {
+                mStats.bytes_decoded += GetByteSize(*request.bitmap);
+                mStats.textures_decoded++;
+            } else ERROR("Texture streaming decode failed. [gpu_id=%1]", it->first);
+        }
+
+        // discard requests that are no longer being used, for example
+        // when the object using the texture went off-screen.
+        if (mFrameNumber - request.frame_stamp > mSettings.max_idle_frames)
+        {
+            it = mRequests.erase(it);
+            continue;
+        }
+
+        if (request.state == RequestState::Queued)
+            queued.push_back({request.priority, &request});
+        else if (request.state == RequestState::Decoded)
+            decoded.push_back({request.priority, &request});
+
+        ++it;
+    }
+
+    const auto by_priority = [](const auto& lhs, const auto& rhs) {
+        return lhs.first > rhs.first;
+    };
+
+    if (auto* pool = base::GetGlobalThreadPool())
+    {
+        std::stable_sort(queued.begin(), queued.end(), by_priority);
+        for (auto& [priority, request] : queued)
+        {
+            if (num_decode_tasks >= mSettings.max_decode_tasks)
+                break;
+
+            auto task = std::make_unique<DecodeTask>(request->decode);
+            task->SetTaskName("TextureDecode");
+            request->task  = pool->SubmitTask(std::move(task));
+            request->state = RequestState::Decoding;
+            ++num_decode_tasks;
+        }
+    }
+
+    std::stable_sort(decoded.begin(), decoded.end(), by_priority);
+    mGrantedBytes = 0;
+    for (auto& [priority, request] : decoded)
+    {
+        const auto bytes = GetByteSize(*request->bitmap);
+        if (mGrantedBytes && mGrantedBytes + bytes > mSettings.upload_budget)
+            break;
+        request->state = RequestState::Granted;
+        mGrantedBytes += bytes;
+    }
+
+    mStats.textures_pending = static_cast<unsigned>(mRequests.size());
+}
+
+void TextureStreamer::Clear()
+{
+    for (auto& [gpu_id, request] : mRequests)
+    {
+        if (request.task.IsValid())
+            request.task.Wait(base::TaskHandle::WaitStrategy::Sleep);
+    }
+    mRequests.clear();
+}
+
+// static
+std::size_t TextureStreamer::GetByteSize(const IBitmap& bitmap) noexcept
+{
+    return std::size_t(bitmap.GetWidth()) * bitmap.GetHeight() * bitmap.GetDepthBits() / 8;
+}
+
+} // namespace
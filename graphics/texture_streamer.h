@@ -0,0 +1,148 @@
+// Copyright (C) 2020-2025 Sami Väisänen
+// Copyright (C) 2020-2025 Ensisoft http://www.ensisoft.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "config.h"
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <cstddef>
+
+#include "base/threadpool.h"
+#include "graphics/bitmap.h"
+
+namespace gfx
+{
+    class Device;
+    class Texture;
+
+    // Stream texture content asynchronously. The texture data is decoded
+    // on the global thread pool (if any) and the decoded bitmaps are then
+    // handed out for uploading on the render thread within a limited per
+    // frame upload budget. Until a texture is ready the caller is expected
+    // to use a placeholder texture instead.
+    //
+    // Both the decoding and uploading are prioritized by the priority of
+    // the texture request. The priority is typically the on-screen size
+    // of the object using the texture so that large and near objects get
+    // their textures before small and distant objects.
+    //
+    // All the functions must be called on the render thread.
+    class TextureStreamer
+    {
+    public:
+        enum class Status {
+            // The texture data is still being decoded or the texture is
+            // waiting for the upload budget. Use a placeholder.
+            Pending,
+            // The texture data is ready for upload.
+            Ready,
+            // Decoding the texture data failed.
+            Failed
+        };
+
+        struct Settings {
+            // The maximum number of texture bytes to hand out for uploading
+            // per frame. The first texture in every frame is always allowed
+            // regardless of its size in order to guarantee progress.
+            std::size_t upload_budget = 4 * 1024 * 1024;
+            // The maximum number of texture decoding tasks in flight.
+            unsigned max_decode_tasks = 4;
+            // The number of frames after which a decoded texture that
+            // hasn't been requested again is discarded.
+            unsigned max_idle_frames = 120;
+        };
+
+        struct Stats {
+            // number of bytes decoded during the current frame.
+            std::size_t bytes_decoded = 0;
+            // number of bytes handed out for upload during the current frame.
+            std::size_t bytes_uploaded = 0;
+            // number of textures decoded during the current frame.
+            unsigned textures_decoded = 0;
+            // number of textures handed out for upload during the current frame.
+            unsigned textures_uploaded = 0;
+            // number of textures currently waiting to be decoded or uploaded.
+            unsigned textures_pending = 0;
+        };
+
+        using DecodeFunction = std::function<std::shared_ptr<const IBitmap> ()>;
+
+        TextureStreamer() = default;
+        explicit TextureStreamer(const Settings& settings) noexcept
+          : mSettings(settings)
+        {}
+       ~TextureStreamer();
+        TextureStreamer(const TextureStreamer&) = delete;
+
+        // Request the texture data for the texture identified by its GPU ID.
+        // On the first call the decode function is queued for decoding. When
+        // the data is ready for uploading the function returns Status::Ready
+        // and the decoded bitmap is returned to the caller who should then
+        // upload it immediately. The request is then complete and forgotten.
+        // The priority is updated on every call and the highest priority
+        // within a frame is used.
+        Status Stream(const std::string& gpu_id, float priority, const DecodeFunction& decode,
+                      std::shared_ptr<const IBitmap>* bitmap);
+
+        // Get a placeholder texture to use while the actual texture is pending.
+        Texture* GetPlaceholder(Device& device) const;
+
+        // Prepare for the next frame. Collects the results of the finished
+        // decoding tasks, starts new decoding tasks and grants uploads
+        // within the upload budget in priority order.
+        void BeginFrame();
+
+        // Discard all pending requests.
+        void Clear();
+
+        inline const Stats& GetStats() const noexcept
+        { return mStats; }
+        inline const Settings& GetSettings() const noexcept
+        { return mSettings; }
+        inline void SetSettings(const Settings& settings) noexcept
+        { mSettings = settings; }
+
+        TextureStreamer& operator=(const TextureStreamer&) = delete;
+    private:
+        class DecodeTask;
+
+        enum class RequestState {
+            Queued, Decoding, Decoded, Granted, Failed
+        };
+        struct Request {
+            DecodeFunction decode;
+            RequestState state = RequestState::Queued;
+            float priority = 0.0f;
+            std::size_t frame_stamp = 0;
+            std::shared_ptr<const IBitmap> bitmap;
+            base::TaskHandle task;
+        };
+        static std::size_t GetByteSize(const IBitmap& bitmap) noexcept;
+
+    private:
+        Settings mSettings;
+        Stats mStats;
+        std::unordered_map<std::string, Request> mRequests;
+        std::size_t mFrameNumber = 0;
+        // number of bytes granted for uploading in the current frame.
+        std::size_t mGrantedBytes = 0;
+    };
+
+} // namespace
@@ -68,6 +68,9 @@ public:
         mHeight = yres;
         mFormat = format;
     }
+    void UploadMip(unsigned mip_level, const void* bytes, size_t byte_count,
+                   unsigned mip_width, unsigned mip_height) override
+    {}
     void Allocate(unsigned width, unsigned height, Format format) override
     {
         mWidth = width;
@@ -181,6 +184,23 @@ public:
     {}
     void SetDefaultTextureFilter(MagFilter filter) override
     {}
+    void EnableTextureStreaming(bool on_off) override
+    {
+        if (on_off && !mTextureStreamer)
+            mTextureStreamer = std::make_unique<gfx::TextureStreamer>();
+        else if (!on_off)
+            mTextureStreamer.reset();
+    }
+    gfx::TextureStreamer* GetTextureStreamer() override
+    { return mTextureStreamer.get(); }
+    void SetTextureBudget(std::size_t bytes) override
+    { mTextureBudget = bytes; }
+    void GetTextureStats(TextureStats* stats) const override
+    {
+        *stats = TextureStats {};
+        stats->budget = mTextureBudget;
+        stats->resident_textures = static_cast<unsigned>(mTextures.size());
+    }
 
     // resource creation APIs
     gfx::ShaderPtr FindShader(const std::string& id) override
@@ -308,7 +328,10 @@ public:
     {}
 
     void BeginFrame() override
-    {}
+    {
+        if (mTextureStreamer)
+            mTextureStreamer->BeginFrame();
+    }
     void EndFrame(bool display) override
     {}
     gfx::Bitmap<gfx::Pixel_RGBA> ReadColorBuffer(unsigned width, unsigned height, gfx::Framebuffer* fbo) const override
@@ -329,6 +352,10 @@ public:
     void GetResourceStats(ResourceStats* stats) const override
     {
 
+    }
+    void GetStateStats(StateStats* stats) const override
+    {
+
     }
     void GetDeviceCaps(DeviceCaps* caps) const override
     {
@@ -389,4 +416,7 @@ private:
 
     std::unordered_map<std::string, std::size_t> mProgramIndexMap;
     std::vector<std::shared_ptr<TestProgram>> mPrograms;
+
+    std::unique_ptr<gfx::TextureStreamer> mTextureStreamer;
+    std::size_t mTextureBudget = 0;
 };
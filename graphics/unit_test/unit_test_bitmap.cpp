@@ -18,6 +18,7 @@
 
 #include <cmath>
 #include <iostream>
+#include <random>
 
 #include "base/utility.h"
 #include "base/format.h"
@@ -29,6 +30,7 @@
 #include "graphics/bitmap.h"
 #include "graphics/bitmap_noise.h"
 #include "graphics/bitmap_algo.h"
+#include "graphics/pixel_kernels.h"
 
 void print_mse()
 {
@@ -693,6 +695,345 @@ void unit_test_algo()
 
 }
 
+void unit_test_pixel_kernels()
+{
+    TEST_CASE(test::Type::Feature)
+
+    const auto default_backend = gfx::GetPixelKernelBackend();
+    TEST_REQUIRE(gfx::IsPixelKernelBackendSupported(default_backend));
+    TEST_REQUIRE(gfx::IsPixelKernelBackendSupported(gfx::PixelKernelBackend::Scalar));
+
+    std::mt19937 rand(1234);
+    std::uniform_int_distribution<unsigned> byte(0, 255);
+    std::uniform_int_distribution<unsigned> noise(0, 3);
+
+    // lhs is random and rhs is a slightly different copy of lhs with
+    // some larger differences so that the compare thresholds matter.
+    std::vector<gfx::Pixel_RGBA> lhs(100);
+    std::vector<gfx::Pixel_RGBA> rhs(100);
+    for (size_t i=0; i<lhs.size(); ++i)
+    {
+        lhs[i] = gfx::Pixel_RGBA(byte(rand), byte(rand), byte(rand), byte(rand));
+        rhs[i] = lhs[i];
+        rhs[i].r ^= noise(rand);
+        rhs[i].a ^= noise(rand);
+        if (i % 37 == 36)
+            rhs[i].g ^= 0x10;
+    }
+
+    for (auto backend : { gfx::PixelKernelBackend::Scalar,
+                          gfx::PixelKernelBackend::SSE2,
+                          gfx::PixelKernelBackend::AVX2,
+                          gfx::PixelKernelBackend::NEON })
+    {
+        if (!gfx::IsPixelKernelBackendSupported(backend))
+        {
+            TEST_REQUIRE(!gfx::SetPixelKernelBackend(backend));
+            continue;
+        }
+        TEST_REQUIRE(gfx::SetPixelKernelBackend(backend));
+        TEST_REQUIRE(gfx::GetPixelKernelBackend() == backend);
+
+        // every span length up to a few SIMD register widths so that
+        // both the vector loops and the scalar tails are covered.
+        for (size_t count=0; count<=lhs.size(); ++count)
+        {
+            std::vector<gfx::Pixel_RGBA> rgba(lhs.begin(), lhs.begin() + count);
+            gfx::PixelSpan_BitwiseAnd((gfx::u8*)rgba.data(), (const gfx::u8*)rhs.data(), count * 4);
+            for (size_t i=0; i<count; ++i)
+                TEST_REQUIRE(rgba[i] == (lhs[i] & rhs[i]));
+
+            rgba.assign(lhs.begin(), lhs.begin() + count);
+            gfx::PixelSpan_BitwiseOr((gfx::u8*)rgba.data(), (const gfx::u8*)rhs.data(), count * 4);
+            for (size_t i=0; i<count; ++i)
+                TEST_REQUIRE(rgba[i] == (lhs[i] | rhs[i]));
+
+            std::vector<gfx::Pixel_RGB> rgb(count);
+            gfx::PixelSpan_Convert(rgb.data(), lhs.data(), count);
+            for (size_t i=0; i<count; ++i)
+                TEST_REQUIRE(rgb[i] == gfx::Pixel_RGB(lhs[i].r, lhs[i].g, lhs[i].b));
+
+            rgba.assign(count, gfx::Pixel_RGBA(0, 0, 0, 0));
+            gfx::PixelSpan_Convert(rgba.data(), rgb.data(), count);
+            for (size_t i=0; i<count; ++i)
+                TEST_REQUIRE(rgba[i] == gfx::Pixel_RGBA(lhs[i].r, lhs[i].g, lhs[i].b, 0xff));
+
+            // in-place premultiply
+            rgba.assign(lhs.begin(), lhs.begin() + count);
+            gfx::PixelSpan_PremulAlpha(rgba.data(), rgba.data(), count, false);
+            for (size_t i=0; i<count; ++i)
+            {
+                const auto a = lhs[i].a;
+                TEST_REQUIRE(rgba[i].r == (unsigned)std::floor(lhs[i].r * a / 255.0 + 0.5));
+                TEST_REQUIRE(rgba[i].g == (unsigned)std::floor(lhs[i].g * a / 255.0 + 0.5));
+                TEST_REQUIRE(rgba[i].b == (unsigned)std::floor(lhs[i].b * a / 255.0 + 0.5));
+                TEST_REQUIRE(rgba[i].a == a);
+            }
+
+            std::vector<gfx::Pixel_A> lhs_a;
+            std::vector<gfx::Pixel_A> rhs_a;
+            std::vector<gfx::Pixel_RGB> lhs_rgb;
+            std::vector<gfx::Pixel_RGB> rhs_rgb;
+            for (size_t i=0; i<count; ++i)
+            {
+                lhs_a.push_back(gfx::Pixel_A(lhs[i].g));
+                rhs_a.push_back(gfx::Pixel_A(rhs[i].g));
+                lhs_rgb.push_back(gfx::Pixel_RGB(lhs[i].r, lhs[i].g, lhs[i].b));
+                rhs_rgb.push_back(gfx::Pixel_RGB(rhs[i].r, rhs[i].g, rhs[i].b));
+            }
+            for (double max_mse : { -1.0, 0.0, 1.0, 2.25, 3.0, 4.5, 64.0, 100.0, 1000.0, 100000.0 })
+            {
+                const gfx::PixelEquality::ThresholdPrecision compare(max_mse);
+                bool expected_a    = true;
+                bool expected_rgb  = true;
+                bool expected_rgba = true;
+                for (size_t i=0; i<count; ++i)
+                {
+                    expected_a    = expected_a    && compare(lhs_a[i], rhs_a[i]);
+                    expected_rgb  = expected_rgb  && compare(lhs_rgb[i], rhs_rgb[i]);
+                    expected_rgba = expected_rgba && compare(lhs[i], rhs[i]);
+                }
+                TEST_REQUIRE(gfx::PixelSpan_Compare(lhs_a.data(), rhs_a.data(), count, max_mse) == expected_a);
+                TEST_REQUIRE(gfx::PixelSpan_Compare(lhs_rgb.data(), rhs_rgb.data(), count, max_mse) == expected_rgb);
+                TEST_REQUIRE(gfx::PixelSpan_Compare(lhs.data(), rhs.data(), count, max_mse) == expected_rgba);
+            }
+        }
+
+        // every color and alpha combination.
+        std::vector<gfx::Pixel_RGBA> src;
+        for (unsigned a=0; a<256; ++a)
+        {
+            for (unsigned c=0; c<256; ++c)
+                src.push_back(gfx::Pixel_RGBA(c, 255-c, c, a));
+        }
+        std::vector<gfx::Pixel_RGBA> dst(src.size());
+        gfx::PixelSpan_PremulAlpha(dst.data(), src.data(), src.size(), false);
+        for (size_t i=0; i<src.size(); ++i)
+        {
+            const auto a = src[i].a;
+            TEST_REQUIRE(dst[i].r == (unsigned)std::floor(src[i].r * a / 255.0 + 0.5));
+            TEST_REQUIRE(dst[i].g == (unsigned)std::floor(src[i].g * a / 255.0 + 0.5));
+            TEST_REQUIRE(dst[i].a == a);
+        }
+
+        // the bitmap algorithms with the kernels against the
+        // generic per pixel implementation.
+        {
+            gfx::AlphaMask src_mask(37, 21);
+            gfx::AlphaMask dst_mask(50, 30);
+            for (unsigned row=0; row<src_mask.GetHeight(); ++row)
+                for (unsigned col=0; col<src_mask.GetWidth(); ++col)
+                    src_mask.SetPixel(row, col, gfx::Pixel_A(byte(rand)));
+            for (unsigned row=0; row<dst_mask.GetHeight(); ++row)
+                for (unsigned col=0; col<dst_mask.GetWidth(); ++col)
+                    dst_mask.SetPixel(row, col, gfx::Pixel_A(byte(rand)));
+
+            for (const auto& pos : { gfx::IPoint(0, 0), gfx::IPoint(20, 15), gfx::IPoint(-10, -5) })
+            {
+                auto expected = dst_mask;
+                expected.Blit(pos.GetX(), pos.GetY(), src_mask, [](const gfx::Pixel_A& dst, const gfx::Pixel_A& src) {
+                    return dst | src;
+                });
+                auto result = dst_mask;
+                result.Blit(pos.GetX(), pos.GetY(), src_mask, gfx::RasterOp_BitwiseOr<gfx::Pixel_A>);
+                TEST_REQUIRE(result == expected);
+
+                expected = dst_mask;
+                expected.Blit(pos.GetX(), pos.GetY(), src_mask, [](const gfx::Pixel_A& dst, const gfx::Pixel_A& src) {
+                    return dst & src;
+                });
+                result = dst_mask;
+                result.Blit(pos.GetX(), pos.GetY(), src_mask, gfx::RasterOp_BitwiseAnd<gfx::Pixel_A>);
+                TEST_REQUIRE(result == expected);
+            }
+        }
+
+        {
+            gfx::RgbBitmap rgb(13, 7);
+            for (unsigned row=0; row<rgb.GetHeight(); ++row)
+                for (unsigned col=0; col<rgb.GetWidth(); ++col)
+                    rgb.SetPixel(row, col, gfx::Pixel_RGB(byte(rand), byte(rand), byte(rand)));
+
+            gfx::RgbaBitmap rgba(13, 7);
+            gfx::ReinterpretBitmap(rgba.GetPixelWriteView(), rgb.GetPixelReadView());
+            gfx::RgbBitmap ret(13, 7);
+            gfx::ReinterpretBitmap(ret.GetPixelWriteView(), rgba.GetPixelReadView());
+            TEST_REQUIRE(ret == rgb);
+            for (unsigned row=0; row<rgba.GetHeight(); ++row)
+            {
+                for (unsigned col=0; col<rgba.GetWidth(); ++col)
+                {
+                    const auto& p = rgb.GetPixel(row, col);
+                    TEST_REQUIRE(rgba.GetPixel(row, col) == gfx::Pixel_RGBA(p.r, p.g, p.b, 0xff));
+                }
+            }
+
+            auto other = rgba;
+            TEST_REQUIRE(gfx::PixelCompare(rgba, other));
+            TEST_REQUIRE(gfx::PixelCompare(rgba, other, gfx::PixelEquality::ThresholdPrecision()));
+            other.SetPixel(6, 12, gfx::Pixel_RGBA(0, 0, 0, 0));
+            TEST_REQUIRE(!gfx::PixelCompare(rgba, other));
+            TEST_REQUIRE(!gfx::PixelCompare(rgba, other, gfx::PixelEquality::ThresholdPrecision(10.0)));
+            TEST_REQUIRE(gfx::PixelCompare(rgba, gfx::URect(0, 0, 12, 7), other, gfx::PixelEquality::PixelPrecision()));
+        }
+    }
+    TEST_REQUIRE(gfx::SetPixelKernelBackend(default_backend));
+}
+
+void unit_test_srgb_lut()
+{
+    TEST_CASE(test::Type::Feature)
+
+    const auto default_mode = gfx::Get_sRGB_Mode();
+    TEST_REQUIRE(default_mode == gfx::sRGB_Mode::LUT4096);
+
+    // decoding with the table is exact.
+    for (unsigned i=0; i<256; ++i)
+    {
+        TEST_REQUIRE(gfx::sRGB_decode_u8(i) == gfx::sRGB_decode(i / 255.0f));
+
+        const gfx::Pixel_RGBA pixel(i, 255-i, i/2, 128);
+        const auto& floats = gfx::sRGB_decode(gfx::Pixel_to_floats(pixel));
+        const auto& ret = gfx::sRGB_decode_to_floats(pixel);
+        TEST_REQUIRE(ret.r == floats.r);
+        TEST_REQUIRE(ret.g == floats.g);
+        TEST_REQUIRE(ret.b == floats.b);
+        TEST_REQUIRE(ret.a == floats.a);
+    }
+
+    // the encoding error compared to the exact encoding.
+    const auto max_encode_error = [](gfx::sRGB_Mode mode) {
+        gfx::Set_sRGB_Mode(mode);
+        int max_error = 0;
+        for (unsigned i=0; i<=100000; ++i)
+        {
+            const auto value = i / 100000.0f;
+            const int exact = static_cast<gfx::u8>(gfx::sRGB_encode(value) * 255);
+            const int ret = gfx::sRGB_encode_u8(value);
+            max_error = std::max(max_error, std::abs(exact - ret));
+        }
+        return max_error;
+    };
+    TEST_REQUIRE(max_encode_error(gfx::sRGB_Mode::Exact) == 0);
+    TEST_REQUIRE(max_encode_error(gfx::sRGB_Mode::LUT4096) <= 1);
+    // the 256 entry table loses precision in the dark values.
+    TEST_REQUIRE(max_encode_error(gfx::sRGB_Mode::LUT256) <= 7);
+
+    // out of range values are clamped
+    for (auto mode : { gfx::sRGB_Mode::Exact, gfx::sRGB_Mode::LUT256, gfx::sRGB_Mode::LUT4096 })
+    {
+        gfx::Set_sRGB_Mode(mode);
+        TEST_REQUIRE(gfx::sRGB_encode_u8(-1.0f) == 0);
+        TEST_REQUIRE(gfx::sRGB_encode_u8(2.0f) == gfx::sRGB_encode_u8(1.0f));
+    }
+
+    // converting to linear is the same as before.
+    {
+        gfx::RgbaBitmap bmp(256, 1);
+        for (unsigned i=0; i<256; ++i)
+            bmp.SetPixel(0, i, gfx::Pixel_RGBA(i, 255-i, i, 255-i));
+        const auto& ret = gfx::ConvertToLinear(bmp);
+        const auto* linear = dynamic_cast<const gfx::RgbaBitmap*>(ret.get());
+        TEST_REQUIRE(linear);
+        for (unsigned i=0; i<256; ++i)
+        {
+            const auto& expected = gfx::Pixel_to_uints(gfx::sRGB_decode(gfx::Pixel_to_floats(bmp.GetPixel(0, i))));
+            TEST_REQUIRE(linear->GetPixel(0, i) == expected);
+        }
+    }
+
+    // premultiplying sRGB with the table is within one step from the
+    // exact computation and the exact computation is the same as before.
+    {
+        gfx::RgbaBitmap bmp(256, 256);
+        for (unsigned a=0; a<256; ++a)
+            for (unsigned c=0; c<256; ++c)
+                bmp.SetPixel(a, c, gfx::Pixel_RGBA(c, 255-c, c, a));
+
+        gfx::Set_sRGB_Mode(gfx::sRGB_Mode::Exact);
+        const auto& exact = gfx::PremultiplyAlpha(bmp, true);
+        gfx::Set_sRGB_Mode(gfx::sRGB_Mode::LUT4096);
+        const auto& table = gfx::PremultiplyAlpha(bmp, true);
+        for (unsigned i=0; i<256*256; ++i)
+        {
+            auto norm = gfx::Pixel_to_floats(bmp.GetPixel(i));
+            norm = gfx::sRGB_decode(norm);
+            norm = gfx::RGBA_premul_alpha(norm);
+            norm = gfx::sRGB_encode(norm);
+            const auto& expected = gfx::Pixel_to_uints(norm);
+            TEST_REQUIRE(exact.GetPixel(i) == expected);
+            TEST_REQUIRE(std::abs(table.GetPixel(i).r - expected.r) <= 1);
+            TEST_REQUIRE(std::abs(table.GetPixel(i).g - expected.g) <= 1);
+            TEST_REQUIRE(std::abs(table.GetPixel(i).b - expected.b) <= 1);
+            TEST_REQUIRE(table.GetPixel(i).a == expected.a);
+        }
+    }
+    gfx::Set_sRGB_Mode(default_mode);
+}
+
+void unit_test_pixel_kernels_perf()
+{
+    TEST_CASE(test::Type::Performance)
+
+    const auto default_backend = gfx::GetPixelKernelBackend();
+    const auto default_mode = gfx::Get_sRGB_Mode();
+
+    std::mt19937 rand(1234);
+    std::uniform_int_distribution<unsigned> byte(0, 255);
+
+    gfx::RgbaBitmap rgba(1024, 1024);
+    gfx::AlphaMask mask(1024, 1024);
+    for (unsigned i=0; i<1024*1024; ++i)
+    {
+        rgba.SetPixel(i, gfx::Pixel_RGBA(byte(rand), byte(rand), byte(rand), byte(rand)));
+        mask.SetPixel(i, gfx::Pixel_A(byte(rand)));
+    }
+    const auto other = rgba;
+
+    for (auto backend : { gfx::PixelKernelBackend::Scalar,
+                          gfx::PixelKernelBackend::SSE2,
+                          gfx::PixelKernelBackend::AVX2,
+                          gfx::PixelKernelBackend::NEON })
+    {
+        if (!gfx::SetPixelKernelBackend(backend))
+            continue;
+
+        auto ret = test::TimedTest(100, [&rgba]() {
+            gfx::PremultiplyAlpha(rgba, false);
+        });
+        test::PrintTestTimes(base::FormatString("premultiply 1024x1024 %1", backend).c_str(), ret);
+
+        auto dst = mask;
+        ret = test::TimedTest(100, [&dst, &mask]() {
+            dst.Blit(0, 0, mask, gfx::RasterOp_BitwiseOr<gfx::Pixel_A>);
+        });
+        test::PrintTestTimes(base::FormatString("blit or 1024x1024 %1", backend).c_str(), ret);
+
+        ret = test::TimedTest(100, [&rgba, &other]() {
+            gfx::PixelCompare(rgba, other, gfx::PixelEquality::ThresholdPrecision(10.0));
+        });
+        test::PrintTestTimes(base::FormatString("compare 1024x1024 %1", backend).c_str(), ret);
+    }
+
+    for (auto mode : { gfx::sRGB_Mode::Exact, gfx::sRGB_Mode::LUT256, gfx::sRGB_Mode::LUT4096 })
+    {
+        gfx::Set_sRGB_Mode(mode);
+
+        auto ret = test::TimedTest(10, [&rgba]() {
+            gfx::PremultiplyAlpha(rgba, true);
+        });
+        test::PrintTestTimes(base::FormatString("premultiply sRGB 1024x1024 %1", mode).c_str(), ret);
+
+        ret = test::TimedTest(10, [&rgba]() {
+            gfx::GenerateNextMipmap(rgba, true);
+        });
+        test::PrintTestTimes(base::FormatString("mipmap sRGB 1024x1024 %1", mode).c_str(), ret);
+    }
+
+    gfx::SetPixelKernelBackend(default_backend);
+    gfx::Set_sRGB_Mode(default_mode);
+}
+
 EXPORT_TEST_MAIN(
 int test_main(int argc, char* argv[])
 {
@@ -719,6 +1060,9 @@ int test_main(int argc, char* argv[])
     unit_test_noise();
     unit_test_find_rect();
     unit_test_algo();
+    unit_test_pixel_kernels();
+    unit_test_srgb_lut();
+    unit_test_pixel_kernels_perf();
     return 0;
 }
 ) // TEST_MAIN
\ No newline at end of file
@@ -22,19 +22,24 @@
 
 #include "config.h"
 
+#include <thread>
+
 #include "base/test_minimal.h"
 #include "device/device.h"
+#include "device/command_buffer.h"
 #include "graphics/device_algo.h"
 #include "graphics/color4f.h"
 #include "graphics/device.h"
 #include "graphics/program.h"
 #include "graphics/texture.h"
+#include "graphics/texture_container.h"
 #include "graphics/shader.h"
 #include "graphics/geometry.h"
 #include "graphics/framebuffer.h"
 #include "graphics/drawcmd.h"
 #include "graphics/instance.h"
 #include "graphics/utility.h"
+#include "graphics/device_uniform_buffer.h"
 
 // We need this to create the rendering context.
 #include "wdk/opengl/context.h"
@@ -599,6 +604,115 @@ void main() {
     TEST_REQUIRE(gfx::PixelCompare(bmp, data));
 }
 
+void unit_test_render_with_compressed_texture()
+{
+    TEST_CASE(test::Type::Feature)
+
+    auto dev = CreateDevice();
+
+    gfx::Device::DeviceCaps caps;
+    dev->GetDeviceCaps(&caps);
+
+    gfx::Bitmap<gfx::Pixel_RGBA> data(8, 8);
+    for (unsigned row=0; row<8; ++row)
+    {
+        for (unsigned col=0; col<8; ++col)
+        {
+            data.SetPixel(row, col, gfx::Pixel_RGBA(col * 32, row * 32, 255 - col * 16, 255));
+        }
+    }
+
+    const gfx::Vertex2D verts[] = {
+        { {-1,  1}, {0, 0} },
+        { {-1, -1}, {0, 1} },
+        { { 1, -1}, {1, 1} },
+
+        { {-1,  1}, {0, 0} },
+        { { 1, -1}, {1, 1} },
+        { { 1,  1}, {1, 0} }
+    };
+    gfx::Geometry::CreateArgs args;
+    args.buffer.SetVertexLayout(gfx::GetVertexLayout<gfx::Vertex2D>());
+    args.buffer.SetVertexBuffer(verts, 6);
+    args.buffer.AddDrawCmd(gfx::Geometry::DrawType::Triangles);
+    auto geom = dev->CreateGeometry("geom", std::move(args));
+
+    constexpr const char* fssrc =
+R"(#version 100
+precision mediump float;
+varying vec2 vTexCoord;
+uniform sampler2D kTexture;
+void main() {
+  gl_FragColor = texture2D(kTexture, vTexCoord.xy);
+})";
+
+    constexpr const char* vssrc =
+R"(#version 100
+attribute vec2 aPosition;
+attribute vec2 aTexCoord;
+varying vec2 vTexCoord;
+void main() {
+  gl_Position = vec4(aPosition.xy, 1.0, 1.0);
+  vTexCoord = aTexCoord;
+})";
+
+    auto prog = MakeTestProgram(*dev, vssrc, fssrc, "prog");
+
+    const gfx::TextureContainer::Format formats[] = {
+        gfx::TextureContainer::Format::BC1,
+        gfx::TextureContainer::Format::BC3,
+        gfx::TextureContainer::Format::ETC2_RGB,
+        gfx::TextureContainer::Format::ETC2_RGBA
+    };
+    for (auto format : formats)
+    {
+        gfx::TextureContainer container;
+        TEST_REQUIRE(container.Encode(data, format, true));
+
+        // the GPU decoded result must match the CPU transcoder whether
+        // the texture was uploaded compressed or transcoded.
+        const auto& expected = gfx::DecompressTexture(container.GetLevel(0).data.data(),
+                                                      container.GetLevel(0).data.size(), 8, 8, format);
+
+        auto* texture = dev->MakeTexture("tex");
+        TEST_REQUIRE(container.Upload(texture, caps));
+        TEST_REQUIRE(texture->GetWidth() == 8);
+        TEST_REQUIRE(texture->GetHeight() == 8);
+        TEST_REQUIRE(texture->HasMips());
+        texture->SetFilter(gfx::Texture::MinFilter::Nearest);
+        texture->SetFilter(gfx::Texture::MagFilter::Nearest);
+
+        dev->BeginFrame();
+        dev->ClearColor(gfx::Color::White);
+
+        gfx::ProgramState program_state;
+        program_state.SetTexture("kTexture", 0, *texture);
+
+        gfx::Device::RasterState state;
+        state.blending = gfx::Device::RasterState::BlendOp::None;
+
+        gfx::Device::ColorDepthStencilState dss;
+        dss.bWriteColor  = true;
+        dss.stencil_func = gfx::Device::ColorDepthStencilState::StencilFunc::Disabled;
+        dev->SetColorDepthStencilState(dss);
+
+        dev::ViewportState vs;
+        vs.viewport = gfx::IRect(0, 0, 8, 8);
+        dev->SetViewportState(vs);
+
+        dev->Draw(*prog, program_state, *geom, state);
+        dev->EndFrame();
+
+        const auto& bmp = dev->ReadColorBuffer(8, 8);
+        TEST_REQUIRE(gfx::PixelCompare(bmp, expected, [](const gfx::Pixel_RGBA& lhs, const gfx::Pixel_RGBA& rhs) {
+            return std::abs(lhs.r - rhs.r) <= 2 &&
+                   std::abs(lhs.g - rhs.g) <= 2 &&
+                   std::abs(lhs.b - rhs.b) <= 2;
+        }));
+        dev->DeleteTexture("tex");
+    }
+}
+
 void unit_test_render_with_multiple_textures()
 {
     TEST_CASE(test::Type::Feature)
@@ -1340,6 +1454,69 @@ void main() {
     TEST_REQUIRE(bmp.PixelCompare(gfx::Color::White));
 }
 
+void unit_test_render_set_uniform_array()
+{
+    TEST_CASE(test::Type::Feature)
+
+    auto dev = CreateDevice();
+    auto geom = MakeQuad(*dev);
+
+    constexpr const char* fssrc =
+R"(#version 100
+precision mediump float;
+uniform vec4 kColors[3];
+void main() {
+  gl_FragColor = kColors[0] + kColors[2];
+})";
+
+    constexpr const char* vssrc =
+R"(#version 100
+attribute vec2 aPosition;
+void main() {
+  gl_Position = vec4(aPosition.xy, 1.0, 1.0);
+})";
+    auto prog = MakeTestProgram(*dev, vssrc, fssrc, "prog");
+
+    gfx::Device::RasterState state;
+    state.blending = gfx::Device::RasterState::BlendOp::None;
+
+    gfx::Device::ColorDepthStencilState dss;
+    dss.bWriteColor  = true;
+    dss.stencil_func = gfx::Device::ColorDepthStencilState::StencilFunc::Disabled;
+
+    gfx::Device::ViewportState vs;
+    vs.viewport = gfx::IRect(0, 0, 10, 10);
+
+    // array elements can be set individually and the array
+    // name itself refers to the first element.
+    {
+        gfx::ProgramState program_state;
+        program_state.SetUniform("kColors[0]", glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
+        program_state.SetUniform("kColors[1]", glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+        program_state.SetUniform("kColors[2]", glm::vec4(0.0f, 0.0f, 1.0f, 0.0f));
+
+        dev->BeginFrame();
+        dev->ClearColor(gfx::Color::Black);
+        dev->SetColorDepthStencilState(dss);
+        dev->SetViewportState(vs);
+        dev->Draw(*prog, program_state, *geom, state);
+        dev->EndFrame();
+        TEST_REQUIRE(dev->ReadColorBuffer(10, 10).PixelCompare(gfx::Color::Magenta));
+    }
+
+    {
+        gfx::ProgramState program_state;
+        program_state.SetUniform("kColors", glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
+        program_state.SetUniform("kColors[2]", glm::vec4(0.0f, 0.0f, 0.0f, 0.0f));
+
+        dev->BeginFrame();
+        dev->ClearColor(gfx::Color::Black);
+        dev->Draw(*prog, program_state, *geom, state);
+        dev->EndFrame();
+        TEST_REQUIRE(dev->ReadColorBuffer(10, 10).PixelCompare(gfx::Color::Green));
+    }
+}
+
 void unit_test_uniform_sampler_optimize_bug()
 {
     TEST_CASE(test::Type::Feature)
@@ -1579,6 +1756,133 @@ void main() {
 }
 
 
+void unit_test_texture_budget()
+{
+    TEST_CASE(test::Type::Feature)
+
+    auto dev = CreateDevice();
+
+    std::vector<gfx::Pixel_RGBA> pixels(16 * 16);
+
+    const auto make_texture = [&dev, &pixels](const std::string& name) {
+        auto* texture = dev->MakeTexture(name);
+        texture->Upload(pixels.data(), 16, 16, gfx::Texture::Format::RGBA);
+        return texture;
+    };
+
+    // no budget, nothing is evicted.
+    {
+        make_texture("a");
+        make_texture("b");
+        for (int i=0; i<3; ++i)
+        {
+            dev->BeginFrame();
+            dev->EndFrame();
+        }
+        gfx::Device::TextureStats stats;
+        dev->GetTextureStats(&stats);
+        TEST_REQUIRE(stats.budget == 0);
+        TEST_REQUIRE(stats.resident_textures == 2);
+        TEST_REQUIRE(stats.resident_bytes == 2 * 16 * 16 * 4);
+        TEST_REQUIRE(stats.pinned_textures == 0);
+        TEST_REQUIRE(stats.evicted_textures == 0);
+        TEST_REQUIRE(dev->FindTexture("a"));
+        TEST_REQUIRE(dev->FindTexture("b"));
+    }
+
+    dev->DeleteTextures();
+
+    dev->SetTextureBudget(2 * 16 * 16 * 4);
+
+    // least recently used textures get evicted, pinned textures
+    // and textures used in the previous frame are kept.
+    {
+        make_texture("a");
+        make_texture("pinned")->SetFlag(gfx::Texture::Flags::GarbageCollect, false);
+        for (int i=0; i<3; ++i)
+        {
+            dev->BeginFrame();
+            dev->EndFrame();
+        }
+        gfx::Device::TextureStats stats;
+        dev->GetTextureStats(&stats);
+        TEST_REQUIRE(stats.resident_textures == 2);
+        TEST_REQUIRE(stats.pinned_textures == 1);
+        TEST_REQUIRE(stats.pinned_bytes == 16 * 16 * 4);
+        TEST_REQUIRE(stats.evicted_textures == 0);
+
+        make_texture("b");
+        dev->BeginFrame();
+        dev->EndFrame();
+        TEST_REQUIRE(dev->FindTexture("a") == nullptr);
+        TEST_REQUIRE(dev->FindTexture("b"));
+        TEST_REQUIRE(dev->FindTexture("pinned"));
+        dev->GetTextureStats(&stats);
+        TEST_REQUIRE(stats.resident_textures == 2);
+        TEST_REQUIRE(stats.resident_bytes == 2 * 16 * 16 * 4);
+        TEST_REQUIRE(stats.evicted_textures == 1);
+        TEST_REQUIRE(stats.evicted_bytes == 16 * 16 * 4);
+
+        // both b and c are recently used, budget is exceeded
+        make_texture("c");
+        dev->BeginFrame();
+        dev->EndFrame();
+        TEST_REQUIRE(dev->FindTexture("b"));
+        TEST_REQUIRE(dev->FindTexture("c"));
+
+        // b is now the least recently used.
+        dev->BeginFrame();
+        dev->EndFrame();
+        TEST_REQUIRE(dev->FindTexture("b") == nullptr);
+        TEST_REQUIRE(dev->FindTexture("c"));
+        TEST_REQUIRE(dev->FindTexture("pinned"));
+        dev->GetTextureStats(&stats);
+        TEST_REQUIRE(stats.evicted_textures == 2);
+        TEST_REQUIRE(stats.evicted_bytes == 2 * 16 * 16 * 4);
+
+        // a texture that was just updated counts as used even
+        // if it hasn't been bound yet.
+        for (int i=0; i<3; ++i)
+        {
+            dev->BeginFrame();
+            dev->EndFrame();
+        }
+        make_texture("d");
+        dev->FindTexture("c")->Upload(pixels.data(), 16, 16, gfx::Texture::Format::RGBA);
+        dev->BeginFrame();
+        dev->EndFrame();
+        TEST_REQUIRE(dev->FindTexture("c"));
+        TEST_REQUIRE(dev->FindTexture("d"));
+        TEST_REQUIRE(dev->FindTexture("pinned"));
+    }
+
+    dev->DeleteTextures();
+
+    // mips and block compressed textures
+    {
+        auto* texture = make_texture("mips");
+        TEST_REQUIRE(texture->GenerateMips());
+
+        gfx::Device::TextureStats stats;
+        dev->GetTextureStats(&stats);
+        TEST_REQUIRE(stats.resident_bytes == 16 * 16 * 4 + 16 * 16 * 4 / 3);
+
+        gfx::Device::DeviceCaps caps;
+        dev->GetDeviceCaps(&caps);
+        if (caps.texture_compression_bc)
+        {
+            std::vector<std::uint8_t> blocks(gfx::TextureContainer::GetLevelByteSize(gfx::TextureContainer::Format::BC1, 16, 16));
+            auto* compressed = dev->MakeTexture("compressed");
+            compressed->Upload(blocks.data(), 16, 16, gfx::Texture::Format::BC1_RGB);
+
+            dev->GetTextureStats(&stats);
+            TEST_REQUIRE(stats.resident_bytes == 16 * 16 * 4 + 16 * 16 * 4 / 3 + 4 * 4 * 8);
+        }
+    }
+
+    dev->DeleteTextures();
+}
+
 void unit_test_vbo_allocation()
 {
     TEST_CASE(test::Type::Feature)
@@ -1702,7 +2006,7 @@ void unit_test_vbo_allocation()
         dev->GetResourceStats(&stats);
         TEST_REQUIRE(stats.streaming_vbo_mem_use == 0);
         TEST_REQUIRE(stats.streaming_vbo_mem_alloc > 0);
-        TEST_REQUIRE(stats.dynamic_vbo_mem_alloc == sizeof(junk_data) + sizeof(junk_data));
+        TEST_REQUIRE(stats.dynamic_vbo_mem_alloc >= sizeof(junk_data) + sizeof(junk_data));
         TEST_REQUIRE(stats.dynamic_vbo_mem_use == sizeof(junk_data) + sizeof(junk_data));
         TEST_REQUIRE(stats.static_vbo_mem_use == 0);
         TEST_REQUIRE(stats.static_vbo_mem_alloc > 0);
@@ -1710,6 +2014,242 @@ void unit_test_vbo_allocation()
     }
 }
 
+void unit_test_buffer_suballocation()
+{
+    TEST_CASE(test::Type::Feature)
+
+    for (auto usage : {dev::BufferUsage::Static, dev::BufferUsage::Dynamic})
+    {
+        auto context = std::make_shared<TestContext>(10, 10);
+        auto device  = dev::CreateDevice(context)->GetSharedGraphicsDevice();
+
+        const auto a = device->AllocateBuffer(100, usage, dev::BufferType::VertexBuffer);
+        const auto b = device->AllocateBuffer(200, usage, dev::BufferType::VertexBuffer);
+        const auto c = device->AllocateBuffer(300, usage, dev::BufferType::VertexBuffer);
+        TEST_REQUIRE(a.handle == b.handle && b.handle == c.handle);
+        TEST_REQUIRE(a.buffer_bytes == 100);
+        TEST_REQUIRE(b.buffer_offset >= a.buffer_offset + 100);
+        TEST_REQUIRE(c.buffer_offset >= b.buffer_offset + 200);
+        TEST_REQUIRE(b.buffer_offset % 16 == 0);
+        TEST_REQUIRE(c.buffer_offset % 16 == 0);
+
+        dev::GraphicsDeviceResourceStats stats;
+        device->GetResourceStats(&stats);
+        TEST_REQUIRE(stats.buffer_objects == 1);
+        TEST_REQUIRE(stats.buffer_free_ranges == 1);
+
+        // freeing a range in the middle creates a hole.
+        device->FreeBuffer(b);
+        device->GetResourceStats(&stats);
+        TEST_REQUIRE(stats.buffer_free_ranges == 2);
+        TEST_REQUIRE(stats.buffer_largest_free_range < stats.buffer_free_mem);
+
+        // the hole is re-used by the best fitting allocation.
+        const auto d = device->AllocateBuffer(150, usage, dev::BufferType::VertexBuffer);
+        TEST_REQUIRE(d.handle == b.handle);
+        TEST_REQUIRE(d.buffer_offset == b.buffer_offset);
+
+        // freed neighbours are merged together
+        device->FreeBuffer(d);
+        device->FreeBuffer(a);
+        device->GetResourceStats(&stats);
+        TEST_REQUIRE(stats.buffer_free_ranges == 2);
+        device->FreeBuffer(c);
+        device->GetResourceStats(&stats);
+        TEST_REQUIRE(stats.buffer_free_ranges == 1);
+        TEST_REQUIRE(stats.buffer_free_mem == stats.buffer_largest_free_range);
+        if (usage == dev::BufferUsage::Static)
+        {
+            TEST_REQUIRE(stats.static_vbo_mem_use == 0);
+            TEST_REQUIRE(stats.buffer_free_mem == stats.static_vbo_mem_alloc);
+        }
+        else
+        {
+            TEST_REQUIRE(stats.dynamic_vbo_mem_use == 0);
+        }
+    }
+}
+
+void unit_test_command_buffer()
+{
+    TEST_CASE(test::Type::Feature)
+
+    auto context = std::make_shared<TestContext>(10, 10);
+    auto device  = dev::CreateDevice(context)->GetSharedGraphicsDevice();
+
+    // resources are created on the device thread.
+    std::string info;
+    const auto vs = device->CompileShader(
+R"(#version 100
+attribute vec2 aPosition;
+void main() {
+  gl_Position = vec4(aPosition.xy, 1.0, 1.0);
+})", dev::ShaderType::VertexShader, &info);
+    const auto fs = device->CompileShader(
+R"(#version 100
+precision mediump float;
+uniform vec4 kColor;
+void main() {
+  gl_FragColor = kColor;
+})", dev::ShaderType::FragmentShader, &info);
+    TEST_REQUIRE(vs.IsValid());
+    TEST_REQUIRE(fs.IsValid());
+    const auto program = device->BuildProgram({vs, fs}, &info);
+    TEST_REQUIRE(program.IsValid());
+
+    const gfx::Vec2 verts[] = {
+        {-1,  1}, {-1, -1}, { 1, -1},
+        {-1,  1}, { 1, -1}, { 1,  1}
+    };
+    const auto buffer = device->AllocateBuffer(sizeof(verts), dev::BufferUsage::Static, dev::BufferType::VertexBuffer);
+
+    dev::CommandBuffer commands(device.get());
+
+    // the immediate functions are device thread only.
+    const auto fbo = device->GetDefaultFramebuffer();
+
+    // record the commands on a worker thread.
+    std::thread worker([&commands, program, buffer, fbo, &verts]() {
+        dev::VertexLayout layout(sizeof(gfx::Vec2), {
+            {"aPosition", 0, 2, 0, 0}
+        });
+        dev::ViewportState vs;
+        vs.viewport = base::IRect(0, 0, 10, 10);
+
+        dev::ColorDepthStencilState dss;
+        dss.bWriteColor  = true;
+        dss.stencil_func = dev::StencilFunc::Disabled;
+
+        dev::RasterState rs;
+        rs.blending = dev::BlendOp::None;
+
+        dev::Uniform color { "kColor", gfx::Color4f(gfx::Color::Green) };
+        dev::ProgramState ps;
+        ps.uniforms.push_back(&color);
+
+        commands.BeginFrame();
+        commands.UploadBuffer(buffer, verts, sizeof(verts));
+        commands.ClearColor(gfx::Color::Red, fbo, dev::ColorAttachment::Attachment0);
+        commands.BindFramebuffer(fbo);
+        commands.SetViewportState(vs);
+        commands.SetColorDepthStencilState(dss);
+        commands.SetRasterState(rs);
+        commands.SetProgramState(program, ps);
+        commands.BindVertexBuffer(buffer, program, layout);
+        commands.DrawArrays(dev::DrawType::Triangles, 0, 6);
+        commands.EndFrame(false);
+    });
+    worker.join();
+
+    TEST_REQUIRE(commands.GetCommandCount() == 11);
+
+    // nothing has been drawn yet.
+    gfx::Bitmap<gfx::Pixel_RGBA> bmp(10, 10);
+    device->ClearColor(gfx::Color::Black, device->GetDefaultFramebuffer(), dev::ColorAttachment::Attachment0);
+    device->ReadColor(10, 10, device->GetDefaultFramebuffer(), bmp.GetDataPtr());
+    TEST_REQUIRE(bmp.PixelCompare(gfx::Color::Black));
+
+    commands.Execute();
+    device->ReadColor(10, 10, device->GetDefaultFramebuffer(), bmp.GetDataPtr());
+    TEST_REQUIRE(bmp.PixelCompare(gfx::Color::Green));
+
+    commands.Clear();
+    TEST_REQUIRE(commands.IsEmpty());
+
+    device->FreeBuffer(buffer);
+    device->DeleteProgram(program);
+    device->DeleteShader(vs);
+    device->DeleteShader(fs);
+}
+
+void unit_test_command_buffer_instanced()
+{
+    TEST_CASE(test::Type::Feature)
+
+    auto context = std::make_shared<TestContext>(10, 10);
+    auto device  = dev::CreateDevice(context)->GetSharedGraphicsDevice();
+
+    std::string info;
+    const auto vs = device->CompileShader(
+R"(#version 100
+attribute vec2 aPosition;
+void main() {
+  gl_Position = vec4(aPosition.xy, 1.0, 1.0);
+})", dev::ShaderType::VertexShader, &info);
+    const auto fs = device->CompileShader(
+R"(#version 100
+precision mediump float;
+uniform vec4 kColor;
+void main() {
+  gl_FragColor = kColor;
+})", dev::ShaderType::FragmentShader, &info);
+    TEST_REQUIRE(vs.IsValid());
+    TEST_REQUIRE(fs.IsValid());
+    const auto program = device->BuildProgram({vs, fs}, &info);
+    TEST_REQUIRE(program.IsValid());
+
+    const gfx::Vec2 verts[] = {
+        {-1,  1}, {-1, -1}, { 1, -1},
+        {-1,  1}, { 1, -1}, { 1,  1}
+    };
+    const auto buffer = device->AllocateBuffer(sizeof(verts), dev::BufferUsage::Static, dev::BufferType::VertexBuffer);
+    device->UploadBuffer(buffer, verts, sizeof(verts));
+
+    const auto fbo = device->GetDefaultFramebuffer();
+
+    dev::VertexLayout layout(sizeof(gfx::Vec2), {
+        {"aPosition", 0, 2, 0, 0}
+    });
+    dev::ViewportState viewport;
+    viewport.viewport = base::IRect(0, 0, 10, 10);
+
+    dev::ColorDepthStencilState dss;
+    dss.bWriteColor  = true;
+    dss.stencil_func = dev::StencilFunc::Disabled;
+
+    dev::RasterState rs;
+    rs.blending = dev::BlendOp::None;
+
+    dev::Uniform color { "kColor", gfx::Color4f(gfx::Color::Red) };
+    dev::ProgramState ps;
+    ps.uniforms.push_back(&color);
+
+    const auto record = [&](dev::CommandBuffer& commands, unsigned instance_count) {
+        commands.ClearColor(gfx::Color::Green, fbo, dev::ColorAttachment::Attachment0);
+        commands.BindFramebuffer(fbo);
+        commands.SetViewportState(viewport);
+        commands.SetColorDepthStencilState(dss);
+        commands.SetRasterState(rs);
+        commands.SetProgramState(program, ps);
+        commands.BindVertexBuffer(buffer, program, layout);
+        commands.DrawArraysInstanced(dev::DrawType::Triangles, 0, 6, instance_count);
+    };
+
+    gfx::Bitmap<gfx::Pixel_RGBA> bmp(10, 10);
+
+    // an instanced draw with zero instances draws nothing.
+    {
+        dev::CommandBuffer commands(device.get());
+        record(commands, 0);
+        commands.Execute();
+        device->ReadColor(10, 10, fbo, bmp.GetDataPtr());
+        TEST_REQUIRE(bmp.PixelCompare(gfx::Color::Green));
+    }
+
+    {
+        dev::CommandBuffer commands(device.get());
+        record(commands, 1);
+        commands.Execute();
+        device->ReadColor(10, 10, fbo, bmp.GetDataPtr());
+        TEST_REQUIRE(bmp.PixelCompare(gfx::Color::Red));
+    }
+
+    device->FreeBuffer(buffer);
+    device->DeleteProgram(program);
+    device->DeleteShader(vs);
+    device->DeleteShader(fs);
+}
+
 void unit_test_ibo_allocation()
 {
     TEST_CASE(test::Type::Feature)
@@ -1831,7 +2371,7 @@ void unit_test_ibo_allocation()
         dev->GetResourceStats(&stats);
         TEST_REQUIRE(stats.streaming_ibo_mem_use == 0);
         TEST_REQUIRE(stats.streaming_ibo_mem_alloc > 0);
-        TEST_REQUIRE(stats.dynamic_ibo_mem_alloc == sizeof(junk_data) + sizeof(junk_data));
+        TEST_REQUIRE(stats.dynamic_ibo_mem_alloc >= sizeof(junk_data) + sizeof(junk_data));
         TEST_REQUIRE(stats.dynamic_ibo_mem_use == sizeof(junk_data) + sizeof(junk_data));
         TEST_REQUIRE(stats.static_ibo_mem_use == 0);
         TEST_REQUIRE(stats.static_ibo_mem_alloc > 0);
@@ -2290,6 +2830,260 @@ void unit_test_algo_texture_read()
     TEST_REQUIRE(*rgba_ret == bmp);
 }
 
+// check that the CPU versions of the texture effects that are used
+// when baking textures offline match the GPU versions.
+void unit_test_algo_texture_effects_cpu()
+{
+    TEST_CASE(test::Type::Feature)
+
+    auto dev = CreateDevice();
+
+    gfx::Bitmap<gfx::Pixel_RGBA> bmp(32, 32);
+    for (unsigned row=0; row<32; ++row)
+    {
+        for (unsigned col=0; col<32; ++col)
+        {
+            const auto x = (float)col - 15.5f;
+            const auto y = (float)row - 15.5f;
+            const auto inside = x*x + y*y < 100.0f;
+            bmp.SetPixel(row, col, gfx::Pixel_RGBA(col * 8, row * 8, 100, inside ? 255 : 0));
+        }
+    }
+    const auto compare = [](const gfx::Pixel_RGBA& lhs, const gfx::Pixel_RGBA& rhs) {
+        return std::abs(lhs.r - rhs.r) <= 4 &&
+               std::abs(lhs.g - rhs.g) <= 4 &&
+               std::abs(lhs.b - rhs.b) <= 4 &&
+               std::abs(lhs.a - rhs.a) <= 4;
+    };
+
+    for (int i=0; i<2; ++i)
+    {
+        const bool blur = i == 1;
+
+        auto* tex = dev->MakeTexture("texture");
+        // flip the bitmap now temporarily to match the layout expected by OpenGL
+        bmp.FlipHorizontally();
+        tex->Upload(bmp.GetDataPtr(), 32, 32, gfx::Texture::Format::sRGBA);
+        bmp.FlipHorizontally();
+        tex->SetFilter(gfx::Texture::MinFilter::Linear);
+        tex->SetFilter(gfx::Texture::MagFilter::Linear);
+        tex->SetWrapX(gfx::Texture::Wrapping::Clamp);
+        tex->SetWrapY(gfx::Texture::Wrapping::Clamp);
+
+        gfx::RgbaBitmap expected = bmp;
+        if (blur)
+        {
+            gfx::algo::ApplyBlur("texture", tex, dev.get());
+            gfx::BlurBitmap(expected, 4, true);
+        }
+        else
+        {
+            gfx::algo::DetectSpriteEdges("texture", tex, dev.get());
+            gfx::DetectBitmapEdges(expected, gfx::Pixel_RGBA(255, 255, 255, 255));
+        }
+
+        const auto& ret = gfx::algo::ReadColorTexture(tex, dev.get());
+        const auto* rgba_ret = dynamic_cast<const gfx::RgbaBitmap*>(ret.get());
+        TEST_REQUIRE(gfx::PixelCompare(*rgba_ret, expected, compare));
+        dev->DeleteTextures();
+    }
+}
+
+// check that redundant state setting calls are culled by the
+// device and don't end up as actual GL calls.
+void unit_test_redundant_state_calls()
+{
+    TEST_CASE(test::Type::Feature)
+
+    auto dev = CreateDevice();
+
+    auto geom = MakeQuad(*dev);
+
+    constexpr const char* fssrc =
+R"(#version 100
+precision mediump float;
+varying vec2 vTexCoord;
+uniform sampler2D kTexture;
+uniform vec4 kColor;
+void main() {
+  gl_FragColor = texture2D(kTexture, vTexCoord.xy) * kColor;
+})";
+
+    constexpr const char* vssrc =
+R"(#version 100
+attribute vec2 aPosition;
+attribute vec2 aTexCoord;
+varying vec2 vTexCoord;
+void main() {
+  gl_Position = vec4(aPosition.xy, 1.0, 1.0);
+  vTexCoord = aTexCoord;
+})";
+    auto prog = MakeTestProgram(*dev, vssrc, fssrc, "prog");
+
+    gfx::Bitmap<gfx::Pixel_RGBA> data(4, 4);
+    data.Fill(gfx::Color::White);
+    auto* texture = dev->MakeTexture("tex");
+    texture->Upload(data.GetDataPtr(), 4, 4, gfx::Texture::Format::RGBA);
+
+    gfx::Device::RasterState state;
+    state.blending = gfx::Device::RasterState::BlendOp::None;
+
+    gfx::Device::ColorDepthStencilState dss;
+    dss.bWriteColor  = true;
+    dss.stencil_func = gfx::Device::ColorDepthStencilState::StencilFunc::Disabled;
+
+    gfx::Device::ViewportState vs;
+    vs.viewport = gfx::IRect(0, 0, 10, 10);
+
+    gfx::ProgramState program_state;
+    program_state.SetTexture("kTexture", 0, *texture);
+    program_state.SetTextureCount(1);
+    program_state.SetUniform("kColor", gfx::Color4f(gfx::Color::Green));
+
+    dev->BeginFrame();
+    dev->ClearColor(gfx::Color::Red);
+    dev->SetColorDepthStencilState(dss);
+    dev->SetViewportState(vs);
+    dev->Draw(*prog, program_state, *geom, state);
+
+    gfx::Device::StateStats first;
+    dev->GetStateStats(&first);
+    TEST_REQUIRE(first.program_binds_issued == 1);
+    TEST_REQUIRE(first.uniform_sets_issued == 2);
+    TEST_REQUIRE(first.texture_binds_issued >= 1);
+    TEST_REQUIRE(first.buffer_binds_issued >= 1);
+
+    // exactly the same draw again. nothing should change.
+    dev->SetColorDepthStencilState(dss);
+    dev->SetViewportState(vs);
+    dev->Draw(*prog, program_state, *geom, state);
+
+    gfx::Device::StateStats second;
+    dev->GetStateStats(&second);
+    TEST_REQUIRE(second.program_binds_issued == first.program_binds_issued);
+    TEST_REQUIRE(second.program_binds_skipped == first.program_binds_skipped + 1);
+    TEST_REQUIRE(second.uniform_sets_issued == first.uniform_sets_issued);
+    TEST_REQUIRE(second.uniform_sets_skipped == first.uniform_sets_skipped + 2);
+    TEST_REQUIRE(second.texture_binds_issued == first.texture_binds_issued);
+    TEST_REQUIRE(second.texture_binds_skipped == first.texture_binds_skipped + 1);
+    TEST_REQUIRE(second.buffer_binds_issued == first.buffer_binds_issued);
+    TEST_REQUIRE(second.buffer_binds_skipped > first.buffer_binds_skipped);
+    TEST_REQUIRE(second.render_state_issued == first.render_state_issued);
+    TEST_REQUIRE(second.render_state_skipped > first.render_state_skipped);
+
+    // change the color, only the color uniform should get set.
+    program_state.Clear();
+    program_state.SetTexture("kTexture", 0, *texture);
+    program_state.SetTextureCount(1);
+    program_state.SetUniform("kColor", gfx::Color4f(gfx::Color::Blue));
+    dev->Draw(*prog, program_state, *geom, state);
+
+    gfx::Device::StateStats third;
+    dev->GetStateStats(&third);
+    TEST_REQUIRE(third.program_binds_issued == second.program_binds_issued);
+    TEST_REQUIRE(third.uniform_sets_issued == second.uniform_sets_issued + 1);
+    TEST_REQUIRE(third.uniform_sets_skipped == second.uniform_sets_skipped + 1);
+    TEST_REQUIRE(third.texture_binds_issued == second.texture_binds_issued);
+    dev->EndFrame();
+
+    const auto& bmp = dev->ReadColorBuffer(10, 10);
+    TEST_REQUIRE(bmp.PixelCompare(gfx::Color::Blue));
+
+    // the uniform values are retained by the program object
+    // but the bindings are re-established on a new frame.
+    dev->BeginFrame();
+    dev->ClearColor(gfx::Color::Red);
+    dev->Draw(*prog, program_state, *geom, state);
+    dev->EndFrame();
+
+    gfx::Device::StateStats fourth;
+    dev->GetStateStats(&fourth);
+    TEST_REQUIRE(fourth.program_binds_issued == 1);
+    TEST_REQUIRE(fourth.uniform_sets_issued == 0);
+    TEST_REQUIRE(fourth.uniform_sets_skipped == 2);
+
+    TEST_REQUIRE(dev->ReadColorBuffer(10, 10).PixelCompare(gfx::Color::Blue));
+}
+
+void unit_test_uniform_array_alias()
+{
+    TEST_CASE(test::Type::Feature)
+
+    auto dev = CreateDevice();
+
+    auto geom = MakeQuad(*dev);
+
+    constexpr const char* fssrc =
+R"(#version 100
+precision mediump float;
+uniform vec4 kColors[2];
+void main() {
+  gl_FragColor = kColors[0] + kColors[1];
+})";
+
+    constexpr const char* vssrc =
+R"(#version 100
+attribute vec2 aPosition;
+void main() {
+  gl_Position = vec4(aPosition.xy, 1.0, 1.0);
+})";
+    auto prog = MakeTestProgram(*dev, vssrc, fssrc, "prog");
+
+    gfx::Device::RasterState state;
+    state.blending = gfx::Device::RasterState::BlendOp::None;
+
+    gfx::Device::ColorDepthStencilState dss;
+    dss.bWriteColor  = true;
+    dss.stencil_func = gfx::Device::ColorDepthStencilState::StencilFunc::Disabled;
+
+    gfx::Device::ViewportState vs;
+    vs.viewport = gfx::IRect(0, 0, 10, 10);
+
+    dev->BeginFrame();
+    dev->ClearColor(gfx::Color::Red);
+    dev->SetColorDepthStencilState(dss);
+    dev->SetViewportState(vs);
+
+    // the array name refers to the first element.
+    gfx::ProgramState program_state;
+    program_state.SetUniform("kColors", gfx::Color4f(gfx::Color::Green));
+    program_state.SetUniform("kColors[1]", gfx::Color4f(gfx::Color::Black));
+    dev->Draw(*prog, program_state, *geom, state);
+
+    gfx::Device::StateStats first;
+    dev->GetStateStats(&first);
+    TEST_REQUIRE(first.uniform_sets_issued == 2);
+    TEST_REQUIRE(dev->ReadColorBuffer(10, 10).PixelCompare(gfx::Color::Green));
+
+    // setting the same value through the first element name
+    // is the same uniform and must be skipped.
+    program_state.Clear();
+    program_state.SetUniform("kColors[0]", gfx::Color4f(gfx::Color::Green));
+    dev->Draw(*prog, program_state, *geom, state);
+
+    gfx::Device::StateStats second;
+    dev->GetStateStats(&second);
+    TEST_REQUIRE(second.uniform_sets_issued == first.uniform_sets_issued);
+    TEST_REQUIRE(second.uniform_sets_skipped == first.uniform_sets_skipped + 1);
+
+    // changing the value through the first element name and then
+    // going back to the old value through the array name must not
+    // be skipped since the program has the new value.
+    program_state.Clear();
+    program_state.SetUniform("kColors[0]", gfx::Color4f(gfx::Color::Blue));
+    dev->Draw(*prog, program_state, *geom, state);
+    program_state.Clear();
+    program_state.SetUniform("kColors", gfx::Color4f(gfx::Color::Green));
+    dev->Draw(*prog, program_state, *geom, state);
+
+    gfx::Device::StateStats third;
+    dev->GetStateStats(&third);
+    TEST_REQUIRE(third.uniform_sets_issued == second.uniform_sets_issued + 2);
+    dev->EndFrame();
+
+    TEST_REQUIRE(dev->ReadColorBuffer(10, 10).PixelCompare(gfx::Color::Green));
+}
+
 void unit_test_instanced_rendering()
 {
     TEST_CASE(test::Type::Feature)
@@ -2669,6 +3463,206 @@ void main() {
 
 }
 
+void unit_test_uniform_buffer_ring()
+{
+    TEST_CASE(test::Type::Feature)
+
+    {
+        auto context = std::make_shared<TestContext>(10, 10);
+        auto device  = dev::CreateDevice(context)->GetSharedGraphicsDevice();
+
+        dev::GraphicsDeviceCaps caps;
+        device->GetDeviceCaps(&caps);
+        TEST_REQUIRE(caps.uniform_buffer_offset_alignment);
+
+        gfx::DeviceUniformBuffer ring(device.get());
+
+        const float data0[4] = {1.0f, 2.0f, 3.0f, 4.0f};
+        const float data1[4] = {4.0f, 3.0f, 2.0f, 1.0f};
+
+        ring.BeginFrame();
+        const auto& a = ring.Upload(data0, sizeof(data0));
+        const auto& b = ring.Upload(data1, sizeof(data1));
+        const auto& c = ring.Upload(data0, sizeof(data0));
+        TEST_REQUIRE(a.handle == c.handle);
+        TEST_REQUIRE(a.buffer_offset == c.buffer_offset);
+        TEST_REQUIRE(a.buffer_bytes == sizeof(data0));
+        TEST_REQUIRE(a.handle == b.handle);
+        TEST_REQUIRE(a.buffer_offset != b.buffer_offset);
+        TEST_REQUIRE(b.buffer_offset % caps.uniform_buffer_offset_alignment == 0);
+        TEST_REQUIRE(ring.GetStats().uploads == 2);
+        TEST_REQUIRE(ring.GetStats().reuses == 1);
+
+        // next frame uses a different buffer.
+        ring.BeginFrame();
+        const auto& d = ring.Upload(data0, sizeof(data0));
+        TEST_REQUIRE(d.handle != a.handle || d.buffer_offset != a.buffer_offset);
+        TEST_REQUIRE(ring.GetStats().uploads == 1);
+        TEST_REQUIRE(ring.GetStats().reuses == 0);
+
+        // data that doesn't fit in the current buffer
+        std::vector<std::uint8_t> big;
+        big.resize(gfx::DeviceUniformBuffer::BufferSize);
+        const auto& e = ring.Upload(big.data(), big.size());
+        TEST_REQUIRE(e.handle != d.handle || e.buffer_offset >= d.buffer_offset + sizeof(data0));
+        TEST_REQUIRE(e.buffer_bytes == big.size());
+
+        // the ring wraps back to the first frame's buffers.
+        ring.BeginFrame();
+        ring.BeginFrame();
+        const auto& f = ring.Upload(data1, sizeof(data1));
+        TEST_REQUIRE(f.handle == a.handle);
+        TEST_REQUIRE(f.buffer_offset == a.buffer_offset);
+    }
+
+    // multiple draws with different block data within the same frame.
+    auto dev = CreateDevice();
+    auto geom = MakeQuad(*dev);
+    auto p0 = MakeTestProgram(*dev,
+R"(#version 300 es
+
+in vec2 aPosition;
+
+void main() {
+  gl_Position = vec4(aPosition.xy, 1.0, 1.0);
+}
+)",
+
+R"(#version 300 es
+precision highp float;
+
+layout (std140) uniform Testing {
+   vec4 color;
+};
+
+layout(location = 0) out vec4 fragOutColor0;
+
+void main() {
+   fragOutColor0 = color;
+}
+)", "p0");
+
+    gfx::Device::RasterState state;
+    state.blending = gfx::Device::RasterState::BlendOp::None;
+
+    gfx::Device::ColorDepthStencilState dss;
+    dss.bWriteColor  = true;
+    dss.stencil_func = gfx::Device::ColorDepthStencilState::StencilFunc::Disabled;
+    dev->SetColorDepthStencilState(dss);
+
+    gfx::GeometryDrawCommand draw_command(*geom);
+    gfx::ProgramState program_state;
+
+    dev->BeginFrame();
+    dev->ClearColor(gfx::Color::Black);
+
+    gfx::Device::ViewportState vs;
+    vs.viewport = gfx::IRect(0, 0, 5, 10);
+    dev->SetViewportState(vs);
+    gfx::UniformBlock block("Testing");
+    auto uniform_block_data = block.GetData<gfx::Vec4>();
+    uniform_block_data.Resize(1);
+    uniform_block_data[0] = gfx::ToVec(gfx::Color::Red);
+    program_state.Clear();
+    program_state.SetUniformBlock(block);
+    dev->Draw(*p0, program_state, draw_command, state);
+
+    vs.viewport = gfx::IRect(5, 0, 5, 10);
+    dev->SetViewportState(vs);
+    uniform_block_data[0] = gfx::ToVec(gfx::Color::Green);
+    program_state.Clear();
+    program_state.SetUniformBlock(block);
+    dev->Draw(*p0, program_state, draw_command, state);
+    dev->EndFrame();
+
+    const auto& bmp = dev->ReadColorBuffer(10, 10);
+    TEST_REQUIRE(bmp.PixelCompare(gfx::URect(0, 0, 5, 10), gfx::Color::Red));
+    TEST_REQUIRE(bmp.PixelCompare(gfx::URect(5, 0, 5, 10), gfx::Color::Green));
+}
+
+void unit_test_buffer_compaction()
+{
+    TEST_CASE(test::Type::Feature)
+
+    auto dev = CreateDevice();
+
+    char junk_data[512] = {0};
+    {
+        gfx::Geometry::CreateArgs args;
+        args.buffer.SetVertexBuffer(junk_data, sizeof(junk_data));
+        args.usage = gfx::GeometryBuffer::Usage::Static;
+        dev->CreateGeometry("junk", std::move(args));
+    }
+
+    auto geom = MakeQuad(*dev);
+    auto p0 = MakeTestProgram(*dev,
+R"(#version 300 es
+in vec2 aPosition;
+void main() {
+  gl_Position = vec4(aPosition.xy, 1.0, 1.0);
+}
+)",
+R"(#version 300 es
+precision mediump float;
+layout(location = 0) out vec4 fragOutColor0;
+void main() {
+  fragOutColor0 = vec4(1.0, 0.0, 0.0, 1.0);
+}
+)", "p0");
+
+    gfx::Device::RasterState state;
+    state.blending = gfx::Device::RasterState::BlendOp::None;
+
+    gfx::Device::ColorDepthStencilState dss;
+    dss.bWriteColor  = true;
+    dss.stencil_func = gfx::Device::ColorDepthStencilState::StencilFunc::Disabled;
+    dev->SetColorDepthStencilState(dss);
+
+    gfx::Device::ViewportState vs;
+    vs.viewport = gfx::IRect(0, 0, 10, 10);
+    dev->SetViewportState(vs);
+
+    gfx::ProgramState program_state;
+
+    dev->BeginFrame();
+    dev->EndFrame();
+
+    dev->BeginFrame();
+      dev->ClearColor(gfx::Color::Black);
+      dev->Draw(*p0, program_state, gfx::GeometryDrawCommand(*geom), state);
+    dev->EndFrame();
+
+    // delete the junk geometry which leaves a hole in front of the quad.
+    dev->CleanGarbage(2, gfx::Device::GCFlags::Geometries);
+    TEST_REQUIRE(dev->FindGeometry("junk") == nullptr);
+    TEST_REQUIRE(dev->FindGeometry("quad"));
+
+    gfx::Device::ResourceStats stats;
+    dev->GetResourceStats(&stats);
+    TEST_REQUIRE(stats.buffer_free_ranges == 2);
+    TEST_REQUIRE(stats.buffer_relocations == 0);
+
+    dev->CleanGarbage(2, gfx::Device::GCFlags::Buffers);
+    dev->GetResourceStats(&stats);
+    TEST_REQUIRE(stats.buffer_free_ranges == 1);
+    TEST_REQUIRE(stats.buffer_relocations == 1);
+    TEST_REQUIRE(stats.buffer_relocated_bytes == sizeof(gfx::Vertex2D) * 6);
+
+    // nothing more to do
+    dev->CleanGarbage(2, gfx::Device::GCFlags::Buffers);
+    dev->GetResourceStats(&stats);
+    TEST_REQUIRE(stats.buffer_relocations == 1);
+
+    // the geometry data must have been moved.
+    dev->BeginFrame();
+      dev->ClearColor(gfx::Color::Black);
+      dev->Draw(*p0, program_state, gfx::GeometryDrawCommand(*geom), state);
+    dev->EndFrame();
+
+    const auto& bmp = dev->ReadColorBuffer(10, 10);
+    TEST_REQUIRE(bmp.PixelCompare(gfx::Color::Red));
+}
+
 void unit_test_data_texture()
 {
     TEST_CASE(test::Type::Feature)
@@ -3299,21 +4293,29 @@ int test_main(int argc, char* argv[])
     unit_test_render_fbo(gfx::Framebuffer::Format::ColorRGBA8_Depth24_Stencil8, gfx::Framebuffer::MSAA::Enabled);
     unit_test_render_color_only();
     unit_test_render_with_single_texture();
+    unit_test_render_with_compressed_texture();
     unit_test_render_with_multiple_textures();
     unit_test_render_set_float_uniforms();
     unit_test_render_set_int_uniforms();
     unit_test_render_set_matrix2x2_uniform();
     unit_test_render_set_matrix3x3_uniform();
     unit_test_render_set_matrix4x4_uniform();
+    unit_test_render_set_uniform_array();
     unit_test_uniform_sampler_optimize_bug();
     unit_test_clean_textures();
+    unit_test_texture_budget();
     unit_test_vbo_allocation();
+    unit_test_buffer_suballocation();
     unit_test_ibo_allocation();
     unit_test_max_texture_units_single_texture();
     unit_test_max_texture_units_many_textures();
     unit_test_algo_texture_copy();
     unit_test_algo_texture_flip();
     unit_test_algo_texture_read();
+    unit_test_algo_texture_effects_cpu();
+    unit_test_redundant_state_calls();
+    unit_test_uniform_array_alias();
+    unit_test_command_buffer();
 
     if (TestContext::GL_ES_Version == 3)
     {
@@ -3323,8 +4325,11 @@ int test_main(int argc, char* argv[])
         unit_test_render_set_uint_uniforms();
 
         unit_test_instanced_rendering();
+        unit_test_command_buffer_instanced();
         unit_test_uniform_buffer();
         unit_test_uniform_buffer_array();
+        unit_test_uniform_buffer_ring();
+        unit_test_buffer_compaction();
         unit_test_data_texture();
 
         unit_test_render_fbo_multiple_color_targets(gfx::Framebuffer::Format::ColorRGBA8, gfx::Framebuffer::MSAA::Disabled);
@@ -16,20 +16,32 @@
 
 #include "config.h"
 
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
 #include "base/test_minimal.h"
 #include "base/test_float.h"
+#include "base/format.h"
 #include "base/utility.h"
 #include "data/json.h"
 #include "graphics/device.h"
 #include "graphics/texture.h"
+#include "graphics/texture_streamer.h"
 #include "graphics/drawable.h"
 #include "graphics/geometry.h"
 #include "graphics/drawcmd.h"
 #include "graphics/linebatch.h"
+#include "graphics/spritebatch.h"
 #include "graphics/guidegrid.h"
 #include "graphics/polygon_mesh.h"
 #include "graphics/particle_engine.h"
+#include "graphics/fluid_simulation.h"
 #include "graphics/simple_shape.h"
+#include "graphics/text_buffer.h"
+#include "graphics/text_drawable.h"
+#include "graphics/transform.h"
 #include "graphics/tool/polygon.h"
 #include "graphics/vertex_algo.h"
 #include "graphics/geometry_algo.h"
@@ -997,6 +1009,73 @@ void unit_test_particle_engine_data()
     }
 }
 
+void unit_test_fluid_simulation_data()
+{
+    TEST_CASE(test::Type::Feature)
+
+    gfx::FluidSimulationClass::Params params;
+    params.grid_width  = 32;
+    params.grid_height = 16;
+    params.solver_iterations = 10;
+    params.time_step   = 0.02f;
+    params.viscosity   = 0.1f;
+    params.diffusion   = 0.2f;
+    params.density_dissipation  = 0.3f;
+    params.velocity_dissipation = 0.4f;
+    params.buoyancy    = 0.5f;
+    gfx::FluidSimulationClass klass(params);
+    klass.SetName("smoke");
+
+    // to/from json
+    {
+        data::JsonObject json;
+        klass.IntoJson(json);
+        gfx::FluidSimulationClass ret;
+        TEST_REQUIRE(ret.FromJson(json));
+        TEST_REQUIRE(ret.GetId() == klass.GetId());
+        TEST_REQUIRE(ret.GetName() == "smoke");
+        TEST_REQUIRE(ret.GetHash() == klass.GetHash());
+
+        const auto& p = ret.GetParams();
+        TEST_REQUIRE(p.grid_width           == 32);
+        TEST_REQUIRE(p.grid_height          == 16);
+        TEST_REQUIRE(p.solver_iterations    == 10);
+        TEST_REQUIRE(p.time_step            == real::float32(0.02f));
+        TEST_REQUIRE(p.viscosity            == real::float32(0.1f));
+        TEST_REQUIRE(p.diffusion            == real::float32(0.2f));
+        TEST_REQUIRE(p.density_dissipation  == real::float32(0.3f));
+        TEST_REQUIRE(p.velocity_dissipation == real::float32(0.4f));
+        TEST_REQUIRE(p.buoyancy             == real::float32(0.5f));
+    }
+
+    // test virtual copy/clone
+    {
+        auto copy = klass.Copy();
+        TEST_REQUIRE(copy->GetId() == klass.GetId());
+        TEST_REQUIRE(copy->GetHash() == klass.GetHash());
+
+        auto clone = klass.Clone();
+        TEST_REQUIRE(clone->GetId() != klass.GetId());
+        TEST_REQUIRE(clone->GetHash() != klass.GetHash());
+    }
+
+    // create instance through the drawable factory
+    {
+        std::shared_ptr<const gfx::DrawableClass> ptr = klass.Copy();
+        auto instance = gfx::CreateDrawableInstance(ptr);
+        TEST_REQUIRE(instance);
+        TEST_REQUIRE(instance->GetType() == gfx::Drawable::Type::FluidSimulation);
+        TEST_REQUIRE(instance->GetDrawCategory() == gfx::DrawCategory::Basic);
+        TEST_REQUIRE(instance->GetClass() == ptr.get());
+
+        const auto* fluid = dynamic_cast<const gfx::FluidSimulationInstance*>(instance.get());
+        TEST_REQUIRE(fluid);
+        TEST_REQUIRE(fluid->GetGrid().width  == 32);
+        TEST_REQUIRE(fluid->GetGrid().height == 16);
+        TEST_REQUIRE(fluid->GetGrid().density.size() == 34 * 18);
+    }
+}
+
 void unit_test_polygon_data()
 {
     TEST_CASE(test::Type::Feature)
@@ -1337,6 +1416,406 @@ void unit_test_shader_id()
     }
 }
 
+void unit_test_sprite_batch()
+{
+    TEST_CASE(test::Type::Feature)
+
+    auto klass = std::make_shared<gfx::RectangleClass>();
+    gfx::RectangleClassInstance rect(klass);
+
+    TEST_REQUIRE(gfx::SpriteBatch::CanBatch(rect));
+    TEST_REQUIRE(gfx::SpriteBatch::CanBatch(gfx::Rectangle()));
+    TEST_REQUIRE(!gfx::SpriteBatch::CanBatch(gfx::Rectangle(gfx::SimpleShapeStyle::Outline)));
+    TEST_REQUIRE(!gfx::SpriteBatch::CanBatch(gfx::Circle()));
+
+    gfx::Transform transform;
+    transform.Resize(10.0f, 20.0f);
+    transform.Translate(100.0f, 50.0f);
+    const auto first = transform.GetAsMatrix();
+    transform.RotateAroundZ(0.5f);
+    const auto second = transform.GetAsMatrix();
+
+    gfx::SpriteBatch batch;
+    TEST_REQUIRE(batch.IsEmpty());
+    batch.AddSprite(first);
+    batch.AddSprite(second);
+    TEST_REQUIRE(batch.GetNumSprites() == 2);
+
+    TestDevice device;
+    gfx::Drawable::Environment env;
+    // the batch must use the same program as the rectangles it replaces.
+    TEST_REQUIRE(batch.GetShaderId(env) == rect.GetShaderId(env));
+
+    gfx::Geometry::CreateArgs batch_geometry;
+    TEST_REQUIRE(batch.Construct(env, device, batch_geometry));
+    TEST_REQUIRE(batch_geometry.usage == gfx::Geometry::Usage::Stream);
+
+    gfx::Geometry::CreateArgs rect_geometry;
+    TEST_REQUIRE(rect.Construct(env, device, rect_geometry));
+
+    const gfx::VertexStream batch_stream(batch_geometry.buffer.GetLayout(),
+                                         batch_geometry.buffer.GetVertexBuffer());
+    const gfx::VertexStream rect_stream(rect_geometry.buffer.GetLayout(),
+                                        rect_geometry.buffer.GetVertexBuffer());
+    TEST_REQUIRE(batch_stream.GetCount() == 12);
+    TEST_REQUIRE(rect_stream.GetCount() == 6);
+
+    // the batched vertices with identity model transform must end up in
+    // the same place as the rectangle vertices with the sprite transform.
+    // remember that the vertex shader flips the Y.
+    const glm::mat4 models[2] = { first, second };
+    for (unsigned sprite=0; sprite<2; ++sprite)
+    {
+        for (unsigned i=0; i<6; ++i)
+        {
+            const auto* rect_vertex  = rect_stream.GetVertex<gfx::Vertex2D>(i);
+            const auto* batch_vertex = batch_stream.GetVertex<gfx::Vertex2D>(sprite * 6 + i);
+            const auto& expected = models[sprite] * glm::vec4(rect_vertex->aPosition.x, -rect_vertex->aPosition.y, 0.0f, 1.0f);
+            TEST_REQUIRE(real::equals(batch_vertex->aPosition.x,  expected.x));
+            TEST_REQUIRE(real::equals(batch_vertex->aPosition.y, -expected.y));
+            TEST_REQUIRE(batch_vertex->aTexCoord.x == rect_vertex->aTexCoord.x);
+            TEST_REQUIRE(batch_vertex->aTexCoord.y == rect_vertex->aTexCoord.y);
+        }
+    }
+}
+
+// compose the glyph quads into a bitmap by sampling the glyph atlas.
+gfx::AlphaMask ComposeGlyphQuads(const std::vector<gfx::TextBuffer::GlyphQuad>& quads, unsigned width, unsigned height)
+{
+    const auto& atlas = gfx::TextBuffer::GetGlyphAtlasBitmap();
+    const float atlas_width  = atlas.GetWidth();
+    const float atlas_height = atlas.GetHeight();
+
+    gfx::AlphaMask out(width, height);
+    out.Fill(gfx::Pixel_A(0));
+    for (const auto& quad : quads)
+    {
+        TEST_REQUIRE(quad.x >= 0.0f && quad.x + quad.width <= width);
+        TEST_REQUIRE(quad.y >= 0.0f && quad.y + quad.height <= height);
+        for (unsigned row=0; row<(unsigned)quad.height; ++row)
+        {
+            for (unsigned col=0; col<(unsigned)quad.width; ++col)
+            {
+                const auto u = quad.texture_x + (col + 0.5f) / quad.width * quad.texture_width;
+                const auto v = quad.texture_y + (row + 0.5f) / quad.height * quad.texture_height;
+                const auto& src = atlas.GetPixel(unsigned(v * atlas_height), unsigned(u * atlas_width));
+                const auto& dst = out.GetPixel(quad.y + row, quad.x + col);
+                out.SetPixel(quad.y + row, quad.x + col, gfx::Pixel_A(src.r | dst.r));
+            }
+        }
+    }
+    return out;
+}
+
+void unit_test_glyph_text()
+{
+    TEST_CASE(test::Type::Feature)
+
+    const auto* font = "../graphics/test/dist/fonts/Cousine-Regular.ttf";
+
+    using HAlign = gfx::TextBuffer::HorizontalAlignment;
+    using VAlign = gfx::TextBuffer::VerticalAlignment;
+
+    struct TestCase {
+        unsigned buffer_width;
+        unsigned buffer_height;
+        HAlign halign;
+        VAlign valign;
+        bool underline;
+        const char* text;
+    } cases[] = {
+        {0,   0,   HAlign::AlignLeft,   VAlign::AlignTop,    false, "Hello World!"},
+        {0,   0,   HAlign::AlignCenter, VAlign::AlignCenter, false, "Hello\nWorld, jumpy quartz"},
+        {0,   0,   HAlign::AlignRight,  VAlign::AlignBottom, true,  "Hello\n\nWorld"},
+        {200, 100, HAlign::AlignLeft,   VAlign::AlignTop,    true,  "Hello World!"},
+        {200, 100, HAlign::AlignCenter, VAlign::AlignCenter, false, "Hello\nWorld"},
+        {200, 100, HAlign::AlignRight,  VAlign::AlignBottom, true,  "gypsy jiggly"},
+        // buffer smaller than the text, the text is clipped
+        {50,  10,  HAlign::AlignCenter, VAlign::AlignCenter, true,  "Hello World!"},
+        {50,  30,  HAlign::AlignLeft,   VAlign::AlignBottom, false, "Hello\nWorld"},
+    };
+
+    for (const auto& test : cases)
+    {
+        gfx::TextBuffer::Text text;
+        text.text      = test.text;
+        text.font      = font;
+        text.fontsize  = 20;
+        text.underline = test.underline;
+
+        gfx::TextBuffer buffer(test.buffer_width, test.buffer_height);
+        buffer.SetAlignment(test.halign);
+        buffer.SetAlignment(test.valign);
+        buffer.SetText(text);
+
+        const auto& bitmap = buffer.RasterizeBitmap();
+        TEST_REQUIRE(bitmap);
+
+        std::vector<gfx::TextBuffer::GlyphQuad> quads;
+        unsigned width  = 0;
+        unsigned height = 0;
+        TEST_REQUIRE(buffer.LayoutGlyphs(&quads, &width, &height));
+        TEST_REQUIRE(width == bitmap->GetWidth());
+        TEST_REQUIRE(height == bitmap->GetHeight());
+        TEST_REQUIRE(!quads.empty());
+
+        const auto& composed = ComposeGlyphQuads(quads, width, height);
+        TEST_REQUIRE(composed == *bitmap);
+    }
+
+    // drawable geometry
+    {
+        gfx::TextBuffer::Text text;
+        text.text     = "Hello";
+        text.font     = font;
+        text.fontsize = 20;
+        gfx::TextBuffer buffer(100, 50);
+        buffer.SetText(text);
+
+        std::vector<gfx::TextBuffer::GlyphQuad> quads;
+        unsigned width  = 0;
+        unsigned height = 0;
+        TEST_REQUIRE(buffer.LayoutGlyphs(&quads, &width, &height));
+        TEST_REQUIRE(quads.size() == 5);
+
+        gfx::TextDrawable drawable(buffer, "test");
+
+        gfx::Drawable::Environment env;
+        gfx::Geometry::CreateArgs args;
+        TestDevice device;
+        TEST_REQUIRE(drawable.GetGeometryId(env) == "glyph-text/test");
+        TEST_REQUIRE(drawable.Construct(env, device, args));
+        TEST_REQUIRE(args.content_hash == drawable.GetGeometryHash());
+
+        const gfx::VertexStream stream(args.buffer.GetLayout(), args.buffer.GetVertexBuffer());
+        TEST_REQUIRE(stream.GetCount() == quads.size() * 6);
+        for (size_t i=0; i<quads.size(); ++i)
+        {
+            const auto& quad = quads[i];
+            const auto* top_left  = stream.GetVertex<gfx::Vertex2D>(i * 6 + 0);
+            const auto* bot_right = stream.GetVertex<gfx::Vertex2D>(i * 6 + 2);
+            TEST_REQUIRE(real::equals(top_left->aPosition.x,   quad.x / 100.0f));
+            TEST_REQUIRE(real::equals(top_left->aPosition.y,  -quad.y / 50.0f));
+            TEST_REQUIRE(real::equals(bot_right->aPosition.x,  (quad.x + quad.width) / 100.0f));
+            TEST_REQUIRE(real::equals(bot_right->aPosition.y, -(quad.y + quad.height) / 50.0f));
+            TEST_REQUIRE(real::equals(top_left->aTexCoord.x,  quad.texture_x));
+            TEST_REQUIRE(real::equals(top_left->aTexCoord.y,  quad.texture_y));
+            TEST_REQUIRE(real::equals(bot_right->aTexCoord.x, quad.texture_x + quad.texture_width));
+            TEST_REQUIRE(real::equals(bot_right->aTexCoord.y, quad.texture_y + quad.texture_height));
+        }
+
+        // changing the text changes the geometry hash
+        const auto hash = drawable.GetGeometryHash();
+        text.text = "World";
+        buffer.SetText(text);
+        drawable.SetText(buffer);
+        TEST_REQUIRE(drawable.GetGeometryHash() != hash);
+    }
+}
+
+void unit_test_distance_field_text()
+{
+    TEST_CASE(test::Type::Feature)
+
+    using GlyphMode = gfx::TextBuffer::GlyphMode;
+
+    // generate the glyphs into a disk cache in a test specific
+    // directory so that nothing else in the temp dir is touched.
+    const auto& cache_dir  = (std::filesystem::temp_directory_path() / "unit_test_distance_field_text").string();
+    std::filesystem::remove_all(cache_dir);
+    std::filesystem::create_directories(cache_dir);
+    gfx::TextBuffer::SetDistanceFieldCacheDirectory(cache_dir);
+
+    const auto* font = "../graphics/test/dist/fonts/Cousine-Regular.ttf";
+
+    // thresholding the distance field at the glyph edge should produce
+    // (almost) the same glyph shapes as the bitmap rasterization when the
+    // text is rendered at the distance field font size.
+    {
+        gfx::TextBuffer::Text text;
+        text.text     = "Hello World!\ngypsy jiggly";
+        text.font     = font;
+        text.fontsize = gfx::TextBuffer::DistanceFieldFontSize;
+        gfx::TextBuffer buffer(0, 0);
+        buffer.SetText(text);
+
+        const auto& bitmap = buffer.RasterizeBitmap();
+        TEST_REQUIRE(bitmap);
+
+        std::vector<gfx::TextBuffer::GlyphQuad> quads;
+        unsigned width  = 0;
+        unsigned height = 0;
+        TEST_REQUIRE(buffer.LayoutGlyphs(&quads, &width, &height, GlyphMode::DistanceField));
+        TEST_REQUIRE(width == bitmap->GetWidth());
+        TEST_REQUIRE(height == bitmap->GetHeight());
+
+        const auto& atlas = gfx::TextBuffer::GetGlyphAtlasBitmap(GlyphMode::DistanceField);
+        gfx::AlphaMask composed(width, height);
+        composed.Fill(gfx::Pixel_A(0));
+        for (const auto& quad : quads)
+        {
+            // the quads should map 1:1 to the atlas texels
+            TEST_REQUIRE(real::equals(quad.width, quad.texture_width * atlas.GetWidth()));
+            TEST_REQUIRE(real::equals(quad.height, quad.texture_height * atlas.GetHeight()));
+            for (unsigned row=0; row<(unsigned)quad.height; ++row)
+            {
+                for (unsigned col=0; col<(unsigned)quad.width; ++col)
+                {
+                    const auto u = quad.texture_x * atlas.GetWidth() + col;
+                    const auto v = quad.texture_y * atlas.GetHeight() + row;
+                    const auto x = quad.x + col;
+                    const auto y = quad.y + row;
+                    const auto& src = atlas.GetPixel(unsigned(v), unsigned(u));
+                    const auto& dst = composed.GetPixel(unsigned(y), unsigned(x));
+                    composed.SetPixel(unsigned(y), unsigned(x), gfx::Pixel_A(std::max(src.r, dst.r)));
+                }
+            }
+        }
+
+        unsigned inked = 0;
+        unsigned mismatch = 0;
+        for (unsigned row=0; row<height; ++row)
+        {
+            for (unsigned col=0; col<width; ++col)
+            {
+                const bool bitmap_inside = bitmap->GetPixel(row, col).r >= 128;
+                const bool field_inside  = composed.GetPixel(row, col).r >= 128;
+                inked += bitmap_inside;
+                mismatch += bitmap_inside != field_inside;
+            }
+        }
+        TEST_REQUIRE(inked);
+        TEST_REQUIRE(mismatch < inked / 20);
+    }
+
+    // scaling the text doesn't generate new glyphs.
+    {
+        const gfx::AlphaMask atlas = gfx::TextBuffer::GetGlyphAtlasBitmap(GlyphMode::DistanceField);
+        const auto generation = gfx::TextBuffer::GetGlyphAtlasGeneration(GlyphMode::DistanceField);
+
+        gfx::TextBuffer::Text text;
+        text.text     = "Hello";
+        text.font     = font;
+        // large enough buffer so that the glyphs don't get clipped
+        gfx::TextBuffer buffer(400, 200);
+
+        text.fontsize = gfx::TextBuffer::DistanceFieldFontSize;
+        buffer.SetText(text);
+        std::vector<gfx::TextBuffer::GlyphQuad> big;
+        unsigned width  = 0;
+        unsigned height = 0;
+        TEST_REQUIRE(buffer.LayoutGlyphs(&big, &width, &height, GlyphMode::DistanceField));
+
+        text.fontsize = gfx::TextBuffer::DistanceFieldFontSize / 4;
+        buffer.SetText(text);
+        std::vector<gfx::TextBuffer::GlyphQuad> small;
+        TEST_REQUIRE(buffer.LayoutGlyphs(&small, &width, &height, GlyphMode::DistanceField));
+
+        TEST_REQUIRE(big.size() == 5);
+        TEST_REQUIRE(small.size() == 5);
+        for (size_t i=0; i<big.size(); ++i)
+        {
+            TEST_REQUIRE(real::equals(small[i].width * 4.0f, big[i].width));
+            TEST_REQUIRE(real::equals(small[i].height * 4.0f, big[i].height));
+            TEST_REQUIRE(small[i].texture_x == big[i].texture_x);
+            TEST_REQUIRE(small[i].texture_y == big[i].texture_y);
+        }
+        TEST_REQUIRE(gfx::TextBuffer::GetGlyphAtlasGeneration(GlyphMode::DistanceField) == generation);
+        TEST_REQUIRE(gfx::TextBuffer::GetGlyphAtlasBitmap(GlyphMode::DistanceField) == atlas);
+    }
+
+    // the glyphs were written in the disk cache.
+    {
+        unsigned cache_files = 0;
+        for (const auto& entry : std::filesystem::directory_iterator(cache_dir))
+        {
+            const auto& name = entry.path().filename().string();
+            if (!base::StartsWith(name, "sdf-") || !base::EndsWith(name, ".cache"))
+                continue;
+            TEST_REQUIRE(entry.file_size() > 24);
+            ++cache_files;
+        }
+        TEST_REQUIRE(cache_files >= 1);
+    }
+
+    // a corrupt cache file is discarded and a new cache file is started.
+    {
+        const std::string corrupt_font = "../graphics/test/dist/fonts/Cousine-Italic.ttf";
+        const auto& font_data = base::LoadBinaryFile(corrupt_font);
+        TEST_REQUIRE(!font_data.empty());
+        std::uint64_t font_hash = 14695981039346656037ull;
+        for (auto byte : font_data)
+        {
+            font_hash ^= std::uint8_t(byte);
+            font_hash *= 1099511628211ull;
+        }
+        const std::uint32_t header[4] = {
+            0x46445344, 1, gfx::TextBuffer::DistanceFieldFontSize, gfx::TextBuffer::DistanceFieldSpread
+        };
+        // a record with a huge glyph and no pixel data.
+        const std::uint32_t record[5] = { 1, 0xffffffff, 0xffffffff, 0, 0 };
+
+        const auto& cache_file = base::JoinPath(cache_dir,
+            base::FormatString("sdf-%1.cache", std::hash<std::string>()(corrupt_font)));
+        {
+            std::ofstream out(cache_file, std::ios::out | std::ios::binary | std::ios::trunc);
+            out.write((const char*)header, sizeof(header));
+            out.write((const char*)&font_hash, sizeof(font_hash));
+            out.write((const char*)record, sizeof(record));
+        }
+
+        gfx::TextBuffer::Text text;
+        text.text     = "Hello";
+        text.font     = corrupt_font;
+        text.fontsize = 20;
+        gfx::TextBuffer buffer(100, 50);
+        buffer.SetText(text);
+        std::vector<gfx::TextBuffer::GlyphQuad> quads;
+        unsigned width  = 0;
+        unsigned height = 0;
+        TEST_REQUIRE(buffer.LayoutGlyphs(&quads, &width, &height, GlyphMode::DistanceField));
+        TEST_REQUIRE(quads.size() == 5);
+
+        // the new cache file has the same header followed by the
+        // newly generated glyphs.
+        std::ifstream in(cache_file, std::ios::in | std::ios::binary);
+        std::uint32_t new_header[4] = {};
+        std::uint64_t new_font_hash = 0;
+        std::uint32_t new_record[5] = {};
+        TEST_REQUIRE(in.read((char*)new_header, sizeof(new_header)));
+        TEST_REQUIRE(in.read((char*)&new_font_hash, sizeof(new_font_hash)));
+        TEST_REQUIRE(in.read((char*)new_record, sizeof(new_record)));
+        TEST_REQUIRE(std::memcmp(new_header, header, sizeof(header)) == 0);
+        TEST_REQUIRE(new_font_hash == font_hash);
+        TEST_REQUIRE(new_record[1] <= gfx::TextBuffer::DistanceFieldFontSize + 2 * gfx::TextBuffer::DistanceFieldSpread);
+        TEST_REQUIRE(new_record[2] <= gfx::TextBuffer::DistanceFieldFontSize + 2 * gfx::TextBuffer::DistanceFieldSpread);
+    }
+
+    // drawable geometry changes with the glyph mode.
+    {
+        gfx::TextBuffer::Text text;
+        text.text     = "Hello";
+        text.font     = font;
+        text.fontsize = 20;
+        gfx::TextBuffer buffer(100, 50);
+        buffer.SetText(text);
+
+        gfx::TextDrawable drawable(buffer, "test");
+        const auto hash = drawable.GetGeometryHash();
+        drawable.SetGlyphMode(GlyphMode::DistanceField);
+        TEST_REQUIRE(drawable.GetGeometryHash() != hash);
+
+        gfx::Drawable::Environment env;
+        gfx::Geometry::CreateArgs args;
+        TestDevice device;
+        TEST_REQUIRE(drawable.Construct(env, device, args));
+        const gfx::VertexStream stream(args.buffer.GetLayout(), args.buffer.GetVertexBuffer());
+        TEST_REQUIRE(stream.GetCount() == 5 * 6);
+    }
+    gfx::TextBuffer::SetDistanceFieldCacheDirectory("");
+    std::filesystem::remove_all(cache_dir);
+}
+
 EXPORT_TEST_MAIN(
 int test_main(int argc, char* argv[])
 {
@@ -1348,9 +1827,13 @@ int test_main(int argc, char* argv[])
     unit_test_polygon_builder_json();
     unit_test_polygon_builder_build();
     unit_test_particle_engine_data();
+    unit_test_fluid_simulation_data();
     unit_test_polygon_data();
     unit_test_simple_shape_shard_mesh();
     unit_test_shader_id();
+    unit_test_sprite_batch();
+    unit_test_glyph_text();
+    unit_test_distance_field_text();
     return 0;
 }
 ) // TEST_MAIN
@@ -49,8 +49,10 @@
 #include "graphics/simple_shape.h"
 #include "graphics/polygon_mesh.h"
 #include "graphics/particle_engine.h"
+#include "graphics/fluid_simulation.h"
 #include "graphics/drawcmd.h"
 #include "graphics/texture_file_source.h"
+#include "graphics/texture_streamer.h"
 #include "graphics/texture_bitmap_buffer_source.h"
 #include "graphics/shader_source.h"
 #include "graphics/tool/polygon.h"
@@ -1449,6 +1451,7 @@ void unit_test_local_particles()
     // emitter position and spawning inside rectangle
     {
         gfx::ParticleEngineClass::Params p;
+        p.primitive = gfx::ParticleEngineClass::DrawPrimitive::Point;
         p.mode             = K::SpawnPolicy::Once;
         p.placement        = K::Placement::Inside;
         p.shape            = K::EmitterShape::Rectangle;
@@ -1486,6 +1489,7 @@ void unit_test_local_particles()
     // emitter position and spawning outside rectangle
     {
         gfx::ParticleEngineClass::Params p;
+        p.primitive = gfx::ParticleEngineClass::DrawPrimitive::Point;
         p.mode             = K::SpawnPolicy::Once;
         p.placement        = K::Placement::Outside;
         p.shape            = K::EmitterShape::Rectangle;
@@ -1525,6 +1529,7 @@ void unit_test_local_particles()
     // emitter position and spawning edge of rectangle
     {
         gfx::ParticleEngineClass::Params p;
+        p.primitive = gfx::ParticleEngineClass::DrawPrimitive::Point;
         p.mode             = K::SpawnPolicy::Once;
         p.placement        = K::Placement::Edge;
         p.shape            = K::EmitterShape::Rectangle;
@@ -1565,6 +1570,7 @@ void unit_test_local_particles()
     // emitter position and spawning center of rectangle
     {
         gfx::ParticleEngineClass::Params p;
+        p.primitive = gfx::ParticleEngineClass::DrawPrimitive::Point;
         p.mode             = K::SpawnPolicy::Once;
         p.placement        = K::Placement::Center;
         p.shape            = K::EmitterShape::Rectangle;
@@ -1610,6 +1616,7 @@ void unit_test_local_particles()
         for (auto placement : placements)
         {
             gfx::ParticleEngineClass::Params p;
+            p.primitive = gfx::ParticleEngineClass::DrawPrimitive::Point;
             p.placement        = placement;
             p.mode             = K::SpawnPolicy::Once;
             p.shape            = K::EmitterShape::Circle;
@@ -1655,6 +1662,7 @@ void unit_test_local_particles()
     // direction of travel outwards from circle edge.
     {
         gfx::ParticleEngineClass::Params p;
+        p.primitive = gfx::ParticleEngineClass::DrawPrimitive::Point;
         p.placement        = K::Placement::Edge;
         p.mode             = K::SpawnPolicy::Once;
         p.shape            = K::EmitterShape::Circle;
@@ -1696,6 +1704,7 @@ void unit_test_local_particles()
     // direction of travel inwards from circle edge.
     {
         gfx::ParticleEngineClass::Params p;
+        p.primitive = gfx::ParticleEngineClass::DrawPrimitive::Point;
         p.placement        = K::Placement::Edge;
         p.mode             = K::SpawnPolicy::Once;
         p.shape            = K::EmitterShape::Circle;
@@ -1751,6 +1760,7 @@ void unit_test_global_particles()
     // global sector direction
     {
         gfx::ParticleEngineClass::Params p;
+        p.primitive = gfx::ParticleEngineClass::DrawPrimitive::Point;
         p.coordinate_space = gfx::ParticleEngineClass::CoordinateSpace::Global;
         p.init_rect_width  = 1.0;
         p.init_rect_height = 1.0;
@@ -1931,6 +1941,659 @@ void unit_test_particles()
     // - min/max properties
 }
 
+void unit_test_particle_update()
+{
+    TEST_CASE(test::Type::Feature)
+
+    using Particle = gfx::ParticleEngineClass::Particle;
+    using ParticleBuffer = gfx::ParticleEngineClass::ParticleBuffer;
+    using Params = gfx::ParticleEngineClass::Params;
+
+    auto MakeParticle = [](float x, float y, float dx, float dy) {
+        Particle p;
+        p.position  = glm::vec2(x, y);
+        p.direction = glm::vec2(dx, dy);
+        p.pointsize = 2.0f;
+        p.alpha     = 1.0f;
+        return p;
+    };
+    auto AddParticle = [](ParticleBuffer& buffer, const Particle& p) {
+        buffer.Resize(buffer.GetCount() + 1);
+        buffer.SetParticle(buffer.GetCount()-1, p);
+    };
+
+    gfx::DrawableClass::Environment env;
+
+    // linear motion, expiring and killing particles.
+    {
+        Params params;
+        params.motion = gfx::ParticleEngineClass::Motion::Linear;
+        params.boundary = gfx::ParticleEngineClass::BoundaryPolicy::Kill;
+        params.max_xpos = 10.0f;
+        params.max_ypos = 10.0f;
+        params.max_lifetime = 2.0f;
+        params.rate_of_change_in_size_wrt_time = -1.0f;
+
+        ParticleBuffer buffer;
+        AddParticle(buffer, MakeParticle(1.0f, 1.0f, 1.0f, 0.0f)); // 0 survives
+        auto p = MakeParticle(2.0f, 2.0f, 0.0f, 1.0f);
+        p.time_scale = 0.25f;
+        AddParticle(buffer, p);                                         // 1 expires
+        AddParticle(buffer, MakeParticle(9.5f, 5.0f, 1.0f, 0.0f)); // 2 leaves the simulation
+        p = MakeParticle(3.0f, 3.0f, 0.0f, -1.0f);
+        p.pointsize = 0.5f;
+        AddParticle(buffer, p);                                         // 3 shrinks to nothing
+        AddParticle(buffer, MakeParticle(4.0f, 4.0f, 3.0f, 4.0f)); // 4 survives
+
+        gfx::ParticleEngineClass::UpdateParticles(env, params, buffer, 1.0f);
+        TEST_REQUIRE(buffer.GetCount() == 2);
+        // the last particle is moved in place of the first dead one.
+        const auto& p0 = buffer.GetParticle(0);
+        const auto& p1 = buffer.GetParticle(1);
+        TEST_REQUIRE(p0.position == glm::vec2(2.0f, 1.0f));
+        TEST_REQUIRE(p1.position == glm::vec2(7.0f, 8.0f));
+        TEST_REQUIRE(real::equals(p0.distance, 1.0f));
+        TEST_REQUIRE(real::equals(p1.distance, 5.0f));
+        TEST_REQUIRE(real::equals(p0.time, 1.0f));
+        TEST_REQUIRE(real::equals(p0.pointsize, 1.0f));
+    }
+
+    // projectile motion
+    {
+        Params params;
+        params.motion = gfx::ParticleEngineClass::Motion::Projectile;
+        params.boundary = gfx::ParticleEngineClass::BoundaryPolicy::Clamp;
+        params.gravity  = glm::vec2(0.0f, 2.0f);
+        params.max_xpos = 10.0f;
+        params.max_ypos = 10.0f;
+
+        ParticleBuffer buffer;
+        AddParticle(buffer, MakeParticle(1.0f, 1.0f, 1.0f, 0.0f));
+        gfx::ParticleEngineClass::UpdateParticles(env, params, buffer, 0.5f);
+        gfx::ParticleEngineClass::UpdateParticles(env, params, buffer, 0.5f);
+        const auto& p = buffer.GetParticle(0);
+        TEST_REQUIRE(p.position == glm::vec2(2.0f, 1.5f));
+        TEST_REQUIRE(p.direction == glm::vec2(1.0f, 2.0f));
+    }
+
+    // boundary policies
+    {
+        Params params;
+        params.max_xpos = 10.0f;
+        params.max_ypos = 10.0f;
+
+        ParticleBuffer buffer;
+        AddParticle(buffer, MakeParticle(9.0f, 5.0f,  2.0f,  0.0f));
+        AddParticle(buffer, MakeParticle(5.0f, 1.0f,  0.0f, -2.0f));
+        AddParticle(buffer, MakeParticle(5.0f, 5.0f,  0.0f,  0.0f));
+
+        auto wrap = buffer;
+        params.boundary = gfx::ParticleEngineClass::BoundaryPolicy::Wrap;
+        gfx::ParticleEngineClass::UpdateParticles(env, params, wrap, 1.0f);
+        TEST_REQUIRE(wrap.GetParticle(0).position == glm::vec2(0.0f, 5.0f));
+        TEST_REQUIRE(wrap.GetParticle(1).position == glm::vec2(5.0f, 10.0f));
+        TEST_REQUIRE(wrap.GetParticle(2).position == glm::vec2(5.0f, 5.0f));
+
+        auto clamp = buffer;
+        params.boundary = gfx::ParticleEngineClass::BoundaryPolicy::Clamp;
+        gfx::ParticleEngineClass::UpdateParticles(env, params, clamp, 1.0f);
+        TEST_REQUIRE(clamp.GetParticle(0).position == glm::vec2(10.0f, 5.0f));
+        TEST_REQUIRE(clamp.GetParticle(1).position == glm::vec2(5.0f, 0.0f));
+
+        auto reflect = buffer;
+        params.boundary = gfx::ParticleEngineClass::BoundaryPolicy::Reflect;
+        gfx::ParticleEngineClass::UpdateParticles(env, params, reflect, 1.0f);
+        TEST_REQUIRE(reflect.GetParticle(0).position == glm::vec2(10.0f, 5.0f));
+        TEST_REQUIRE(reflect.GetParticle(0).direction == glm::vec2(-2.0f, 0.0f));
+        TEST_REQUIRE(reflect.GetParticle(1).position == glm::vec2(5.0f, 0.0f));
+        TEST_REQUIRE(reflect.GetParticle(1).direction == glm::vec2(0.0f, 2.0f));
+        TEST_REQUIRE(reflect.GetParticle(2).direction == glm::vec2(0.0f, 0.0f));
+    }
+
+    // particle initialization is repeatable with the same seed.
+    {
+        Params params;
+        params.min_velocity = 1.0f;
+        params.max_velocity = 2.0f;
+        params.min_alpha = 0.5f;
+        params.max_alpha = 1.0f;
+        params.max_lifetime = 1.0f;
+
+        ParticleBuffer a, b;
+        base::FastRandom ra(1234);
+        base::FastRandom rb(1234);
+        gfx::ParticleEngineClass::InitParticles(env, params, a, ra, 100);
+        gfx::ParticleEngineClass::InitParticles(env, params, b, rb, 100);
+        TEST_REQUIRE(a.GetCount() == 100);
+        TEST_REQUIRE(a.position_x == b.position_x);
+        TEST_REQUIRE(a.position_y == b.position_y);
+        TEST_REQUIRE(a.direction_x == b.direction_x);
+        TEST_REQUIRE(a.alpha == b.alpha);
+        for (size_t i=0; i<a.GetCount(); ++i)
+        {
+            const auto& p = a.GetParticle(i);
+            TEST_REQUIRE(p.position.x >= 0.0f && p.position.x <= 1.0f);
+            TEST_REQUIRE(p.position.y >= 0.0f && p.position.y <= 1.0f);
+            TEST_REQUIRE(p.alpha >= 0.5f && p.alpha <= 1.0f);
+            const auto velocity = glm::length(p.direction);
+            TEST_REQUIRE(velocity >= 0.999f && velocity <= 2.001f);
+        }
+    }
+}
+
+void unit_test_particle_update_perf()
+{
+    TEST_CASE(test::Type::Performance)
+
+    gfx::ParticleEngineClass::Params params;
+    params.motion = gfx::ParticleEngineClass::Motion::Projectile;
+    params.boundary = gfx::ParticleEngineClass::BoundaryPolicy::Wrap;
+    params.max_lifetime = 1000.0f;
+    params.max_xpos = 100.0f;
+    params.max_ypos = 100.0f;
+    params.min_velocity = 1.0f;
+    params.max_velocity = 10.0f;
+    params.init_rect_width  = 1.0f;
+    params.init_rect_height = 1.0f;
+
+    gfx::DrawableClass::Environment env;
+    gfx::ParticleEngineClass::ParticleBuffer buffer;
+    base::FastRandom random(0xdeadbeef);
+    gfx::ParticleEngineClass::InitParticles(env, params, buffer, random, 50000);
+
+    const auto& ret = test::TimedTest(1000, [&params, &env, &buffer]() {
+        gfx::ParticleEngineClass::UpdateParticles(env, params, buffer, 1.0f/60.0f);
+    });
+    test::PrintTestTimes("update 50k particles", ret);
+}
+
+void unit_test_particle_parallel_update()
+{
+    TEST_CASE(test::Type::Feature)
+
+    gfx::ParticleEngineClass::Params p;
+    p.primitive = gfx::ParticleEngineClass::DrawPrimitive::Point;
+    p.num_particles = 200;
+    p.min_lifetime  = 0.5f;
+    p.max_lifetime  = 2.0f;
+    p.min_velocity  = 0.1f;
+    p.max_velocity  = 1.0f;
+    p.mode     = gfx::ParticleEngineClass::SpawnPolicy::Maintain;
+    p.motion   = gfx::ParticleEngineClass::Motion::Projectile;
+    p.boundary = gfx::ParticleEngineClass::BoundaryPolicy::Reflect;
+    const auto klass = std::make_shared<const gfx::ParticleEngineClass>(p);
+
+    using EngineList = std::vector<std::unique_ptr<gfx::ParticleEngineInstance>>;
+
+    // create the engines in the same sequence with the same seed for
+    // both simulations so that the engines get the same random seeds.
+    auto CreateEngines = [&klass]() {
+        gfx::ParticleEngineClass::SetRandomSeed(0x1234);
+        EngineList engines;
+        for (unsigned i=0; i<16; ++i)
+            engines.push_back(std::make_unique<gfx::ParticleEngineInstance>(klass));
+        return engines;
+    };
+
+    gfx::DrawableClass::Environment env;
+
+    // serial simulation without any thread pool.
+    EngineList serial = CreateEngines();
+    for (auto& engine : serial)
+        engine->Restart(env);
+    for (unsigned frame=0; frame<60; ++frame)
+    {
+        for (auto& engine : serial)
+            engine->Update(env, 1.0f/60.0f);
+    }
+
+    // parallel simulation on the thread pool.
+    base::ThreadPool threads;
+    threads.AddRealThread(base::ThreadPool::Worker0ThreadID);
+    threads.AddRealThread(base::ThreadPool::Worker1ThreadID);
+    threads.AddRealThread(base::ThreadPool::Worker2ThreadID);
+    base::SetGlobalThreadPool(&threads);
+
+    EngineList parallel = CreateEngines();
+    for (auto& engine : parallel)
+    {
+        engine->SetExecutionMode(gfx::ParticleEngineClass::ExecutionMode::Immediate);
+        engine->Restart(env);
+        // immediate mode doesn't use any background tasks.
+        TEST_REQUIRE(engine->GetNumParticlesAlive() == 200);
+    }
+    for (unsigned frame=0; frame<60; ++frame)
+    {
+        base::ParallelFor(&threads, 0, parallel.size(), 1, [&parallel, &env](size_t index) {
+            parallel[index]->Update(env, 1.0f/60.0f);
+        });
+    }
+
+    base::SetGlobalThreadPool(nullptr);
+    threads.Shutdown();
+
+    // both simulations must produce exactly the same result while
+    // each engine has its own random sequence.
+    TestDevice device;
+    std::vector<std::uint8_t> previous;
+    for (size_t i=0; i<serial.size(); ++i)
+    {
+        gfx::Geometry::CreateArgs a;
+        gfx::Geometry::CreateArgs b;
+        TEST_REQUIRE(serial[i]->Construct(env, device, a));
+        TEST_REQUIRE(parallel[i]->Construct(env, device, b));
+        TEST_REQUIRE(a.buffer.GetVertexCount() == 200);
+        TEST_REQUIRE(a.buffer.GetVertexBuffer() == b.buffer.GetVertexBuffer());
+        TEST_REQUIRE(a.buffer.GetVertexBuffer() != previous);
+        previous = a.buffer.GetVertexBuffer();
+    }
+}
+
+void unit_test_particle_quads()
+{
+    TEST_CASE(test::Type::Feature)
+
+    using K = gfx::ParticleEngineClass;
+
+    struct QuadVertex {
+        gfx::Vec2 aCorner;
+        gfx::Vec2 aPosition;
+        gfx::Vec2 aDirection;
+        gfx::Vec4 aData;
+    };
+    struct InstanceData {
+        gfx::Vec2 aPosition;
+        gfx::Vec2 aDirection;
+        gfx::Vec4 aData;
+    };
+
+    K::Params p;
+    TEST_REQUIRE(p.primitive == K::DrawPrimitive::Quad);
+    p.mode           = K::SpawnPolicy::Once;
+    p.num_particles  = 10;
+    p.max_xpos       = 100.0f;
+    p.max_ypos       = 100.0f;
+    p.min_point_size = 5.0f;
+    p.max_point_size = 10.0f;
+    gfx::ParticleEngineInstance eng(p);
+    TEST_REQUIRE(eng.GetDrawPrimitive() == gfx::Drawable::DrawPrimitive::Triangles);
+
+    gfx::DrawableClass::Environment env;
+    env.pixel_ratio = glm::vec2(2.0f, 2.0f);
+    eng.Restart(env);
+    TEST_REQUIRE(eng.GetNumParticlesAlive() == 10);
+
+    TestDevice dev;
+
+    // no instancing, the quads are expanded on the CPU.
+    env.instancing_supported = false;
+    TEST_REQUIRE(!eng.HasDrawableInstances(env));
+    gfx::Geometry::CreateArgs quads;
+    TEST_REQUIRE(eng.Construct(env, dev, quads));
+    TEST_REQUIRE(quads.buffer.GetVertexCount() == 10 * 6);
+    TEST_REQUIRE(quads.buffer.GetNumDrawCmds() == 1);
+    TEST_REQUIRE(quads.buffer.GetDrawCmd(0).type == gfx::Geometry::DrawType::Triangles);
+    TEST_REQUIRE(quads.buffer.GetLayout().vertex_struct_size == sizeof(QuadVertex));
+    const auto* quad_vertices = reinterpret_cast<const QuadVertex*>(quads.buffer.GetVertexDataPtr());
+
+    // client side instancing takes precedence over the particle instances.
+    env.instancing_supported = true;
+    env.use_instancing = true;
+    TEST_REQUIRE(!eng.HasDrawableInstances(env));
+
+    // instanced quads with one instance per particle.
+    env.use_instancing = false;
+    TEST_REQUIRE(eng.HasDrawableInstances(env));
+    gfx::Geometry::CreateArgs corners;
+    TEST_REQUIRE(eng.Construct(env, dev, corners));
+    TEST_REQUIRE(corners.buffer.GetVertexCount() == 6);
+    TEST_REQUIRE(corners.buffer.GetDrawCmd(0).type == gfx::Geometry::DrawType::Triangles);
+
+    gfx::InstancedDraw::CreateArgs instances;
+    TEST_REQUIRE(eng.ConstructInstances(env, dev, instances));
+    TEST_REQUIRE(instances.usage == gfx::BufferUsage::Stream);
+    TEST_REQUIRE(instances.buffer.GetInstanceCount() == 10);
+    TEST_REQUIRE(instances.buffer.GetInstanceDataLayout().vertex_struct_size == sizeof(InstanceData));
+    for (const auto& attr : instances.buffer.GetInstanceDataLayout().attributes)
+        TEST_REQUIRE(attr.divisor == 1);
+
+    // the instance data is the same as the per vertex data without
+    // instancing and the quad size is in world units.
+    const auto* instance_data = reinterpret_cast<const InstanceData*>(instances.buffer.GetVertexDataPtr());
+    for (size_t i=0; i<10; ++i)
+    {
+        const auto& instance = instance_data[i];
+        TEST_REQUIRE(instance.aData.x >= 5.0f && instance.aData.x <= 10.0f);
+        for (size_t j=0; j<6; ++j)
+        {
+            const auto& vertex = quad_vertices[i * 6 + j];
+            TEST_REQUIRE(vertex.aPosition.x == instance.aPosition.x);
+            TEST_REQUIRE(vertex.aPosition.y == instance.aPosition.y);
+            TEST_REQUIRE(vertex.aData.x == instance.aData.x);
+            TEST_REQUIRE(vertex.aData.w == instance.aData.w);
+            TEST_REQUIRE(vertex.aCorner.x == -0.5f || vertex.aCorner.x == 0.5f);
+            TEST_REQUIRE(vertex.aCorner.y == -0.5f || vertex.aCorner.y == 0.5f);
+        }
+    }
+    // 32 bytes per particle instead of 6 vertices per particle.
+    TEST_REQUIRE(instances.buffer.GetInstanceDataSize() * 7 < quads.buffer.GetVertexBytes());
+
+    // no particles, no instances.
+    K::Params none = p;
+    none.num_particles = 0;
+    gfx::ParticleEngineInstance empty(none);
+    empty.Restart(env);
+    gfx::InstancedDraw::CreateArgs nothing;
+    TEST_REQUIRE(!empty.ConstructInstances(env, dev, nothing));
+}
+
+namespace {
+using FluidGrid = gfx::FluidSimulationClass::Grid;
+
+float GetFluidMass(const FluidGrid& grid)
+{
+    float mass = 0.0f;
+    for (unsigned y=1; y<=grid.height; ++y)
+        for (unsigned x=1; x<=grid.width; ++x)
+            mass += grid.density[grid.GetIndex(x, y)];
+    return mass;
+}
+
+// the density weighted center in normalized simulation coordinates.
+glm::vec2 GetFluidCenter(const FluidGrid& grid)
+{
+    glm::vec2 center = {0.0f, 0.0f};
+    for (unsigned y=1; y<=grid.height; ++y)
+    {
+        for (unsigned x=1; x<=grid.width; ++x)
+        {
+            const auto density = grid.density[grid.GetIndex(x, y)];
+            center.x += density * (float(x) - 0.5f) / float(grid.width);
+            center.y += density * (float(y) - 0.5f) / float(grid.height);
+        }
+    }
+    return center / GetFluidMass(grid);
+}
+
+float GetFluidDivergence(const FluidGrid& grid)
+{
+    const auto stride = grid.GetStride();
+    float divergence = 0.0f;
+    for (unsigned y=1; y<=grid.height; ++y)
+    {
+        for (unsigned x=1; x<=grid.width; ++x)
+        {
+            const auto i = grid.GetIndex(x, y);
+            const auto div = grid.velocity_x[i+1] - grid.velocity_x[i-1] +
+                             grid.velocity_y[i+stride] - grid.velocity_y[i-stride];
+            divergence = std::max(divergence, std::abs(div));
+        }
+    }
+    return divergence;
+}
+} // namespace
+
+void unit_test_fluid_simulation()
+{
+    TEST_CASE(test::Type::Feature)
+
+    gfx::DrawableClass::Environment env;
+
+    gfx::FluidSimulationClass::Params params;
+    params.grid_width  = 32;
+    params.grid_height = 32;
+
+    // still fluid doesn't move and no mass is lost.
+    {
+        gfx::FluidSimulationInstance fluid(params);
+        fluid.AddDensity(glm::vec2(0.5f, 0.5f), 1.0f, 0.1f);
+        const auto mass = GetFluidMass(fluid.GetGrid());
+        TEST_REQUIRE(mass > 1.0f);
+        for (unsigned i=0; i<60; ++i)
+            fluid.Update(env, 1.0f/60.0f);
+        TEST_REQUIRE(math::equals(GetFluidMass(fluid.GetGrid()), mass, 0.001f));
+        const auto center = GetFluidCenter(fluid.GetGrid());
+        TEST_REQUIRE(math::equals(center.x, 0.5f, 0.001f));
+        TEST_REQUIRE(math::equals(center.y, 0.5f, 0.001f));
+    }
+
+    // density is advected along the velocity and the velocity
+    // is projected to be divergence free.
+    {
+        gfx::FluidSimulationInstance fluid(params);
+        fluid.AddDensity(glm::vec2(0.3f, 0.5f), 1.0f, 0.05f);
+        fluid.AddVelocity(glm::vec2(0.3f, 0.5f), glm::vec2(1.0f, 0.0f), 0.15f);
+        const auto divergence = GetFluidDivergence(fluid.GetGrid());
+        TEST_REQUIRE(divergence > 0.0f);
+
+        for (unsigned i=0; i<10; ++i)
+            fluid.Update(env, 1.0f/60.0f);
+        const auto center = GetFluidCenter(fluid.GetGrid());
+        TEST_REQUIRE(center.x > 0.35f);
+        TEST_REQUIRE(math::equals(center.y, 0.5f, 0.01f));
+        TEST_REQUIRE(GetFluidDivergence(fluid.GetGrid()) < divergence * 0.25f);
+    }
+
+    // buoyant density rises towards the top.
+    {
+        auto p = params;
+        p.buoyancy = 4.0f;
+        gfx::FluidSimulationInstance fluid(p);
+        fluid.AddDensity(glm::vec2(0.5f, 0.5f), 1.0f, 0.1f);
+        for (unsigned i=0; i<30; ++i)
+            fluid.Update(env, 1.0f/60.0f);
+        const auto center = GetFluidCenter(fluid.GetGrid());
+        TEST_REQUIRE(center.y < 0.45f);
+        TEST_REQUIRE(math::equals(center.x, 0.5f, 0.01f));
+    }
+
+    // density dissipates.
+    {
+        auto p = params;
+        p.density_dissipation = 1.0f;
+        gfx::FluidSimulationInstance fluid(p);
+        fluid.AddDensity(glm::vec2(0.5f, 0.5f), 1.0f, 0.1f);
+        const auto mass = GetFluidMass(fluid.GetGrid());
+        for (unsigned i=0; i<60; ++i)
+            fluid.Update(env, 1.0f/60.0f);
+        TEST_REQUIRE(GetFluidMass(fluid.GetGrid()) < mass * 0.5f);
+        TEST_REQUIRE(GetFluidMass(fluid.GetGrid()) > mass * 0.25f);
+    }
+
+    // the simulation only steps in fixed time steps.
+    {
+        gfx::FluidSimulationInstance fluid(params);
+        fluid.AddDensity(glm::vec2(0.3f, 0.5f), 1.0f, 0.05f);
+        fluid.AddVelocity(glm::vec2(0.3f, 0.5f), glm::vec2(1.0f, 0.0f), 0.15f);
+        const auto density = fluid.GetGrid().density;
+        fluid.Update(env, 0.5f/60.0f);
+        TEST_REQUIRE(fluid.GetGrid().density == density);
+        fluid.Update(env, 0.5f/60.0f);
+        TEST_REQUIRE(fluid.GetGrid().density != density);
+    }
+
+    // commands
+    {
+        gfx::FluidSimulationInstance fluid(params);
+        TEST_REQUIRE(GetFluidMass(fluid.GetGrid()) == 0.0f);
+
+        gfx::Drawable::Command cmd;
+        cmd.name = "AddDensity";
+        cmd.args["x"] = 0.25f;
+        cmd.args["y"] = 0.75f;
+        cmd.args["amount"] = 2;
+        fluid.Execute(env, cmd);
+        const auto mass = GetFluidMass(fluid.GetGrid());
+        TEST_REQUIRE(mass > 0.0f);
+        TEST_REQUIRE(math::equals(GetFluidCenter(fluid.GetGrid()).x, 0.25f, 0.01f));
+        TEST_REQUIRE(math::equals(GetFluidCenter(fluid.GetGrid()).y, 0.75f, 0.01f));
+
+        cmd.name = "AddVelocity";
+        cmd.args.clear();
+        cmd.args["vx"] = 1.0f;
+        fluid.Execute(env, cmd);
+        TEST_REQUIRE(GetFluidDivergence(fluid.GetGrid()) > 0.0f);
+        TEST_REQUIRE(GetFluidMass(fluid.GetGrid()) == mass);
+
+        // bad command is ignored
+        cmd.name = "Foobar";
+        fluid.Execute(env, cmd);
+        TEST_REQUIRE(GetFluidMass(fluid.GetGrid()) == mass);
+
+        fluid.Restart(env);
+        TEST_REQUIRE(GetFluidMass(fluid.GetGrid()) == 0.0f);
+    }
+
+    // density texture upload.
+    {
+        auto klass = std::make_shared<gfx::FluidSimulationClass>(params);
+        gfx::FluidSimulationInstance fluid(klass);
+        fluid.AddDensity(glm::vec2(0.5f, 0.5f), 1.0f, 0.1f);
+
+        TestDevice device;
+        gfx::Geometry::CreateArgs args;
+        TEST_REQUIRE(fluid.Construct(env, device, args));
+        TEST_REQUIRE(args.buffer.GetVertexCount() == 6);
+        TEST_REQUIRE(device.GetNumTextures() == 0);
+
+        const glm::mat4 identity(1.0f);
+        env.proj_matrix  = &identity;
+        env.view_matrix  = &identity;
+        env.model_matrix = &identity;
+
+        // the drawable binds the density texture after the material textures.
+        gfx::ProgramState program;
+        gfx::Drawable::RasterState state;
+        program.SetTextureCount(1);
+        TEST_REQUIRE(fluid.ApplyDynamicState(env, device, program, state));
+        TEST_REQUIRE(program.GetSamplerCount() == 2);
+
+        auto* texture = device.FindTexture(fluid.GetDensityTextureId());
+        TEST_REQUIRE(texture);
+        TEST_REQUIRE(texture->GetWidth() == 32);
+        TEST_REQUIRE(texture->GetHeight() == 32);
+        TEST_REQUIRE(texture->GetFormat() == gfx::Texture::Format::AlphaMask);
+        TEST_REQUIRE(program.GetSamplerSetting(1).texture == texture);
+        TEST_REQUIRE(program.GetSamplerSetting(1).name == "kFluidDensityMap");
+        TEST_REQUIRE(program.GetSamplerSetting(1).unit == 1);
+
+        const auto hash = texture->GetContentHash();
+        program.Clear();
+        TEST_REQUIRE(fluid.ApplyDynamicState(env, device, program, state));
+        TEST_REQUIRE(texture->GetContentHash() == hash);
+        TEST_REQUIRE(program.GetSamplerCount() == 1);
+
+        fluid.Update(env, 1.0f/60.0f);
+        program.Clear();
+        TEST_REQUIRE(fluid.ApplyDynamicState(env, device, program, state));
+        TEST_REQUIRE(texture->GetContentHash() != hash);
+
+        // another instance of the same class shares the geometry but
+        // has a texture of its own and doesn't overwrite the content
+        // of the first instance.
+        const auto fluid_hash = texture->GetContentHash();
+        gfx::FluidSimulationInstance other(klass);
+        TEST_REQUIRE(other.GetGeometryId(env) == fluid.GetGeometryId(env));
+        program.Clear();
+        TEST_REQUIRE(other.ApplyDynamicState(env, device, program, state));
+        TEST_REQUIRE(device.GetNumTextures() == 2);
+        TEST_REQUIRE(program.GetSamplerSetting(0).texture != texture);
+        TEST_REQUIRE(device.FindTexture(fluid.GetDensityTextureId()) == texture);
+        TEST_REQUIRE(texture->GetContentHash() == fluid_hash);
+
+        std::vector<std::uint8_t> texels;
+        gfx::FluidSimulationClass::ConvertDensity(fluid.GetGrid(), texels);
+        TEST_REQUIRE(texels.size() == 32 * 32);
+        TEST_REQUIRE(texels[16 * 32 + 16] > 200);
+        TEST_REQUIRE(texels[0] == 0);
+    }
+
+    // the parallel solver produces exactly the same result
+    // as the serial solver.
+    {
+        auto p = params;
+        p.grid_width  = 128;
+        p.grid_height = 128;
+        p.viscosity   = 0.0001f;
+        p.diffusion   = 0.0001f;
+        p.buoyancy    = 1.0f;
+        p.density_dissipation  = 0.1f;
+        p.velocity_dissipation = 0.1f;
+        gfx::FluidSimulationClass klass(p);
+
+        gfx::FluidSimulationClass::InstanceState serial;
+        gfx::FluidSimulationClass::InstanceState parallel;
+        klass.Restart(serial);
+        klass.Restart(parallel);
+        for (auto* state : { &serial, &parallel })
+        {
+            klass.AddDensity(*state, glm::vec2(0.5f, 0.8f), 1.0f, 0.05f);
+            klass.AddVelocity(*state, glm::vec2(0.5f, 0.8f), glm::vec2(0.2f, -0.5f), 0.1f);
+        }
+
+        base::ThreadPool threads;
+        threads.AddRealThread(base::ThreadPool::Worker0ThreadID);
+        threads.AddRealThread(base::ThreadPool::Worker1ThreadID);
+        threads.AddRealThread(base::ThreadPool::Worker2ThreadID);
+        TEST_REQUIRE(gfx::FluidSimulationClass::GetSolverThreadPool(serial.grid) == nullptr);
+        base::SetGlobalThreadPool(&threads);
+        TEST_REQUIRE(gfx::FluidSimulationClass::GetSolverThreadPool(serial.grid) == &threads);
+
+        for (unsigned i=0; i<20; ++i)
+        {
+            gfx::FluidSimulationClass::StepSimulation(p, serial.grid, p.time_step, nullptr);
+            gfx::FluidSimulationClass::StepSimulation(p, parallel.grid, p.time_step, &threads);
+        }
+        base::SetGlobalThreadPool(nullptr);
+        threads.Shutdown();
+
+        TEST_REQUIRE(GetFluidMass(serial.grid) > 0.0f);
+        TEST_REQUIRE(serial.grid.density    == parallel.grid.density);
+        TEST_REQUIRE(serial.grid.velocity_x == parallel.grid.velocity_x);
+        TEST_REQUIRE(serial.grid.velocity_y == parallel.grid.velocity_y);
+    }
+}
+
+void unit_test_fluid_simulation_perf()
+{
+    TEST_CASE(test::Type::Performance)
+
+    // measure the cost of a single simulation step at different
+    // grid resolutions both on a single thread and on the thread pool.
+    base::ThreadPool threads;
+    threads.AddRealThread(base::ThreadPool::Worker0ThreadID);
+    threads.AddRealThread(base::ThreadPool::Worker1ThreadID);
+    threads.AddRealThread(base::ThreadPool::Worker2ThreadID);
+
+    for (unsigned size : { 64u, 128u, 256u, 512u })
+    {
+        gfx::FluidSimulationClass::Params params;
+        params.grid_width  = size;
+        params.grid_height = size;
+        params.viscosity   = 0.0001f;
+        params.diffusion   = 0.0001f;
+        params.buoyancy    = 1.0f;
+        gfx::FluidSimulationClass klass(params);
+
+        const auto iterations = size >= 512 ? 20u : 100u;
+
+        for (auto* pool : { (base::ThreadPool*)nullptr, &threads })
+        {
+            gfx::FluidSimulationClass::InstanceState state;
+            klass.Restart(state);
+            klass.AddDensity(state, glm::vec2(0.5f, 0.8f), 1.0f, 0.1f);
+            klass.AddVelocity(state, glm::vec2(0.5f, 0.8f), glm::vec2(0.0f, -1.0f), 0.1f);
+
+            const auto& ret = test::TimedTest(iterations, [&params, &state, pool]() {
+                gfx::FluidSimulationClass::StepSimulation(params, state.grid, params.time_step, pool);
+            });
+            const auto& name = base::FormatString("fluid step %1x%1 %2", size, pool ? "parallel" : "serial");
+            test::PrintTestTimes(name.c_str(), ret);
+        }
+    }
+    threads.Shutdown();
+}
+
 // test that new programs are built out of vertex and
 // fragment shaders only when the shaders change not
 // when the high level class types changes. For example
@@ -2332,6 +2995,120 @@ void unit_test_gpu_id_bug()
 
 }
 
+void unit_test_texture_streaming()
+{
+    TEST_CASE(test::Type::Feature)
+
+    const auto MakeBitmap = [](unsigned size) {
+        return [size]() -> std::shared_ptr<const gfx::IBitmap> {
+            auto bitmap = std::make_shared<gfx::RgbaBitmap>();
+            bitmap->Resize(size, size);
+            bitmap->Fill(gfx::Color::HotPink);
+            return bitmap;
+        };
+    };
+    const auto Fail = []() -> std::shared_ptr<const gfx::IBitmap> {
+        return nullptr;
+    };
+
+    // upload budget and priorities without a thread pool.
+    {
+        gfx::TextureStreamer::Settings settings;
+        settings.upload_budget = 10 * 10 * 4;
+        gfx::TextureStreamer streamer(settings);
+
+        std::shared_ptr<const gfx::IBitmap> bitmap;
+        TEST_REQUIRE(streamer.Stream("a", 1.0f, MakeBitmap(10), &bitmap) == gfx::TextureStreamer::Status::Ready);
+        TEST_REQUIRE(bitmap && bitmap->GetWidth() == 10);
+        TEST_REQUIRE(streamer.Stream("b", 1.0f, MakeBitmap(10), &bitmap) == gfx::TextureStreamer::Status::Pending);
+        TEST_REQUIRE(streamer.Stream("c", 5.0f, MakeBitmap(10), &bitmap) == gfx::TextureStreamer::Status::Pending);
+        TEST_REQUIRE(streamer.Stream("d", 1.0f, Fail, &bitmap) == gfx::TextureStreamer::Status::Failed);
+        TEST_REQUIRE(streamer.GetStats().textures_uploaded == 1);
+        TEST_REQUIRE(streamer.GetStats().textures_decoded == 3);
+        TEST_REQUIRE(streamer.GetStats().bytes_decoded == 3 * 10 * 10 * 4);
+
+        // higher priority texture is uploaded first.
+        streamer.BeginFrame();
+        TEST_REQUIRE(streamer.GetStats().textures_pending == 2);
+        TEST_REQUIRE(streamer.Stream("b", 1.0f, MakeBitmap(10), &bitmap) == gfx::TextureStreamer::Status::Pending);
+        TEST_REQUIRE(streamer.Stream("c", 5.0f, MakeBitmap(10), &bitmap) == gfx::TextureStreamer::Status::Ready);
+
+        streamer.BeginFrame();
+        TEST_REQUIRE(streamer.Stream("b", 1.0f, MakeBitmap(10), &bitmap) == gfx::TextureStreamer::Status::Ready);
+        TEST_REQUIRE(streamer.GetStats().bytes_uploaded == 10 * 10 * 4);
+
+        // the first upload in a frame is allowed to exceed the budget.
+        streamer.BeginFrame();
+        TEST_REQUIRE(streamer.Stream("e", 1.0f, MakeBitmap(20), &bitmap) == gfx::TextureStreamer::Status::Ready);
+        TEST_REQUIRE(streamer.Stream("f", 1.0f, MakeBitmap(1), &bitmap) == gfx::TextureStreamer::Status::Pending);
+    }
+
+    // decoding on the thread pool.
+    {
+        base::ThreadPool threads;
+        threads.AddRealThread(base::ThreadPool::Worker0ThreadID);
+        base::SetGlobalThreadPool(&threads);
+
+        gfx::TextureStreamer streamer;
+
+        std::shared_ptr<const gfx::IBitmap> bitmap;
+        TEST_REQUIRE(streamer.Stream("a", 1.0f, MakeBitmap(10), &bitmap) == gfx::TextureStreamer::Status::Pending);
+
+        auto status = gfx::TextureStreamer::Status::Pending;
+        for (unsigned i=0; i<1000 && status == gfx::TextureStreamer::Status::Pending; ++i)
+        {
+            streamer.BeginFrame();
+            status = streamer.Stream("a", 1.0f, MakeBitmap(10), &bitmap);
+            if (status == gfx::TextureStreamer::Status::Pending)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        TEST_REQUIRE(status == gfx::TextureStreamer::Status::Ready);
+        TEST_REQUIRE(bitmap && bitmap->GetWidth() == 10);
+
+        base::SetGlobalThreadPool(nullptr);
+        threads.Shutdown();
+    }
+
+    // texture file source uses a placeholder until the texture is ready.
+    {
+        gfx::RgbaBitmap bmp;
+        bmp.Resize(10, 10);
+        bmp.Fill(gfx::Color::HotPink);
+        gfx::WritePNG(bmp, "test-texture.png");
+
+        gfx::TextureMap2DClass material0(gfx::MaterialClass::Type::Texture);
+        material0.SetTexture(gfx::LoadTextureFromFile("test-texture.png"));
+        gfx::TextureMap2DClass material1(gfx::MaterialClass::Type::Texture);
+        material1.SetTexture(gfx::LoadTextureFromFile("test-texture.png"));
+        material1.GetTextureMap(0)->GetTextureSource(0)->SetColorSpace(gfx::TextureSource::ColorSpace::Linear);
+
+        gfx::TextureStreamer::Settings settings;
+        settings.upload_budget = 1;
+
+        TestDevice device;
+        device.EnableTextureStreaming(true);
+        device.GetTextureStreamer()->SetSettings(settings);
+
+        gfx::ProgramState program;
+        gfx::MaterialClass::State env;
+        env.material_time = 0.0f;
+        env.editing_mode  = false;
+        env.texture_priority = 1.0f;
+        material0.ApplyDynamicState(env, device, program);
+        TEST_REQUIRE(device.GetNumTextures() == 1);
+        TEST_REQUIRE(device.GetTexture(0).GetWidth() == 10);
+
+        material1.ApplyDynamicState(env, device, program);
+        TEST_REQUIRE(device.GetNumTextures() == 2);
+        TEST_REQUIRE(device.GetTexture(1).GetWidth() == 2);
+
+        device.BeginFrame();
+        material1.ApplyDynamicState(env, device, program);
+        TEST_REQUIRE(device.GetNumTextures() == 3);
+        TEST_REQUIRE(device.GetTexture(2).GetWidth() == 10);
+    }
+}
+
 EXPORT_TEST_MAIN(
 int test_main(int argc, char* argv[])
 {
@@ -2350,6 +3127,12 @@ int test_main(int argc, char* argv[])
     unit_test_local_particles();
     unit_test_global_particles();
     unit_test_particles();
+    unit_test_particle_update();
+    unit_test_particle_update_perf();
+    unit_test_particle_parallel_update();
+    unit_test_particle_quads();
+    unit_test_fluid_simulation();
+    unit_test_fluid_simulation_perf();
     unit_test_painter_shape_material_pairing();
     unit_test_painter_fallback_material_shader();
     unit_test_painter_fallback_drawable_shader();
@@ -2357,6 +3140,7 @@ int test_main(int argc, char* argv[])
 
     unit_test_packed_texture_bug();
     unit_test_gpu_id_bug();
+    unit_test_texture_streaming();
     return 0;
 }
 ) // TEST_MAIN
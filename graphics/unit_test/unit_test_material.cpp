@@ -25,6 +25,7 @@
 #include "graphics/types.h"
 #include "graphics/material.h"
 #include "graphics/material_class.h"
+#include "graphics/material_instance.h"
 #include "graphics/texture_file_source.h"
 
 void unit_test_maps()
@@ -267,11 +268,52 @@ void unit_test_material_class()
     }
 }
 
+void unit_test_material_instance_state()
+{
+    TEST_CASE(test::Type::Feature)
+
+    auto color = std::make_shared<gfx::ColorClass>(gfx::MaterialClass::Type::Color);
+    auto other = std::make_shared<gfx::ColorClass>(gfx::MaterialClass::Type::Color);
+    auto sprite = std::make_shared<gfx::SpriteClass>(gfx::MaterialClass::Type::Sprite);
+
+    {
+        gfx::MaterialInstance a(color);
+        gfx::MaterialInstance b(color);
+        gfx::MaterialInstance c(other);
+        TEST_REQUIRE(a.HasSameState(a));
+        TEST_REQUIRE(a.HasSameState(b));
+        TEST_REQUIRE(!a.HasSameState(c));
+
+        // the color material doesn't care about the time.
+        b.SetRuntime(1.0);
+        TEST_REQUIRE(a.HasSameState(b));
+
+        b.SetUniform("kBaseColor", gfx::Color4f(gfx::Color::Red));
+        TEST_REQUIRE(!a.HasSameState(b));
+        a.SetUniform("kBaseColor", gfx::Color4f(gfx::Color::Red));
+        TEST_REQUIRE(a.HasSameState(b));
+        a.SetUniform("kBaseColor", gfx::Color4f(gfx::Color::Green));
+        TEST_REQUIRE(!a.HasSameState(b));
+    }
+
+    {
+        // sprites are animated so the runtime matters.
+        gfx::MaterialInstance a(sprite);
+        gfx::MaterialInstance b(sprite);
+        TEST_REQUIRE(a.HasSameState(b));
+        b.SetRuntime(1.0);
+        TEST_REQUIRE(!a.HasSameState(b));
+        a.SetRuntime(1.0);
+        TEST_REQUIRE(a.HasSameState(b));
+    }
+}
+
 EXPORT_TEST_MAIN(
 int test_main(int argc, char* argv[])
 {
     unit_test_maps();
     unit_test_material_class();
+    unit_test_material_instance_state();
     return 0;
 }
 ) // TEST_MAIN
\ No newline at end of file
@@ -0,0 +1,577 @@
+// Copyright (C) 2020-2025 Sami Väisänen
+// Copyright (C) 2020-2025 Ensisoft http://www.ensisoft.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "config.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "base/test_minimal.h"
+#include "base/format.h"
+#include "graphics/bitmap.h"
+#include "graphics/texture.h"
+#include "graphics/texture_container.h"
+#include "graphics/texture_file_source.h"
+
+namespace {
+// texture that records the uploads so that the container upload
+// can be tested without a GPU.
+class RecordingTexture : public gfx::Texture
+{
+public:
+    struct Upload {
+        unsigned level  = 0;
+        unsigned width  = 0;
+        unsigned height = 0;
+        size_t bytes = 0;
+    };
+    std::vector<Upload> uploads;
+
+    void SetFlag(Flags flag, bool on_off) override
+    {}
+    void SetFilter(MinFilter filter) override
+    {}
+    void SetFilter(MagFilter filter) override
+    {}
+    MinFilter GetMinFilter() const override
+    { return MinFilter::Default; }
+    MagFilter GetMagFilter() const override
+    { return MagFilter::Default; }
+    void SetWrapX(Wrapping w) override
+    {}
+    void SetWrapY(Wrapping w) override
+    {}
+    Wrapping GetWrapX() const override
+    { return Wrapping::Repeat; }
+    Wrapping GetWrapY() const override
+    { return Wrapping::Repeat; }
+    void Upload(const void* bytes, unsigned xres, unsigned yres, Format format) override
+    {
+        mWidth  = xres;
+        mHeight = yres;
+        mFormat = format;
+        uploads.push_back({0, xres, yres, 0});
+    }
+    void UploadMip(unsigned mip_level, const void* bytes, size_t byte_count,
+                   unsigned mip_width, unsigned mip_height) override
+    {
+        uploads.push_back({mip_level, mip_width, mip_height, byte_count});
+    }
+    void Allocate(unsigned width, unsigned height, Format format) override
+    {}
+    void AllocateArray(unsigned width, unsigned height, unsigned array_size, Format format) override
+    {}
+    unsigned GetWidth() const override
+    { return mWidth; }
+    unsigned GetHeight() const override
+    { return mHeight; }
+    unsigned GetArraySize() const override
+    { return 0; }
+    Format GetFormat() const override
+    { return mFormat; }
+    void SetContentHash(size_t hash) override
+    {}
+    size_t GetContentHash() const override
+    { return 0; }
+    void SetName(const std::string&) override
+    {}
+    void SetGroup(const std::string&) override
+    {}
+    bool TestFlag(Flags flag) const override
+    { return false; }
+    bool GenerateMips() override
+    { return false; }
+    bool HasMips() const override
+    { return false; }
+    std::string GetName() const override
+    { return ""; }
+    std::string GetGroup() const override
+    { return ""; }
+    std::string GetId() const override
+    { return ""; }
+private:
+    unsigned mWidth  = 0;
+    unsigned mHeight = 0;
+    Format mFormat = Format::AlphaMask;
+};
+
+// smooth gradient test image. block compression is lossy and
+// designed for natural images so a test pattern with hard noise
+// would produce too large errors for a meaningful comparison.
+gfx::RgbaBitmap MakeTestImage(unsigned width, unsigned height, bool alpha = true)
+{
+    gfx::RgbaBitmap bitmap(width, height);
+    for (unsigned row=0; row<height; ++row)
+    {
+        for (unsigned col=0; col<width; ++col)
+        {
+            gfx::Pixel_RGBA pixel;
+            pixel.r = static_cast<std::uint8_t>(col * 255 / width);
+            pixel.g = static_cast<std::uint8_t>(row * 255 / height);
+            pixel.b = static_cast<std::uint8_t>(128);
+            pixel.a = static_cast<std::uint8_t>((row / 4) % 2 || !alpha ? 255 : 0);
+            bitmap.SetPixel(row, col, pixel);
+        }
+    }
+    return bitmap;
+}
+
+// compute the max absolute difference of any channel between the bitmaps
+// and the mean absolute difference.
+void ComputeError(const gfx::IBitmap& lhs, const gfx::RgbaBitmap& rhs, bool alpha, int* max_error, double* mean_error)
+{
+    TEST_REQUIRE(lhs.GetWidth() == rhs.GetWidth());
+    TEST_REQUIRE(lhs.GetHeight() == rhs.GetHeight());
+    const auto view = lhs.GetReadView();
+
+    *max_error = 0;
+    double sum = 0.0;
+    for (unsigned row=0; row<rhs.GetHeight(); ++row)
+    {
+        for (unsigned col=0; col<rhs.GetWidth(); ++col)
+        {
+            gfx::Pixel_RGBA a;
+            view->ReadPixel(row, col, &a);
+            const auto& b = rhs.GetPixel(row, col);
+            const int errors[4] = {
+                std::abs(int(a.r) - int(b.r)),
+                std::abs(int(a.g) - int(b.g)),
+                std::abs(int(a.b) - int(b.b)),
+                alpha ? std::abs(int(a.a) - int(b.a)) : 0
+            };
+            for (auto e : errors)
+            {
+                *max_error = std::max(*max_error, e);
+                sum += e;
+            }
+        }
+    }
+    *mean_error = sum / (rhs.GetWidth() * rhs.GetHeight() * (alpha ? 4 : 3));
+}
+
+} // namespace
+
+void unit_test_level_sizes()
+{
+    TEST_CASE(test::Type::Feature)
+
+    using F = gfx::TextureContainer::Format;
+    TEST_REQUIRE(gfx::TextureContainer::GetLevelByteSize(F::RGBA, 10, 10) == 400);
+    TEST_REQUIRE(gfx::TextureContainer::GetLevelByteSize(F::RGB, 10, 10) == 300);
+    TEST_REQUIRE(gfx::TextureContainer::GetLevelByteSize(F::AlphaMask, 10, 10) == 100);
+    TEST_REQUIRE(gfx::TextureContainer::GetLevelByteSize(F::BC1, 4, 4) == 8);
+    TEST_REQUIRE(gfx::TextureContainer::GetLevelByteSize(F::BC1, 1, 1) == 8);
+    TEST_REQUIRE(gfx::TextureContainer::GetLevelByteSize(F::BC1, 5, 5) == 32);
+    TEST_REQUIRE(gfx::TextureContainer::GetLevelByteSize(F::BC3, 8, 4) == 32);
+    TEST_REQUIRE(gfx::TextureContainer::GetLevelByteSize(F::ETC2_RGB, 8, 8) == 32);
+    TEST_REQUIRE(gfx::TextureContainer::GetLevelByteSize(F::ETC2_RGBA, 8, 8) == 64);
+
+    TEST_REQUIRE(gfx::TextureContainer::IsCompressed(F::BC1));
+    TEST_REQUIRE(gfx::TextureContainer::IsCompressed(F::ETC2_RGBA));
+    TEST_REQUIRE(!gfx::TextureContainer::IsCompressed(F::RGBA));
+
+    // device texture format sizes must agree with the container.
+    TEST_REQUIRE(dev::GetCompressedTextureByteSize(dev::TextureFormat::BC1_RGB, 5, 5) == 32);
+    TEST_REQUIRE(dev::GetCompressedTextureByteSize(dev::TextureFormat::ETC2_RGBA, 8, 8) == 64);
+}
+
+void unit_test_uncompressed()
+{
+    TEST_CASE(test::Type::Feature)
+
+    const auto& bitmap = MakeTestImage(13, 7);
+
+    gfx::TextureContainer container;
+    TEST_REQUIRE(!container.IsValid());
+    container.SetFlag(gfx::TextureContainer::Flags::PremulAlpha, true);
+    TEST_REQUIRE(container.Encode(bitmap, gfx::TextureContainer::Format::RGBA, false));
+    TEST_REQUIRE(container.IsValid());
+    TEST_REQUIRE(container.GetLevelCount() == 1);
+    TEST_REQUIRE(container.GetWidth() == 13);
+    TEST_REQUIRE(container.GetHeight() == 7);
+
+    const auto& data = container.ToMemory();
+
+    gfx::TextureContainer other;
+    TEST_REQUIRE(other.FromMemory(data.data(), data.size()));
+    TEST_REQUIRE(other.GetFormat() == gfx::TextureContainer::Format::RGBA);
+    TEST_REQUIRE(other.TestFlag(gfx::TextureContainer::Flags::PremulAlpha));
+    TEST_REQUIRE(!other.TestFlag(gfx::TextureContainer::Flags::sRGB));
+    TEST_REQUIRE(other.GetLevelCount() == 1);
+
+    const auto& ret = other.Decode(0);
+    TEST_REQUIRE(ret->GetDepthBits() == 32);
+    TEST_REQUIRE(*static_cast<const gfx::RgbaBitmap*>(ret.get()) == bitmap);
+
+    // wrong bitmap depth for the format
+    gfx::RgbBitmap rgb(4, 4);
+    TEST_REQUIRE(!container.Encode(rgb, gfx::TextureContainer::Format::RGBA, false));
+    TEST_REQUIRE(container.Encode(rgb, gfx::TextureContainer::Format::RGB, false));
+    gfx::AlphaMask mask(4, 4);
+    TEST_REQUIRE(!container.Encode(mask, gfx::TextureContainer::Format::BC1, false));
+    TEST_REQUIRE(container.Encode(mask, gfx::TextureContainer::Format::AlphaMask, false));
+}
+
+void unit_test_mips()
+{
+    TEST_CASE(test::Type::Feature)
+
+    const auto& bitmap = MakeTestImage(64, 16);
+
+    gfx::TextureContainer container;
+    container.SetFlag(gfx::TextureContainer::Flags::sRGB, true);
+    TEST_REQUIRE(container.Encode(bitmap, gfx::TextureContainer::Format::BC3, true));
+    TEST_REQUIRE(container.GetLevelCount() == 7);
+
+    const unsigned expected[7][2] = {
+        {64, 16}, {32, 8}, {16, 4}, {8, 2}, {4, 1}, {2, 1}, {1, 1}
+    };
+    for (unsigned i=0; i<7; ++i)
+    {
+        const auto& level = container.GetLevel(i);
+        TEST_REQUIRE(level.width  == expected[i][0]);
+        TEST_REQUIRE(level.height == expected[i][1]);
+        TEST_REQUIRE(level.data.size() == gfx::TextureContainer::GetLevelByteSize(
+                gfx::TextureContainer::Format::BC3, level.width, level.height));
+    }
+
+    const auto& data = container.ToMemory();
+    gfx::TextureContainer other;
+    TEST_REQUIRE(other.FromMemory(data.data(), data.size()));
+    TEST_REQUIRE(other.GetLevelCount() == 7);
+    TEST_REQUIRE(other.TestFlag(gfx::TextureContainer::Flags::sRGB));
+    for (unsigned i=0; i<7; ++i)
+    {
+        TEST_REQUIRE(other.GetLevel(i).width == expected[i][0]);
+        TEST_REQUIRE(other.GetLevel(i).height == expected[i][1]);
+        TEST_REQUIRE(other.GetLevel(i).data == container.GetLevel(i).data);
+
+        const auto& ret = other.Decode(i);
+        TEST_REQUIRE(ret->GetWidth() == expected[i][0]);
+        TEST_REQUIRE(ret->GetHeight() == expected[i][1]);
+    }
+}
+
+void unit_test_compressed_round_trip()
+{
+    TEST_CASE(test::Type::Feature)
+
+    struct TestCase {
+        gfx::TextureContainer::Format format;
+        bool alpha;
+    } cases[] = {
+        {gfx::TextureContainer::Format::BC1,       false},
+        {gfx::TextureContainer::Format::BC3,       true},
+        {gfx::TextureContainer::Format::ETC2_RGB,  false},
+        {gfx::TextureContainer::Format::ETC2_RGBA, true}
+    };
+
+    // odd size to exercise the partial edge blocks.
+    const auto& bitmap = MakeTestImage(30, 18);
+
+    for (const auto& test : cases)
+    {
+        const auto& image = MakeTestImage(30, 18, test.alpha);
+
+        gfx::TextureContainer container;
+        TEST_REQUIRE(container.Encode(image, test.format, false));
+
+        const auto& data = container.ToMemory();
+        gfx::TextureContainer other;
+        TEST_REQUIRE(other.FromMemory(data.data(), data.size()));
+        TEST_REQUIRE(other.GetFormat() == test.format);
+
+        const auto& ret = other.Decode(0);
+        TEST_REQUIRE(ret->GetDepthBits() == 32);
+
+        int max_error = 0;
+        double mean_error = 0.0;
+        ComputeError(*ret, image, test.alpha, &max_error, &mean_error);
+        TEST_REQUIRE(max_error <= 32);
+        TEST_REQUIRE(mean_error <= 6.0);
+    }
+
+    // BC1 1bit alpha
+    {
+        gfx::TextureContainer container;
+        TEST_REQUIRE(container.Encode(bitmap, gfx::TextureContainer::Format::BC1, false));
+        const auto& ret = container.Decode(0);
+        const auto view = ret->GetReadView();
+        for (unsigned row=0; row<bitmap.GetHeight(); ++row)
+        {
+            for (unsigned col=0; col<bitmap.GetWidth(); ++col)
+            {
+                gfx::Pixel_RGBA pixel;
+                view->ReadPixel(row, col, &pixel);
+                TEST_REQUIRE(pixel.a == bitmap.GetPixel(row, col).a);
+            }
+        }
+    }
+
+    // solid colors should survive practically intact.
+    {
+        gfx::RgbaBitmap solid(8, 8);
+        solid.Fill(gfx::Pixel_RGBA(200, 100, 50, 255));
+        for (const auto& test : cases)
+        {
+            gfx::TextureContainer container;
+            TEST_REQUIRE(container.Encode(solid, test.format, false));
+            int max_error = 0;
+            double mean_error = 0.0;
+            ComputeError(*container.Decode(0), solid, test.alpha, &max_error, &mean_error);
+            TEST_REQUIRE(max_error <= 8);
+        }
+    }
+}
+
+void unit_test_invalid_data()
+{
+    TEST_CASE(test::Type::Feature)
+
+    gfx::TextureContainer container;
+    TEST_REQUIRE(container.Encode(MakeTestImage(16, 16), gfx::TextureContainer::Format::ETC2_RGB, true));
+    const auto& data = container.ToMemory();
+
+    gfx::TextureContainer other;
+    // truncated
+    TEST_REQUIRE(!other.FromMemory(data.data(), 10));
+    TEST_REQUIRE(!other.FromMemory(data.data(), data.size() - 1));
+    // bad magic
+    {
+        auto copy = data;
+        copy[0] = 'X';
+        TEST_REQUIRE(!other.FromMemory(copy.data(), copy.size()));
+    }
+    // bad version
+    {
+        auto copy = data;
+        copy[4] = 2;
+        TEST_REQUIRE(!other.FromMemory(copy.data(), copy.size()));
+    }
+    // bad format
+    {
+        auto copy = data;
+        copy[8] = 100;
+        TEST_REQUIRE(!other.FromMemory(copy.data(), copy.size()));
+    }
+    // level data offset + size wraps around
+    {
+        auto copy = data;
+        std::uint64_t bytes = 0;
+        std::memcpy(&bytes, &copy[24 + 16], sizeof(bytes));
+        const std::uint64_t offset = ~std::uint64_t(0) - bytes + 2;
+        std::memcpy(&copy[24 + 8], &offset, sizeof(offset));
+        TEST_REQUIRE(!other.FromMemory(copy.data(), copy.size()));
+    }
+    // mip level dimensions don't match the base level, 4x16 has
+    // the same byte size as the expected 8x8.
+    {
+        auto copy = data;
+        const std::uint32_t width  = 4;
+        const std::uint32_t height = 16;
+        std::memcpy(&copy[48 + 0], &width, sizeof(width));
+        std::memcpy(&copy[48 + 4], &height, sizeof(height));
+        TEST_REQUIRE(!other.FromMemory(copy.data(), copy.size()));
+    }
+    // not a container at all
+    {
+        const char* png = "\x89PNG\r\n\x1a\n..........................";
+        TEST_REQUIRE(!other.FromMemory(png, std::strlen(png)));
+    }
+    TEST_REQUIRE(!other.IsValid());
+    TEST_REQUIRE(other.FromMemory(data.data(), data.size()));
+    TEST_REQUIRE(other.IsValid());
+}
+
+void unit_test_upload()
+{
+    TEST_CASE(test::Type::Feature)
+
+    gfx::TextureContainer container;
+    container.SetFlag(gfx::TextureContainer::Flags::sRGB, true);
+    TEST_REQUIRE(container.Encode(MakeTestImage(8, 8), gfx::TextureContainer::Format::BC1, true));
+    TEST_REQUIRE(container.GetLevelCount() == 4);
+
+    // format support
+    {
+        dev::GraphicsDeviceCaps caps;
+        caps.texture_compression_bc      = false;
+        caps.texture_compression_bc_srgb = false;
+        caps.texture_compression_etc2    = false;
+        using F = gfx::TextureContainer::Format;
+        TEST_REQUIRE(gfx::TextureContainer::IsFormatSupported(F::RGBA, true, caps));
+        TEST_REQUIRE(!gfx::TextureContainer::IsFormatSupported(F::BC1, false, caps));
+        TEST_REQUIRE(!gfx::TextureContainer::IsFormatSupported(F::ETC2_RGB, false, caps));
+        caps.texture_compression_bc = true;
+        TEST_REQUIRE(gfx::TextureContainer::IsFormatSupported(F::BC1, false, caps));
+        TEST_REQUIRE(!gfx::TextureContainer::IsFormatSupported(F::BC1, true, caps));
+        caps.texture_compression_bc_srgb = true;
+        TEST_REQUIRE(gfx::TextureContainer::IsFormatSupported(F::BC3, true, caps));
+        caps.texture_compression_etc2 = true;
+        TEST_REQUIRE(gfx::TextureContainer::IsFormatSupported(F::ETC2_RGBA, true, caps));
+    }
+
+    // device supports the format, upload as-is
+    {
+        dev::GraphicsDeviceCaps caps;
+        caps.texture_compression_bc      = true;
+        caps.texture_compression_bc_srgb = true;
+
+        RecordingTexture texture;
+        TEST_REQUIRE(container.Upload(&texture, caps));
+        TEST_REQUIRE(texture.GetFormat() == gfx::Texture::Format::BC1_sRGB);
+        TEST_REQUIRE(texture.uploads.size() == 4);
+        TEST_REQUIRE(texture.uploads[0].width == 8);
+        TEST_REQUIRE(texture.uploads[1].level == 1);
+        TEST_REQUIRE(texture.uploads[1].width == 4);
+        TEST_REQUIRE(texture.uploads[1].bytes == 8);
+        TEST_REQUIRE(texture.uploads[3].level == 3);
+        TEST_REQUIRE(texture.uploads[3].width == 1);
+        TEST_REQUIRE(texture.uploads[3].bytes == 8);
+    }
+
+    // no support, transcode
+    {
+        dev::GraphicsDeviceCaps caps;
+        caps.texture_compression_bc      = false;
+        caps.texture_compression_bc_srgb = false;
+
+        RecordingTexture texture;
+        TEST_REQUIRE(container.Upload(&texture, caps));
+        TEST_REQUIRE(texture.GetFormat() == gfx::Texture::Format::sRGBA);
+        TEST_REQUIRE(texture.uploads.size() == 4);
+        TEST_REQUIRE(texture.uploads[1].width == 4);
+        TEST_REQUIRE(texture.uploads[1].bytes == 4*4*4);
+        TEST_REQUIRE(texture.uploads[3].bytes == 4);
+    }
+
+    // ETC2 RGB transcodes to RGB
+    {
+        gfx::TextureContainer etc;
+        TEST_REQUIRE(etc.Encode(MakeTestImage(8, 8), gfx::TextureContainer::Format::ETC2_RGB, false));
+
+        dev::GraphicsDeviceCaps caps;
+        caps.texture_compression_etc2 = false;
+        RecordingTexture texture;
+        TEST_REQUIRE(etc.Upload(&texture, caps));
+        TEST_REQUIRE(texture.GetFormat() == gfx::Texture::Format::RGB);
+    }
+}
+
+void unit_test_bake()
+{
+    TEST_CASE(test::Type::Feature)
+
+    using Effect = gfx::TextureFileSource::Effect;
+    using ColorSpace = gfx::TextureFileSource::ColorSpace;
+    using Flags = gfx::TextureContainer::Flags;
+
+    // RGBA with premultiplied alpha
+    {
+        gfx::RgbaBitmap bitmap(16, 8);
+        bitmap.Fill(gfx::Pixel_RGBA(255, 255, 255, 0));
+
+        gfx::TextureContainer container;
+        TEST_REQUIRE(gfx::TextureFileSource::BakeData(bitmap, ColorSpace::sRGB, true, {}, &container));
+        TEST_REQUIRE(container.GetFormat() == gfx::TextureContainer::Format::RGBA);
+        TEST_REQUIRE(container.GetLevelCount() == 5);
+        TEST_REQUIRE(container.TestFlag(Flags::sRGB));
+        TEST_REQUIRE(container.TestFlag(Flags::PremulAlpha));
+        TEST_REQUIRE(!container.TestFlag(Flags::AlphaMask));
+        TEST_REQUIRE(!container.TestFlag(Flags::EdgeEffect));
+        TEST_REQUIRE(!container.TestFlag(Flags::BlurEffect));
+
+        for (unsigned i=0; i<container.GetLevelCount(); ++i)
+        {
+            const auto& level = container.Decode(i);
+            const auto* rgba = static_cast<const gfx::RgbaBitmap*>(level.get());
+            TEST_REQUIRE(rgba->PixelCompare(gfx::Pixel_RGBA(0, 0, 0, 0)));
+        }
+    }
+
+    // RGB in linear color space, no effects possible
+    {
+        gfx::RgbBitmap bitmap(4, 4);
+        bitmap.Fill(gfx::Pixel_RGB(10, 20, 30));
+
+        base::bitflag<Effect> effects;
+        effects.set(Effect::Blur, true);
+
+        gfx::TextureContainer container;
+        TEST_REQUIRE(gfx::TextureFileSource::BakeData(bitmap, ColorSpace::Linear, true, effects, &container));
+        TEST_REQUIRE(container.GetFormat() == gfx::TextureContainer::Format::RGB);
+        TEST_REQUIRE(container.GetLevelCount() == 3);
+        TEST_REQUIRE(!container.TestFlag(Flags::sRGB));
+        TEST_REQUIRE(!container.TestFlag(Flags::PremulAlpha));
+        TEST_REQUIRE(!container.TestFlag(Flags::BlurEffect));
+    }
+
+    // alpha mask with effects is expanded to RGBA
+    {
+        gfx::AlphaMask bitmap(32, 32);
+        bitmap.Fill(gfx::Pixel_A(0));
+        bitmap.Fill(gfx::URect(8, 8, 16, 16), gfx::Pixel_A(255));
+
+        base::bitflag<Effect> effects;
+        effects.set(Effect::Edges, true);
+
+        gfx::TextureContainer container;
+        TEST_REQUIRE(gfx::TextureFileSource::BakeData(bitmap, ColorSpace::sRGB, false, effects, &container));
+        TEST_REQUIRE(container.GetFormat() == gfx::TextureContainer::Format::RGBA);
+        TEST_REQUIRE(container.GetLevelCount() == 6);
+        TEST_REQUIRE(container.TestFlag(Flags::AlphaMask));
+        TEST_REQUIRE(container.TestFlag(Flags::EdgeEffect));
+        TEST_REQUIRE(!container.TestFlag(Flags::sRGB));
+
+        const auto& level = container.Decode(0);
+        const auto* rgba = static_cast<const gfx::RgbaBitmap*>(level.get());
+        // inside and outside of the square have no edges.
+        TEST_REQUIRE(rgba->GetPixel(16, 16).a == 0);
+        TEST_REQUIRE(rgba->GetPixel(2, 2).a == 0);
+        // the edge of the square
+        TEST_REQUIRE(rgba->GetPixel(8, 16).a == 255);
+        TEST_REQUIRE(rgba->GetPixel(16, 8).a == 255);
+    }
+
+    // alpha mask without effects stays as-is
+    {
+        gfx::AlphaMask bitmap(8, 8);
+        bitmap.Fill(gfx::Pixel_A(128));
+
+        gfx::TextureContainer container;
+        TEST_REQUIRE(gfx::TextureFileSource::BakeData(bitmap, ColorSpace::sRGB, true, {}, &container));
+        TEST_REQUIRE(container.GetFormat() == gfx::TextureContainer::Format::AlphaMask);
+        TEST_REQUIRE(container.GetLevelCount() == 4);
+        TEST_REQUIRE(!container.TestFlag(Flags::AlphaMask));
+        TEST_REQUIRE(!container.TestFlag(Flags::PremulAlpha));
+    }
+}
+
+EXPORT_TEST_MAIN(
+int test_main(int argc, char* argv[])
+{
+    unit_test_level_sizes();
+    unit_test_uncompressed();
+    unit_test_mips();
+    unit_test_compressed_round_trip();
+    unit_test_invalid_data();
+    unit_test_upload();
+    unit_test_bake();
+    return 0;
+}
+) // EXPORT_TEST_MAIN